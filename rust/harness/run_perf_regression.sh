@@ -0,0 +1,210 @@
+#!/bin/bash
+#
+# SuperMelee Performance Regression Runner
+#
+# Runs the game's SuperMelee benchmark (config.meleebenchmark, see
+# RunMeleeBenchmark() in sc2/src/uqm/supermelee/melee.c) on a recorded
+# battle, reads the "Benchmark:" results from the log, and compares them
+# against a stored baseline.
+#
+# The recording fixes the seed, the fleets and every input, so each run does
+# the same work. The game goes straight into the battle and quits after it;
+# no input is needed.
+#
+# Usage:
+#   run_perf_regression.sh REPLAY [BASELINE]
+#
+#   REPLAY    a battle recorded with config.meleerecord (lastmelee.rpl)
+#   BASELINE  defaults to perf_baseline.txt next to this script
+#
+# Environment:
+#   UQM_BIN        the game binary (default: sc2/uqm)
+#   CONTENT_DIR    default: sc2/content
+#   PERF_TOLERANCE percent a result may be worse than the baseline (default 10)
+#   PERF_UPDATE    when 1, write the results as the new baseline and pass
+#   PERF_RUNS      runs per measurement; the best one counts (default 3)
+#   PERF_MIN_US    times with a baseline below this are shown but never fail,
+#                  as they are mostly noise (default 100)
+#
+# This script FAILS if:
+#   - The game does not run the benchmark (no "Benchmark:" line in the log)
+#   - Any result is more than PERF_TOLERANCE percent worse than the baseline
+#
+# The baseline depends on the machine and the graphics settings, so it is
+# made with PERF_UPDATE=1 on the machine that runs the comparisons.
+#
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+RUST_DIR="$(cd "${SCRIPT_DIR}/.." && pwd)"
+REPO_ROOT="$(cd "${RUST_DIR}/.." && pwd)"
+
+UQM_BIN="${UQM_BIN:-${REPO_ROOT}/sc2/uqm}"
+CONTENT_DIR="${CONTENT_DIR:-${REPO_ROOT}/sc2/content}"
+PERF_TOLERANCE="${PERF_TOLERANCE:-10}"
+PERF_UPDATE="${PERF_UPDATE:-0}"
+PERF_RUNS="${PERF_RUNS:-3}"
+PERF_MIN_US="${PERF_MIN_US:-100}"
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 REPLAY [BASELINE]"
+    exit 2
+fi
+REPLAY="$1"
+BASELINE="${2:-${SCRIPT_DIR}/perf_baseline.txt}"
+
+echo "=== SuperMelee Performance Regression ==="
+echo "Started: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+echo "UQM_BIN: ${UQM_BIN}"
+echo "REPLAY: ${REPLAY}"
+echo "BASELINE: ${BASELINE}"
+echo "TOLERANCE: ${PERF_TOLERANCE}%"
+echo ""
+
+# --------------------------------------------------------------------------
+# 0. Verify prerequisites
+# --------------------------------------------------------------------------
+
+if [ ! -x "${UQM_BIN}" ]; then
+    echo "FAIL: ${UQM_BIN} not found or not executable"
+    exit 1
+fi
+if [ ! -f "${REPLAY}" ]; then
+    echo "FAIL: ${REPLAY} not found"
+    exit 1
+fi
+if [ "${PERF_UPDATE}" != "1" ] && [ ! -f "${BASELINE}" ]; then
+    echo "FAIL: ${BASELINE} not found; run with PERF_UPDATE=1 to make it"
+    exit 1
+fi
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "${WORK_DIR}"' EXIT
+
+# The benchmark reads the replay from the config dir
+cp "${REPLAY}" "${WORK_DIR}/benchmark.rpl"
+cat > "${WORK_DIR}/uqm.cfg" <<EOF
+meleebenchmark = STRING:benchmark.rpl
+EOF
+
+# --------------------------------------------------------------------------
+# 1. Run the benchmark
+# --------------------------------------------------------------------------
+
+# Results are "metric value" lines. Frame rates are better when higher,
+# times (us per displayed frame) when lower.
+RESULTS="${WORK_DIR}/results.txt"
+: > "${RESULTS}"
+
+for run in $(seq 1 "${PERF_RUNS}"); do
+    LOG="${WORK_DIR}/run${run}.log"
+    echo "--- Run ${run} of ${PERF_RUNS} ---"
+    "${UQM_BIN}" --configdir="${WORK_DIR}" --contentdir="${CONTENT_DIR}" \
+            --logfile="${LOG}" >/dev/null 2>&1 || true
+
+    if ! grep -q "Benchmark:" "${LOG}" 2>/dev/null; then
+        echo "FAIL: no benchmark results in the log of run ${run}"
+        tail -20 "${LOG}" 2>/dev/null || true
+        exit 1
+    fi
+    grep "Benchmark:" "${LOG}"
+
+    # "Benchmark: N battle frames in S s; X simulated frames/s,
+    #  Y displayed frames/s", then the percentile table
+    awk '
+        /Benchmark:/ {
+            for (i = 1; i <= NF; ++i) {
+                if ($(i + 1) == "simulated")
+                    printf "simulated_fps %s\n", $i
+                else if ($(i + 1) == "displayed")
+                    printf "displayed_fps %s\n", $i
+            }
+            table = 1
+            next
+        }
+        table && /us per frame/ { next }
+        table && NF >= 4 && $(NF - 2) ~ /^[0-9]+$/ {
+            printf "%s_p50_us %s\n", $(NF - 3), $(NF - 2)
+            printf "%s_p90_us %s\n", $(NF - 3), $(NF - 1)
+            printf "%s_p99_us %s\n", $(NF - 3), $NF
+        }
+    ' "${LOG}" | sed 's/,$//' >> "${RESULTS}"
+done
+echo ""
+
+# The best of the runs, so one disturbed run does not fail the comparison
+BEST="${WORK_DIR}/best.txt"
+awk '
+    {
+        if (!($1 in best)) {
+            best[$1] = $2
+            order[n++] = $1
+        } else if ($1 ~ /_fps$/ ? $2 + 0 > best[$1] + 0 : $2 + 0 < best[$1] + 0) {
+            best[$1] = $2
+        }
+    }
+    END {
+        for (i = 0; i < n; ++i)
+            printf "%s %s\n", order[i], best[order[i]]
+    }
+' "${RESULTS}" > "${BEST}"
+
+# --------------------------------------------------------------------------
+# 2. Compare against the baseline
+# --------------------------------------------------------------------------
+
+if [ "${PERF_UPDATE}" = "1" ]; then
+    {
+        echo "# SuperMelee benchmark baseline, written by run_perf_regression.sh"
+        echo "# $(date -u +%Y-%m-%dT%H:%M:%SZ) $(uname -srm)"
+        cat "${BEST}"
+    } > "${BASELINE}"
+    echo "PASS: baseline written to ${BASELINE}"
+    exit 0
+fi
+
+echo "--- Comparing against ${BASELINE} ---"
+set +e
+awk -v tol="${PERF_TOLERANCE}" -v min_us="${PERF_MIN_US}" '
+    NR == FNR {
+        if ($0 !~ /^#/ && NF == 2)
+            base[$1] = $2
+        next
+    }
+    {
+        if (!($1 in base)) {
+            printf "  %-24s %10s (not in the baseline)\n", $1, $2
+            next
+        }
+        b = base[$1]
+        if (b == 0) {
+            printf "  %-24s %10s (baseline is 0)\n", $1, $2
+            next
+        }
+        # Positive is worse
+        if ($1 ~ /_fps$/)
+            change = (b - $2) * 100 / b
+        else
+            change = ($2 - b) * 100 / b
+        if ($1 ~ /_us$/ && b < min_us + 0)
+            status = "(too small)"
+        else if (change > tol)
+            status = "FAIL"
+        else
+            status = "ok"
+        printf "  %-24s %10s  baseline %10s  %+6.1f%% worse  %s\n",
+                $1, $2, b, change, status
+        if (status == "FAIL")
+            failed++
+    }
+    END { exit failed ? 1 : 0 }
+' "${BASELINE}" "${BEST}"
+STATUS=$?
+set -e
+echo ""
+
+if [ ${STATUS} -ne 0 ]; then
+    echo "FAIL: results more than ${PERF_TOLERANCE}% worse than the baseline"
+    exit 1
+fi
+echo "PASS: no results more than ${PERF_TOLERANCE}% worse than the baseline"
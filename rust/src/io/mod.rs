@@ -6,8 +6,10 @@
 pub mod dirs;
 pub mod ffi;
 pub mod files;
+pub mod read_ahead;
 pub mod temp;
 pub mod uio_bridge;
+pub mod uio_stats;
 pub mod zip_reader; // @plan PLAN-20260314-FILE-IO.P09 @requirement REQ-FIO-ARCHIVE-MOUNT
 
 // Re-exports for convenience
@@ -0,0 +1,343 @@
+//! Read-ahead for streams that are read front to back.
+//!
+//! The source is handed to an I/O thread that keeps reading the blocks
+//! after the one being consumed into a bounded queue, so a sequential
+//! reader finds its data there instead of waiting on the read (or, for a
+//! compressed ZIP entry, the inflation). Seeking within the current block,
+//! or a little way ahead, is served from the queue; any other seek stops
+//! the thread, seeks the source and starts over from there.
+
+use std::io::{self, Read, Seek, SeekFrom};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{self, Receiver};
+use std::sync::Arc;
+use std::thread::JoinHandle;
+
+pub struct ReadAhead<S: Read + Seek + Send + 'static> {
+    block_size: usize,
+    num_blocks: usize,
+    /// Size of the source, for seeks relative to the end
+    len: u64,
+    /// Offset in the source of the next byte to be read
+    position: u64,
+    /// The block being consumed, and how far into it `position` is
+    current: Vec<u8>,
+    current_pos: usize,
+    /// No more blocks are coming
+    at_end: bool,
+    worker: Option<Worker<S>>,
+    /// The source, while no thread runs
+    idle: Option<S>,
+}
+
+struct Worker<S> {
+    blocks: Receiver<io::Result<Vec<u8>>>,
+    stop: Arc<AtomicBool>,
+    thread: JoinHandle<S>,
+}
+
+impl<S: Read + Seek + Send + 'static> ReadAhead<S> {
+    /// Start reading ahead in `source`, which is at `position` and `len`
+    /// bytes long, keeping up to `num_blocks` blocks of `block_size` bytes
+    /// in flight. If no thread can be started, reads go straight to the
+    /// source.
+    pub fn new(source: S, position: u64, len: u64, block_size: usize, num_blocks: usize) -> Self {
+        let mut reader = ReadAhead {
+            block_size: block_size.max(1),
+            num_blocks: num_blocks.max(1),
+            len,
+            position,
+            current: Vec::new(),
+            current_pos: 0,
+            at_end: false,
+            worker: None,
+            idle: Some(source),
+        };
+        reader.start();
+        reader
+    }
+
+    pub fn len(&self) -> u64 {
+        self.len
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// Stop reading ahead and get the source back, positioned where the
+    /// reader was
+    pub fn into_inner(mut self) -> io::Result<S> {
+        self.stop()?;
+        let mut source = self
+            .idle
+            .take()
+            .ok_or_else(|| io::Error::other("read-ahead source lost"))?;
+        source.seek(SeekFrom::Start(self.position))?;
+        Ok(source)
+    }
+
+    fn start(&mut self) {
+        let Some(source) = self.idle.take() else {
+            return;
+        };
+
+        // The source goes to the thread through a channel, so that it
+        // is not lost if the thread cannot be started
+        let (source_tx, source_rx) = mpsc::channel::<S>();
+        let (block_tx, block_rx) = mpsc::sync_channel(self.num_blocks);
+        let stop = Arc::new(AtomicBool::new(false));
+        let block_size = self.block_size;
+        let thread_stop = Arc::clone(&stop);
+
+        let spawned = std::thread::Builder::new()
+            .name("uio read-ahead".into())
+            .spawn(move || {
+                let mut source = source_rx.recv().expect("read-ahead source");
+                while !thread_stop.load(Ordering::Relaxed) {
+                    let block = read_block(&mut source, block_size);
+                    let done = !matches!(&block, Ok(data) if !data.is_empty());
+                    if block_tx.send(block).is_err() || done {
+                        break;
+                    }
+                }
+                source
+            });
+
+        match spawned {
+            Ok(thread) => {
+                let _ = source_tx.send(source);
+                self.worker = Some(Worker {
+                    blocks: block_rx,
+                    stop,
+                    thread,
+                });
+            }
+            Err(_) => self.idle = Some(source),
+        }
+    }
+
+    /// Stop the thread and take the source back; where the source is at
+    /// is then unknown
+    fn stop(&mut self) -> io::Result<()> {
+        let Some(worker) = self.worker.take() else {
+            return Ok(());
+        };
+        worker.stop.store(true, Ordering::Relaxed);
+        // Unblocks the thread if it is waiting for room in the queue
+        drop(worker.blocks);
+        let source = worker
+            .thread
+            .join()
+            .map_err(|_| io::Error::other("read-ahead thread panicked"))?;
+        self.idle = Some(source);
+        Ok(())
+    }
+
+    /// Move on to the next block. Returns false at the end of the source.
+    fn next_block(&mut self) -> io::Result<bool> {
+        if self.at_end {
+            return Ok(false);
+        }
+        let Some(worker) = &self.worker else {
+            return Ok(false);
+        };
+
+        match worker.blocks.recv() {
+            Ok(Ok(block)) if !block.is_empty() => {
+                self.current = block;
+                self.current_pos = 0;
+                Ok(true)
+            }
+            Ok(Ok(_)) => {
+                self.at_end = true;
+                Ok(false)
+            }
+            Ok(Err(e)) => {
+                self.at_end = true;
+                Err(e)
+            }
+            Err(_) => {
+                self.at_end = true;
+                Err(io::Error::other("read-ahead thread stopped"))
+            }
+        }
+    }
+
+    fn restart_at(&mut self, target: u64) -> io::Result<u64> {
+        self.stop()?;
+        let source = self
+            .idle
+            .as_mut()
+            .ok_or_else(|| io::Error::other("read-ahead source lost"))?;
+        source.seek(SeekFrom::Start(target))?;
+        self.position = target;
+        self.current.clear();
+        self.current_pos = 0;
+        self.at_end = false;
+        self.start();
+        Ok(target)
+    }
+}
+
+/// Read up to `block_size` bytes; fewer only at the end of the source
+fn read_block<S: Read>(source: &mut S, block_size: usize) -> io::Result<Vec<u8>> {
+    let mut block = vec![0u8; block_size];
+    let mut filled = 0;
+    while filled < block_size {
+        match source.read(&mut block[filled..]) {
+            Ok(0) => break,
+            Ok(n) => filled += n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    block.truncate(filled);
+    Ok(block)
+}
+
+impl<S: Read + Seek + Send + 'static> Read for ReadAhead<S> {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        if buf.is_empty() {
+            return Ok(0);
+        }
+
+        if self.worker.is_none() {
+            if let Some(source) = self.idle.as_mut() {
+                let n = source.read(buf)?;
+                self.position += n as u64;
+                return Ok(n);
+            }
+        }
+
+        while self.current_pos == self.current.len() {
+            if !self.next_block()? {
+                return Ok(0);
+            }
+        }
+
+        let n = buf.len().min(self.current.len() - self.current_pos);
+        buf[..n].copy_from_slice(&self.current[self.current_pos..self.current_pos + n]);
+        self.current_pos += n;
+        self.position += n as u64;
+        Ok(n)
+    }
+}
+
+impl<S: Read + Seek + Send + 'static> Seek for ReadAhead<S> {
+    fn seek(&mut self, pos: SeekFrom) -> io::Result<u64> {
+        let target = match pos {
+            SeekFrom::Start(offset) => Some(offset),
+            SeekFrom::Current(delta) => self.position.checked_add_signed(delta),
+            SeekFrom::End(delta) => self.len.checked_add_signed(delta),
+        }
+        .ok_or_else(|| {
+            io::Error::new(io::ErrorKind::InvalidInput, "seek to a negative position")
+        })?;
+
+        if self.worker.is_none() {
+            if let Some(source) = self.idle.as_mut() {
+                self.position = source.seek(SeekFrom::Start(target))?;
+                return Ok(self.position);
+            }
+        }
+
+        // Within the current block
+        let block_start = self.position - self.current_pos as u64;
+        if target >= block_start && target <= block_start + self.current.len() as u64 {
+            self.current_pos = (target - block_start) as usize;
+            self.position = target;
+            return Ok(target);
+        }
+
+        // A little way ahead: skip through what has been read already
+        let window = (self.block_size * self.num_blocks) as u64;
+        if target > self.position && target - self.position <= window {
+            while self.position < target {
+                if self.current_pos == self.current.len() {
+                    if !self.next_block()? {
+                        break;
+                    }
+                    continue;
+                }
+                let skip =
+                    (target - self.position).min((self.current.len() - self.current_pos) as u64);
+                self.current_pos += skip as usize;
+                self.position += skip;
+            }
+            if self.position == target {
+                return Ok(target);
+            }
+        }
+
+        self.restart_at(target)
+    }
+}
+
+impl<S: Read + Seek + Send + 'static> Drop for ReadAhead<S> {
+    fn drop(&mut self) {
+        let _ = self.stop();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Cursor;
+
+    fn test_data() -> Vec<u8> {
+        (0..100_000u32)
+            .map(|i| (i.wrapping_mul(31) % 251) as u8)
+            .collect()
+    }
+
+    #[test]
+    fn test_read_ahead_reads_everything_in_order() {
+        let data = test_data();
+        let mut reader = ReadAhead::new(Cursor::new(data.clone()), 0, data.len() as u64, 4096, 4);
+
+        let mut out = Vec::new();
+        let mut buf = [0u8; 1000];
+        loop {
+            let n = reader.read(&mut buf).unwrap();
+            if n == 0 {
+                break;
+            }
+            out.extend_from_slice(&buf[..n]);
+        }
+        assert!(out == data);
+        assert_eq!(reader.read(&mut buf).unwrap(), 0);
+    }
+
+    #[test]
+    fn test_read_ahead_seeks() {
+        let data = test_data();
+        let mut reader = ReadAhead::new(Cursor::new(data.clone()), 0, data.len() as u64, 4096, 4);
+        let mut buf = [0u8; 16];
+
+        reader.read_exact(&mut buf).unwrap();
+        // Back within the current block, as ungetc does
+        assert_eq!(reader.seek(SeekFrom::Current(-1)).unwrap(), 15);
+        assert_eq!(reader.stream_position().unwrap(), 15);
+        reader.read_exact(&mut buf).unwrap();
+        assert_eq!(&buf, &data[15..31]);
+
+        // Ahead, within what is queued
+        reader.seek(SeekFrom::Start(10_000)).unwrap();
+        reader.read_exact(&mut buf).unwrap();
+        assert_eq!(&buf, &data[10_000..10_016]);
+
+        // Far ahead and back again
+        reader.seek(SeekFrom::End(-16)).unwrap();
+        reader.read_exact(&mut buf).unwrap();
+        assert_eq!(&buf, &data[data.len() - 16..]);
+        reader.seek(SeekFrom::Start(5)).unwrap();
+        reader.read_exact(&mut buf).unwrap();
+        assert_eq!(&buf, &data[5..21]);
+
+        let mut source = reader.into_inner().unwrap();
+        assert_eq!(source.stream_position().unwrap(), 21);
+        source.read_exact(&mut buf).unwrap();
+        assert_eq!(&buf, &data[21..37]);
+    }
+}
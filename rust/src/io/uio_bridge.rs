@@ -107,6 +107,16 @@ fn get_mount_registry() -> &'static Mutex<Vec<MountInfo>> {
     MOUNT_REGISTRY.get_or_init(|| Mutex::new(Vec::new()))
 }
 
+type PreindexedArchives = HashMap<PathBuf, std::sync::Arc<crate::io::zip_reader::ZipIndex>>;
+
+/// ZIP indices built by uio_preindexArchives, waiting for their archive
+/// to be mounted
+static PREINDEXED_ARCHIVES: OnceLock<Mutex<PreindexedArchives>> = OnceLock::new();
+
+fn get_preindexed_archives() -> &'static Mutex<PreindexedArchives> {
+    PREINDEXED_ARCHIVES.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
 // Types matching C structures from io.h and uiostream.h
 
 #[repr(C)]
@@ -417,9 +427,12 @@ pub unsafe extern "C" fn uio_stat(
                     let suffix_str = suffix.to_string_lossy();
 
                     // Check if it's a directory
+                    // Entry times are not kept; everything in an archive
+                    // counts as equally old
                     if zip_index.is_directory(&suffix_str) {
                         (*stat_buf).st_size = 0;
                         (*stat_buf).st_mode = 0o040555; // Directory, read+exec for all
+                        (*stat_buf).st_mtime = 0;
                         return 0;
                     }
 
@@ -427,6 +440,7 @@ pub unsafe extern "C" fn uio_stat(
                     if let Some(entry) = zip_index.get_entry(&suffix_str) {
                         (*stat_buf).st_size = entry.uncompressed_size as i64;
                         (*stat_buf).st_mode = 0o100444; // Regular file, read-only
+                        (*stat_buf).st_mtime = 0;
                         return 0;
                     }
                 }
@@ -449,6 +463,11 @@ pub unsafe extern "C" fn uio_stat(
                     } else {
                         0o666
                     };
+                    (*stat_buf).st_mtime = meta
+                        .modified()
+                        .ok()
+                        .and_then(|t| t.duration_since(std::time::UNIX_EPOCH).ok())
+                        .map_or(0, |d| d.as_secs() as _);
                     return 0;
                 }
                 Err(_) => continue,
@@ -592,8 +611,14 @@ pub unsafe extern "C" fn uio_lseek(handle: *mut uio_Handle, offset: off_t, whenc
         _ => return -1,
     };
 
+    let from = stats_position(&mut guard);
     match guard.seek(seek_from) {
-        Ok(_) => 0,
+        Ok(to) => {
+            if let Some(from) = from {
+                crate::io::uio_stats::record_seek(handle as usize, from, to);
+            }
+            0
+        }
         Err(_) => -1,
     }
 }
@@ -620,6 +645,12 @@ pub struct uio_DirList {
 pub enum uio_HandleInner {
     File(std::fs::File),
     ZipEntry(crate::io::zip_reader::ZipEntryReader),
+    /// A File or ZipEntry being read ahead of the reader on an I/O thread
+    ReadAhead {
+        reader: Box<crate::io::read_ahead::ReadAhead<uio_HandleInner>>,
+        /// What metadata() gave before read-ahead started
+        metadata: Option<std::fs::Metadata>,
+    },
 }
 
 impl Read for uio_HandleInner {
@@ -627,6 +658,7 @@ impl Read for uio_HandleInner {
         match self {
             uio_HandleInner::File(f) => f.read(buf),
             uio_HandleInner::ZipEntry(z) => z.read(buf),
+            uio_HandleInner::ReadAhead { reader, .. } => reader.read(buf),
         }
     }
 }
@@ -639,13 +671,17 @@ impl Write for uio_HandleInner {
                 std::io::ErrorKind::PermissionDenied,
                 "Cannot write to ZIP entry",
             )),
+            uio_HandleInner::ReadAhead { .. } => Err(std::io::Error::new(
+                std::io::ErrorKind::PermissionDenied,
+                "Cannot write to a stream that is read ahead",
+            )),
         }
     }
 
     fn flush(&mut self) -> std::io::Result<()> {
         match self {
             uio_HandleInner::File(f) => f.flush(),
-            uio_HandleInner::ZipEntry(_) => Ok(()),
+            uio_HandleInner::ZipEntry(_) | uio_HandleInner::ReadAhead { .. } => Ok(()),
         }
     }
 }
@@ -655,6 +691,7 @@ impl Seek for uio_HandleInner {
         match self {
             uio_HandleInner::File(f) => f.seek(pos),
             uio_HandleInner::ZipEntry(z) => z.seek(pos),
+            uio_HandleInner::ReadAhead { reader, .. } => reader.seek(pos),
         }
     }
 }
@@ -665,6 +702,7 @@ impl uio_HandleInner {
         match self {
             uio_HandleInner::File(f) => f.metadata().map(|m| m.len()),
             uio_HandleInner::ZipEntry(z) => Ok(z.size()),
+            uio_HandleInner::ReadAhead { reader, .. } => Ok(reader.len()),
         }
     }
 
@@ -681,8 +719,50 @@ impl uio_HandleInner {
                 std::io::ErrorKind::Unsupported,
                 "metadata not supported for ZIP entries",
             )),
+            uio_HandleInner::ReadAhead { metadata, .. } => metadata.clone().ok_or_else(|| {
+                std::io::Error::new(
+                    std::io::ErrorKind::Unsupported,
+                    "metadata not supported for ZIP entries",
+                )
+            }),
         }
     }
+
+    /// Start reading ahead, keeping `num_blocks` blocks of `block_size`
+    /// bytes in flight, or stop doing so if `num_blocks` is 0
+    fn set_read_ahead(&mut self, block_size: usize, num_blocks: usize) -> std::io::Result<()> {
+        let reading_ahead = matches!(self, uio_HandleInner::ReadAhead { .. });
+        if reading_ahead == (num_blocks > 0) {
+            return Ok(());
+        }
+
+        // Stand-in while the real source is moved around
+        let empty = uio_HandleInner::ZipEntry(crate::io::zip_reader::ZipEntryReader::empty());
+        match std::mem::replace(self, empty) {
+            uio_HandleInner::ReadAhead { reader, .. } => {
+                *self = reader.into_inner()?;
+            }
+            mut source => {
+                let position = match source.stream_position() {
+                    Ok(position) => position,
+                    Err(e) => {
+                        *self = source;
+                        return Err(e);
+                    }
+                };
+                let len = source.len().unwrap_or(0);
+                let metadata = source.metadata().ok();
+                let reader = crate::io::read_ahead::ReadAhead::new(
+                    source, position, len, block_size, num_blocks,
+                );
+                *self = uio_HandleInner::ReadAhead {
+                    reader: Box::new(reader),
+                    metadata,
+                };
+            }
+        }
+        Ok(())
+    }
 }
 
 #[allow(
@@ -775,10 +855,19 @@ fn register_mount(
         return ptr::null_mut();
     }
 
-    // For ZIP mounts, index the archive at mount time
+    // For ZIP mounts, index the archive at mount time, unless that has
+    // been done ahead of time
     let zip_index = if fs_type == UIO_FSTYPE_ZIP {
-        match crate::io::zip_reader::ZipIndex::new(&mounted_root) {
-            Ok(index) => Some(std::sync::Arc::new(index)),
+        let preindexed = get_preindexed_archives()
+            .lock()
+            .ok()
+            .and_then(|mut map| map.remove(&mounted_root));
+        let index = match preindexed {
+            Some(index) => Ok(index),
+            None => crate::io::zip_reader::ZipIndex::new(&mounted_root).map(std::sync::Arc::new),
+        };
+        match index {
+            Ok(index) => Some(index),
             Err(_e) => {
                 set_errno(libc::EIO);
                 return ptr::null_mut();
@@ -933,6 +1022,43 @@ fn resolve_mount_for_path<'a>(
         })
 }
 
+/// How a mount is named in the I/O statistics; None when they are not
+/// being collected
+fn stats_mount_name(mount: Option<&MountInfo>) -> Option<String> {
+    if !crate::io::uio_stats::enabled() {
+        return None;
+    }
+    Some(match mount {
+        Some(mount) => format!("{} <- {}", mount.mount_point, mount.mounted_root.display()),
+        None => "(not mounted)".to_string(),
+    })
+}
+
+/// Have what is read through a newly opened handle counted in the I/O
+/// statistics
+unsafe fn track_handle(handle: *mut uio_Handle, virtual_path: &Path, mount_name: Option<&str>) {
+    let Some(mount_name) = mount_name else {
+        return;
+    };
+    let stats = crate::io::uio_stats::open(&virtual_path.to_string_lossy(), mount_name);
+    if let Ok(mut inner) = (*handle).lock() {
+        if let uio_HandleInner::ZipEntry(reader) = &mut *inner {
+            reader.set_stats(std::sync::Arc::clone(&stats));
+        }
+    }
+    crate::io::uio_stats::attach(handle as usize, stats);
+}
+
+/// Where a handle is, when the I/O statistics need it to tell backward
+/// seeks
+fn stats_position(inner: &mut uio_HandleInner) -> Option<u64> {
+    if crate::io::uio_stats::enabled() {
+        inner.stream_position().ok()
+    } else {
+        None
+    }
+}
+
 fn remove_mount_entry(handle: *mut uio_MountHandle) -> Option<MountInfo> {
     if handle.is_null() {
         return None;
@@ -1283,6 +1409,7 @@ unsafe fn uio_fgets_inner(buf: *mut c_char, size: c_int, stream: *mut uio_Stream
         }
     }
 
+    crate::io::uio_stats::record_read(s.handle as usize, count);
     if count == 0 {
         return ptr::null_mut();
     }
@@ -1301,7 +1428,6 @@ unsafe fn uio_fgets_inner(buf: *mut c_char, size: c_int, stream: *mut uio_Stream
 /// Caller must ensure pointer arguments are valid and properly aligned.
 #[no_mangle]
 pub unsafe extern "C" fn uio_fgetc(stream: *mut uio_Stream) -> c_int {
-    rust_bridge_log_msg("RUST_UIO: uio_fgetc entry");
     if stream.is_null() {
         return -1;
     }
@@ -1316,6 +1442,7 @@ pub unsafe extern "C" fn uio_fgetc(stream: *mut uio_Stream) -> c_int {
     let mut byte = [0u8; 1];
     match guard.read(&mut byte) {
         Ok(1) => {
+            crate::io::uio_stats::record_read(s.handle as usize, 1);
             set_stream_status(stream, UIO_STREAM_STATUS_OK);
             byte[0] as c_int
         }
@@ -1338,7 +1465,6 @@ pub unsafe extern "C" fn uio_fgetc(stream: *mut uio_Stream) -> c_int {
 /// Caller must ensure pointer arguments are valid and properly aligned.
 #[no_mangle]
 pub unsafe extern "C" fn uio_ungetc(c: c_int, stream: *mut uio_Stream) -> c_int {
-    rust_bridge_log_msg("RUST_UIO: uio_ungetc entry");
     if stream.is_null() {
         return -1;
     }
@@ -1350,8 +1476,9 @@ pub unsafe extern "C" fn uio_ungetc(c: c_int, stream: *mut uio_Stream) -> c_int
         Ok(g) => g,
         Err(_) => return -1,
     };
-    if guard.seek(SeekFrom::Current(-1)).is_err() {
-        return -1;
+    match guard.seek(SeekFrom::Current(-1)) {
+        Ok(to) => crate::io::uio_stats::record_seek(s.handle as usize, to + 1, to),
+        Err(_) => return -1,
     }
     c
 }
@@ -1609,6 +1736,101 @@ struct FileBlockInner {
     cache: Vec<u8>,
     /// File offset where cache starts
     cache_offset: off_t,
+    /// The block's bytes, when they can be handed out without copying
+    direct: Option<DirectView>,
+}
+
+/// Read-only view of a whole file block, either mapped from the file or
+/// pointing into an entry a ZIP handle already holds in memory (which
+/// stays put for as long as the handle, which outlives the block).
+struct DirectView {
+    /// Start of the block
+    data: *const u8,
+    _mapping: Option<FileMapping>,
+}
+
+/// A region of a file mapped read-only, unmapped on drop
+struct FileMapping {
+    base: *mut libc::c_void,
+    len: usize,
+}
+
+impl Drop for FileMapping {
+    fn drop(&mut self) {
+        #[cfg(unix)]
+        unsafe {
+            libc::munmap(self.base, self.len);
+        }
+    }
+}
+
+/// Map `len` bytes of `file` from `offset` on.
+/// Returns `None` where mapping is not available, so that the caller
+/// falls back to reading into the block's cache.
+#[cfg(unix)]
+fn map_file_region(file: &std::fs::File, offset: u64, len: u64) -> Option<DirectView> {
+    use std::os::unix::io::AsRawFd;
+
+    if len == 0 {
+        return None;
+    }
+    let page = unsafe { libc::sysconf(libc::_SC_PAGESIZE) };
+    if page <= 0 {
+        return None;
+    }
+    let page = page as u64;
+    let aligned = offset & !(page - 1);
+    let lead = (offset - aligned) as usize;
+    let map_len = usize::try_from(len).ok()?.checked_add(lead)?;
+
+    let base = unsafe {
+        libc::mmap(
+            ptr::null_mut(),
+            map_len,
+            libc::PROT_READ,
+            libc::MAP_PRIVATE,
+            file.as_raw_fd(),
+            aligned as off_t,
+        )
+    };
+    if base == libc::MAP_FAILED {
+        return None;
+    }
+
+    Some(DirectView {
+        data: unsafe { (base as *const u8).add(lead) },
+        _mapping: Some(FileMapping { base, len: map_len }),
+    })
+}
+
+#[cfg(not(unix))]
+fn map_file_region(_file: &std::fs::File, _offset: u64, _len: u64) -> Option<DirectView> {
+    None
+}
+
+/// Get a view of `len` bytes of the handle's data from `offset` on, for
+/// plain files and ZIP entries that are not compressed.
+fn direct_view(handle: &uio_HandleInner, offset: u64, len: u64) -> Option<DirectView> {
+    match handle {
+        uio_HandleInner::File(file) => map_file_region(file, offset, len),
+        uio_HandleInner::ReadAhead { .. } => None,
+        uio_HandleInner::ZipEntry(entry) => {
+            if let Some(data) = entry.memory_data() {
+                if len == 0 {
+                    return None;
+                }
+                let start = usize::try_from(offset).ok()?;
+                let data = data.get(start..)?;
+                return Some(DirectView {
+                    data: data.as_ptr(),
+                    _mapping: None,
+                });
+            }
+            let (archive_path, data_start) = entry.stored_region()?;
+            let archive = std::fs::File::open(archive_path).ok()?;
+            map_file_region(&archive, data_start.checked_add(offset)?, len)
+        }
+    }
 }
 
 /// @plan PLAN-20260314-FILE-IO.P08
@@ -1641,14 +1863,15 @@ pub unsafe extern "C" fn uio_openFileBlock(handle: *mut uio_Handle) -> *mut uio_
             Err(_) => return fail_errno(libc::EIO, ptr::null_mut()),
         };
 
-        let size = match file_guard.metadata() {
-            Ok(meta) => meta.len() as off_t,
+        let size = match file_guard.len() {
+            Ok(len) => len as off_t,
             Err(e) => {
                 let err_code = e.raw_os_error().unwrap_or(libc::EIO);
                 return fail_errno(err_code, ptr::null_mut());
             }
         };
 
+        let direct = direct_view(&file_guard, 0, size as u64);
         drop(file_guard);
 
         let inner = FileBlockInner {
@@ -1657,6 +1880,7 @@ pub unsafe extern "C" fn uio_openFileBlock(handle: *mut uio_Handle) -> *mut uio_
             size,
             cache: Vec::new(),
             cache_offset: 0,
+            direct,
         };
 
         let block = Box::new(inner);
@@ -1700,26 +1924,28 @@ pub unsafe extern "C" fn uio_openFileBlock2(
             Err(_) => return fail_errno(libc::EIO, ptr::null_mut()),
         };
 
-        let file_size = match file_guard.metadata() {
-            Ok(meta) => meta.len(),
+        let file_size = match file_guard.len() {
+            Ok(len) => len,
             Err(e) => {
                 let err_code = e.raw_os_error().unwrap_or(libc::EIO);
                 return fail_errno(err_code, ptr::null_mut());
             }
         };
 
-        drop(file_guard);
-
         if end_offset > file_size {
             return fail_errno(libc::EINVAL, ptr::null_mut());
         }
 
+        let direct = direct_view(&file_guard, offset as u64, size as u64);
+        drop(file_guard);
+
         let inner = FileBlockInner {
             handle,
             base_offset: offset,
             size: size as off_t,
             cache: Vec::new(),
             cache_offset: 0,
+            direct,
         };
 
         let block = Box::new(inner);
@@ -1754,6 +1980,17 @@ pub unsafe extern "C" fn uio_accessFileBlock(
 
         let inner = &mut *(block as *mut FileBlockInner);
 
+        if let Some(view) = &inner.direct {
+            let available = inner.size - offset;
+            if available <= 0 {
+                *buffer = ptr::null_mut();
+                return 0;
+            }
+            let count = std::cmp::min(length as off_t, available) as usize;
+            *buffer = view.data.add(offset as usize) as *mut c_char;
+            return count as isize;
+        }
+
         // Calculate absolute file offset
         let file_offset = inner.base_offset + offset;
 
@@ -1764,8 +2001,8 @@ pub unsafe extern "C" fn uio_accessFileBlock(
                 Ok(g) => g,
                 Err(_) => return fail_errno(libc::EIO, -1) as isize,
             };
-            let file_size = match file_guard.metadata() {
-                Ok(meta) => meta.len() as off_t,
+            let file_size = match file_guard.len() {
+                Ok(len) => len as off_t,
                 Err(e) => {
                     let err_code = e.raw_os_error().unwrap_or(libc::EIO);
                     return fail_errno(err_code, -1) as isize;
@@ -1811,6 +2048,7 @@ pub unsafe extern "C" fn uio_accessFileBlock(
         };
 
         drop(file_guard);
+        crate::io::uio_stats::record_read(inner.handle as usize, bytes_read);
 
         // Truncate cache to actual bytes read
         inner.cache.truncate(bytes_read);
@@ -1853,6 +2091,15 @@ pub unsafe extern "C" fn uio_copyFileBlock(
 
         let inner = &mut *(block as *mut FileBlockInner);
 
+        if let Some(view) = &inner.direct {
+            let available = inner.size - offset;
+            if available > 0 {
+                let count = std::cmp::min(length as off_t, available) as usize;
+                ptr::copy_nonoverlapping(view.data.add(offset as usize), buffer as *mut u8, count);
+            }
+            return 0;
+        }
+
         // Calculate absolute file offset
         let file_offset = inner.base_offset + offset;
 
@@ -1863,8 +2110,8 @@ pub unsafe extern "C" fn uio_copyFileBlock(
                 Ok(g) => g,
                 Err(_) => return fail_errno(libc::EIO, -1),
             };
-            let file_size = match file_guard.metadata() {
-                Ok(meta) => meta.len() as off_t,
+            let file_size = match file_guard.len() {
+                Ok(len) => len as off_t,
                 Err(e) => {
                     let err_code = e.raw_os_error().unwrap_or(libc::EIO);
                     return fail_errno(err_code, -1);
@@ -1905,6 +2152,7 @@ pub unsafe extern "C" fn uio_copyFileBlock(
         };
 
         drop(file_guard);
+        crate::io::uio_stats::record_read(inner.handle as usize, bytes_read);
 
         // Copy to caller buffer
         if bytes_read > 0 {
@@ -2649,16 +2897,78 @@ pub unsafe extern "C" fn uio_copyFile(
     })
 }
 
+/// List the mounts of `repository` (all of them if NULL), topmost first,
+/// followed by the I/O statistics if any have been collected.
 ///
 /// # Safety
 ///
-/// No safety requirements; marked unsafe for C ABI compatibility.
+/// `out_stream` must be a valid FILE pointer or NULL.
 #[no_mangle]
 pub unsafe extern "C" fn uio_printMounts(
-    _out_stream: *mut libc::FILE,
-    _repository: *const uio_Repository,
+    out_stream: *mut libc::FILE,
+    repository: *const uio_Repository,
 ) {
-    log_marker("uio_printMounts called - stub");
+    ffi_guard!((), {
+        log_marker("uio_printMounts called");
+        if out_stream.is_null() {
+            return;
+        }
+
+        let mut text = String::new();
+        {
+            let registry = get_mount_registry().lock().unwrap();
+            let mut mounts: Vec<&MountInfo> = registry
+                .iter()
+                .filter(|m| m.active_in_registry)
+                .filter(|m| repository.is_null() || m.repository == repository as usize)
+                .collect();
+            mounts.sort_by_key(|m| m.position);
+            for mount in mounts {
+                let kind = match &mount.zip_index {
+                    Some(index) if index.loaded_from_cache() => "zip, index from cache",
+                    Some(_) => "zip",
+                    None => "stdio",
+                };
+                text.push_str(&format!(
+                    "{} <- {} ({}{})\n",
+                    mount.mount_point,
+                    mount.mounted_root.display(),
+                    kind,
+                    if mount.read_only { ", read-only" } else { "" }
+                ));
+            }
+        }
+
+        if crate::io::uio_stats::enabled() || crate::io::uio_stats::has_stats() {
+            text.push_str(&crate::io::uio_stats::report());
+        }
+
+        if let Ok(text) = std::ffi::CString::new(text) {
+            libc::fputs(text.as_ptr(), out_stream);
+        }
+    })
+}
+
+/// Start (`enable` non-zero) or stop collecting I/O statistics for
+/// uio_printMounts() to show. Starting clears what was counted before.
+///
+/// # Safety
+///
+/// No safety requirements; marked unsafe for C ABI compatibility.
+#[no_mangle]
+pub unsafe extern "C" fn uio_setStatsEnabled(enable: c_int) {
+    crate::io::uio_stats::set_enabled(enable != 0);
+}
+
+/// Set how many bytes of small ZIP entries are kept inflated in memory
+/// for the next time they are opened. 0 turns the cache off.
+///
+/// # Safety
+///
+/// No safety requirements; marked unsafe for C ABI compatibility.
+#[no_mangle]
+pub unsafe extern "C" fn uio_setEntryCacheSize(size: size_t) {
+    crate::io::zip_reader::set_entry_cache_budget(size);
 }
 
 ///
@@ -2923,6 +3233,8 @@ pub unsafe extern "C" fn uio_init() {
         buffer_registry.clear();
         drop(buffer_registry);
 
+        crate::io::uio_stats::init_from_env();
+
         log_marker("uio_init: subsystem initialized");
     })
 }
@@ -3209,6 +3521,94 @@ pub unsafe extern "C" fn uio_mountDir(
     )
 }
 
+/// Index the ZIP archives `names` in `source_dir` on worker threads, so
+/// that mounting them with uio_mountDir afterwards, still one at a time and
+/// in the same order, does not have to. Archives that cannot be indexed are
+/// left for uio_mountDir to fail on as before.
+/// Returns the number of archives indexed.
+///
+/// # Safety
+///
+/// `source_dir` must be a valid directory handle and `names` must point to
+/// `count` valid C strings.
+#[no_mangle]
+pub unsafe extern "C" fn uio_preindexArchives(
+    source_dir: *mut uio_DirHandle,
+    names: *const *const c_char,
+    count: c_int,
+) -> c_int {
+    ffi_guard!(0, {
+        if source_dir.is_null() || names.is_null() || count <= 0 {
+            return 0;
+        }
+
+        let base_path = &(*source_dir).path;
+        let paths: Vec<PathBuf> = slice::from_raw_parts(names, count as usize)
+            .iter()
+            .filter_map(|&name| cstr_to_pathbuf(name))
+            .map(|name| resolve_path(base_path, &name))
+            .collect();
+
+        let indexed = index_archives_in_parallel(&paths);
+
+        let num_indexed = indexed.len();
+        if let Ok(mut map) = get_preindexed_archives().lock() {
+            for (path, index) in indexed {
+                map.insert(path, std::sync::Arc::new(index));
+            }
+        }
+        rust_bridge_log_msg(&format!(
+            "RUST_UIO: uio_preindexArchives: indexed {} of {} archives",
+            num_indexed,
+            paths.len()
+        ));
+        num_indexed as c_int
+    })
+}
+
+/// Index each of `paths`, spreading them over as many threads as there are
+/// cores. Archives that fail to index are left out.
+fn index_archives_in_parallel(
+    paths: &[PathBuf],
+) -> Vec<(PathBuf, crate::io::zip_reader::ZipIndex)> {
+    let num_workers = std::thread::available_parallelism()
+        .map(|n| n.get())
+        .unwrap_or(1)
+        .min(paths.len());
+    let next = AtomicUsize::new(0);
+
+    let index_some = || {
+        let mut done = Vec::new();
+        while let Some(path) = paths.get(next.fetch_add(1, Ordering::Relaxed)) {
+            if let Ok(index) = crate::io::zip_reader::ZipIndex::new(path) {
+                done.push((path.clone(), index));
+            }
+        }
+        done
+    };
+
+    std::thread::scope(|scope| {
+        let workers: Vec<_> = (0..num_workers).map(|_| scope.spawn(index_some)).collect();
+        workers
+            .into_iter()
+            .flat_map(|worker| worker.join().unwrap_or_default())
+            .collect()
+    })
+}
+
+/// Drop the indices from uio_preindexArchives whose archive was not
+/// mounted after all
+///
+/// # Safety
+///
+/// No safety requirements; marked unsafe for C ABI compatibility.
+#[no_mangle]
+pub unsafe extern "C" fn uio_forgetPreindexedArchives() {
+    if let Ok(mut map) = get_preindexed_archives().lock() {
+        map.clear();
+    }
+}
+
 ///
 /// # Safety
 ///
@@ -3397,9 +3797,12 @@ pub unsafe extern "C" fn uio_open(
                     let suffix_str = suffix.to_string_lossy();
                     match zip_index.open_entry(&suffix_str) {
                         Ok(reader) => {
+                            let mount_name = stats_mount_name(Some(mount));
                             drop(registry);
                             let handle = uio_HandleInner::ZipEntry(reader);
-                            return Box::leak(Box::new(Mutex::new(handle))) as *mut uio_Handle;
+                            let handle = Box::leak(Box::new(Mutex::new(handle))) as *mut uio_Handle;
+                            track_handle(handle, &virtual_path, mount_name.as_deref());
+                            return handle;
                         }
                         Err(err) => {
                             drop(registry);
@@ -3416,11 +3819,14 @@ pub unsafe extern "C" fn uio_open(
             }
         }
 
+        let mount_name;
         let file_path = if let Some(resolution) = resolve_mount_for_path(&registry, &virtual_path) {
             let path = resolution.host_path.clone();
+            mount_name = stats_mount_name(Some(resolution.mount));
             drop(registry);
             path
         } else {
+            mount_name = stats_mount_name(None);
             drop(registry);
             // No mount - fall back to direct path resolution
             resolve_path(dir_host_path, &input_path)
@@ -3444,7 +3850,9 @@ pub unsafe extern "C" fn uio_open(
 
         // Return Mutex<HandleInner> as uio_Handle
         let handle = uio_HandleInner::File(file);
-        Box::leak(Box::new(Mutex::new(handle))) as *mut uio_Handle
+        let handle = Box::leak(Box::new(Mutex::new(handle))) as *mut uio_Handle;
+        track_handle(handle, &virtual_path, mount_name.as_deref());
+        handle
     })
 }
 
@@ -3461,6 +3869,7 @@ pub unsafe extern "C" fn uio_open(
 pub unsafe extern "C" fn uio_close(handle: *mut uio_Handle) -> c_int {
     log_marker("uio_close called");
     if !handle.is_null() {
+        crate::io::uio_stats::detach(handle as usize);
         let _ = Box::from_raw(handle);
     }
     0 // Success
@@ -3483,7 +3892,10 @@ pub unsafe extern "C" fn uio_read(handle: *mut uio_Handle, buf: *mut u8, count:
 
     let buffer = slice::from_raw_parts_mut(buf, count);
     match guard.read(buffer) {
-        Ok(n) => n as isize,
+        Ok(n) => {
+            crate::io::uio_stats::record_read(handle as usize, n);
+            n as isize
+        }
         Err(_) => -1,
     }
 }
@@ -3764,6 +4176,7 @@ pub unsafe extern "C" fn uio_fopen(
             }
         };
 
+        let mount_name = stats_mount_name(mount_info);
         drop(registry);
 
         let open_flags =
@@ -3774,13 +4187,17 @@ pub unsafe extern "C" fn uio_fopen(
             } else {
                 0
             };
+        let handle = Box::leak(Box::new(Mutex::new(handle_inner))) as *mut uio_Handle;
+        if open_flags == O_RDONLY {
+            track_handle(handle, &virtual_path, mount_name.as_deref());
+        }
 
         let stream = Box::new(uio_Stream {
             buf: ptr::null_mut(),
             data_start: ptr::null_mut(),
             data_end: ptr::null_mut(),
             buf_end: ptr::null_mut(),
-            handle: Box::leak(Box::new(Mutex::new(handle_inner))) as *mut uio_Handle,
+            handle,
             status: UIO_STREAM_STATUS_OK,
             operation: UIO_STREAM_OPERATION_NONE,
             open_flags,
@@ -3823,6 +4240,7 @@ pub unsafe extern "C" fn uio_fclose(stream: *mut uio_Stream) -> c_int {
             // (or was never registered), so we don't deallocate it to avoid double-free
         }
         if !s.handle.is_null() {
+            crate::io::uio_stats::detach(s.handle as usize);
             // Reconstruct Box<uio_Handle> from raw pointer
             let _ = Box::from_raw(s.handle);
         }
@@ -3902,7 +4320,24 @@ pub unsafe extern "C" fn uio_fread(
 
     let total_bytes = size * nmemb;
     let buffer = slice::from_raw_parts_mut(buf as *mut u8, total_bytes);
-    match guard.read(buffer) {
+    // Like fread, keep reading until there is no more, as a read may
+    // stop short (at the end of a read-ahead block, for one)
+    let mut filled = 0;
+    let result = loop {
+        match guard.read(&mut buffer[filled..]) {
+            Ok(0) => break Ok(filled),
+            Ok(n) => {
+                filled += n;
+                if filled == total_bytes {
+                    break Ok(filled);
+                }
+            }
+            Err(e) if e.kind() == std::io::ErrorKind::Interrupted => {}
+            Err(e) => break Err((e, filled)),
+        }
+    };
+    crate::io::uio_stats::record_read(handle_addr, filled);
+    match result {
         Ok(n) => {
             set_stream_operation(stream, UIO_STREAM_OPERATION_READ);
             if n == 0 {
@@ -3916,16 +4351,12 @@ pub unsafe extern "C" fn uio_fread(
                 // Full read successful
                 set_stream_status(stream, UIO_STREAM_STATUS_OK);
             }
-            rust_bridge_log_msg(&format!(
-                "RUST_UIO: uio_fread requested={} read={}",
-                total_bytes, n
-            ));
             n / size
         }
-        Err(err) => {
+        Err((err, n)) => {
             rust_bridge_log_msg(&format!("RUST_UIO: uio_fread error: {}", err));
             set_stream_status(stream, UIO_STREAM_STATUS_ERROR);
-            0
+            n / size
         }
     }
 }
@@ -3958,8 +4389,12 @@ pub unsafe extern "C" fn uio_fseek(
         _ => return -1,
     };
 
+    let from = stats_position(&mut guard);
     match guard.seek(seek_from) {
-        Ok(_) => {
+        Ok(to) => {
+            if let Some(from) = from {
+                crate::io::uio_stats::record_seek(s.handle as usize, from, to);
+            }
             // Per P02a carry-forward: seek clears EOF flag
             if (*stream).status == UIO_STREAM_STATUS_EOF {
                 (*stream).status = UIO_STREAM_STATUS_OK;
@@ -3993,6 +4428,55 @@ pub unsafe extern "C" fn uio_ftell(stream: *mut uio_Stream) -> c_long {
     }
 }
 
+/// Stream usage hint: the stream is read front to back
+const UIO_STREAM_USAGE_SEQUENTIAL: c_int = 1;
+
+/// Number of blocks uio_setStreamUsageHint splits its read-ahead into
+const READ_AHEAD_BLOCKS: usize = 4;
+
+/// Tell how a stream is going to be used. For a stream opened for reading
+/// only, uio_STREAM_USAGE_SEQUENTIAL with a non-zero `read_ahead_buf_size`
+/// has up to that many bytes after the read position read ahead of time on
+/// an I/O thread; a usage of 0 stops that again.
+///
+/// # Safety
+///
+/// Caller must ensure pointer arguments are valid and properly aligned.
+#[no_mangle]
+pub unsafe extern "C" fn uio_setStreamUsageHint(
+    stream: *mut uio_Stream,
+    usage: c_int,
+    read_ahead_buf_size: size_t,
+) {
+    ffi_guard!((), {
+        if stream.is_null() || (*stream).handle.is_null() {
+            return;
+        }
+        if (*stream).open_flags != O_RDONLY {
+            return;
+        }
+
+        let (block_size, num_blocks) =
+            if (usage & UIO_STREAM_USAGE_SEQUENTIAL) != 0 && read_ahead_buf_size > 0 {
+                (
+                    read_ahead_buf_size.div_ceil(READ_AHEAD_BLOCKS),
+                    READ_AHEAD_BLOCKS,
+                )
+            } else {
+                (0, 0)
+            };
+
+        let mut guard = match (*(*stream).handle).lock() {
+            Ok(g) => g,
+            Err(_) => return,
+        };
+        if let Err(e) = guard.set_read_ahead(block_size, num_blocks) {
+            rust_bridge_log_msg(&format!("RUST_UIO: uio_setStreamUsageHint failed: {}", e));
+            set_stream_status(stream, UIO_STREAM_STATUS_ERROR);
+        }
+    })
+}
+
 // =============================================================================
 // uio_getDirList / uio_DirList_free
 // =============================================================================
@@ -5050,6 +5534,69 @@ mod tests {
         }
     }
 
+    #[test]
+    #[serial]
+    fn test_stream_read_ahead() {
+        {
+            use std::fs;
+            use tempfile::TempDir;
+
+            let temp_dir = TempDir::new().unwrap();
+            let data: Vec<u8> = (0..50_000u32).map(|i| (i % 241) as u8).collect();
+            fs::write(temp_dir.path().join("big.bin"), &data).unwrap();
+
+            let repository = Box::into_raw(Box::new(uio_Repository { flags: 0 }));
+            let dir_handle = Box::into_raw(Box::new(uio_DirHandle {
+                path: temp_dir.path().to_path_buf(),
+                virtual_path: temp_dir.path().to_path_buf(),
+                refcount: std::sync::atomic::AtomicI32::new(1),
+                repository,
+                root_end: temp_dir.path().to_path_buf(),
+            }));
+
+            let path = CString::new("big.bin").unwrap();
+            let mode = CString::new("rb").unwrap();
+
+            let stream = unsafe { uio_fopen(dir_handle, path.as_ptr(), mode.as_ptr()) };
+            assert!(!stream.is_null());
+
+            unsafe {
+                let mut buf = [0u8; 100];
+                assert_eq!(
+                    uio_fread(buf.as_mut_ptr() as *mut libc::c_void, 1, 10, stream),
+                    10
+                );
+
+                uio_setStreamUsageHint(stream, UIO_STREAM_USAGE_SEQUENTIAL, 16 * 1024);
+                assert!(matches!(
+                    *(*(*stream).handle).lock().unwrap(),
+                    uio_HandleInner::ReadAhead { .. }
+                ));
+                assert_eq!(uio_ftell(stream), 10);
+
+                // Straddles a read-ahead block boundary
+                assert_eq!(uio_fseek(stream, 4090, SEEK_SET), 0);
+                assert_eq!(
+                    uio_fread(buf.as_mut_ptr() as *mut libc::c_void, 10, 10, stream),
+                    10
+                );
+                assert_eq!(&buf[..], &data[4090..4190]);
+                assert_eq!(uio_fgetc(stream), data[4190] as c_int);
+
+                let mut st: stat = std::mem::zeroed();
+                assert_eq!(uio_fstat((*stream).handle, &mut st), 0);
+                assert_eq!(st.st_size, data.len() as i64);
+
+                uio_setStreamUsageHint(stream, 0, 0);
+                assert_eq!(uio_ftell(stream), 4191);
+
+                uio_fclose(stream);
+                let _ = Box::from_raw(dir_handle);
+                let _ = Box::from_raw(repository);
+            }
+        }
+    }
+
     #[test]
     #[serial]
     fn test_write_error_sets_error_status() {
@@ -5136,6 +5683,75 @@ mod tests {
         }
     }
 
+    /// Throughput of the per-stream reads; run with
+    /// `cargo test --release -- --ignored --nocapture bench_stream_reads`
+    #[test]
+    #[serial]
+    #[ignore]
+    fn bench_stream_reads() {
+        use std::fs;
+        use std::time::Instant;
+        use tempfile::TempDir;
+
+        const SIZE: usize = 4 << 20;
+        let temp_dir = TempDir::new().unwrap();
+        fs::write(temp_dir.path().join("bench.bin"), vec![0x5au8; SIZE]).unwrap();
+
+        let repository = Box::into_raw(Box::new(uio_Repository { flags: 0 }));
+        let dir_handle = Box::into_raw(Box::new(uio_DirHandle {
+            path: temp_dir.path().to_path_buf(),
+            virtual_path: temp_dir.path().to_path_buf(),
+            refcount: std::sync::atomic::AtomicI32::new(1),
+            repository,
+            root_end: temp_dir.path().to_path_buf(),
+        }));
+        let path = CString::new("bench.bin").unwrap();
+        let mode = CString::new("rb").unwrap();
+
+        unsafe {
+            let stream = uio_fopen(dir_handle, path.as_ptr(), mode.as_ptr());
+            assert!(!stream.is_null());
+            let start = Instant::now();
+            let mut count = 0;
+            while uio_fgetc(stream) != -1 {
+                count += 1;
+            }
+            let elapsed = start.elapsed();
+            assert_eq!(count, SIZE);
+            println!(
+                "uio_fgetc: {:.1} MB/s",
+                SIZE as f64 / elapsed.as_secs_f64() / 1e6
+            );
+            uio_fclose(stream);
+
+            for chunk in [16usize, 4096] {
+                let stream = uio_fopen(dir_handle, path.as_ptr(), mode.as_ptr());
+                assert!(!stream.is_null());
+                let mut buf = vec![0u8; chunk];
+                let start = Instant::now();
+                let mut total = 0;
+                loop {
+                    let n = uio_fread(buf.as_mut_ptr() as *mut libc::c_void, 1, chunk, stream);
+                    if n == 0 {
+                        break;
+                    }
+                    total += n;
+                }
+                let elapsed = start.elapsed();
+                assert_eq!(total, SIZE);
+                println!(
+                    "uio_fread of {} bytes: {:.1} MB/s",
+                    chunk,
+                    SIZE as f64 / elapsed.as_secs_f64() / 1e6
+                );
+                uio_fclose(stream);
+            }
+
+            let _ = Box::from_raw(dir_handle);
+            let _ = Box::from_raw(repository);
+        }
+    }
+
     // =============================================================================
     // Path Normalization Tests (Phase P05)
     // =============================================================================
@@ -6723,6 +7339,55 @@ mod tests {
         }
     }
 
+    #[cfg(unix)]
+    #[test]
+    fn test_fileblock_maps_plain_file() {
+        {
+            use std::io::Write;
+            use tempfile::NamedTempFile;
+
+            let data: Vec<u8> = (0..20000u32).map(|i| (i % 253) as u8).collect();
+            let mut temp = NamedTempFile::new().unwrap();
+            temp.write_all(&data).unwrap();
+            temp.flush().unwrap();
+
+            unsafe {
+                let file = std::fs::File::open(temp.path()).unwrap();
+                let handle = Box::into_raw(Box::new(Mutex::new(uio_HandleInner::File(file))));
+
+                // Deliberately not page aligned
+                let block = uio_openFileBlock2(handle, 5001, 10000);
+                assert!(!block.is_null());
+                assert!((*(block as *const FileBlockInner)).direct.is_some());
+
+                let mut first: *mut c_char = ptr::null_mut();
+                let mut second: *mut c_char = ptr::null_mut();
+                assert_eq!(uio_accessFileBlock(block, 0, 100, &mut first), 100);
+                assert_eq!(uio_accessFileBlock(block, 9990, 100, &mut second), 10);
+                assert_eq!(
+                    slice::from_raw_parts(first as *const u8, 100),
+                    &data[5001..5101]
+                );
+                assert_eq!(
+                    slice::from_raw_parts(second as *const u8, 10),
+                    &data[14991..15001]
+                );
+                // Both point into the same mapping; nothing was copied
+                assert_eq!(second.offset_from(first), 9990);
+
+                let mut copy = [0u8; 16];
+                assert_eq!(
+                    uio_copyFileBlock(block, 4096, copy.as_mut_ptr() as *mut c_char, 16),
+                    0
+                );
+                assert_eq!(&copy, &data[9097..9113]);
+
+                uio_closeFileBlock(block);
+                let _ = Box::from_raw(handle);
+            }
+        }
+    }
+
     /// @plan PLAN-20260314-FILE-IO.P08
     /// @requirement REQ-FIO-FILEBLOCK
     #[test]
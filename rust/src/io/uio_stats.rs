@@ -0,0 +1,313 @@
+//! Counters for what is read through the uio layer.
+//!
+//! Meant for finding resources that are opened over and over, and ones
+//! read in a way that is expensive where they are stored, such as
+//! seeking back in a compressed ZIP entry, which has it inflated again
+//! from the start. Content can then be repacked to avoid that.
+//!
+//! Nothing is counted unless collecting is switched on, by having
+//! UQM_UIO_STATS in the environment when uio is initialised or by
+//! uio_setStatsEnabled(). uio_printMounts() shows what was counted.
+//!
+//! With UQM_UIO_TRACE naming a file, collecting is switched on as well,
+//! and each path is written to that file when it is first opened. That
+//! access trace is what tools/pkg/mkpkg orders a package by.
+
+use std::collections::HashMap;
+use std::fmt::Write;
+use std::fs::File;
+use std::io::Write as _;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock, RwLock};
+
+/// Environment variable that turns collecting on from the start
+pub const STATS_ENV_VAR: &str = "UQM_UIO_STATS";
+/// Environment variable naming the file to write the access trace to
+pub const TRACE_ENV_VAR: &str = "UQM_UIO_TRACE";
+
+/// How many files the report lists
+const HOT_FILES: usize = 20;
+
+/// What was done with one path, over all the handles it was opened with
+#[derive(Default)]
+pub struct FileStats {
+    /// The mount the path was found in
+    mount: String,
+    opens: AtomicU64,
+    bytes_read: AtomicU64,
+    bytes_inflated: AtomicU64,
+    backward_seeks: AtomicU64,
+    /// Backward seeks that made a compressed entry start inflating over
+    rewinds: AtomicU64,
+    /// Opens served from the inflated entry cache
+    cache_hits: AtomicU64,
+}
+
+impl FileStats {
+    pub fn add_inflated(&self, bytes: u64) {
+        self.bytes_inflated.fetch_add(bytes, Ordering::Relaxed);
+    }
+
+    pub fn add_rewind(&self) {
+        self.rewinds.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn add_cache_hit(&self) {
+        self.cache_hits.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn rewinds(&self) -> u64 {
+        self.rewinds.load(Ordering::Relaxed)
+    }
+
+    fn load(&self) -> Counts {
+        Counts {
+            opens: self.opens.load(Ordering::Relaxed),
+            bytes_read: self.bytes_read.load(Ordering::Relaxed),
+            bytes_inflated: self.bytes_inflated.load(Ordering::Relaxed),
+            backward_seeks: self.backward_seeks.load(Ordering::Relaxed),
+            rewinds: self.rewinds.load(Ordering::Relaxed),
+            cache_hits: self.cache_hits.load(Ordering::Relaxed),
+        }
+    }
+}
+
+#[derive(Clone, Copy, Default)]
+struct Counts {
+    opens: u64,
+    bytes_read: u64,
+    bytes_inflated: u64,
+    backward_seeks: u64,
+    rewinds: u64,
+    cache_hits: u64,
+}
+
+impl Counts {
+    fn add(&mut self, other: &Counts) {
+        self.opens += other.opens;
+        self.bytes_read += other.bytes_read;
+        self.bytes_inflated += other.bytes_inflated;
+        self.backward_seeks += other.backward_seeks;
+        self.rewinds += other.rewinds;
+        self.cache_hits += other.cache_hits;
+    }
+}
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// Per path
+static FILES: OnceLock<Mutex<HashMap<String, Arc<FileStats>>>> = OnceLock::new();
+/// The stats of each open handle, by handle address. Only opening and
+/// closing a handle change it; every read looks it up, so reads of
+/// different handles must not wait for each other.
+static HANDLES: OnceLock<RwLock<HashMap<usize, Arc<FileStats>>>> = OnceLock::new();
+
+/// Where the access trace goes, if anywhere
+static TRACE: Mutex<Option<File>> = Mutex::new(None);
+
+fn files() -> &'static Mutex<HashMap<String, Arc<FileStats>>> {
+    FILES.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+fn handles() -> &'static RwLock<HashMap<usize, Arc<FileStats>>> {
+    HANDLES.get_or_init(|| RwLock::new(HashMap::new()))
+}
+
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+/// Switch collecting on or off. Switching it on starts the counts over.
+pub fn set_enabled(enable: bool) {
+    if enable {
+        files().lock().unwrap().clear();
+    }
+    ENABLED.store(enable, Ordering::Relaxed);
+}
+
+/// True if anything has been counted
+pub fn has_stats() -> bool {
+    FILES
+        .get()
+        .is_some_and(|files| !files.lock().unwrap().is_empty())
+}
+
+pub fn init_from_env() {
+    if let Some(path) = std::env::var_os(TRACE_ENV_VAR) {
+        match File::create(&path) {
+            Ok(file) => {
+                *TRACE.lock().unwrap() = Some(file);
+                set_enabled(true);
+            }
+            Err(e) => eprintln!("Could not create access trace {:?}: {}", path, e),
+        }
+    }
+    if std::env::var_os(STATS_ENV_VAR).is_some() {
+        set_enabled(true);
+    }
+}
+
+/// Add a path opened for the first time to the access trace. Written
+/// straight away, so that the trace is complete up to a crash.
+fn trace_first_open(path: &str) {
+    let mut trace = TRACE.lock().unwrap();
+    if let Some(file) = trace.as_mut() {
+        if writeln!(file, "{}", path).is_err() {
+            *trace = None;
+        }
+    }
+}
+
+/// Count an open of `path`, found in `mount`, returning the stats to
+/// attach to the new handle
+pub fn open(path: &str, mount: &str) -> Arc<FileStats> {
+    let mut files = files().lock().unwrap();
+    let stats = files
+        .entry(path.to_string())
+        .or_insert_with(|| {
+            trace_first_open(path);
+            Arc::new(FileStats {
+                mount: mount.to_string(),
+                ..FileStats::default()
+            })
+        })
+        .clone();
+    stats.opens.fetch_add(1, Ordering::Relaxed);
+    stats
+}
+
+pub fn attach(handle: usize, stats: Arc<FileStats>) {
+    handles().write().unwrap().insert(handle, stats);
+}
+
+/// Forget a handle that is being closed
+pub fn detach(handle: usize) {
+    if let Some(handles) = HANDLES.get() {
+        handles.write().unwrap().remove(&handle);
+    }
+}
+
+fn with_handle(handle: usize, f: impl FnOnce(&FileStats)) {
+    if !enabled() {
+        return;
+    }
+    if let Some(stats) = handles().read().unwrap().get(&handle) {
+        f(stats);
+    }
+}
+
+pub fn record_read(handle: usize, bytes: usize) {
+    with_handle(handle, |stats| {
+        stats.bytes_read.fetch_add(bytes as u64, Ordering::Relaxed);
+    });
+}
+
+/// Count a seek of `handle` from offset `from` to offset `to`
+pub fn record_seek(handle: usize, from: u64, to: u64) {
+    if to < from {
+        with_handle(handle, |stats| {
+            stats.backward_seeks.fetch_add(1, Ordering::Relaxed);
+        });
+    }
+}
+
+/// Totals per mount, then the files that cost the most to read
+pub fn report() -> String {
+    let files = files().lock().unwrap();
+    let mut out = String::new();
+
+    let mut mounts: Vec<(&str, Counts)> = Vec::new();
+    let mut hot: Vec<(&str, Counts)> = Vec::with_capacity(files.len());
+    for (path, stats) in files.iter() {
+        let counts = stats.load();
+        match mounts.iter_mut().find(|(m, _)| *m == stats.mount) {
+            Some((_, total)) => total.add(&counts),
+            None => mounts.push((&stats.mount, counts)),
+        }
+        hot.push((path, counts));
+    }
+    mounts.sort_by(|a, b| b.1.bytes_read.cmp(&a.1.bytes_read).then(a.0.cmp(b.0)));
+    // Inflated bytes cost more than bytes read as they are
+    hot.sort_by(|a, b| {
+        let cost = |c: &Counts| c.bytes_read + 4 * c.bytes_inflated;
+        cost(&b.1).cmp(&cost(&a.1)).then(a.0.cmp(b.0))
+    });
+
+    let _ = writeln!(
+        out,
+        "I/O statistics{}:",
+        if enabled() { "" } else { " (not collecting)" }
+    );
+    let _ = writeln!(
+        out,
+        "{:>8} {:>8} {:>12} {:>12} {:>8} {:>8}  mount",
+        "opens", "cached", "read", "inflated", "back", "rewinds"
+    );
+    for (mount, counts) in &mounts {
+        write_counts(&mut out, counts, mount);
+    }
+
+    let _ = writeln!(out, "Hot files:");
+    let _ = writeln!(
+        out,
+        "{:>8} {:>8} {:>12} {:>12} {:>8} {:>8}  path",
+        "opens", "cached", "read", "inflated", "back", "rewinds"
+    );
+    for (path, counts) in hot.iter().take(HOT_FILES) {
+        write_counts(&mut out, counts, path);
+    }
+    out
+}
+
+fn write_counts(out: &mut String, counts: &Counts, name: &str) {
+    let _ = writeln!(
+        out,
+        "{:>8} {:>8} {:>12} {:>12} {:>8} {:>8}  {}",
+        counts.opens,
+        counts.cache_hits,
+        counts.bytes_read,
+        counts.bytes_inflated,
+        counts.backward_seeks,
+        counts.rewinds,
+        name
+    );
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    #[serial_test::serial]
+    fn test_stats_report_orders_by_cost() {
+        set_enabled(true);
+        let cheap = open("/content/small.txt", "/ <- content");
+        let dear = open("/content/big.ogg", "/ <- content.uqm");
+        attach(1, cheap.clone());
+        attach(2, dear.clone());
+
+        record_read(1, 100);
+        record_read(2, 50);
+        dear.add_inflated(1000);
+        record_seek(2, 500, 10);
+        record_seek(2, 10, 500);
+        dear.add_rewind();
+        detach(1);
+        detach(2);
+        // No longer counted
+        record_read(1, 100);
+
+        let counts = dear.load();
+        assert_eq!(counts.opens, 1);
+        assert_eq!(counts.bytes_read, 50);
+        assert_eq!(counts.backward_seeks, 1);
+        assert_eq!(cheap.load().bytes_read, 100);
+
+        let report = report();
+        let big = report.rfind("/content/big.ogg").unwrap();
+        let small = report.rfind("/content/small.txt").unwrap();
+        assert!(big < small, "{}", report);
+        assert!(report.contains("/ <- content.uqm"));
+        set_enabled(false);
+    }
+}
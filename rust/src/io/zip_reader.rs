@@ -18,12 +18,18 @@
 ///
 /// Synthetic directories:
 /// - Implied parent directories are synthesized (e.g., "a/b/c.txt" creates "a" and "a/b")
-use std::collections::{HashMap, HashSet};
+use flate2::bufread::DeflateDecoder;
+use std::borrow::Cow;
+use std::collections::{BTreeMap, HashMap, HashSet};
 use std::fs::File;
-use std::io::{Read, Seek, SeekFrom};
+use std::io::{BufRead, BufReader, Read, Seek, SeekFrom, Take};
 use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
 use zip::ZipArchive;
 
+use crate::io::uio_stats::FileStats;
+
 /// Metadata for a single entry in a ZIP archive
 #[derive(Debug, Clone)]
 pub struct ZipEntry {
@@ -54,9 +60,52 @@ pub struct ZipIndex {
     pub directories: HashSet<String>,
     /// Path to the archive file
     pub archive_path: PathBuf,
+    /// Names of the files and directories right inside each directory
+    /// ("" being the root), so listing one does not scan the whole index
+    children: HashMap<String, Vec<String>>,
+    /// Taken from the index cache rather than parsed from the archive
+    from_cache: bool,
+    /// Tells the entries of this index apart in the inflated entry cache
+    cache_id: u64,
 }
 
 impl ZipIndex {
+    fn from_parts(
+        archive_path: &Path,
+        entries: HashMap<String, ZipEntry>,
+        directories: HashSet<String>,
+    ) -> Self {
+        let mut child_sets: HashMap<&str, HashSet<&str>> = HashMap::new();
+        // Every parent of an entry is in `directories`, so each path only
+        // needs to be listed in its immediate parent
+        for path in entries.keys().chain(directories.iter()) {
+            let (parent, name) = split_parent(path);
+            child_sets.entry(parent).or_default().insert(name);
+        }
+        let children = child_sets
+            .into_iter()
+            .map(|(dir, names)| {
+                (
+                    dir.to_string(),
+                    names.into_iter().map(str::to_string).collect(),
+                )
+            })
+            .collect();
+
+        ZipIndex {
+            entries,
+            directories,
+            archive_path: archive_path.to_path_buf(),
+            children,
+            from_cache: false,
+            cache_id: NEXT_INDEX_CACHE_ID.fetch_add(1, Ordering::Relaxed),
+        }
+    }
+
+    pub fn loaded_from_cache(&self) -> bool {
+        self.from_cache
+    }
+
     /// Create a new ZIP index by parsing the archive at the given path
     ///
     /// This reads the central directory and builds an in-memory index
@@ -64,7 +113,41 @@ impl ZipIndex {
     /// any file paths that imply intermediate directories.
     ///
     /// Returns Err if the archive cannot be opened or parsed.
+    ///
+    /// The index is kept in the index cache under the config dir, and
+    /// taken from there as long as the archive has not changed.
     pub fn new(archive_path: &Path) -> Result<Self, std::io::Error> {
+        Self::with_cache(archive_path, index_cache_dir().as_deref())
+    }
+
+    /// Like `new`, with the index cache in `cache_dir` (none if `None`)
+    pub fn with_cache(
+        archive_path: &Path,
+        cache_dir: Option<&Path>,
+    ) -> Result<Self, std::io::Error> {
+        let cache = cache_dir.and_then(|dir| {
+            ArchiveKey::read(archive_path)
+                .ok()
+                .map(|key| (cache_file_path(dir, archive_path), key))
+        });
+
+        if let Some((cache_file, key)) = &cache {
+            if let Some(mut index) = load_cached_index(cache_file, archive_path, key) {
+                index.from_cache = true;
+                return Ok(index);
+            }
+        }
+
+        let index = Self::parse(archive_path)?;
+        if let Some((cache_file, key)) = &cache {
+            // Not being able to cache the index only costs time
+            let _ = store_cached_index(cache_file, &index, key);
+        }
+        Ok(index)
+    }
+
+    /// Build the index from the archive's central directory
+    fn parse(archive_path: &Path) -> Result<Self, std::io::Error> {
         let file = File::open(archive_path)?;
         let mut archive = ZipArchive::new(file).map_err(|e| {
             std::io::Error::new(
@@ -86,7 +169,7 @@ impl ZipIndex {
             })?;
 
             let raw_name = entry.name();
-            let normalized = normalize_zip_path(raw_name);
+            let normalized = normalize_zip_path(raw_name).into_owned();
 
             // Skip empty paths
             if normalized.is_empty() {
@@ -127,66 +210,37 @@ impl ZipIndex {
             }
         }
 
-        Ok(ZipIndex {
-            entries,
-            directories,
-            archive_path: archive_path.to_path_buf(),
-        })
+        Ok(ZipIndex::from_parts(archive_path, entries, directories))
     }
 
     /// Check if a path exists in the archive (file or directory)
     pub fn contains(&self, path: &str) -> bool {
         let normalized = normalize_zip_path(path);
-        self.entries.contains_key(&normalized) || self.directories.contains(&normalized)
+        self.entries.contains_key(normalized.as_ref())
+            || self.directories.contains(normalized.as_ref())
     }
 
     /// Get entry metadata for a file path
     pub fn get_entry(&self, path: &str) -> Option<&ZipEntry> {
-        let normalized = normalize_zip_path(path);
-        self.entries.get(&normalized)
+        self.entries.get(normalize_zip_path(path).as_ref())
     }
 
     /// Check if a path is a directory
     pub fn is_directory(&self, path: &str) -> bool {
-        let normalized = normalize_zip_path(path);
-        self.directories.contains(&normalized)
+        self.directories.contains(normalize_zip_path(path).as_ref())
     }
 
     /// List all entries in a directory (non-recursive)
     pub fn list_directory(&self, dir_path: &str) -> Vec<String> {
-        let normalized_dir = if dir_path.is_empty() {
-            String::new()
-        } else {
-            let mut n = normalize_zip_path(dir_path);
-            if !n.is_empty() && !n.ends_with('/') {
-                n.push('/');
-            }
-            n
-        };
-
-        let mut results = HashSet::new();
-
-        // Find all entries that are direct children of this directory
-        for entry_path in self.entries.keys() {
-            if let Some(child_name) = get_direct_child(&normalized_dir, entry_path) {
-                results.insert(child_name);
-            }
-        }
-
-        // Also check synthetic directories
-        for dir_path in &self.directories {
-            if let Some(child_name) = get_direct_child(&normalized_dir, dir_path) {
-                results.insert(child_name);
-            }
-        }
-
-        results.into_iter().collect()
+        self.children
+            .get(normalize_zip_path(dir_path).as_ref())
+            .cloned()
+            .unwrap_or_default()
     }
 
     /// Read an entry from the archive into a buffer
     pub fn read_entry(&self, path: &str) -> Result<Vec<u8>, std::io::Error> {
-        let normalized = normalize_zip_path(path);
-        let entry = self.entries.get(&normalized).ok_or_else(|| {
+        let entry = self.get_entry(path).ok_or_else(|| {
             std::io::Error::new(std::io::ErrorKind::NotFound, "Entry not found in archive")
         })?;
 
@@ -232,8 +286,7 @@ impl ZipIndex {
 
     /// Open an entry for streaming reads
     pub fn open_entry(&self, path: &str) -> Result<ZipEntryReader, std::io::Error> {
-        let normalized = normalize_zip_path(path);
-        let entry = self.entries.get(&normalized).ok_or_else(|| {
+        let entry = self.get_entry(path).ok_or_else(|| {
             std::io::Error::new(std::io::ErrorKind::NotFound, "Entry not found in archive")
         })?;
 
@@ -244,83 +297,723 @@ impl ZipIndex {
             ));
         }
 
-        ZipEntryReader::new(&self.archive_path, entry.index, entry.uncompressed_size)
+        ZipEntryReader::new(&self.archive_path, entry, self.cache_id)
+    }
+}
+
+impl Drop for ZipIndex {
+    fn drop(&mut self) {
+        // Once unmounted, nothing can ask for these again
+        entry_cache().lock().unwrap().remove_index(self.cache_id);
+    }
+}
+
+// =============================================================================
+// Inflated entry cache
+// =============================================================================
+
+/// Default byte budget of the inflated entry cache
+pub const DEFAULT_ENTRY_CACHE_BUDGET: usize = 8 * 1024 * 1024;
+
+static NEXT_INDEX_CACHE_ID: AtomicU64 = AtomicU64::new(1);
+
+static ENTRY_CACHE: OnceLock<Mutex<EntryCache>> = OnceLock::new();
+
+fn entry_cache() -> &'static Mutex<EntryCache> {
+    ENTRY_CACHE.get_or_init(|| Mutex::new(EntryCache::new(DEFAULT_ENTRY_CACHE_BUDGET)))
+}
+
+/// Set the byte budget of the inflated entry cache, dropping entries
+/// until it fits. 0 turns the cache off.
+pub fn set_entry_cache_budget(budget: usize) {
+    let mut cache = entry_cache().lock().unwrap();
+    cache.budget = budget;
+    cache.shrink_to(budget);
+}
+
+/// (index cache_id, entry index in the archive)
+type EntryKey = (u64, usize);
+
+/// Entries read into memory in full, shared by all readers of the same
+/// entry, so that opening one again does not inflate it again. The least
+/// recently used entries go first when the budget is exceeded.
+struct EntryCache {
+    budget: usize,
+    size: usize,
+    /// The data, and when it was last used
+    entries: HashMap<EntryKey, (Arc<Vec<u8>>, u64)>,
+    /// The keys by when they were last used
+    by_use: BTreeMap<u64, EntryKey>,
+    tick: u64,
+}
+
+impl EntryCache {
+    fn new(budget: usize) -> Self {
+        EntryCache {
+            budget,
+            size: 0,
+            entries: HashMap::new(),
+            by_use: BTreeMap::new(),
+            tick: 0,
+        }
+    }
+
+    fn get(&mut self, key: EntryKey) -> Option<Arc<Vec<u8>>> {
+        let (data, last_use) = self.entries.get_mut(&key)?;
+        self.by_use.remove(last_use);
+        self.tick += 1;
+        *last_use = self.tick;
+        self.by_use.insert(self.tick, key);
+        Some(Arc::clone(data))
+    }
+
+    fn insert(&mut self, key: EntryKey, data: Arc<Vec<u8>>) {
+        // An entry taking a large part of the budget would push out
+        // many others
+        if data.len() > self.budget / 4 {
+            return;
+        }
+        self.remove(key);
+        self.shrink_to(self.budget - data.len());
+        self.tick += 1;
+        self.size += data.len();
+        self.by_use.insert(self.tick, key);
+        self.entries.insert(key, (data, self.tick));
+    }
+
+    fn remove(&mut self, key: EntryKey) {
+        if let Some((data, last_use)) = self.entries.remove(&key) {
+            self.by_use.remove(&last_use);
+            self.size -= data.len();
+        }
+    }
+
+    fn remove_index(&mut self, cache_id: u64) {
+        let keys: Vec<EntryKey> = self
+            .entries
+            .keys()
+            .filter(|(id, _)| *id == cache_id)
+            .copied()
+            .collect();
+        for key in keys {
+            self.remove(key);
+        }
+    }
+
+    fn shrink_to(&mut self, size: usize) {
+        while self.size > size {
+            let Some((_, key)) = self.by_use.pop_first() else {
+                break;
+            };
+            if let Some((data, _)) = self.entries.remove(&key) {
+                self.size -= data.len();
+            }
+        }
     }
 }
 
+// =============================================================================
+// Index cache
+// =============================================================================
+
+/// Name of the index cache directory, inside the config dir
+const INDEX_CACHE_DIR_NAME: &str = "cache";
+
+const INDEX_CACHE_MAGIC: &[u8; 8] = b"UQMZIX01";
+
+/// Size of the end of central directory record, without its comment
+const EOCD_SIZE: usize = 22;
+const EOCD_SIGNATURE: u32 = 0x0605_4b50;
+
+/// Where the index cache goes: the config dir, as the C side publishes it
+/// in UQM_CONFIG_DIR when preparing it, which is before any packages are
+/// mounted. No caching without it.
+fn index_cache_dir() -> Option<PathBuf> {
+    std::env::var_os("UQM_CONFIG_DIR").map(|dir| PathBuf::from(dir).join(INDEX_CACHE_DIR_NAME))
+}
+
+/// One cache file per archive, named after it, with a hash of the full
+/// path to tell apart packages of the same name in different places
+fn cache_file_path(cache_dir: &Path, archive_path: &Path) -> PathBuf {
+    let full_path = archive_path.to_string_lossy();
+    let name = archive_path
+        .file_name()
+        .map(|n| n.to_string_lossy().into_owned())
+        .unwrap_or_default();
+    cache_dir.join(format!(
+        "{}-{:08x}.idx",
+        name,
+        crc32fast::hash(full_path.as_bytes())
+    ))
+}
+
+/// What a cached index must match to be used for an archive
+#[derive(Debug, PartialEq, Eq)]
+struct ArchiveKey {
+    file_size: u64,
+    mtime_secs: u64,
+    mtime_nanos: u32,
+    central_dir_size: u64,
+    central_dir_crc: u32,
+}
+
+impl ArchiveKey {
+    fn read(archive_path: &Path) -> Result<Self, std::io::Error> {
+        let mut file = File::open(archive_path)?;
+        let meta = file.metadata()?;
+        let mtime = meta
+            .modified()?
+            .duration_since(std::time::UNIX_EPOCH)
+            .unwrap_or_default();
+        let (central_dir_offset, central_dir_size) = find_central_dir(&mut file, meta.len())?;
+
+        let mut central_dir = vec![0u8; central_dir_size as usize];
+        file.seek(SeekFrom::Start(central_dir_offset))?;
+        file.read_exact(&mut central_dir)?;
+
+        Ok(ArchiveKey {
+            file_size: meta.len(),
+            mtime_secs: mtime.as_secs(),
+            mtime_nanos: mtime.subsec_nanos(),
+            central_dir_size,
+            central_dir_crc: crc32fast::hash(&central_dir),
+        })
+    }
+}
+
+/// Locate the central directory through the end of central directory
+/// record. ZIP64 archives are not handled (and so not cached).
+fn find_central_dir(file: &mut File, file_size: u64) -> Result<(u64, u64), std::io::Error> {
+    let invalid = || {
+        std::io::Error::new(
+            std::io::ErrorKind::InvalidData,
+            "no usable end of central directory",
+        )
+    };
+
+    let tail_size = std::cmp::min(file_size, (EOCD_SIZE + 0xffff) as u64) as usize;
+    if tail_size < EOCD_SIZE {
+        return Err(invalid());
+    }
+    let mut tail = vec![0u8; tail_size];
+    file.seek(SeekFrom::Start(file_size - tail_size as u64))?;
+    file.read_exact(&mut tail)?;
+
+    let eocd = (0..=tail_size - EOCD_SIZE)
+        .rev()
+        .find(|&i| {
+            u32::from_le_bytes([tail[i], tail[i + 1], tail[i + 2], tail[i + 3]]) == EOCD_SIGNATURE
+        })
+        .ok_or_else(invalid)?;
+    let field = |at: usize| {
+        u32::from_le_bytes([
+            tail[eocd + at],
+            tail[eocd + at + 1],
+            tail[eocd + at + 2],
+            tail[eocd + at + 3],
+        ])
+    };
+    let size = field(12);
+    let offset = field(16);
+    if size == u32::MAX || offset == u32::MAX || offset as u64 + size as u64 > file_size {
+        return Err(invalid());
+    }
+    Ok((offset as u64, size as u64))
+}
+
+/// Read a cached index, if there is one for this archive as it is now
+fn load_cached_index(cache_file: &Path, archive_path: &Path, key: &ArchiveKey) -> Option<ZipIndex> {
+    let data = std::fs::read(cache_file).ok()?;
+    let mut r = CacheReader {
+        data: &data,
+        pos: 0,
+    };
+
+    if r.bytes(INDEX_CACHE_MAGIC.len())? != INDEX_CACHE_MAGIC {
+        return None;
+    }
+    let cached_key = ArchiveKey {
+        file_size: r.u64()?,
+        mtime_secs: r.u64()?,
+        mtime_nanos: r.u32()?,
+        central_dir_size: r.u64()?,
+        central_dir_crc: r.u32()?,
+    };
+    if cached_key != *key || r.string()? != archive_path.to_string_lossy() {
+        return None;
+    }
+
+    let num_entries = r.u32()? as usize;
+    let mut entries = HashMap::with_capacity(num_entries);
+    for _ in 0..num_entries {
+        let entry = ZipEntry {
+            path: r.string()?,
+            compressed_size: r.u64()?,
+            uncompressed_size: r.u64()?,
+            compression_method: r.u16()?,
+            crc32: r.u32()?,
+            local_header_offset: r.u64()?,
+            is_directory: r.u8()? != 0,
+            index: r.u64()? as usize,
+        };
+        entries.insert(entry.path.clone(), entry);
+    }
+
+    let num_dirs = r.u32()? as usize;
+    let mut directories = HashSet::with_capacity(num_dirs);
+    for _ in 0..num_dirs {
+        directories.insert(r.string()?);
+    }
+
+    if r.pos != data.len() {
+        return None;
+    }
+
+    Some(ZipIndex::from_parts(archive_path, entries, directories))
+}
+
+fn store_cached_index(
+    cache_file: &Path,
+    index: &ZipIndex,
+    key: &ArchiveKey,
+) -> Result<(), std::io::Error> {
+    let mut out = Vec::new();
+    out.extend_from_slice(INDEX_CACHE_MAGIC);
+    out.extend_from_slice(&key.file_size.to_le_bytes());
+    out.extend_from_slice(&key.mtime_secs.to_le_bytes());
+    out.extend_from_slice(&key.mtime_nanos.to_le_bytes());
+    out.extend_from_slice(&key.central_dir_size.to_le_bytes());
+    out.extend_from_slice(&key.central_dir_crc.to_le_bytes());
+    put_string(&mut out, &index.archive_path.to_string_lossy());
+
+    out.extend_from_slice(&(index.entries.len() as u32).to_le_bytes());
+    for entry in index.entries.values() {
+        put_string(&mut out, &entry.path);
+        out.extend_from_slice(&entry.compressed_size.to_le_bytes());
+        out.extend_from_slice(&entry.uncompressed_size.to_le_bytes());
+        out.extend_from_slice(&entry.compression_method.to_le_bytes());
+        out.extend_from_slice(&entry.crc32.to_le_bytes());
+        out.extend_from_slice(&entry.local_header_offset.to_le_bytes());
+        out.push(entry.is_directory as u8);
+        out.extend_from_slice(&(entry.index as u64).to_le_bytes());
+    }
+
+    out.extend_from_slice(&(index.directories.len() as u32).to_le_bytes());
+    for dir in &index.directories {
+        put_string(&mut out, dir);
+    }
+
+    // Write aside and rename, so a reader never sees half a file
+    if let Some(dir) = cache_file.parent() {
+        std::fs::create_dir_all(dir)?;
+    }
+    let temp_file = cache_file.with_extension("idx.tmp");
+    std::fs::write(&temp_file, &out)?;
+    if let Err(e) = std::fs::rename(&temp_file, cache_file) {
+        let _ = std::fs::remove_file(&temp_file);
+        return Err(e);
+    }
+    Ok(())
+}
+
+fn put_string(out: &mut Vec<u8>, s: &str) {
+    out.extend_from_slice(&(s.len() as u32).to_le_bytes());
+    out.extend_from_slice(s.as_bytes());
+}
+
+/// Cursor over a cache file; every read is `None` past the end
+struct CacheReader<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> CacheReader<'a> {
+    fn bytes(&mut self, count: usize) -> Option<&'a [u8]> {
+        let end = self.pos.checked_add(count)?;
+        let bytes = self.data.get(self.pos..end)?;
+        self.pos = end;
+        Some(bytes)
+    }
+
+    fn u8(&mut self) -> Option<u8> {
+        self.bytes(1).map(|b| b[0])
+    }
+
+    fn u16(&mut self) -> Option<u16> {
+        self.bytes(2).map(|b| u16::from_le_bytes([b[0], b[1]]))
+    }
+
+    fn u32(&mut self) -> Option<u32> {
+        self.bytes(4)
+            .map(|b| u32::from_le_bytes([b[0], b[1], b[2], b[3]]))
+    }
+
+    fn u64(&mut self) -> Option<u64> {
+        self.bytes(8).map(|b| {
+            let mut a = [0u8; 8];
+            a.copy_from_slice(b);
+            u64::from_le_bytes(a)
+        })
+    }
+
+    fn string(&mut self) -> Option<String> {
+        let len = self.u32()? as usize;
+        String::from_utf8(self.bytes(len)?.to_vec()).ok()
+    }
+}
+
+/// Entries up to this size are decompressed and CRC-validated in full
+/// when they are opened; larger ones are inflated as they are read.
+pub const EAGER_ENTRY_MAX_SIZE: u64 = 256 * 1024;
+
+/// Size of the buffers used while streaming an entry
+const STREAM_BUFFER_SIZE: usize = 64 * 1024;
+
 /// Streaming reader for a ZIP entry.
-/// Eagerly decompresses and CRC-validates the full entry on construction
-/// so that every subsequent read is served from a validated in-memory buffer.
+///
+/// Small entries (up to `EAGER_ENTRY_MAX_SIZE`) and entries with a
+/// compression method other than stored or deflated are decompressed and
+/// CRC-validated in full on construction, so that every read is served
+/// from a validated in-memory buffer. That buffer is kept in the inflated
+/// entry cache for the next reader of the entry.
+///
+/// Larger stored and deflated entries are inflated on demand through
+/// bounded buffers. The CRC is computed as the data goes by and checked
+/// when the end of the entry is reached; a mismatch makes that read fail.
+/// Seeking backwards in a deflated entry restarts inflation from the
+/// start of the entry; stored entries are seeked in place.
 /// @requirement REQ-FIO-ARCHIVE-MOUNT (CRC validation on read path)
 pub struct ZipEntryReader {
-    data: Vec<u8>,
+    source: EntrySource,
+    size: u64,
     position: u64,
+    /// The entry in memory was compressed in the archive
+    inflated_on_open: bool,
+    /// The entry in memory came from the inflated entry cache
+    from_entry_cache: bool,
+}
+
+enum EntrySource {
+    Memory(Arc<Vec<u8>>),
+    Stream(EntryStream),
+}
+
+/// Where a streamed entry lives in the archive
+struct StreamOrigin {
+    archive_path: PathBuf,
+    data_start: u64,
+    compressed_size: u64,
+    deflated: bool,
+    expected_crc: u32,
+}
+
+struct EntryStream {
+    origin: StreamOrigin,
+    decoder: EntryDecoder,
+    /// Offset in the uncompressed data that `decoder` is at
+    stream_pos: u64,
+    hasher: crc32fast::Hasher,
+    crc_checked: bool,
+    /// Where inflating and starting over are counted, if anywhere
+    stats: Option<Arc<FileStats>>,
+}
+
+enum EntryDecoder {
+    Stored(BufReader<Take<File>>),
+    Deflated(DeflateDecoder<BufReader<Take<File>>>),
+}
+
+impl Read for EntryDecoder {
+    fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
+        match self {
+            EntryDecoder::Stored(r) => r.read(buf),
+            EntryDecoder::Deflated(r) => r.read(buf),
+        }
+    }
 }
 
 impl ZipEntryReader {
-    fn new(archive_path: &Path, index: usize, _size: u64) -> Result<Self, std::io::Error> {
-        let file = File::open(archive_path)?;
-        let mut archive = ZipArchive::new(file).map_err(|e| {
-            std::io::Error::new(
-                std::io::ErrorKind::InvalidData,
-                format!("Failed to open ZIP archive: {}", e),
-            )
-        })?;
+    fn new(archive_path: &Path, entry: &ZipEntry, cache_id: u64) -> Result<Self, std::io::Error> {
+        let streamable = entry.compression_method == 0 || entry.compression_method == 8;
+        if streamable && entry.uncompressed_size > EAGER_ENTRY_MAX_SIZE {
+            let origin = StreamOrigin {
+                archive_path: archive_path.to_path_buf(),
+                data_start: entry.local_header_offset,
+                compressed_size: entry.compressed_size,
+                deflated: entry.compression_method == 8,
+                expected_crc: entry.crc32,
+            };
+            let stream = EntryStream::open(origin)?;
+            return Ok(ZipEntryReader {
+                source: EntrySource::Stream(stream),
+                size: entry.uncompressed_size,
+                position: 0,
+                inflated_on_open: false,
+                from_entry_cache: false,
+            });
+        }
 
-        let expected_crc = {
-            let entry = archive.by_index_raw(index).map_err(|e| {
-                std::io::Error::new(
-                    std::io::ErrorKind::InvalidData,
-                    format!("Failed to read ZIP entry metadata: {}", e),
-                )
-            })?;
-            entry.crc32()
+        let key = (cache_id, entry.index);
+        let cached = entry_cache().lock().unwrap().get(key);
+        let from_entry_cache = cached.is_some();
+        let data = match cached {
+            Some(data) => data,
+            None => {
+                let data = Arc::new(read_entry_eagerly(archive_path, entry.index)?);
+                entry_cache().lock().unwrap().insert(key, Arc::clone(&data));
+                data
+            }
         };
+        Ok(ZipEntryReader {
+            size: data.len() as u64,
+            source: EntrySource::Memory(data),
+            position: 0,
+            inflated_on_open: entry.compression_method != 0 && !from_entry_cache,
+            from_entry_cache,
+        })
+    }
+
+    /// A reader for an entry with nothing in it
+    pub fn empty() -> Self {
+        ZipEntryReader {
+            source: EntrySource::Memory(Arc::new(Vec::new())),
+            size: 0,
+            position: 0,
+            inflated_on_open: false,
+            from_entry_cache: false,
+        }
+    }
+
+    pub fn size(&self) -> u64 {
+        self.size
+    }
 
-        let mut zip_file = archive.by_index(index).map_err(|e| {
+    pub fn position(&self) -> u64 {
+        self.position
+    }
+
+    /// True if the entry is inflated as it is read rather than held in memory
+    pub fn is_streaming(&self) -> bool {
+        matches!(self.source, EntrySource::Stream(_))
+    }
+
+    /// Count what inflating this entry costs in `stats`. Entries held in
+    /// memory were inflated, as a whole, when opened.
+    pub fn set_stats(&mut self, stats: Arc<FileStats>) {
+        match &mut self.source {
+            EntrySource::Stream(stream) => stream.stats = Some(stats),
+            EntrySource::Memory(data) => {
+                if self.inflated_on_open {
+                    stats.add_inflated(data.len() as u64);
+                }
+                if self.from_entry_cache {
+                    stats.add_cache_hit();
+                }
+            }
+        }
+    }
+
+    /// The whole entry, if it is held in memory
+    pub fn memory_data(&self) -> Option<&[u8]> {
+        match &self.source {
+            EntrySource::Memory(data) => Some(data.as_slice()),
+            EntrySource::Stream(_) => None,
+        }
+    }
+
+    /// Archive path and offset of the entry's bytes, if it is streamed
+    /// and stored uncompressed, so it can be read from the archive as-is
+    pub fn stored_region(&self) -> Option<(&Path, u64)> {
+        match &self.source {
+            EntrySource::Stream(stream) if !stream.origin.deflated => {
+                Some((&stream.origin.archive_path, stream.origin.data_start))
+            }
+            _ => None,
+        }
+    }
+}
+
+/// Decompress and CRC-validate a whole entry
+fn read_entry_eagerly(archive_path: &Path, index: usize) -> Result<Vec<u8>, std::io::Error> {
+    let file = File::open(archive_path)?;
+    let mut archive = ZipArchive::new(file).map_err(|e| {
+        std::io::Error::new(
+            std::io::ErrorKind::InvalidData,
+            format!("Failed to open ZIP archive: {}", e),
+        )
+    })?;
+
+    let expected_crc = {
+        let entry = archive.by_index_raw(index).map_err(|e| {
             std::io::Error::new(
                 std::io::ErrorKind::InvalidData,
-                format!("Failed to read ZIP entry: {}", e),
+                format!("Failed to read ZIP entry metadata: {}", e),
             )
         })?;
+        entry.crc32()
+    };
+
+    let mut zip_file = archive.by_index(index).map_err(|e| {
+        std::io::Error::new(
+            std::io::ErrorKind::InvalidData,
+            format!("Failed to read ZIP entry: {}", e),
+        )
+    })?;
+
+    let mut data = Vec::new();
+    zip_file.read_to_end(&mut data)?;
+
+    let actual_crc = crc32fast::hash(&data);
+    if actual_crc != expected_crc {
+        return Err(std::io::Error::new(
+            std::io::ErrorKind::InvalidData,
+            format!(
+                "CRC mismatch for ZIP entry: expected 0x{:08x}, got 0x{:08x}",
+                expected_crc, actual_crc
+            ),
+        ));
+    }
+
+    Ok(data)
+}
+
+impl EntryStream {
+    fn open(origin: StreamOrigin) -> Result<Self, std::io::Error> {
+        let decoder = Self::open_decoder(&origin)?;
+        Ok(EntryStream {
+            origin,
+            decoder,
+            stream_pos: 0,
+            hasher: crc32fast::Hasher::new(),
+            crc_checked: false,
+            stats: None,
+        })
+    }
 
-        let mut data = Vec::new();
-        zip_file.read_to_end(&mut data)?;
+    fn open_decoder(origin: &StreamOrigin) -> Result<EntryDecoder, std::io::Error> {
+        let mut file = File::open(&origin.archive_path)?;
+        file.seek(SeekFrom::Start(origin.data_start))?;
+        let raw = BufReader::with_capacity(STREAM_BUFFER_SIZE, file.take(origin.compressed_size));
+        Ok(if origin.deflated {
+            EntryDecoder::Deflated(DeflateDecoder::new(raw))
+        } else {
+            EntryDecoder::Stored(raw)
+        })
+    }
 
-        let actual_crc = crc32fast::hash(&data);
-        if actual_crc != expected_crc {
+    /// Start over from the beginning of the entry
+    fn rewind(&mut self) -> std::io::Result<()> {
+        if let Some(stats) = &self.stats {
+            stats.add_rewind();
+        }
+        self.decoder = Self::open_decoder(&self.origin)?;
+        self.stream_pos = 0;
+        self.hasher = crc32fast::Hasher::new();
+        self.crc_checked = false;
+        Ok(())
+    }
+
+    /// Read from the current stream position, keeping the CRC up to date
+    fn read_at_stream_pos(&mut self, buf: &mut [u8], size: u64) -> std::io::Result<usize> {
+        let remaining = size - self.stream_pos;
+        let want = std::cmp::min(buf.len() as u64, remaining) as usize;
+        if want == 0 {
+            return Ok(0);
+        }
+
+        let n = self.decoder.read(&mut buf[..want])?;
+        if n == 0 {
             return Err(std::io::Error::new(
-                std::io::ErrorKind::InvalidData,
-                format!(
-                    "CRC mismatch for ZIP entry: expected 0x{:08x}, got 0x{:08x}",
-                    expected_crc, actual_crc
-                ),
+                std::io::ErrorKind::UnexpectedEof,
+                "ZIP entry ended before its recorded size",
             ));
         }
+        self.hasher.update(&buf[..n]);
+        self.stream_pos += n as u64;
+        if let (Some(stats), true) = (&self.stats, self.origin.deflated) {
+            stats.add_inflated(n as u64);
+        }
 
-        Ok(ZipEntryReader { data, position: 0 })
+        if self.stream_pos == size && !self.crc_checked {
+            let actual_crc = self.hasher.clone().finalize();
+            if actual_crc != self.origin.expected_crc {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::InvalidData,
+                    format!(
+                        "CRC mismatch for ZIP entry: expected 0x{:08x}, got 0x{:08x}",
+                        self.origin.expected_crc, actual_crc
+                    ),
+                ));
+            }
+            self.crc_checked = true;
+        }
+        Ok(n)
     }
 
-    pub fn size(&self) -> u64 {
-        self.data.len() as u64
+    /// Move a stored entry to `position` by seeking in the archive.
+    /// Deflated entries are left alone.
+    fn jump_stored(&mut self, position: u64) -> std::io::Result<()> {
+        let EntryDecoder::Stored(reader) = &mut self.decoder else {
+            return Ok(());
+        };
+        let buffered = reader.buffer().len();
+        reader.consume(buffered);
+        let take = reader.get_mut();
+        take.get_mut()
+            .seek(SeekFrom::Start(self.origin.data_start + position))?;
+        take.set_limit(self.origin.compressed_size.saturating_sub(position));
+        self.stream_pos = position;
+        // Not read through from the start, so there is nothing to check
+        // the CRC against
+        self.crc_checked = true;
+        Ok(())
     }
 
-    pub fn position(&self) -> u64 {
-        self.position
+    fn read_at(&mut self, position: u64, buf: &mut [u8], size: u64) -> std::io::Result<usize> {
+        // Stored entries (audio and video in a repacked package) can be
+        // seeked in place, unless the skip is within what is buffered
+        let buffered = match &self.decoder {
+            EntryDecoder::Stored(reader) => reader.buffer().len() as u64,
+            EntryDecoder::Deflated(_) => 0,
+        };
+        if position < self.stream_pos || position - self.stream_pos > buffered {
+            self.jump_stored(position)?;
+        }
+
+        if position < self.stream_pos {
+            self.rewind()?;
+        }
+
+        // Skip forward to the requested position
+        if position > self.stream_pos {
+            let mut scratch = vec![0u8; STREAM_BUFFER_SIZE];
+            while self.stream_pos < position {
+                let chunk = std::cmp::min(scratch.len() as u64, position - self.stream_pos);
+                self.read_at_stream_pos(&mut scratch[..chunk as usize], size)?;
+            }
+        }
+
+        self.read_at_stream_pos(buf, size)
     }
 }
 
 impl Read for ZipEntryReader {
     fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
-        let remaining = self.data.len() as u64 - self.position;
-        if remaining == 0 {
+        if self.position >= self.size {
             return Ok(0);
         }
-        let to_copy = std::cmp::min(buf.len() as u64, remaining) as usize;
-        let start = self.position as usize;
-        buf[..to_copy].copy_from_slice(&self.data[start..start + to_copy]);
-        self.position += to_copy as u64;
-        Ok(to_copy)
+        let n = match &mut self.source {
+            EntrySource::Memory(data) => {
+                let remaining = data.len() as u64 - self.position;
+                let to_copy = std::cmp::min(buf.len() as u64, remaining) as usize;
+                let start = self.position as usize;
+                buf[..to_copy].copy_from_slice(&data[start..start + to_copy]);
+                to_copy
+            }
+            EntrySource::Stream(stream) => stream.read_at(self.position, buf, self.size)?,
+        };
+        self.position += n as u64;
+        Ok(n)
     }
 }
 
@@ -329,7 +1022,7 @@ impl Seek for ZipEntryReader {
         let new_pos = match pos {
             SeekFrom::Start(offset) => offset as i64,
             SeekFrom::Current(offset) => self.position as i64 + offset,
-            SeekFrom::End(offset) => self.data.len() as i64 + offset,
+            SeekFrom::End(offset) => self.size as i64 + offset,
         };
 
         if new_pos < 0 {
@@ -339,6 +1032,7 @@ impl Seek for ZipEntryReader {
             ));
         }
 
+        // Streamed entries catch up on the next read
         self.position = new_pos as u64;
         Ok(self.position)
     }
@@ -348,25 +1042,18 @@ impl Seek for ZipEntryReader {
 /// - Strip leading "/" and "\"
 /// - Convert backslashes to forward slashes
 /// - Strip trailing "/" for files (but preserve for detection)
-fn normalize_zip_path(path: &str) -> String {
-    if path.is_empty() {
-        return String::new();
+fn normalize_zip_path(path: &str) -> Cow<'_, str> {
+    // Paths handed in by the uio layer are normally clean already, in
+    // which case they are used as they are
+    let trimmed = path.trim_matches('/');
+    if !path.contains('\\') {
+        return Cow::Borrowed(trimmed);
     }
 
-    // Convert backslashes to forward slashes
-    let mut normalized = path.replace('\\', "/");
-
-    // Strip leading slashes
-    while normalized.starts_with('/') {
-        normalized = normalized[1..].to_string();
-    }
-
-    // Strip trailing slashes (will be re-added for directories if needed)
-    while normalized.ends_with('/') {
-        normalized = normalized[..normalized.len() - 1].to_string();
-    }
-
-    normalized
+    // Convert backslashes to forward slashes, then strip leading and
+    // trailing slashes (re-added for directories if needed)
+    let converted = path.replace('\\', "/");
+    Cow::Owned(converted.trim_matches('/').to_string())
 }
 
 /// Synthesize all parent directories for a given path
@@ -383,30 +1070,12 @@ fn synthesize_parent_dirs(path: &str, directories: &mut HashSet<String>) {
     }
 }
 
-/// Get the direct child name if `entry_path` is a direct child of `dir_path`
-///
-/// Returns None if `entry_path` is not a direct child.
-/// Returns Some(child_name) with just the name component (not full path).
-fn get_direct_child(dir_path: &str, entry_path: &str) -> Option<String> {
-    // For root directory
-    if dir_path.is_empty() {
-        if let Some(slash_pos) = entry_path.find('/') {
-            return Some(entry_path[..slash_pos].to_string());
-        } else {
-            return Some(entry_path.to_string());
-        }
-    }
-
-    // For non-root directories
-    if !entry_path.starts_with(dir_path) {
-        return None;
-    }
-
-    let remainder = &entry_path[dir_path.len()..];
-    if let Some(slash_pos) = remainder.find('/') {
-        Some(remainder[..slash_pos].to_string())
-    } else {
-        Some(remainder.to_string())
+/// Split a normalized path into its parent directory ("" for the root)
+/// and its last component
+fn split_parent(path: &str) -> (&str, &str) {
+    match path.rfind('/') {
+        Some(slash_pos) => (&path[..slash_pos], &path[slash_pos + 1..]),
+        None => ("", path),
     }
 }
 
@@ -445,28 +1114,10 @@ mod tests {
     }
 
     #[test]
-    fn test_get_direct_child() {
-        // Root directory
-        assert_eq!(
-            get_direct_child("", "file.txt"),
-            Some("file.txt".to_string())
-        );
-        assert_eq!(
-            get_direct_child("", "dir/file.txt"),
-            Some("dir".to_string())
-        );
-
-        // Non-root directory
-        assert_eq!(
-            get_direct_child("dir/", "dir/file.txt"),
-            Some("file.txt".to_string())
-        );
-        assert_eq!(
-            get_direct_child("dir/", "dir/subdir/file.txt"),
-            Some("subdir".to_string())
-        );
-        assert_eq!(get_direct_child("dir/", "other/file.txt"), None);
-        assert_eq!(get_direct_child("a/", "a/b/c.txt"), Some("b".to_string()));
+    fn test_split_parent() {
+        assert_eq!(split_parent("file.txt"), ("", "file.txt"));
+        assert_eq!(split_parent("dir/file.txt"), ("dir", "file.txt"));
+        assert_eq!(split_parent("a/b/c.txt"), ("a/b", "c.txt"));
     }
 
     #[test]
@@ -586,4 +1237,185 @@ mod tests {
 
         Ok(())
     }
+
+    fn write_test_zip(path: &Path, files: &[(&str, &[u8])]) -> Result<(), std::io::Error> {
+        let mut zip = zip::ZipWriter::new(File::create(path)?);
+        let options = zip::write::SimpleFileOptions::default();
+        for (name, data) in files {
+            zip.start_file(*name, options)?;
+            zip.write_all(data)?;
+        }
+        zip.finish()?;
+        Ok(())
+    }
+
+    #[test]
+    fn test_zip_index_cache_roundtrip() -> Result<(), std::io::Error> {
+        let temp_dir = TempDir::new()?;
+        let zip_path = temp_dir.path().join("cached.uqm");
+        let cache_dir = temp_dir.path().join("cache");
+        write_test_zip(&zip_path, &[("a/b/one.txt", b"one"), ("two.txt", b"two")])?;
+
+        let parsed = ZipIndex::with_cache(&zip_path, Some(&cache_dir))?;
+        let cache_file = cache_file_path(&cache_dir, &zip_path);
+        assert!(cache_file.exists());
+
+        let key = ArchiveKey::read(&zip_path)?;
+        let cached = load_cached_index(&cache_file, &zip_path, &key).expect("cache hit");
+        assert_eq!(cached.directories, parsed.directories);
+        assert_eq!(cached.entries.len(), parsed.entries.len());
+        for (path, entry) in &parsed.entries {
+            let other = &cached.entries[path];
+            assert_eq!(other.crc32, entry.crc32);
+            assert_eq!(other.local_header_offset, entry.local_header_offset);
+            assert_eq!(other.index, entry.index);
+        }
+
+        let index = ZipIndex::with_cache(&zip_path, Some(&cache_dir))?;
+        assert_eq!(index.read_entry("a/b/one.txt")?, b"one");
+        Ok(())
+    }
+
+    #[test]
+    fn test_zip_index_cache_ignored_after_change() -> Result<(), std::io::Error> {
+        let temp_dir = TempDir::new()?;
+        let zip_path = temp_dir.path().join("changing.uqm");
+        let cache_dir = temp_dir.path().join("cache");
+        write_test_zip(&zip_path, &[("old.txt", b"old")])?;
+        ZipIndex::with_cache(&zip_path, Some(&cache_dir))?;
+
+        write_test_zip(&zip_path, &[("new.txt", b"new contents")])?;
+        let key = ArchiveKey::read(&zip_path)?;
+        let cache_file = cache_file_path(&cache_dir, &zip_path);
+        assert!(load_cached_index(&cache_file, &zip_path, &key).is_none());
+
+        let index = ZipIndex::with_cache(&zip_path, Some(&cache_dir))?;
+        assert!(index.contains("new.txt"));
+        assert!(!index.contains("old.txt"));
+
+        // A damaged cache file is ignored too
+        std::fs::write(&cache_file, b"UQMZIX01garbage")?;
+        let index = ZipIndex::with_cache(&zip_path, Some(&cache_dir))?;
+        assert!(index.contains("new.txt"));
+        Ok(())
+    }
+
+    #[test]
+    fn test_zip_entry_reader_streams_large_entry() -> Result<(), std::io::Error> {
+        let temp_dir = TempDir::new()?;
+        let zip_path = temp_dir.path().join("stream_test.zip");
+
+        let data: Vec<u8> = (0..(EAGER_ENTRY_MAX_SIZE as u32 * 3))
+            .map(|i| (i.wrapping_mul(7919) % 251) as u8 ^ (i / 1000) as u8)
+            .collect();
+
+        let file = File::create(&zip_path)?;
+        let mut zip = zip::ZipWriter::new(file);
+        let options = zip::write::SimpleFileOptions::default()
+            .compression_method(zip::CompressionMethod::Deflated);
+        zip.start_file("big.bin", options)?;
+        zip.write_all(&data)?;
+        zip.start_file("small.txt", options)?;
+        zip.write_all(b"small")?;
+        zip.finish()?;
+
+        let index = ZipIndex::new(&zip_path)?;
+        assert!(!index.open_entry("small.txt")?.is_streaming());
+
+        let mut reader = index.open_entry("big.bin")?;
+        assert!(reader.is_streaming());
+        assert_eq!(reader.size(), data.len() as u64);
+
+        let mut all = Vec::new();
+        reader.read_to_end(&mut all)?;
+        assert!(all == data);
+
+        // Backwards, then forwards past what has been read since
+        let mut buf = [0u8; 16];
+        reader.seek(SeekFrom::Start(1000))?;
+        reader.read_exact(&mut buf)?;
+        assert_eq!(&buf, &data[1000..1016]);
+
+        let far = EAGER_ENTRY_MAX_SIZE as usize * 2;
+        reader.seek(SeekFrom::Start(far as u64))?;
+        reader.read_exact(&mut buf)?;
+        assert_eq!(&buf, &data[far..far + 16]);
+
+        reader.seek(SeekFrom::End(-4))?;
+        let mut tail = Vec::new();
+        reader.read_to_end(&mut tail)?;
+        assert_eq!(&tail[..], &data[data.len() - 4..]);
+
+        Ok(())
+    }
+
+    #[test]
+    fn test_entry_cache_evicts_least_recently_used() {
+        let mut cache = EntryCache::new(4000);
+        let data = |n: usize| Arc::new(vec![0u8; n]);
+
+        cache.insert((1, 0), data(900));
+        cache.insert((1, 1), data(900));
+        cache.insert((2, 0), data(900));
+        assert!(cache.get((1, 0)).is_some());
+        // Too large a part of the budget
+        cache.insert((2, 1), data(1500));
+        assert!(cache.get((2, 1)).is_none());
+
+        // (1, 1) was used longest ago
+        cache.insert((2, 2), data(1000));
+        cache.insert((2, 3), data(1000));
+        assert!(cache.get((1, 1)).is_none());
+        assert!(cache.get((1, 0)).is_some());
+        assert!(cache.size <= 4000);
+
+        cache.remove_index(2);
+        assert!(cache.get((2, 0)).is_none());
+        assert_eq!(cache.size, 900);
+
+        cache.shrink_to(0);
+        assert!(cache.entries.is_empty() && cache.by_use.is_empty());
+    }
+
+    #[test]
+    fn test_zip_entry_reader_seeks_stored_entry() -> Result<(), std::io::Error> {
+        let temp_dir = TempDir::new()?;
+        let zip_path = temp_dir.path().join("stored_test.zip");
+
+        let data: Vec<u8> = (0..(EAGER_ENTRY_MAX_SIZE as u32 * 2))
+            .map(|i| (i.wrapping_mul(31) % 251) as u8)
+            .collect();
+
+        let file = File::create(&zip_path)?;
+        let mut zip = zip::ZipWriter::new(file);
+        let options = zip::write::SimpleFileOptions::default()
+            .compression_method(zip::CompressionMethod::Stored);
+        zip.start_file("music.ogg", options)?;
+        zip.write_all(&data)?;
+        zip.finish()?;
+
+        let index = ZipIndex::new(&zip_path)?;
+        let mut reader = index.open_entry("music.ogg")?;
+        assert!(reader.is_streaming());
+        let stats = Arc::new(FileStats::default());
+        reader.set_stats(Arc::clone(&stats));
+
+        let mut buf = [0u8; 16];
+        let far = data.len() - 100;
+        reader.seek(SeekFrom::Start(far as u64))?;
+        reader.read_exact(&mut buf)?;
+        assert_eq!(&buf, &data[far..far + 16]);
+
+        // Back to near the start, without reading it all again
+        reader.seek(SeekFrom::Start(10))?;
+        reader.read_exact(&mut buf)?;
+        assert_eq!(&buf, &data[10..26]);
+
+        let mut rest = Vec::new();
+        reader.read_to_end(&mut rest)?;
+        assert!(rest[..] == data[26..]);
+        assert_eq!(stats.rewinds(), 0);
+
+        Ok(())
+    }
 }
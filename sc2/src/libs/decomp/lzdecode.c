@@ -37,38 +37,48 @@ BYTE* _Stream;
 UWORD _workbuf;
 BYTE _workbuflen;
 
-/* get one bit */
-static SWORD
-GetBit (void)
+/* refill the input buffer of a file stream, and return its first byte */
+static int
+FillInBuf (void)
 {
-	SWORD i;
+	PLZHCODE_DESC lpCD = _lpCurCodeDesc;
 
-	while (_workbuflen <= 8)
-	{
-		if ((i = InChar ()) < 0)
-			i = 0;
-		_workbuf |= i << (8 - _workbuflen);
-		_workbuflen += 8;
-	}
-	i = (_workbuf & 0xFFFF) >> (16 - 1);
-	_workbuf = (_workbuf << 1) & 0xFFFF;
-	_workbuflen--;
+	lpCD->in_pos = 0;
+	lpCD->in_len = (COUNT)ReadResFile (lpCD->in_buf, 1, IN_BUF_SIZE,
+			(uio_Stream *)_Stream);
+	if (lpCD->in_len == 0)
+		return (-1);
 
-	return (i);
+	return (lpCD->in_buf[lpCD->in_pos++]);
 }
 
-static UWORD
-GetBits (BYTE num_bits)
+	/* InChar () for decoding, reading files a buffer at a time */
+#define DecodeInChar() (_StreamType != FILE_STREAM ? (int)*_Stream++ : \
+		_lpCurCodeDesc->in_pos < _lpCurCodeDesc->in_len ? \
+		(int)_lpCurCodeDesc->in_buf[_lpCurCodeDesc->in_pos++] : \
+		FillInBuf ())
+
+/* make sure there are more than 8 bits in the work buffer */
+static inline void
+FillWorkBuf (void)
 {
 	SWORD i;
 
 	while (_workbuflen <= 8)
 	{
-		if ((i = InChar ()) < 0)
+		if ((i = DecodeInChar ()) < 0)
 			i = 0;
 		_workbuf |= i << (8 - _workbuflen);
 		_workbuflen += 8;
 	}
+}
+
+static inline UWORD
+GetBits (BYTE num_bits)
+{
+	UWORD i;
+
+	FillWorkBuf ();
 	i = (_workbuf & 0xFFFF) >> (16 - num_bits);
 	_workbuf = (_workbuf << num_bits) & 0xFFFF;
 	_workbuflen -= num_bits;
@@ -164,6 +174,14 @@ cclose (PLZHCODE_DESC lpCodeDesc)
 		if (_lpCurCodeDesc->CleanupFunc)
 			(*_lpCurCodeDesc->CleanupFunc) ();
 
+		/* leave a file where the compressed data ends, as when it
+		 * was read a byte at a time */
+		if (_lpCurCodeDesc->StreamType == FILE_STREAM
+				&& _lpCurCodeDesc->in_pos < _lpCurCodeDesc->in_len)
+			SeekResFile ((uio_Stream *)_lpCurCodeDesc->Stream,
+					-(long)(_lpCurCodeDesc->in_len - _lpCurCodeDesc->in_pos),
+					SEEK_CUR);
+
 		StreamIndex = lpCodeDesc->StreamIndex;
 		FreeCodeDesc (lpCodeDesc);
 		_lpCurCodeDesc = NULL;
@@ -258,12 +276,7 @@ static const BYTE d_len[256] =
 	/* decode upper 6 bits from given table */
 #define DecodePosition(p) \
 { \
-	while (_workbuflen <= 8) \
-	{ \
-		*(p) = InChar (); \
-		_workbuf |= *(p) << (8 - _workbuflen); \
-		_workbuflen += 8; \
-	} \
+	FillWorkBuf (); \
 	*(p) = HIBYTE (_workbuf); \
 	_workbuf = (_workbuf << 8) & 0xFFFF; \
 	_workbuflen -= 8; \
@@ -277,13 +290,29 @@ static const BYTE d_len[256] =
 	/* start searching tree from the root to leaves.
 	 * choose node #(son[]) if input bit == 0
 	 * else choose #(son[]+1) (input bit == 1)
+	 * The tree changes with every character, so rather than looking
+	 * codes up in a table, up to 8 levels are walked with the bits
+	 * in the work buffer before it is refilled.
 	 */
 #define DecodeChar(c) \
 { \
-	for (*(c) = lpCodeDesc->son[R]; \
-			*(c) < T; \
-			*(c) = lpCodeDesc->son[*(c) + GetBit ()]) \
-		; \
+	*(c) = lpCodeDesc->son[R]; \
+	do \
+	{ \
+		UWORD bits; \
+		BYTE used; \
+		\
+		FillWorkBuf (); \
+		bits = _workbuf; \
+		used = 0; \
+		do \
+		{ \
+			*(c) = lpCodeDesc->son[*(c) + ((bits >> 15) & 1)]; \
+			bits <<= 1; \
+		} while (++used < 8 && *(c) < T); \
+		_workbuf = (_workbuf << used) & 0xFFFF; \
+		_workbuflen -= used; \
+	} while (*(c) < T); \
 	_update (*(c)); \
 	*(c) -= T; \
 }
@@ -39,6 +39,8 @@
 #define MAX_FREQ 0x8000
 										/* update when cumulative frequency */
 
+#define IN_BUF_SIZE 1024 /* File input read at a time when decoding */
+
 struct _LZHCODE_DESC
 {
 	COUNT buf_index, restart_index, bytes_left;
@@ -62,6 +64,10 @@ struct _LZHCODE_DESC
 
 	STREAM_MODE StreamMode;
 	PVOIDFUNC CleanupFunc;
+
+		/* file input read ahead when decoding */
+	COUNT in_pos, in_len;
+	BYTE in_buf[IN_BUF_SIZE];
 };
 
 typedef struct _LZHCODE_DESC LZHCODE_DESC;
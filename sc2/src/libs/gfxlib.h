@@ -342,6 +342,7 @@ MAKE_DRAW_MODE (DrawKind kind, SWORD factor)
 }
 
 extern CONTEXT SetContext (CONTEXT Context);
+extern CONTEXT GetContext (void);
 extern Color SetContextForeGroundColor (Color Color);
 extern Color GetContextForeGroundColor (void);
 extern Color SetContextBackGroundColor (Color Color);
@@ -370,6 +371,16 @@ extern void DrawPoint (POINT *pPoint);
 extern void DrawRectangle (RECT *pRect);
 extern void DrawFilledRectangle (RECT *pRect);
 extern void DrawLine (LINE *pLine);
+// Lines from each of the 'count' points to the next
+extern void DrawPolyline (const POINT *pPoints, COUNT count);
+// Draw into 'Context' instead of the current one, in the given color
+extern void DrawStampIn (CONTEXT Context, STAMP *pStamp);
+extern void DrawFilledStampIn (CONTEXT Context, STAMP *pStamp, Color Color);
+extern void DrawPointIn (CONTEXT Context, POINT *pPoint, Color Color);
+extern void DrawRectangleIn (CONTEXT Context, RECT *pRect, Color Color);
+extern void DrawFilledRectangleIn (CONTEXT Context, RECT *pRect,
+		Color Color);
+extern void DrawLineIn (CONTEXT Context, LINE *pLine, Color Color);
 extern void font_DrawText (TEXT *pText);
 extern void font_DrawTracedText (TEXT *pText, Color text, Color trace);
 extern void DrawBatch (PRIMITIVE *pBasePrim, PRIM_LINKS PrimLinks,
@@ -411,6 +422,14 @@ extern FONT SetContextFont (FONT Font);
 extern BOOLEAN DestroyFont (FONT FontRef);
 // The returned pRect is relative to the context drawing origin
 extern BOOLEAN TextRect (TEXT *pText, RECT *pRect, BYTE *pdelta);
+// Fits as many words of pText as there is room for in 'maxWidth', up to a
+// newline or the terminating \0, measuring each character once.
+// pText->CharCount is set to the number of characters that fitted, and
+// '*startNext' to the start of the first word that did not fit, or past
+// the newline, or to the end of the string. At most 'maxChars' characters
+// are fitted. TRUE when the rest of the line fitted.
+extern BOOLEAN TextLineWithinWidth (TEXT *pText, const char **startNext,
+		SIZE maxWidth, COUNT maxChars);
 extern BOOLEAN GetContextFontLeading (SIZE *pheight);
 extern BOOLEAN GetContextFontLeadingWidth (SIZE *pwidth);
 extern COUNT GetFrameCount (FRAME Frame);
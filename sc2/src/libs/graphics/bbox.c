@@ -15,12 +15,19 @@
  */
 
 #include "port.h"
+#include <string.h>
 #include "libs/graphics/bbox.h"
+#include "libs/memlib.h"
 
 TFB_BoundingBox TFB_BBox;
 int maxWidth;
 int maxHeight;
 
+static BYTE *tileMap;
+		// One byte per tile, row by row; non-zero when dirty
+static int tilesX;
+static int tilesY;
+
 void
 TFB_BBox_Init (int width, int height)
 {
@@ -28,14 +35,46 @@ TFB_BBox_Init (int width, int height)
 	maxHeight = height;
 	TFB_BBox.clip.extent.width = width;
 	TFB_BBox.clip.extent.height = height;
+
+	tilesX = (width + TFB_BBOX_TILE_SIZE - 1) / TFB_BBOX_TILE_SIZE;
+	tilesY = (height + TFB_BBOX_TILE_SIZE - 1) / TFB_BBOX_TILE_SIZE;
+	HFree (tileMap);
+	tileMap = HCalloc (tilesX * tilesY);
+}
+
+void
+TFB_BBox_Uninit (void)
+{
+	HFree (tileMap);
+	tileMap = NULL;
 }
 
 void
 TFB_BBox_Reset (void)
 {
+	if (TFB_BBox.valid && tileMap)
+		memset (tileMap, 0, tilesX * tilesY);
 	TFB_BBox.valid = 0;
 }
 
+// Mark the tiles covering the pixel rectangle (x1, y1) - (x2, y2),
+// inclusive.  The coordinates must already be clipped to the screen.
+static void
+markTiles (int x1, int y1, int x2, int y2)
+{
+	int tx1 = x1 / TFB_BBOX_TILE_SIZE;
+	int ty1 = y1 / TFB_BBOX_TILE_SIZE;
+	int tx2 = x2 / TFB_BBOX_TILE_SIZE;
+	int ty2 = y2 / TFB_BBOX_TILE_SIZE;
+	int ty;
+
+	if (!tileMap)
+		return;
+
+	for (ty = ty1; ty <= ty2; ++ty)
+		memset (tileMap + ty * tilesX + tx1, 1, tx2 - tx1 + 1);
+}
+
 void
 TFB_BBox_SetClipRect (const RECT *r)
 {
@@ -78,6 +117,8 @@ TFB_BBox_RegisterPoint (int x, int y)
 	if (y < y1) y = y1;
 	if (y >= y2) y = y2;
 
+	markTiles (x, y, x, y);
+
 	/* Is this the first point?  If so, set a pixel-region and return. */
 	if (!TFB_BBox.valid)
 	{
@@ -114,12 +155,31 @@ TFB_BBox_RegisterPoint (int x, int y)
 void
 TFB_BBox_RegisterRect (const RECT *r)
 {
+	int x1 = r->corner.x;
+	int y1 = r->corner.y;
+	int x2 = r->corner.x + r->extent.width - 1;
+	int y2 = r->corner.y + r->extent.height - 1;
+	int cx2 = TFB_BBox.clip.corner.x + TFB_BBox.clip.extent.width - 1;
+	int cy2 = TFB_BBox.clip.corner.y + TFB_BBox.clip.extent.height - 1;
+
 	/* RECT will still register as a corner point of the cliprect even
 	 * if it does not intersect with the cliprect at all. This is not
 	 * a problem, as more is not less. */
-	TFB_BBox_RegisterPoint (r->corner.x, r->corner.y);
-	TFB_BBox_RegisterPoint (r->corner.x + r->extent.width - 1,
-			r->corner.y + r->extent.height - 1);
+	TFB_BBox_RegisterPoint (x1, y1);
+	TFB_BBox_RegisterPoint (x2, y2);
+
+	/* The corner points only marked their own tiles; mark the ones
+	 * in between as well. */
+	if (x1 < TFB_BBox.clip.corner.x)
+		x1 = TFB_BBox.clip.corner.x;
+	if (y1 < TFB_BBox.clip.corner.y)
+		y1 = TFB_BBox.clip.corner.y;
+	if (x2 > cx2)
+		x2 = cx2;
+	if (y2 > cy2)
+		y2 = cy2;
+	if (x1 <= x2 && y1 <= y2)
+		markTiles (x1, y1, x2, y2);
 }
 
 void
@@ -131,3 +191,100 @@ TFB_BBox_RegisterCanvas (TFB_Canvas c, int x, int y)
 	TFB_DrawCanvas_GetExtent (c, &r.extent);
 	TFB_BBox_RegisterRect (&r);
 }
+
+static void
+clipToRegion (RECT *r)
+{
+	const RECT *reg = &TFB_BBox.region;
+	int x2 = r->corner.x + r->extent.width;
+	int y2 = r->corner.y + r->extent.height;
+
+	if (r->corner.x < reg->corner.x)
+		r->corner.x = reg->corner.x;
+	if (r->corner.y < reg->corner.y)
+		r->corner.y = reg->corner.y;
+	if (x2 > reg->corner.x + reg->extent.width)
+		x2 = reg->corner.x + reg->extent.width;
+	if (y2 > reg->corner.y + reg->extent.height)
+		y2 = reg->corner.y + reg->extent.height;
+	r->extent.width = x2 - r->corner.x;
+	r->extent.height = y2 - r->corner.y;
+}
+
+int
+TFB_BBox_GetDirtyRects (RECT *rects, int max)
+{
+	int count = 0;
+	int ty, i;
+
+	if (!TFB_BBox.valid)
+		return 0;
+
+	if (!tileMap)
+	{	/* No tile map; the bounding box is all we have */
+		if (max < 1)
+			return -1;
+		rects[0] = TFB_BBox.region;
+		return 1;
+	}
+
+	/* Collect horizontal runs of dirty tiles, in tile units.  A run
+	 * with the same horizontal span as a rect that ended on the row
+	 * above extends that rect downwards. */
+	for (ty = 0; ty < tilesY; ++ty)
+	{
+		const BYTE *row = tileMap + ty * tilesX;
+		int tx = 0;
+
+		while (tx < tilesX)
+		{
+			int start;
+
+			if (!row[tx])
+			{
+				++tx;
+				continue;
+			}
+
+			start = tx;
+			while (tx < tilesX && row[tx])
+				++tx;
+
+			for (i = 0; i < count; ++i)
+			{
+				if (rects[i].corner.x == start
+						&& rects[i].extent.width == tx - start
+						&& rects[i].corner.y + rects[i].extent.height == ty)
+					break;
+			}
+
+			if (i < count)
+			{
+				++rects[i].extent.height;
+			}
+			else
+			{
+				if (count == max)
+					return -1;
+				rects[count].corner.x = start;
+				rects[count].corner.y = ty;
+				rects[count].extent.width = tx - start;
+				rects[count].extent.height = 1;
+				++count;
+			}
+		}
+	}
+
+	/* Convert to pixels.  All the dirty pixels lie within the bounding
+	 * box, so clipping to it only removes what is known to be clean. */
+	for (i = 0; i < count; ++i)
+	{
+		rects[i].corner.x *= TFB_BBOX_TILE_SIZE;
+		rects[i].corner.y *= TFB_BBOX_TILE_SIZE;
+		rects[i].extent.width *= TFB_BBOX_TILE_SIZE;
+		rects[i].extent.height *= TFB_BBOX_TILE_SIZE;
+		clipToRegion (&rects[i]);
+	}
+
+	return count;
+}
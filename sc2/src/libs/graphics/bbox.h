@@ -35,11 +35,27 @@ typedef struct {
 
 extern TFB_BoundingBox TFB_BBox;
 
+/* Dirty tile map.  Besides growing the bounding box, every registered
+ * point and rect marks the TFB_BBOX_TILE_SIZE square tiles it touches,
+ * so that two small updates at opposite ends of the screen do not make
+ * the presenter scale and upload everything in between. */
+#define TFB_BBOX_TILE_SIZE 16
+
+/* Largest number of rects TFB_BBox_GetDirtyRects() will produce.  The
+ * presenters fall back on the bounding box when more are needed. */
+#define TFB_BBOX_MAX_DIRTY_RECTS 32
+
+/* Fill 'rects' with a set of rectangles covering all dirty tiles,
+ * clipped to the bounding box.  Returns the number of rects, 0 if
+ * nothing is dirty, or -1 if more than 'max' would be needed. */
+int TFB_BBox_GetDirtyRects (RECT *rects, int max);
+
 void TFB_BBox_RegisterPoint (int x, int y);
 void TFB_BBox_RegisterRect (const RECT *r);
 void TFB_BBox_RegisterCanvas (TFB_Canvas c, int x, int y);
 
 void TFB_BBox_Init (int width, int height);
+void TFB_BBox_Uninit (void);
 void TFB_BBox_Reset (void);
 void TFB_BBox_SetClipRect (const RECT *r);
 
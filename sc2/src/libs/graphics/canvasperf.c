@@ -0,0 +1,434 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Canvas_PerfTest(): times the canvas drawing operations on offscreen
+// canvases, for measuring changes to them.
+
+#include "gfx_common.h"
+#include "tfb_draw.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+#include "libs/timelib.h"
+
+#include <stdio.h>
+
+#define PERFTEST_TARGET_SIZE 512
+#define PERFTEST_MIN_TIME 200000
+		// In microseconds; each case is repeated for at least this long
+
+enum
+{
+	PERFTEST_PALETTED,
+	PERFTEST_OPAQUE,
+	PERFTEST_ALPHA,
+
+	PERFTEST_NUM_FORMATS
+};
+
+static const char *const formatNames[PERFTEST_NUM_FORMATS] =
+{
+	"paletted",
+	"opaque",
+	"alpha",
+};
+
+static const int imageSizes[] = { 16, 64, 256 };
+#define NUM_IMAGE_SIZES (sizeof imageSizes / sizeof imageSizes[0])
+
+typedef struct
+{
+	const char *name;
+	DrawKind kind;
+	SWORD factor;
+} PerfMode;
+
+static const PerfMode drawModes[] =
+{
+	{ "replace",  DRAW_REPLACE,  0 },
+	{ "additive", DRAW_ADDITIVE, DRAW_FACTOR_1 },
+	{ "alpha",    DRAW_ALPHA,    0x80 },
+};
+#define NUM_DRAW_MODES (sizeof drawModes / sizeof drawModes[0])
+
+// Images are only ever scaled down
+static const int drawScales[] =
+{
+	GSCALE_IDENTITY,
+	GSCALE_IDENTITY * 3 / 4,
+	GSCALE_IDENTITY / 2,
+	GSCALE_IDENTITY / 4,
+};
+#define NUM_DRAW_SCALES (sizeof drawScales / sizeof drawScales[0])
+
+typedef struct
+{
+	TFB_Canvas target;
+	TFB_Image *img;
+	TFB_Char *fontChar;
+	TFB_Image *backing;
+	TFB_Canvas dst;
+	int size;
+	int scale;
+	int scaleMode;
+	DrawMode mode;
+	Color color;
+	int pos;
+			// Moves each call, so that lines and rects do not all hit the
+			// same pixels
+} PerfCase;
+
+typedef void (*PerfOp) (PerfCase *pc);
+
+static int
+nextPos (PerfCase *pc)
+{
+	pc->pos = (pc->pos + 7) % (PERFTEST_TARGET_SIZE - pc->size);
+	return pc->pos;
+}
+
+static void
+perfImage (PerfCase *pc)
+{
+	int p = nextPos (pc);
+	TFB_DrawCanvas_Image (pc->img, p / 2, p / 2, pc->scale, pc->scaleMode,
+			NULL, pc->mode, pc->target);
+}
+
+static void
+perfFilledImage (PerfCase *pc)
+{
+	int p = nextPos (pc);
+	TFB_DrawCanvas_FilledImage (pc->img, p / 2, p / 2, pc->scale,
+			pc->scaleMode, pc->color, pc->mode, pc->target);
+}
+
+static void
+perfFontChar (PerfCase *pc)
+{
+	int p = nextPos (pc);
+	TFB_DrawCanvas_FontChar (pc->fontChar, pc->backing, p, p, pc->mode,
+			pc->target);
+}
+
+static void
+perfRect (PerfCase *pc)
+{
+	RECT r;
+
+	r.corner.x = nextPos (pc);
+	r.corner.y = r.corner.x;
+	r.extent.width = pc->size;
+	r.extent.height = pc->size;
+	TFB_DrawCanvas_Rect (&r, pc->color, pc->mode, pc->target);
+}
+
+static void
+perfLine (PerfCase *pc)
+{
+	int p = nextPos (pc);
+	// A shallow diagonal; 'size' pixels long
+	TFB_DrawCanvas_Line (p, p, p + pc->size - 1, p + pc->size / 3,
+			pc->color, pc->mode, pc->target);
+}
+
+static void
+perfRescaleNearest (PerfCase *pc)
+{
+	HOT_SPOT dstHs;
+	EXTENT size;
+
+	// Works out the scaled size and hot spot itself
+	TFB_DrawCanvas_Rescale_Nearest (pc->img->NormalImg, pc->dst, pc->scale,
+			&pc->img->NormalHs, &size, &dstHs);
+}
+
+static void
+perfRescaleBilinear (PerfCase *pc)
+{
+	HOT_SPOT dstHs;
+	EXTENT size;
+
+	// Works out the scaled size and hot spot itself
+	TFB_DrawCanvas_Rescale_Bilinear (pc->img->NormalImg, pc->dst, pc->scale,
+			&pc->img->NormalHs, &size, &dstHs);
+}
+
+static void
+perfRotate (PerfCase *pc)
+{
+	EXTENT size;
+
+	TFB_DrawCanvas_GetRotatedExtent (pc->img->NormalImg, 30, &size);
+	TFB_DrawCanvas_Rotate (pc->img->NormalImg, pc->dst, 30, size);
+}
+
+// Runs 'op' for at least PERFTEST_MIN_TIME, and logs how many pixels per
+// second it wrote, 'pixels' for each call
+static void
+timeOp (const char *what, PerfOp op, PerfCase *pc, DWORD pixels)
+{
+	DWORD start, elapsed;
+	DWORD calls = 0;
+
+	op (pc);
+			// Once outside the timing, to get the caches made
+	start = GetTimeMicroseconds ();
+	do
+	{
+		op (pc);
+		++calls;
+		elapsed = GetTimeMicroseconds () - start;
+	} while (elapsed < PERFTEST_MIN_TIME);
+
+	log_add (log_Debug, "%-48s %8.1f Mpix/s (%lu calls)", what,
+			(double) pixels * calls / elapsed, (unsigned long) calls);
+}
+
+static TFB_Image *
+makeImage (int format, int size)
+{
+	TFB_Canvas canvas;
+	int x, y;
+
+	if (format == PERFTEST_PALETTED)
+	{
+		Color palette[256];
+		BYTE *data = HMalloc (size * size);
+
+		for (x = 0; x < 256; ++x)
+			palette[x] = BUILD_COLOR_RGBA (x, 255 - x, x / 2, 0xff);
+		// Index 0 is transparent, so about every 16th pixel is
+		for (y = 0; y < size; ++y)
+			for (x = 0; x < size; ++x)
+				data[y * size + x] = (BYTE) ((x * 7 + y * 13) & 0xff);
+
+		canvas = TFB_DrawCanvas_New_Paletted (size, size, palette, 0);
+		TFB_DrawCanvas_SetPixelIndexes (canvas, data, size, size);
+		HFree (data);
+	}
+	else
+	{
+		Color *pixels = HMalloc (size * size * sizeof (Color));
+
+		for (y = 0; y < size; ++y)
+		{
+			for (x = 0; x < size; ++x)
+			{
+				BYTE a = 0xff;
+				if (format == PERFTEST_ALPHA)
+					a = (BYTE) ((x + y) * 255 / (2 * size));
+				pixels[y * size + x] = BUILD_COLOR_RGBA ((BYTE) (x * 4),
+						(BYTE) (y * 4), (BYTE) ((x ^ y) * 4), a);
+			}
+		}
+
+		canvas = TFB_DrawCanvas_New_TrueColor (size, size,
+				format == PERFTEST_ALPHA);
+		TFB_DrawCanvas_SetPixelColors (canvas, pixels, size, size);
+		HFree (pixels);
+	}
+
+	// Converts the true color ones to screen format, as all images are
+	return TFB_DrawImage_New (canvas);
+}
+
+static TFB_Char *
+makeFontChar (int size)
+{
+	TFB_Char *fontChar = HCalloc (sizeof (TFB_Char));
+	int x, y;
+
+	fontChar->extent.width = size;
+	fontChar->extent.height = size;
+	fontChar->disp = fontChar->extent;
+	fontChar->pitch = size;
+	fontChar->data = HMalloc (size * size);
+	// Covered, half covered and empty pixels, as in antialiased glyphs
+	for (y = 0; y < size; ++y)
+		for (x = 0; x < size; ++x)
+			fontChar->data[y * size + x] =
+					(BYTE) (((x + y) % 4 == 0) ? 0xff : (x & 1) * 0x80);
+	return fontChar;
+}
+
+static void
+freeFontChar (TFB_Char *fontChar)
+{
+	HFree (fontChar->data);
+	HFree (fontChar);
+}
+
+static void
+perfImages (PerfCase *pc, int format)
+{
+	char what[80];
+	COUNT mode, scale;
+
+	for (mode = 0; mode < NUM_DRAW_MODES; ++mode)
+	{
+		pc->mode = MAKE_DRAW_MODE (drawModes[mode].kind,
+				drawModes[mode].factor);
+		for (scale = 0; scale < NUM_DRAW_SCALES; ++scale)
+		{
+			DWORD pixels;
+			int scaleMode;
+
+			pc->scale = drawScales[scale];
+			pixels = (DWORD) pc->size * pc->scale / GSCALE_IDENTITY;
+			pixels *= pixels;
+			for (scaleMode = TFB_SCALE_NEAREST;
+					scaleMode <= TFB_SCALE_BILINEAR; ++scaleMode)
+			{
+				pc->scaleMode = scaleMode;
+				if (pc->scale == GSCALE_IDENTITY
+						&& scaleMode != TFB_SCALE_NEAREST)
+					continue;
+						// The scale mode is not used unscaled
+
+				sprintf (what, "Image %s %d %s x%.2f%s", formatNames[format],
+						pc->size, drawModes[mode].name,
+						(double) pc->scale / GSCALE_IDENTITY,
+						scaleMode == TFB_SCALE_BILINEAR ? " bilinear" : "");
+				timeOp (what, perfImage, pc, pixels);
+
+				sprintf (what, "FilledImage %s %d %s x%.2f%s",
+						formatNames[format], pc->size, drawModes[mode].name,
+						(double) pc->scale / GSCALE_IDENTITY,
+						scaleMode == TFB_SCALE_BILINEAR ? " bilinear" : "");
+				timeOp (what, perfFilledImage, pc, pixels);
+			}
+		}
+	}
+}
+
+static void
+perfScaling (PerfCase *pc, int format)
+{
+	char what[80];
+	COUNT scale;
+	EXTENT size;
+
+	for (scale = 1; scale < NUM_DRAW_SCALES; ++scale)
+	{
+		DWORD pixels;
+
+		pc->scale = drawScales[scale];
+		pixels = (DWORD) pc->size * pc->scale / GSCALE_IDENTITY;
+		pixels *= pixels;
+
+		// The same targets TFB_DrawImage_FixScaling() scales into
+		pc->dst = TFB_DrawCanvas_New_ScaleTarget (pc->img->NormalImg, NULL,
+				TFB_SCALE_NEAREST, -1);
+		sprintf (what, "Rescale_Nearest %s %d x%.2f", formatNames[format],
+				pc->size, (double) pc->scale / GSCALE_IDENTITY);
+		timeOp (what, perfRescaleNearest, pc, pixels);
+		TFB_DrawCanvas_Delete (pc->dst);
+
+		pc->dst = TFB_DrawCanvas_New_ScaleTarget (pc->img->NormalImg, NULL,
+				TFB_SCALE_BILINEAR, -1);
+		sprintf (what, "Rescale_Bilinear %s %d x%.2f", formatNames[format],
+				pc->size, (double) pc->scale / GSCALE_IDENTITY);
+		timeOp (what, perfRescaleBilinear, pc, pixels);
+		TFB_DrawCanvas_Delete (pc->dst);
+		pc->dst = NULL;
+	}
+
+	pc->dst = TFB_DrawCanvas_New_RotationTarget (pc->img->NormalImg, 30);
+	TFB_DrawCanvas_GetRotatedExtent (pc->img->NormalImg, 30, &size);
+	sprintf (what, "Rotate %s %d 30 degrees", formatNames[format],
+			pc->size);
+	timeOp (what, perfRotate, pc, (DWORD) size.width * size.height);
+	TFB_DrawCanvas_Delete (pc->dst);
+	pc->dst = NULL;
+}
+
+static void
+perfPrimitives (PerfCase *pc)
+{
+	char what[80];
+	COUNT mode;
+
+	for (mode = 0; mode < NUM_DRAW_MODES; ++mode)
+	{
+		pc->mode = MAKE_DRAW_MODE (drawModes[mode].kind,
+				drawModes[mode].factor);
+
+		sprintf (what, "Rect %d %s", pc->size, drawModes[mode].name);
+		timeOp (what, perfRect, pc, (DWORD) pc->size * pc->size);
+
+		sprintf (what, "Line %d %s", pc->size, drawModes[mode].name);
+		timeOp (what, perfLine, pc, (DWORD) pc->size);
+
+		if (drawModes[mode].kind == DRAW_ADDITIVE)
+			continue;
+				// Text does not do additive
+		pc->fontChar = makeFontChar (pc->size);
+		pc->backing = TFB_DrawImage_CreateForScreen (pc->size, pc->size,
+				TRUE);
+		sprintf (what, "FontChar %d %s", pc->size, drawModes[mode].name);
+		timeOp (what, perfFontChar, pc, (DWORD) pc->size * pc->size);
+		TFB_DrawImage_Delete (pc->backing);
+		pc->backing = NULL;
+		freeFontChar (pc->fontChar);
+		pc->fontChar = NULL;
+	}
+}
+
+// Times the drawing operations of the canvas layer, for each source
+// format, image size, draw mode and scale, and logs the pixels written per
+// second. Everything is drawn to an offscreen canvas in screen format, so
+// this needs the graphics to be initialised, but does not show anything.
+// Drawing a scaled image blits the image's cached scaled copy; the
+// Rescale_* lines time making that copy.
+void
+Canvas_PerfTest (void)
+{
+	PerfCase pc;
+	int format;
+	COUNT size;
+
+	pc.target = TFB_DrawCanvas_New_ForScreen (PERFTEST_TARGET_SIZE,
+			PERFTEST_TARGET_SIZE, FALSE);
+	pc.img = NULL;
+	pc.fontChar = NULL;
+	pc.backing = NULL;
+	pc.dst = NULL;
+	pc.scale = GSCALE_IDENTITY;
+	pc.scaleMode = TFB_SCALE_NEAREST;
+	pc.color = BUILD_COLOR_RGBA (0x40, 0x80, 0xc0, 0xff);
+	pc.pos = 0;
+
+	log_add (log_Debug, "Canvas_PerfTest(): %dx%d screen format target",
+			PERFTEST_TARGET_SIZE, PERFTEST_TARGET_SIZE);
+
+	for (size = 0; size < NUM_IMAGE_SIZES; ++size)
+	{
+		pc.size = imageSizes[size];
+
+		perfPrimitives (&pc);
+
+		for (format = 0; format < PERFTEST_NUM_FORMATS; ++format)
+		{
+			pc.img = makeImage (format, pc.size);
+			perfImages (&pc, format);
+			perfScaling (&pc, format);
+			TFB_DrawImage_Delete (pc.img);
+			pc.img = NULL;
+		}
+	}
+
+	TFB_DrawCanvas_Delete (pc.target);
+}
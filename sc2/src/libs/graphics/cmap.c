@@ -17,6 +17,7 @@
  */
 
 #include "libs/graphics/cmap.h"
+#include "libs/graphics/gfx_common.h"
 #include "libs/threadlib.h"
 #include "libs/timelib.h"
 #include "libs/inplib.h"
@@ -35,6 +36,14 @@ typedef struct xform_control
 	DWORD StartTime;
 	DWORD EndTime;
 	Color OldCMap[NUMBER_OF_PLUTVALS];
+	Color NewCMap[NUMBER_OF_PLUTVALS];
+			// Decoded from CMapPtr when the transform starts
+	int Steps;
+			// The biggest change of any channel, but no more than Ticks.
+			// Each step changes every channel by one level at most, so
+			// making more maps than that would only repeat colors.
+	int LastStep;
+			// The step of the last map made; 0 is OldCMap
 } XFORM_CONTROL;
 
 #define MAX_XFORMS 16
@@ -370,6 +379,19 @@ GetFadeAmount (void)
 	return newAmount;
 }
 
+// Whether a fade is in progress, so GetFadeAmount() will change
+BOOLEAN
+FadePending (void)
+{
+	BOOLEAN pending;
+
+	LockMutex (fadeLock);
+	pending = fadeInterval != 0;
+	UnlockMutex (fadeLock);
+
+	return pending;
+}
+
 static void
 finishPendingFade (void)
 {
@@ -437,6 +459,9 @@ FadeScreen (ScreenFadeType fadeType, SIZE TimeInterval)
 
 	UnlockMutex (fadeLock);
 
+	// The renderer draws the fade without any commands being queued
+	TFB_WakeEventWait ();
+
 	return TimeOut;
 }
 
@@ -499,33 +524,37 @@ XFormColorMap_step (void)
 
 		if (TicksLeft > 0)
 		{
-#define XFORM_SCALE 0x10000
 			TFB_ColorMap *newmap = NULL;
-			UBYTE *newClr;
-			Color *oldClr;
-			int frac;
+			const Color *newClr;
+			const Color *oldClr;
+			int step;
 			int i;
 
+			step = (int)(control->Ticks - TicksLeft) * control->Steps
+					/ control->Ticks;
+			if (step == control->LastStep)
+			{	// Still the same colors; nothing to redraw
+				UnlockMutex (maplock);
+				continue;
+			}
+			control->LastStep = step;
+
 			newmap = clone_colormap (curmap, index);
 
 			oldClr = control->OldCMap;
-			newClr = (UBYTE*)control->CMapPtr + 2;
-
-			frac = (int)(control->Ticks - TicksLeft) * XFORM_SCALE
-					/ control->Ticks;
+			newClr = control->NewCMap;
 
-			for (i = 0; i < NUMBER_OF_PLUTVALS; ++i, ++oldClr,
-					newClr += PLUTVAL_BYTE_SIZE)
+			for (i = 0; i < NUMBER_OF_PLUTVALS; ++i, ++oldClr, ++newClr)
 			{
 				Color color;
 
 				color.a = 0xff;
-				color.r = blendChan (oldClr->r, newClr[PLUTVAL_RED],
-						frac, XFORM_SCALE);
-				color.g = blendChan (oldClr->g, newClr[PLUTVAL_GREEN],
-						frac, XFORM_SCALE);
-				color.b = blendChan (oldClr->b, newClr[PLUTVAL_BLUE],
-						frac, XFORM_SCALE);
+				color.r = blendChan (oldClr->r, newClr->r,
+						step, control->Steps);
+				color.g = blendChan (oldClr->g, newClr->g,
+						step, control->Steps);
+				color.b = blendChan (oldClr->b, newClr->b,
+						step, control->Steps);
 				SetNativePaletteColor (newmap->palette, i, color);
 			}
 
@@ -565,6 +594,48 @@ FlushPLUTXForms (void)
 	UnlockMutex (XFormControl.Lock);
 }
 
+static int
+channelDelta (BYTE c1, BYTE c2)
+{
+	return c1 > c2 ? c1 - c2 : c2 - c1;
+}
+
+// Fills in NewCMap and Steps, from OldCMap and CMapPtr
+static void
+prepare_colormap_xform (XFORM_CONTROL *control)
+{
+	const UBYTE *newClr = (const UBYTE*)control->CMapPtr + 2;
+	int maxDelta = 0;
+	int i;
+
+	for (i = 0; i < NUMBER_OF_PLUTVALS; ++i, newClr += PLUTVAL_BYTE_SIZE)
+	{
+		const Color *oldClr = &control->OldCMap[i];
+		Color *color = &control->NewCMap[i];
+		int delta;
+
+		color->a = 0xff;
+		color->r = newClr[PLUTVAL_RED];
+		color->g = newClr[PLUTVAL_GREEN];
+		color->b = newClr[PLUTVAL_BLUE];
+
+		delta = channelDelta (oldClr->r, color->r);
+		if (delta > maxDelta)
+			maxDelta = delta;
+		delta = channelDelta (oldClr->g, color->g);
+		if (delta > maxDelta)
+			maxDelta = delta;
+		delta = channelDelta (oldClr->b, color->b);
+		if (delta > maxDelta)
+			maxDelta = delta;
+	}
+
+	control->Steps = maxDelta;
+	if (control->Steps > control->Ticks)
+		control->Steps = control->Ticks;
+	control->LastStep = 0;
+}
+
 static DWORD
 XFormPLUT (COLORMAPPTR ColorMapPtr, SIZE TimeInterval)
 {
@@ -628,6 +699,7 @@ XFormPLUT (COLORMAPPTR ColorMapPtr, SIZE TimeInterval)
 		control->Ticks = 0; /* prevent negative fade */
 	control->StartTime = Now;
 	control->EndTime = EndTime = Now + control->Ticks;
+	prepare_colormap_xform (control);
 
 	UnlockMutex (XFormControl.Lock);
 
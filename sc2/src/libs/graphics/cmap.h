@@ -57,6 +57,7 @@ typedef struct tfb_colormap
 } TFB_ColorMap;
 
 extern int GetFadeAmount (void);
+extern BOOLEAN FadePending (void);
 
 extern void InitColorMaps (void);
 extern void UninitColorMaps (void);
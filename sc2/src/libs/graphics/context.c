@@ -75,6 +75,12 @@ SetContext (CONTEXT Context)
 	return (LastContext);
 }
 
+CONTEXT
+GetContext (void)
+{
+	return _pCurContext;
+}
+
 #ifdef DEBUG
 CONTEXT
 CreateContextAux (const char *name)
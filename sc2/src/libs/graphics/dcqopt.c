@@ -0,0 +1,406 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Peephole optimisation of a window of draw commands, run by
+// TFB_FlushGraphicsEx() before the commands are executed.
+// Every transformation here must leave the rendered result exactly
+// as it would have been without it:
+//  - commands whose output is completely overwritten by a later
+//    opaque Rect fill or screen Copy are dropped, as long as nothing
+//    in between reads the destination or changes the clip rect;
+//  - edge-adjacent Rect fills with the same colour and mode are merged;
+//  - runs of mutually non-overlapping Image blits to the same
+//    destination are regrouped by colormap, so consecutive blits
+//    share the palette setup in TFB_DrawCanvas_Image().
+
+#include "port.h"
+#include <string.h>
+#include "libs/graphics/drawcmd.h"
+#include "libs/graphics/dcqueue.h"
+#include "libs/graphics/cmap.h"
+#include "libs/graphics/gfx_common.h"
+#include "libs/threadlib.h"
+#include "libs/memlib.h"
+
+// How far ahead to look for a command that overdraws another one
+#define DCQ_OCCLUSION_LOOKAHEAD 64
+
+TFB_DrawCommandStats DCQ_FrameStats;
+
+static inline BOOLEAN
+rectContains (const RECT *outer, const RECT *inner)
+{
+	return inner->corner.x >= outer->corner.x
+			&& inner->corner.y >= outer->corner.y
+			&& inner->corner.x + inner->extent.width <=
+				outer->corner.x + outer->extent.width
+			&& inner->corner.y + inner->extent.height <=
+				outer->corner.y + outer->extent.height;
+}
+
+static inline BOOLEAN
+rectsOverlap (const RECT *r1, const RECT *r2)
+{
+	return r1->corner.x < r2->corner.x + r2->extent.width
+			&& r2->corner.x < r1->corner.x + r1->extent.width
+			&& r1->corner.y < r2->corner.y + r2->extent.height
+			&& r2->corner.y < r1->corner.y + r1->extent.height;
+}
+
+static BOOLEAN
+imageRect (TFB_Image *img, int x, int y, int scale, RECT *r)
+{
+	EXTENT size;
+
+	if (!img || (scale != 0 && scale != GSCALE_IDENTITY))
+		return FALSE;
+
+	LockMutex (img->mutex);
+	TFB_DrawCanvas_GetExtent (img->NormalImg, &size);
+	r->corner.x = x - img->NormalHs.x;
+	r->corner.y = y - img->NormalHs.y;
+	UnlockMutex (img->mutex);
+	r->extent = size;
+	return TRUE;
+}
+
+// Get the rectangle that a command may modify in its destination
+// buffer. Returns FALSE if the command does not draw to a screen, or
+// if its extent cannot be cheaply determined.
+static BOOLEAN
+getDestRect (const TFB_DrawCommand *dc, SCREEN *dest, RECT *r)
+{
+	switch (dc->Type)
+	{
+		case TFB_DRAWCOMMANDTYPE_LINE:
+		{
+			const TFB_DrawCommand_Line *cmd = &dc->data.line;
+			int x1 = cmd->x1 < cmd->x2 ? cmd->x1 : cmd->x2;
+			int x2 = cmd->x1 < cmd->x2 ? cmd->x2 : cmd->x1;
+			int y1 = cmd->y1 < cmd->y2 ? cmd->y1 : cmd->y2;
+			int y2 = cmd->y1 < cmd->y2 ? cmd->y2 : cmd->y1;
+			r->corner.x = x1;
+			r->corner.y = y1;
+			r->extent.width = x2 - x1 + 1;
+			r->extent.height = y2 - y1 + 1;
+			*dest = cmd->destBuffer;
+			return TRUE;
+		}
+		case TFB_DRAWCOMMANDTYPE_RECTANGLE:
+			*r = dc->data.rect.rect;
+			*dest = dc->data.rect.destBuffer;
+			return TRUE;
+		case TFB_DRAWCOMMANDTYPE_IMAGE:
+		{
+			const TFB_DrawCommand_Image *cmd = &dc->data.image;
+			*dest = cmd->destBuffer;
+			return imageRect (cmd->image, cmd->x, cmd->y, cmd->scale, r);
+		}
+		case TFB_DRAWCOMMANDTYPE_FILLEDIMAGE:
+		{
+			const TFB_DrawCommand_FilledImage *cmd = &dc->data.filledimage;
+			*dest = cmd->destBuffer;
+			return imageRect (cmd->image, cmd->x, cmd->y, cmd->scale, r);
+		}
+		case TFB_DRAWCOMMANDTYPE_FONTCHAR:
+		{
+			const TFB_DrawCommand_FontChar *cmd = &dc->data.fontchar;
+			r->corner.x = cmd->x - cmd->fontchar->HotSpot.x;
+			r->corner.y = cmd->y - cmd->fontchar->HotSpot.y;
+			r->extent = cmd->fontchar->extent;
+			*dest = cmd->destBuffer;
+			return TRUE;
+		}
+		case TFB_DRAWCOMMANDTYPE_TEXTRUN:
+			*r = dc->data.textrun.bounds;
+			*dest = dc->data.textrun.destBuffer;
+			return TRUE;
+		case TFB_DRAWCOMMANDTYPE_COPY:
+			*r = dc->data.copy.rect;
+			*dest = dc->data.copy.destBuffer;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+// Does the command completely replace the pixels in its rectangle?
+static BOOLEAN
+isOpaqueCover (const TFB_DrawCommand *dc, SCREEN *dest, RECT *r)
+{
+	if (dc->Type == TFB_DRAWCOMMANDTYPE_RECTANGLE)
+	{
+		const TFB_DrawCommand_Rect *cmd = &dc->data.rect;
+		if (cmd->drawMode.kind != DRAW_REPLACE || cmd->color.a != 0xff)
+			return FALSE;
+		*r = cmd->rect;
+		*dest = cmd->destBuffer;
+		return TRUE;
+	}
+	if (dc->Type == TFB_DRAWCOMMANDTYPE_COPY)
+	{
+		const TFB_DrawCommand_Copy *cmd = &dc->data.copy;
+		if (cmd->srcBuffer == cmd->destBuffer)
+			return FALSE;
+		*r = cmd->rect;
+		*dest = cmd->destBuffer;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+// May pixels drawn to 'dest' before this command be observed by it?
+// Anything that reads the screen, changes the clip rect, or has side
+// effects visible outside the DCQ acts as a barrier, and keeps
+// earlier commands from being dropped.
+static BOOLEAN
+isBarrier (const TFB_DrawCommand *dc, SCREEN dest)
+{
+	switch (dc->Type)
+	{
+		case TFB_DRAWCOMMANDTYPE_COPY:
+			return dc->data.copy.srcBuffer == dest;
+		case TFB_DRAWCOMMANDTYPE_COPYTOIMAGE:
+			return dc->data.copytoimage.srcBuffer == dest;
+		case TFB_DRAWCOMMANDTYPE_SCISSORENABLE:
+		case TFB_DRAWCOMMANDTYPE_SCISSORDISABLE:
+			// The clip rect only applies to the main screen
+			return dest == TFB_SCREEN_MAIN;
+		case TFB_DRAWCOMMANDTYPE_SENDSIGNAL:
+		case TFB_DRAWCOMMANDTYPE_REINITVIDEO:
+		case TFB_DRAWCOMMANDTYPE_CALLBACK:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static BOOLEAN
+isOverdrawn (const TFB_DrawCommand *cmds, int index, int count)
+{
+	SCREEN dest;
+	RECT r;
+	int i, end;
+
+	if (!getDestRect (&cmds[index], &dest, &r))
+		return FALSE;
+
+	end = index + 1 + DCQ_OCCLUSION_LOOKAHEAD;
+	if (end > count)
+		end = count;
+
+	for (i = index + 1; i < end; ++i)
+	{
+		SCREEN coverDest;
+		RECT cover;
+
+		if (isBarrier (&cmds[i], dest))
+			return FALSE;
+		if (isOpaqueCover (&cmds[i], &coverDest, &cover)
+				&& coverDest == dest && rectContains (&cover, &r))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+dropCommand (TFB_DrawCommand *dc)
+{
+	// The colormap was addrefed for us when the command was queued;
+	// normally TFB_DrawCanvas_Image() releases it.
+	if (dc->Type == TFB_DRAWCOMMANDTYPE_IMAGE && dc->data.image.colormap)
+		TFB_ReturnColorMap (dc->data.image.colormap);
+	else if (dc->Type == TFB_DRAWCOMMANDTYPE_TEXTRUN)
+		HFree (dc->data.textrun.glyphs);
+}
+
+// Try to merge rect fill 'next' into 'prev'. They must be drawn
+// identically and share a full edge, so they never overlap.
+static BOOLEAN
+mergeRects (TFB_DrawCommand_Rect *prev, const TFB_DrawCommand_Rect *next)
+{
+	RECT *a = &prev->rect;
+	const RECT *b = &next->rect;
+
+	if (prev->destBuffer != next->destBuffer
+			|| !sameColor (prev->color, next->color)
+			|| prev->drawMode.kind != next->drawMode.kind
+			|| prev->drawMode.factor != next->drawMode.factor)
+		return FALSE;
+
+	if (a->corner.x == b->corner.x && a->extent.width == b->extent.width)
+	{
+		if (a->corner.y + a->extent.height == b->corner.y)
+		{
+			a->extent.height += b->extent.height;
+			return TRUE;
+		}
+		if (b->corner.y + b->extent.height == a->corner.y)
+		{
+			a->corner.y = b->corner.y;
+			a->extent.height += b->extent.height;
+			return TRUE;
+		}
+	}
+	else if (a->corner.y == b->corner.y
+			&& a->extent.height == b->extent.height)
+	{
+		if (a->corner.x + a->extent.width == b->corner.x)
+		{
+			a->extent.width += b->extent.width;
+			return TRUE;
+		}
+		if (b->corner.x + b->extent.width == a->corner.x)
+		{
+			a->corner.x = b->corner.x;
+			a->extent.width += b->extent.width;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+// Stable-sort a run of Image blits by colormap. Only called when no
+// two blits in the run overlap, so their order does not matter.
+static int
+groupImageRun (TFB_DrawCommand *cmds, int count)
+{
+	int moved = 0;
+	int i, j;
+
+	// Insertion sort: runs are short and usually nearly grouped
+	// already.  Group key is the colormap pointer; all that matters
+	// is that equal keys end up adjacent.
+	for (i = 1; i < count; ++i)
+	{
+		TFB_DrawCommand dc = cmds[i];
+		TFB_ColorMap *cmap = dc.data.image.colormap;
+
+		// Find the last earlier blit with the same colormap
+		for (j = i - 1; j >= 0; --j)
+		{
+			if (cmds[j].data.image.colormap == cmap)
+				break;
+		}
+		if (j < 0 || j == i - 1)
+			continue;
+
+		memmove (&cmds[j + 2], &cmds[j + 1],
+				(i - j - 1) * sizeof (cmds[0]));
+		cmds[j + 1] = dc;
+		++moved;
+	}
+	return moved;
+}
+
+static void
+groupImages (TFB_DrawCommand *cmds, int count)
+{
+	int start = 0;
+
+	while (start < count)
+	{
+		int end;
+		SCREEN dest;
+		RECT rects[DCQ_OCCLUSION_LOOKAHEAD];
+		BOOLEAN disjoint = TRUE;
+		int i, j;
+
+		if (cmds[start].Type != TFB_DRAWCOMMANDTYPE_IMAGE
+				|| !getDestRect (&cmds[start], &dest, &rects[0]))
+		{
+			++start;
+			continue;
+		}
+
+		for (end = start + 1; end < count
+				&& end - start < DCQ_OCCLUSION_LOOKAHEAD; ++end)
+		{
+			SCREEN d;
+			if (cmds[end].Type != TFB_DRAWCOMMANDTYPE_IMAGE
+					|| !getDestRect (&cmds[end], &d, &rects[end - start])
+					|| d != dest)
+				break;
+		}
+
+		for (i = 0; disjoint && i < end - start; ++i)
+		{
+			for (j = i + 1; j < end - start; ++j)
+			{
+				if (rectsOverlap (&rects[i], &rects[j]))
+				{
+					disjoint = FALSE;
+					break;
+				}
+			}
+		}
+
+		if (disjoint && end - start > 2)
+			DCQ_FrameStats.regrouped +=
+					groupImageRun (&cmds[start], end - start);
+
+		start = end;
+	}
+}
+
+int
+TFB_OptimizeDrawCommands (TFB_DrawCommand *cmds, int count)
+{
+	int i, out;
+
+	DCQ_FrameStats.processed += count;
+
+	// Pass 1: drop overdrawn commands and merge adjacent rect fills,
+	// compacting the array as we go.
+	out = 0;
+	for (i = 0; i < count; ++i)
+	{
+		TFB_DrawCommand *dc = &cmds[i];
+
+		if (isOverdrawn (cmds, i, count))
+		{
+			dropCommand (dc);
+			++DCQ_FrameStats.overdrawn;
+			continue;
+		}
+
+		if (dc->Type == TFB_DRAWCOMMANDTYPE_RECTANGLE && out > 0
+				&& cmds[out - 1].Type == TFB_DRAWCOMMANDTYPE_RECTANGLE
+				&& mergeRects (&cmds[out - 1].data.rect, &dc->data.rect))
+		{
+			++DCQ_FrameStats.merged;
+			continue;
+		}
+
+		if (out != i)
+			cmds[out] = *dc;
+		++out;
+	}
+
+	// Pass 2: regroup independent Image blits by colormap
+	groupImages (cmds, out);
+
+	return out;
+}
+
+void
+TFB_ResetDrawCommandStats (void)
+{
+	DCQ_FrameStats.processed = 0;
+	DCQ_FrameStats.overdrawn = 0;
+	DCQ_FrameStats.merged = 0;
+	DCQ_FrameStats.regrouped = 0;
+}
@@ -22,33 +22,52 @@
 #include "libs/graphics/dcqueue.h"
 #include "libs/graphics/gfx_common.h"
 #include "libs/graphics/bbox.h"
+#include "libs/graphics/cmap.h"
 #include "libs/timelib.h"
+#include "libs/time/profile.h"
 #include "libs/log.h"
 #include "libs/misc.h"
 		// for TFB_DEBUG_HALT
 
 
+// The DCQ is a bounded multi-producer, single-consumer ring.
+// A producer reserves slots by atomically advancing InsertionPoint,
+// copies the command in, and then publishes the slot by storing the
+// slot's ticket number (plus one) in DCQ_Seq.  The renderer only
+// reads a slot once it has been published, so it never has to wait
+// for a producer that is still in the middle of writing one.
+//
+// DCQ_Mutex is no longer taken for every command.  It is only used by
+// Lock_DCQ() to keep producers out (livelock deterrence, and callers
+// that need several commands to go in together); while the queue is
+// locked, producers take the mutex before pushing.
+
 static RecursiveMutex DCQ_Mutex;
 
 CondVar RenderingCond;
 
 TFB_DrawCommand DCQ[DCQ_MAX];
+static AtomicU32 DCQ_Seq[DCQ_MAX];
 
 TFB_DrawCommandQueue DrawCommandQueue;
 
 #define FPS_PERIOD  (ONE_SECOND / 100)
+#define DCQ_IDLE_WAIT_MS 100
+		// The longest the renderer sleeps with nothing to draw, so that
+		// thread lifecycles and quitting are still looked at
 int RenderedFrames = 0;
 
+TFB_DrawCommandStats DCQ_LastFrameStats;
+
 
-// Wait for the queue to be emptied.
+// Wait for the renderer to make room in the queue.
 static void
 TFB_WaitForSpace (int requested_slots)
 {
 	int old_depth, i;
 	log_add (log_Debug, "DCQ overload (Size = %d, FullSize = %d, "
 			"Requested = %d).  Sleeping until renderer is done.",
-			DrawCommandQueue.Size, DrawCommandQueue.FullSize,
-			requested_slots);
+			DCQ_SIZE (), DCQ_FULLSIZE (), requested_slots);
 	// Restore the DCQ locking level.  I *think* this is
 	// always 1, but...
 	TFB_BatchReset ();
@@ -59,14 +78,15 @@ TFB_WaitForSpace (int requested_slots)
 	for (i = 0; i < old_depth; i++)
 		LockRecursiveMutex (DCQ_Mutex);
 	log_add (log_Debug, "DCQ clear (Size = %d, FullSize = %d).  Continuing.",
-			DrawCommandQueue.Size, DrawCommandQueue.FullSize);
+			DCQ_SIZE (), DCQ_FULLSIZE ());
 }
 
 void
 Lock_DCQ (int slots)
 {
 	LockRecursiveMutex (DCQ_Mutex);
-	while (DrawCommandQueue.FullSize >= DCQ_MAX - slots)
+	AtomicAdd (&DrawCommandQueue.Locked, 1);
+	while (DCQ_FULLSIZE () >= DCQ_MAX - slots)
 	{
 		TFB_WaitForSpace (slots);
 	}
@@ -75,48 +95,86 @@ Lock_DCQ (int slots)
 void
 Unlock_DCQ (void)
 {
+	AtomicAdd (&DrawCommandQueue.Locked, (uint32) -1);
 	UnlockRecursiveMutex (DCQ_Mutex);
 }
 
-// Always have the DCQ locked when calling this.
+// Make all the commands inserted so far visible to the renderer,
+// unless we are batching.  Back only ever moves forward.
 static void
 Synchronize_DCQ (void)
 {
-	if (!DrawCommandQueue.Batching)
+	uint32 back;
+	uint32 insertion;
+
+	if (AtomicLoad (&DrawCommandQueue.Batching))
+		return;
+
+	insertion = AtomicLoad (&DrawCommandQueue.InsertionPoint);
+	do
 	{
-		int front = DrawCommandQueue.Front;
-		int back  = DrawCommandQueue.InsertionPoint;
-		DrawCommandQueue.Back = DrawCommandQueue.InsertionPoint;
-		if (front <= back)
-		{
-			DrawCommandQueue.Size = (back - front);
-		}
-		else
-		{
-			DrawCommandQueue.Size = (back + DCQ_MAX - front);
-		}
-		DrawCommandQueue.FullSize = DrawCommandQueue.Size;
-	}
+		back = AtomicLoad (&DrawCommandQueue.Back);
+		if ((sint32) (insertion - back) <= 0)
+			return;
+	} while (!AtomicCompareExchange (&DrawCommandQueue.Back,
+			back, insertion));
+
+	// The renderer may be waiting for something to do
+	TFB_WakeEventWait ();
 }
 
 void
 TFB_BatchGraphics (void)
 {
-	LockRecursiveMutex (DCQ_Mutex);
-	DrawCommandQueue.Batching++;
-	UnlockRecursiveMutex (DCQ_Mutex);
+	AtomicAdd (&DrawCommandQueue.Batching, 1);
+}
+
+// The drawing threads may run one frame ahead of the renderer: when a
+// batch is finished while the renderer has not yet taken the one before
+// it off the queue, the drawing thread waits. That way, the renderer has
+// the next frame ready when it is done with this one, but what is shown
+// is never more than one frame behind what the game has drawn.
+static void
+TFB_WaitForLastFrame (uint32 frameEnd)
+{
+#ifndef RUST_OWNS_MAIN
+	if (!GetMyThreadLocal ())
+		return; // The renderer itself, which does not wait for itself
+
+	while ((sint32) (frameEnd - AtomicLoad (&DrawCommandQueue.Front)) > 0
+			&& !AtomicLoad (&DrawCommandQueue.Locked))
+	{
+		WaitCondVar (RenderingCond);
+	}
+#else
+	(void) frameEnd;
+			// There is no separate renderer to wait for
+#endif
 }
 
 void
 TFB_UnbatchGraphics (void)
 {	
-	LockRecursiveMutex (DCQ_Mutex);
-	if (DrawCommandQueue.Batching)
+	static AtomicU32 lastFrameEnd;
+			// Where the last finished batch ends in the queue
+	uint32 batching;
+	uint32 frameEnd;
+
+	do
 	{
-		DrawCommandQueue.Batching--;
-	}
+		batching = AtomicLoad (&DrawCommandQueue.Batching);
+		if (batching == 0)
+			break;
+	} while (!AtomicCompareExchange (&DrawCommandQueue.Batching,
+			batching, batching - 1));
 	Synchronize_DCQ ();
-	UnlockRecursiveMutex (DCQ_Mutex);
+
+	if (batching != 1)
+		return; // Not the end of a batch
+
+	frameEnd = AtomicLoad (&lastFrameEnd);
+	AtomicStore (&lastFrameEnd, AtomicLoad (&DrawCommandQueue.Back));
+	TFB_WaitForLastFrame (frameEnd);
 }
 
 // Cancel all pending batch operations, making them unbatched.  This will
@@ -125,10 +183,8 @@ TFB_UnbatchGraphics (void)
 void
 TFB_BatchReset (void)
 {
-	LockRecursiveMutex (DCQ_Mutex);
-	DrawCommandQueue.Batching = 0;
+	AtomicStore (&DrawCommandQueue.Batching, 0);
 	Synchronize_DCQ ();
-	UnlockRecursiveMutex (DCQ_Mutex);
 }
 
 
@@ -137,12 +193,15 @@ TFB_BatchReset (void)
 void
 Init_DrawCommandQueue (void)
 {
-	DrawCommandQueue.Back = 0;
-	DrawCommandQueue.Front = 0;
-	DrawCommandQueue.InsertionPoint = 0;
-	DrawCommandQueue.Batching = 0;
-	DrawCommandQueue.FullSize = 0;
-	DrawCommandQueue.Size = 0;
+	int i;
+
+	AtomicStore (&DrawCommandQueue.Back, 0);
+	AtomicStore (&DrawCommandQueue.Front, 0);
+	AtomicStore (&DrawCommandQueue.InsertionPoint, 0);
+	AtomicStore (&DrawCommandQueue.Batching, 0);
+	AtomicStore (&DrawCommandQueue.Locked, 0);
+	for (i = 0; i < DCQ_MAX; i++)
+		AtomicStore (&DCQ_Seq[i], 0);
 
 	TFB_BBox_Init (ScreenWidth, ScreenHeight);
 
@@ -167,62 +226,86 @@ Uninit_DrawCommandQueue (void)
 		DestroyRecursiveMutex (DCQ_Mutex);
 		DCQ_Mutex = 0;
 	}
+
+	TFB_BBox_Uninit ();
+}
+
+// Insert 'count' commands into consecutive slots, so that no other
+// producer's commands can end up between them.
+static void
+DCQ_PushCommands (const TFB_DrawCommand *commands, int count)
+{
+	uint32 ticket;
+	BOOLEAN locked;
+	int i;
+
+	// Slow path: somebody holds Lock_DCQ(). This is a soft barrier;
+	// a producer that got past this check just before the lock was
+	// taken may still add its commands, which is harmless.
+	locked = AtomicLoad (&DrawCommandQueue.Locked) != 0;
+	if (locked)
+		LockRecursiveMutex (DCQ_Mutex);
+
+	ticket = AtomicAdd (&DrawCommandQueue.InsertionPoint, (uint32) count);
+
+	for (i = 0; i < count; i++, ticket++)
+	{
+		uint32 slot = ticket & DCQ_MASK;
+
+		// Wait until the renderer has consumed the command that
+		// previously occupied this slot.
+		while (ticket - AtomicLoad (&DrawCommandQueue.Front) >= DCQ_MAX)
+			TFB_WaitForSpace (count - i);
+
+		DCQ[slot] = commands[i];
+		AtomicStore (&DCQ_Seq[slot], ticket + 1);
+	}
+
+	Synchronize_DCQ ();
+
+	if (locked)
+		UnlockRecursiveMutex (DCQ_Mutex);
 }
 
 void
 TFB_DrawCommandQueue_Push (TFB_DrawCommand* Command)
 {
-	Lock_DCQ (1);
-	DCQ[DrawCommandQueue.InsertionPoint] = *Command;
-	DrawCommandQueue.InsertionPoint = (DrawCommandQueue.InsertionPoint + 1)
-			% DCQ_MAX;
-	DrawCommandQueue.FullSize++;
-	Synchronize_DCQ ();
-	Unlock_DCQ ();
+	DCQ_PushCommands (Command, 1);
 }
 
+// Only call from the rendering thread.
 int
 TFB_DrawCommandQueue_Pop (TFB_DrawCommand *target)
 {
-	LockRecursiveMutex (DCQ_Mutex);
+	uint32 front = AtomicLoad (&DrawCommandQueue.Front);
+	uint32 slot = front & DCQ_MASK;
 
-	if (DrawCommandQueue.Size == 0)
-	{
-		Unlock_DCQ ();
+	if (front == AtomicLoad (&DrawCommandQueue.Back))
 		return (0);
-	}
 
-	if (DrawCommandQueue.Front == DrawCommandQueue.Back &&
-			DrawCommandQueue.Size != DCQ_MAX)
-	{
-		log_add (log_Debug, "Augh!  Assertion failure in DCQ!  "
-				"Front == Back, Size != DCQ_MAX");
-		DrawCommandQueue.Size = 0;
-		Unlock_DCQ ();
+	// The slot is reserved but its producer has not finished writing
+	// it yet. Leave it, and everything after it, for the next flush.
+	if (AtomicLoad (&DCQ_Seq[slot]) != front + 1)
 		return (0);
-	}
-
-	*target = DCQ[DrawCommandQueue.Front];
-	DrawCommandQueue.Front = (DrawCommandQueue.Front + 1) % DCQ_MAX;
 
-	DrawCommandQueue.Size--;
-	DrawCommandQueue.FullSize--;
-	UnlockRecursiveMutex (DCQ_Mutex);
+	*target = DCQ[slot];
+	AtomicStore (&DrawCommandQueue.Front, front + 1);
 
 	return 1;
 }
 
+// Drop all the commands that are currently visible to the renderer.
+// Commands that are still batched are kept.
 void
 TFB_DrawCommandQueue_Clear ()
 {
-	LockRecursiveMutex (DCQ_Mutex);
-	DrawCommandQueue.Size = 0;
-	DrawCommandQueue.Front = 0;
-	DrawCommandQueue.Back = 0;
-	DrawCommandQueue.Batching = 0;
-	DrawCommandQueue.FullSize = 0;
-	DrawCommandQueue.InsertionPoint = 0;
-	UnlockRecursiveMutex (DCQ_Mutex);
+	TFB_DrawCommand DC;
+
+	Lock_DCQ (-1);
+	while (TFB_DrawCommandQueue_Pop (&DC))
+		;
+	AtomicStore (&DrawCommandQueue.Batching, 0);
+	Unlock_DCQ ();
 }
 
 static void
@@ -252,6 +335,9 @@ checkExclusiveThread (TFB_DrawCommand* DrawCommand)
 void
 TFB_EnqueueDrawCommand (TFB_DrawCommand* DrawCommand)
 {
+	TFB_DrawCommand DC[2];
+	int count = 0;
+
 	if (TFB_DEBUG_HALT)
 	{
 		return;
@@ -270,8 +356,6 @@ TFB_EnqueueDrawCommand (TFB_DrawCommand* DrawCommand)
 				|| (!_pCurContext && scissor_rect.extent.width != 0))
 		{
 			// Enqueue command to set the glScissor spec
-			TFB_DrawCommand DC;
-
 			if (_pCurContext)
 				scissor_rect = _pCurContext->ClipRect;
 			else
@@ -279,19 +363,21 @@ TFB_EnqueueDrawCommand (TFB_DrawCommand* DrawCommand)
 
 			if (scissor_rect.extent.width)
 			{
-				DC.Type = TFB_DRAWCOMMANDTYPE_SCISSORENABLE;
-				DC.data.scissor.rect = scissor_rect;
+				DC[count].Type = TFB_DRAWCOMMANDTYPE_SCISSORENABLE;
+				DC[count].data.scissor.rect = scissor_rect;
 			}
 			else
 			{
-				DC.Type = TFB_DRAWCOMMANDTYPE_SCISSORDISABLE;
+				DC[count].Type = TFB_DRAWCOMMANDTYPE_SCISSORDISABLE;
 			}
-				
-			TFB_EnqueueDrawCommand(&DC);
+			++count;
 		}
 	}
 
-	TFB_DrawCommandQueue_Push (DrawCommand);
+	// The scissor command and the command it applies to are pushed
+	// into adjacent slots.
+	DC[count++] = *DrawCommand;
+	DCQ_PushCommands (DC, count);
 }
 
 static void
@@ -312,12 +398,257 @@ computeFPS (void)
 		log_add (log_User, "fps %.2f, effective %.2f",
 				(float)ONE_SECOND / delta_time,
 				(float)ONE_SECOND * RenderedFrames / fps_counter);
+		log_add (log_User, "dcq %d commands, %d overdrawn, %d merged, "
+				"%d regrouped", DCQ_LastFrameStats.processed,
+				DCQ_LastFrameStats.overdrawn, DCQ_LastFrameStats.merged,
+				DCQ_LastFrameStats.regrouped);
 
 		fps_counter = 0;
 		RenderedFrames = 0;
 	}
 }
 
+// Execute one draw command against the screen canvases
+static void
+TFB_ExecuteDrawCommand (TFB_DrawCommand *DC)
+{
+	switch (DC->Type)
+	{
+		case TFB_DRAWCOMMANDTYPE_SETMIPMAP:
+		{
+			TFB_DrawCommand_SetMipmap *cmd = &DC->data.setmipmap;
+			TFB_DrawImage_SetMipmap (cmd->image, cmd->mipmap,
+					cmd->hotx, cmd->hoty);
+			break;
+		}
+
+		case TFB_DRAWCOMMANDTYPE_IMAGE:
+		{
+			TFB_DrawCommand_Image *cmd = &DC->data.image;
+			TFB_Image *DC_image = cmd->image;
+			const int x = cmd->x;
+			const int y = cmd->y;
+
+			TFB_DrawCanvas_Image (DC_image, x, y,
+					cmd->scale, cmd->scaleMode, cmd->colormap,
+					cmd->drawMode,
+					TFB_GetScreenCanvas (cmd->destBuffer));
+
+			if (cmd->destBuffer == TFB_SCREEN_MAIN)
+			{
+				LockMutex (DC_image->mutex);
+				if (cmd->scale)
+					TFB_BBox_RegisterCanvas (DC_image->ScaledImg,
+							x - DC_image->last_scale_hs.x,
+							y - DC_image->last_scale_hs.y);
+				else
+					TFB_BBox_RegisterCanvas (DC_image->NormalImg,
+							x - DC_image->NormalHs.x,
+							y - DC_image->NormalHs.y);
+				UnlockMutex (DC_image->mutex);
+			}
+
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_FILLEDIMAGE:
+		{
+			TFB_DrawCommand_FilledImage *cmd = &DC->data.filledimage;
+			TFB_Image *DC_image = cmd->image;
+			const int x = cmd->x;
+			const int y = cmd->y;
+
+			TFB_DrawCanvas_FilledImage (DC_image, x, y,
+					cmd->scale, cmd->scaleMode, cmd->color,
+					cmd->drawMode,
+					TFB_GetScreenCanvas (cmd->destBuffer));
+
+			if (cmd->destBuffer == TFB_SCREEN_MAIN)
+			{
+				LockMutex (DC_image->mutex);
+				if (cmd->scale)
+					TFB_BBox_RegisterCanvas (DC_image->ScaledImg,
+							x - DC_image->last_scale_hs.x,
+							y - DC_image->last_scale_hs.y);
+				else
+					TFB_BBox_RegisterCanvas (DC_image->NormalImg,
+							x - DC_image->NormalHs.x,
+							y - DC_image->NormalHs.y);
+				UnlockMutex (DC_image->mutex);
+			}
+
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_FONTCHAR:
+		{
+			TFB_DrawCommand_FontChar *cmd = &DC->data.fontchar;
+			TFB_Char *DC_char = cmd->fontchar;
+			const int x = cmd->x;
+			const int y = cmd->y;
+
+			TFB_DrawCanvas_FontChar (DC_char, cmd->backing, x, y,
+					cmd->drawMode, TFB_GetScreenCanvas (cmd->destBuffer));
+
+			if (cmd->destBuffer == TFB_SCREEN_MAIN)
+			{
+				RECT r;
+				
+				r.corner.x = x - DC_char->HotSpot.x;
+				r.corner.y = y - DC_char->HotSpot.y;
+				r.extent.width = DC_char->extent.width;
+				r.extent.height = DC_char->extent.height;
+
+				TFB_BBox_RegisterRect (&r);
+			}
+
+			break;
+		}
+
+		case TFB_DRAWCOMMANDTYPE_TEXTRUN:
+		{
+			TFB_DrawCommand_TextRun *cmd = &DC->data.textrun;
+
+			TFB_DrawCanvas_TextRun (cmd->glyphs, cmd->count, cmd->backing,
+					cmd->drawMode, TFB_GetScreenCanvas (cmd->destBuffer));
+
+			if (cmd->destBuffer == TFB_SCREEN_MAIN)
+				TFB_BBox_RegisterRect (&cmd->bounds);
+
+			HFree (cmd->glyphs);
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_LINE:
+		{
+			TFB_DrawCommand_Line *cmd = &DC->data.line;
+
+			if (cmd->destBuffer == TFB_SCREEN_MAIN)
+			{
+				TFB_BBox_RegisterPoint (cmd->x1, cmd->y1);
+				TFB_BBox_RegisterPoint (cmd->x2, cmd->y2);
+			}
+			TFB_DrawCanvas_Line (cmd->x1, cmd->y1, cmd->x2, cmd->y2,
+					cmd->color, cmd->drawMode,
+					TFB_GetScreenCanvas (cmd->destBuffer));
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_RECTANGLE:
+		{
+			TFB_DrawCommand_Rect *cmd = &DC->data.rect;
+
+			if (cmd->destBuffer == TFB_SCREEN_MAIN)
+				TFB_BBox_RegisterRect (&cmd->rect);
+			TFB_DrawCanvas_Rect (&cmd->rect, cmd->color, cmd->drawMode,
+					TFB_GetScreenCanvas (cmd->destBuffer));
+
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_SCISSORENABLE:
+		{
+			TFB_DrawCommand_Scissor *cmd = &DC->data.scissor;
+
+			TFB_DrawCanvas_SetClipRect (
+					TFB_GetScreenCanvas (TFB_SCREEN_MAIN), &cmd->rect);
+			TFB_BBox_SetClipRect (&DC->data.scissor.rect);
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_SCISSORDISABLE:
+			TFB_DrawCanvas_SetClipRect (
+					TFB_GetScreenCanvas (TFB_SCREEN_MAIN), NULL);
+			TFB_BBox_SetClipRect (NULL);
+			break;
+		
+		case TFB_DRAWCOMMANDTYPE_COPYTOIMAGE:
+		{
+			TFB_DrawCommand_CopyToImage *cmd = &DC->data.copytoimage;
+			TFB_Image *DC_image = cmd->image;
+			const POINT dstPt = {0, 0};
+
+			if (DC_image == 0)
+			{
+				log_add (log_Debug, "DCQ ERROR: COPYTOIMAGE passed null "
+						"image ptr");
+				break;
+			}
+			LockMutex (DC_image->mutex);
+			TFB_DrawCanvas_CopyRect (
+					TFB_GetScreenCanvas (cmd->srcBuffer), &cmd->rect,
+					DC_image->NormalImg, dstPt);
+			++DC_image->version;
+			UnlockMutex (DC_image->mutex);
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_COPY:
+		{
+			TFB_DrawCommand_Copy *cmd = &DC->data.copy;
+			const RECT r = cmd->rect;
+
+			if (cmd->destBuffer == TFB_SCREEN_MAIN)
+				TFB_BBox_RegisterRect (&cmd->rect);
+
+			TFB_DrawCanvas_CopyRect	(
+					TFB_GetScreenCanvas (cmd->srcBuffer), &r,
+					TFB_GetScreenCanvas (cmd->destBuffer), r.corner);
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_DELETEIMAGE:
+		{
+			TFB_Image *DC_image = DC->data.deleteimage.image;
+			TFB_DrawImage_Delete (DC_image);
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_DELETEDATA:
+		{
+			void *data = DC->data.deletedata.data;
+			HFree (data);
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_SENDSIGNAL:
+			ClearSemaphore (DC->data.sendsignal.sem);
+			break;
+		
+		case TFB_DRAWCOMMANDTYPE_REINITVIDEO:
+		{
+			TFB_DrawCommand_ReinitVideo *cmd = &DC->data.reinitvideo;
+			int oldDriver = GraphicsDriver;
+			int oldFlags = GfxFlags;
+			int oldWidth = ScreenWidthActual;
+			int oldHeight = ScreenHeightActual;
+			if (TFB_ReInitGraphics (cmd->driver, cmd->flags,
+					cmd->width, cmd->height))
+			{
+				log_add (log_Error, "Could not provide requested mode: "
+						"reverting to last known driver.");
+				// We don't know what exactly failed, so roll it all back
+				if (TFB_ReInitGraphics (oldDriver, oldFlags,
+						oldWidth, oldHeight))
+				{
+					log_add (log_Fatal,
+							"Couldn't reinit at that point either. "
+							"Your video has been somehow tied in knots.");
+					exit (EXIT_FAILURE);
+				}
+			}
+			TFB_SwapBuffers (TFB_REDRAW_YES);
+			break;
+		}
+		
+		case TFB_DRAWCOMMANDTYPE_CALLBACK:
+		{
+			DC->data.callback.callback (DC->data.callback.arg);
+			break;
+		}
+	}
+}
+
 // Only call from main() thread!!
 void
 TFB_FlushGraphics (void)
@@ -338,9 +669,9 @@ TFB_FlushGraphicsEx (BOOLEAN skip_swap)
 	int commands_handled;
 	BOOLEAN livelock_deterrence;
 
-	// This is technically a locking violation on DrawCommandQueue.Size,
-	// but it is likely to not be very destructive.
-	if (DrawCommandQueue.Size == 0)
+	// Producers may be adding commands while we look; anything we miss
+	// here is picked up by the next flush.
+	if (DCQ_SIZE () == 0)
 	{
 		static int last_fade = 255;
 		static int last_transition = 255;
@@ -356,6 +687,14 @@ TFB_FlushGraphicsEx (BOOLEAN skip_swap)
 		{
 			TFB_SwapBuffers (TFB_REDRAW_FADING);
 					// if fading, redraw every frame
+			Profile_endFrame ();
+		}
+		else if (!skip_swap && current_transition == 255 &&
+				!FadePending ())
+		{
+			// Nothing is drawing; sleep until a command is queued or
+			// an event comes in
+			TFB_WaitForEvents (DCQ_IDLE_WAIT_MS);
 		}
 		else
 		{
@@ -371,269 +710,68 @@ TFB_FlushGraphicsEx (BOOLEAN skip_swap)
 	if (GfxFlags & TFB_GFXFLAGS_SHOWFPS)
 		computeFPS ();
 
+	PROFILE_BEGIN (PROF_FLUSH);
 	commands_handled = 0;
 	livelock_deterrence = FALSE;
 
-	if (DrawCommandQueue.FullSize > DCQ_FORCE_BREAK_SIZE)
+	if (DCQ_FULLSIZE () > DCQ_FORCE_BREAK_SIZE)
 	{
 		TFB_BatchReset ();
 	}
 
-	if (DrawCommandQueue.Size > DCQ_FORCE_SLOWDOWN_SIZE)
+	if (DCQ_SIZE () > DCQ_FORCE_SLOWDOWN_SIZE)
 	{
 		Lock_DCQ (-1);
 		livelock_deterrence = TRUE;
 	}
 
 	TFB_BBox_Reset ();
+	TFB_ResetDrawCommandStats ();
 
 	for (;;)
 	{
-		TFB_DrawCommand DC;
+		static TFB_DrawCommand window[DCQ_OPTIMIZE_WINDOW];
+		int count, i;
 
-		if (!TFB_DrawCommandQueue_Pop (&DC))
+		// Take a window of commands off the queue, and let the
+		// optimiser drop or merge what it can before executing them.
+		for (count = 0; count < DCQ_OPTIMIZE_WINDOW; ++count)
 		{
-			// the Queue is now empty.
-			break;
-		}
-
-		++commands_handled;
-		if (!livelock_deterrence && commands_handled + DrawCommandQueue.Size
-				> DCQ_LIVELOCK_MAX)
-		{
-			// log_add (log_Debug, "Initiating livelock deterrence!");
-			livelock_deterrence = TRUE;
-			
-			Lock_DCQ (-1);
-		}
-
-		switch (DC.Type)
-		{
-			case TFB_DRAWCOMMANDTYPE_SETMIPMAP:
-			{
-				TFB_DrawCommand_SetMipmap *cmd = &DC.data.setmipmap;
-				TFB_DrawImage_SetMipmap (cmd->image, cmd->mipmap,
-						cmd->hotx, cmd->hoty);
-				break;
-			}
-
-			case TFB_DRAWCOMMANDTYPE_IMAGE:
-			{
-				TFB_DrawCommand_Image *cmd = &DC.data.image;
-				TFB_Image *DC_image = cmd->image;
-				const int x = cmd->x;
-				const int y = cmd->y;
-
-				TFB_DrawCanvas_Image (DC_image, x, y,
-						cmd->scale, cmd->scaleMode, cmd->colormap,
-						cmd->drawMode,
-						TFB_GetScreenCanvas (cmd->destBuffer));
-
-				if (cmd->destBuffer == TFB_SCREEN_MAIN)
-				{
-					LockMutex (DC_image->mutex);
-					if (cmd->scale)
-						TFB_BBox_RegisterCanvas (DC_image->ScaledImg,
-								x - DC_image->last_scale_hs.x,
-								y - DC_image->last_scale_hs.y);
-					else
-						TFB_BBox_RegisterCanvas (DC_image->NormalImg,
-								x - DC_image->NormalHs.x,
-								y - DC_image->NormalHs.y);
-					UnlockMutex (DC_image->mutex);
-				}
-
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_FILLEDIMAGE:
-			{
-				TFB_DrawCommand_FilledImage *cmd = &DC.data.filledimage;
-				TFB_Image *DC_image = cmd->image;
-				const int x = cmd->x;
-				const int y = cmd->y;
-
-				TFB_DrawCanvas_FilledImage (DC_image, x, y,
-						cmd->scale, cmd->scaleMode, cmd->color,
-						cmd->drawMode,
-						TFB_GetScreenCanvas (cmd->destBuffer));
-
-				if (cmd->destBuffer == TFB_SCREEN_MAIN)
-				{
-					LockMutex (DC_image->mutex);
-					if (cmd->scale)
-						TFB_BBox_RegisterCanvas (DC_image->ScaledImg,
-								x - DC_image->last_scale_hs.x,
-								y - DC_image->last_scale_hs.y);
-					else
-						TFB_BBox_RegisterCanvas (DC_image->NormalImg,
-								x - DC_image->NormalHs.x,
-								y - DC_image->NormalHs.y);
-					UnlockMutex (DC_image->mutex);
-				}
-
+			if (!TFB_DrawCommandQueue_Pop (&window[count]))
 				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_FONTCHAR:
-			{
-				TFB_DrawCommand_FontChar *cmd = &DC.data.fontchar;
-				TFB_Char *DC_char = cmd->fontchar;
-				const int x = cmd->x;
-				const int y = cmd->y;
-
-				TFB_DrawCanvas_FontChar (DC_char, cmd->backing, x, y,
-						cmd->drawMode, TFB_GetScreenCanvas (cmd->destBuffer));
-
-				if (cmd->destBuffer == TFB_SCREEN_MAIN)
-				{
-					RECT r;
-					
-					r.corner.x = x - DC_char->HotSpot.x;
-					r.corner.y = y - DC_char->HotSpot.y;
-					r.extent.width = DC_char->extent.width;
-					r.extent.height = DC_char->extent.height;
-
-					TFB_BBox_RegisterRect (&r);
-				}
-
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_LINE:
-			{
-				TFB_DrawCommand_Line *cmd = &DC.data.line;
-
-				if (cmd->destBuffer == TFB_SCREEN_MAIN)
-				{
-					TFB_BBox_RegisterPoint (cmd->x1, cmd->y1);
-					TFB_BBox_RegisterPoint (cmd->x2, cmd->y2);
-				}
-				TFB_DrawCanvas_Line (cmd->x1, cmd->y1, cmd->x2, cmd->y2,
-						cmd->color, cmd->drawMode,
-						TFB_GetScreenCanvas (cmd->destBuffer));
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_RECTANGLE:
-			{
-				TFB_DrawCommand_Rect *cmd = &DC.data.rect;
-
-				if (cmd->destBuffer == TFB_SCREEN_MAIN)
-					TFB_BBox_RegisterRect (&cmd->rect);
-				TFB_DrawCanvas_Rect (&cmd->rect, cmd->color, cmd->drawMode,
-						TFB_GetScreenCanvas (cmd->destBuffer));
 
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_SCISSORENABLE:
+			++commands_handled;
+			if (!livelock_deterrence && commands_handled + DCQ_SIZE ()
+					> DCQ_LIVELOCK_MAX)
 			{
-				TFB_DrawCommand_Scissor *cmd = &DC.data.scissor;
-
-				TFB_DrawCanvas_SetClipRect (
-						TFB_GetScreenCanvas (TFB_SCREEN_MAIN), &cmd->rect);
-				TFB_BBox_SetClipRect (&DC.data.scissor.rect);
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_SCISSORDISABLE:
-				TFB_DrawCanvas_SetClipRect (
-						TFB_GetScreenCanvas (TFB_SCREEN_MAIN), NULL);
-				TFB_BBox_SetClipRect (NULL);
-				break;
-			
-			case TFB_DRAWCOMMANDTYPE_COPYTOIMAGE:
-			{
-				TFB_DrawCommand_CopyToImage *cmd = &DC.data.copytoimage;
-				TFB_Image *DC_image = cmd->image;
-				const POINT dstPt = {0, 0};
-
-				if (DC_image == 0)
-				{
-					log_add (log_Debug, "DCQ ERROR: COPYTOIMAGE passed null "
-							"image ptr");
-					break;
-				}
-				LockMutex (DC_image->mutex);
-				TFB_DrawCanvas_CopyRect (
-						TFB_GetScreenCanvas (cmd->srcBuffer), &cmd->rect,
-						DC_image->NormalImg, dstPt);
-				UnlockMutex (DC_image->mutex);
-				break;
+				// log_add (log_Debug, "Initiating livelock deterrence!");
+				livelock_deterrence = TRUE;
+				
+				Lock_DCQ (-1);
 			}
-			
-			case TFB_DRAWCOMMANDTYPE_COPY:
-			{
-				TFB_DrawCommand_Copy *cmd = &DC.data.copy;
-				const RECT r = cmd->rect;
-
-				if (cmd->destBuffer == TFB_SCREEN_MAIN)
-					TFB_BBox_RegisterRect (&cmd->rect);
+		}
 
-				TFB_DrawCanvas_CopyRect	(
-						TFB_GetScreenCanvas (cmd->srcBuffer), &r,
-						TFB_GetScreenCanvas (cmd->destBuffer), r.corner);
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_DELETEIMAGE:
-			{
-				TFB_Image *DC_image = DC.data.deleteimage.image;
-				TFB_DrawImage_Delete (DC_image);
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_DELETEDATA:
-			{
-				void *data = DC.data.deletedata.data;
-				HFree (data);
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_SENDSIGNAL:
-				ClearSemaphore (DC.data.sendsignal.sem);
-				break;
-			
-			case TFB_DRAWCOMMANDTYPE_REINITVIDEO:
-			{
-				TFB_DrawCommand_ReinitVideo *cmd = &DC.data.reinitvideo;
-				int oldDriver = GraphicsDriver;
-				int oldFlags = GfxFlags;
-				int oldWidth = ScreenWidthActual;
-				int oldHeight = ScreenHeightActual;
-				if (TFB_ReInitGraphics (cmd->driver, cmd->flags,
-						cmd->width, cmd->height))
-				{
-					log_add (log_Error, "Could not provide requested mode: "
-							"reverting to last known driver.");
-					// We don't know what exactly failed, so roll it all back
-					if (TFB_ReInitGraphics (oldDriver, oldFlags,
-							oldWidth, oldHeight))
-					{
-						log_add (log_Fatal,
-								"Couldn't reinit at that point either. "
-								"Your video has been somehow tied in knots.");
-						exit (EXIT_FAILURE);
-					}
-				}
-				TFB_SwapBuffers (TFB_REDRAW_YES);
-				break;
-			}
-			
-			case TFB_DRAWCOMMANDTYPE_CALLBACK:
-			{
-				DC.data.callback.callback (DC.data.callback.arg);
-				break;
-			}
+		if (count == 0)
+		{
+			// the Queue is now empty.
+			break;
 		}
+
+		count = TFB_OptimizeDrawCommands (window, count);
+		for (i = 0; i < count; ++i)
+			TFB_ExecuteDrawCommand (&window[i]);
 	}
 	
 	if (livelock_deterrence)
 		Unlock_DCQ ();
 
+	DCQ_LastFrameStats = DCQ_FrameStats;
+
 	if (!skip_swap)
 		TFB_SwapBuffers (TFB_REDRAW_NO);
+	PROFILE_END (PROF_FLUSH);
+	if (!skip_swap)
+		Profile_endFrame ();
 	RenderedFrames++;
 	BroadcastCondVar (RenderingCond);
 }
@@ -667,6 +805,11 @@ TFB_PurgeDanglingGraphics (void)
 				HFree (data);
 				break;
 			}
+			case TFB_DRAWCOMMANDTYPE_TEXTRUN:
+			{
+				HFree (DC.data.textrun.glyphs);
+				break;
+			}
 			case TFB_DRAWCOMMANDTYPE_IMAGE:
 			{
 				TFB_ColorMap *cmap = DC.data.image.colormap;
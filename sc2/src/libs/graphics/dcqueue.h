@@ -48,8 +48,42 @@
 #define DCQ_LIVELOCK_MAX 4096
 #endif
 
+// DCQ_MAX must be a power of two, so that the free-running queue
+// counters map onto slots without a discontinuity when they wrap.
+#define DCQ_MASK (DCQ_MAX - 1)
+
 extern CondVar RenderingCond;
 
+// Number of commands TFB_FlushGraphicsEx() takes off the queue at a
+// time and hands to TFB_OptimizeDrawCommands().
+#define DCQ_OPTIMIZE_WINDOW 256
+
+// Counters kept by TFB_OptimizeDrawCommands().  Reset at the start of
+// each frame; DCQ_LastFrameStats holds the totals for the last
+// completed frame.
+typedef struct
+{
+	int processed;   // Commands examined
+	int overdrawn;   // Dropped because a later command covered them
+	int merged;      // Rect fills merged into an adjacent one
+	int regrouped;   // Image blits moved next to others with their colormap
+} TFB_DrawCommandStats;
+
+extern TFB_DrawCommandStats DCQ_FrameStats;
+extern TFB_DrawCommandStats DCQ_LastFrameStats;
+
+int TFB_OptimizeDrawCommands (TFB_DrawCommand *cmds, int count);
+void TFB_ResetDrawCommandStats (void);
+
+// Number of commands the renderer may currently process
+#define DCQ_SIZE() \
+		((int) (AtomicLoad (&DrawCommandQueue.Back) - \
+		AtomicLoad (&DrawCommandQueue.Front)))
+// Number of commands in the queue, including batched ones
+#define DCQ_FULLSIZE() \
+		((int) (AtomicLoad (&DrawCommandQueue.InsertionPoint) - \
+		AtomicLoad (&DrawCommandQueue.Front)))
+
 #endif
 
 
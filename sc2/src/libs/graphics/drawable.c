@@ -302,6 +302,7 @@ SetFrameTransparentColor (FRAME frame, Color color)
 
 	// TODO: This should defer to TFB_DrawImage instead
 	TFB_DrawCanvas_SetTransparentColor (img->NormalImg, color, FALSE);
+	++img->version;
 	
 	UnlockMutex (img->mutex);
 }
@@ -463,6 +464,7 @@ WriteFramePixelColors (FRAME frame, const Color *pixels, int width, int height)
 
 	// TODO: Do we need to lock the img->mutex here?
 	img = frame->image;
+	++img->version;
 	return TFB_DrawCanvas_SetPixelColors (img->NormalImg, pixels,
 			width, height);
 }
@@ -496,6 +498,7 @@ WriteFramePixelIndexes (FRAME frame, const BYTE *pixels, int width, int height)
 
 	// TODO: Do we need to lock the img->mutex here?
 	img = frame->image;
+	++img->version;
 	return TFB_DrawCanvas_SetPixelIndexes (img->NormalImg, pixels,
 			width, height);
 }
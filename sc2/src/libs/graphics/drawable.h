@@ -53,6 +53,8 @@ struct drawable_desc
 	CREATE_FLAGS Flags;
 	UWORD MaxIndex;
 	FRAME_DESC *Frame;
+	TFB_Canvas atlas;
+			// Holds the pixels of all frames, if they were packed
 };
 
 #define GetFrameWidth(f) ((f)->Bounds.width)
@@ -78,6 +80,7 @@ extern INTERSECT_CODE _clip_line (const RECT *pClipRect,
 
 extern void *_GetCelData (uio_Stream *fp, DWORD length);
 extern BOOLEAN _ReleaseCelData (void *handle);
+extern void UninitCelDecoders (void);
 
 extern FRAME _CurFramePtr;
 
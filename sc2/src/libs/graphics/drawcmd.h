@@ -20,6 +20,7 @@
 #define DRAWCMD_H
 
 #include "libs/graphics/tfb_draw.h"
+#include "libs/threadlib.h"
 
 enum
 {
@@ -28,6 +29,7 @@ enum
 	TFB_DRAWCOMMANDTYPE_IMAGE,
 	TFB_DRAWCOMMANDTYPE_FILLEDIMAGE,
 	TFB_DRAWCOMMANDTYPE_FONTCHAR,
+	TFB_DRAWCOMMANDTYPE_TEXTRUN,
 
 	TFB_DRAWCOMMANDTYPE_COPY,
 	TFB_DRAWCOMMANDTYPE_COPYTOIMAGE,
@@ -90,6 +92,18 @@ typedef struct tfb_dc_fontchar
 	SCREEN destBuffer;
 } TFB_DrawCommand_FontChar;
 
+typedef struct tfb_dc_textrun
+{
+	TFB_TextGlyph *glyphs;
+		// glyphs must be a result of HXalloc() call
+	COUNT count;
+	RECT bounds;
+		// Covers all the chars, for the dirty bbox and the optimiser
+	TFB_Image *backing;
+	DrawMode drawMode;
+	SCREEN destBuffer;
+} TFB_DrawCommand_TextRun;
+
 typedef struct tfb_dc_copy
 {
 	RECT rect;
@@ -151,6 +165,7 @@ typedef struct tfb_drawcommand
 		TFB_DrawCommand_Image image;
 		TFB_DrawCommand_FilledImage filledimage;
 		TFB_DrawCommand_FontChar fontchar;
+		TFB_DrawCommand_TextRun textrun;
 		TFB_DrawCommand_Copy copy;
 		TFB_DrawCommand_CopyToImage copytoimage;
 		TFB_DrawCommand_Scissor scissor;
@@ -165,14 +180,21 @@ typedef struct tfb_drawcommand
 
 // Queue Stuff
 
+// The queue positions are free-running counters; the slot index is
+// the counter modulo DCQ_MAX.  Producers reserve slots by atomically
+// advancing InsertionPoint, so pushing a command never takes a lock.
+// Commands between Front and Back are visible to the renderer;
+// commands between Back and InsertionPoint are still batched.
 typedef struct tfb_drawcommandqueue
 {
-	int Front;
-	int Back;
-	int InsertionPoint;
-	int Batching;
-	volatile int FullSize;
-	volatile int Size;
+	AtomicU32 Front;
+			// Only written by the rendering thread
+	AtomicU32 Back;
+	AtomicU32 InsertionPoint;
+	AtomicU32 Batching;
+	AtomicU32 Locked;
+			// Lock_DCQ() depth; while non-zero, producers go through
+			// DCQ_Mutex instead of the lock-free path
 } TFB_DrawCommandQueue;
 
 void Init_DrawCommandQueue (void);
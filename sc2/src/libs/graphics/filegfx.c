@@ -26,10 +26,12 @@ LoadGraphicFile (const char *pStr)
 {
 	uio_Stream *fp;
 
-	// FIXME: this theoretically needs a mechanism to prevent races
+	res_LockLoading ();
 	if (_cur_resfile_name)
-		// something else is loading resources atm
+	{	// something else on this thread is loading resources atm
+		res_UnlockLoading ();
 		return 0;
+	}
 
 	fp = res_OpenResFile (contentDir, pStr, "rb");
 	if (fp != NULL)
@@ -39,9 +41,11 @@ LoadGraphicFile (const char *pStr)
 		_cur_resfile_name = pStr;
 		hData = (DRAWABLE)_GetCelData (fp, LengthResFile (fp));
 		_cur_resfile_name = 0;
+		res_UnlockLoading ();
 		res_CloseResFile (fp);
 		return hData;
 	}
+	res_UnlockLoading ();
 
 	return (NULL);
 }
@@ -51,10 +55,12 @@ LoadFontFile (const char *pStr)
 {
 	uio_Stream *fp;
 
-	// FIXME: this theoretically needs a mechanism to prevent races
+	res_LockLoading ();
 	if (_cur_resfile_name)
-		// something else is loading resources atm
+	{	// something else on this thread is loading resources atm
+		res_UnlockLoading ();
 		return 0;
+	}
 
 	fp = res_OpenResFile (contentDir, pStr, "rb");
 	if (fp != NULL)
@@ -64,9 +70,11 @@ LoadFontFile (const char *pStr)
 		_cur_resfile_name = pStr;
 		hData = (FONT)_GetFontData (fp, LengthResFile (fp));
 		_cur_resfile_name = 0;
+		res_UnlockLoading ();
 		res_CloseResFile (fp);
 		return hData;
 	}
+	res_UnlockLoading ();
 
 	return (0);
 }
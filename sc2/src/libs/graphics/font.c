@@ -70,24 +70,43 @@ font_DrawText (TEXT *lpText)
 
 /* Draw the stroke by drawing the same text in the
  * background color one pixel shifted to all 4 directions.
+ * The text is measured once; the shifted copies only move its rect.
  */
 void
 font_DrawTracedText (TEXT *pText, Color text, Color trace)
 {
+	static const POINT shifts[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+	RECT TextClipRect;
+	RECT ClipRect;
+	POINT origin;
+	TEXT locText;
+	Color oldfg;
+	COUNT i;
+
+	if (!GraphicsSystemActive () || !GetContextValidRect (NULL, &origin))
+		return;
+
+	// TextRect() clobbers TEXT.CharCount so we have to make a copy
+	locText = *pText;
+	if (!TextRect (&locText, &TextClipRect, NULL))
+		return;
+
 	// Preserve current foreground color for full correctness
-	Color oldfg = SetContextForeGroundColor (trace);
-	pText->baseline.x--;
-	font_DrawText (pText);
-	pText->baseline.x += 2;
-	font_DrawText (pText);
-	pText->baseline.x--;
-	pText->baseline.y--;
-	font_DrawText (pText);
-	pText->baseline.y += 2;
-	font_DrawText (pText);
-	pText->baseline.y--;
+	oldfg = SetContextForeGroundColor (trace);
+	FixContextFontEffect ();
+	for (i = 0; i < sizeof shifts / sizeof shifts[0]; ++i)
+	{
+		ClipRect = TextClipRect;
+		ClipRect.corner.x += shifts[i].x;
+		ClipRect.corner.y += shifts[i].y;
+		locText.baseline.y = pText->baseline.y + shifts[i].y;
+		_text_blt (&ClipRect, &locText, origin);
+	}
+
 	SetContextForeGroundColor (text);
-	font_DrawText (pText);
+	FixContextFontEffect ();
+	locText.baseline.y = pText->baseline.y;
+	_text_blt (&TextClipRect, &locText, origin);
 	SetContextForeGroundColor (oldfg);
 }
 
@@ -153,7 +172,7 @@ TextRect (TEXT *lpText, RECT *pRect, BYTE *pdelta)
 		pStr = lpText->pStr;
 		if (num_chars > 0)
 		{
-			next_ch = getCharFromString (&pStr);
+			next_ch = getCharFromStringFast (&pStr);
 			if (next_ch == '\0')
 				num_chars = 0;
 		}
@@ -168,7 +187,7 @@ TextRect (TEXT *lpText, RECT *pRect, BYTE *pdelta)
 			ch = next_ch;
 			if (num_chars > 0)
 			{
-				next_ch = getCharFromString (&pStr);
+				next_ch = getCharFromStringFast (&pStr);
 				if (next_ch == '\0')
 				{
 					lpText->CharCount -= num_chars;
@@ -233,6 +252,103 @@ TextRect (TEXT *lpText, RECT *pRect, BYTE *pdelta)
 	return (FALSE);
 }
 
+// Adds the extent of 'ch' to a measurement, the way TextRect() does.
+// '*pdelta' is set to how much wider the text became.
+static inline void
+measureChar (FONT FontPtr, UniChar ch, SIZE *pwidth, COORD *ptop_y,
+		COORD *pbot_y, BYTE *pdelta)
+{
+	TFB_Char *charFrame = getCharFrame (FontPtr, ch);
+	COORD y;
+
+	*pdelta = 0;
+	if (charFrame == NULL || !charFrame->disp.width)
+		return;
+
+	y = -charFrame->HotSpot.y;
+	if (y < *ptop_y)
+		*ptop_y = y;
+	y += charFrame->disp.height;
+	if (y > *pbot_y)
+		*pbot_y = y;
+
+	*pwidth += charFrame->disp.width;
+	*pdelta = (BYTE) charFrame->disp.width;
+}
+
+BOOLEAN
+TextLineWithinWidth (TEXT *pText, const char **startNext,
+		SIZE maxWidth, COUNT maxChars)
+{
+	FONT FontPtr = _CurFontPtr;
+	const char *ptr = pText->pStr;
+	const char *wordStart;
+	COUNT charCount = 0;
+	COUNT fitCount = pText->CharCount;
+			// What pText->CharCount is left at when the next word does
+			// not fit
+	SIZE width = 0;
+	COORD top_y = 0;
+	COORD bot_y = 0;
+	BYTE last_delta = 0;
+	BOOLEAN eol;
+	BOOLEAN done;
+	UniChar ch;
+
+	for (;;)
+	{
+		SIZE lineWidth;
+
+		wordStart = ptr;
+
+		// Scan one word, measuring it as we go.
+		for (;;)
+		{
+			if (*ptr == '\0')
+			{
+				eol = TRUE;
+				done = TRUE;
+				break;
+			}
+			ch = getCharFromStringFast (&ptr);
+			eol = ch == '\0' || ch == '\n' || ch == '\r';
+			done = eol || charCount >= maxChars;
+			if (done || ch == ' ')
+				break;
+			if (FontPtr)
+				measureChar (FontPtr, ch, &width, &top_y, &bot_y,
+						&last_delta);
+			charCount++;
+		}
+
+		// The width TextRect() gives for the first 'charCount'
+		// characters, without the spacing after the last one
+		lineWidth = 0;
+		if (charCount > 0 && width > 0 && bot_y > top_y)
+			lineWidth = width - (last_delta > 0 ? 1 : 0);
+
+		if (lineWidth >= maxWidth)
+		{
+			pText->CharCount = fitCount;
+			*startNext = wordStart;
+			return FALSE;
+		}
+
+		pText->CharCount = charCount;
+		if (done)
+		{
+			*startNext = ptr;
+			return eol;
+		}
+		fitCount = charCount;
+
+		// For the space in between words.
+		if (FontPtr)
+			measureChar (FontPtr, ch, &width, &top_y, &bot_y, &last_delta);
+		charCount++;
+	}
+}
+
 void
 _text_blt (RECT *pClipRect, TEXT *TextPtr, POINT ctxOrigin)
 {
@@ -242,6 +358,9 @@ _text_blt (RECT *pClipRect, TEXT *TextPtr, POINT ctxOrigin)
 	const char *pStr;
 	POINT origin;
 	TFB_Image *backing;
+	TFB_TextGlyph *glyphs;
+	COUNT num_glyphs;
+	RECT bounds;
 	DrawMode mode = _get_context_draw_mode ();
 
 	FontPtr = _CurFontPtr;
@@ -257,9 +376,13 @@ _text_blt (RECT *pClipRect, TEXT *TextPtr, POINT ctxOrigin)
 	if (num_chars == 0)
 		return;
 
+	// The whole string goes to the DCQ as one text run
+	glyphs = HMalloc (num_chars * sizeof *glyphs);
+	num_glyphs = 0;
+
 	pStr = TextPtr->pStr;
 
-	next_ch = getCharFromString (&pStr);
+	next_ch = getCharFromStringFast (&pStr);
 	if (next_ch == '\0')
 		num_chars = 0;
 	while (num_chars--)
@@ -270,7 +393,7 @@ _text_blt (RECT *pClipRect, TEXT *TextPtr, POINT ctxOrigin)
 		ch = next_ch;
 		if (num_chars > 0)
 		{
-			next_ch = getCharFromString (&pStr);
+			next_ch = getCharFromStringFast (&pStr);
 			if (next_ch == '\0')
 				num_chars = 0;
 		}
@@ -286,8 +409,23 @@ _text_blt (RECT *pClipRect, TEXT *TextPtr, POINT ctxOrigin)
 			r.extent.height = fontChar->disp.height;
 			if (BoxIntersect (&r, pClipRect, &r))
 			{
-				TFB_Prim_FontChar (origin, fontChar, backing, mode,
-						ctxOrigin);
+				TFB_TextGlyph *g = &glyphs[num_glyphs];
+
+				g->fontChar = fontChar;
+				g->x = origin.x;
+				g->y = origin.y;
+
+				r.corner.x = origin.x - fontChar->HotSpot.x;
+				r.corner.y = origin.y - fontChar->HotSpot.y;
+				r.extent = fontChar->extent;
+				if (num_glyphs > 0)
+				{	// BoxUnion() cannot work in place
+					RECT u;
+					BoxUnion (&bounds, &r, &u);
+					r = u;
+				}
+				bounds = r;
+				++num_glyphs;
 			}
 
 			origin.x += fontChar->disp.width;
@@ -299,6 +437,14 @@ _text_blt (RECT *pClipRect, TEXT *TextPtr, POINT ctxOrigin)
 #endif
 		}
 	}
+
+	if (num_glyphs == 0)
+	{
+		HFree (glyphs);
+		return;
+	}
+	TFB_Prim_TextRun (glyphs, num_glyphs, &bounds, backing, mode,
+			ctxOrigin);
 }
 
 static inline TFB_Char *
@@ -53,6 +53,8 @@ struct font_desc
 	UWORD Leading;
 	UWORD LeadingWidth;
 	FONT_PAGE *fontPages;
+	BYTE *atlas;
+			// Alpha data of all chars, packed into one matrix
 };
 
 #define CHAR_DESCPTR PCHAR_DESC
@@ -50,8 +50,9 @@ typedef struct
 
 
 // pValidRect or origin may be NULL
-BOOLEAN
-GetContextValidRect (RECT *pValidRect, POINT *origin)
+static BOOLEAN
+getValidRect (FRAME frame, const RECT *clipRect, RECT *pValidRect,
+		POINT *origin)
 {
 	RECT tempRect;
 	POINT tempPt;
@@ -64,26 +65,44 @@ GetContextValidRect (RECT *pValidRect, POINT *origin)
 	// Start with a rect the size of foreground frame
 	pValidRect->corner.x = 0;
 	pValidRect->corner.y = 0;
-	pValidRect->extent = GetFrameBounds (_CurFramePtr);
-	*origin = _CurFramePtr->HotSpot;
+	pValidRect->extent = GetFrameBounds (frame);
+	*origin = frame->HotSpot;
 
-	if (_pCurContext->ClipRect.extent.width)
+	if (clipRect->extent.width)
 	{
 		// If the cliprect is completely outside of the valid frame
 		// bounds we have nothing to draw
-		if (!BoxIntersect (&_pCurContext->ClipRect,
-				pValidRect, pValidRect))
+		if (!BoxIntersect ((RECT *) clipRect, pValidRect, pValidRect))
 			return (FALSE);
 
 		// Foreground frame hotspot defines a drawing position offset
 		// WRT the context cliprect
-		origin->x += _pCurContext->ClipRect.corner.x;
-		origin->y += _pCurContext->ClipRect.corner.y;
+		origin->x += clipRect->corner.x;
+		origin->y += clipRect->corner.y;
 	}
 
 	return (TRUE);
 }
 
+// pValidRect or origin may be NULL
+BOOLEAN
+GetContextValidRect (RECT *pValidRect, POINT *origin)
+{
+	return getValidRect (_CurFramePtr, &_pCurContext->ClipRect,
+			pValidRect, origin);
+}
+
+// The explicit context counterpart of GraphicsSystemActive() and
+// GetContextValidRect()
+static BOOLEAN
+contextDrawable (CONTEXT context, POINT *origin)
+{
+	if (!context || !context->ForeGroundFrame)
+		return FALSE;
+	return getValidRect (context->ForeGroundFrame, &context->ClipRect,
+			NULL, origin);
+}
+
 static void
 ClearBackGround (RECT *pClipRect)
 {
@@ -93,7 +112,7 @@ ClearBackGround (RECT *pClipRect)
 	clearRect.corner.y = 0;
 	clearRect.extent = pClipRect->extent;
 	TFB_Prim_FillRect (&clearRect, color, DRAW_REPLACE_MODE,
-			pClipRect->corner);
+			pClipRect->corner, _CurFramePtr);
 }
 
 void
@@ -138,20 +157,21 @@ DrawBatch (PRIMITIVE *lpBasePrim, PRIM_LINKS PrimLinks,
 				case POINT_PRIM:
 					color = GetPrimColor (lpWorkPrim);
 					TFB_Prim_Point (&lpWorkPrim->Object.Point, color,
-							mode, origin);
+							mode, origin, _CurFramePtr);
 					break;
 				case STAMP_PRIM:
-					TFB_Prim_Stamp (&lpWorkPrim->Object.Stamp, mode, origin);
+					TFB_Prim_Stamp (&lpWorkPrim->Object.Stamp, mode, origin,
+							_CurFramePtr);
 					break;
 				case STAMPFILL_PRIM:
 					color = GetPrimColor (lpWorkPrim);
 					TFB_Prim_StampFill (&lpWorkPrim->Object.Stamp, color,
-							mode, origin);
+							mode, origin, _CurFramePtr);
 					break;
 				case LINE_PRIM:
 					color = GetPrimColor (lpWorkPrim);
 					TFB_Prim_Line (&lpWorkPrim->Object.Line, color,
-							mode, origin);
+							mode, origin, _CurFramePtr);
 					break;
 				case TEXT_PRIM:
 					if (!TextRect (&lpWorkPrim->Object.Text, &ClipRect, NULL))
@@ -162,12 +182,12 @@ DrawBatch (PRIMITIVE *lpBasePrim, PRIM_LINKS PrimLinks,
 				case RECT_PRIM:
 					color = GetPrimColor (lpWorkPrim);
 					TFB_Prim_Rect (&lpWorkPrim->Object.Rect, color,
-							mode, origin);
+							mode, origin, _CurFramePtr);
 					break;
 				case RECTFILL_PRIM:
 					color = GetPrimColor (lpWorkPrim);
 					TFB_Prim_FillRect (&lpWorkPrim->Object.Rect, color,
-							mode, origin);
+							mode, origin, _CurFramePtr);
 					break;
 			}
 		}
@@ -196,7 +216,7 @@ DrawPoint (POINT *lpPoint)
 	{
 		Color color = GetPrimColor (&_locPrim);
 		DrawMode mode = _get_context_draw_mode ();
-		TFB_Prim_Point (lpPoint, color, mode, origin);
+		TFB_Prim_Point (lpPoint, color, mode, origin, _CurFramePtr);
 	}
 }
 
@@ -209,7 +229,7 @@ DrawRectangle (RECT *lpRect)
 	{
 		Color color = GetPrimColor (&_locPrim);
 		DrawMode mode = _get_context_draw_mode ();
-		TFB_Prim_Rect (lpRect, color, mode, origin);
+		TFB_Prim_Rect (lpRect, color, mode, origin, _CurFramePtr);
 	}
 }
 
@@ -222,7 +242,7 @@ DrawFilledRectangle (RECT *lpRect)
 	{
 		Color color = GetPrimColor (&_locPrim);
 		DrawMode mode = _get_context_draw_mode ();
-		TFB_Prim_FillRect (lpRect, color, mode, origin);
+		TFB_Prim_FillRect (lpRect, color, mode, origin, _CurFramePtr);
 	}
 }
 
@@ -235,7 +255,24 @@ DrawLine (LINE *lpLine)
 	{
 		Color color = GetPrimColor (&_locPrim);
 		DrawMode mode = _get_context_draw_mode ();
-		TFB_Prim_Line (lpLine, color, mode, origin);
+		TFB_Prim_Line (lpLine, color, mode, origin, _CurFramePtr);
+	}
+}
+
+void
+DrawPolyline (const POINT *lpPoints, COUNT count)
+{
+	POINT origin;
+
+	if (count < 2)
+		return;
+
+	if (GraphicsSystemActive () && GetContextValidRect (NULL, &origin))
+	{
+		Color color = GetPrimColor (&_locPrim);
+		DrawMode mode = _get_context_draw_mode ();
+		TFB_Prim_Polyline (lpPoints, count, color, mode, origin,
+				_CurFramePtr);
 	}
 }
 
@@ -247,7 +284,7 @@ DrawStamp (STAMP *stmp)
 	if (GraphicsSystemActive () && GetContextValidRect (NULL, &origin))
 	{
 		DrawMode mode = _get_context_draw_mode ();
-		TFB_Prim_Stamp (stmp, mode, origin);
+		TFB_Prim_Stamp (stmp, mode, origin, _CurFramePtr);
 	}
 }
 
@@ -260,7 +297,72 @@ DrawFilledStamp (STAMP *stmp)
 	{
 		Color color = GetPrimColor (&_locPrim);
 		DrawMode mode = _get_context_draw_mode ();
-		TFB_Prim_StampFill (stmp, color, mode, origin);
+		TFB_Prim_StampFill (stmp, color, mode, origin, _CurFramePtr);
 	}
 }
 
+
+// The *In() functions draw into 'context' with its own cliprect and draw
+// mode, in the color given. They neither use nor change the current
+// context, so several draws in different colors need no SetContext()
+// and SetContextForeGroundColor() in between.
+
+void
+DrawPointIn (CONTEXT context, POINT *lpPoint, Color color)
+{
+	POINT origin;
+
+	if (contextDrawable (context, &origin))
+		TFB_Prim_Point (lpPoint, color, context->Mode, origin,
+				context->ForeGroundFrame);
+}
+
+void
+DrawRectangleIn (CONTEXT context, RECT *lpRect, Color color)
+{
+	POINT origin;
+
+	if (contextDrawable (context, &origin))
+		TFB_Prim_Rect (lpRect, color, context->Mode, origin,
+				context->ForeGroundFrame);
+}
+
+void
+DrawFilledRectangleIn (CONTEXT context, RECT *lpRect, Color color)
+{
+	POINT origin;
+
+	if (contextDrawable (context, &origin))
+		TFB_Prim_FillRect (lpRect, color, context->Mode, origin,
+				context->ForeGroundFrame);
+}
+
+void
+DrawLineIn (CONTEXT context, LINE *lpLine, Color color)
+{
+	POINT origin;
+
+	if (contextDrawable (context, &origin))
+		TFB_Prim_Line (lpLine, color, context->Mode, origin,
+				context->ForeGroundFrame);
+}
+
+void
+DrawStampIn (CONTEXT context, STAMP *stmp)
+{
+	POINT origin;
+
+	if (contextDrawable (context, &origin))
+		TFB_Prim_Stamp (stmp, context->Mode, origin,
+				context->ForeGroundFrame);
+}
+
+void
+DrawFilledStampIn (CONTEXT context, STAMP *stmp, Color color)
+{
+	POINT origin;
+
+	if (contextDrawable (context, &origin))
+		TFB_Prim_StampFill (stmp, color, context->Mode, origin,
+				context->ForeGroundFrame);
+}
@@ -51,6 +51,15 @@ enum
 #define TFB_GFXFLAGS_SCALE_HQXX         (1<<7)
 #define TFB_GFXFLAGS_SCALE_XBRZ3        (1<<8)
 #define TFB_GFXFLAGS_SCALE_XBRZ4        (1<<9)
+#define TFB_GFXFLAGS_SCALE_THREADED     (1<<10)
+		// Split scaling across worker threads; not a scaler by itself
+#define TFB_GFXFLAGS_GL_SHADERS         (1<<11)
+		// Scale in OpenGL fragment shaders instead of on the CPU
+#define TFB_GFXFLAGS_VSYNC              (1<<12)
+		// Present in step with the display refresh; SDL2 renderer only
+#define TFB_GFXFLAGS_SCALE_ADAPTIVE     (1<<13)
+		// Trade the software scaler for a cheaper one when it is too
+		// slow; SDL2 renderer only
 #define TFB_GFXFLAGS_SCALE_ANY \
 		( TFB_GFXFLAGS_SCALE_BILINEAR   | \
 		  TFB_GFXFLAGS_SCALE_BIADAPT    | \
@@ -72,9 +81,12 @@ int TFB_InitGraphics (int driver, int flags, const char *renderer,
 int TFB_ReInitGraphics (int driver, int flags, int width, int height);
 void TFB_UninitGraphics (void);
 void TFB_ProcessEvents (void);
+void TFB_WaitForEvents (DWORD timeout);
+void TFB_WakeEventWait (void);
 bool TFB_SetGamma (float gamma);
 void TFB_UploadTransitionScreen (void);
 int TFB_SupportsHardwareScaling (void);
+int TFB_GetCPUCount (void);
 // This function should not be called directly
 void TFB_SwapBuffers (int force_full_redraw);
 
@@ -103,6 +115,40 @@ extern RECT TransitionClipRect;
 extern float FrameRate;
 extern int FrameRateTickBase;
 
+// A presented frame, as given to the frame capture function.
+// The pixels are the unscaled screens themselves, not a copy, so they
+// are only valid during the call. The fade, the screen transition and
+// the system box are not applied to 'pixels'; what is needed to apply
+// them is passed along.
+typedef struct
+{
+	const void *pixels;
+			// The main screen, ScreenWidth by ScreenHeight
+	int pitch;
+			// In bytes
+	int bytesPerPixel;
+	DWORD rmask, gmask, bmask;
+	int fadeAmount;
+			// 255 for none; less fades to black, more to white
+	int transitionAmount;
+			// 255 for none; less shows more of 'transitionPixels'
+	const void *transitionPixels;
+			// Same format as 'pixels'
+	RECT transitionRect;
+			// The part of the screen that the transition covers
+	DWORD frame;
+			// Counts the presented frames
+} TFB_CapturedFrame;
+
+typedef void (*TFB_FrameCaptureFunc) (const TFB_CapturedFrame *frame,
+		void *arg);
+
+// 'func' is called on the main thread after each frame is presented,
+// until it is set to NULL. It should return quickly, as presenting
+// waits for it. Only call from the main thread, or before graphics are
+// initialised.
+void TFB_SetFrameCapture (TFB_FrameCaptureFunc func, void *arg);
+
 void TFB_FlushGraphics (void); // Only call from main thread!!
 void TFB_FlushGraphicsEx (BOOLEAN skip_swap); // Only call from main thread!!
 void TFB_PurgeDanglingGraphics (void); // Only call from main thread as part of shutdown.
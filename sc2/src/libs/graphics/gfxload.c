@@ -26,6 +26,8 @@
 		// for _cur_resfile_name
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/threads/workpool.h"
+#include "libs/graphics/gfx_common.h"
 #include "libs/graphics/tfb_draw.h"
 #include "libs/graphics/drawable.h"
 #include "libs/graphics/font.h"
@@ -42,6 +44,18 @@ typedef struct anidata
 extern uio_Repository *repository;
 static uio_AutoMount *autoMount[] = { NULL };
 
+static BOOLEAN packAtlas;
+		// Pack the frames of each drawable into one canvas
+
+// With the atlas on, the frames of each drawable loaded from then on
+// share one canvas, each drawing from its own part of it, rather than
+// being spread out over a canvas each
+void
+TFB_SetDrawableAtlas (BOOLEAN enable)
+{
+	packAtlas = enable;
+}
+
 static void
 process_image (FRAME FramePtr, TFB_Canvas img[], AniData *ani, int cel_ct)
 {
@@ -109,20 +123,42 @@ process_image (FRAME FramePtr, TFB_Canvas img[], AniData *ani, int cel_ct)
 }
 
 static void
-processFontChar (TFB_Char* CharPtr, TFB_Canvas canvas)
+packDrawable (DRAWABLE Drawable)
 {
-	BYTE* newdata;
-	size_t dpitch;
+	int count = Drawable->MaxIndex + 1;
+	TFB_Canvas *canvases;
+	int i;
+
+	canvases = HMalloc (sizeof (TFB_Canvas) * count);
+	for (i = 0; i < count; ++i)
+		canvases[i] = Drawable->Frame[i].image->NormalImg;
+	// Leaves the frames as they are if they do not go together
+	Drawable->atlas = TFB_DrawCanvas_PackAtlas (canvases, count);
+	if (Drawable->atlas)
+	{
+		for (i = 0; i < count; ++i)
+			Drawable->Frame[i].image->NormalImg = canvases[i];
+	}
+	HFree (canvases);
+}
+
+static void
+deleteAtlas (void *arg)
+{
+	TFB_DrawCanvas_Delete ((TFB_Canvas) arg);
+}
 
+static void
+processFontChar (TFB_Char* CharPtr, TFB_Canvas canvas, BYTE *data,
+		size_t dpitch)
+{
 	TFB_DrawCanvas_GetExtent (canvas, &CharPtr->extent);
 
-	// Currently, each font char has its own separate data
-	//  but that can change to common mem area
-	dpitch = CharPtr->extent.width;
-	newdata = HMalloc (dpitch * CharPtr->extent.height * sizeof (BYTE));
-	TFB_DrawCanvas_GetFontCharData (canvas, newdata, dpitch);
+	// All chars of a font share one atlas; 'data' points at this
+	// char's cell in it
+	TFB_DrawCanvas_GetFontCharData (canvas, data, dpitch);
 
-	CharPtr->data = newdata;
+	CharPtr->data = data;
 	CharPtr->pitch = dpitch;
 	CharPtr->disp.width = CharPtr->extent.width + 1;
 	CharPtr->disp.height = CharPtr->extent.height + 1;
@@ -151,14 +187,98 @@ processFontChar (TFB_Char* CharPtr, TFB_Canvas canvas)
 	}
 }
 
+// The frames of a drawable are decoded on the work pool as well as on
+// the loading thread. Every frame goes into its own slot, so the
+// drawable comes out the same as when they are decoded one after the
+// other. There is one decode going on at a time, from the thread
+// holding the loader lock.
+#define CEL_DECODE_MIN_FRAMES 4
+		// Fewer than that are not worth handing out
+
+typedef struct
+{
+	uio_DirHandle *dir;
+	char **names;
+	TFB_Canvas *img;
+} CelDecodeJob;
+
+static CelDecodeJob decodeJob;
+static WorkGroup decodeGroup;
+static BOOLEAN decodeGroupInited;
+
+static TFB_Canvas
+loadCel (uio_DirHandle *dir, const char *filename)
+{
+	TFB_Canvas canvas = TFB_DrawCanvas_LoadFromFile (dir, filename);
+	if (canvas == NULL)
+	{
+		const char *err;
+
+		err = TFB_DrawCanvas_GetError ();
+		log_add (log_Warning, "_GetCelData: Unable to load image!");
+		if (err != NULL)
+			log_add (log_Warning, "Gfx Driver reports: %s", err);
+	}
+	return canvas;
+}
+
+static void
+decodeCel (void *data, int i)
+{
+	(void) data;
+	decodeJob.img[i] = loadCel (decodeJob.dir, decodeJob.names[i]);
+}
+
+// Fill img[] with the frames named in names[], NULL where one could not
+// be loaded
+static void
+decodeAllCels (uio_DirHandle *dir, char **names, TFB_Canvas *img,
+		int count)
+{
+	int i;
+
+	if (count < CEL_DECODE_MIN_FRAMES || WorkPool_getWorkerCount () == 0)
+	{
+		for (i = 0; i < count; ++i)
+			img[i] = loadCel (dir, names[i]);
+		return;
+	}
+
+	if (!decodeGroupInited)
+	{
+		WorkGroup_init (&decodeGroup, "Cel decode done");
+		decodeGroupInited = TRUE;
+	}
+
+	decodeJob.dir = dir;
+	decodeJob.names = names;
+	decodeJob.img = img;
+
+	for (i = 0; i < count; ++i)
+		WorkGroup_submit (&decodeGroup, decodeCel, NULL, i);
+	WorkGroup_wait (&decodeGroup);
+}
+
+void
+UninitCelDecoders (void)
+{
+	if (!decodeGroupInited)
+		return;
+
+	WorkGroup_uninit (&decodeGroup);
+	decodeGroupInited = FALSE;
+}
+
 void *
 _GetCelData (uio_Stream *fp, DWORD length)
 {
 	int cel_total, cel_index, n;
+	int num_cels, i;
 	DWORD opos;
 	char CurrentLine[1024], filename[PATH_MAX];
 	TFB_Canvas *img;
 	AniData *ani;
+	char **names;
 	DRAWABLE Drawable;
 	uio_MountHandle *aniMount = 0;
 	uio_DirHandle *aniDir = 0;
@@ -229,7 +349,8 @@ _GetCelData (uio_Stream *fp, DWORD length)
 
 	img = HMalloc (sizeof (TFB_Canvas) * cel_total);
 	ani = HMalloc (sizeof (AniData) * cel_total);
-	if (!img || !ani)
+	names = HMalloc (sizeof (char *) * cel_total);
+	if (!img || !ani || !names)
 	{
 		log_add (log_Warning, "Couldn't allocate space for '%s'", _cur_resfile_name);
 		if (aniMount)
@@ -240,36 +361,45 @@ _GetCelData (uio_Stream *fp, DWORD length)
 		}
 		HFree (img);
 		HFree (ani);
+		HFree (names);
 		return NULL;
 	}
 
-	cel_index = 0;
+	// Read all the frame lines first, so that the frames can be decoded
+	// all at once
+	num_cels = 0;
 	uio_fseek (aniFile, opos, SEEK_SET);
-	while (uio_fgets (CurrentLine, sizeof (CurrentLine), aniFile) && cel_index < cel_total)
+	while (uio_fgets (CurrentLine, sizeof (CurrentLine), aniFile) && num_cels < cel_total)
 	{
-		sscanf (CurrentLine, "%s %d %d %d %d", &filename[n], 
-			&ani[cel_index].transparent_color, &ani[cel_index].colormap_index, 
-			&ani[cel_index].hotspot_x, &ani[cel_index].hotspot_y);
-	
-		img[cel_index] = TFB_DrawCanvas_LoadFromFile (aniDir, filename);
-		if (img[cel_index] == NULL)
-		{
-			const char *err;
+		size_t len;
 
-			err = TFB_DrawCanvas_GetError ();
-			log_add (log_Warning, "_GetCelData: Unable to load image!");
-			if (err != NULL)
-				log_add (log_Warning, "Gfx Driver reports: %s", err);
-		}
-		else
-		{
-			++cel_index;
-		}
+		sscanf (CurrentLine, "%s %d %d %d %d", &filename[n], 
+			&ani[num_cels].transparent_color, &ani[num_cels].colormap_index, 
+			&ani[num_cels].hotspot_x, &ani[num_cels].hotspot_y);
+		len = strlen (filename) + 1;
+		names[num_cels] = HMalloc (len);
+		memcpy (names[num_cels], filename, len);
+		++num_cels;
 
 		if ((int)uio_ftell (aniFile) - (int)opos >= (int)length)
 			break;
 	}
 
+	decodeAllCels (aniDir, names, img, num_cels);
+
+	// Frames that could not be loaded are left out, as before
+	cel_index = 0;
+	for (i = 0; i < num_cels; ++i)
+	{
+		HFree (names[i]);
+		if (img[i] == NULL)
+			continue;
+		img[cel_index] = img[i];
+		ani[cel_index] = ani[i];
+		++cel_index;
+	}
+	HFree (names);
+
 	Drawable = NULL;
 	if (cel_index && (Drawable = AllocDrawable (cel_index)))
 	{
@@ -291,6 +421,9 @@ _GetCelData (uio_Stream *fp, DWORD length)
 			FramePtr = &Drawable->Frame[cel_index];
 			while (--FramePtr, cel_index--)
 				process_image (FramePtr, img, ani, cel_index);
+
+			if (packAtlas && Drawable->MaxIndex > 0)
+				packDrawable (Drawable);
 		}
 	}
 
@@ -316,12 +449,14 @@ _ReleaseCelData (void *handle)
 	DRAWABLE DrawablePtr;
 	int cel_ct;
 	FRAME FramePtr = NULL;
+	TFB_Canvas atlas;
 
 	if ((DrawablePtr = handle) == 0)
 		return (FALSE);
 
 	cel_ct = DrawablePtr->MaxIndex + 1;
 	FramePtr = DrawablePtr->Frame;
+	atlas = DrawablePtr->atlas;
 
 	HFree (handle);
 	if (FramePtr)
@@ -338,6 +473,11 @@ _ReleaseCelData (void *handle)
 		}
 		HFree (FramePtr);
 	}
+	if (atlas)
+	{	// The frame images are deleted on the drawing thread; this goes
+		// after them
+		TFB_DrawScreen_Callback (deleteAtlas, atlas);
+	}
 
 	return (TRUE);
 }
@@ -346,8 +486,13 @@ typedef struct BuildCharDesc
 {
 	TFB_Canvas canvas;
 	UniChar index;
+	COORD x, y;
+			// Position in the font atlas
 } BuildCharDesc;
 
+// Width of the font glyph atlas, unless a char is wider than this
+#define FONT_ATLAS_WIDTH 256
+
 static int
 compareBCDIndex (const void *arg1, const void *arg2)
 {
@@ -357,6 +502,52 @@ compareBCDIndex (const void *arg1, const void *arg2)
 	return (int) bcd1->index - (int) bcd2->index;
 }
 
+// Lay out the (sorted) chars in rows of one shared alpha matrix, and
+// allocate it.  Duplicate chars get no cell; they are dropped later.
+static BYTE *
+allocFontAtlas (BuildCharDesc *bcds, size_t numBCDs, size_t *pitch)
+{
+	size_t bcdI;
+	COORD width = FONT_ATLAS_WIDTH;
+	COORD x = 0, y = 0, rowHeight = 0;
+
+	for (bcdI = 0; bcdI < numBCDs; bcdI++)
+	{
+		EXTENT size;
+		TFB_DrawCanvas_GetExtent (bcds[bcdI].canvas, &size);
+		if (size.width > width)
+			width = size.width;
+	}
+
+	for (bcdI = 0; bcdI < numBCDs; bcdI++)
+	{
+		BuildCharDesc *bcd = &bcds[bcdI];
+		EXTENT size;
+
+		if (bcdI > 0 && bcd->index == bcds[bcdI - 1].index)
+			continue;
+
+		TFB_DrawCanvas_GetExtent (bcd->canvas, &size);
+		if (x + size.width > width)
+		{	// start a new row
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+		bcd->x = x;
+		bcd->y = y;
+		x += size.width;
+		if (size.height > rowHeight)
+			rowHeight = size.height;
+	}
+	y += rowHeight;
+
+	*pitch = width;
+	if (y == 0)
+		return NULL;
+	return HCalloc ((size_t) width * y);
+}
+
 void *
 _GetFontData (uio_Stream *fp, DWORD length)
 {
@@ -368,6 +559,7 @@ _GetFontData (uio_Stream *fp, DWORD length)
 	uio_DirHandle *fontDirHandle = NULL;
 	uio_MountHandle *fontMount = NULL;
 	FONT fontPtr = NULL;
+	size_t atlasPitch;
 
 	if (_cur_resfile_name == 0)
 		goto err;
@@ -469,6 +661,7 @@ _GetFontData (uio_Stream *fp, DWORD length)
 	
 	fontPtr->Leading = 0;
 	fontPtr->LeadingWidth = 0;
+	fontPtr->atlas = allocFontAtlas (bcds, numBCDs, &atlasPitch);
 
 	{
 		size_t startBCD = 0;
@@ -513,7 +706,8 @@ _GetFontData (uio_Stream *fp, DWORD length)
 						continue;
 					}
 					
-					processFontChar (destChar, bcd->canvas);
+					processFontChar (destChar, bcd->canvas, fontPtr->atlas
+							+ bcd->y * atlasPitch + bcd->x, atlasPitch);
 					TFB_DrawCanvas_Delete (bcd->canvas);
 
 					if (destChar->disp.height > fontPtr->Leading)
@@ -573,24 +767,15 @@ _ReleaseFontData (void *handle)
 
 		for (page = font->fontPages; page != NULL; page = nextPage)
 		{
-			size_t charI;
-			for (charI = 0; charI < page->numChars; charI++)
-			{
-				TFB_Char *c = &page->charDesc[charI];
-				
-				if (c->data == NULL)
-					continue;
-				
-				// XXX: fix this if fonts get per-page data
-				//  rather than per-char
-				TFB_DrawScreen_DeleteData (c->data);
-			}
-		
 			nextPage = page->next;
 			FreeFontPage (page);
 		}
 	}
 
+	// The char data lives in the atlas, which queued text may still
+	// be using
+	TFB_DrawScreen_DeleteData (font->atlas);
+
 	HFree (font);
 
 	return TRUE;
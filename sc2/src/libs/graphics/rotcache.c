@@ -0,0 +1,263 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "port.h"
+#include "libs/graphics/rotcache.h"
+#include "libs/threadlib.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+
+#define ROTCACHE_BUCKETS 64
+
+typedef struct rotcache_entry
+{
+	struct rotcache_entry *hashNext;
+	struct rotcache_entry *lruPrev;
+	struct rotcache_entry *lruNext;
+			// The LRU list runs from the most to the least recently used
+	TFB_Image *source;
+	DWORD version;
+	int angle;
+	TFB_Canvas canvas;
+	size_t size;
+} RotCacheEntry;
+
+static RotCacheEntry *buckets[ROTCACHE_BUCKETS];
+static RotCacheEntry *lruHead;
+static RotCacheEntry *lruTail;
+static size_t cacheSize;
+static size_t cacheLimit = TFB_ROTCACHE_DEFAULT_LIMIT;
+static Mutex cacheMutex;
+
+static struct
+{
+	DWORD hits;
+	DWORD misses;
+	DWORD evictions;
+} stats;
+
+static inline int
+normalizeAngle (int angle)
+{
+	angle %= 360;
+	if (angle < 0)
+		angle += 360;
+	return angle;
+}
+
+static inline RotCacheEntry **
+bucketFor (TFB_Image *src, int angle)
+{
+	uintptr_t key = ((uintptr_t) src >> 4) ^ ((uintptr_t) angle * 31);
+	return &buckets[key % ROTCACHE_BUCKETS];
+}
+
+static void
+lruUnlink (RotCacheEntry *e)
+{
+	if (e->lruPrev)
+		e->lruPrev->lruNext = e->lruNext;
+	else
+		lruHead = e->lruNext;
+	if (e->lruNext)
+		e->lruNext->lruPrev = e->lruPrev;
+	else
+		lruTail = e->lruPrev;
+}
+
+static void
+lruPushFront (RotCacheEntry *e)
+{
+	e->lruPrev = NULL;
+	e->lruNext = lruHead;
+	if (lruHead)
+		lruHead->lruPrev = e;
+	else
+		lruTail = e;
+	lruHead = e;
+}
+
+static void
+removeEntry (RotCacheEntry *e)
+{
+	RotCacheEntry **link = bucketFor (e->source, e->angle);
+
+	while (*link != e)
+		link = &(*link)->hashNext;
+	*link = e->hashNext;
+	lruUnlink (e);
+
+	cacheSize -= e->size;
+	TFB_DrawCanvas_Delete (e->canvas);
+	HFree (e);
+}
+
+static void
+evictToLimit (size_t limit)
+{
+	while (lruTail && cacheSize > limit)
+	{
+		removeEntry (lruTail);
+		++stats.evictions;
+	}
+}
+
+void
+TFB_InitRotationCache (void)
+{
+	cacheMutex = CreateMutex ("rotation cache lock", SYNC_CLASS_VIDEO);
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+}
+
+void
+TFB_UninitRotationCache (void)
+{
+	if (!cacheMutex)
+		return;
+
+	log_add (log_Debug, "Rotation cache: %lu hits, %lu misses, "
+			"%lu evictions", (unsigned long) stats.hits,
+			(unsigned long) stats.misses,
+			(unsigned long) stats.evictions);
+
+	LockMutex (cacheMutex);
+	evictToLimit (0);
+	UnlockMutex (cacheMutex);
+
+	DestroyMutex (cacheMutex);
+	cacheMutex = 0;
+}
+
+void
+TFB_SetRotationCacheLimit (size_t bytes)
+{
+	if (!cacheMutex)
+	{	// Not initialised yet
+		cacheLimit = bytes;
+		return;
+	}
+
+	LockMutex (cacheMutex);
+	cacheLimit = bytes;
+	evictToLimit (cacheLimit);
+	UnlockMutex (cacheMutex);
+}
+
+TFB_Canvas
+TFB_RotationCache_Get (TFB_Image *src, int angle)
+{
+	RotCacheEntry *e;
+	TFB_Canvas result = NULL;
+
+	if (!cacheMutex || cacheLimit == 0)
+		return NULL;
+
+	angle = normalizeAngle (angle);
+
+	LockMutex (cacheMutex);
+	for (e = *bucketFor (src, angle); e != NULL; e = e->hashNext)
+	{
+		if (e->source == src && e->angle == angle)
+			break;
+	}
+
+	if (e && e->version != src->version)
+	{	// The source has been drawn to since
+		removeEntry (e);
+		e = NULL;
+	}
+
+	if (e)
+	{
+		lruUnlink (e);
+		lruPushFront (e);
+		result = TFB_DrawCanvas_New_Copy (e->canvas);
+		++stats.hits;
+	}
+	else
+	{
+		++stats.misses;
+	}
+	UnlockMutex (cacheMutex);
+
+	return result;
+}
+
+void
+TFB_RotationCache_Put (TFB_Image *src, int angle, TFB_Canvas rotated)
+{
+	RotCacheEntry *e;
+	RotCacheEntry **bucket;
+	EXTENT extent;
+	size_t size;
+
+	if (!cacheMutex || cacheLimit == 0)
+		return;
+
+	TFB_DrawCanvas_GetExtent (rotated, &extent);
+	size = (size_t) TFB_DrawCanvas_GetStride (rotated) * extent.height;
+	if (size > cacheLimit / 4)
+		return; // Would push out too much else
+
+	angle = normalizeAngle (angle);
+
+	LockMutex (cacheMutex);
+	bucket = bucketFor (src, angle);
+	for (e = *bucket; e != NULL; e = e->hashNext)
+	{
+		if (e->source == src && e->angle == angle)
+			break;
+	}
+	if (e)
+	{	// Stale, or another thread got here first
+		removeEntry (e);
+	}
+
+	e = HMalloc (sizeof (RotCacheEntry));
+	e->source = src;
+	e->version = src->version;
+	e->angle = angle;
+	e->canvas = TFB_DrawCanvas_New_Copy (rotated);
+	e->size = size;
+	e->hashNext = *bucket;
+	*bucket = e;
+	lruPushFront (e);
+	cacheSize += size;
+
+	evictToLimit (cacheLimit);
+	UnlockMutex (cacheMutex);
+}
+
+void
+TFB_RotationCache_Invalidate (TFB_Image *src)
+{
+	RotCacheEntry *e;
+	RotCacheEntry *next;
+
+	if (!cacheMutex)
+		return;
+
+	LockMutex (cacheMutex);
+	for (e = lruHead; e != NULL; e = next)
+	{
+		next = e->lruNext;
+		if (e->source == src)
+			removeEntry (e);
+	}
+	UnlockMutex (cacheMutex);
+}
@@ -0,0 +1,45 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef ROTCACHE_H_INCL__
+#define ROTCACHE_H_INCL__
+
+#include "libs/graphics/tfb_draw.h"
+
+/* Cache of rotated image canvases, used by TFB_DrawImage_New_Rotated().
+ * Entries are keyed on the source image, its version, and the angle
+ * in whole degrees; the least recently used ones are evicted once the
+ * cache holds more than the limit in bytes.  The cache owns its
+ * canvases and hands out copies, since every rotated image is freed
+ * separately by its owner.  All functions are safe to call from any
+ * thread. */
+
+// Default limit, overridden by config.rotcachesize
+#define TFB_ROTCACHE_DEFAULT_LIMIT (4 * 1024 * 1024)
+
+void TFB_InitRotationCache (void);
+void TFB_UninitRotationCache (void);
+void TFB_SetRotationCacheLimit (size_t bytes);
+		// 0 disables the cache
+
+// Returns a new copy of the cached rotation, or NULL on a miss
+TFB_Canvas TFB_RotationCache_Get (TFB_Image *src, int angle);
+// Stores a copy of 'rotated'; the caller keeps its canvas
+void TFB_RotationCache_Put (TFB_Image *src, int angle, TFB_Canvas rotated);
+// Drops all rotations of 'src'; called when it is deleted
+void TFB_RotationCache_Invalidate (TFB_Image *src);
+
+#endif /* ROTCACHE_H_INCL__ */
@@ -0,0 +1,224 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Each entry is a file of its own, named after its key, scale and scale
+// type. It starts with a header of 32-bit little endian numbers:
+//   "USCL", version, key (low, high), scale, scale type,
+//   width, height, hotspot x, y of the scaled image,
+//   hotspot x, y of the source and of its mipmap, bytes per pixel
+// followed by the pixels, row after row. The hotspots of the source are
+// not in the key, so an entry made for other ones is taken as a miss,
+// and replaced.
+//
+// Entries are never removed; delete the directory to start over.
+
+#include "port.h"
+#include "options.h"
+#include "libs/graphics/scaledisk.h"
+#include "libs/graphics/gfx_common.h"
+#include "libs/uio.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SCALEDISK_DIR "scalecache"
+#define SCALEDISK_MAGIC "USCL"
+#define SCALEDISK_VERSION 1
+#define SCALEDISK_HEADER_DWORDS 15
+#define SCALEDISK_MAX_SIZE 4096
+		// Width or height larger than that means the file is broken
+
+static uio_DirHandle *cacheDir;
+
+void
+TFB_SetScaleDiskCache (BOOLEAN enable)
+{
+	if (cacheDir)
+	{
+		uio_closeDir (cacheDir);
+		cacheDir = NULL;
+	}
+	if (!enable || !configDir)
+		return;
+
+	uio_mkdir (configDir, SCALEDISK_DIR, 0777);
+			// Fails if it is there already, which is fine
+	cacheDir = uio_openDirRelative (configDir, SCALEDISK_DIR, 0);
+	if (!cacheDir)
+		log_add (log_Warning, "Could not open the scaled image cache "
+				"directory; not using it.");
+}
+
+static void
+putDword (BYTE *buf, DWORD val)
+{
+	buf[0] = val & 0xff;
+	buf[1] = (val >> 8) & 0xff;
+	buf[2] = (val >> 16) & 0xff;
+	buf[3] = (val >> 24) & 0xff;
+}
+
+static DWORD
+getDword (const BYTE *buf)
+{
+	return (DWORD) buf[0] | ((DWORD) buf[1] << 8) |
+			((DWORD) buf[2] << 16) | ((DWORD) buf[3] << 24);
+}
+
+static uint64
+imageKey (TFB_Image *image, int type)
+{
+	uint64 hash = 0xcbf29ce484222325ULL;
+			// FNV-1a offset basis
+
+	hash = TFB_DrawCanvas_Hash (image->NormalImg, hash);
+	if (type == TFB_SCALE_TRILINEAR && image->MipmapImg)
+		hash = TFB_DrawCanvas_Hash (image->MipmapImg, hash);
+	return hash;
+}
+
+static void
+entryName (char *buf, size_t size, uint64 key, int target, int type)
+{
+	snprintf (buf, size, "%08lx%08lx-%d-%d.scl",
+			(unsigned long) (key >> 32), (unsigned long) (key & 0xffffffff),
+			target, type);
+}
+
+// The header for the image as it is now
+static void
+makeHeader (BYTE *header, TFB_Image *image, int target, int type,
+		uint64 key)
+{
+	memcpy (header, SCALEDISK_MAGIC, 4);
+	putDword (header + 4, SCALEDISK_VERSION);
+	putDword (header + 8, (DWORD) (key & 0xffffffff));
+	putDword (header + 12, (DWORD) (key >> 32));
+	putDword (header + 16, (DWORD) target);
+	putDword (header + 20, (DWORD) type);
+	putDword (header + 24, (DWORD) image->extent.width);
+	putDword (header + 28, (DWORD) image->extent.height);
+	putDword (header + 32, (DWORD) (SDWORD) image->last_scale_hs.x);
+	putDword (header + 36, (DWORD) (SDWORD) image->last_scale_hs.y);
+	putDword (header + 40, (DWORD) (SDWORD) image->NormalHs.x);
+	putDword (header + 44, (DWORD) (SDWORD) image->NormalHs.y);
+	putDword (header + 48, (DWORD) (SDWORD) image->MipmapHs.x);
+	putDword (header + 52, (DWORD) (SDWORD) image->MipmapHs.y);
+	putDword (header + 56,
+			(DWORD) TFB_DrawCanvas_GetPixelSize (image->ScaledImg));
+}
+
+BOOLEAN
+TFB_ScaleDiskCache_Load (TFB_Image *image, int target, int type,
+		uint64 *key)
+{
+	char name[64];
+	uio_Stream *stream;
+	BYTE header[SCALEDISK_HEADER_DWORDS * 4];
+	BYTE expected[SCALEDISK_HEADER_DWORDS * 4];
+	DWORD width, height;
+	size_t size;
+	BYTE *data;
+	BOOLEAN ok;
+
+	*key = 0;
+	if (!cacheDir)
+		return FALSE;
+
+	*key = imageKey (image, type);
+	entryName (name, sizeof name, *key, target, type);
+	stream = uio_fopen (cacheDir, name, "rb");
+	if (!stream)
+		return FALSE;
+
+	if (uio_fread (header, sizeof header, 1, stream) != 1)
+	{
+		uio_fclose (stream);
+		return FALSE;
+	}
+	// All but the size and hotspot of the scaled image must match
+	makeHeader (expected, image, target, type, *key);
+	width = getDword (header + 24);
+	height = getDword (header + 28);
+	if (memcmp (header, expected, 24) != 0
+			|| memcmp (header + 40, expected + 40, sizeof header - 40) != 0
+			|| width == 0 || height == 0 || width > SCALEDISK_MAX_SIZE
+			|| height > SCALEDISK_MAX_SIZE)
+	{
+		uio_fclose (stream);
+		return FALSE;
+	}
+
+	size = (size_t) width * height * getDword (header + 56);
+	data = HMalloc (size);
+	ok = uio_fread (data, size, 1, stream) == 1
+			&& TFB_DrawCanvas_SetPixels (image->ScaledImg, width, height,
+			data);
+	HFree (data);
+	uio_fclose (stream);
+	if (!ok)
+		return FALSE;
+
+	image->extent.width = width;
+	image->extent.height = height;
+	image->last_scale_hs.x = (SDWORD) getDword (header + 32);
+	image->last_scale_hs.y = (SDWORD) getDword (header + 36);
+	return TRUE;
+}
+
+void
+TFB_ScaleDiskCache_Save (TFB_Image *image, int target, int type,
+		uint64 key)
+{
+	char name[64];
+	uio_Stream *stream;
+	BYTE header[SCALEDISK_HEADER_DWORDS * 4];
+	size_t size;
+	BYTE *data;
+	BOOLEAN ok;
+
+	if (!cacheDir)
+		return;
+
+	size = (size_t) image->extent.width * image->extent.height
+			* TFB_DrawCanvas_GetPixelSize (image->ScaledImg);
+	data = HMalloc (size);
+	if (!TFB_DrawCanvas_GetPixels (image->ScaledImg, image->extent.width,
+			image->extent.height, data))
+	{
+		HFree (data);
+		return;
+	}
+
+	entryName (name, sizeof name, key, target, type);
+	stream = uio_fopen (cacheDir, name, "wb");
+	if (!stream)
+	{
+		HFree (data);
+		return;
+	}
+	makeHeader (header, image, target, type, key);
+	ok = uio_fwrite (header, sizeof header, 1, stream) == 1
+			&& uio_fwrite (data, size, 1, stream) == 1;
+	uio_fclose (stream);
+	HFree (data);
+
+	if (!ok)
+	{	// Would only be taken as a miss, but do not leave it around
+		uio_unlink (cacheDir, name);
+	}
+}
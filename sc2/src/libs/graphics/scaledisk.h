@@ -0,0 +1,38 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef SCALEDISK_H_INCL__
+#define SCALEDISK_H_INCL__
+
+#include "libs/graphics/tfb_draw.h"
+
+/* Cache on disk of what TFB_DrawImage_FixScaling() makes of an image,
+ * kept in "scalecache" in the config dir when config.scalediskcache is
+ * on.  Entries are found by a hash of the source image (and of its
+ * mipmap for trilinear scaling), the scale and the scale type, so an
+ * image that was changed simply misses.  Nearest scaling does not go
+ * through it, as it is cheaper than reading a file.  Called with the
+ * image mutex held. */
+
+// Fills in image->ScaledImg, extent and last_scale_hs from the cache.
+// Returns FALSE on a miss; 'key' is then set for the _Save() call
+// after scaling.
+BOOLEAN TFB_ScaleDiskCache_Load (TFB_Image *image, int target, int type,
+		uint64 *key);
+void TFB_ScaleDiskCache_Save (TFB_Image *image, int target, int type,
+		uint64 key);
+
+#endif /* SCALEDISK_H_INCL__ */
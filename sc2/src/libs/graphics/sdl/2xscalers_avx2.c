@@ -0,0 +1,91 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "port.h"
+
+#ifndef USE_RUST_GFX
+/* Replaced by Rust: rust/src/graphics/scaling.rs */
+
+#include "libs/platform.h"
+
+#if defined(AVX2_INTRIN)
+
+#include "libs/graphics/sdl/sdl_common.h"
+#include "types.h"
+#include "scalers.h"
+#include "scaleint.h"
+#include "2xscalers.h"
+#include "2xscalers_simd.h"
+
+// AVX2 name for all functions
+#undef SCALE_
+#define SCALE_(name) Scale ## _AVX2_ ## name
+
+// Bring in the vector kernels
+#define SCALE_SIMD_AVX2
+#include "scalesimd.h"
+
+
+// Scaler function lookup table
+//	Biadapt and advanced biadapt decide pixel by pixel with little
+//	math to share between neighbours; they stay plain C.
+//
+const Scale_FuncDef_t
+Scale_AVX2_Functions[] =
+{
+	{TFB_GFXFLAGS_SCALE_BILINEAR,   Scale_AVX2_BilinearFilter},
+	{TFB_GFXFLAGS_SCALE_BIADAPT,    Scale_BiAdaptFilter},
+	{TFB_GFXFLAGS_SCALE_BIADAPTADV, Scale_BiAdaptAdvFilter},
+	{TFB_GFXFLAGS_SCALE_TRISCAN,    Scale_AVX2_TriScanFilter},
+	{TFB_GFXFLAGS_SCALE_HQXX,       Scale_AVX2_HqFilter},
+	// Default
+	{0,                             Scale_AVX2_Nearest}
+};
+
+
+// Nearest Neighbor scaling to 2x
+//	void Scale_AVX2_Nearest (SDL_Surface *src,
+//			SDL_Surface *dst, SDL_Rect *r)
+
+#include "nearest2x.c"
+
+
+// Bilinear scaling to 2x
+//	void Scale_AVX2_BilinearFilter (SDL_Surface *src,
+//			SDL_Surface *dst, SDL_Rect *r)
+
+#include "bilinear2x.c"
+
+
+// Triscan scaling to 2x
+// derivative of scale2x -- scale2x.sf.net
+//	void Scale_AVX2_TriScanFilter (SDL_Surface *src,
+//			SDL_Surface *dst, SDL_Rect *r)
+
+#include "triscan2x.c"
+
+
+// Hq2x scaling
+//		(adapted from 'hq2x' by Maxim Stepin -- www.hiend3d.com/hq2x.html)
+//	void Scale_AVX2_HqFilter (SDL_Surface *src,
+//			SDL_Surface *dst, SDL_Rect *r)
+
+#include "hq2x.c"
+
+#endif /* AVX2_INTRIN */
+
+#endif /* !USE_RUST_GFX */
+
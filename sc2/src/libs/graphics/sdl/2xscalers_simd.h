@@ -0,0 +1,47 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef LIBS_GRAPHICS_SDL_2XSCALERS_SIMD_H_
+#define LIBS_GRAPHICS_SDL_2XSCALERS_SIMD_H_
+
+// SSE2 versions
+void Scale_SSE2_Nearest (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_SSE2_BilinearFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_SSE2_TriScanFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_SSE2_HqFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+
+extern const Scale_FuncDef_t Scale_SSE2_Functions[];
+
+
+// AVX2 versions
+void Scale_AVX2_Nearest (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_AVX2_BilinearFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_AVX2_TriScanFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_AVX2_HqFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+
+extern const Scale_FuncDef_t Scale_AVX2_Functions[];
+
+
+// NEON (ARM) versions
+void Scale_NEON_Nearest (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_NEON_BilinearFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_NEON_TriScanFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+void Scale_NEON_HqFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r);
+
+extern const Scale_FuncDef_t Scale_NEON_Functions[];
+
+
+#endif /* LIBS_GRAPHICS_SDL_2XSCALERS_SIMD_H_ */
@@ -31,6 +31,7 @@
 //		Scale_BilinearFilter (for plain C) or
 //		Scale_MMX_BilinearFilter (for MMX)
 //		Scale_SSE_BilinearFilter (for SSE)
+//		Scale_SSE2_BilinearFilter (for SSE2, likewise AVX2 and NEON)
 //		[others when platforms are added]
 void
 SCALE_(BilinearFilter) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
@@ -84,7 +85,19 @@ SCALE_(BilinearFilter) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
 		SCALE_(Prefetch) (srow1 + 16);
 		SCALE_(Prefetch) (srow1 + 32);
 
-		for (x = region->x; x < xend; ++x, ++srow0, ++srow1, dst_p += 2)
+		x = region->x;
+#ifdef SCALE_BILINEAR_ROW
+		{	// vector versions blend as much of the row as they can;
+			// the last column always needs the temp pixel rows below
+			int done = SCALE_BILINEAR_ROW (srow0, srow1, dst_p, dlen,
+					(xend < w ? xend : w - 1) - x);
+			x += done;
+			srow0 += done;
+			srow1 += done;
+			dst_p += done * 2;
+		}
+#endif
+		for (; x < xend; ++x, ++srow0, ++srow1, dst_p += 2)
 		{
 			if (x < w - 1)
 			{	// can blend directly from pixels
@@ -95,6 +95,37 @@ TFB_DrawCanvas_Line (int x1, int y1, int x2, int y2, Color color,
 	SDL_UnlockSurface (dst);
 }
 
+void
+TFB_DrawCanvas_Polyline (const POINT *points, COUNT count, POINT offset,
+		Color color, DrawMode mode, TFB_Canvas target)
+{
+	SDL_Surface *dst = target;
+	SDL_PixelFormat *fmt = dst->format;
+	Uint32 sdlColor;
+	RenderPixelFn plotFn;
+	COUNT i;
+
+	checkPrimitiveMode (dst, &color, &mode);
+	sdlColor = SDL_MapRGBA (fmt, color.r, color.g, color.b, color.a);
+
+	plotFn = renderpixel_for (target, mode.kind);
+	if (!plotFn)
+	{
+		log_add (log_Warning, "ERROR: TFB_DrawCanvas_Polyline "
+				"unsupported draw mode (%d)", (int)mode.kind);
+		return;
+	}
+
+	SDL_LockSurface (dst);
+	for (i = 1; i < count; ++i)
+	{
+		line_prim (points[i - 1].x + offset.x, points[i - 1].y + offset.y,
+				points[i].x + offset.x, points[i].y + offset.y,
+				sdlColor, plotFn, mode.factor, dst);
+	}
+	SDL_UnlockSurface (dst);
+}
+
 void
 TFB_DrawCanvas_Rect (RECT *rect, Color color, DrawMode mode, TFB_Canvas target)
 {
@@ -123,8 +154,8 @@ TFB_DrawCanvas_Rect (RECT *rect, Color color, DrawMode mode, TFB_Canvas target)
 	}
 	else
 	{	// Custom fillrect rendering
-		RenderPixelFn plotFn = renderpixel_for (target, mode.kind);
-		if (!plotFn)
+		RenderSpanFn spanFn = renderspan_for (target, mode.kind);
+		if (!spanFn)
 		{
 			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Rect "
 					"unsupported draw mode (%d)", (int)mode.kind);
@@ -132,7 +163,7 @@ TFB_DrawCanvas_Rect (RECT *rect, Color color, DrawMode mode, TFB_Canvas target)
 		}
 
 		SDL_LockSurface (dst);
-		fillrect_prim (sr, sdlColor, plotFn, mode.factor, dst);
+		fillrect_prim (sr, sdlColor, spanFn, mode.factor, dst);
 		SDL_UnlockSurface (dst);
 	}
 }
@@ -161,8 +192,8 @@ TFB_DrawCanvas_Blit (SDL_Surface *src, SDL_Rect *src_r,
 	else
 	{	// Custom blit
 		SDL_Rect loc_src_r, loc_dst_r;
-		RenderPixelFn plotFn = renderpixel_for (dst, mode.kind);
-		if (!plotFn)
+		RenderSpanFn spanFn = renderspan_for (dst, mode.kind);
+		if (!spanFn)
 		{
 			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Blit "
 					"unsupported draw mode (%d)", (int)mode.kind);
@@ -188,11 +219,126 @@ TFB_DrawCanvas_Blit (SDL_Surface *src, SDL_Rect *src_r,
 		}
 
 		SDL_LockSurface (dst);
-		blt_prim (src, *src_r, plotFn, mode.factor, dst, *dst_r);
+		blt_prim (src, *src_r, spanFn, mode.factor, dst, *dst_r);
 		SDL_UnlockSurface (dst);
 	}
 }
 
+static void
+expandPalettedRow (Uint32 *out, const Uint8 *in, int w, const Uint32 *lut)
+{
+	int x;
+
+	for (x = 0; x + 4 <= w; x += 4)
+	{
+		out[x] = lut[in[x]];
+		out[x + 1] = lut[in[x + 1]];
+		out[x + 2] = lut[in[x + 2]];
+		out[x + 3] = lut[in[x + 3]];
+	}
+	for (; x < w; ++x)
+		out[x] = lut[in[x]];
+}
+
+// Converts an 8-bit surface to the 32-bit screen format through a table
+// of its mapped palette colors, which is faster than SDL_ConvertSurface()
+// with its generic per-pixel mapping.
+// Returns NULL when the formats do not allow this.
+static SDL_Surface *
+expandPalettedImage (SDL_Surface *src)
+{
+	SDL_PixelFormat *dstfmt = SDL_Screen->format;
+	SDL_Palette *pal = src->format->palette;
+	SDL_Surface *dst;
+	Uint32 lut[256];
+	Uint32 key;
+	BOOLEAN keyed;
+	int i, y;
+
+	if (src->format->BytesPerPixel != 1 || !pal
+			|| dstfmt->BytesPerPixel != 4 || TFB_HasSurfaceAlphaMod (src))
+		return NULL;
+
+	dst = SDL_CreateRGBSurface (SDL_SWSURFACE, src->w, src->h, 32,
+			dstfmt->Rmask, dstfmt->Gmask, dstfmt->Bmask, dstfmt->Amask);
+	if (!dst)
+		return NULL;
+
+	memset (lut, 0, sizeof lut);
+	for (i = 0; i < pal->ncolors && i < 256; ++i)
+		lut[i] = SDL_MapRGB (dst->format, pal->colors[i].r,
+				pal->colors[i].g, pal->colors[i].b);
+
+	keyed = TFB_GetColorKey (src, &key) == 0 && key < 256;
+	if (keyed)
+	{	// The key is an index; other indexes with the same color must
+		// not turn transparent, so they are made a shade bluer.
+		for (i = 0; i < 256; ++i)
+		{
+			if ((Uint32) i != key && lut[i] == lut[key])
+				lut[i] ^= 1 << dst->format->Bshift;
+		}
+	}
+
+	SDL_LockSurface (src);
+	for (y = 0; y < src->h; ++y)
+	{
+		expandPalettedRow ((Uint32 *) ((Uint8 *) dst->pixels
+				+ y * dst->pitch), (const Uint8 *) src->pixels
+				+ y * src->pitch, src->w, lut);
+	}
+	SDL_UnlockSurface (src);
+
+	if (keyed)
+		TFB_SetColorKey (dst, lut[key], 0);
+
+	return dst;
+}
+
+// Returns NormalImg converted to screen format with the colors of cmap.
+// The conversion is kept until cmap or NormalImg changes, so an image
+// drawn many times with the same colormap is only converted once, and
+// a colormap change only costs the images that are drawn with it.
+// NormalImg must already have the cmap palette set.
+// The result is RLE encoded when it has a transparent color, so it may
+// only be drawn with SDL_BlitSurface() without any surface alpha; the
+// pixels of an RLE surface cannot be read directly, and changing the
+// alpha would make SDL encode it again.
+static SDL_Surface *
+getConvertedImage (TFB_Image *img, TFB_ColorMap *cmap)
+{
+	SDL_Surface *conv;
+	Uint32 key;
+
+	if (img->ConvertedImg && img->converted_cmap_index == cmap->index
+			&& img->converted_cmap_version == cmap->version
+			&& img->converted_version == img->version)
+		return img->ConvertedImg;
+
+	if (img->ConvertedImg)
+	{
+		TFB_DrawCanvas_Delete (img->ConvertedImg);
+		img->ConvertedImg = NULL;
+	}
+
+	conv = expandPalettedImage (img->NormalImg);
+	if (!conv)
+		conv = TFB_DisplayFormatAlpha (img->NormalImg);
+	if (!conv || conv == img->NormalImg)
+		return img->NormalImg;
+
+	// Mostly transparent sprites blit much faster as runs of opaque
+	// pixels with the transparent ones skipped
+	if (TFB_GetColorKey (conv, &key) == 0)
+		TFB_SetColorKey (conv, key, TRUE);
+
+	img->ConvertedImg = conv;
+	img->converted_cmap_index = cmap->index;
+	img->converted_cmap_version = cmap->version;
+	img->converted_version = img->version;
+	return conv;
+}
+
 // XXX: If a colormap is passed in, it has to have been acquired via
 // TFB_GetColorMap(). We release the colormap at the end.
 void
@@ -253,6 +399,9 @@ TFB_DrawCanvas_Image (TFB_Image *img, int x, int y, int scale,
 	else
 	{
 		surf = img->NormalImg;
+		if (NormalPal && cmap && mode.kind == DRAW_REPLACE)
+			surf = getConvertedImage (img, cmap);
+				// other modes draw the paletted image itself
 		pSrcRect = NULL;
 
 		targetRect.x = x - img->NormalHs.x;
@@ -503,49 +652,20 @@ TFB_DrawCanvas_FilledImage (TFB_Image *img, int x, int y, int scale,
 	UnlockMutex (img->mutex);
 }
 
-void
-TFB_DrawCanvas_FontChar (TFB_Char *fontChar, TFB_Image *backing,
-		int x, int y, DrawMode mode, TFB_Canvas target)
+// Transfer the char's alpha to the backing surface and blit it.
+// The backing mutex must be held.
+static void
+blitFontChar (TFB_Char *fontChar, SDL_Surface *surf, int x, int y,
+		DrawMode mode, SDL_Surface *dst)
 {
-	SDL_Surface *dst = target;
 	SDL_Rect srcRect, targetRect;
-	SDL_Surface *surf;
-	int w, h;
-
-	if (fontChar == 0)
-	{
-		log_add (log_Warning, "ERROR: "
-				"TFB_DrawCanvas_FontChar passed null char ptr");
-		return;
-	}
-	if (backing == 0)
-	{
-		log_add (log_Warning, "ERROR: "
-				"TFB_DrawCanvas_FontChar passed null backing ptr");
-		return;
-	}
-
-	w = fontChar->extent.width;
-	h = fontChar->extent.height;
-
-	LockMutex (backing->mutex);
-
-	surf = backing->NormalImg;
-	if (surf->format->BytesPerPixel != 4
-			|| surf->w < w || surf->h < h)
-	{
-		log_add (log_Warning, "ERROR: "
-				"TFB_DrawCanvas_FontChar bad backing surface: %dx%dx%d; "
-				"char: %dx%d",
-				surf->w, surf->h, (int)surf->format->BytesPerPixel, w, h);
-		UnlockMutex (backing->mutex);
-		return;
-	}
+	const int w = fontChar->extent.width;
+	const int h = fontChar->extent.height;
 
 	srcRect.x = 0;
 	srcRect.y = 0;
-	srcRect.w = fontChar->extent.width;
-	srcRect.h = fontChar->extent.height;
+	srcRect.w = w;
+	srcRect.h = h;
 
 	targetRect.x = x - fontChar->HotSpot.x;
 	targetRect.y = y - fontChar->HotSpot.y;
@@ -601,6 +721,82 @@ TFB_DrawCanvas_FontChar (TFB_Char *fontChar, TFB_Image *backing,
 	SDL_UnlockSurface (surf);
 
 	TFB_DrawCanvas_Blit (surf, &srcRect, dst, &targetRect, mode);
+}
+
+static BOOLEAN
+checkFontBacking (SDL_Surface *surf, int w, int h)
+{
+	if (surf->format->BytesPerPixel != 4
+			|| surf->w < w || surf->h < h)
+	{
+		log_add (log_Warning, "ERROR: "
+				"TFB_DrawCanvas_FontChar bad backing surface: %dx%dx%d; "
+				"char: %dx%d",
+				surf->w, surf->h, (int)surf->format->BytesPerPixel, w, h);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void
+TFB_DrawCanvas_FontChar (TFB_Char *fontChar, TFB_Image *backing,
+		int x, int y, DrawMode mode, TFB_Canvas target)
+{
+	SDL_Surface *surf;
+
+	if (fontChar == 0)
+	{
+		log_add (log_Warning, "ERROR: "
+				"TFB_DrawCanvas_FontChar passed null char ptr");
+		return;
+	}
+	if (backing == 0)
+	{
+		log_add (log_Warning, "ERROR: "
+				"TFB_DrawCanvas_FontChar passed null backing ptr");
+		return;
+	}
+
+	LockMutex (backing->mutex);
+
+	surf = backing->NormalImg;
+	if (checkFontBacking (surf, fontChar->extent.width,
+			fontChar->extent.height))
+		blitFontChar (fontChar, surf, x, y, mode, target);
+
+	UnlockMutex (backing->mutex);
+}
+
+void
+TFB_DrawCanvas_TextRun (const TFB_TextGlyph *glyphs, COUNT count,
+		TFB_Image *backing, DrawMode mode, TFB_Canvas target)
+{
+	SDL_Surface *surf;
+	COUNT i;
+
+	if (backing == 0)
+	{
+		log_add (log_Warning, "ERROR: "
+				"TFB_DrawCanvas_TextRun passed null backing ptr");
+		return;
+	}
+
+	// The backing is shared by all the chars, so it is only
+	// locked once for the whole run
+	LockMutex (backing->mutex);
+
+	surf = backing->NormalImg;
+	for (i = 0; i < count; ++i)
+	{
+		TFB_Char *fontChar = glyphs[i].fontChar;
+
+		if (!checkFontBacking (surf, fontChar->extent.width,
+				fontChar->extent.height))
+			break;
+		blitFontChar (fontChar, surf, glyphs[i].x, glyphs[i].y, mode,
+				target);
+	}
+
 	UnlockMutex (backing->mutex);
 }
 
@@ -754,6 +950,318 @@ TFB_DrawCanvas_New_RotationTarget (TFB_Canvas src_canvas, int angle)
 	return newsurf;
 }
 
+TFB_Canvas
+TFB_DrawCanvas_New_Copy (TFB_Canvas src_canvas)
+{
+	SDL_Surface *src = src_canvas;
+	SDL_Surface *newsurf;
+	int y;
+
+	newsurf = SDL_CreateRGBSurface (SDL_SWSURFACE, src->w, src->h,
+				src->format->BitsPerPixel,
+				src->format->Rmask,
+				src->format->Gmask,
+				src->format->Bmask,
+				src->format->Amask);
+	if (!newsurf)
+	{
+		log_add (log_Fatal, "TFB_DrawCanvas_New_Copy()"
+				" INTERNAL PANIC: Failed to create TFB_Canvas: %s",
+				SDL_GetError());
+		exit (EXIT_FAILURE);
+	}
+
+	if (src->format->palette)
+		TFB_SetColors (newsurf, src->format->palette->colors, 0,
+				src->format->palette->ncolors);
+	TFB_DrawCanvas_CopyTransparencyInfo (src, newsurf);
+
+	// A straight copy of the pixels; a blit would blend
+	SDL_LockSurface (src);
+	SDL_LockSurface (newsurf);
+	for (y = 0; y < src->h; ++y)
+	{
+		memcpy ((Uint8 *) newsurf->pixels + y * newsurf->pitch,
+				(const Uint8 *) src->pixels + y * src->pitch,
+				src->w * src->format->BytesPerPixel);
+	}
+	SDL_UnlockSurface (newsurf);
+	SDL_UnlockSurface (src);
+
+	return newsurf;
+}
+
+#define ATLAS_MAX_SIZE 4096
+#define ATLAS_PADDING 1
+		// Empty pixels between frames, so that filtering one does not
+		// pick up its neighbours
+
+// Lay the canvases out in rows, in order, in an atlas about as wide as
+// it is high. Returns FALSE if it would get too big.
+static BOOLEAN
+layoutAtlas (SDL_Surface **surfs, int count, SDL_Rect *rects, int *width,
+		int *height)
+{
+	long area = 0;
+	int side = 0, w = 0, x = 0, y = 0, rowHeight = 0, i;
+
+	for (i = 0; i < count; ++i)
+	{
+		area += (long) (surfs[i]->w + ATLAS_PADDING)
+				* (surfs[i]->h + ATLAS_PADDING);
+		if (surfs[i]->w + ATLAS_PADDING > w)
+			w = surfs[i]->w + ATLAS_PADDING;
+	}
+	while ((long) side * side < area && side <= ATLAS_MAX_SIZE)
+		++side;
+	if (side > w)
+		w = side;
+	if (w > ATLAS_MAX_SIZE)
+		return FALSE;
+
+	for (i = 0; i < count; ++i)
+	{
+		if (x + surfs[i]->w > w)
+		{	// start a new row
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+		rects[i].x = x;
+		rects[i].y = y;
+		rects[i].w = surfs[i]->w;
+		rects[i].h = surfs[i]->h;
+		x += surfs[i]->w + ATLAS_PADDING;
+		if (surfs[i]->h + ATLAS_PADDING > rowHeight)
+			rowHeight = surfs[i]->h + ATLAS_PADDING;
+	}
+	y += rowHeight;
+	if (y > ATLAS_MAX_SIZE)
+		return FALSE;
+
+	*width = w;
+	*height = y;
+	return TRUE;
+}
+
+// Copy the canvases into one atlas canvas, and replace each with a canvas
+// of its own that draws from its part of the atlas. They keep their own
+// palettes and transparency. The canvases must all have the same pixel
+// format. Returns the atlas, which must be deleted after all canvases
+// that use it; NULL, with the canvases left as they were, if they could
+// not be packed.
+TFB_Canvas
+TFB_DrawCanvas_PackAtlas (TFB_Canvas canvases[], int count)
+{
+	SDL_Surface **surfs = (SDL_Surface **) canvases;
+	SDL_PixelFormat *fmt;
+	SDL_Surface *atlas;
+	SDL_Surface **views;
+	SDL_Rect *rects;
+	int width, height, i, y;
+
+	if (count < 1)
+		return NULL;
+
+	fmt = surfs[0]->format;
+	for (i = 1; i < count; ++i)
+	{
+		SDL_PixelFormat *f = surfs[i]->format;
+		if (f->BitsPerPixel != fmt->BitsPerPixel || f->Rmask != fmt->Rmask
+				|| f->Gmask != fmt->Gmask || f->Bmask != fmt->Bmask
+				|| f->Amask != fmt->Amask)
+			return NULL;
+	}
+
+	rects = HMalloc (sizeof (SDL_Rect) * count);
+	views = HMalloc (sizeof (SDL_Surface *) * count);
+	if (!layoutAtlas (surfs, count, rects, &width, &height))
+	{
+		HFree (rects);
+		HFree (views);
+		return NULL;
+	}
+
+	atlas = SDL_CreateRGBSurface (SDL_SWSURFACE, width, height,
+			fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask, fmt->Bmask,
+			fmt->Amask);
+	if (!atlas)
+	{
+		log_add (log_Warning, "Failed to create an atlas of %dx%d: %s",
+				width, height, SDL_GetError ());
+		HFree (rects);
+		HFree (views);
+		return NULL;
+	}
+	SDL_FillRect (atlas, NULL, 0);
+
+	for (i = 0; i < count; ++i)
+	{
+		views[i] = SDL_CreateRGBSurfaceFrom ((Uint8 *) atlas->pixels
+				+ rects[i].y * atlas->pitch
+				+ rects[i].x * fmt->BytesPerPixel,
+				rects[i].w, rects[i].h, fmt->BitsPerPixel, atlas->pitch,
+				fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+		if (!views[i])
+		{
+			while (i--)
+				SDL_FreeSurface (views[i]);
+			SDL_FreeSurface (atlas);
+			HFree (rects);
+			HFree (views);
+			return NULL;
+		}
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		SDL_Surface *src = surfs[i];
+		SDL_Surface *view = views[i];
+
+		if (src->format->palette)
+			TFB_SetColors (view, src->format->palette->colors, 0,
+					src->format->palette->ncolors);
+		TFB_DrawCanvas_CopyTransparencyInfo (src, view);
+
+		// A straight copy of the pixels; a blit would blend
+		SDL_LockSurface (src);
+		for (y = 0; y < src->h; ++y)
+		{
+			memcpy ((Uint8 *) view->pixels + y * view->pitch,
+					(const Uint8 *) src->pixels + y * src->pitch,
+					src->w * src->format->BytesPerPixel);
+		}
+		SDL_UnlockSurface (src);
+
+		SDL_FreeSurface (src);
+		canvases[i] = view;
+	}
+
+	HFree (rects);
+	HFree (views);
+	return atlas;
+}
+
+#define FNV64_PRIME 0x100000001b3ULL
+
+static uint64
+hashBytes (uint64 hash, const void *data, size_t size)
+{
+	const Uint8 *p = data;
+
+	while (size--)
+	{
+		hash ^= *p++;
+		hash *= FNV64_PRIME;
+	}
+	return hash;
+}
+
+static uint64
+hashDword (uint64 hash, Uint32 val)
+{
+	Uint8 buf[4];
+
+	buf[0] = val & 0xff;
+	buf[1] = (val >> 8) & 0xff;
+	buf[2] = (val >> 16) & 0xff;
+	buf[3] = (val >> 24) & 0xff;
+	return hashBytes (hash, buf, 4);
+}
+
+// Mix everything that makes up what the canvas looks like into 'hash':
+// size, pixel format, palette, transparency and the pixels themselves
+uint64
+TFB_DrawCanvas_Hash (TFB_Canvas canvas, uint64 hash)
+{
+	SDL_Surface *surf = canvas;
+	SDL_PixelFormat *fmt = surf->format;
+	Uint32 colorkey;
+	int y;
+
+	hash = hashDword (hash, surf->w);
+	hash = hashDword (hash, surf->h);
+	hash = hashDword (hash, fmt->BitsPerPixel);
+	hash = hashDword (hash, fmt->Rmask);
+	hash = hashDword (hash, fmt->Gmask);
+	hash = hashDword (hash, fmt->Bmask);
+	hash = hashDword (hash, fmt->Amask);
+	if (TFB_GetColorKey (surf, &colorkey) == 0)
+		hash = hashDword (hash, colorkey);
+	else
+		hash = hashDword (hash, 0xffffffff);
+	if (fmt->palette)
+	{
+		int i;
+		for (i = 0; i < fmt->palette->ncolors; ++i)
+		{
+			SDL_Color *c = &fmt->palette->colors[i];
+			hash = hashDword (hash, ((Uint32) c->r << 16)
+					| ((Uint32) c->g << 8) | c->b);
+		}
+	}
+
+	SDL_LockSurface (surf);
+	for (y = 0; y < surf->h; ++y)
+	{
+		hash = hashBytes (hash, (const Uint8 *) surf->pixels
+				+ y * surf->pitch, surf->w * fmt->BytesPerPixel);
+	}
+	SDL_UnlockSurface (surf);
+
+	return hash;
+}
+
+int
+TFB_DrawCanvas_GetPixelSize (TFB_Canvas canvas)
+{
+	return ((SDL_Surface *) canvas)->format->BytesPerPixel;
+}
+
+// Copy the top left w x h pixels out of the canvas, row after row with
+// no padding. Returns FALSE if the canvas is smaller than that.
+BOOLEAN
+TFB_DrawCanvas_GetPixels (TFB_Canvas canvas, int w, int h, BYTE *data)
+{
+	SDL_Surface *surf = canvas;
+	size_t rowSize = (size_t) w * surf->format->BytesPerPixel;
+	int y;
+
+	if (w > surf->w || h > surf->h)
+		return FALSE;
+
+	SDL_LockSurface (surf);
+	for (y = 0; y < h; ++y)
+	{
+		memcpy (data + y * rowSize,
+				(const Uint8 *) surf->pixels + y * surf->pitch, rowSize);
+	}
+	SDL_UnlockSurface (surf);
+	return TRUE;
+}
+
+// The reverse of TFB_DrawCanvas_GetPixels()
+BOOLEAN
+TFB_DrawCanvas_SetPixels (TFB_Canvas canvas, int w, int h,
+		const BYTE *data)
+{
+	SDL_Surface *surf = canvas;
+	size_t rowSize = (size_t) w * surf->format->BytesPerPixel;
+	int y;
+
+	if (w > surf->w || h > surf->h)
+		return FALSE;
+
+	SDL_LockSurface (surf);
+	for (y = 0; y < h; ++y)
+	{
+		memcpy ((Uint8 *) surf->pixels + y * surf->pitch,
+				data + y * rowSize, rowSize);
+	}
+	SDL_UnlockSurface (surf);
+	return TRUE;
+}
+
 TFB_Canvas
 TFB_DrawCanvas_LoadFromFile (void *dir, const char *fileName)
 {
@@ -1208,61 +1716,139 @@ blend_ratio_2 (Uint8 c1, Uint8 c2, int ratio)
 	return (((c1 - c2) * ratio) >> 8) + c2;
 }
 
-static inline Uint32
-scale_read_pixel (void* ppix, SDL_PixelFormat *fmt, SDL_Color *pal,
-				Uint32 mask, Uint32 key)
+// Scaler source, decoded into pixel_t RGBA with a border of
+// non-present (all zero) pixels around it.  Decoding once per call
+// keeps the pixel format checks and the image edge checks out of the
+// scaling loops.
+typedef struct
+{
+	pixel_t *pixels;
+	int pitch; // in pixels
+	int w, h;
+} scale_source_t;
+
+static void
+scale_decode_paletted (pixel_t *out, const Uint8 *in, int w,
+		const pixel_t *lut)
 {
-	pixel_t p;
+	int x;
 
-	// start off with non-present pixel
-	p.value = 0;
+	for (x = 0; x < w; ++x)
+		out[x] = lut[in[x]];
+}
 
-	if (pal)
-	{	// paletted pixel; mask not used
-		Uint32 c = *(Uint8 *)ppix;
+static void
+scale_decode_alpha (pixel_t *out, const Uint32 *in, int w,
+		const SDL_PixelFormat *fmt)
+{	// RGBA pixel; present when alpha is non-zero
+	const Uint32 amask = fmt->Amask;
+	int x;
 
-		if (c != key)
-		{
-			p.c.r = pal[c].r;
-			p.c.g = pal[c].g;
-			p.c.b = pal[c].b;
-			p.c.a = SDL_ALPHA_OPAQUE;
-		}
+	for (x = 0; x < w; ++x)
+	{
+		Uint32 c = in[x];
+
+		if (!(c & amask))
+			continue; // non-present, already zeroed
+
+		// Assume 8 bits/channel; a safe assumption with 32bpp surfaces
+		out[x].c.r = (c >> fmt->Rshift) & 0xff;
+		out[x].c.g = (c >> fmt->Gshift) & 0xff;
+		out[x].c.b = (c >> fmt->Bshift) & 0xff;
+		out[x].c.a = (c >> fmt->Ashift) & 0xff;
 	}
-	else
-	{	// RGB(A) pixel; (pix & mask) != key
-		Uint32 c = *(Uint32 *)ppix;
+}
+
+static void
+scale_decode_keyed (pixel_t *out, const Uint32 *in, int w,
+		const SDL_PixelFormat *fmt, Uint32 mask, Uint32 key)
+{	// RGBX pixel; present when (pix & mask) != key
+	int x;
 
-		if ((c & mask) != key)
+	for (x = 0; x < w; ++x)
+	{
+		Uint32 c = in[x];
+
+		if ((c & mask) == key)
+			continue; // non-present, already zeroed
+
+		out[x].c.r = (c >> fmt->Rshift) & 0xff;
+		out[x].c.g = (c >> fmt->Gshift) & 0xff;
+		out[x].c.b = (c >> fmt->Bshift) & 0xff;
+		out[x].c.a = SDL_ALPHA_OPAQUE;
+	}
+}
+
+// 'pal' is the palette to use when 'surf' is paletted, and 'key' the
+// transparent index then; for RGB(A) surfaces pixels with
+// (pix & mask) == key are not present.
+static void
+scale_decode_source (SDL_Surface *surf, SDL_Color *pal, Uint32 mask,
+		Uint32 key, scale_source_t *out)
+{
+	SDL_PixelFormat *fmt = surf->format;
+	pixel_t lut[256];
+	pixel_t *row;
+	int y;
+
+	out->w = surf->w;
+	out->h = surf->h;
+	out->pitch = surf->w + 2;
+	out->pixels = HCalloc (sizeof (pixel_t) * out->pitch * (surf->h + 2));
+
+	if (fmt->BytesPerPixel == 1)
+	{
+		int i;
+
+		for (i = 0; i < 256; ++i)
 		{
-#if 0
-			SDL_GetRGBA (c, fmt, &p.c.r, &p.c.g, &p.c.b, &p.c.a);
-#else
-			// Assume 8 bits/channel; a safe assumption with 32bpp surfaces
-			p.c.r = (c >> fmt->Rshift) & 0xff;
-			p.c.g = (c >> fmt->Gshift) & 0xff;
-			p.c.b = (c >> fmt->Bshift) & 0xff;
-			if (fmt->Amask)
-				p.c.a = (c >> fmt->Ashift) & 0xff;
-			else
-				p.c.a = SDL_ALPHA_OPAQUE;
+			lut[i].c.r = pal[i].r;
+			lut[i].c.g = pal[i].g;
+			lut[i].c.b = pal[i].b;
+			lut[i].c.a = SDL_ALPHA_OPAQUE;
 		}
-#endif
+		if (key < 256)
+			lut[key].value = 0;
 	}
 
-	return p.value;
-}
+	SDL_LockSurface (surf);
+	for (y = 0, row = out->pixels + out->pitch + 1; y < surf->h;
+			++y, row += out->pitch)
+	{
+		const Uint8 *in = (Uint8 *) surf->pixels + y * surf->pitch;
 
-static inline Uint32
-scale_get_pixel (SDL_Surface *src, Uint32 mask, Uint32 key, int x, int y)
-{
-	SDL_Color *pal = src->format->palette? src->format->palette->colors : 0;
+		if (fmt->BytesPerPixel == 1)
+			scale_decode_paletted (row, in, surf->w, lut);
+		else if (fmt->Amask && mask == fmt->Amask)
+			scale_decode_alpha (row, (const Uint32 *) in, surf->w, fmt);
+		else
+			scale_decode_keyed (row, (const Uint32 *) in, surf->w, fmt,
+					mask, key);
+	}
+	SDL_UnlockSurface (surf);
+}
 
-	if (x < 0 || x >= src->w || y < 0 || y >= src->h)
-		return 0;
+static inline void
+scale_fetch_quad (const scale_source_t *src, int x, int y, pixel_t p[4])
+{	// fetches pixels (x, y) through (x + 1, y + 1) in pattern
+	//  0  1
+	//  2  3
+	if (x >= -1 && x < src->w && y >= -1 && y < src->h)
+	{
+		const pixel_t *q = src->pixels + (y + 1) * src->pitch + (x + 1);
 
-	return scale_read_pixel ((Uint8*)src->pixels + y * src->pitch +
-			x * src->format->BytesPerPixel, src->format, pal, mask, key);
+		p[0].value = q[0].value;
+		p[1].value = q[1].value;
+		p[2].value = q[src->pitch].value;
+		p[3].value = q[src->pitch + 1].value;
+	}
+	else
+	{	// entirely outside the image
+		p[0].value = 0;
+		p[1].value = 0;
+		p[2].value = 0;
+		p[3].value = 0;
+	}
 }
 
 void
@@ -1277,10 +1863,6 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 	SDL_PixelFormat *mmfmt = mm->format;
 	SDL_PixelFormat *dstfmt = dst->format;
 	SDL_Color *srcpal = srcfmt->palette? srcfmt->palette->colors : 0;
-	const int sbpp = srcfmt->BytesPerPixel;
-	const int mmbpp = mmfmt->BytesPerPixel;
-	const int slen = src->pitch;
-	const int mmlen = mm->pitch;
 	const int dst_has_alpha = (dstfmt->Amask != 0);
 	Uint32 transparent = 0;
 	const int alpha_threshold = dst_has_alpha ? 0 : 127;
@@ -1294,6 +1876,8 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 	int fsx0 = 0, fsy0 = 0, fsx1 = 0, fsy1 = 0;
 	// source fractional x and y starting points
 	int ssx0 = 0, ssy0 = 0, ssx1 = 0, ssy1 = 0;
+	// decoded source and mipmap pixels
+	scale_source_t s0, s1;
 	int x, y, w, h;
 
 	TFB_GetColorKey (dst, &transparent);
@@ -1401,9 +1985,10 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 		ck1 &= mk1;
 	}
 
-	SDL_LockSurface(src);
+	scale_decode_source (src, srcpal, mk0, ck0, &s0);
+	scale_decode_source (mm, srcpal, mk1, ck1, &s1);
+
 	SDL_LockSurface(dst);
-	SDL_LockSurface(mm);
 
 	for (y = 0, sy0 = ssy0, sy1 = ssy1;
 			y < h;
@@ -1412,8 +1997,6 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 		Uint32 *dst_p = (Uint32 *) ((Uint8*)dst->pixels + y * dst->pitch);
 		const int py0 = (sy0 >> 16);
 		const int py1 = (sy1 >> 16);
-		Uint8 *src_a0 = (Uint8*)src->pixels + py0 * slen;
-		Uint8 *src_a1 = (Uint8*)mm->pixels + py1 * mmlen;
 		// retrieve the fractional portions of y
 		const Uint8 v0 = (sy0 >> 8) & 0xff;
 		const Uint8 v1 = (sy1 >> 8) & 0xff;
@@ -1447,53 +2030,8 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 			w1[2] = btable[255 - u1][v1];
 			w1[3] = btable[u1][v1];
 
-			// Collect interesting pixels from src image
-			// Optimization: speed is criticial on larger images;
-			// most pixel reads fall completely inside the image
-			if (px0 >= 0 && px0 + 1 < src->w && py0 >= 0 && py0 + 1 < src->h)
-			{
-				Uint8 *src_p = src_a0 + px0 * sbpp;
-
-				p0[0].value = scale_read_pixel (src_p, srcfmt,
-						srcpal, mk0, ck0);
-				p0[1].value = scale_read_pixel (src_p + sbpp, srcfmt,
-						srcpal, mk0, ck0);
-				p0[2].value = scale_read_pixel (src_p + slen, srcfmt,
-						srcpal, mk0, ck0);
-				p0[3].value = scale_read_pixel (src_p + sbpp + slen, srcfmt,
-						srcpal, mk0, ck0);
-			}
-			else
-			{
-				p0[0].value = scale_get_pixel (src, mk0, ck0, px0, py0);
-				p0[1].value = scale_get_pixel (src, mk0, ck0, px0 + 1, py0);
-				p0[2].value = scale_get_pixel (src, mk0, ck0, px0, py0 + 1);
-				p0[3].value = scale_get_pixel (src, mk0, ck0,
-						px0 + 1, py0 + 1);
-			}
-
-			// Collect interesting pixels from mipmap image
-			if (px1 >= 0 && px1 + 1 < mm->w && py1 >= 0 && py1 + 1 < mm->h)
-			{
-				Uint8 *mm_p = src_a1 + px1 * mmbpp;
-
-				p1[0].value = scale_read_pixel (mm_p, mmfmt,
-						srcpal, mk1, ck1);
-				p1[1].value = scale_read_pixel (mm_p + mmbpp, mmfmt,
-						srcpal, mk1, ck1);
-				p1[2].value = scale_read_pixel (mm_p + mmlen, mmfmt,
-						srcpal, mk1, ck1);
-				p1[3].value = scale_read_pixel (mm_p + mmbpp + mmlen, mmfmt,
-						srcpal, mk1, ck1);
-			}
-			else
-			{
-				p1[0].value = scale_get_pixel (mm, mk1, ck1, px1, py1);
-				p1[1].value = scale_get_pixel (mm, mk1, ck1, px1 + 1, py1);
-				p1[2].value = scale_get_pixel (mm, mk1, ck1, px1, py1 + 1);
-				p1[3].value = scale_get_pixel (mm, mk1, ck1,
-						px1 + 1, py1 + 1);
-			}
+			scale_fetch_quad (&s0, px0, py0, p0);
+			scale_fetch_quad (&s1, px1, py1, p1);
 
 			p0[4].c.a = dot_product_8_4 (p0, 3, w0);
 			p1[4].c.a = dot_product_8_4 (p1, 3, w1);
@@ -1580,9 +2118,10 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 		}
 	}
 
-	SDL_UnlockSurface(mm);
 	SDL_UnlockSurface(dst);
-	SDL_UnlockSurface(src);
+
+	HFree (s1.pixels);
+	HFree (s0.pixels);
 }
 
 void
@@ -1594,8 +2133,6 @@ TFB_DrawCanvas_Rescale_Bilinear (TFB_Canvas src_canvas, TFB_Canvas dst_canvas,
 	SDL_PixelFormat *srcfmt = src->format;
 	SDL_PixelFormat *dstfmt = dst->format;
 	SDL_Color *srcpal = srcfmt->palette? srcfmt->palette->colors : 0;
-	const int sbpp = srcfmt->BytesPerPixel;
-	const int slen = src->pitch;
 	const int dst_has_alpha = (dstfmt->Amask != 0);
 	Uint32 srckey = 0, transparent = 0;
 	const int alpha_threshold = dst_has_alpha ? 0 : 127;
@@ -1607,6 +2144,8 @@ TFB_DrawCanvas_Rescale_Bilinear (TFB_Canvas src_canvas, TFB_Canvas dst_canvas,
 	int fsx = 0, fsy = 0;
 	// source fractional x and y starting points
 	int ssx = 0, ssy = 0;
+	// decoded source pixels
+	scale_source_t s0;
 	int x, y, w, h;
 
 	// Get destination transparent color if it exists
@@ -1670,14 +2209,14 @@ TFB_DrawCanvas_Rescale_Bilinear (TFB_Canvas src_canvas, TFB_Canvas dst_canvas,
 		ck = srckey & mk;
 	}
 
-	SDL_LockSurface(src);
+	scale_decode_source (src, srcpal, mk, ck, &s0);
+
 	SDL_LockSurface(dst);
 
 	for (y = 0, sy = ssy; y < h; ++y, sy += fsy)
 	{
 		Uint32 *dst_p = (Uint32 *) ((Uint8*)dst->pixels + y * dst->pitch);
 		const int py = (sy >> 16);
-		Uint8 *src_a = (Uint8*)src->pixels + py * slen;
 		// retrieve the fractional portions of y
 		const Uint8 v = (sy >> 8) & 0xff;
 		Uint8 weight[4]; // pixel weight vectors
@@ -1700,28 +2239,7 @@ TFB_DrawCanvas_Rescale_Bilinear (TFB_Canvas src_canvas, TFB_Canvas dst_canvas,
 			weight[2] = btable[255 - u][v];
 			weight[3] = btable[u][v];
 
-			// Collect interesting pixels from src image
-			// Optimization: speed is criticial on larger images;
-			// most pixel reads fall completely inside the image
-			if (px >= 0 && px + 1 < src->w && py >= 0 && py + 1 < src->h)
-			{
-				Uint8 *src_p = src_a + px * sbpp;
-
-				p[0].value = scale_read_pixel (src_p, srcfmt, srcpal, mk, ck);
-				p[1].value = scale_read_pixel (src_p + sbpp, srcfmt,
-						srcpal, mk, ck);
-				p[2].value = scale_read_pixel (src_p + slen, srcfmt,
-						srcpal, mk, ck);
-				p[3].value = scale_read_pixel (src_p + sbpp + slen, srcfmt,
-						srcpal, mk, ck);
-			}
-			else
-			{
-				p[0].value = scale_get_pixel (src, mk, ck, px, py);
-				p[1].value = scale_get_pixel (src, mk, ck, px + 1, py);
-				p[2].value = scale_get_pixel (src, mk, ck, px, py + 1);
-				p[3].value = scale_get_pixel (src, mk, ck, px + 1, py + 1);
-			}
+			scale_fetch_quad (&s0, px, py, p);
 
 			p[4].c.a = dot_product_8_4 (p, 3, weight);
 
@@ -1773,7 +2291,8 @@ TFB_DrawCanvas_Rescale_Bilinear (TFB_Canvas src_canvas, TFB_Canvas dst_canvas,
 	}
 
 	SDL_UnlockSurface(dst);
-	SDL_UnlockSurface(src);
+
+	HFree (s0.pixels);
 }
 
 void
@@ -1952,77 +2471,56 @@ TFB_DrawCanvas_SetClipRect (TFB_Canvas canvas, const RECT *clipRect)
 	}
 }
 
-BOOLEAN
-TFB_DrawCanvas_Intersect (TFB_Canvas canvas1, POINT c1org,
-		TFB_Canvas canvas2, POINT c2org, const RECT *interRect)
+TFB_CollisionMask *
+TFB_DrawCanvas_NewCollisionMask (TFB_Canvas canvas)
 {
-	BOOLEAN ret = FALSE;
-	SDL_Surface *surf1 = canvas1;
-	SDL_Surface *surf2 = canvas2;
+	SDL_Surface *surf = canvas;
+	TFB_CollisionMask *mask;
+	uint64 *row;
+	int pitch;
 	int x, y;
-	Uint32 s1key, s2key;
-	Uint32 s1mask, s2mask;
-	GetPixelFn getpixel1, getpixel2;
-
-	SDL_LockSurface (surf1);
-	SDL_LockSurface (surf2);
-
-	getpixel1 = getpixel_for (surf1);
-	getpixel2 = getpixel_for (surf2);
+	Uint32 key;
+	Uint32 keymask;
+	GetPixelFn getpixel;
 
-	if (surf1->format->Amask)
+	if (surf->format->Amask)
 	{	// use alpha transparency info
-		s1mask = surf1->format->Amask;
+		keymask = surf->format->Amask;
 		// consider any not fully transparent pixel collidable
-		s1key = 0;
+		key = 0;
 	}
 	else
 	{	// colorkey transparency
 		Uint32 colorkey = 0;
-		TFB_GetColorKey(surf1, &colorkey);
-		s1mask = ~surf1->format->Amask;
-		s1key = colorkey & s1mask;
+		TFB_GetColorKey(surf, &colorkey);
+		keymask = ~surf->format->Amask;
+		key = colorkey & keymask;
 	}
 
-	if (surf2->format->Amask)
-	{	// use alpha transparency info
-		s2mask = surf2->format->Amask;
-		// consider any not fully transparent pixel collidable
-		s2key = 0;
-	}
-	else
-	{	// colorkey transparency
-		Uint32 colorkey = 0;
-		TFB_GetColorKey(surf2, &colorkey);
-		s2mask = ~surf2->format->Amask;
-		s2key = colorkey & s2mask;
-	}
+	pitch = (surf->w + 63) / 64 + 1;
+	// the bits follow the header in the same block
+	mask = HCalloc (sizeof (TFB_CollisionMask)
+			+ sizeof (uint64) * pitch * surf->h);
+	mask->width = surf->w;
+	mask->height = surf->h;
+	mask->pitch = pitch;
+	mask->bits = (uint64 *) (mask + 1);
 
-	// convert surface origins to pixel offsets within
-	c1org.x = interRect->corner.x - c1org.x;
-	c1org.y = interRect->corner.y - c1org.y;
-	c2org.x = interRect->corner.x - c2org.x;
-	c2org.y = interRect->corner.y - c2org.y;
+	SDL_LockSurface (surf);
+	getpixel = getpixel_for (surf);
 
-	for (y = 0; y < interRect->extent.height; ++y)
+	for (y = 0, row = mask->bits; y < surf->h; ++y, row += mask->pitch)
 	{
-		for (x = 0; x < interRect->extent.width; ++x)
+		for (x = 0; x < surf->w; ++x)
 		{
-			Uint32 p1 = getpixel1 (surf1, x + c1org.x, y + c1org.y) & s1mask;
-			Uint32 p2 = getpixel2 (surf2, x + c2org.x, y + c2org.y) & s2mask;
-
-			if (p1 != s1key && p2 != s2key)
-			{	// pixel collision
-				ret = TRUE;
-				break;
-			}
+			if ((getpixel (surf, x, y) & keymask) != key)
+				row[x >> 6] |= (uint64) 1 << (63 - (x & 63));
 		}
 	}
 
-	SDL_UnlockSurface (surf2);
-	SDL_UnlockSurface (surf1);
+	SDL_UnlockSurface (surf);
 
-	return ret;
+	return mask;
 }
 
 // Read/write the canvas pixels in a Color format understood by the core.
@@ -0,0 +1,351 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_OPENGL
+
+#include "libs/graphics/sdl/glshader.h"
+
+#if SDL_MAJOR_VERSION == 1
+
+#include "libs/log.h"
+#include "libs/memlib.h"
+
+// GL 2.0 bits; SDL 1.2 only guarantees the GL 1.1 headers
+#ifndef GL_FRAGMENT_SHADER
+#	define GL_FRAGMENT_SHADER   0x8B30
+#endif
+#ifndef GL_COMPILE_STATUS
+#	define GL_COMPILE_STATUS    0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#	define GL_LINK_STATUS       0x8B82
+#endif
+#ifndef GL_INFO_LOG_LENGTH
+#	define GL_INFO_LOG_LENGTH   0x8B84
+#endif
+
+typedef GLuint (APIENTRY *TFB_GLCreateShader) (GLenum type);
+typedef void (APIENTRY *TFB_GLShaderSource) (GLuint shader, GLsizei count,
+		const char **string, const GLint *length);
+typedef void (APIENTRY *TFB_GLObjectFunc) (GLuint obj);
+typedef void (APIENTRY *TFB_GLGetObjectiv) (GLuint obj, GLenum pname,
+		GLint *params);
+typedef void (APIENTRY *TFB_GLGetInfoLog) (GLuint obj, GLsizei bufSize,
+		GLsizei *length, char *infoLog);
+typedef GLuint (APIENTRY *TFB_GLCreateProgram) (void);
+typedef void (APIENTRY *TFB_GLAttachShader) (GLuint program, GLuint shader);
+typedef GLint (APIENTRY *TFB_GLGetUniformLocation) (GLuint program,
+		const char *name);
+typedef void (APIENTRY *TFB_GLUniform1i) (GLint location, GLint v0);
+typedef void (APIENTRY *TFB_GLUniform2f) (GLint location, GLfloat v0,
+		GLfloat v1);
+
+static struct
+{
+	TFB_GLCreateShader CreateShader;
+	TFB_GLShaderSource ShaderSource;
+	TFB_GLObjectFunc CompileShader;
+	TFB_GLGetObjectiv GetShaderiv;
+	TFB_GLGetInfoLog GetShaderInfoLog;
+	TFB_GLObjectFunc DeleteShader;
+	TFB_GLCreateProgram CreateProgram;
+	TFB_GLAttachShader AttachShader;
+	TFB_GLObjectFunc LinkProgram;
+	TFB_GLGetObjectiv GetProgramiv;
+	TFB_GLGetInfoLog GetProgramInfoLog;
+	TFB_GLObjectFunc DeleteProgram;
+	TFB_GLObjectFunc UseProgram;
+	TFB_GLGetUniformLocation GetUniformLocation;
+	TFB_GLUniform1i Uniform1i;
+	TFB_GLUniform2f Uniform2f;
+} gl;
+
+static GLuint program;
+static GLint texel_loc;
+static GLint limit_loc;
+
+
+// Shared by all the scaler shaders.  Source pixel 'center' is the
+// one the fragment falls into; 'dir' points from its middle to the
+// corner the fragment is in, like the quadrants of the 2x scalers.
+// limit is the middle of the bottom-right source pixel: the texture
+// is bigger than the screen, and neighbours are clamped as in C.
+static const char shader_prelude[] =
+	"#version 110\n"
+	"uniform sampler2D screen;\n"
+	"uniform vec2 texel;\n"
+	"uniform vec2 limit;\n"
+	"\n"
+	"vec4 fetch (vec2 pos)\n"
+	"{\n"
+	"	return texture2D (screen, clamp (pos, texel * 0.5, limit));\n"
+	"}\n"
+	"\n"
+	"vec2 center;\n"
+	"vec2 quadrant;\n"
+	"vec2 dir;\n"
+	"\n"
+	"void locate ()\n"
+	"{\n"
+	"	vec2 pos = gl_TexCoord[0].xy / texel;\n"
+	"	center = (floor (pos) + 0.5) * texel;\n"
+	"	quadrant = step (0.5, fract (pos));\n"
+	"	dir = quadrant * 2.0 - 1.0;\n"
+	"}\n"
+	"\n"
+	// Scale_CmpYUV(): the C matrix, Y doubled, channels 0..255
+	"bool close (vec4 a, vec4 b, float toler)\n"
+	"{\n"
+	"	vec3 d = mat3 (0.5978, -0.1687, 0.5,\n"
+	"			1.1733, -0.3313, -0.4183,\n"
+	"			0.2288, 0.5, -0.0817) * (a.rgb - b.rgb);\n"
+	"	return dot (abs (d), vec3 (255.0)) <= toler;\n"
+	"}\n"
+	"\n"
+	// Scale_DiffYUV(): per-channel thresholds on Y, U, V
+	"bool differ (vec4 a, vec4 b)\n"
+	"{\n"
+	"	vec3 d = mat3 (0.2989, -0.1687, 0.5,\n"
+	"			0.5867, -0.3313, -0.4183,\n"
+	"			0.1144, 0.5, -0.0817) * (a.rgb - b.rgb);\n"
+	"	return any (greaterThan (abs (d) * 255.0,\n"
+	"			vec3 (64.0, 36.0, 24.0)));\n"
+	"}\n"
+	"\n";
+
+// Biadapt: blend towards the right and bottom neighbours
+//	(see 2xscalers.c)
+static const char biadapt_main[] =
+	"void main ()\n"
+	"{\n"
+	"	locate ();\n"
+	"\n"
+	"	vec4 c = fetch (center);\n"
+	"	vec4 r = fetch (center + vec2 (texel.x, 0.0));\n"
+	"	vec4 b = fetch (center + vec2 (0.0, texel.y));\n"
+	"	vec4 br = fetch (center + texel);\n"
+	"	vec4 color = c;\n"
+	"\n"
+	"	if (quadrant.x > 0.0 && quadrant.y > 0.0)\n"
+	"	{\n"
+	"		if (c == br)\n"
+	"			color = c;\n"
+	"		else if (r == b)\n"
+	"			color = r;\n"
+	"		else\n"
+	"			color = (c + r + b + br) * 0.25;\n"
+	"	}\n"
+	"	else if (quadrant.x > 0.0)\n"
+	"		color = (c + r) * 0.5;\n"
+	"	else if (quadrant.y > 0.0)\n"
+	"		color = (c + b) * 0.5;\n"
+	"\n"
+	"	gl_FragColor = color * gl_Color;\n"
+	"}\n";
+
+// Triscan: scale2x with YUV tolerance (see triscan2x.c)
+static const char triscan_main[] =
+	"void main ()\n"
+	"{\n"
+	"	locate ();\n"
+	"\n"
+	"	vec4 c = fetch (center);\n"
+	"	vec4 h = fetch (center + vec2 (dir.x * texel.x, 0.0));\n"
+	"	vec4 v = fetch (center + vec2 (0.0, dir.y * texel.y));\n"
+	"	vec4 ho = fetch (center - vec2 (dir.x * texel.x, 0.0));\n"
+	"	vec4 vo = fetch (center - vec2 (0.0, dir.y * texel.y));\n"
+	"	vec4 color = c;\n"
+	"\n"
+	"	if (!close (v, vo, 100.0) && !close (h, ho, 100.0)\n"
+	"			&& close (h, v, 100.0))\n"
+	"		color = (h + v) * 0.5;\n"
+	"\n"
+	"	gl_FragColor = color * gl_Color;\n"
+	"}\n";
+
+// HQ: the common hq2x corner cases; an edge between the orthogonal
+// neighbours rounds the corner, a lone diagonal one tints it
+static const char hq_main[] =
+	"void main ()\n"
+	"{\n"
+	"	locate ();\n"
+	"\n"
+	"	vec4 c = fetch (center);\n"
+	"	vec4 h = fetch (center + vec2 (dir.x * texel.x, 0.0));\n"
+	"	vec4 v = fetch (center + vec2 (0.0, dir.y * texel.y));\n"
+	"	vec4 d = fetch (center + dir * texel);\n"
+	"	bool dh = differ (c, h);\n"
+	"	bool dv = differ (c, v);\n"
+	"	vec4 color = c;\n"
+	"\n"
+	"	if ((dh || dv) && !differ (h, v))\n"
+	"		color = (c * 2.0 + h + v) * 0.25;\n"
+	"	else if (!dh && !dv && differ (c, d))\n"
+	"		color = (c * 3.0 + d) * 0.25;\n"
+	"\n"
+	"	gl_FragColor = color * gl_Color;\n"
+	"}\n";
+
+
+static BOOLEAN
+LoadEntryPoints (void)
+{
+#define GET_PROC(name, type) \
+		gl.name = (type) SDL_GL_GetProcAddress ("gl" #name); \
+		if (!gl.name) \
+			return FALSE;
+
+	GET_PROC (CreateShader, TFB_GLCreateShader);
+	GET_PROC (ShaderSource, TFB_GLShaderSource);
+	GET_PROC (CompileShader, TFB_GLObjectFunc);
+	GET_PROC (GetShaderiv, TFB_GLGetObjectiv);
+	GET_PROC (GetShaderInfoLog, TFB_GLGetInfoLog);
+	GET_PROC (DeleteShader, TFB_GLObjectFunc);
+	GET_PROC (CreateProgram, TFB_GLCreateProgram);
+	GET_PROC (AttachShader, TFB_GLAttachShader);
+	GET_PROC (LinkProgram, TFB_GLObjectFunc);
+	GET_PROC (GetProgramiv, TFB_GLGetObjectiv);
+	GET_PROC (GetProgramInfoLog, TFB_GLGetInfoLog);
+	GET_PROC (DeleteProgram, TFB_GLObjectFunc);
+	GET_PROC (UseProgram, TFB_GLObjectFunc);
+	GET_PROC (GetUniformLocation, TFB_GLGetUniformLocation);
+	GET_PROC (Uniform1i, TFB_GLUniform1i);
+	GET_PROC (Uniform2f, TFB_GLUniform2f);
+
+#undef GET_PROC
+	return TRUE;
+}
+
+static void
+LogInfo (GLuint obj, TFB_GLGetObjectiv getiv, TFB_GLGetInfoLog getlog,
+		const char *what)
+{
+	GLint len = 0;
+	char *buf;
+
+	getiv (obj, GL_INFO_LOG_LENGTH, &len);
+	if (len <= 1)
+	{
+		log_add (log_Warning, "OpenGL: %s failed", what);
+		return;
+	}
+	buf = HMalloc (len);
+	getlog (obj, len, NULL, buf);
+	log_add (log_Warning, "OpenGL: %s failed: %s", what, buf);
+	HFree (buf);
+}
+
+static const char *
+ChooseShader (int flags)
+{
+	if (flags & TFB_GFXFLAGS_SCALE_TRISCAN)
+		return triscan_main;
+	else if (flags & (TFB_GFXFLAGS_SCALE_BIADAPT
+			| TFB_GFXFLAGS_SCALE_BIADAPTADV))
+		return biadapt_main;
+	else if (flags & (TFB_GFXFLAGS_SCALE_HQXX
+			| TFB_GFXFLAGS_SCALE_XBRZ3 | TFB_GFXFLAGS_SCALE_XBRZ4))
+		return hq_main;
+	else
+		return NULL;
+}
+
+BOOLEAN
+TFB_GL_InitScaleShader (int flags)
+{
+	const char *source[2];
+	const char *version = (const char *) glGetString (GL_VERSION);
+	GLuint shader;
+	GLint status = 0;
+
+	program = 0;
+
+	source[0] = shader_prelude;
+	source[1] = ChooseShader (flags);
+	if (!source[1])
+		return FALSE;
+
+	if (!version || version[0] < '2' || !LoadEntryPoints ())
+	{
+		log_add (log_Warning, "OpenGL: no GLSL support; "
+				"scaling on the CPU");
+		return FALSE;
+	}
+
+	shader = gl.CreateShader (GL_FRAGMENT_SHADER);
+	gl.ShaderSource (shader, 2, source, NULL);
+	gl.CompileShader (shader);
+	gl.GetShaderiv (shader, GL_COMPILE_STATUS, &status);
+	if (!status)
+	{
+		LogInfo (shader, gl.GetShaderiv, gl.GetShaderInfoLog,
+				"scaler shader compile");
+		gl.DeleteShader (shader);
+		return FALSE;
+	}
+
+	// The fixed function pipeline still does the vertices
+	program = gl.CreateProgram ();
+	gl.AttachShader (program, shader);
+	gl.LinkProgram (program);
+	// Flagged for deletion; goes away with the program
+	gl.DeleteShader (shader);
+	gl.GetProgramiv (program, GL_LINK_STATUS, &status);
+	if (!status)
+	{
+		LogInfo (program, gl.GetProgramiv, gl.GetProgramInfoLog,
+				"scaler shader link");
+		gl.DeleteProgram (program);
+		program = 0;
+		return FALSE;
+	}
+
+	texel_loc = gl.GetUniformLocation (program, "texel");
+	limit_loc = gl.GetUniformLocation (program, "limit");
+	gl.UseProgram (program);
+	gl.Uniform1i (gl.GetUniformLocation (program, "screen"), 0);
+	gl.UseProgram (0);
+
+	log_add (log_Info, "OpenGL: scaling in fragment shaders");
+	return TRUE;
+}
+
+void
+TFB_GL_UninitScaleShader (void)
+{
+	if (!program)
+		return;
+	gl.DeleteProgram (program);
+	program = 0;
+}
+
+void
+TFB_GL_UseScaleShader (int tex_width, int tex_height, int width, int height)
+{
+	gl.UseProgram (program);
+	gl.Uniform2f (texel_loc, 1.0f / tex_width, 1.0f / tex_height);
+	gl.Uniform2f (limit_loc, (width - 0.5f) / tex_width,
+			(height - 0.5f) / tex_height);
+}
+
+void
+TFB_GL_UnuseScaleShader (void)
+{
+	gl.UseProgram (0);
+}
+
+#endif /* SDL_MAJOR_VERSION == 1 */
+#endif /* HAVE_OPENGL */
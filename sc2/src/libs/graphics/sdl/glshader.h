@@ -0,0 +1,40 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef GLSHADER_H
+#define GLSHADER_H
+
+#include "libs/graphics/sdl/opengl.h"
+
+#if SDL_MAJOR_VERSION == 1 && defined(HAVE_OPENGL)
+
+// Fragment shader versions of the software scalers.
+// The shaders sample the unscaled screen texture, so only 320x240
+// pixels need uploading per screen.  TFB_GL_InitScaleShader() builds
+// the program for the scaler selected in 'flags' in the current GL
+// context; it returns FALSE if the driver cannot run it.
+BOOLEAN TFB_GL_InitScaleShader (int flags);
+void TFB_GL_UninitScaleShader (void);
+
+// Bracket drawing a screen texture; the texture must be bound and
+// the source image must be 'width' x 'height' pixels at its top-left
+void TFB_GL_UseScaleShader (int tex_width, int tex_height,
+		int width, int height);
+void TFB_GL_UnuseScaleShader (void);
+
+#endif
+
+#endif /* GLSHADER_H */
@@ -89,6 +89,7 @@
 // The name expands to
 //		Scale_HqFilter (for plain C)
 //		Scale_MMX_HqFilter (for MMX)
+//		Scale_SSE2_HqFilter (for SSE2, likewise AVX2 and NEON)
 //		[others when platforms are added]
 void
 SCALE_(HqFilter) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
@@ -228,6 +229,10 @@ SCALE_(HqFilter) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
 				yuv[9] = yuv[8];
 			}
 
+#ifdef SCALE_HQXX_PATTERN
+			// vector versions compare all 8 neighbours at once
+			pattern = SCALE_HQXX_PATTERN (yuv);
+#else
 			// this runs much faster with branching removed
 			pattern |= HQXX_DIFFYUV (yuv[5], yuv[1]) & 0x0001;
 			pattern |= HQXX_DIFFYUV (yuv[5], yuv[2]) & 0x0002;
@@ -237,6 +242,7 @@ SCALE_(HqFilter) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
 			pattern |= HQXX_DIFFYUV (yuv[5], yuv[7]) & 0x0020;
 			pattern |= HQXX_DIFFYUV (yuv[5], yuv[8]) & 0x0040;
 			pattern |= HQXX_DIFFYUV (yuv[5], yuv[9]) & 0x0080;
+#endif
 
 			switch (pattern)
 			{
@@ -30,6 +30,7 @@
 //		Scale_Nearest (for plain C)
 //		Scale_MMX_Nearest (for MMX)
 //		Scale_SSE_Nearest (for SSE)
+//		Scale_SSE2_Nearest (for SSE2, likewise AVX2 and NEON)
 //		[others when platforms are added]
 void
 SCALE_(Nearest) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
@@ -54,7 +55,12 @@ SCALE_(Nearest) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
 	src_p += slen * r->y + r->x;
 	dst_p += (dlen * r->y + r->x) * 2;
 
-#if defined(MMX_ASM) && defined(MSVC_ASM)
+#if defined(SCALE_NEAREST_ROW)
+	// Vector versions double a whole row at a time
+	for (y = rh; y; --y, src_p += rw + dsrc, dst_p += rw * 2 + ddst)
+		SCALE_NEAREST_ROW (src_p, dst_p, dlen, rw);
+
+#elif defined(MMX_ASM) && defined(MSVC_ASM)
 	// Just about everything has to be done in asm for MSVC
 	// to actually take advantage of asm here
 	// MSVC does not support beautiful GCC-like asm templates
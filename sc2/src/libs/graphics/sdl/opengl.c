@@ -19,9 +19,11 @@
 #ifdef HAVE_OPENGL
 
 #include "libs/graphics/sdl/opengl.h"
+#include "libs/graphics/sdl/glshader.h"
 #include "libs/graphics/bbox.h"
 #include "scalers.h"
 #include "options.h"
+#include "libs/time/profile.h"
 #include "libs/log.h"
 
 #if SDL_MAJOR_VERSION == 1
@@ -31,6 +33,9 @@ typedef struct _gl_screeninfo {
 	GLuint texture;
 	BOOLEAN dirty, active;
 	SDL_Rect updated;
+			// Bounding box of the regions below
+	SDL_Rect updated_rects[TFB_BBOX_MAX_DIRTY_RECTS];
+	int num_updated;
 } TFB_GL_SCREENINFO;
 
 static TFB_GL_SCREENINFO GL_Screens[TFB_GFX_NUMSCREENS];
@@ -57,6 +62,7 @@ static void TFB_GL_Postprocess (void);
 static void TFB_GL_UploadTransitionScreen (void);
 static void TFB_GL_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect);
 static void TFB_GL_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect);
+static void TFB_GL_Shader_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect);
 static void TFB_GL_ColorLayer (Uint8 r, Uint8 g, Uint8 b, Uint8 a, SDL_Rect *rect);
 
 static TFB_GRAPHICS_BACKEND opengl_scaled_backend = {
@@ -73,6 +79,13 @@ static TFB_GRAPHICS_BACKEND opengl_unscaled_backend = {
 	TFB_GL_Unscaled_ScreenLayer,
 	TFB_GL_ColorLayer };
 
+static TFB_GRAPHICS_BACKEND opengl_shader_backend = {
+	TFB_GL_Preprocess,
+	TFB_GL_Postprocess,
+	TFB_GL_UploadTransitionScreen,
+	TFB_GL_Shader_ScreenLayer,
+	TFB_GL_ColorLayer };
+
 
 static int
 AttemptColorDepth (int flags, int width, int height, int bpp)
@@ -193,7 +206,18 @@ TFB_GL_ConfigureVideo (int driver, int flags, int width, int height, int togglef
 		}
 	}
 
-	if (GfxFlags & TFB_GFXFLAGS_SCALE_SOFT_ONLY)
+	if ((GfxFlags & TFB_GFXFLAGS_SCALE_SOFT_ONLY)
+			&& (GfxFlags & TFB_GFXFLAGS_GL_SHADERS)
+			&& TFB_GL_InitScaleShader (GfxFlags))
+	{
+		// Upload the screens unscaled and let the GPU do the scaling
+		texture_width = 512;
+		texture_height = 256;
+
+		scaler = NULL;
+		graphics_backend = &opengl_shader_backend;
+	}
+	else if (GfxFlags & TFB_GFXFLAGS_SCALE_SOFT_ONLY)
 	{
 		if (!togglefullscreen)
 		{
@@ -223,7 +247,9 @@ TFB_GL_ConfigureVideo (int driver, int flags, int width, int height, int togglef
 	}
 
 
-	if (GfxFlags & TFB_GFXFLAGS_SCALE_ANY)
+	if (graphics_backend == &opengl_shader_backend)
+		ScreenFilterMode = GL_NEAREST; // the shader does its own taps
+	else if (GfxFlags & TFB_GFXFLAGS_SCALE_ANY)
 		ScreenFilterMode = GL_LINEAR;
 	else
 		ScreenFilterMode = GL_NEAREST;
@@ -288,6 +314,40 @@ TFB_GL_UninitGraphics (void)
 	for (i = 0; i < TFB_GFX_NUMSCREENS; i++) {
 		UnInit_Screen (&GL_Screens[i].scaled);
 	}
+	TFB_GL_UninitScaleShader ();
+}
+
+// Mark the whole of the 'updated' rect as needing an upload
+static void
+TFB_GL_SetUpdatedFull (TFB_GL_SCREENINFO *info)
+{
+	info->updated_rects[0] = info->updated;
+	info->num_updated = 1;
+}
+
+// Only upload the dirty tiles from the bounding box, unless there
+// are too many separate regions to be worth it.
+static void
+TFB_GL_SetUpdatedTiles (TFB_GL_SCREENINFO *info)
+{
+	RECT rects[TFB_BBOX_MAX_DIRTY_RECTS];
+	int count, i;
+
+	count = TFB_BBox_GetDirtyRects (rects, TFB_BBOX_MAX_DIRTY_RECTS);
+	if (count <= 0)
+	{
+		TFB_GL_SetUpdatedFull (info);
+		return;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		info->updated_rects[i].x = rects[i].corner.x;
+		info->updated_rects[i].y = rects[i].corner.y;
+		info->updated_rects[i].w = rects[i].extent.width;
+		info->updated_rects[i].h = rects[i].extent.height;
+	}
+	info->num_updated = count;
 }
 
 static void
@@ -297,6 +357,7 @@ TFB_GL_UploadTransitionScreen (void)
 	GL_Screens[TFB_SCREEN_TRANSITION].updated.y = 0;
 	GL_Screens[TFB_SCREEN_TRANSITION].updated.w = ScreenWidth;
 	GL_Screens[TFB_SCREEN_TRANSITION].updated.h = ScreenHeight;
+	TFB_GL_SetUpdatedFull (&GL_Screens[TFB_SCREEN_TRANSITION]);
 	GL_Screens[TFB_SCREEN_TRANSITION].dirty = TRUE;
 }
 
@@ -431,6 +492,7 @@ TFB_GL_Preprocess (int force_full_redraw, int transition_amount, int fade_amount
 		GL_Screens[TFB_SCREEN_MAIN].updated.y = 0;
 		GL_Screens[TFB_SCREEN_MAIN].updated.w = ScreenWidth;
 		GL_Screens[TFB_SCREEN_MAIN].updated.h = ScreenHeight;
+		TFB_GL_SetUpdatedFull (&GL_Screens[TFB_SCREEN_MAIN]);
 		GL_Screens[TFB_SCREEN_MAIN].dirty = TRUE;
 	}
 	else if (TFB_BBox.valid)
@@ -439,37 +501,44 @@ TFB_GL_Preprocess (int force_full_redraw, int transition_amount, int fade_amount
 		GL_Screens[TFB_SCREEN_MAIN].updated.y = TFB_BBox.region.corner.y;
 		GL_Screens[TFB_SCREEN_MAIN].updated.w = TFB_BBox.region.extent.width;
 		GL_Screens[TFB_SCREEN_MAIN].updated.h = TFB_BBox.region.extent.height;
+		TFB_GL_SetUpdatedTiles (&GL_Screens[TFB_SCREEN_MAIN]);
 		GL_Screens[TFB_SCREEN_MAIN].dirty = TRUE;
 	}
 }
 
+// Upload the dirty parts of an unscaled screen to its texture
 static void
-TFB_GL_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
+TFB_GL_UploadUnscaled (SCREEN screen)
 {
-	glBindTexture (GL_TEXTURE_2D, GL_Screens[screen].texture);
-	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-
-	if (GL_Screens[screen].dirty)
+	int i;
+	int PitchWords;
+
+	if (!GL_Screens[screen].dirty)
+		return;
+
+	PitchWords = SDL_Screens[screen]->pitch / 4;
+	glPixelStorei (GL_UNPACK_ROW_LENGTH, PitchWords);
+	/* Matrox OpenGL drivers do not handle GL_UNPACK_SKIP_*
+	   correctly */
+	glPixelStorei (GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei (GL_UNPACK_SKIP_PIXELS, 0);
+	SDL_LockSurface (SDL_Screens[screen]);
+	for (i = 0; i < GL_Screens[screen].num_updated; ++i)
 	{
-		int PitchWords = SDL_Screens[screen]->pitch / 4;
-		glPixelStorei (GL_UNPACK_ROW_LENGTH, PitchWords);
-		/* Matrox OpenGL drivers do not handle GL_UNPACK_SKIP_*
-		   correctly */
-		glPixelStorei (GL_UNPACK_SKIP_ROWS, 0);
-		glPixelStorei (GL_UNPACK_SKIP_PIXELS, 0);
-		SDL_LockSurface (SDL_Screens[screen]);
-		glTexSubImage2D (GL_TEXTURE_2D, 0, GL_Screens[screen].updated.x, 
-				GL_Screens[screen].updated.y,
-				GL_Screens[screen].updated.w, 
-				GL_Screens[screen].updated.h,
+		const SDL_Rect *r = &GL_Screens[screen].updated_rects[i];
+		glTexSubImage2D (GL_TEXTURE_2D, 0, r->x, r->y, r->w, r->h,
 				GL_RGBA, GL_UNSIGNED_BYTE,
 				(Uint32 *)SDL_Screens[screen]->pixels +
-					(GL_Screens[screen].updated.y * PitchWords + 
-					GL_Screens[screen].updated.x));
-		SDL_UnlockSurface (SDL_Screens[screen]);
-		GL_Screens[screen].dirty = FALSE;
+					(r->y * PitchWords + r->x));
 	}
+	SDL_UnlockSurface (SDL_Screens[screen]);
+	GL_Screens[screen].dirty = FALSE;
+}
 
+// Draw the bound screen texture with the given alpha
+static void
+TFB_GL_DrawScreenTexture (Uint8 a, SDL_Rect *rect)
+{
 	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, ScreenFilterMode);
 	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, ScreenFilterMode);
 	glEnable (GL_TEXTURE_2D);
@@ -490,16 +559,48 @@ TFB_GL_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 	TFB_GL_DrawQuad (rect);
 }
 
+static void
+TFB_GL_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
+{
+	glBindTexture (GL_TEXTURE_2D, GL_Screens[screen].texture);
+	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+	TFB_GL_UploadUnscaled (screen);
+	TFB_GL_DrawScreenTexture (a, rect);
+}
+
+static void
+TFB_GL_Shader_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
+{
+	glBindTexture (GL_TEXTURE_2D, GL_Screens[screen].texture);
+
+	TFB_GL_UploadUnscaled (screen);
+	// The shader takes the alpha from the vertex color, as
+	// GL_MODULATE does
+	TFB_GL_UseScaleShader (512, 256, ScreenWidth, ScreenHeight);
+	TFB_GL_DrawScreenTexture (a, rect);
+	TFB_GL_UnuseScaleShader ();
+}
+
 static void
 TFB_GL_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 {
+	int i;
+
 	glBindTexture (GL_TEXTURE_2D, GL_Screens[screen].texture);
 	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
 	if (GL_Screens[screen].dirty)
 	{
 		int PitchWords = GL_Screens[screen].scaled->pitch / 4;
-		scaler (SDL_Screens[screen], GL_Screens[screen].scaled, &GL_Screens[screen].updated);
+		for (i = 0; i < GL_Screens[screen].num_updated; ++i)
+		{
+			// The scaler may expand the rect it is given
+			SDL_Rect update = GL_Screens[screen].updated_rects[i];
+			PROFILE_BEGIN (PROF_SCALE);
+			scaler (SDL_Screens[screen], GL_Screens[screen].scaled, &update);
+			PROFILE_END (PROF_SCALE);
+		}
 		glPixelStorei (GL_UNPACK_ROW_LENGTH, PitchWords);
 
 		 /* Matrox OpenGL drivers do not handle GL_UNPACK_SKIP_*
@@ -507,36 +608,20 @@ TFB_GL_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 		glPixelStorei (GL_UNPACK_SKIP_ROWS, 0);
 		glPixelStorei (GL_UNPACK_SKIP_PIXELS, 0);
 		SDL_LockSurface (GL_Screens[screen].scaled);
-		glTexSubImage2D (GL_TEXTURE_2D, 0, GL_Screens[screen].updated.x * 2, 
-				GL_Screens[screen].updated.y * 2,
-				GL_Screens[screen].updated.w * 2, 
-				GL_Screens[screen].updated.h * 2,
-				GL_RGBA, GL_UNSIGNED_BYTE,
-				(Uint32 *)GL_Screens[screen].scaled->pixels +
-				(GL_Screens[screen].updated.y * 2 * PitchWords + 
-				GL_Screens[screen].updated.x * 2));
+		for (i = 0; i < GL_Screens[screen].num_updated; ++i)
+		{
+			const SDL_Rect *r = &GL_Screens[screen].updated_rects[i];
+			glTexSubImage2D (GL_TEXTURE_2D, 0, r->x * 2, r->y * 2,
+					r->w * 2, r->h * 2,
+					GL_RGBA, GL_UNSIGNED_BYTE,
+					(Uint32 *)GL_Screens[screen].scaled->pixels +
+					(r->y * 2 * PitchWords + r->x * 2));
+		}
 		SDL_UnlockSurface (GL_Screens[screen].scaled);
 		GL_Screens[screen].dirty = FALSE;
 	}
 
-	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, ScreenFilterMode);
-	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, ScreenFilterMode);
-	glEnable (GL_TEXTURE_2D);
-
-	if (a == 255)
-	{
-		glDisable (GL_BLEND);
-		glColor4f (1, 1, 1, 1);
-	}
-	else
-	{
-		float a_f = a / 255.0f;
-		glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glEnable (GL_BLEND);
-		glColor4f (1, 1, 1, a_f);
-	}
-	
-	TFB_GL_DrawQuad (rect);
+	TFB_GL_DrawScreenTexture (a, rect);
 }
 
 static void
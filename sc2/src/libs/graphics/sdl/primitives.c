@@ -19,6 +19,18 @@
 #include "port.h"
 #include "sdl_common.h"
 #include "primitives.h"
+#include "libs/platform.h"
+
+#include <string.h>
+
+#ifdef SSE2_INTRIN
+#	include <emmintrin.h>
+#elif defined(NEON_INTRIN)
+#	include <arm_neon.h>
+#endif
+
+#define SPAN_CHUNK 256
+		// Pixels of a row converted or filled in at a time
 
 
 // Pixel drawing routines
@@ -292,6 +304,223 @@ renderpixel_for(SDL_Surface *surface, RenderKind kind)
 	return NULL;
 }
 
+// Span rendering routines
+// These work on runs of 32bpp pixels. As every channel is 8 bits wide
+// and byte aligned, the 4 bytes of a pixel are blended alike, without
+// regard to which channel is which. 'rgbMask' then clears the byte that
+// is not a color channel, as PACK_PIXEL_32() does.
+
+static void
+renderspan_replace(Uint32 *dst, const Uint32 *src, int count, int factor,
+		Uint32 rgbMask)
+{
+	(void) factor; // ignored
+	(void) rgbMask; // ignored
+	memcpy (dst, src, count * sizeof (Uint32));
+}
+
+static inline Uint32
+additive_32(Uint32 dp, Uint32 sp, int factor, Uint32 rgbMask)
+{
+	Uint32 res = 0;
+	int shift;
+
+	for (shift = 0; shift < 32; shift += 8)
+	{
+		Uint8 dc = (dp >> shift) & 0xff;
+		Uint8 sc = (sp >> shift) & 0xff;
+		Uint8 c;
+
+		if (factor == ADDITIVE_FACTOR_1)
+			c = clip_channel(dc + sc);
+		else
+			c = modulated_sum(dc, sc, factor);
+		res |= (Uint32)c << shift;
+	}
+	return res & rgbMask;
+}
+
+static void
+renderspan_additive(Uint32 *dst, const Uint32 *src, int count, int factor,
+		Uint32 rgbMask)
+{
+	int x = 0;
+
+#if defined(SSE2_INTRIN)
+	if (factor >= -255 && factor <= 255)
+	{
+		const __m128i zero = _mm_setzero_si128 ();
+		const __m128i mask = _mm_set1_epi32 ((int)rgbMask);
+		const __m128i f = _mm_set1_epi16 (factor < 0 ? -factor : factor);
+		const __m128i round = _mm_set1_epi16 (factor < 0 ? 255 : 0);
+				// A negative modulated addend rounds away from 0
+
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128i d = _mm_loadu_si128 ((const __m128i *) (dst + x));
+			__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x));
+			__m128i r;
+
+			if (factor != ADDITIVE_FACTOR_1)
+			{
+				__m128i lo = _mm_unpacklo_epi8 (s, zero);
+				__m128i hi = _mm_unpackhi_epi8 (s, zero);
+				lo = _mm_srli_epi16 (_mm_add_epi16 (
+						_mm_mullo_epi16 (lo, f), round), 8);
+				hi = _mm_srli_epi16 (_mm_add_epi16 (
+						_mm_mullo_epi16 (hi, f), round), 8);
+				s = _mm_packus_epi16 (lo, hi);
+			}
+			if (factor < 0)
+				r = _mm_subs_epu8 (d, s);
+			else
+				r = _mm_adds_epu8 (d, s);
+			_mm_storeu_si128 ((__m128i *) (dst + x),
+					_mm_and_si128 (r, mask));
+		}
+	}
+#elif defined(NEON_INTRIN)
+	if (factor >= -255 && factor <= 255)
+	{
+		const uint32x4_t mask = vdupq_n_u32 (rgbMask);
+		const uint8x8_t f = vdup_n_u8 (factor < 0 ? -factor : factor);
+		const uint16x8_t round = vdupq_n_u16 (factor < 0 ? 255 : 0);
+				// A negative modulated addend rounds away from 0
+
+		for (; x + 4 <= count; x += 4)
+		{
+			uint8x16_t d = vreinterpretq_u8_u32 (vld1q_u32 (dst + x));
+			uint8x16_t s = vreinterpretq_u8_u32 (vld1q_u32 (src + x));
+			uint8x16_t r;
+
+			if (factor != ADDITIVE_FACTOR_1)
+			{
+				uint16x8_t lo = vaddq_u16 (vmull_u8 (vget_low_u8 (s), f),
+						round);
+				uint16x8_t hi = vaddq_u16 (vmull_u8 (vget_high_u8 (s), f),
+						round);
+				s = vcombine_u8 (vshrn_n_u16 (lo, 8), vshrn_n_u16 (hi, 8));
+			}
+			if (factor < 0)
+				r = vqsubq_u8 (d, s);
+			else
+				r = vqaddq_u8 (d, s);
+			vst1q_u32 (dst + x, vandq_u32 (vreinterpretq_u32_u8 (r), mask));
+		}
+	}
+#endif
+
+	for (; x < count; ++x)
+		dst[x] = additive_32(dst[x], src[x], factor, rgbMask);
+}
+
+static inline Uint32
+alpha_32(Uint32 dp, Uint32 sp, int alpha, Uint32 rgbMask)
+{
+	Uint32 res = 0;
+	int shift;
+
+	for (shift = 0; shift < 32; shift += 8)
+	{
+		Uint8 dc = (dp >> shift) & 0xff;
+		Uint8 sc = (sp >> shift) & 0xff;
+		res |= (Uint32)alpha_blend(dc, sc, alpha) << shift;
+	}
+	return res & rgbMask;
+}
+
+static void
+renderspan_alpha(Uint32 *dst, const Uint32 *src, int count, int factor,
+		Uint32 rgbMask)
+{
+	int x = 0;
+
+	if (factor == FULLY_OPAQUE_ALPHA)
+	{	// alpha == 255 is equivalent to 'replace' and blending does not
+		// work correctly anyway because we use >> 8 instead of / 255
+		renderspan_replace(dst, src, count, factor, rgbMask);
+		return;
+	}
+
+	// alpha_blend() computes dc + (((sc - dc) * alpha) >> 8); that is the
+	// same as (dc * (256 - alpha) + sc * alpha) >> 8, which does not go
+	// negative and so fits unsigned 16 bits.
+#if defined(SSE2_INTRIN)
+	if (factor >= 0 && factor < 255)
+	{
+		const __m128i zero = _mm_setzero_si128 ();
+		const __m128i mask = _mm_set1_epi32 ((int)rgbMask);
+		const __m128i a = _mm_set1_epi16 (factor);
+		const __m128i inv = _mm_set1_epi16 (256 - factor);
+
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128i d = _mm_loadu_si128 ((const __m128i *) (dst + x));
+			__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x));
+			__m128i lo = _mm_add_epi16 (
+					_mm_mullo_epi16 (_mm_unpacklo_epi8 (d, zero), inv),
+					_mm_mullo_epi16 (_mm_unpacklo_epi8 (s, zero), a));
+			__m128i hi = _mm_add_epi16 (
+					_mm_mullo_epi16 (_mm_unpackhi_epi8 (d, zero), inv),
+					_mm_mullo_epi16 (_mm_unpackhi_epi8 (s, zero), a));
+			__m128i r = _mm_packus_epi16 (_mm_srli_epi16 (lo, 8),
+					_mm_srli_epi16 (hi, 8));
+			_mm_storeu_si128 ((__m128i *) (dst + x),
+					_mm_and_si128 (r, mask));
+		}
+	}
+#elif defined(NEON_INTRIN)
+	if (factor >= 0 && factor < 255)
+	{
+		const uint32x4_t mask = vdupq_n_u32 (rgbMask);
+		const uint16_t a = (uint16_t) factor;
+		const uint16_t inv = (uint16_t) (256 - factor);
+
+		for (; x + 4 <= count; x += 4)
+		{
+			uint8x16_t d = vreinterpretq_u8_u32 (vld1q_u32 (dst + x));
+			uint8x16_t s = vreinterpretq_u8_u32 (vld1q_u32 (src + x));
+			uint16x8_t lo = vmlaq_n_u16 (
+					vmulq_n_u16 (vmovl_u8 (vget_low_u8 (d)), inv),
+					vmovl_u8 (vget_low_u8 (s)), a);
+			uint16x8_t hi = vmlaq_n_u16 (
+					vmulq_n_u16 (vmovl_u8 (vget_high_u8 (d)), inv),
+					vmovl_u8 (vget_high_u8 (s)), a);
+			uint8x16_t r = vcombine_u8 (vshrn_n_u16 (lo, 8),
+					vshrn_n_u16 (hi, 8));
+			vst1q_u32 (dst + x, vandq_u32 (vreinterpretq_u32_u8 (r), mask));
+		}
+	}
+#endif
+
+	for (; x < count; ++x)
+		dst[x] = alpha_32(dst[x], src[x], factor, rgbMask);
+}
+
+RenderSpanFn
+renderspan_for(SDL_Surface *surface, RenderKind kind)
+{
+	const SDL_PixelFormat *fmt = surface->format;
+
+	// Same restrictions as for renderpixel_for()
+	if (fmt->BytesPerPixel != 4)
+		return NULL;
+	if (fmt->Amask != 0 && kind != renderReplace)
+		return NULL;
+
+	switch (kind)
+	{
+	case renderReplace:
+		return &renderspan_replace;
+	case renderAdditive:
+		return &renderspan_additive;
+	case renderAlpha:
+		return &renderspan_alpha;
+	}
+	// should not ever get here
+	return NULL;
+}
+
 /* Line drawing routine
  * Adapted from Paul Heckbert's implementation of Bresenham's algorithm,
  * 3 Sep 85; taken from Graphics Gems I */
@@ -437,25 +666,36 @@ clip_line (int *lx1, int *ly1, int *lx2, int *ly2, const SDL_Rect *r)
 }
 
 void
-fillrect_prim(SDL_Rect r, Uint32 color, RenderPixelFn plot, int factor,
+fillrect_prim(SDL_Rect r, Uint32 color, RenderSpanFn span, int factor,
 		SDL_Surface *dst)
 {
+	const SDL_PixelFormat *fmt = dst->format;
+	Uint32 rgbMask = fmt->Rmask | fmt->Gmask | fmt->Bmask;
+	Uint32 row[SPAN_CHUNK];
 	int x, y;
-	int x1, y1;
+	int w, y1;
 	SDL_Rect clip_r;
 
 	SDL_GetClipRect (dst, &clip_r);
 	if (!clip_rect (&r, &clip_r))
 		return; // rect is completely outside clipping rectangle
 
-	// TODO: calculate destination pointer directly instead of
-	//   using the plot(x,y) version
-	x1 = r.x + r.w;
+	w = r.w;
+	for (x = 0; x < w && x < SPAN_CHUNK; ++x)
+		row[x] = color;
+
 	y1 = r.y + r.h;
 	for (y = r.y; y < y1; ++y)
 	{
-		for (x = r.x; x < x1; ++x)
-			plot(dst, x, y, color, factor);
+		Uint32 *p = (Uint32 *) ((Uint8 *)dst->pixels + y * dst->pitch)
+				+ r.x;
+		for (x = 0; x < w; x += SPAN_CHUNK)
+		{
+			int count = w - x;
+			if (count > SPAN_CHUNK)
+				count = SPAN_CHUNK;
+			span(p + x, row, count, factor, rgbMask);
+		}
 	}
 }
 
@@ -502,16 +742,33 @@ clip_rect(SDL_Rect *r, const SDL_Rect *clip_r)
 	return 1;
 }
 
+enum
+{
+	BLT_CONVERT,
+			// Any format, through SDL_GetRGBA() and SDL_MapRGBA()
+	BLT_PALETTE,
+			// 8bpp paletted, through a table for the palette
+	BLT_SAME_RGB,
+			// 32bpp with the color channels where 'dst' has them
+};
+
 void
-blt_prim(SDL_Surface *src, SDL_Rect src_r, RenderPixelFn plot, int factor,
+blt_prim(SDL_Surface *src, SDL_Rect src_r, RenderSpanFn span, int factor,
 		SDL_Surface *dst, SDL_Rect dst_r)
 {
 	SDL_PixelFormat *srcfmt = src->format;
 	SDL_Palette *srcpal = srcfmt->palette;
 	SDL_PixelFormat *dstfmt = dst->format;
+	Uint32 rgbMask = dstfmt->Rmask | dstfmt->Gmask | dstfmt->Bmask;
 	Uint32 mask = 0;
 	Uint32 key = ~0;
 	GetPixelFn getpix = getpixel_for(src);
+	Uint32 palmap[256];
+	Uint32 row[SPAN_CHUNK];
+	Uint8 opaque[SPAN_CHUNK];
+	int conv = BLT_CONVERT;
+	Uint32 keep = ~0;
+			// BLT_SAME_RGB: the source bits that are kept
 	SDL_Rect clip_r;
 	int x, y;
 
@@ -537,34 +794,105 @@ blt_prim(SDL_Surface *src, SDL_Rect src_r, RenderPixelFn plot, int factor,
 	{
 		mask = ~0;
 	}
-	// TODO: calculate the source and destination pointers directly
-	//   instead of using the plot(x,y) version
-	for (y = 0; y < src_r.h; ++y)
+
+	// Pick the quickest conversion to the destination format that
+	// gives the same pixels as SDL_GetRGBA() and SDL_MapRGBA()
+	if (srcpal && srcfmt->BytesPerPixel == 1)
 	{
-		for (x = 0; x < src_r.w; ++x)
+		int i;
+		for (i = 0; i < 256; ++i)
 		{
 			Uint8 r, g, b, a;
-			Uint32 p;
-			
-			p = getpix(src, src_r.x + x, src_r.y + y);
-			if (srcpal)
-			{	// source is paletted, colorkey does not use mask
-				if (p == key)
-					continue; // transparent pixel
+			SDL_GetRGBA(i, srcfmt, &r, &g, &b, &a);
+			palmap[i] = SDL_MapRGBA(dstfmt, r, g, b, a);
+		}
+		conv = BLT_PALETTE;
+	}
+	else if (!srcpal && srcfmt->BytesPerPixel == 4
+			&& srcfmt->Rmask == dstfmt->Rmask
+			&& srcfmt->Gmask == dstfmt->Gmask
+			&& srcfmt->Bmask == dstfmt->Bmask)
+	{
+		if (dstfmt->Amask == 0)
+		{
+			keep = rgbMask;
+			conv = BLT_SAME_RGB;
+		}
+		else if (srcfmt->Amask == dstfmt->Amask)
+		{
+			keep = rgbMask | dstfmt->Amask;
+			conv = BLT_SAME_RGB;
+		}
+	}
+
+	// TODO: handle source pixel alpha; the span functions should
+	//   probably get a source alpha row
+	for (y = 0; y < src_r.h; ++y)
+	{
+		const Uint8 *srcrow = (const Uint8 *)src->pixels
+				+ (src_r.y + y) * src->pitch;
+		Uint32 *dstrow = (Uint32 *) ((Uint8 *)dst->pixels
+				+ (dst_r.y + y) * dst->pitch) + dst_r.x;
+		int x0;
+
+		for (x0 = 0; x0 < src_r.w; x0 += SPAN_CHUNK)
+		{
+			int count = src_r.w - x0;
+			int run;
+
+			if (count > SPAN_CHUNK)
+				count = SPAN_CHUNK;
+
+			// convert the pixels to the destination format
+			for (x = 0; x < count; ++x)
+			{
+				int sx = src_r.x + x0 + x;
+				Uint32 p;
+
+				if (conv == BLT_PALETTE)
+				{	// source is paletted, colorkey does not use mask
+					p = srcrow[sx];
+					opaque[x] = (p != key);
+					row[x] = palmap[p];
+					continue;
+				}
+
+				if (conv == BLT_SAME_RGB)
+					p = ((const Uint32 *)srcrow)[sx];
+				else
+					p = getpix(src, sx, src_r.y + y);
+
+				if (srcpal)
+				{	// source is paletted, colorkey does not use mask
+					opaque[x] = (p != key);
+				}
+				else
+				{	// source is RGB(A), colorkey uses mask
+					opaque[x] = ((p & mask) != key);
+				}
+
+				if (conv == BLT_SAME_RGB)
+				{
+					row[x] = p & keep;
+				}
+				else
+				{
+					Uint8 r, g, b, a;
+					SDL_GetRGBA(p, srcfmt, &r, &g, &b, &a);
+					row[x] = SDL_MapRGBA(dstfmt, r, g, b, a);
+				}
 			}
-			else
-			{	// source is RGB(A), colorkey uses mask
-				if ((p & mask) == key)
+
+			// render the runs of non-transparent pixels
+			for (x = 0; x < count; x += run)
+			{
+				run = 1;
+				if (!opaque[x])
 					continue; // transparent pixel
+				while (x + run < count && opaque[x + run])
+					++run;
+				span(dstrow + x0 + x, row + x, run, factor, rgbMask);
 			}
-
-			// convert pixel format to destination
-			SDL_GetRGBA(p, srcfmt, &r, &g, &b, &a);
-			// TODO: handle source pixel alpha; plot() should probably
-			//   get a source alpha parameter
-			p = SDL_MapRGBA(dstfmt, r, g, b, a);
-			
-			plot(dst, dst_r.x + x, dst_r.y + y, p, factor);
 		}
 	}
 }
@@ -46,12 +46,20 @@ typedef void (*RenderPixelFn)(SDL_Surface *, int x, int y, Uint32 pixel,
 
 RenderPixelFn renderpixel_for(SDL_Surface *surface, RenderKind);
 
+// Renders 'count' pixels of 'src' onto 'dst', a whole row at a time;
+// both are in destination surface format. 'rgbMask' covers the color
+// channels of that format.
+typedef void (*RenderSpanFn)(Uint32 *dst, const Uint32 *src, int count,
+		int factor, Uint32 rgbMask);
+
+RenderSpanFn renderspan_for(SDL_Surface *surface, RenderKind);
+
 void line_prim(int x1, int y1, int x2, int y2, Uint32 color,
 		RenderPixelFn plot, int factor, SDL_Surface *dst);
 void fillrect_prim(SDL_Rect r, Uint32 color,
-		RenderPixelFn plot, int factor, SDL_Surface *dst);
+		RenderSpanFn span, int factor, SDL_Surface *dst);
 void blt_prim(SDL_Surface *src, SDL_Rect src_r,
-		RenderPixelFn plot, int factor,
+		RenderSpanFn span, int factor,
 		SDL_Surface *dst, SDL_Rect dst_r);
 
 int clip_line(int *lx1, int *ly1, int *lx2, int *ly2, const SDL_Rect *clip_r);
@@ -18,6 +18,7 @@
 #include "pure.h"
 #include "libs/graphics/bbox.h"
 #include "scalers.h"
+#include "libs/time/profile.h"
 #include "libs/log.h"
 
 #if SDL_MAJOR_VERSION == 1
@@ -368,8 +369,10 @@ TFB_Pure_Scaled_Postprocess (void)
 	SDL_LockSurface (scalebuffer);
 	SDL_LockSurface (backbuffer);
 
+	PROFILE_BEGIN (PROF_SCALE);
 	if (scaler)
 		scaler (backbuffer, scalebuffer, &updated);
+	PROFILE_END (PROF_SCALE);
 
 	if (GfxFlags & TFB_GFXFLAGS_SCANLINES)
 		ScanLines (scalebuffer, &updated);
@@ -409,10 +412,62 @@ TFB_Pure_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 	SDL_BlitSurface (SDL_Screens[screen], rect, backbuffer, rect);
 }	
 
+// Blends 'col' over 'rect' of a 32bpp surface in place, two channels
+// at a time, leaving the alpha channel alone, as an alpha blit would.
+// Saves reading a surface filled with the color.
+static void
+BlendColor32 (SDL_Surface *dst, SDL_Rect *rect, Uint32 col, Uint8 a)
+{
+	SDL_Rect r = {0, 0, 0, 0};
+	const Uint32 amask = dst->format->Amask;
+	// 255 is made 256, so that a fade reaches its color
+	const Uint32 mul = a + (a >> 7);
+	const Uint32 inv = 256 - mul;
+	const Uint32 colRB = (col & 0x00ff00ff) * mul;
+	const Uint32 colAG = ((col >> 8) & 0x00ff00ff) * mul;
+	int len;
+	Uint32 *p;
+	int x, y;
+
+	if (rect)
+		r = *rect;
+	else
+	{
+		r.w = dst->w;
+		r.h = dst->h;
+	}
+
+	SDL_LockSurface (dst);
+	len = dst->pitch / 4;
+	p = (Uint32 *) dst->pixels + len * r.y + r.x;
+	for (y = r.h; y; --y, p += len - r.w)
+	{
+		for (x = r.w; x; --x, ++p)
+		{
+			Uint32 pix = *p;
+			Uint32 rb = (((pix & 0x00ff00ff) * inv + colRB) >> 8)
+					& 0x00ff00ff;
+			Uint32 ag = (((pix >> 8) & 0x00ff00ff) * inv + colAG)
+					& 0xff00ff00;
+			*p = ((rb | ag) & ~amask) | (pix & amask);
+		}
+	}
+	SDL_UnlockSurface (dst);
+}
+
 static void
 TFB_Pure_ColorLayer (Uint8 r, Uint8 g, Uint8 b, Uint8 a, SDL_Rect *rect)
 {
 	Uint32 col = SDL_MapRGB (fade_color_surface->format, r, g, b);
+
+	if (backbuffer->format->BytesPerPixel == 4
+			&& backbuffer->format->Rmask == fade_color_surface->format->Rmask
+			&& backbuffer->format->Bmask == fade_color_surface->format->Bmask)
+	{
+		BlendColor32 (backbuffer, rect, col, a);
+		return;
+	}
+
 	if (col != fade_color)
 	{
 		fade_color = col;
@@ -23,6 +23,7 @@
 
 #include "libs/graphics/sdl/sdl_common.h"
 #include "types.h"
+#include "scalers.h"
 
 
 // Plain C names
@@ -88,12 +89,6 @@ typedef struct
 } Scale_FuncDef_t;
 
 
-// expands the given rectangle in all directions by 'expansion'
-// guarded by 'limits'
-extern void Scale_ExpandRect (SDL_Rect* rect, int expansion,
-				const SDL_Rect* limits);
-
-
 // Standard plain C versions of support functions
 
 // Initialize various platform-specific features
@@ -0,0 +1,130 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Multithreaded scaling.
+//
+// Every scaler reads the source surface only, and writes a destination
+// pixel purely as a function of the source, so any partition of the
+// update rect gives the same result.  The scalers do expand the rect
+// they are given by up to 2 pixels in each direction, however, so two
+// adjacent bands would write the same destination rows.  To keep threads
+// from writing the same memory, the bands are scaled in two phases:
+// first the even bands, then the odd ones.  Within a phase, bands are
+// always separated by at least one whole band, which is taller than
+// the expansion.
+// The bands are scaled on the shared work pool.
+
+#include "scalemt.h"
+#include "libs/graphics/gfx_common.h"
+#include "libs/threads/workpool.h"
+
+#define SCALE_MT_MAX_BANDS (2 * (WORKPOOL_MAX_WORKERS + 1))
+#define SCALE_MT_MIN_BAND_ROWS 8
+		// Must be larger than the largest scaler rect expansion
+
+typedef struct
+{
+	TFB_ScaleFunc func;
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	SDL_Rect bands[SCALE_MT_MAX_BANDS];
+	int numBands;
+} ScaleJob;
+
+static ScaleJob job;
+static TFB_ScaleFunc realScaler;
+static WorkGroup scaleGroup;
+static BOOLEAN scaleGroupInited;
+
+static void
+scaleBand (void *data, int band)
+{
+	// The scaler may expand the rect it is given
+	SDL_Rect r = job.bands[band];
+
+	(void) data;
+	job.func (job.src, job.dst, &r);
+}
+
+static void
+runPhase (int phase)
+{
+	int band;
+
+	for (band = phase; band < job.numBands; band += 2)
+		WorkGroup_submit (&scaleGroup, scaleBand, NULL, band);
+	WorkGroup_wait (&scaleGroup);
+}
+
+static void
+Scale_MT_Scale (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
+{
+	int bands, rows, y, i;
+
+	bands = 2 * (WorkPool_getWorkerCount () + 1);
+	if (bands * SCALE_MT_MIN_BAND_ROWS > r->h)
+		bands = r->h / SCALE_MT_MIN_BAND_ROWS;
+
+	if (bands < 2)
+	{	// Not worth splitting
+		realScaler (src, dst, r);
+		return;
+	}
+
+	job.func = realScaler;
+	job.src = src;
+	job.dst = dst;
+	job.numBands = bands;
+
+	rows = r->h / bands;
+	for (i = 0, y = r->y; i < bands; ++i, y += rows)
+	{
+		job.bands[i].x = r->x;
+		job.bands[i].y = y;
+		job.bands[i].w = r->w;
+		job.bands[i].h = rows;
+	}
+	// The last band takes the remainder
+	job.bands[bands - 1].h = r->y + r->h - job.bands[bands - 1].y;
+
+	runPhase (0);
+	runPhase (1);
+}
+
+TFB_ScaleFunc
+Scale_MT_Prepare (TFB_ScaleFunc func)
+{
+	if (WorkPool_getWorkerCount () == 0)
+		return func;
+
+	if (!scaleGroupInited)
+	{
+		WorkGroup_init (&scaleGroup, "Scaler done");
+		scaleGroupInited = TRUE;
+	}
+	realScaler = func;
+	return Scale_MT_Scale;
+}
+
+void
+Scale_MT_Uninit (void)
+{
+	if (!scaleGroupInited)
+		return;
+
+	WorkGroup_uninit (&scaleGroup);
+	scaleGroupInited = FALSE;
+}
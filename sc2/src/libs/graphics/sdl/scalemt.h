@@ -0,0 +1,29 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef SCALEMT_H_
+#define SCALEMT_H_
+
+#include "scalers.h"
+
+// Band-splitting executor for the screen scalers.
+// Scale_MT_Prepare() returns a scale function that splits each update
+// rect into horizontal bands and scales them on the work pool, using
+// 'func' for the actual work.
+TFB_ScaleFunc Scale_MT_Prepare (TFB_ScaleFunc func);
+void Scale_MT_Uninit (void);
+
+#endif /* SCALEMT_H_ */
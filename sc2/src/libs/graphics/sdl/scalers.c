@@ -19,6 +19,7 @@
 #include "libs/platform.h"
 #include "libs/log.h"
 #include "scalers.h"
+#include "scalemt.h"
 #include "scaleint.h"
 #include "2xscalers.h"
 #ifdef USE_PLATFORM_ACCEL
@@ -29,12 +30,27 @@
 #	ifdef MMX_ASM
 #		include "2xscalers_mmx.h"
 #	endif /* MMX_ASM */
+#	if defined(SSE2_INTRIN) || defined(NEON_INTRIN)
+#		include "2xscalers_simd.h"
+#	endif
 #endif /* USE_PLATFORM_ACCEL */
 
 #if SDL_MAJOR_VERSION == 1
 #define SDL_HasMMX SDL_HasMMXExt
 #endif
 
+#if SDL_MAJOR_VERSION == 1
+	// SDL 1.2 only knows about MMX-era extensions
+#	define Scale_HasSSE2() 0
+#	define Scale_HasAVX2() 0
+#elif !SDL_VERSION_ATLEAST(2, 0, 4)
+#	define Scale_HasSSE2() SDL_HasSSE2 ()
+#	define Scale_HasAVX2() 0
+#else
+#	define Scale_HasSSE2() SDL_HasSSE2 ()
+#	define Scale_HasAVX2() SDL_HasAVX2 ()
+#endif
+
 typedef enum
 {
 	SCALEPLAT_NULL    = PLATFORM_NULL,
@@ -43,6 +59,9 @@ typedef enum
 	SCALEPLAT_SSE     = PLATFORM_SSE,
 	SCALEPLAT_3DNOW   = PLATFORM_3DNOW,
 	SCALEPLAT_ALTIVEC = PLATFORM_ALTIVEC,
+	SCALEPLAT_SSE2    = PLATFORM_SSE2,
+	SCALEPLAT_AVX2    = PLATFORM_AVX2,
+	SCALEPLAT_NEON    = PLATFORM_NEON,
 		
 	SCALEPLAT_C_RGBA,
 	SCALEPLAT_C_BGRA,
@@ -190,6 +209,15 @@ typedef struct
 static const Scale_PlatDef_t
 Scale_PlatDefs[] =
 {
+#if defined(AVX2_INTRIN)
+	{SCALEPLAT_AVX2,    Scale_AVX2_Functions},
+#endif /* AVX2_INTRIN */
+#if defined(SSE2_INTRIN)
+	{SCALEPLAT_SSE2,    Scale_SSE2_Functions},
+#endif /* SSE2_INTRIN */
+#if defined(NEON_INTRIN)
+	{SCALEPLAT_NEON,    Scale_NEON_Functions},
+#endif /* NEON_INTRIN */
 #if defined(MMX_ASM)
 	{SCALEPLAT_SSE,     Scale_SSE_Functions},
 	{SCALEPLAT_3DNOW,   Scale_3DNow_Functions},
@@ -200,6 +228,17 @@ Scale_PlatDefs[] =
 };
 
 
+int
+Scale_GetExpansion (int flags)
+{
+	if (flags & (TFB_GFXFLAGS_SCALE_BIADAPT | TFB_GFXFLAGS_SCALE_BIADAPTADV))
+		return 2;
+	if (flags & (TFB_GFXFLAGS_SCALE_BILINEAR | TFB_GFXFLAGS_SCALE_TRISCAN
+			| TFB_GFXFLAGS_SCALE_HQXX))
+		return 1;
+	return 0; // nearest
+}
+
 TFB_ScaleFunc
 Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt)
 {
@@ -217,7 +256,37 @@ Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt)
 #else
 	// first match wins
 	// add better platform techs to the top
+	// the vector intrinsics versions give the same output as plain C
+#ifdef AVX2_INTRIN
+	if ( (!force_platform && Scale_HasAVX2 ())
+			|| force_platform == PLATFORM_AVX2)
+	{
+		log_add (log_Info, "Screen scalers are using AVX2 code");
+		Scale_Platform = SCALEPLAT_AVX2;
+	}
+#endif
+#ifdef SSE2_INTRIN
+	if (Scale_Platform == SCALEPLAT_NULL && (
+			(!force_platform && Scale_HasSSE2 ())
+			|| force_platform == PLATFORM_SSE2))
+	{
+		log_add (log_Info, "Screen scalers are using SSE2 code");
+		Scale_Platform = SCALEPLAT_SSE2;
+	}
+#endif
+#ifdef NEON_INTRIN
+	// a NEON build already requires NEON from the CPU
+	if (Scale_Platform == SCALEPLAT_NULL && (
+			!force_platform || force_platform == PLATFORM_NEON))
+	{
+		log_add (log_Info, "Screen scalers are using NEON code");
+		Scale_Platform = SCALEPLAT_NEON;
+	}
+#endif
 #ifdef MMX_ASM
+	if (Scale_Platform != SCALEPLAT_NULL)
+		; // already have the vector intrinsics versions
+	else
 	if ( (!force_platform && (SDL_HasSSE () || SDL_HasMMX ()))
 			|| force_platform == PLATFORM_SSE)
 	{
@@ -290,6 +359,9 @@ Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt)
 			++fdef)
 		;
 
+	if (flags & TFB_GFXFLAGS_SCALE_THREADED)
+		return Scale_MT_Prepare (fdef->func);
+
 	return fdef->func;
 }
 
@@ -24,4 +24,13 @@ typedef void (* TFB_ScaleFunc) (SDL_Surface *src, SDL_Surface *dst,
 
 TFB_ScaleFunc Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt);
 
+// expands the given rectangle in all directions by 'expansion'
+// guarded by 'limits'
+extern void Scale_ExpandRect (SDL_Rect* rect, int expansion,
+				const SDL_Rect* limits);
+
+// how far the scaler for 'flags' expands the rectangle it is given;
+// it writes the destination pixels for all of the expanded rectangle
+int Scale_GetExpansion (int flags);
+
 #endif /* SCALERS_H_ */
@@ -0,0 +1,424 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Vector (SSE2, AVX2, NEON) support for the 2x scaler templates
+//  The kernels here do exactly the per-channel math of the plain C
+//  versions, only several pixels at a time, so their output is
+//  bit-exact with the C scalers.  Everything the kernels do not cover
+//  falls back on the plain C helpers from scaleint.h.
+
+#ifndef SCALESIMD_H_
+#define SCALESIMD_H_
+
+#if !defined(SCALE_)
+#	error Please define SCALE_(name) before including scalesimd.h
+#endif
+
+#if defined(SCALE_SIMD_AVX2)
+#	include <immintrin.h>
+#	if defined(__GNUC__)
+		// AVX2 is detected at runtime, so only these functions may
+		// use it; the rest of the build stays at the SSE2 baseline
+#		define SCALE_SIMD_TARGET __attribute__((target("avx2")))
+#	endif
+#elif defined(SCALE_SIMD_SSE2)
+#	include <emmintrin.h>
+#elif defined(SCALE_SIMD_NEON)
+#	include <arm_neon.h>
+#else
+#	error Please define target instruction set (SCALE_SIMD_SSE2, SCALE_SIMD_AVX2, SCALE_SIMD_NEON) before including scalesimd.h
+#endif
+
+#ifndef SCALE_SIMD_TARGET
+#	define SCALE_SIMD_TARGET
+#endif
+
+// Plain C helpers for the scalar parts of the templates
+#undef  SCALE_CMPRGB
+#define SCALE_CMPRGB(p1, p2) \
+			Scale_GetRGBDelta (fmt, p1, p2)
+
+#undef  SCALE_TOYUV
+#define SCALE_TOYUV(p) \
+			Scale_RGBtoYUV (fmt, p)
+
+#undef  SCALE_CMPYUV
+#define SCALE_CMPYUV(p1, p2, toler) \
+			Scale_CmpYUV (fmt, p1, p2, toler)
+
+#undef  SCALE_DIFFYUV
+#define SCALE_DIFFYUV(p1, p2) \
+			Scale_DiffYUV (p1, p2)
+
+#undef  SCALE_GETY
+#define SCALE_GETY(p) \
+			Scale_GetPixY (fmt, p)
+
+#undef  SCALE_BILINEAR_BLEND4
+#define SCALE_BILINEAR_BLEND4(r0, r1, dst, dlen) \
+			Scale_Blend_bilinear (r0, r1, dst, dlen)
+
+// Vector kernel hooks picked up by the templates
+#define SCALE_NEAREST_ROW(src_p, dst_p, dlen, count) \
+			SCALE_(NearestRow) (src_p, dst_p, dlen, count)
+
+#define SCALE_BILINEAR_ROW(row0, row1, dst_p, dlen, count) \
+			SCALE_(BilinearRow) (row0, row1, dst_p, dlen, count)
+
+#define SCALE_TRISCAN_ROW(src_p, prevline, nextline, dst_p, dlen, count) \
+			SCALE_(TriScanRow) (fmt, src_p, prevline, nextline, \
+					dst_p, dlen, count, TRISCAN_YUV_MED)
+
+#define SCALE_HQXX_PATTERN(yuv) \
+			SCALE_(HqPattern) (yuv)
+
+
+// Lane-wise operations on 32-bit pixels
+//	SIMD_ANDNOT(m, a) is (~m & a)
+//	SIMD_MULC(v, c) only needs to handle 16-bit signed v and c
+//	SIMD_STORE2X(p, a, b) stores a[0] b[0] a[1] b[1] ...
+#if defined(SCALE_SIMD_AVX2)
+
+typedef __m256i SIMD_V;
+#define SIMD_WIDTH              8
+#define SIMD_LOAD(p)            _mm256_loadu_si256 ((const __m256i *)(p))
+#define SIMD_STORE(p, v)        _mm256_storeu_si256 ((__m256i *)(p), (v))
+#define SIMD_SET1(c)            _mm256_set1_epi32 ((int)(c))
+#define SIMD_AND(a, b)          _mm256_and_si256 ((a), (b))
+#define SIMD_OR(a, b)           _mm256_or_si256 ((a), (b))
+#define SIMD_ANDNOT(m, a)       _mm256_andnot_si256 ((m), (a))
+#define SIMD_ADD(a, b)          _mm256_add_epi32 ((a), (b))
+#define SIMD_SUB(a, b)          _mm256_sub_epi32 ((a), (b))
+#define SIMD_SRLI(v, n)         _mm256_srli_epi32 ((v), (n))
+#define SIMD_SRAI(v, n)         _mm256_srai_epi32 ((v), (n))
+#define SIMD_SRL(v, n)          _mm256_srl_epi32 ((v), _mm_cvtsi32_si128 (n))
+#define SIMD_MULC(v, c)         _mm256_mullo_epi32 ((v), SIMD_SET1 (c))
+#define SIMD_ABS(v)             _mm256_abs_epi32 (v)
+#define SIMD_CMPGT(a, b)        _mm256_cmpgt_epi32 ((a), (b))
+#define SIMD_STORE2X(p, a, b) \
+		do { \
+			__m256i lo_ = _mm256_unpacklo_epi32 ((a), (b)); \
+			__m256i hi_ = _mm256_unpackhi_epi32 ((a), (b)); \
+			SIMD_STORE ((p), _mm256_permute2x128_si256 (lo_, hi_, 0x20)); \
+			SIMD_STORE ((p) + 8, _mm256_permute2x128_si256 (lo_, hi_, 0x31)); \
+		} while (0)
+
+#elif defined(SCALE_SIMD_SSE2)
+
+typedef __m128i SIMD_V;
+#define SIMD_WIDTH              4
+#define SIMD_LOAD(p)            _mm_loadu_si128 ((const __m128i *)(p))
+#define SIMD_STORE(p, v)        _mm_storeu_si128 ((__m128i *)(p), (v))
+#define SIMD_SET1(c)            _mm_set1_epi32 ((int)(c))
+#define SIMD_AND(a, b)          _mm_and_si128 ((a), (b))
+#define SIMD_OR(a, b)           _mm_or_si128 ((a), (b))
+#define SIMD_ANDNOT(m, a)       _mm_andnot_si128 ((m), (a))
+#define SIMD_ADD(a, b)          _mm_add_epi32 ((a), (b))
+#define SIMD_SUB(a, b)          _mm_sub_epi32 ((a), (b))
+#define SIMD_SRLI(v, n)         _mm_srli_epi32 ((v), (n))
+#define SIMD_SRAI(v, n)         _mm_srai_epi32 ((v), (n))
+#define SIMD_SRL(v, n)          _mm_srl_epi32 ((v), _mm_cvtsi32_si128 (n))
+	// SSE2 has no 32-bit multiply; the high word of c is 0, and
+	// pmaddwd then yields the 32-bit product of the low words
+#define SIMD_MULC(v, c)         _mm_madd_epi16 ((v), SIMD_SET1 ((c) & 0xffff))
+#define SIMD_ABS(v)             SCALE_(Abs) (v)
+#define SIMD_CMPGT(a, b)        _mm_cmpgt_epi32 ((a), (b))
+#define SIMD_STORE2X(p, a, b) \
+		do { \
+			SIMD_STORE ((p), _mm_unpacklo_epi32 ((a), (b))); \
+			SIMD_STORE ((p) + 4, _mm_unpackhi_epi32 ((a), (b))); \
+		} while (0)
+
+static inline __m128i
+SCALE_(Abs) (__m128i v)
+{
+	__m128i sign = _mm_srai_epi32 (v, 31);
+	return _mm_sub_epi32 (_mm_xor_si128 (v, sign), sign);
+}
+
+#elif defined(SCALE_SIMD_NEON)
+
+typedef uint32x4_t SIMD_V;
+#define SIMD_WIDTH              4
+#define SIMD_LOAD(p)            vld1q_u32 ((const uint32_t *)(p))
+#define SIMD_STORE(p, v)        vst1q_u32 ((uint32_t *)(p), (v))
+#define SIMD_SET1(c)            vdupq_n_u32 ((uint32_t)(c))
+#define SIMD_AND(a, b)          vandq_u32 ((a), (b))
+#define SIMD_OR(a, b)           vorrq_u32 ((a), (b))
+#define SIMD_ANDNOT(m, a)       vbicq_u32 ((a), (m))
+#define SIMD_ADD(a, b)          vaddq_u32 ((a), (b))
+#define SIMD_SUB(a, b)          vsubq_u32 ((a), (b))
+#define SIMD_SRLI(v, n)         vshrq_n_u32 ((v), (n))
+#define SIMD_SRAI(v, n) \
+		vreinterpretq_u32_s32 (vshrq_n_s32 (vreinterpretq_s32_u32 (v), (n)))
+#define SIMD_SRL(v, n)          vshlq_u32 ((v), vdupq_n_s32 (-(int)(n)))
+#define SIMD_MULC(v, c)         vmulq_n_u32 ((v), (uint32_t)(c))
+#define SIMD_ABS(v) \
+		vreinterpretq_u32_s32 (vabsq_s32 (vreinterpretq_s32_u32 (v)))
+#define SIMD_CMPGT(a, b) \
+		vcgtq_s32 (vreinterpretq_s32_u32 (a), vreinterpretq_s32_u32 (b))
+#define SIMD_STORE2X(p, a, b) \
+		do { \
+			uint32x4x2_t pair_; \
+			pair_.val[0] = (a); \
+			pair_.val[1] = (b); \
+			vst2q_u32 ((uint32_t *)(p), pair_); \
+		} while (0)
+
+#endif
+
+// Per-lane Scale_Blend_11()
+#define SIMD_BLEND_11(p1, p2, mask) \
+		SIMD_ADD (SIMD_SRLI (SIMD_AND ((p1), (mask)), 1), \
+				SIMD_SRLI (SIMD_AND ((p2), (mask)), 1))
+
+// Per-lane choice: (m ? a : b)
+#define SIMD_SELECT(m, a, b) \
+		SIMD_OR (SIMD_AND ((m), (a)), SIMD_ANDNOT ((m), (b)))
+
+
+// Standard support functions; nothing to set up for the vector units
+
+static inline void
+SCALE_(PlatInit) (void)
+{
+}
+
+static inline void
+SCALE_(PlatDone) (void)
+{
+}
+
+static inline void
+SCALE_(Prefetch) (const void* p)
+{
+	(void)p; // silence compiler
+	/* no-op; hardware prefetch does fine with these row scans */
+}
+
+
+// Nearest Neighbor row: doubles 'count' pixels into two rows
+static SCALE_SIMD_TARGET void
+SCALE_(NearestRow) (const Uint32 *src_p, Uint32 *dst_p, int dlen, int count)
+{
+	int x;
+
+	for (x = 0; x + SIMD_WIDTH <= count; x += SIMD_WIDTH,
+			src_p += SIMD_WIDTH, dst_p += SIMD_WIDTH * 2)
+	{
+		SIMD_V pix = SIMD_LOAD (src_p);
+		SIMD_STORE2X (dst_p, pix, pix);
+		SIMD_STORE2X (dst_p + dlen, pix, pix);
+	}
+
+	for (; x < count; ++x, ++src_p, dst_p += 2)
+	{
+		Uint32 pix = *src_p;
+		dst_p[0] = pix;
+		dst_p[1] = pix;
+		dst_p[dlen] = pix;
+		dst_p[dlen + 1] = pix;
+	}
+}
+
+// Bilinear row: the lane-wise equivalent of Scale_Blend_bilinear()
+// Reads one pixel past 'count' in both rows; leaves the last
+// (count % SIMD_WIDTH) pixels to the caller, returns pixels done
+static SCALE_SIMD_TARGET int
+SCALE_(BilinearRow) (const Uint32 *row0, const Uint32 *row1,
+		Uint32 *dst_p, int dlen, int count)
+{
+	const SIMD_V half_mask = SIMD_SET1 (0xfefefefe);
+	const SIMD_V half_err = SIMD_SET1 (0x01010101);
+	int x;
+
+#	define BL_PACKED_HALF(p) \
+			SIMD_SRLI (SIMD_AND ((p), half_mask), 1)
+#	define BL_SUM(p1, p2) \
+			SIMD_ADD (BL_PACKED_HALF (p1), BL_PACKED_HALF (p2))
+#	define BL_SUM_WERR(p1, p2) \
+			SIMD_ADD (BL_SUM (p1, p2), half_err)
+
+	for (x = 0; x + SIMD_WIDTH <= count; x += SIMD_WIDTH,
+			dst_p += SIMD_WIDTH * 2)
+	{
+		SIMD_V p0 = SIMD_LOAD (row0 + x);
+		SIMD_V p1 = SIMD_LOAD (row0 + x + 1);
+		SIMD_V p2 = SIMD_LOAD (row1 + x);
+		SIMD_V p3 = SIMD_LOAD (row1 + x + 1);
+		SIMD_V sum1111, sum1331, sum3113;
+
+		sum1331 = BL_SUM (p1, p2);
+		sum3113 = BL_SUM (p0, p3);
+		sum1111 = BL_SUM_WERR (sum1331, sum3113);
+
+		sum1331 = BL_PACKED_HALF (BL_SUM_WERR (sum1331, sum1111));
+		sum3113 = BL_PACKED_HALF (BL_SUM_WERR (sum3113, sum1111));
+
+		SIMD_STORE2X (dst_p,
+				SIMD_ADD (BL_PACKED_HALF (p0), sum1331),
+				SIMD_ADD (BL_PACKED_HALF (p1), sum3113));
+		SIMD_STORE2X (dst_p + dlen,
+				SIMD_ADD (BL_PACKED_HALF (p2), sum3113),
+				SIMD_ADD (BL_PACKED_HALF (p3), sum1331));
+	}
+
+#	undef BL_PACKED_HALF
+#	undef BL_SUM
+#	undef BL_SUM_WERR
+
+	return x;
+}
+
+// Lane-wise Scale_CmpYUV(): ~0 where the pixels are close
+// Computes each matrix term like dRGB_to_dYUV[] does, so the
+// result is the same as the table lookups
+static inline SCALE_SIMD_TARGET SIMD_V
+SCALE_(CmpYUVVec) (const SDL_PixelFormat* fmt, SIMD_V pix1, SIMD_V pix2,
+		int toler)
+{
+	const SIMD_V chan_mask = SIMD_SET1 (0xff);
+	SIMD_V dr, dg, db;
+	SIMD_V delta;
+
+	dr = SIMD_SUB (SIMD_AND (SIMD_SRL (pix1, fmt->Rshift), chan_mask),
+			SIMD_AND (SIMD_SRL (pix2, fmt->Rshift), chan_mask));
+	dg = SIMD_SUB (SIMD_AND (SIMD_SRL (pix1, fmt->Gshift), chan_mask),
+			SIMD_AND (SIMD_SRL (pix2, fmt->Gshift), chan_mask));
+	db = SIMD_SUB (SIMD_AND (SIMD_SRL (pix1, fmt->Bshift), chan_mask),
+			SIMD_AND (SIMD_SRL (pix2, fmt->Bshift), chan_mask));
+
+#	define YUV_DELTA(c) \
+			SIMD_ADD (SIMD_ADD ( \
+				SIMD_SRAI (SIMD_MULC (dr, YUV_matrix[YUV_XFORM_R][c]), 14), \
+				SIMD_SRAI (SIMD_MULC (dg, YUV_matrix[YUV_XFORM_G][c]), 14)), \
+				SIMD_SRAI (SIMD_MULC (db, YUV_matrix[YUV_XFORM_B][c]), 14))
+
+	delta = SIMD_ADD (SIMD_ADD (
+			SIMD_ABS (YUV_DELTA (YUV_XFORM_Y)),
+			SIMD_ABS (YUV_DELTA (YUV_XFORM_U))),
+			SIMD_ABS (YUV_DELTA (YUV_XFORM_V)));
+
+#	undef YUV_DELTA
+
+	return SIMD_CMPGT (SIMD_SET1 (toler + 1), delta);
+}
+
+// Triscan row: the same decisions as the template makes, one pixel
+// per lane.  Needs the pixels left and right of the span, so the span
+// must not touch either edge of the surface; returns pixels done
+static SCALE_SIMD_TARGET int
+SCALE_(TriScanRow) (const SDL_PixelFormat* fmt, const Uint32 *src_p,
+		int prevline, int nextline, Uint32 *dst_p, int dlen, int count,
+		int toler)
+{
+	const SIMD_V half_mask = SIMD_SET1 (0xfefefefe);
+	int x;
+
+	for (x = 0; x + SIMD_WIDTH <= count; x += SIMD_WIDTH,
+			src_p += SIMD_WIDTH, dst_p += SIMD_WIDTH * 2)
+	{
+		SIMD_V pc = SIMD_LOAD (src_p);
+		SIMD_V pl = SIMD_LOAD (src_p - 1);
+		SIMD_V pr = SIMD_LOAD (src_p + 1);
+		SIMD_V pt = SIMD_LOAD (src_p + prevline);
+		SIMD_V pb = SIMD_LOAD (src_p + nextline);
+		SIMD_V flat;
+		SIMD_V d0, d1, d2, d3;
+
+		// wherever either pair of opposite neighbours is close,
+		// all 4 destination pixels are just the source pixel
+		flat = SIMD_OR (SCALE_(CmpYUVVec) (fmt, pt, pb, toler),
+				SCALE_(CmpYUVVec) (fmt, pl, pr, toler));
+
+		d0 = SIMD_ANDNOT (flat, SCALE_(CmpYUVVec) (fmt, pl, pt, toler));
+		d0 = SIMD_SELECT (d0, SIMD_BLEND_11 (pl, pt, half_mask), pc);
+		d1 = SIMD_ANDNOT (flat, SCALE_(CmpYUVVec) (fmt, pr, pt, toler));
+		d1 = SIMD_SELECT (d1, SIMD_BLEND_11 (pr, pt, half_mask), pc);
+		d2 = SIMD_ANDNOT (flat, SCALE_(CmpYUVVec) (fmt, pl, pb, toler));
+		d2 = SIMD_SELECT (d2, SIMD_BLEND_11 (pl, pb, half_mask), pc);
+		d3 = SIMD_ANDNOT (flat, SCALE_(CmpYUVVec) (fmt, pr, pb, toler));
+		d3 = SIMD_SELECT (d3, SIMD_BLEND_11 (pr, pb, half_mask), pc);
+
+		SIMD_STORE2X (dst_p, d0, d1);
+		SIMD_STORE2X (dst_p + dlen, d2, d3);
+	}
+
+	return x;
+}
+
+// Hq2x neighbour pattern: the 8 Scale_DiffYUV() tests at once
+// yuv[] is the template's sliding window, yuv[5] is the center.
+// A byte-wise saturated |a - b| minus the tolerance is non-zero
+// exactly where Scale_DiffYUV() finds the channel too far off.
+// AVX2 gains nothing over SSE2 for 8 pixels, and this is called for
+// every pixel, so it stays inline SSE2 there too.
+#define SCALE_HQXX_THRESHOLDS \
+		(0xff000000 | (SCALE_DIFFYUV_TY << 16) | \
+		(SCALE_DIFFYUV_TU << 8) | SCALE_DIFFYUV_TV)
+
+#if defined(SCALE_SIMD_SSE2) || defined(SCALE_SIMD_AVX2)
+
+static inline int
+SCALE_(HqPattern) (const Uint32 *yuv)
+{
+	const __m128i thresh = _mm_set1_epi32 ((int)SCALE_HQXX_THRESHOLDS);
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i center = _mm_set1_epi32 ((int)yuv[5]);
+	__m128i lo = _mm_loadu_si128 ((const __m128i *)(yuv + 1));
+	__m128i hi = _mm_loadu_si128 ((const __m128i *)(yuv + 6));
+
+	lo = _mm_or_si128 (_mm_subs_epu8 (lo, center),
+			_mm_subs_epu8 (center, lo));
+	lo = _mm_cmpeq_epi32 (_mm_subs_epu8 (lo, thresh), zero);
+	hi = _mm_or_si128 (_mm_subs_epu8 (hi, center),
+			_mm_subs_epu8 (center, hi));
+	hi = _mm_cmpeq_epi32 (_mm_subs_epu8 (hi, thresh), zero);
+
+	// set lanes are the close neighbours
+	return ~(_mm_movemask_ps (_mm_castsi128_ps (lo))
+			| (_mm_movemask_ps (_mm_castsi128_ps (hi)) << 4)) & 0xff;
+}
+
+#elif defined(SCALE_SIMD_NEON)
+
+static inline int
+SCALE_(HqPattern) (const Uint32 *yuv)
+{
+	static const uint32_t bits[8] =
+			{0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+	const uint8x16_t thresh =
+			vreinterpretq_u8_u32 (vdupq_n_u32 (SCALE_HQXX_THRESHOLDS));
+	const uint8x16_t center = vreinterpretq_u8_u32 (vdupq_n_u32 (yuv[5]));
+	uint32x4_t lo, hi;
+	uint32x2_t sum;
+
+	lo = vreinterpretq_u32_u8 (vqsubq_u8 (vabdq_u8 (
+			vreinterpretq_u8_u32 (vld1q_u32 (yuv + 1)), center), thresh));
+	hi = vreinterpretq_u32_u8 (vqsubq_u8 (vabdq_u8 (
+			vreinterpretq_u8_u32 (vld1q_u32 (yuv + 6)), center), thresh));
+
+	// set lanes are the distant neighbours; fold them into bits
+	lo = vandq_u32 (vtstq_u32 (lo, lo), vld1q_u32 (bits));
+	hi = vandq_u32 (vtstq_u32 (hi, hi), vld1q_u32 (bits + 4));
+	lo = vorrq_u32 (lo, hi);
+	sum = vorr_u32 (vget_low_u32 (lo), vget_high_u32 (lo));
+	return (int)(vget_lane_u32 (sum, 0) | vget_lane_u32 (sum, 1));
+}
+
+#endif
+
+#endif /* SCALESIMD_H_ */
@@ -20,6 +20,8 @@
 #include "libs/log.h"
 #include "scalers.h"
 #include "uqmversion.h"
+#include "libs/time/profile.h"
+#include "libs/timelib.h"
 
 #if SDL_MAJOR_VERSION > 1
 
@@ -28,6 +30,9 @@ typedef struct tfb_sdl2_screeninfo_s {
 	SDL_Texture *texture;
 	BOOLEAN dirty, active;
 	SDL_Rect updated;
+			// Bounding box of the regions below
+	SDL_Rect updated_rects[TFB_BBOX_MAX_DIRTY_RECTS];
+	int num_updated;
 } TFB_SDL2_SCREENINFO;
 
 static TFB_SDL2_SCREENINFO SDL2_Screens[TFB_GFX_NUMSCREENS];
@@ -39,6 +44,57 @@ static const char *rendererBackend = NULL;
 static int ScreenFilterMode;
 
 static TFB_ScaleFunc scaler = NULL;
+static int scaleExpansion = 0;
+		// Scale_GetExpansion() of the scaler
+
+static SDL_Surface *directSurface = NULL;
+		// Stands for a locked texture when the scaler writes straight
+		// into it; see TFB_SDL2_ScaleToTexture(). NULL when the
+		// textures are not locked.
+
+/* With TFB_GFXFLAGS_SCALE_ADAPTIVE, the scaler steps down to a cheaper
+ * one when scaling a whole screen would take more than SCALE_BUDGET_US,
+ * and back up, as far as the configured one, when the better one fits
+ * again. Scalers are judged by their cost per pixel, which, unlike their
+ * cost per frame, does not depend on how much of the screen changed. To
+ * step up without a fresh measurement of the better scaler, it is tried
+ * for a while, when the current one takes less than half the budget. */
+static const struct
+{
+	int flag;
+	const char *name;
+} scaleSteps[] =
+{
+	{TFB_GFXFLAGS_SCALE_HQXX,       "hq"},
+	{TFB_GFXFLAGS_SCALE_BIADAPTADV, "biadv"},
+	{TFB_GFXFLAGS_SCALE_BIADAPT,    "biadapt"},
+	{TFB_GFXFLAGS_SCALE_TRISCAN,    "triscan"},
+	{0,                             "nearest"},
+};
+#define NUM_SCALE_STEPS (sizeof scaleSteps / sizeof scaleSteps[0])
+#define SCALE_BUDGET_US 8000
+		// Half of a frame at 60 Hz
+#define SCALE_SAMPLE_PIXELS (320 * 240 * 30)
+		// A scaler is judged after it has scaled about 30 whole screens
+#define SCALE_RETRY_INTERVAL (ONE_SECOND * 30)
+		// How long the cost measured for a scaler is believed
+
+static struct
+{
+	BOOLEAN enabled;
+	int flags;
+			// The video flags, with the configured scaler
+	int top;
+			// The step of the configured scaler
+	int step;
+	BOOLEAN redraw;
+			// The scaler changed; the scaled screens are redone
+	DWORD sumUs;
+	DWORD sumPixels;
+	float costPerPixel[NUM_SCALE_STEPS];
+			// In microseconds; 0 when not measured
+	TimeCount measuredAt[NUM_SCALE_STEPS];
+} scaleGovernor;
 
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
 #define A_MASK 0xff000000
@@ -73,6 +129,128 @@ static TFB_GRAPHICS_BACKEND sdl2_unscaled_backend = {
         TFB_SDL2_Unscaled_ScreenLayer,
         TFB_SDL2_ColorLayer };
 
+// SDL_LockTexture() is not safe with every driver; see
+// TFB_SDL2_UpdateTexture().
+static BOOLEAN
+TFB_SDL2_CanLockTextures (void)
+{
+	SDL_RendererInfo info;
+
+	if (SDL_GetRendererInfo (renderer, &info) != 0)
+		return FALSE;
+	return strcmp (info.name, "direct3d") != 0;
+}
+
+static void
+TFB_SDL2_UninitDirectScale (void)
+{
+	if (directSurface)
+	{
+		SDL_FreeSurface (directSurface);
+		directSurface = NULL;
+	}
+}
+
+static void
+TFB_SDL2_InitDirectScale (void)
+{
+	TFB_SDL2_UninitDirectScale ();
+	if (!TFB_SDL2_CanLockTextures ())
+		return;
+
+	// The pixels and pitch are filled in for every lock
+	directSurface = SDL_CreateRGBSurfaceFrom (NULL,
+			ScreenWidth * 2, ScreenHeight * 2, 32, ScreenWidth * 2 * 4,
+			R_MASK, G_MASK, B_MASK, 0);
+	if (!directSurface)
+	{
+		log_add (log_Warning, "Couldn't create the surface to scale to "
+				"textures directly: %s", SDL_GetError ());
+	}
+}
+
+static void
+TFB_SDL2_InitScaleGovernor (int flags)
+{
+	int i;
+
+	memset (&scaleGovernor, 0, sizeof scaleGovernor);
+	if (!(flags & TFB_GFXFLAGS_SCALE_ADAPTIVE))
+		return;
+
+	for (i = 0; i < (int) NUM_SCALE_STEPS; ++i)
+	{
+		if ((flags & TFB_GFXFLAGS_SCALE_ANY) == scaleSteps[i].flag)
+			break;
+	}
+	if (i == NUM_SCALE_STEPS || i == NUM_SCALE_STEPS - 1)
+		return; // Not a software scaler, or nothing cheaper
+
+	scaleGovernor.enabled = TRUE;
+	scaleGovernor.flags = flags;
+	scaleGovernor.top = i;
+	scaleGovernor.step = i;
+}
+
+static void
+TFB_SDL2_SetScaleStep (int step, DWORD fullScreenUs)
+{
+	int flags = (scaleGovernor.flags & ~TFB_GFXFLAGS_SCALE_ANY)
+			| scaleSteps[step].flag;
+
+	log_add (log_Info, "Scaler '%s' takes %u us for a whole screen; "
+			"switching to '%s'.", scaleSteps[scaleGovernor.step].name,
+			(unsigned) fullScreenUs, scaleSteps[step].name);
+
+	scaler = Scale_PrepPlatform (flags, SDL2_Screens[0].scaled->format);
+	scaleExpansion = Scale_GetExpansion (flags);
+	scaleGovernor.step = step;
+	scaleGovernor.redraw = TRUE;
+}
+
+// Called once per frame displayed
+static void
+TFB_SDL2_RunScaleGovernor (void)
+{
+	TimeCount now;
+	int step = scaleGovernor.step;
+	float cost;
+	DWORD fullScreenUs;
+
+	if (scaleGovernor.sumPixels < SCALE_SAMPLE_PIXELS)
+		return;
+
+	now = GetTimeCounter ();
+	cost = (float) scaleGovernor.sumUs / scaleGovernor.sumPixels;
+	scaleGovernor.costPerPixel[step] = cost;
+	scaleGovernor.measuredAt[step] = now;
+	scaleGovernor.sumUs = 0;
+	scaleGovernor.sumPixels = 0;
+
+	fullScreenUs = (DWORD) (cost * ScreenWidth * ScreenHeight);
+	if (fullScreenUs > SCALE_BUDGET_US)
+	{
+		if (step < (int) NUM_SCALE_STEPS - 1)
+			TFB_SDL2_SetScaleStep (step + 1, fullScreenUs);
+	}
+	else if (step > scaleGovernor.top)
+	{
+		float better = scaleGovernor.costPerPixel[step - 1];
+
+		if (better && now - scaleGovernor.measuredAt[step - 1]
+				< SCALE_RETRY_INTERVAL)
+		{	// Known; step up when it fits with some room to spare
+			if (better * ScreenWidth * ScreenHeight
+					< SCALE_BUDGET_US * 3 / 4)
+				TFB_SDL2_SetScaleStep (step - 1, fullScreenUs);
+		}
+		else if (fullScreenUs < SCALE_BUDGET_US / 2)
+		{	// Try it
+			TFB_SDL2_SetScaleStep (step - 1, fullScreenUs);
+		}
+	}
+}
+
 static SDL_Surface *
 Create_Screen (int w, int h)
 {
@@ -150,7 +328,11 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height, int toggl
 		{
 			return -1;
 		}
-		renderer = SDL_CreateRenderer (window, FindBestRenderDriver (), 0);
+		renderer = SDL_CreateRenderer (window, FindBestRenderDriver (),
+				(flags & TFB_GFXFLAGS_VSYNC) ?
+				SDL_RENDERER_PRESENTVSYNC : 0);
+				// XXX: Only takes effect when the renderer is created;
+				//      changing it afterwards needs a restart.
 		if (!renderer)
 		{
 			return -1;
@@ -233,6 +415,9 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height, int toggl
 			SDL_UnlockSurface (SDL2_Screens[i].scaled);
 		}
 		scaler = Scale_PrepPlatform (flags, SDL2_Screens[0].scaled->format);
+		scaleExpansion = Scale_GetExpansion (flags);
+		TFB_SDL2_InitDirectScale ();
+		TFB_SDL2_InitScaleGovernor (flags);
 		graphics_backend = &sdl2_scaled_backend;
 	}
 	else
@@ -255,6 +440,8 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height, int toggl
 			SDL_UnlockSurface (SDL_Screens[i]);
 		}
 		scaler = NULL;
+		TFB_SDL2_UninitDirectScale ();
+		scaleGovernor.enabled = FALSE;
 		graphics_backend = &sdl2_unscaled_backend;
 	}
 
@@ -292,6 +479,7 @@ TFB_Pure_InitGraphics (int driver, int flags, const char *renderer, int width, i
 void
 TFB_Pure_UninitGraphics (void)
 {
+	TFB_SDL2_UninitDirectScale ();
 	if (renderer) {
 		SDL_DestroyRenderer (renderer);
 	}
@@ -300,6 +488,39 @@ TFB_Pure_UninitGraphics (void)
 	}
 }
 
+// Mark the whole of the 'updated' rect as needing an upload
+static void
+TFB_SDL2_SetUpdatedFull (TFB_SDL2_SCREENINFO *info)
+{
+	info->updated_rects[0] = info->updated;
+	info->num_updated = 1;
+}
+
+// Only upload the dirty tiles from the bounding box, unless there
+// are too many separate regions to be worth it.
+static void
+TFB_SDL2_SetUpdatedTiles (TFB_SDL2_SCREENINFO *info)
+{
+	RECT rects[TFB_BBOX_MAX_DIRTY_RECTS];
+	int count, i;
+
+	count = TFB_BBox_GetDirtyRects (rects, TFB_BBOX_MAX_DIRTY_RECTS);
+	if (count <= 0)
+	{
+		TFB_SDL2_SetUpdatedFull (info);
+		return;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		info->updated_rects[i].x = rects[i].corner.x;
+		info->updated_rects[i].y = rects[i].corner.y;
+		info->updated_rects[i].w = rects[i].extent.width;
+		info->updated_rects[i].h = rects[i].extent.height;
+	}
+	info->num_updated = count;
+}
+
 static void
 TFB_SDL2_UploadTransitionScreen (void)
 {
@@ -307,6 +528,7 @@ TFB_SDL2_UploadTransitionScreen (void)
 	SDL2_Screens[TFB_SCREEN_TRANSITION].updated.y = 0;
 	SDL2_Screens[TFB_SCREEN_TRANSITION].updated.w = ScreenWidth;
 	SDL2_Screens[TFB_SCREEN_TRANSITION].updated.h = ScreenHeight;
+	TFB_SDL2_SetUpdatedFull (&SDL2_Screens[TFB_SCREEN_TRANSITION]);
 	SDL2_Screens[TFB_SCREEN_TRANSITION].dirty = TRUE;
 }
 
@@ -336,11 +558,54 @@ TFB_SDL2_UpdateTexture (SDL_Texture *dest, SDL_Surface *src, SDL_Rect *rect)
 	 *
 	 * These bugs may be fixed in the future, but in the meantime we
 	 * rely on this allegedly slower but definitely more reliable
-	 * function. */
+	 * function.
+	 *
+	 * TFB_SDL2_ScaleToTexture() does lock the textures of scaled
+	 * screens, but not with the "direct3d" (Direct3D 9) driver. */
 	SDL_UpdateTexture (dest, rect, srcBytes, src->pitch);
 	SDL_UnlockSurface (src);
 }
 
+// Scales 'update' of a screen straight into the locked texture memory,
+// saving the copy from the 'scaled' surface. Returns FALSE if the texture
+// could not be locked.
+static BOOLEAN
+TFB_SDL2_ScaleToTexture (SCREEN screen, SDL_Rect *update)
+{
+	SDL_Rect limits = {0, 0, 0, 0};
+	SDL_Rect lock = *update;
+	void *pixels;
+	int pitch;
+
+	// The texture is write-only while locked, so the locked part must
+	// be just what the scaler writes
+	limits.w = ScreenWidth;
+	limits.h = ScreenHeight;
+	Scale_ExpandRect (&lock, scaleExpansion, &limits);
+	lock.x *= 2;
+	lock.y *= 2;
+	lock.w *= 2;
+	lock.h *= 2;
+
+	if (SDL_LockTexture (SDL2_Screens[screen].texture, &lock,
+			&pixels, &pitch) != 0)
+		return FALSE;
+
+	// XXX: The surface is made to start where the texture would, so
+	//      that the scaler can address it as usual. It only writes to
+	//      the locked part.
+	directSurface->pixels = (Uint8 *) pixels - lock.y * pitch - lock.x * 4;
+	directSurface->pitch = pitch;
+
+	PROFILE_BEGIN (PROF_SCALE);
+	scaler (SDL_Screens[screen], directSurface, update);
+	PROFILE_END (PROF_SCALE);
+
+	SDL_UnlockTexture (SDL2_Screens[screen].texture);
+	directSurface->pixels = NULL;
+	return TRUE;
+}
+
 static void
 TFB_SDL2_ScanLines (void)
 {
@@ -361,13 +626,16 @@ TFB_SDL2_Preprocess (int force_full_redraw, int transition_amount, int fade_amou
 	(void) transition_amount;
 	(void) fade_amount;
 
-	if (force_full_redraw == TFB_REDRAW_YES)
-	{
+	if (force_full_redraw == TFB_REDRAW_YES || scaleGovernor.redraw)
+	{	// After a scaler change, what was scaled with the old one is
+		// redone with the new one
 		SDL2_Screens[TFB_SCREEN_MAIN].updated.x = 0;
 		SDL2_Screens[TFB_SCREEN_MAIN].updated.y = 0;
 		SDL2_Screens[TFB_SCREEN_MAIN].updated.w = ScreenWidth;
 		SDL2_Screens[TFB_SCREEN_MAIN].updated.h = ScreenHeight;
+		TFB_SDL2_SetUpdatedFull (&SDL2_Screens[TFB_SCREEN_MAIN]);
 		SDL2_Screens[TFB_SCREEN_MAIN].dirty = TRUE;
+		scaleGovernor.redraw = FALSE;
 	}
 	else if (TFB_BBox.valid)
 	{
@@ -375,6 +643,7 @@ TFB_SDL2_Preprocess (int force_full_redraw, int transition_amount, int fade_amou
 		SDL2_Screens[TFB_SCREEN_MAIN].updated.y = TFB_BBox.region.corner.y;
 		SDL2_Screens[TFB_SCREEN_MAIN].updated.w = TFB_BBox.region.extent.width;
 		SDL2_Screens[TFB_SCREEN_MAIN].updated.h = TFB_BBox.region.extent.height;
+		TFB_SDL2_SetUpdatedTiles (&SDL2_Screens[TFB_SCREEN_MAIN]);
 		SDL2_Screens[TFB_SCREEN_MAIN].dirty = TRUE;
 	}
 
@@ -389,7 +658,15 @@ TFB_SDL2_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 	SDL_Texture *texture = SDL2_Screens[screen].texture;
 	if (SDL2_Screens[screen].dirty)
 	{
-		TFB_SDL2_UpdateTexture (texture, SDL_Screens[screen], &SDL2_Screens[screen].updated);
+		int i;
+		for (i = 0; i < SDL2_Screens[screen].num_updated; ++i)
+		{
+			TFB_SDL2_UpdateTexture (texture, SDL_Screens[screen],
+					&SDL2_Screens[screen].updated_rects[i]);
+		}
+		// The texture is up to date until something is drawn again;
+		// fades and the system box only compose it anew
+		SDL2_Screens[screen].dirty = FALSE;
 	}
 	if (a == 255)
 	{
@@ -411,13 +688,46 @@ TFB_SDL2_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 	if (SDL2_Screens[screen].dirty)
 	{
 		SDL_Surface *src = SDL2_Screens[screen].scaled;
-		SDL_Rect scaled_update = SDL2_Screens[screen].updated;
-		scaler (SDL_Screens[screen], src, &SDL2_Screens[screen].updated);
-		scaled_update.x *= 2;
-		scaled_update.y *= 2;
-		scaled_update.w *= 2;
-		scaled_update.h *= 2;
-		TFB_SDL2_UpdateTexture (texture, src, &scaled_update);
+		DWORD startUs = 0;
+		int i;
+
+		if (scaleGovernor.enabled)
+			startUs = GetTimeMicroseconds ();
+
+		for (i = 0; i < SDL2_Screens[screen].num_updated; ++i)
+		{
+			SDL_Rect update = SDL2_Screens[screen].updated_rects[i];
+			SDL_Rect scaled_update = update;
+
+			if (scaleGovernor.enabled)
+				scaleGovernor.sumPixels += update.w * update.h;
+
+			if (directSurface)
+			{
+				if (TFB_SDL2_ScaleToTexture (screen, &update))
+					continue;
+				log_add (log_Warning, "Couldn't lock a screen texture "
+						"(%s); scaling through a surface instead.",
+						SDL_GetError ());
+				TFB_SDL2_UninitDirectScale ();
+			}
+
+			// The scaler may expand the rect it is given
+			PROFILE_BEGIN (PROF_SCALE);
+			scaler (SDL_Screens[screen], src, &update);
+			PROFILE_END (PROF_SCALE);
+			scaled_update.x *= 2;
+			scaled_update.y *= 2;
+			scaled_update.w *= 2;
+			scaled_update.h *= 2;
+			TFB_SDL2_UpdateTexture (texture, src, &scaled_update);
+		}
+
+		// The texture upload is counted too, as it grows with the
+		// scaled area alike
+		if (scaleGovernor.enabled)
+			scaleGovernor.sumUs += GetTimeMicroseconds () - startUs;
+		SDL2_Screens[screen].dirty = FALSE;
 	}
 	if (a == 255)
 	{
@@ -460,6 +770,9 @@ TFB_SDL2_Postprocess (void)
 		TFB_SDL2_ScanLines ();
 
 	SDL_RenderPresent (renderer);
+
+	if (scaleGovernor.enabled)
+		TFB_SDL2_RunScaleGovernor ();
 }
 
 #endif
@@ -19,6 +19,7 @@
 #include "sdl_common.h"
 #include "opengl.h"
 #include "pure.h"
+#include "scalemt.h"
 #include "primitives.h"
 #include "options.h"
 #include "uqmversion.h"
@@ -28,9 +29,13 @@
 #include "libs/input/sdl/input.h"
 		// for ProcessInputEvent()
 #include "libs/graphics/bbox.h"
+#include "libs/graphics/rotcache.h"
+#include "libs/graphics/drawable.h"
+#include "libs/time/profile.h"
 #include "port.h"
 #include "libs/uio.h"
 #include "libs/log.h"
+#include "libs/threadlib.h"
 #include "libs/memlib.h"
 #include "libs/vidlib.h"
 
@@ -55,6 +60,14 @@ TFB_GRAPHICS_BACKEND *graphics_backend = NULL;
 volatile int QuitPosted = 0;
 volatile int GameActive = 1; // Track the SDL_ACTIVEEVENT state SDL_APPACTIVE
 
+#if SDL_MAJOR_VERSION > 1 && !defined(RUST_OWNS_MAIN)
+#	define EVENT_WAIT
+static Uint32 wakeEventType = (Uint32) -1;
+		// Registered in TFB_InitGraphics()
+static AtomicU32 wakePending;
+		// A wake event is in the queue and not processed yet
+#endif
+
 #ifdef USE_RUST_GFX
 /* Rust graphics backend vtable wrapper functions */
 static void Rust_Preprocess (int force_redraw, int transition_amount, int fade_amount)
@@ -170,7 +183,12 @@ TFB_InitGraphics (int driver, int flags, const char *renderer, int width, int he
 	if (flags & TFB_GFXFLAGS_FULLSCREEN)
 		SDL_ShowCursor (SDL_DISABLE);
 
+#ifdef EVENT_WAIT
+	wakeEventType = SDL_RegisterEvents (1);
+#endif
+
 	Init_DrawCommandQueue ();
+	TFB_InitRotationCache ();
 
 	TFB_DrawCanvas_Initialize ();
 
@@ -183,6 +201,9 @@ TFB_UninitGraphics (void)
 	int i;
 
 	Uninit_DrawCommandQueue ();
+	TFB_UninitRotationCache ();
+	UninitCelDecoders ();
+	TFB_SetScaleDiskCache (FALSE);
 
 #ifdef USE_RUST_GFX
 	rust_gfx_uninit ();
@@ -195,6 +216,7 @@ TFB_UninitGraphics (void)
 	for (i = 0; i < TFB_GFX_NUMSCREENS; i++)
 		UnInit_Screen (&SDL_Screens[i]);
 
+	Scale_MT_Uninit ();
 	TFB_Pure_UninitGraphics ();
 #ifdef HAVE_OPENGL
 	TFB_GL_UninitGraphics ();
@@ -204,6 +226,16 @@ TFB_UninitGraphics (void)
 #endif
 }
 
+int
+TFB_GetCPUCount (void)
+{
+#if SDL_MAJOR_VERSION > 1
+	return SDL_GetCPUCount ();
+#else
+	return 2;
+#endif
+}
+
 void
 TFB_ProcessEvents ()
 {
@@ -211,6 +243,13 @@ TFB_ProcessEvents ()
 
 	while (SDL_PollEvent (&Event) > 0)
 	{
+#ifdef EVENT_WAIT
+		if (Event.type == wakeEventType)
+		{
+			AtomicStore (&wakePending, 0);
+			continue;
+		}
+#endif
 		/* Run through the InputEvent filter. */
 		ProcessInputEvent (&Event);
 		/* Handle graphics and exposure events. */
@@ -252,13 +291,87 @@ TFB_ProcessEvents ()
 	}
 }
 
+// Sleeps until there is an event to process, TFB_WakeEventWait() is
+// called, or 'timeout' milliseconds pass, whichever is first.
+// Only call from the main thread.
+void
+TFB_WaitForEvents (DWORD timeout)
+{
+#ifdef EVENT_WAIT
+	if (wakeEventType != (Uint32) -1)
+	{
+		SDL_WaitEventTimeout (NULL, (int) timeout);
+		return;
+	}
+#endif
+	// Nothing could end the wait early, so do not wait long
+	(void) timeout;
+	TaskSwitch ();
+}
+
+// Ends a TFB_WaitForEvents() now or, when the main thread is not waiting,
+// makes its next one return at once. May be called from any thread.
+void
+TFB_WakeEventWait (void)
+{
+#ifdef EVENT_WAIT
+	SDL_Event event;
+
+	if (wakeEventType == (Uint32) -1)
+		return;
+	// One wake event in the queue is enough
+	if (!AtomicCompareExchange (&wakePending, 0, 1))
+		return;
+
+	SDL_zero (event);
+	event.type = wakeEventType;
+	if (SDL_PushEvent (&event) != 1)
+		AtomicStore (&wakePending, 0);
+#endif
+}
+
+static TFB_FrameCaptureFunc frameCaptureFunc;
+static void *frameCaptureArg;
+
+void
+TFB_SetFrameCapture (TFB_FrameCaptureFunc func, void *arg)
+{
+	frameCaptureFunc = func;
+	frameCaptureArg = arg;
+}
+
+static void
+captureFrame (int fade_amount, int transition_amount)
+{
+	static DWORD frame;
+	SDL_Surface *screen = SDL_Screens[TFB_SCREEN_MAIN];
+	TFB_CapturedFrame cf;
+
+	cf.pixels = screen->pixels;
+	cf.pitch = screen->pitch;
+	cf.bytesPerPixel = screen->format->BytesPerPixel;
+	cf.rmask = screen->format->Rmask;
+	cf.gmask = screen->format->Gmask;
+	cf.bmask = screen->format->Bmask;
+	cf.fadeAmount = fade_amount;
+	cf.transitionAmount = transition_amount;
+	cf.transitionPixels = SDL_Screens[TFB_SCREEN_TRANSITION]->pixels;
+	cf.transitionRect = TransitionClipRect;
+	cf.frame = frame++;
+
+	frameCaptureFunc (&cf, frameCaptureArg);
+}
+
 static BOOLEAN system_box_active = 0;
+static BOOLEAN system_box_changed = 0;
+		// Since the last frame was presented
 static SDL_Rect system_box;
 
 void
 SetSystemRect (const RECT *r)
 {
 	system_box_active = TRUE;
+	system_box_changed = TRUE;
 	system_box.x = r->corner.x;
 	system_box.y = r->corner.y;
 	system_box.w = r->extent.width;
@@ -269,7 +382,84 @@ void
 ClearSystemRect (void)
 {
 	system_box_active = FALSE;
+	system_box_changed = TRUE;
+}
+
+#if SDL_MAJOR_VERSION > 1
+#define PROFILE_GRAPH_US_PER_PIXEL 1000
+#define PROFILE_GRAPH_BUDGET (1000000 / 24)
+		// A battle frame
+#define PROFILE_GRAPH_HEIGHT (2 * PROFILE_GRAPH_BUDGET \
+		/ PROFILE_GRAPH_US_PER_PIXEL)
+
+// Draws the frame times as stacked bars, one per frame with the newest
+// on the right, in the bottom left corner of the screen.
+// With SDL1, the software backend composes onto the main screen itself,
+// where the graph would then stay, so it is only drawn with SDL2.
+static void
+DrawProfileGraph (void)
+{
+	static const SDL_Color sectionColors[PROF_NUM_SECTIONS] =
+	{
+		{ 0xff, 0x40, 0x40, 0xff },  // input
+		{ 0xff, 0xc0, 0x40, 0xff },  // preprocess
+		{ 0xff, 0xff, 0x40, 0xff },  // postprocess
+		{ 0xc0, 0x40, 0xff, 0xff },  // comm
+		{ 0x40, 0xc0, 0xff, 0xff },  // flush
+		{ 0x40, 0x40, 0xff, 0xff },  // swap
+		{ 0x40, 0xff, 0xff, 0xff },  // scale
+		{ 0x40, 0xff, 0x40, 0xff },  // audio
+	};
+	const int graphTop = ScreenHeight - PROFILE_GRAPH_HEIGHT;
+	COUNT numFrames = Profile_numFrames ();
+	COUNT framesAgo;
+	SDL_Rect r;
+	int i;
+
+	r.x = 0;
+	r.y = graphTop;
+	r.w = PROFILE_HISTORY;
+	r.h = PROFILE_GRAPH_HEIGHT;
+	graphics_backend->color (0, 0, 0, 0xa0, &r);
+
+	r.w = 1;
+	for (framesAgo = 0; framesAgo < numFrames; ++framesAgo)
+	{
+		int top = ScreenHeight;
+		int height;
+
+		r.x = PROFILE_HISTORY - 1 - framesAgo;
+		for (i = 0; i < PROF_NUM_SECTIONS && top > graphTop; ++i)
+		{
+			height = Profile_sectionTime (framesAgo, i)
+					/ PROFILE_GRAPH_US_PER_PIXEL;
+			if (height == 0)
+				continue;
+			if (height > top - graphTop)
+				height = top - graphTop;
+			top -= height;
+			r.y = top;
+			r.h = height;
+			graphics_backend->color (sectionColors[i].r,
+					sectionColors[i].g, sectionColors[i].b, 0xc0, &r);
+		}
+
+		// A dot for what the frame took in all, including waiting
+		height = Profile_frameTime (framesAgo) / PROFILE_GRAPH_US_PER_PIXEL;
+		if (height >= PROFILE_GRAPH_HEIGHT)
+			height = PROFILE_GRAPH_HEIGHT - 1;
+		r.y = ScreenHeight - 1 - height;
+		r.h = 1;
+		graphics_backend->color (0xff, 0xff, 0xff, 0xc0, &r);
+	}
+
+	r.x = 0;
+	r.y = ScreenHeight - PROFILE_GRAPH_BUDGET / PROFILE_GRAPH_US_PER_PIXEL;
+	r.w = PROFILE_HISTORY;
+	r.h = 1;
+	graphics_backend->color (0x80, 0x80, 0x80, 0xc0, &r);
 }
+#endif
 
 void
 TFB_SwapBuffers (int force_full_redraw)
@@ -291,9 +481,14 @@ TFB_SwapBuffers (int force_full_redraw)
 	fade_amount = GetFadeAmount ();
 	transition_amount = TransitionAmount;
 
+	// Nothing drawn to the main screen, and the fade and transition
+	// are where they were: what would be presented is already shown,
+	// so the screens are neither scaled nor uploaded. This also holds
+	// during a fade that has stopped part way, like a screen kept black.
 	if (force_full_redraw == TFB_REDRAW_NO && !TFB_BBox.valid &&
-			fade_amount == 255 && transition_amount == 255 &&
-			last_fade_amount == 255 && last_transition_amount == 255)
+			!system_box_changed &&
+			fade_amount == last_fade_amount &&
+			transition_amount == last_transition_amount)
 		return;
 
 	if (force_full_redraw == TFB_REDRAW_NO &&
@@ -303,7 +498,9 @@ TFB_SwapBuffers (int force_full_redraw)
 
 	last_fade_amount = fade_amount;
 	last_transition_amount = transition_amount;
+	system_box_changed = FALSE;
 
+	PROFILE_BEGIN (PROF_SWAP);
 	graphics_backend->preprocess (force_full_redraw, transition_amount,
 			fade_amount);
 	graphics_backend->screen (TFB_SCREEN_MAIN, 255, NULL);
@@ -337,7 +534,16 @@ TFB_SwapBuffers (int force_full_redraw)
 		graphics_backend->screen (TFB_SCREEN_MAIN, 255, &system_box);
 	}
 
+#if SDL_MAJOR_VERSION > 1
+	if (Profile_enabled && Profile_showGraph)
+		DrawProfileGraph ();
+#endif
+
 	graphics_backend->postprocess ();
+	PROFILE_END (PROF_SWAP);
+
+	if (frameCaptureFunc)
+		captureFrame (fade_amount, transition_amount);
 }
 
 /* Probably ought to clean this away at some point. */
@@ -32,6 +32,7 @@
 // The name expands to either
 //		Scale_TriScanFilter (for plain C) or
 //		Scale_MMX_TriScanFilter (for MMX)
+//		Scale_SSE2_TriScanFilter (for SSE2, likewise AVX2 and NEON)
 //		[others when platforms are added]
 void
 SCALE_(TriScanFilter) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
@@ -95,15 +96,28 @@ SCALE_(TriScanFilter) (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
 		else
 			nextline = 0;
 	
+		x = region->x;
+#ifdef SCALE_TRISCAN_ROW
+		if (x > 0)
+		{	// vector versions handle the inner pixels of the row;
+			// the edge columns need the clamping below
+			int done = SCALE_TRISCAN_ROW (src_p, prevline, nextline,
+					dst_p, dlen, (xend < w ? xend : w - 1) - x);
+			x += done;
+			src_p += done;
+			dst_p += done * 2;
+		}
+#endif
+
 		// prime the (tiny) sliding-window pixel arrays
 		PIX( 1,  0) = src_p[0];
 
-		if (region->x > 0)
+		if (x > 0)
 			PIX( 0,  0) = src_p[-1];
 		else
 			PIX( 0,  0) = PIX( 1,  0);
 
-		for (x = region->x; x < xend; ++x, ++src_p, dst_p += 2)
+		for (; x < xend; ++x, ++src_p, dst_p += 2)
 		{
 			// slide the window
 			PIX(-1,  0) = PIX( 0,  0);
@@ -17,6 +17,8 @@
 #include "gfx_common.h"
 #include "tfb_draw.h"
 #include "drawcmd.h"
+#include "rotcache.h"
+#include "scaledisk.h"
 #include "libs/gfxlib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
@@ -24,6 +26,8 @@
 
 static const HOT_SPOT NullHs = {0, 0};
 
+static void flushScaleCache (TFB_Image *image);
+
 void
 TFB_DrawScreen_Line (int x1, int y1, int x2, int y2, Color color,
 		DrawMode mode, SCREEN dest)
@@ -120,6 +124,23 @@ TFB_DrawScreen_FontChar (TFB_Char *fontChar, TFB_Image *backing,
 	TFB_EnqueueDrawCommand (&DC);
 }
 
+void
+TFB_DrawScreen_TextRun (TFB_TextGlyph *glyphs, COUNT count,
+		const RECT *bounds, TFB_Image *backing, DrawMode mode, SCREEN dest)
+{
+	TFB_DrawCommand DC;
+
+	DC.Type = TFB_DRAWCOMMANDTYPE_TEXTRUN;
+	DC.data.textrun.glyphs = glyphs;
+	DC.data.textrun.count = count;
+	DC.data.textrun.bounds = *bounds;
+	DC.data.textrun.backing = backing;
+	DC.data.textrun.drawMode = mode;
+	DC.data.textrun.destBuffer = dest;
+
+	TFB_EnqueueDrawCommand (&DC);
+}
+
 void
 TFB_DrawScreen_CopyToImage (TFB_Image *img, const RECT *r, SCREEN src)
 {
@@ -266,6 +287,19 @@ TFB_DrawImage_Line (int x1, int y1, int x2, int y2, Color color,
 	LockMutex (target->mutex);
 	TFB_DrawCanvas_Line (x1, y1, x2, y2, color, mode, target->NormalImg);
 	target->dirty = TRUE;
+	++target->version;
+	UnlockMutex (target->mutex);
+}
+
+void
+TFB_DrawImage_Polyline (const POINT *points, COUNT count, POINT offset,
+		Color color, DrawMode mode, TFB_Image *target)
+{
+	LockMutex (target->mutex);
+	TFB_DrawCanvas_Polyline (points, count, offset, color, mode,
+			target->NormalImg);
+	target->dirty = TRUE;
+	++target->version;
 	UnlockMutex (target->mutex);
 }
 
@@ -275,6 +309,7 @@ TFB_DrawImage_Rect (RECT *rect, Color color, DrawMode mode, TFB_Image *target)
 	LockMutex (target->mutex);
 	TFB_DrawCanvas_Rect (rect, color, mode, target->NormalImg);
 	target->dirty = TRUE;
+	++target->version;
 	UnlockMutex (target->mutex);
 }
 
@@ -286,6 +321,7 @@ TFB_DrawImage_Image (TFB_Image *img, int x, int y, int scale,
 	TFB_DrawCanvas_Image (img, x, y, scale, scaleMode, cmap,
 			mode, target->NormalImg);
 	target->dirty = TRUE;
+	++target->version;
 	UnlockMutex (target->mutex);
 }
 
@@ -297,6 +333,7 @@ TFB_DrawImage_FilledImage (TFB_Image *img, int x, int y, int scale,
 	TFB_DrawCanvas_FilledImage (img, x, y, scale, scaleMode, color,
 			mode, target->NormalImg);
 	target->dirty = TRUE;
+	++target->version;
 	UnlockMutex (target->mutex);
 }
 
@@ -307,6 +344,18 @@ TFB_DrawImage_FontChar (TFB_Char *fontChar, TFB_Image *backing,
 	LockMutex (target->mutex);
 	TFB_DrawCanvas_FontChar (fontChar, backing, x, y, mode, target->NormalImg);
 	target->dirty = TRUE;
+	++target->version;
+	UnlockMutex (target->mutex);
+}
+
+void
+TFB_DrawImage_TextRun (const TFB_TextGlyph *glyphs, COUNT count,
+		TFB_Image *backing, DrawMode mode, TFB_Image *target)
+{
+	LockMutex (target->mutex);
+	TFB_DrawCanvas_TextRun (glyphs, count, backing, mode, target->NormalImg);
+	target->dirty = TRUE;
+	++target->version;
 	UnlockMutex (target->mutex);
 }
 
@@ -321,12 +370,20 @@ TFB_DrawImage_New (TFB_Canvas canvas)
 	img->FilledImg = NULL;
 	img->colormap_index = -1;
 	img->colormap_version = 0;
+	img->ConvertedImg = NULL;
+	img->converted_cmap_index = -1;
+	img->converted_cmap_version = 0;
+	img->converted_version = 0;
 	img->NormalHs = NullHs;
 	img->MipmapHs = NullHs;
 	img->last_scale_hs = NullHs;
 	img->last_scale_type = -1;
+	img->scaleCache = NULL;
 	img->last_scale = 0;
 	img->dirty = FALSE;
+	img->version = 0;
+	img->CollisionMask = NULL;
+	img->maskVersion = 0;
 	TFB_DrawCanvas_GetExtent (canvas, &img->extent);
 
 	if (TFB_DrawCanvas_IsPaletted (canvas))
@@ -351,11 +408,20 @@ TFB_DrawImage_CreateForScreen (int w, int h, BOOLEAN withalpha)
 	img->FilledImg = NULL;
 	img->colormap_index = -1;
 	img->colormap_version = 0;
+	img->ConvertedImg = NULL;
+	img->converted_cmap_index = -1;
+	img->converted_cmap_version = 0;
+	img->converted_version = 0;
 	img->NormalHs = NullHs;
 	img->MipmapHs = NullHs;
 	img->last_scale_hs = NullHs;
 	img->last_scale_type = -1;
+	img->scaleCache = NULL;
 	img->last_scale = 0;
+	img->dirty = FALSE;
+	img->version = 0;
+	img->CollisionMask = NULL;
+	img->maskVersion = 0;
 	img->extent.width = w;
 	img->extent.height = h;
 
@@ -379,6 +445,10 @@ TFB_DrawImage_New_Rotated (TFB_Image *img, int angle)
 		return NULL;
 	}
 
+	dst = TFB_RotationCache_Get (img, angle);
+	if (dst)
+		return TFB_DrawImage_New (dst);
+
 	TFB_DrawCanvas_GetRotatedExtent (img->NormalImg, angle, &size);
 	dst = TFB_DrawCanvas_New_RotationTarget (img->NormalImg, angle);
 	if (!dst)
@@ -390,6 +460,8 @@ TFB_DrawImage_New_Rotated (TFB_Image *img, int angle)
 	TFB_DrawCanvas_Rotate (img->NormalImg, dst, angle, size);
 	
 	newimg = TFB_DrawImage_New (dst);
+	// Cache the final canvas, after any conversion to screen format
+	TFB_RotationCache_Put (img, angle, newimg->NormalImg);
 	return newimg;
 }
 
@@ -414,6 +486,9 @@ TFB_DrawImage_SetMipmap (TFB_Image *img, TFB_Image *mmimg, int hotx, int hoty)
 	if (!mmpal || (mmpal && imgpal &&
 			img->colormap_index == mmimg->colormap_index))
 	{
+		if (img->MipmapImg != mmimg->NormalImg)
+			flushScaleCache (img);
+				// trilinear variants are made from the mipmap
 		img->MipmapImg = mmimg->NormalImg;
 		img->MipmapHs.x = hotx;
 		img->MipmapHs.y = hoty;
@@ -436,6 +511,9 @@ TFB_DrawImage_Delete (TFB_Image *image)
 		/* Should we die here? */
 		return;
 	}
+	// A new image could get the same address
+	TFB_RotationCache_Invalidate (image);
+
 	LockMutex (image->mutex);
 
 	TFB_DrawCanvas_Delete (image->NormalImg);
@@ -452,28 +530,195 @@ TFB_DrawImage_Delete (TFB_Image *image)
 		image->FilledImg = 0;
 	}
 
+	if (image->ConvertedImg)
+	{
+		TFB_DrawCanvas_Delete (image->ConvertedImg);
+		image->ConvertedImg = 0;
+	}
+
+	if (image->scaleCache)
+	{
+		flushScaleCache (image);
+		HFree (image->scaleCache);
+		image->scaleCache = NULL;
+	}
+
+	if (image->CollisionMask)
+	{
+		HFree (image->CollisionMask);
+		image->CollisionMask = NULL;
+	}
+
 	UnlockMutex (image->mutex);
 	DestroyMutex (image->mutex);
 			
 	HFree (image);
 }
 
+static size_t scaleCacheLimit = TFB_SCALECACHE_DEFAULT_LIMIT;
+static AtomicU32 scaleCacheBytes;
+		// Memory held by the scaled variants of all images
+static AtomicU32 scaleCacheTick;
+
+void
+TFB_SetScaleCacheLimit (size_t bytes)
+{
+	// Already cached variants are dropped as they get replaced
+	scaleCacheLimit = bytes;
+}
+
+static size_t
+canvasBytes (TFB_Canvas canvas)
+{
+	EXTENT size;
+	TFB_DrawCanvas_GetExtent (canvas, &size);
+	return (size_t) TFB_DrawCanvas_GetStride (canvas) * size.height;
+}
+
+static void
+dropScaledVariant (TFB_ScaledVariant *v)
+{
+	AtomicAdd (&scaleCacheBytes, (uint32) -(sint32) canvasBytes (v->canvas));
+	TFB_DrawCanvas_Delete (v->canvas);
+	v->canvas = NULL;
+}
+
+// The image mutex must be held for all of the below
+static void
+flushScaleCache (TFB_Image *image)
+{
+	int i;
+
+	if (!image->scaleCache)
+		return;
+
+	for (i = 0; i < TFB_SCALECACHE_ENTRIES; ++i)
+	{
+		if (image->scaleCache[i].canvas)
+			dropScaledVariant (&image->scaleCache[i]);
+	}
+}
+
+// Move ScaledImg into the variant cache, in place of the least recently
+// used variant.  Returns FALSE if the memory limit does not allow it.
+static BOOLEAN
+stashScaledImg (TFB_Image *image)
+{
+	TFB_ScaledVariant *slot;
+	size_t size;
+	int i;
+
+	if (!image->ScaledImg || scaleCacheLimit == 0)
+		return FALSE;
+
+	if (!image->scaleCache)
+		image->scaleCache = HCalloc (sizeof (TFB_ScaledVariant)
+				* TFB_SCALECACHE_ENTRIES);
+
+	slot = &image->scaleCache[0];
+	for (i = 0; i < TFB_SCALECACHE_ENTRIES && slot->canvas; ++i)
+	{
+		TFB_ScaledVariant *v = &image->scaleCache[i];
+		if (!v->canvas || v->lastUse < slot->lastUse)
+			slot = v;
+	}
+	if (slot->canvas)
+		dropScaledVariant (slot);
+
+	size = canvasBytes (image->ScaledImg);
+	if (AtomicLoad (&scaleCacheBytes) + size > scaleCacheLimit)
+		return FALSE;
+	AtomicAdd (&scaleCacheBytes, (uint32) size);
+
+	slot->canvas = image->ScaledImg;
+	slot->scale = image->last_scale;
+	slot->type = image->last_scale_type;
+	slot->hs = image->last_scale_hs;
+	slot->lastUse = AtomicAdd (&scaleCacheTick, 1);
+	image->ScaledImg = NULL;
+	return TRUE;
+}
+
+// Make a cached variant the current ScaledImg, and put the current
+// one in its slot
+static BOOLEAN
+fetchScaledVariant (TFB_Image *image, int target, int type)
+{
+	TFB_ScaledVariant found;
+	TFB_ScaledVariant *slot = NULL;
+	int i;
+
+	if (!image->scaleCache)
+		return FALSE;
+
+	for (i = 0; i < TFB_SCALECACHE_ENTRIES; ++i)
+	{
+		TFB_ScaledVariant *v = &image->scaleCache[i];
+		if (v->canvas && v->scale == target && v->type == type)
+		{
+			slot = v;
+			break;
+		}
+	}
+	if (!slot)
+		return FALSE;
+
+	found = *slot;
+	AtomicAdd (&scaleCacheBytes, (uint32) -(sint32) canvasBytes (found.canvas));
+	slot->canvas = NULL;
+	if (image->ScaledImg)
+	{
+		size_t size = canvasBytes (image->ScaledImg);
+		AtomicAdd (&scaleCacheBytes, (uint32) size);
+		slot->canvas = image->ScaledImg;
+		slot->scale = image->last_scale;
+		slot->type = image->last_scale_type;
+		slot->hs = image->last_scale_hs;
+		slot->lastUse = AtomicAdd (&scaleCacheTick, 1);
+	}
+
+	image->ScaledImg = found.canvas;
+	image->last_scale = found.scale;
+	image->last_scale_type = found.type;
+	image->last_scale_hs = found.hs;
+	return TRUE;
+}
+
 void
 TFB_DrawImage_FixScaling (TFB_Image *image, int target, int type)
 {
-	if (image->dirty || !image->ScaledImg ||
-			target != image->last_scale ||
-			type != image->last_scale_type)
+	uint64 key;
+
+	if (image->dirty)
+	{	// None of the scaled versions are any good now
+		flushScaleCache (image);
+	}
+	else if (image->ScaledImg && target == image->last_scale
+			&& type == image->last_scale_type)
 	{
-		image->dirty = FALSE;
-		image->ScaledImg = TFB_DrawCanvas_New_ScaleTarget (image->NormalImg,
-			image->ScaledImg, type, image->last_scale_type);
-		
-		if (type == TFB_SCALE_NEAREST)
-			TFB_DrawCanvas_Rescale_Nearest (image->NormalImg,
-					image->ScaledImg, target, &image->NormalHs,
-					&image->extent, &image->last_scale_hs);
-		else if (type == TFB_SCALE_BILINEAR)
+		return;
+	}
+	else if (fetchScaledVariant (image, target, type))
+	{
+		return;
+	}
+	else
+	{	// Keep the current scale around; if there is no room, its
+		// canvas gets reused below
+		stashScaledImg (image);
+	}
+
+	image->dirty = FALSE;
+	image->ScaledImg = TFB_DrawCanvas_New_ScaleTarget (image->NormalImg,
+		image->ScaledImg, type, image->last_scale_type);
+	
+	if (type == TFB_SCALE_NEAREST)
+		TFB_DrawCanvas_Rescale_Nearest (image->NormalImg,
+				image->ScaledImg, target, &image->NormalHs,
+				&image->extent, &image->last_scale_hs);
+	else if (!TFB_ScaleDiskCache_Load (image, target, type, &key))
+	{
+		if (type == TFB_SCALE_BILINEAR)
 			TFB_DrawCanvas_Rescale_Bilinear (image->NormalImg,
 					image->ScaledImg, target, &image->NormalHs,
 					&image->extent, &image->last_scale_hs);
@@ -482,10 +727,108 @@ TFB_DrawImage_FixScaling (TFB_Image *image, int target, int type)
 					image->MipmapImg, image->ScaledImg, target,
 					&image->NormalHs, &image->MipmapHs,
 					&image->extent, &image->last_scale_hs);
+		TFB_ScaleDiskCache_Save (image, target, type, key);
+	}
+
+	image->last_scale_type = type;
+	image->last_scale = target;
+}
+
+// Render a scaled version of the image into its variant cache ahead
+// of time.  Returns FALSE once the cache is full.
+BOOLEAN
+TFB_DrawImage_Prescale (TFB_Image *image, int target, int type)
+{
+	BOOLEAN ok;
 
-		image->last_scale_type = type;
-		image->last_scale = target;
+	if (target == 0 || target == GSCALE_IDENTITY)
+		return TRUE;
+
+	LockMutex (image->mutex);
+	if (type == TFB_SCALE_TRILINEAR && !image->MipmapImg)
+		type = TFB_SCALE_BILINEAR;
+			// as TFB_DrawCanvas_Image() would
+	TFB_DrawImage_FixScaling (image, target, type);
+	ok = stashScaledImg (image);
+	UnlockMutex (image->mutex);
+
+	return ok;
+}
+
+// Call with the image mutex held
+static TFB_CollisionMask *
+getCollisionMask (TFB_Image *image)
+{
+	if (image->CollisionMask && image->maskVersion != image->version)
+	{	// drawn to since
+		HFree (image->CollisionMask);
+		image->CollisionMask = NULL;
 	}
+
+	if (!image->CollisionMask)
+	{
+		image->CollisionMask =
+				TFB_DrawCanvas_NewCollisionMask (image->NormalImg);
+		image->maskVersion = image->version;
+	}
+
+	return image->CollisionMask;
+}
+
+// Returns the 64 mask bits starting at pixel x of a row
+static inline uint64
+getMaskBits (const uint64 *row, int x)
+{
+	const uint64 *word = row + (x >> 6);
+	int shift = x & 63;
+
+	if (shift == 0)
+		return word[0];
+	// rows have a spare word at the end, so word[1] is always there
+	return (word[0] << shift) | (word[1] >> (64 - shift));
+}
+
+static BOOLEAN
+masksIntersect (const TFB_CollisionMask *mask1, POINT org1,
+		const TFB_CollisionMask *mask2, POINT org2, const RECT *r)
+{
+	const uint64 *row1;
+	const uint64 *row2;
+	int x, y;
+
+	// convert mask origins to pixel offsets within
+	org1.x = r->corner.x - org1.x;
+	org1.y = r->corner.y - org1.y;
+	org2.x = r->corner.x - org2.x;
+	org2.y = r->corner.y - org2.y;
+
+	if (org1.x < 0 || org1.y < 0 || org2.x < 0 || org2.y < 0
+			|| org1.x + r->extent.width > mask1->width
+			|| org1.y + r->extent.height > mask1->height
+			|| org2.x + r->extent.width > mask2->width
+			|| org2.y + r->extent.height > mask2->height)
+		return FALSE; // rect is not inside both images
+
+	row1 = mask1->bits + org1.y * mask1->pitch;
+	row2 = mask2->bits + org2.y * mask2->pitch;
+	for (y = 0; y < r->extent.height;
+			++y, row1 += mask1->pitch, row2 += mask2->pitch)
+	{
+		for (x = 0; x < r->extent.width; x += 64)
+		{
+			uint64 bits = getMaskBits (row1, org1.x + x)
+					& getMaskBits (row2, org2.x + x);
+
+			if (r->extent.width - x < 64)
+			{	// drop the pixels past the rect
+				bits &= ~(uint64) 0 << (64 - (r->extent.width - x));
+			}
+			if (bits)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
 }
 
 BOOLEAN
@@ -496,8 +839,8 @@ TFB_DrawImage_Intersect (TFB_Image *img1, POINT img1org,
 
 	LockMutex (img1->mutex);
 	LockMutex (img2->mutex);
-	ret = TFB_DrawCanvas_Intersect (img1->NormalImg, img1org,
-			img2->NormalImg, img2org, interRect);
+	ret = masksIntersect (getCollisionMask (img1), img1org,
+			getCollisionMask (img2), img2org, interRect);
 	UnlockMutex (img2->mutex);
 	UnlockMutex (img1->mutex);
 
@@ -513,6 +856,7 @@ TFB_DrawImage_CopyRect (TFB_Image *source, const RECT *srcRect,
 	TFB_DrawCanvas_CopyRect (source->NormalImg, srcRect,
 			target->NormalImg, dstPt);
 	target->dirty = TRUE;
+	++target->version;
 	UnlockMutex (target->mutex);
 	UnlockMutex (source->mutex);
 }
@@ -35,6 +35,36 @@ typedef enum {
 #include "libs/graphics/gfx_common.h"
 #include "libs/graphics/cmap.h"
 
+// A scaled version of an image, other than the current ScaledImg.
+// TFB_DrawImage_FixScaling() keeps a few of these per image, so that
+// going back to a recently used scale is a swap and not a rescale.
+#define TFB_SCALECACHE_ENTRIES 8
+
+typedef struct tfb_scaledvariant
+{
+	TFB_Canvas canvas;
+			// NULL when the slot is free
+	int scale;
+	int type;
+	HOT_SPOT hs;
+	DWORD lastUse;
+} TFB_ScaledVariant;
+
+// Default limit on the memory of all scaled variants together,
+// overridden by config.scalecachesize
+#define TFB_SCALECACHE_DEFAULT_LIMIT (8 * 1024 * 1024)
+
+// Collision mask of an image: 1 bit per pixel, set where the pixel is
+// not transparent.  Each row starts on a 64-bit word and has one spare
+// zero word at its end; the leftmost pixel is the top bit of a word.
+typedef struct tfb_collisionmask
+{
+	int width, height;
+	int pitch;
+			// In words
+	uint64 *bits;
+} TFB_CollisionMask;
+
 typedef struct tfb_image
 {
 	TFB_Canvas NormalImg;
@@ -43,15 +73,29 @@ typedef struct tfb_image
 	TFB_Canvas FilledImg;
 	int colormap_index;
 	int colormap_version;
+	TFB_Canvas ConvertedImg;
+			// A paletted NormalImg converted to screen format with the
+			// colormap it was last drawn with unscaled; NULL until then
+	int converted_cmap_index;
+	int converted_cmap_version;
+	DWORD converted_version;
+			// The NormalImg version ConvertedImg was made from
 	HOT_SPOT NormalHs;
 	HOT_SPOT MipmapHs;
 	HOT_SPOT last_scale_hs;
+	TFB_ScaledVariant *scaleCache;
+			// TFB_SCALECACHE_ENTRIES slots, allocated on first use
 	int last_scale;
 	int last_scale_type;
 	Color last_fill;
 	EXTENT extent;
 	Mutex mutex;
 	BOOLEAN dirty;
+	DWORD version;
+		// Bumped whenever NormalImg changes; keys the rotation cache
+	TFB_CollisionMask *CollisionMask;
+			// Built from NormalImg on first intersect test
+	DWORD maskVersion;
 } TFB_Image;
 
 typedef struct tfb_char
@@ -66,6 +110,14 @@ typedef struct tfb_char
 		// in one rectangular pixel matrix
 } TFB_Char;
 
+// One char of a text run.  x, y is the char origin, as passed to
+// TFB_DrawScreen_FontChar()
+typedef struct tfb_textglyph
+{
+	TFB_Char *fontChar;
+	int x, y;
+} TFB_TextGlyph;
+
 // we do not support paletted format for now
 typedef struct tfb_pixelformat
 {
@@ -88,6 +140,9 @@ void TFB_DrawScreen_FilledImage (TFB_Image *img, int x, int y, int scale,
 		int scaleMode, Color, DrawMode, SCREEN dest);
 void TFB_DrawScreen_FontChar (TFB_Char *, TFB_Image *backing, int x, int y,
 		DrawMode, SCREEN dest);
+void TFB_DrawScreen_TextRun (TFB_TextGlyph *glyphs, COUNT count,
+		const RECT *bounds, TFB_Image *backing, DrawMode, SCREEN dest);
+		// 'glyphs' must be a result of HXalloc() call; the DCQ frees it
 
 void TFB_DrawScreen_CopyToImage (TFB_Image *img, const RECT *r, SCREEN src);
 void TFB_DrawScreen_SetMipmap (TFB_Image *img, TFB_Image *mmimg, int hotx,
@@ -105,6 +160,10 @@ void TFB_DrawImage_SetMipmap (TFB_Image *img, TFB_Image *mmimg, int hotx,
 		int hoty);
 void TFB_DrawImage_Delete (TFB_Image *image);
 void TFB_DrawImage_FixScaling (TFB_Image *image, int target, int type);
+BOOLEAN TFB_DrawImage_Prescale (TFB_Image *image, int target, int type);
+void TFB_SetScaleCacheLimit (size_t bytes);
+void TFB_SetDrawableAtlas (BOOLEAN enable);
+void TFB_SetScaleDiskCache (BOOLEAN enable);
 BOOLEAN TFB_DrawImage_Intersect (TFB_Image *img1, POINT img1org,
 		TFB_Image *img2, POINT img2org, const RECT *interRect);
 void TFB_DrawImage_CopyRect (TFB_Image *source, const RECT *srcRect,
@@ -112,6 +171,8 @@ void TFB_DrawImage_CopyRect (TFB_Image *source, const RECT *srcRect,
 
 void TFB_DrawImage_Line (int x1, int y1, int x2, int y2, Color color,
 		DrawMode, TFB_Image *target);
+void TFB_DrawImage_Polyline (const POINT *points, COUNT count, POINT offset,
+		Color color, DrawMode, TFB_Image *target);
 void TFB_DrawImage_Rect (RECT *rect, Color, DrawMode, TFB_Image *target);
 void TFB_DrawImage_Image (TFB_Image *img, int x, int y, int scale,
 		int scaleMode, TFB_ColorMap *, DrawMode, TFB_Image *target);
@@ -119,8 +180,17 @@ void TFB_DrawImage_FilledImage (TFB_Image *img, int x, int y, int scale,
 		int scaleMode, Color, DrawMode, TFB_Image *target);
 void TFB_DrawImage_FontChar (TFB_Char *, TFB_Image *backing, int x, int y,
 		DrawMode, TFB_Image *target);
+void TFB_DrawImage_TextRun (const TFB_TextGlyph *glyphs, COUNT count,
+		TFB_Image *backing, DrawMode, TFB_Image *target);
 
 TFB_Canvas TFB_DrawCanvas_LoadFromFile (void *dir, const char *fileName);
+TFB_Canvas TFB_DrawCanvas_PackAtlas (TFB_Canvas canvases[], int count);
+uint64 TFB_DrawCanvas_Hash (TFB_Canvas canvas, uint64 hash);
+int TFB_DrawCanvas_GetPixelSize (TFB_Canvas canvas);
+BOOLEAN TFB_DrawCanvas_GetPixels (TFB_Canvas canvas, int w, int h,
+		BYTE *data);
+BOOLEAN TFB_DrawCanvas_SetPixels (TFB_Canvas canvas, int w, int h,
+		const BYTE *data);
 TFB_Canvas TFB_DrawCanvas_New_TrueColor (int w, int h, BOOLEAN hasalpha);
 TFB_Canvas TFB_DrawCanvas_New_ForScreen (int w, int h, BOOLEAN withalpha);
 TFB_Canvas TFB_DrawCanvas_New_Paletted (int w, int h, Color palette[256],
@@ -128,6 +198,7 @@ TFB_Canvas TFB_DrawCanvas_New_Paletted (int w, int h, Color palette[256],
 TFB_Canvas TFB_DrawCanvas_New_ScaleTarget (TFB_Canvas canvas,
 		TFB_Canvas oldcanvas, int type, int last_type);
 TFB_Canvas TFB_DrawCanvas_New_RotationTarget (TFB_Canvas src, int angle);
+TFB_Canvas TFB_DrawCanvas_New_Copy (TFB_Canvas src);
 TFB_Canvas TFB_DrawCanvas_ToScreenFormat (TFB_Canvas canvas);
 BOOLEAN TFB_DrawCanvas_IsPaletted (TFB_Canvas canvas);
 void TFB_DrawCanvas_Rescale_Nearest (TFB_Canvas src, TFB_Canvas dst,
@@ -150,6 +221,9 @@ void TFB_DrawCanvas_Delete (TFB_Canvas canvas);
 
 void TFB_DrawCanvas_Line (int x1, int y1, int x2, int y2, Color color,
 		DrawMode, TFB_Canvas target);
+// Lines between consecutive points, each moved by 'offset'
+void TFB_DrawCanvas_Polyline (const POINT *points, COUNT count,
+		POINT offset, Color color, DrawMode, TFB_Canvas target);
 void TFB_DrawCanvas_Rect (RECT *rect, Color, DrawMode, TFB_Canvas target);
 void TFB_DrawCanvas_Image (TFB_Image *img, int x, int y, int scale,
 		int scaleMode, TFB_ColorMap *, DrawMode, TFB_Canvas target);
@@ -157,6 +231,8 @@ void TFB_DrawCanvas_FilledImage (TFB_Image *img, int x, int y, int scale,
 		int scaleMode, Color, DrawMode, TFB_Canvas target);
 void TFB_DrawCanvas_FontChar (TFB_Char *, TFB_Image *backing, int x, int y,
 		DrawMode, TFB_Canvas target);
+void TFB_DrawCanvas_TextRun (const TFB_TextGlyph *glyphs, COUNT count,
+		TFB_Image *backing, DrawMode, TFB_Canvas target);
 void TFB_DrawCanvas_CopyRect (TFB_Canvas source, const RECT *srcRect,
 		TFB_Canvas target, POINT dstPt);
 
@@ -179,8 +255,8 @@ void TFB_DrawCanvas_GetScreenFormat (TFB_PixelFormat *fmt);
 int TFB_DrawCanvas_GetStride (TFB_Canvas canvas);
 void *TFB_DrawCanvas_GetLine (TFB_Canvas canvas, int line);
 Color TFB_DrawCanvas_GetPixel (TFB_Canvas canvas, int x, int y);
-BOOLEAN TFB_DrawCanvas_Intersect (TFB_Canvas canvas1, POINT c1org,
-		TFB_Canvas canvas2, POINT c2org, const RECT *interRect);
+TFB_CollisionMask *TFB_DrawCanvas_NewCollisionMask (TFB_Canvas canvas);
+		// Free the result with HFree()
 
 BOOLEAN TFB_DrawCanvas_GetPixelColors (TFB_Canvas, Color *pixels,
 		int width, int height);
@@ -195,5 +271,7 @@ const char *TFB_DrawCanvas_GetError (void);
 
 TFB_Canvas TFB_GetScreenCanvas (SCREEN screen);
 
+void Canvas_PerfTest (void);
+
 #endif
 
@@ -29,7 +29,8 @@
 #include "libs/log.h"
 
 void
-TFB_Prim_Point (POINT *p, Color color, DrawMode mode, POINT ctxOrigin)
+TFB_Prim_Point (POINT *p, Color color, DrawMode mode, POINT ctxOrigin,
+		FRAME dst)
 {
 	RECT r;
 
@@ -38,14 +39,15 @@ TFB_Prim_Point (POINT *p, Color color, DrawMode mode, POINT ctxOrigin)
 	r.corner.y = p->y + ctxOrigin.y;
 	r.extent.width = r.extent.height = 1;
 
-	if (_CurFramePtr->Type == SCREEN_DRAWABLE)
+	if (dst->Type == SCREEN_DRAWABLE)
 		TFB_DrawScreen_Rect (&r, color, mode, TFB_SCREEN_MAIN);
 	else
-		TFB_DrawImage_Rect (&r, color, mode, _CurFramePtr->image);
+		TFB_DrawImage_Rect (&r, color, mode, dst->image);
 }
 
 void
-TFB_Prim_Rect (RECT *r, Color color, DrawMode mode, POINT ctxOrigin)
+TFB_Prim_Rect (RECT *r, Color color, DrawMode mode, POINT ctxOrigin,
+		FRAME dst)
 {
 	RECT arm;
 	int gscale;
@@ -57,24 +59,25 @@ TFB_Prim_Rect (RECT *r, Color color, DrawMode mode, POINT ctxOrigin)
 	arm = *r;
 	arm.extent.width = r->extent.width;
 	arm.extent.height = 1;
-	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin);
+	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin, dst);
 	arm.extent.height = r->extent.height;
 	arm.extent.width = 1;
-	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin);
+	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin, dst);
 	// rounding error correction here
 	arm.corner.x += ((r->extent.width * gscale + (GSCALE_IDENTITY >> 1))
 			/ GSCALE_IDENTITY) - 1;
-	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin);
+	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin, dst);
 	arm.corner.x = r->corner.x;
 	arm.corner.y += ((r->extent.height * gscale + (GSCALE_IDENTITY >> 1))
 			/ GSCALE_IDENTITY) - 1;
 	arm.extent.width = r->extent.width;
 	arm.extent.height = 1;
-	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin);
+	TFB_Prim_FillRect (&arm, color, mode, ctxOrigin, dst);
 }
 
 void
-TFB_Prim_FillRect (RECT *r, Color color, DrawMode mode, POINT ctxOrigin)
+TFB_Prim_FillRect (RECT *r, Color color, DrawMode mode, POINT ctxOrigin,
+		FRAME dst)
 {
 	RECT rect;
 	int gscale;
@@ -96,14 +99,15 @@ TFB_Prim_FillRect (RECT *r, Color color, DrawMode mode, POINT ctxOrigin)
 				+ (GSCALE_IDENTITY >> 1)) / GSCALE_IDENTITY;
 	}
 
-	if (_CurFramePtr->Type == SCREEN_DRAWABLE)
+	if (dst->Type == SCREEN_DRAWABLE)
 		TFB_DrawScreen_Rect (&rect, color, mode, TFB_SCREEN_MAIN);
 	else
-		TFB_DrawImage_Rect (&rect, color, mode, _CurFramePtr->image);
+		TFB_DrawImage_Rect (&rect, color, mode, dst->image);
 }
 
 void
-TFB_Prim_Line (LINE *line, Color color, DrawMode mode, POINT ctxOrigin)
+TFB_Prim_Line (LINE *line, Color color, DrawMode mode, POINT ctxOrigin,
+		FRAME dst)
 {
 	int x1, y1, x2, y2;
 
@@ -113,14 +117,37 @@ TFB_Prim_Line (LINE *line, Color color, DrawMode mode, POINT ctxOrigin)
 	x2=line->second.x + ctxOrigin.x;
 	y2=line->second.y + ctxOrigin.y;
 
-	if (_CurFramePtr->Type == SCREEN_DRAWABLE)
+	if (dst->Type == SCREEN_DRAWABLE)
 		TFB_DrawScreen_Line (x1, y1, x2, y2, color, mode, TFB_SCREEN_MAIN);
 	else
-		TFB_DrawImage_Line (x1, y1, x2, y2, color, mode, _CurFramePtr->image);
+		TFB_DrawImage_Line (x1, y1, x2, y2, color, mode, dst->image);
 }
 
 void
-TFB_Prim_Stamp (STAMP *stmp, DrawMode mode, POINT ctxOrigin)
+TFB_Prim_Polyline (const POINT *points, COUNT count, Color color,
+		DrawMode mode, POINT ctxOrigin, FRAME dst)
+{
+	COUNT i;
+
+	if (dst->Type != SCREEN_DRAWABLE)
+	{	// All in one go, with the image locked once
+		TFB_DrawImage_Polyline (points, count, ctxOrigin, color, mode,
+				dst->image);
+		return;
+	}
+
+	// The caller must scale the origins!
+	for (i = 1; i < count; ++i)
+	{
+		TFB_DrawScreen_Line (points[i - 1].x + ctxOrigin.x,
+				points[i - 1].y + ctxOrigin.y,
+				points[i].x + ctxOrigin.x, points[i].y + ctxOrigin.y,
+				color, mode, TFB_SCREEN_MAIN);
+	}
+}
+
+void
+TFB_Prim_Stamp (STAMP *stmp, DrawMode mode, POINT ctxOrigin, FRAME dst)
 {
 	int x, y;
 	FRAME SrcFramePtr;
@@ -157,7 +184,7 @@ TFB_Prim_Stamp (STAMP *stmp, DrawMode mode, POINT ctxOrigin)
 
 	UnlockMutex (img->mutex);
 
-	if (_CurFramePtr->Type == SCREEN_DRAWABLE)
+	if (dst->Type == SCREEN_DRAWABLE)
 	{
 		TFB_DrawScreen_Image (img, x, y, GetGraphicScale (),
 				GetGraphicScaleMode (), cmap, mode, TFB_SCREEN_MAIN);
@@ -165,12 +192,13 @@ TFB_Prim_Stamp (STAMP *stmp, DrawMode mode, POINT ctxOrigin)
 	else
 	{
 		TFB_DrawImage_Image (img, x, y, GetGraphicScale (),
-				GetGraphicScaleMode (), cmap, mode, _CurFramePtr->image);
+				GetGraphicScaleMode (), cmap, mode, dst->image);
 	}
 }
 
 void
-TFB_Prim_StampFill (STAMP *stmp, Color color, DrawMode mode, POINT ctxOrigin)
+TFB_Prim_StampFill (STAMP *stmp, Color color, DrawMode mode,
+		POINT ctxOrigin, FRAME dst)
 {
 	int x, y;
 	FRAME SrcFramePtr;
@@ -200,7 +228,7 @@ TFB_Prim_StampFill (STAMP *stmp, Color color, DrawMode mode, POINT ctxOrigin)
 
 	UnlockMutex (img->mutex);
 
-	if (_CurFramePtr->Type == SCREEN_DRAWABLE)
+	if (dst->Type == SCREEN_DRAWABLE)
 	{
 		TFB_DrawScreen_FilledImage (img, x, y, GetGraphicScale (),
 				GetGraphicScaleMode (), color, mode, TFB_SCREEN_MAIN);
@@ -208,7 +236,7 @@ TFB_Prim_StampFill (STAMP *stmp, Color color, DrawMode mode, POINT ctxOrigin)
 	else
 	{
 		TFB_DrawImage_FilledImage (img, x, y, GetGraphicScale (),
-				GetGraphicScaleMode (), color, mode, _CurFramePtr->image);
+				GetGraphicScaleMode (), color, mode, dst->image);
 	}
 }
 
@@ -234,4 +262,34 @@ TFB_Prim_FontChar (POINT charOrigin, TFB_Char *fontChar, TFB_Image *backing,
 	}
 }
 
+void
+TFB_Prim_TextRun (TFB_TextGlyph *glyphs, COUNT count, const RECT *bounds,
+		TFB_Image *backing, DrawMode mode, POINT ctxOrigin)
+{
+	COUNT i;
+	RECT r;
+
+	// Text prim does not scale
+	for (i = 0; i < count; ++i)
+	{
+		glyphs[i].x += ctxOrigin.x;
+		glyphs[i].y += ctxOrigin.y;
+	}
+	r = *bounds;
+	r.corner.x += ctxOrigin.x;
+	r.corner.y += ctxOrigin.y;
+
+	if (_CurFramePtr->Type == SCREEN_DRAWABLE)
+	{	// The DCQ takes ownership of the glyphs
+		TFB_DrawScreen_TextRun (glyphs, count, &r, backing, mode,
+				TFB_SCREEN_MAIN);
+	}
+	else
+	{
+		TFB_DrawImage_TextRun (glyphs, count, backing, mode,
+				_CurFramePtr->image);
+		HFree (glyphs);
+	}
+}
+
 // Text rendering is in font.c, under the name _text_blt
@@ -20,11 +20,19 @@
 #include "tfb_draw.h"
 
 
-void TFB_Prim_Line (LINE *, Color, DrawMode, POINT ctxOrigin);
-void TFB_Prim_Point (POINT *, Color, DrawMode, POINT ctxOrigin);
-void TFB_Prim_Rect (RECT *, Color, DrawMode, POINT ctxOrigin);
-void TFB_Prim_FillRect (RECT *, Color, DrawMode, POINT ctxOrigin);
-void TFB_Prim_Stamp (STAMP *, DrawMode, POINT ctxOrigin);
-void TFB_Prim_StampFill (STAMP *, Color, DrawMode, POINT ctxOrigin);
+// 'dst' is the frame drawn into, normally the current context's
+// foreground frame
+void TFB_Prim_Line (LINE *, Color, DrawMode, POINT ctxOrigin, FRAME dst);
+void TFB_Prim_Polyline (const POINT *, COUNT, Color, DrawMode,
+		POINT ctxOrigin, FRAME dst);
+void TFB_Prim_Point (POINT *, Color, DrawMode, POINT ctxOrigin, FRAME dst);
+void TFB_Prim_Rect (RECT *, Color, DrawMode, POINT ctxOrigin, FRAME dst);
+void TFB_Prim_FillRect (RECT *, Color, DrawMode, POINT ctxOrigin,
+		FRAME dst);
+void TFB_Prim_Stamp (STAMP *, DrawMode, POINT ctxOrigin, FRAME dst);
+void TFB_Prim_StampFill (STAMP *, Color, DrawMode, POINT ctxOrigin,
+		FRAME dst);
 void TFB_Prim_FontChar (POINT charOrigin, TFB_Char *fontChar,
 		TFB_Image *backing, DrawMode, POINT ctxOrigin);
+void TFB_Prim_TextRun (TFB_TextGlyph *glyphs, COUNT count,
+		const RECT *bounds, TFB_Image *backing, DrawMode, POINT ctxOrigin);
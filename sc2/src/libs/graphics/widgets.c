@@ -46,39 +46,37 @@ static FONT cur_font;
 void
 DrawShadowedBox (RECT *r, Color bg, Color dark, Color medium)
 {
+	CONTEXT context = GetContext ();
 	RECT t;
-	Color oldcolor;
 
+	// Drawn with explicit colors, so the context foreground color and
+	// with it the font backing stay as they are
 	BatchGraphics ();
 
 	t.corner.x = r->corner.x - 2;
 	t.corner.y = r->corner.y - 2;
 	t.extent.width  = r->extent.width + 4;
 	t.extent.height  = r->extent.height + 4;
-	oldcolor = SetContextForeGroundColor (dark);
-	DrawFilledRectangle (&t);
+	DrawFilledRectangleIn (context, &t, dark);
 
 	t.corner.x += 2;
 	t.corner.y += 2;
 	t.extent.width -= 2;
 	t.extent.height -= 2;
-	SetContextForeGroundColor (medium);
-	DrawFilledRectangle (&t);
+	DrawFilledRectangleIn (context, &t, medium);
 
 	t.corner.x -= 1;
 	t.corner.y += r->extent.height + 1;
 	t.extent.height = 1;
-	DrawFilledRectangle (&t);
+	DrawFilledRectangleIn (context, &t, medium);
 
 	t.corner.x += r->extent.width + 2;
 	t.corner.y -= r->extent.height + 2;
 	t.extent.width = 1;
-	DrawFilledRectangle (&t);
+	DrawFilledRectangleIn (context, &t, medium);
 
-	SetContextForeGroundColor (bg);
-	DrawFilledRectangle (r);
+	DrawFilledRectangleIn (context, r, bg);
 
-	SetContextForeGroundColor (oldcolor);
 	UnbatchGraphics ();
 }
 
@@ -23,6 +23,7 @@
 #include "libs/compiler.h"
 #include "libs/uio.h"
 #include "libs/unicode.h"
+#include "libs/timelib.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -63,6 +64,20 @@ void SaveKeyConfiguration (uio_DirHandle *path, const char *fname);
 
 void BeginInputFrame (void);
 
+/* Flight key presses and releases, in the order they happened */
+
+typedef struct
+{
+	TimeCount time;
+			// When the event was pumped
+	BYTE templat;
+	BYTE control;
+	BOOLEAN pressed;
+} TFB_InputEdge;
+
+// Returns FALSE when there are no more edges
+BOOLEAN TFB_GetInputEdge (TFB_InputEdge *edge);
+
 #if defined(__cplusplus)
 }
 #endif
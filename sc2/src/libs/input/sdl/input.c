@@ -54,6 +54,15 @@ static volatile int *flight_vec;
 static int num_templ;
 static int num_flight;
 
+#define EDGEBUFSIZE (1 << 8)
+static TFB_InputEdge edgebuf[EDGEBUFSIZE];
+static AtomicU32 edgehead, edgetail;
+		// Only the thread pumping events moves the tail, so no lock is
+		// needed to add an edge; edges are taken with a compare-exchange
+		// on the head
+static BYTE *flight_down;
+		// Whether each flight_vec element was down at the last edge
+
 static BOOLEAN InputInitialized = FALSE;
 
 static BOOLEAN in_character_mode = FALSE;
@@ -173,6 +182,7 @@ initKeyConfig (void)
 
 	controls = HCalloc (sizeof (*controls) * num_templ * num_flight
 			* MAX_FLIGHT_ALTERNATES);
+	flight_down = HCalloc (num_templ * num_flight);
 
 	/* First, load in the menu keys */
 	LoadResourceIndex (contentDir, "menu.key", "menu.");
@@ -296,6 +306,8 @@ TFB_UninitInput (void)
 {
 	VControl_Uninit ();
 	HFree (controls);
+	HFree (flight_down);
+	flight_down = NULL;
 #if SDL_MAJOR_VERSION == 1
 	HFree (kbdstate);
 #endif
@@ -354,6 +366,56 @@ ProcessMouseEvent (const SDL_Event *e)
 	}
 }
 
+// Called after every event VControl has seen. A press and release
+// within one game frame both show up here, even if VControl's start bit
+// for it was cleared before the game looked.
+static void
+recordFlightEdges (void)
+{
+	int i;
+	int count = num_templ * num_flight;
+	TimeCount now = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		BYTE down = (flight_vec[i] & VCONTROL_MASK) != 0;
+		uint32 tail;
+		TFB_InputEdge *edge;
+
+		if (down == flight_down[i])
+			continue;
+		flight_down[i] = down;
+
+		tail = AtomicLoad (&edgetail);
+		if (tail - AtomicLoad (&edgehead) >= EDGEBUFSIZE)
+			continue; // the game is not looking; drop it
+		if (now == 0)
+			now = GetTimeCounter ();
+		edge = &edgebuf[tail & (EDGEBUFSIZE - 1)];
+		edge->time = now;
+		edge->templat = (BYTE) (i / num_flight);
+		edge->control = (BYTE) (i % num_flight);
+		edge->pressed = down;
+		AtomicStore (&edgetail, tail + 1);
+	}
+}
+
+BOOLEAN
+TFB_GetInputEdge (TFB_InputEdge *edge)
+{
+	uint32 head;
+
+	do
+	{
+		head = AtomicLoad (&edgehead);
+		if (head == AtomicLoad (&edgetail))
+			return FALSE;
+		*edge = edgebuf[head & (EDGEBUFSIZE - 1)];
+	} while (!AtomicCompareExchange (&edgehead, head, head + 1));
+
+	return TRUE;
+}
+
 #if SDL_MAJOR_VERSION == 1
 
 static inline int
@@ -377,7 +439,10 @@ ProcessInputEvent (const SDL_Event *Event)
 	// In character mode with NumLock on, numpad chars bypass VControl
 	// so that menu arrow events are not produced
 	if (!is_numpad_char_event (Event))
+	{
 		VControl_HandleEvent (Event);
+		recordFlightEdges ();
+	}
 
 	if (Event->type == SDL_KEYDOWN || Event->type == SDL_KEYUP)
 	{	// process character input event, if any
@@ -460,6 +525,7 @@ ProcessInputEvent (const SDL_Event *Event)
 	if (!is_numpad_char_event(Event))
 	{
 		VControl_HandleEvent (Event);
+		recordFlightEdges ();
 	}
 
 	if (Event->type == SDL_TEXTINPUT)
@@ -528,6 +594,8 @@ TFB_ResetControls (void)
 	// flush character buffer
 	kbdhead = kbdtail = 0;
 	lastchar = 0;
+	// and the edges not taken yet
+	AtomicStore (&edgehead, AtomicLoad (&edgetail));
 }
 
 void
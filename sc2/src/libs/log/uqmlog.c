@@ -24,6 +24,7 @@
 #include <signal.h>
 #include <errno.h>
 #include "libs/threadlib.h"
+#include "libs/timelib.h"
 
 #ifndef MAX_LOG_ENTRY_SIZE
 #	define MAX_LOG_ENTRY_SIZE 256
@@ -33,6 +34,11 @@
 #	define MAX_LOG_ENTRIES 128
 #endif
 
+#ifndef MAX_PENDING_ENTRIES
+#	define MAX_PENDING_ENTRIES 1024
+		// Lines waiting for the writer thread; must be a power of 2
+#endif
+
 typedef char log_Entry[MAX_LOG_ENTRY_SIZE];
 
 // static buffers in case we run out of memory
@@ -55,6 +61,23 @@ FILE *streamOut;
 static volatile int qlock = 0;
 static Mutex qmutex;
 
+// Lines for streamOut are queued here and written by the writer thread,
+// so that logging does not wait for the stream. Each slot has a sequence
+// number telling whether it is free for the adding thread at that
+// position, or filled for the writing thread at that position, so
+// adding and writing lines needs no lock.
+static log_Entry pending[MAX_PENDING_ENTRIES];
+static AtomicU32 pendingSeq[MAX_PENDING_ENTRIES];
+static AtomicU32 pendingTail;
+		// Where the next line is added
+static AtomicU32 pendingHead;
+		// The next line to write
+static AtomicU32 pendingDropped;
+		// Lines lost because the queue was full
+static volatile bool writerRunning = false;
+		// Lines are written directly while there is no writer thread
+static volatile bool writerQuit = false;
+
 static void exitCallback (void);
 static void displayLog (bool isError);
 
@@ -76,6 +99,99 @@ unlockQueue (void)
 	UnlockMutex (qmutex);
 }
 
+static void
+queuePending (const char *msg)
+{
+	uint32 pos;
+	log_Entry *entry;
+
+	for (;;)
+	{
+		sint32 ahead;
+
+		pos = AtomicLoad (&pendingTail);
+		ahead = (sint32) (AtomicLoad (&pendingSeq[
+				pos & (MAX_PENDING_ENTRIES - 1)]) - pos);
+		if (ahead < 0)
+		{	// Not written out yet; full
+			AtomicAdd (&pendingDropped, 1);
+			return;
+		}
+		if (ahead == 0 && AtomicCompareExchange (&pendingTail, pos,
+				pos + 1))
+			break;
+		// Another thread took this slot first
+	}
+
+	entry = &pending[pos & (MAX_PENDING_ENTRIES - 1)];
+	memcpy (*entry, msg, sizeof (*entry));
+	AtomicStore (&pendingSeq[pos & (MAX_PENDING_ENTRIES - 1)], pos + 1);
+}
+
+// Writes out the queued lines. Any thread may do this, although lines
+// written by two threads at once may come out slightly reordered.
+static void
+flushPending (void)
+{
+	uint32 pos;
+	uint32 dropped;
+	log_Entry msg;
+
+	for (;;)
+	{
+		pos = AtomicLoad (&pendingHead);
+		if (AtomicLoad (&pendingSeq[pos & (MAX_PENDING_ENTRIES - 1)])
+				!= pos + 1)
+			break; // empty, or the line is still being copied in
+		if (!AtomicCompareExchange (&pendingHead, pos, pos + 1))
+			continue; // someone else took it
+		// The slot stays ours until its sequence number is bumped
+		memcpy (msg, pending[pos & (MAX_PENDING_ENTRIES - 1)],
+				sizeof (msg));
+		AtomicStore (&pendingSeq[pos & (MAX_PENDING_ENTRIES - 1)],
+				pos + MAX_PENDING_ENTRIES);
+
+		fprintf (streamOut, "%s\n", msg);
+	}
+
+	dropped = AtomicLoad (&pendingDropped);
+	if (dropped != 0 && AtomicCompareExchange (&pendingDropped, dropped, 0))
+		fprintf (streamOut, "(%lu log lines dropped)\n",
+				(unsigned long) dropped);
+}
+
+static int
+writerFunc (void *data)
+{
+	while (!writerQuit)
+	{
+		flushPending ();
+		fflush (streamOut);
+		SleepThread (ONE_SECOND / 50);
+	}
+	(void) data;
+	return 0;
+}
+
+static void
+writeStream (log_Level level, const char *msg)
+{
+	// Errors go out right away, as the program may be about to die
+	if (writerRunning && (int)level > log_Error)
+	{
+		queuePending (msg);
+		if (AtomicLoad (&pendingTail) - AtomicLoad (&pendingHead)
+				> MAX_PENDING_ENTRIES * 3 / 4)
+			flushPending ();
+				// The writer is falling behind; help out rather
+				// than drop lines
+		return;
+	}
+
+	flushPending ();
+	fprintf (streamOut, "%s\n", msg);
+}
+
 static void
 removeExcess (int room)
 {
@@ -139,6 +255,9 @@ log_init (int max_lines)
 	msgBuf[sizeof (msgBuf) - 1] = '\0';
 	msgNoThread[sizeof (msgNoThread) - 1] = '\0';
 
+	for (i = 0; i < MAX_PENDING_ENTRIES; ++i)
+		AtomicStore (&pendingSeq[i], i);
+
 	// install exit handlers
 	atexit (exitCallback);
 }
@@ -148,6 +267,10 @@ log_initThreads (void)
 {
 	qmutex = CreateMutex ("Logging Lock", SYNC_CLASS_RESOURCE);
 	qlock = 1;
+
+	writerQuit = false;
+	StartThread (writerFunc, NULL, 0, "log writer");
+	writerRunning = true;
 }
 
 int
@@ -155,6 +278,11 @@ log_exit (int code)
 {
 	showBox = false;
 
+	// The writer thread may not get to run again
+	writerRunning = false;
+	writerQuit = true;
+	flushPending ();
+
 	if (qlock)
 	{
 		qlock = 0;
@@ -176,6 +304,7 @@ FILE *
 log_setOutput (FILE *out)
 {
 	FILE *old = streamOut;
+	flushPending ();
 	streamOut = out;
 	
 	return old;
@@ -185,12 +314,16 @@ void
 log_addV (log_Level level, const char *fmt, va_list list)
 {
 	log_Entry full_msg;
+
+	if ((int)level > maxStreamLevel && (int)level > maxLevel)
+		return; // not wanted anywhere; do not bother formatting
+
 	vsnprintf (full_msg, sizeof (full_msg) - 1, fmt, list);
 	full_msg[sizeof (full_msg) - 1] = '\0';
 	
 	if ((int)level <= maxStreamLevel)
 	{
-		fprintf (streamOut, "%s\n", full_msg);
+		writeStream (level, full_msg);
 	}
 
 	if ((int)level <= maxLevel)
@@ -221,6 +354,10 @@ void
 log_add_nothreadV (log_Level level, const char *fmt, va_list list)
 {
 	log_Entry full_msg;
+
+	if ((int)level > maxStreamLevel && (int)level > maxLevel)
+		return;
+
 	vsnprintf (full_msg, sizeof (full_msg) - 1, fmt, list);
 	full_msg[sizeof (full_msg) - 1] = '\0';
 	
@@ -47,6 +47,8 @@ RandomContext *RandomContext_New (void);
 void RandomContext_Delete (RandomContext *context);
 RandomContext *RandomContext_Copy (const RandomContext *source);
 DWORD RandomContext_Random (RandomContext *context);
+void RandomContext_FillRandom (RandomContext *context, DWORD *values,
+		COUNT count);
 DWORD RandomContext_SeedRandom (RandomContext *context, DWORD new_seed);
 DWORD RandomContext_GetSeed (RandomContext *context);
 
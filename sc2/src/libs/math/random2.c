@@ -66,6 +66,27 @@ RandomContext_Random (RandomContext *context)
 	return context->seed;
 }
 
+// Fills 'values' with the next 'count' values of the sequence, the same
+// ones that as many calls to RandomContext_Random() would return.
+void
+RandomContext_FillRandom (RandomContext *context, DWORD *values,
+		COUNT count)
+{
+	DWORD seed = context->seed;
+
+	while (count--)
+	{
+		seed = A * (seed % Q) - R * (seed / Q);
+		if (seed > M)
+			seed -= M;
+		else if (seed == 0)
+			seed = 1;
+		*values++ = seed;
+	}
+
+	context->seed = seed;
+}
+
 DWORD
 RandomContext_SeedRandom (RandomContext *context, DWORD new_seed)
 {
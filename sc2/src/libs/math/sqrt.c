@@ -18,80 +18,57 @@
 
 #include "mthintrn.h"
 
-COUNT
-square_root (DWORD value)
+// square_root (i) for i < 256
+static const BYTE small_roots[256] =
 {
-	UWORD sig_word, mask;
-	COUNT result, shift;
-
-	if ((sig_word = HIWORD (value)) > 0)
-	{
-		DWORD mask_squared, result_shift;
-
-		for (mask = 1 << 15, shift = 31;
-				!(mask & sig_word); mask >>= 1, --shift)
-			;
-		shift >>= 1;
-		mask = 1 << shift;
-
-		result = mask;
-		mask_squared = result_shift = (DWORD)mask << shift;
-		value -= mask_squared;
-		while (mask >>= 1)
-		{
-			DWORD remainder;
-
-			mask_squared >>= 1;
-			mask_squared >>= 1;
-			if ((remainder = result_shift + mask_squared) > value)
-				result_shift >>= 1;
-			else
-			{
-				value -= remainder;
-
-				result_shift = (result_shift >> 1) + mask_squared;
-
-				result |= mask;
-			}
-		}
+	0, 1, 1, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+	8, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+	9, 9, 9, 9, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+	10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11,
+	11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 13, 13, 13, 13, 13, 13, 13,
+	13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+	13, 13, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+	14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+	14, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+};
+
+// Digit-by-digit square root, two bits of 'value' per step, starting with
+// the bit pair 'bit' (a power of 4 at least as large as the highest pair
+// set in 'value'). The steps do not branch on the data.
+static inline COUNT
+root_from (DWORD value, DWORD bit)
+{
+	DWORD result = 0;
 
-		return (result);
-	}
-	else if ((sig_word = LOWORD (value)) > 0)
+	for (; bit; bit >>= 2)
 	{
-		UWORD mask_squared, result_shift;
-
-		for (mask = 1 << 15, shift = 15;
-				!(mask & sig_word); mask >>= 1, --shift)
-			;
-		shift >>= 1;
-		mask = 1 << shift;
-
-		result = mask;
-		mask_squared = result_shift = mask << shift;
-		sig_word -= mask_squared;
-		while (mask >>= 1)
-		{
-			UWORD remainder;
-
-			mask_squared >>= 1;
-			mask_squared >>= 1;
-			if ((remainder = result_shift + mask_squared) > sig_word)
-				result_shift >>= 1;
-			else
-			{
-				sig_word -= remainder;
-
-				result_shift = (result_shift >> 1) + mask_squared;
+		DWORD trial = result + bit;
+		DWORD take = (DWORD) 0 - (DWORD) (value >= trial);
+				// All ones if 'trial' fits, else 0
 
-				result |= mask;
-			}
-		}
-
-		return (result);
+		value -= trial & take;
+		result = (result >> 1) + (bit & take);
 	}
 
-	return (0);
+	return (COUNT) result;
 }
 
+// The integer part of the square root; the same as the bit-by-bit
+// version this replaced, which netplay relies on
+COUNT
+square_root (DWORD value)
+{
+	if (value < 256)
+		return small_roots[value];
+	if (HIWORD (value) == 0)
+		return root_from (value, (DWORD) 1 << 14);
+	return root_from (value, (DWORD) 1 << 30);
+}
 
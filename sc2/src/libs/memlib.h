@@ -19,6 +19,8 @@
 #ifndef LIBS_MEMLIB_H_
 #define LIBS_MEMLIB_H_
 
+//#define TRACK_MEMORY           /* Should heap use be counted per subsystem? */
+
 #include <stddef.h>
 
 #include "types.h"
@@ -53,6 +55,50 @@ extern void *HCalloc (size_t size);
 extern void *HRealloc (void *p, size_t size);
 #endif /* USE_RUST_MEM */
 
+#ifdef TRACK_MEMORY
+/* Heap accounting, see libs/memory/memtrack.c.
+ * Every HMalloc() and friends is charged to the subsystem of the file it
+ * is called from; uio_malloc() and friends to MEMTAG_UIO. For each there
+ * are the live and peak bytes and the allocations made. */
+typedef enum
+{
+	MEMTAG_GFX,
+	MEMTAG_SOUND,
+	MEMTAG_RESOURCES,
+	MEMTAG_UIO,
+	MEMTAG_GAME,
+	MEMTAG_OTHER,
+
+	MEMTAG_COUNT
+} MemTag;
+
+extern void *MemTrack_HMalloc (size_t size, const char *file);
+extern void *MemTrack_HCalloc (size_t size, const char *file);
+extern void *MemTrack_HRealloc (void *p, size_t size, const char *file);
+extern void MemTrack_HFree (void *p);
+
+// Same, for the C library's allocator
+extern void *MemTrack_malloc (size_t size, MemTag tag);
+extern void *MemTrack_calloc (size_t count, size_t size, MemTag tag);
+extern void *MemTrack_realloc (void *p, size_t size, MemTag tag);
+extern void MemTrack_free (void *p);
+
+// Logs the counts per subsystem, and the allocations per second since
+// the previous report
+extern void MemTrack_report (void);
+
+#ifndef MEMTRACK_INTERNAL
+#	undef HMalloc
+#	undef HFree
+#	undef HCalloc
+#	undef HRealloc
+#	define HMalloc(s) MemTrack_HMalloc (s, __FILE__)
+#	define HFree(p) MemTrack_HFree (p)
+#	define HCalloc(s) MemTrack_HCalloc (s, __FILE__)
+#	define HRealloc(p, s) MemTrack_HRealloc (p, s, __FILE__)
+#endif /* MEMTRACK_INTERNAL */
+#endif /* TRACK_MEMORY */
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,194 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "arena.h"
+#include "libs/compiler.h"
+#include "libs/memlib.h"
+
+#include <string.h>
+
+#define ARENA_DEFAULT_CHUNK (64 * 1024)
+#define ARENA_ALIGN 16
+		// Enough for any type, SSE vectors included
+
+struct MemArenaChunk
+{
+	MemArenaChunk *prev;
+	size_t size;
+			// Of the data, past the header
+	size_t used;
+};
+
+#define CHUNK_HEADER_SIZE \
+		((sizeof (MemArenaChunk) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+struct MemArena
+{
+	MemArenaChunk *chunk;
+			// The newest one; the first one is at the end of 'prev'
+	size_t chunkSize;
+	void *last;
+			// The last allocation, which MemArena_realloc() can grow
+};
+
+static BYTE *
+chunkData (MemArenaChunk *chunk)
+{
+	return (BYTE *) chunk + CHUNK_HEADER_SIZE;
+}
+
+static size_t
+alignUp (size_t size)
+{
+	return (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+}
+
+static MemArenaChunk *
+newChunk (size_t size, MemArenaChunk *prev)
+{
+	MemArenaChunk *chunk = HMalloc (CHUNK_HEADER_SIZE + size);
+	if (!chunk)
+		return NULL;
+	chunk->prev = prev;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+MemArena *
+MemArena_new (size_t chunkSize)
+{
+	MemArena *arena = HMalloc (sizeof *arena);
+	if (!arena)
+		return NULL;
+
+	arena->chunkSize = alignUp (chunkSize ? chunkSize : ARENA_DEFAULT_CHUNK);
+	arena->chunk = NULL;
+	arena->last = NULL;
+	return arena;
+}
+
+void
+MemArena_delete (MemArena *arena)
+{
+	MemArenaChunk *chunk;
+	MemArenaChunk *prev;
+
+	if (!arena)
+		return;
+
+	for (chunk = arena->chunk; chunk; chunk = prev)
+	{
+		prev = chunk->prev;
+		HFree (chunk);
+	}
+	HFree (arena);
+}
+
+void *
+MemArena_alloc (MemArena *arena, size_t size)
+{
+	MemArenaChunk *chunk = arena->chunk;
+	void *p;
+
+	size = alignUp (size ? size : 1);
+	if (!chunk || chunk->size - chunk->used < size)
+	{
+		chunk = newChunk (size > arena->chunkSize ? size : arena->chunkSize,
+				chunk);
+		if (!chunk)
+			return NULL;
+		arena->chunk = chunk;
+	}
+
+	p = chunkData (chunk) + chunk->used;
+	chunk->used += size;
+	arena->last = p;
+	return p;
+}
+
+void *
+MemArena_calloc (MemArena *arena, size_t size)
+{
+	void *p = MemArena_alloc (arena, size);
+	if (p)
+		memset (p, 0, size);
+	return p;
+}
+
+void *
+MemArena_realloc (MemArena *arena, void *p, size_t oldSize, size_t size)
+{
+	MemArenaChunk *chunk = arena->chunk;
+	void *newP;
+
+	if (!p)
+		return MemArena_alloc (arena, size);
+
+	if (p == arena->last)
+	{
+		size_t start = (size_t) ((BYTE *) p - chunkData (chunk));
+		size_t newSize = alignUp (size ? size : 1);
+
+		if (chunk->size - start >= newSize)
+		{
+			chunk->used = start + newSize;
+			return p;
+		}
+	}
+
+	newP = MemArena_alloc (arena, size);
+	if (newP)
+		memcpy (newP, p, oldSize < size ? oldSize : size);
+	return newP;
+}
+
+MemArenaMark
+MemArena_mark (MemArena *arena)
+{
+	MemArenaMark mark;
+
+	mark.chunk = arena->chunk;
+	mark.used = arena->chunk ? arena->chunk->used : 0;
+	return mark;
+}
+
+void
+MemArena_release (MemArena *arena, MemArenaMark mark)
+{
+	while (arena->chunk != mark.chunk)
+	{
+		MemArenaChunk *prev = arena->chunk->prev;
+		if (!mark.chunk && !prev)
+			break;
+				// Keep the first chunk when everything goes
+		HFree (arena->chunk);
+		arena->chunk = prev;
+	}
+	if (arena->chunk)
+		arena->chunk->used = mark.chunk ? mark.used : 0;
+	arena->last = NULL;
+}
+
+void
+MemArena_reset (MemArena *arena)
+{
+	MemArenaMark none;
+
+	none.chunk = NULL;
+	none.used = 0;
+	MemArena_release (arena, none);
+}
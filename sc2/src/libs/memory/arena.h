@@ -0,0 +1,64 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Arenas, for memory that is all let go of at the same time, such as
+ * what a screen uses while it is up.
+ * Allocating takes the next piece of a large chunk, and nothing is freed
+ * on its own: MemArena_release() frees everything allocated since a
+ * MemArena_mark(), and MemArena_reset() everything. More chunks are
+ * added as needed; reset keeps the first one for the next use.
+ * An arena is not locked; only one thread at a time may use it. */
+
+#ifndef LIBS_MEMORY_ARENA_H_
+#define LIBS_MEMORY_ARENA_H_
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct MemArena MemArena;
+typedef struct MemArenaChunk MemArenaChunk;
+
+typedef struct
+{
+	MemArenaChunk *chunk;
+	size_t used;
+} MemArenaMark;
+
+// 'chunkSize' is the size of each chunk; larger allocations get a chunk
+// of their own. 0 picks a default.
+MemArena *MemArena_new (size_t chunkSize);
+void MemArena_delete (MemArena *arena);
+
+// The memory is aligned for any type. NULL when out of memory.
+void *MemArena_alloc (MemArena *arena, size_t size);
+void *MemArena_calloc (MemArena *arena, size_t size);
+// Grows the last allocation in place when it can; otherwise copies.
+// 'oldSize' is what 'p' was allocated with.
+void *MemArena_realloc (MemArena *arena, void *p, size_t oldSize,
+		size_t size);
+
+MemArenaMark MemArena_mark (MemArena *arena);
+void MemArena_release (MemArena *arena, MemArenaMark mark);
+void MemArena_reset (MemArena *arena);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_MEMORY_ARENA_H_ */
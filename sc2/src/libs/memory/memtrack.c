@@ -0,0 +1,494 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Heap accounting for TRACK_MEMORY.
+ * The size and subsystem of every live block is kept in a table of its
+ * own rather than in a header in front of the block, so a block that is
+ * allocated one way and freed another (HMalloc() and free(), or
+ * uio_malloc() in C and free() in Rust) does no harm; it is just not
+ * counted right. Blocks the table does not know are passed on as they
+ * are. */
+
+#define MEMTRACK_INTERNAL
+#include "libs/memlib.h"
+
+#ifdef TRACK_MEMORY
+
+#include "libs/log.h"
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	void *p;
+			// NULL for an empty slot
+	size_t size;
+	MemTag tag;
+} MemBlock;
+
+typedef struct
+{
+	size_t liveBytes;
+	size_t peakBytes;
+	DWORD liveBlocks;
+	DWORD allocs;
+			// Reallocations included
+	DWORD reportedAllocs;
+			// 'allocs' at the previous report
+} MemTagStats;
+
+#define MEMTRACK_MIN_BLOCKS 4096
+		// Table size to start with; it doubles when half full
+
+static MemBlock *blocks;
+static size_t blocksSize;
+static size_t blocksUsed;
+static MemTagStats stats[MEMTAG_COUNT];
+static size_t totalPeakBytes;
+static TimeCount lastReport;
+static AtomicU32 trackLock;
+		// A spin lock; a Mutex would be allocated with HMalloc()
+
+#define MEMTRACK_FILE_CACHE 64
+static struct
+{
+	const char *file;
+	MemTag tag;
+} fileCache[MEMTRACK_FILE_CACHE];
+		// __FILE__ strings are constants, so they are looked up by address
+
+static const char *const tagNames[MEMTAG_COUNT] =
+{
+	"gfx",
+	"sound",
+	"resources",
+	"uio",
+	"game",
+	"other",
+};
+
+// The most specific directories first
+static const struct
+{
+	const char *dir;
+	MemTag tag;
+} tagDirs[] =
+{
+	{ "libs/graphics/", MEMTAG_GFX },
+	{ "libs/video/", MEMTAG_GFX },
+	{ "libs/sound/", MEMTAG_SOUND },
+	{ "libs/mikmod/", MEMTAG_SOUND },
+	{ "libs/resource/", MEMTAG_RESOURCES },
+	{ "libs/strings/", MEMTAG_RESOURCES },
+	{ "libs/decomp/", MEMTAG_RESOURCES },
+	{ "libs/uio/", MEMTAG_UIO },
+	{ "libs/file/", MEMTAG_UIO },
+	{ "uqm/", MEMTAG_GAME },
+};
+
+static void
+lockTrack (void)
+{
+	while (!AtomicCompareExchange (&trackLock, 0, 1))
+		;
+}
+
+static void
+unlockTrack (void)
+{
+	AtomicStore (&trackLock, 0);
+}
+
+// Whether 'dir' (with '/' separators) is a part of the path 'file',
+// starting at a directory boundary
+static BOOLEAN
+pathHasDir (const char *file, const char *dir)
+{
+	const char *start;
+
+	for (start = file; *start != '\0'; ++start)
+	{
+		const char *f = start;
+		const char *d = dir;
+
+		if (start != file && start[-1] != '/' && start[-1] != '\\')
+			continue;
+
+		while (*d != '\0' && (*f == *d || (*f == '\\' && *d == '/')))
+		{
+			++f;
+			++d;
+		}
+		if (*d == '\0')
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// The lock is held
+static MemTag
+tagOfFile (const char *file)
+{
+	size_t slot = ((size_t) file >> 3) % MEMTRACK_FILE_CACHE;
+	MemTag tag = MEMTAG_OTHER;
+	COUNT i;
+
+	if (fileCache[slot].file == file)
+		return fileCache[slot].tag;
+
+	for (i = 0; i < sizeof tagDirs / sizeof tagDirs[0]; ++i)
+	{
+		if (pathHasDir (file, tagDirs[i].dir))
+		{
+			tag = tagDirs[i].tag;
+			break;
+		}
+	}
+	fileCache[slot].file = file;
+	fileCache[slot].tag = tag;
+	return tag;
+}
+
+static size_t
+slotOf (const void *p, size_t size)
+{
+	size_t h = (size_t) p;
+
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return h & (size - 1);
+}
+
+static MemBlock *
+findBlock (const void *p)
+{
+	size_t i;
+
+	if (blocks == NULL)
+		return NULL;
+
+	for (i = slotOf (p, blocksSize); blocks[i].p != NULL;
+			i = (i + 1) & (blocksSize - 1))
+	{
+		if (blocks[i].p == p)
+			return &blocks[i];
+	}
+	return NULL;
+}
+
+// Empties the slot, moving up the blocks after it that would otherwise be
+// cut off from their own slots
+static void
+removeBlock (MemBlock *block)
+{
+	size_t hole = (size_t) (block - blocks);
+	size_t i = hole;
+
+	for (;;)
+	{
+		size_t home;
+
+		i = (i + 1) & (blocksSize - 1);
+		if (blocks[i].p == NULL)
+			break;
+		home = slotOf (blocks[i].p, blocksSize);
+		// Leave it if its own slot lies in (hole, i]
+		if (((i - home) & (blocksSize - 1)) < ((i - hole) & (blocksSize - 1)))
+			continue;
+		blocks[hole] = blocks[i];
+		hole = i;
+	}
+	blocks[hole].p = NULL;
+	--blocksUsed;
+}
+
+static void
+uncount (MemBlock *block)
+{
+	MemTagStats *s = &stats[block->tag];
+
+	s->liveBytes -= block->size;
+	--s->liveBlocks;
+	removeBlock (block);
+}
+
+static void
+insertBlock (MemBlock *table, size_t size, const MemBlock *block)
+{
+	size_t i;
+
+	for (i = slotOf (block->p, size); table[i].p != NULL;
+			i = (i + 1) & (size - 1))
+		;
+	table[i] = *block;
+}
+
+// Returns FALSE if there is no room; the block is then not counted
+static BOOLEAN
+growBlocks (void)
+{
+	size_t newSize = blocks ? blocksSize * 2 : MEMTRACK_MIN_BLOCKS;
+	MemBlock *newBlocks;
+	size_t i;
+
+	newBlocks = calloc (newSize, sizeof *newBlocks);
+	if (newBlocks == NULL)
+		return FALSE;
+
+	for (i = 0; i < blocksSize; ++i)
+	{
+		if (blocks[i].p != NULL)
+			insertBlock (newBlocks, newSize, &blocks[i]);
+	}
+	free (blocks);
+	blocks = newBlocks;
+	blocksSize = newSize;
+	return TRUE;
+}
+
+static void
+count (void *p, size_t size, MemTag tag)
+{
+	MemTagStats *s = &stats[tag];
+	MemBlock block;
+	MemBlock *old;
+	size_t total;
+	COUNT i;
+
+	++s->allocs;
+
+	// The block may have been freed behind our back and handed out again
+	old = findBlock (p);
+	if (old != NULL)
+		uncount (old);
+
+	if (blocksUsed + 1 > blocksSize / 2 && !growBlocks ())
+		return;
+
+	block.p = p;
+	block.size = size;
+	block.tag = tag;
+	insertBlock (blocks, blocksSize, &block);
+	++blocksUsed;
+
+	s->liveBytes += size;
+	++s->liveBlocks;
+	if (s->liveBytes > s->peakBytes)
+		s->peakBytes = s->liveBytes;
+
+	total = 0;
+	for (i = 0; i < MEMTAG_COUNT; ++i)
+		total += stats[i].liveBytes;
+	if (total > totalPeakBytes)
+		totalPeakBytes = total;
+}
+
+static void
+track (void *p, size_t size, MemTag tag)
+{
+	if (p == NULL)
+		return;
+
+	lockTrack ();
+	count (p, size, tag);
+	unlockTrack ();
+}
+
+static void
+untrack (void *p)
+{
+	MemBlock *block;
+
+	if (p == NULL)
+		return;
+
+	lockTrack ();
+	block = findBlock (p);
+	if (block != NULL)
+		uncount (block);
+	unlockTrack ();
+}
+
+// A reallocated block stays with the subsystem that first allocated it
+static void
+retrack (void *oldP, void *newP, size_t size, MemTag tag)
+{
+	MemBlock *block;
+
+	if (newP == NULL)
+		return;
+
+	lockTrack ();
+	block = oldP ? findBlock (oldP) : NULL;
+	if (block != NULL)
+	{
+		tag = block->tag;
+		uncount (block);
+	}
+	count (newP, size, tag);
+	unlockTrack ();
+}
+
+static MemTag
+lockedTagOfFile (const char *file)
+{
+	MemTag tag;
+
+	lockTrack ();
+	tag = tagOfFile (file);
+	unlockTrack ();
+	return tag;
+}
+
+void *
+MemTrack_HMalloc (size_t size, const char *file)
+{
+	void *p = HMalloc (size);
+	track (p, size, lockedTagOfFile (file));
+	return p;
+}
+
+void *
+MemTrack_HCalloc (size_t size, const char *file)
+{
+	void *p = HCalloc (size);
+	track (p, size, lockedTagOfFile (file));
+	return p;
+}
+
+void *
+MemTrack_HRealloc (void *p, size_t size, const char *file)
+{
+	void *newP;
+
+	if (size == 0)
+	{	// Frees the block
+		untrack (p);
+		return HRealloc (p, size);
+	}
+
+	newP = HRealloc (p, size);
+	retrack (p, newP, size, lockedTagOfFile (file));
+	return newP;
+}
+
+void
+MemTrack_HFree (void *p)
+{
+	untrack (p);
+	HFree (p);
+}
+
+void *
+MemTrack_malloc (size_t size, MemTag tag)
+{
+	void *p = malloc (size);
+	track (p, size, tag);
+	return p;
+}
+
+void *
+MemTrack_calloc (size_t count, size_t size, MemTag tag)
+{
+	void *p = calloc (count, size);
+	track (p, count * size, tag);
+	return p;
+}
+
+void *
+MemTrack_realloc (void *p, size_t size, MemTag tag)
+{
+	void *newP;
+
+	if (size == 0)
+	{
+		untrack (p);
+		return realloc (p, size);
+	}
+
+	newP = realloc (p, size);
+	retrack (p, newP, size, tag);
+	return newP;
+}
+
+void
+MemTrack_free (void *p)
+{
+	untrack (p);
+	free (p);
+}
+
+void
+MemTrack_report (void)
+{
+	MemTagStats snapshot[MEMTAG_COUNT];
+	MemTagStats total;
+	size_t peak;
+	size_t tracked;
+	TimeCount now = GetTimeCounter ();
+	double seconds;
+	COUNT i;
+
+	// Taken apart from the logging, which may allocate
+	lockTrack ();
+	memcpy (snapshot, stats, sizeof snapshot);
+	for (i = 0; i < MEMTAG_COUNT; ++i)
+		stats[i].reportedAllocs = stats[i].allocs;
+	peak = totalPeakBytes;
+	tracked = blocksSize * sizeof *blocks;
+	seconds = lastReport ? (double) (now - lastReport) / ONE_SECOND : 0.0;
+	lastReport = now;
+	unlockTrack ();
+
+	memset (&total, 0, sizeof total);
+	log_add (log_Info, "Heap use per subsystem:");
+	log_add (log_Info, "%-10s %10s %10s %9s %10s %9s", "", "live KB",
+			"peak KB", "blocks", "allocs", "allocs/s");
+	for (i = 0; i < MEMTAG_COUNT; ++i)
+	{
+		const MemTagStats *s = &snapshot[i];
+		DWORD recent = s->allocs - s->reportedAllocs;
+
+		log_add (log_Info, "%-10s %10lu %10lu %9lu %10lu %9.1f",
+				tagNames[i], (unsigned long) (s->liveBytes / 1024),
+				(unsigned long) (s->peakBytes / 1024),
+				(unsigned long) s->liveBlocks, (unsigned long) s->allocs,
+				seconds > 0.0 ? recent / seconds : 0.0);
+
+		total.liveBytes += s->liveBytes;
+		total.liveBlocks += s->liveBlocks;
+		total.allocs += s->allocs;
+		total.reportedAllocs += s->reportedAllocs;
+	}
+	log_add (log_Info, "%-10s %10lu %10lu %9lu %10lu %9.1f", "total",
+			(unsigned long) (total.liveBytes / 1024),
+			(unsigned long) (peak / 1024),
+			(unsigned long) total.liveBlocks, (unsigned long) total.allocs,
+			seconds > 0.0 ?
+			(total.allocs - total.reportedAllocs) / seconds : 0.0);
+	log_add (log_Info, "(the peak of the total is not the sum of the peaks; "
+			"the accounting itself uses %lu KB)",
+			(unsigned long) (tracked / 1024));
+	if (seconds == 0.0)
+		log_add (log_Info, "(allocations per second are given from the "
+				"next report on)");
+}
+
+#endif  /* TRACK_MEMORY */
@@ -722,6 +722,11 @@ extern MikMod_callback_t vc_callback;
 #endif
 
 /*========== SIMD mixing routines */
+/* UQM edit: build the SIMD mixers whenever the compiler supports them.
+ * They are only used when DMODE_SIMDMIXER is set (see modaud.c). */
+#ifndef MIKMOD_SIMD
+#define MIKMOD_SIMD
+#endif
 #undef HAVE_ALTIVEC
 #undef HAVE_SSE2
 #if defined(MIKMOD_SIMD)
@@ -261,6 +261,69 @@ static SINTPTR_T MixSIMDStereoNormal(const SWORD* srce,SLONG* dest,SINTPTR_T idx
 	}
 	return idx;
 }
+
+#if defined HAVE_SSE2
+/* UQM edit: the interpolating stereo mixer is what our music is played
+ * with. The interpolated sample always lies between its two neighbours,
+ * so it fits a SWORD and the result matches the plain C mixer exactly. */
+static __inline SWORD InterpSample(const SWORD* srce,SINTPTR_T idx)
+{
+	return (SWORD)((SLONG)srce[idx>>FRACBITS]+
+		((SLONG)(srce[(idx>>FRACBITS)+1]-srce[idx>>FRACBITS])
+		 *(idx&FRACMASK)>>FRACBITS));
+}
+
+static SINTPTR_T MixSIMDStereoInterp(const SWORD* srce,SLONG* dest,SINTPTR_T idx,SINTPTR_T increment,SINTPTR_T todo)
+{
+	SWORD lvol = vnf->lvolsel, rvol = vnf->rvolsel;
+	SWORD sample;
+	SINTPTR_T remain;
+	__m128i v0;
+
+	/* Dest can be misaligned */
+	while(todo && !IS_ALIGNED_16(dest)) {
+		sample=InterpSample(srce, idx);
+		idx += increment;
+		*dest++ += lvol * sample;
+		*dest++ += rvol * sample;
+		todo--;
+	}
+
+	remain = todo&3;
+	v0 = _mm_set_epi16(0, rvol, 0, lvol, 0, rvol, 0, lvol);
+	for(todo>>=2;todo; todo--)
+	{
+		SWORD s0, s1, s2, s3;
+		__m128i v1, v2, v3, v4;
+
+		s0 = InterpSample(srce, idx);
+		idx += increment;
+		s1 = InterpSample(srce, idx);
+		idx += increment;
+		s2 = InterpSample(srce, idx);
+		idx += increment;
+		s3 = InterpSample(srce, idx);
+		idx += increment;
+
+		v1 = _mm_set_epi16(0, s1, 0, s1, 0, s0, 0, s0);
+		v2 = _mm_set_epi16(0, s3, 0, s3, 0, s2, 0, s2);
+		v3 = _mm_load_si128((__m128i*)(dest+0));
+		v4 = _mm_load_si128((__m128i*)(dest+4));
+		_mm_store_si128((__m128i*)(dest+0), _mm_add_epi32(v3, _mm_madd_epi16(v0, v1)));
+		_mm_store_si128((__m128i*)(dest+4), _mm_add_epi32(v4, _mm_madd_epi16(v0, v2)));
+		dest+=8;
+	}
+
+	/* Remaining bits */
+	while(remain--) {
+		sample=InterpSample(srce, idx);
+		idx += increment;
+		*dest++ += lvol * sample;
+		*dest++ += rvol * sample;
+	}
+	return idx;
+}
+#endif /* HAVE_SSE2 */
 #endif
 
 /*========== 32 bit sample mixers - only for 32 bit platforms */
@@ -404,6 +467,10 @@ static SLONG Mix32StereoInterp(const SWORD* srce,SLONG* dest,SLONG idx,SLONG inc
 			return idx;
 	}
 
+#if defined HAVE_SSE2
+	if (md_mode & DMODE_SIMDMIXER)
+		return MixSIMDStereoInterp(srce, dest, idx, increment, todo);
+#endif
 	while(todo--) {
 		sample=(SLONG)srce[idx>>FRACBITS]+
 			((SLONG)(srce[(idx>>FRACBITS)+1]-srce[idx>>FRACBITS])
@@ -588,6 +655,10 @@ static SLONGLONG MixStereoInterp(const SWORD* srce,SLONG* dest,SLONGLONG idx,SLO
 			return idx;
 	}
 
+#if defined HAVE_SSE2 && defined NATIVE_64BIT_INT
+	if (md_mode & DMODE_SIMDMIXER)
+		return MixSIMDStereoInterp(srce, dest, idx, increment, todo);
+#endif
 	while(todo--) {
 		sample=(SLONG)srce[idx>>FRACBITS]+
 			((SLONG)(srce[(idx>>FRACBITS)+1]-srce[idx>>FRACBITS])
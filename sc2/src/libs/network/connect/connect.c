@@ -66,7 +66,11 @@ ConnectState_free(ConnectState *connectState) {
 
 static void
 ConnectState_delete(ConnectState *connectState) {
-	assert(connectState->nd == NULL);
+#ifndef NDEBUG
+	size_t i;
+	for (i = 0; i < CONNECT_MAX_ATTEMPTS; i++)
+		assert(connectState->attempts[i].nd == NULL);
+#endif
 	assert(connectState->alarm == NULL);
 	assert(connectState->info == NULL);
 	assert(connectState->infoPtr == NULL);
@@ -98,6 +102,49 @@ ConnectState_decRef(ConnectState *connectState) {
 	return false;
 }
 
+static void
+closeAttempt(ConnectAttempt *attempt) {
+	if (attempt->alarm != NULL) {
+		Alarm_remove(attempt->alarm);
+		attempt->alarm = NULL;
+	}
+	if (attempt->nd != NULL) {
+		NetDescriptor_close(attempt->nd);
+		attempt->nd = NULL;
+	}
+}
+
+static void
+closeAttempts(ConnectState *connectState) {
+	size_t i;
+
+	for (i = 0; i < CONNECT_MAX_ATTEMPTS; i++)
+		closeAttempt(&connectState->attempts[i]);
+}
+
+// Returns an attempt that is not in use, or NULL if there is none.
+static ConnectAttempt *
+getFreeAttempt(ConnectState *connectState) {
+	size_t i;
+
+	for (i = 0; i < CONNECT_MAX_ATTEMPTS; i++) {
+		if (connectState->attempts[i].nd == NULL)
+			return &connectState->attempts[i];
+	}
+	return NULL;
+}
+
+static bool
+haveAttempts(const ConnectState *connectState) {
+	size_t i;
+
+	for (i = 0; i < CONNECT_MAX_ATTEMPTS; i++) {
+		if (connectState->attempts[i].nd != NULL)
+			return true;
+	}
+	return false;
+}
+
 // decrements ref count by 1
 void
 ConnectState_close(ConnectState *connectState) {
@@ -109,10 +156,7 @@ ConnectState_close(ConnectState *connectState) {
 		Alarm_remove(connectState->alarm);
 		connectState->alarm = NULL;
 	}
-	if (connectState->nd != NULL) {
-		NetDescriptor_close(connectState->nd);
-		connectState->nd = NULL;
-	}
+	closeAttempts(connectState);
 	if (connectState->info != NULL) {
 		freeaddrinfo(connectState->info);
 		connectState->info = NULL;
@@ -135,13 +179,13 @@ ConnectState_getExtra(ConnectState *connectState) {
 static void
 connectCallback(NetDescriptor *nd) {
 	// Called by the NetManager when a connection has been established.
-	ConnectState *connectState =
-			(ConnectState *) NetDescriptor_getExtra(nd);
+	ConnectAttempt *attempt = (ConnectAttempt *) NetDescriptor_getExtra(nd);
+	ConnectState *connectState = attempt->connectState;
 	int err;
 
-	if (connectState->alarm != NULL) {
-		Alarm_remove(connectState->alarm);
-		connectState->alarm = NULL;
+	if (attempt->alarm != NULL) {
+		Alarm_remove(attempt->alarm);
+		attempt->alarm = NULL;
 	}
 
 	if (connectState->state == Connect_closed) {
@@ -163,8 +207,7 @@ connectCallback(NetDescriptor *nd) {
 		log_add(log_Debug, "connect() failed: %s.", strerror(err));
 #endif
 		NetDescriptor_close(nd);
-		connectState->nd = NULL;
-		connectState->infoPtr = connectState->infoPtr->ai_next;
+		attempt->nd = NULL;
 		connectHostNext(connectState);
 		return;
 	}
@@ -174,16 +217,24 @@ connectCallback(NetDescriptor *nd) {
 #endif
 
 	// Notify the higher layer.
-	connectState->nd = NULL;
+	attempt->nd = NULL;
 			// The callback function takes over ownership of the
 			// NetDescriptor.
 	NetDescriptor_setWriteCallback(nd, NULL);
+	NetDescriptor_setExtra(nd, (void *) connectState);
+
+	// The attempts to the other addresses are not needed any more.
+	closeAttempts(connectState);
+	if (connectState->alarm != NULL) {
+		Alarm_remove(connectState->alarm);
+		connectState->alarm = NULL;
+	}
 	// Note that connectState->info and connectState->infoPtr are cleaned up
 	// when ConnectState_close() is called by the callback function.
 	
 	ConnectState_incRef(connectState);
-	doConnectCallback(connectState, nd, connectState->infoPtr->ai_addr,
-			connectState->infoPtr->ai_addrlen);
+	doConnectCallback(connectState, nd, attempt->info->ai_addr,
+			attempt->info->ai_addrlen);
 	{
 		// The callback called should release the last reference to
 		// the connectState, by calling ConnectState_close().
@@ -194,36 +245,30 @@ connectCallback(NetDescriptor *nd) {
 }
 
 static void
-connectTimeoutCallback(ConnectState *connectState) {
-	connectState->alarm = NULL;
+connectTimeoutCallback(ConnectAttempt *attempt) {
+	attempt->alarm = NULL;
 
-	NetDescriptor_close(connectState->nd);
-	connectState->nd = NULL;
+	NetDescriptor_close(attempt->nd);
+	attempt->nd = NULL;
 
-	connectState->infoPtr = connectState->infoPtr->ai_next;
-	connectHostNext(connectState);
+	connectHostNext(attempt->connectState);
 }
 
 static void
-setConnectTimeout(ConnectState *connectState) {
-	assert(connectState->alarm == NULL);
+setConnectTimeout(ConnectAttempt *attempt) {
+	assert(attempt->alarm == NULL);
 
-	connectState->alarm =
-			Alarm_addRelativeMs(connectState->flags.timeout,
-			(AlarmCallback) connectTimeoutCallback, connectState);
+	attempt->alarm =
+			Alarm_addRelativeMs(attempt->connectState->flags.timeout,
+			(AlarmCallback) connectTimeoutCallback, attempt);
 }
 
-// Try connecting to the next address.
+// Try connecting to an address.
 static Socket *
-tryConnectHostNext(ConnectState *connectState) {
-	struct addrinfo *info;
+tryConnectHost(const struct addrinfo *info) {
 	Socket *sock;
 	int connectResult;
 
-	assert(connectState->nd == NULL);
-
-	info = connectState->infoPtr;
-
 	sock = Socket_openNative(info->ai_family, info->ai_socktype,
 			info->ai_protocol);
 	if (sock == Socket_noSocket) {
@@ -280,6 +325,22 @@ tryConnectHostNext(ConnectState *connectState) {
 	return Socket_noSocket;
 }
 
+static void
+connectDelayCallback(ConnectState *connectState) {
+	connectState->alarm = NULL;
+
+	connectHostNext(connectState);
+}
+
+static void
+setConnectDelayAlarm(ConnectState *connectState) {
+	assert(connectState->alarm == NULL);
+
+	connectState->alarm =
+			Alarm_addRelativeMs(CONNECT_ATTEMPT_DELAY_MS,
+			(AlarmCallback) connectDelayCallback, connectState);
+}
+
 static void
 connectRetryCallback(ConnectState *connectState) {
 	connectState->alarm = NULL;
@@ -316,40 +377,70 @@ connectHostReportAllFailed(ConnectState *connectState) {
 	doConnectErrorCallback(connectState, &error);
 }
 
+// Starts a connection attempt to the next address that does not fail
+// right away. The address after that is tried when an attempt fails, or
+// after CONNECT_ATTEMPT_DELAY_MS when none has succeeded by then, so a
+// dead address does not hold up the others for the whole timeout
+// ("Happy Eyeballs", RFC 8305).
 static void
 connectHostNext(ConnectState *connectState) {
-	Socket *sock;
+	if (connectState->alarm != NULL) {
+		// The next address is tried now, instead of after the delay.
+		Alarm_remove(connectState->alarm);
+		connectState->alarm = NULL;
+	}
 
 	while (connectState->infoPtr != NULL) {
-		sock = tryConnectHostNext(connectState);
-
-		if (sock != Socket_noSocket) {
-			// Connection succeeded or connection in progress
-			connectState->nd =
-					NetDescriptor_new(sock, (void *) connectState);
-			if (connectState->nd == NULL) {
-				ConnectError error;
-				int savedErrno = errno;
-
-				log_add(log_Error, "NetDescriptor_new() failed: %s.",
-						strerror(errno));
-				Socket_close(sock);
-				freeaddrinfo(connectState->info);
-				connectState->info = NULL;
-				connectState->infoPtr = NULL;
-				connectState->state = Connect_closed;
-				error.state = Connect_connecting;
-				error.err = savedErrno;
-				doConnectErrorCallback(connectState, &error);
-				return;
-			}
-
-			NetDescriptor_setWriteCallback(connectState->nd, connectCallback);
-			setConnectTimeout(connectState);
+		ConnectAttempt *attempt;
+		struct addrinfo *info;
+		Socket *sock;
+
+		attempt = getFreeAttempt(connectState);
+		if (attempt == NULL) {
+			// As many attempts as allowed are in progress. The next
+			// address is tried when one of them fails.
+			return;
+		}
+
+		info = connectState->infoPtr;
+		connectState->infoPtr = info->ai_next;
+
+		sock = tryConnectHost(info);
+		if (sock == Socket_noSocket)
+			continue;
+
+		// Connection succeeded or connection in progress
+		attempt->nd = NetDescriptor_new(sock, (void *) attempt);
+		if (attempt->nd == NULL) {
+			ConnectError error;
+			int savedErrno = errno;
+
+			log_add(log_Error, "NetDescriptor_new() failed: %s.",
+					strerror(errno));
+			Socket_close(sock);
+			closeAttempts(connectState);
+			freeaddrinfo(connectState->info);
+			connectState->info = NULL;
+			connectState->infoPtr = NULL;
+			connectState->state = Connect_closed;
+			error.state = Connect_connecting;
+			error.err = savedErrno;
+			doConnectErrorCallback(connectState, &error);
 			return;
 		}
+		attempt->connectState = connectState;
+		attempt->info = info;
 
-		connectState->infoPtr = connectState->infoPtr->ai_next;
+		NetDescriptor_setWriteCallback(attempt->nd, connectCallback);
+		setConnectTimeout(attempt);
+		if (connectState->infoPtr != NULL)
+			setConnectDelayAlarm(connectState);
+		return;
+	}
+
+	if (haveAttempts(connectState)) {
+		// No more addresses to try; wait for the attempts in progress.
+		return;
 	}
 
 	// Connect failed to all addresses.
@@ -362,6 +453,38 @@ connectHostNext(ConnectState *connectState) {
 	setConnectRetryAlarm(connectState);
 }
 
+// Reorders 'info' so that the address families take turns, starting with
+// 'family'. When the addresses of one family cannot be reached, the
+// staggered attempts then still get to the other family soon.
+static struct addrinfo *
+interleaveAddrInfoFamilies(struct addrinfo *info, int family) {
+	struct addrinfo *first;
+	struct addrinfo **firstEnd;
+	struct addrinfo *rest;
+	struct addrinfo **restEnd;
+	struct addrinfo *result;
+	struct addrinfo **resultEnd;
+
+	splitAddrInfoOnFamily(info, family, &first, &firstEnd, &rest, &restEnd);
+
+	resultEnd = &result;
+	while (first != NULL || rest != NULL) {
+		if (first != NULL) {
+			*resultEnd = first;
+			resultEnd = &first->ai_next;
+			first = first->ai_next;
+		}
+		if (rest != NULL) {
+			*resultEnd = rest;
+			resultEnd = &rest->ai_next;
+			rest = rest->ai_next;
+		}
+	}
+	*resultEnd = NULL;
+
+	return result;
+}
+
 static void
 connectHostResolveCallback(ResolveState *resolveState,
 		struct addrinfo *info) {
@@ -373,17 +496,15 @@ connectHostResolveCallback(ResolveState *resolveState,
 	Resolve_close(resolveState);
 	connectState->resolveState = NULL;
 
-	if (connectState->flags.familyPrefer != PF_UNSPEC) {
-		// Reorganise the 'info' list to put the structures of the
-		// prefered family in front.
-		struct addrinfo *preferred;
-		struct addrinfo **preferredEnd;
-		struct addrinfo *rest;
-		struct addrinfo **restEnd;
-		splitAddrInfoOnFamily(info, connectState->flags.familyPrefer,
-				&preferred, &preferredEnd, &rest, &restEnd);
-		info = preferred;
-		*preferredEnd = rest;
+	if (info != NULL) {
+		// Start with the prefered family, or else with the one the
+		// resolver put first.
+		int family = info->ai_family;
+		if (connectState->flags.familyPrefer != PF_unspec) {
+			family = protocolFamilyTranslation[
+					connectState->flags.familyPrefer];
+		}
+		info = interleaveAddrInfoFamilies(info, family);
 	}
 
 	connectState->info = info;
@@ -418,6 +539,7 @@ connectHostByName(const char *host, const char *service, Protocol proto,
 	ConnectState *connectState;
 	ResolveFlags resolveFlags;
 			// Structure is empty (for now).
+	size_t i;
 
 	assert(flags->familyDemand == PF_inet ||
 			flags->familyDemand == PF_inet6 ||
@@ -452,7 +574,12 @@ connectHostByName(const char *host, const char *service, Protocol proto,
 	connectState->extra = extra;
 	connectState->info = NULL;
 	connectState->infoPtr = NULL;
-	connectState->nd = NULL;
+	for (i = 0; i < CONNECT_MAX_ATTEMPTS; i++) {
+		connectState->attempts[i].connectState = connectState;
+		connectState->attempts[i].info = NULL;
+		connectState->attempts[i].nd = NULL;
+		connectState->attempts[i].alarm = NULL;
+	}
 	connectState->alarm = NULL;
 	
 	connectState->resolveState = getaddrinfoAsync(
@@ -47,7 +47,9 @@ struct ConnectFlags {
 	int timeout;
 			/* Number of milliseconds before timing out a connection attempt.
 			 * Note that if a host has multiple addresses, a connect to that
-			 * host will have this timeout *per address*. */
+			 * host will have this timeout *per address*. Attempts to
+			 * further addresses are started while earlier ones are still
+			 * in progress though; see CONNECT_ATTEMPT_DELAY_MS. */
 	int retryDelayMs;
 			/* Retry connecting this many ms after connecting to the last
 			 * address for the specified host fails. Set to Connect_noRetry
@@ -74,6 +76,24 @@ typedef void (*ConnectErrorCallback)(ConnectState *connectState,
 
 #include "libs/alarm.h"
 
+#define CONNECT_MAX_ATTEMPTS 4
+		// Connection attempts to different addresses of a host that may
+		// be in progress at the same time.
+#define CONNECT_ATTEMPT_DELAY_MS 250
+		// Time after starting a connection attempt before the next
+		// address is tried too, unless the attempt fails sooner.
+
+typedef struct ConnectAttempt ConnectAttempt;
+struct ConnectAttempt {
+	ConnectState *connectState;
+	struct addrinfo *info;
+			// The address being connected to.
+	NetDescriptor *nd;
+			// NULL if this attempt is not in use.
+	Alarm *alarm;
+			// The timeout for this attempt.
+};
+
 struct ConnectState {
 	RefCount refCount;
 
@@ -86,13 +106,15 @@ struct ConnectState {
 
 	struct addrinfo *info;
 	struct addrinfo *infoPtr;
+			// The next address to try.
 
 	ResolveState *resolveState;
 
-	NetDescriptor *nd;
+	ConnectAttempt attempts[CONNECT_MAX_ATTEMPTS];
 	Alarm *alarm;
-			// Used for both the timeout for a connection attempt
-			// and to retry after all addresses have been tried.
+			// Used for both starting the attempt to the next address
+			// while others are in progress, and to retry after all
+			// addresses have been tried.
 };
 #endif  /* CONNECT_INTERNAL */
 
@@ -19,15 +19,17 @@
 #define RESOLVE_INTERNAL
 #include "resolve.h"
 
+#include "libs/threadlib.h"
+
 #include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define DEBUG_RESOLVE_REF
 #ifdef DEBUG_RESOLVE_REF
 #	include "types.h"
 #	include "libs/log.h"
-#	include <string.h>
 #endif
 
 static ResolveState *
@@ -42,7 +44,9 @@ ResolveState_free(ResolveState *resolveState) {
 
 static void
 ResolveState_delete(ResolveState *resolveState) {
-	assert(resolveState->callbackID == CallbackID_invalid);
+	assert(!resolveState->threadBusy);
+	free(resolveState->node);
+	free(resolveState->service);
 	ResolveState_free(resolveState);
 }
 
@@ -103,9 +107,26 @@ doResolveErrorCallback(ResolveState *resolveState) {
 	}
 }
 
+// Called through the callback queue, on the thread that processes it,
+// once the lookup thread is done.
 static void
 resolveCallback(ResolveState *resolveState) {
-	resolveState->callbackID = CallbackID_invalid;
+	resolveState->threadBusy = false;
+
+	if (resolveState->state == Resolve_closed) {
+		// Nobody is interested in the result any more.
+		if (resolveState->result != NULL) {
+			freeaddrinfo(resolveState->result);
+			resolveState->result = NULL;
+		}
+		ResolveState_decRef(resolveState);
+		return;
+	}
+
+	// Drop the reference of the lookup thread. The one of the owner
+	// remains, until it calls Resolve_close() from the callback.
+	(void) ResolveState_decRef(resolveState);
+
 	if (resolveState->error.gaiRes == 0) {
 		// Successful lookup.
 		doResolveCallback(resolveState);
@@ -115,10 +136,41 @@ resolveCallback(ResolveState *resolveState) {
 	}
 }
 
+// getaddrinfo() blocks, for as long as the DNS servers take to answer,
+// so it is called from a thread of its own. Nothing but the result fields
+// of the ResolveState are touched here; the result is handed back
+// through the callback queue, which may be added to from any thread.
+static int
+resolveThreadFunc(void *arg) {
+	ResolveState *resolveState = (ResolveState *) arg;
+
+	resolveState->error.gaiRes = getaddrinfo(resolveState->node,
+			resolveState->service, &resolveState->hints,
+			&resolveState->result);
+	resolveState->error.err = errno;
+
+	(void) Callback_add((CallbackFunction) resolveCallback,
+			(CallbackArg) resolveState);
+	return 0;
+}
+
+static char *
+copyString(const char *str) {
+	char *copy;
+	size_t len;
+
+	if (str == NULL)
+		return NULL;
+
+	len = strlen(str) + 1;
+	copy = (char *) malloc(len);
+	memcpy(copy, str, len);
+	return copy;
+}
+
 // Function that does getaddrinfo() and calls the callback function when
-// the result is available.
-// TODO: actually make this function asynchronous. Right now it just calls
-// getaddrinfo() (which blocks) and then schedules the callback.
+// the result is available. The lookup runs on a thread of its own, so
+// this returns right away.
 ResolveState *
 getaddrinfoAsync(const char *node, const char *service,
 		const struct addrinfo *hints, ResolveFlags *flags,
@@ -127,9 +179,10 @@ getaddrinfoAsync(const char *node, const char *service,
 	ResolveState *resolveState;
 
 	resolveState = ResolveState_new();
-	resolveState->refCount = 1;
+	resolveState->refCount = 2;
+			// One for the caller, one for the lookup thread.
 #ifdef DEBUG_RESOLVE_REF
-	log_add(log_Debug, "ResolveState %08" PRIxPTR ": ref=1 (%d)",
+	log_add(log_Debug, "ResolveState %08" PRIxPTR ": ref=2 (%d)",
 			(uintptr_t) resolveState, resolveState->refCount);
 #endif
 	resolveState->state = Resolve_resolving;
@@ -137,24 +190,27 @@ getaddrinfoAsync(const char *node, const char *service,
 	resolveState->callback = callback;
 	resolveState->errorCallback = errorCallback;
 	resolveState->extra = extra;
+	resolveState->node = copyString(node);
+	resolveState->service = copyString(service);
+	memset(&resolveState->hints, '\0', sizeof resolveState->hints);
+	resolveState->hints.ai_flags = hints->ai_flags;
+	resolveState->hints.ai_family = hints->ai_family;
+	resolveState->hints.ai_socktype = hints->ai_socktype;
+	resolveState->hints.ai_protocol = hints->ai_protocol;
+	resolveState->threadBusy = true;
+	resolveState->error.gaiRes = 0;
+	resolveState->error.err = 0;
 	resolveState->result = NULL;
-	
-	resolveState->error.gaiRes =
-			getaddrinfo(node, service, hints, &resolveState->result);
-	resolveState->error.err = errno;
 
-	resolveState->callbackID = Callback_add(
-			(CallbackFunction) resolveCallback, (CallbackArg) resolveState);
+	StartThread(resolveThreadFunc, resolveState, 0, "resolver");
 
 	return resolveState;
 }
 
+// The callbacks will not be called after this. A lookup that is still
+// going on is left to finish; its result is thrown away.
 void
 Resolve_close(ResolveState *resolveState) {
-	if (resolveState->callbackID != CallbackID_invalid) {
-		Callback_remove(resolveState->callbackID);
-		resolveState->callbackID = CallbackID_invalid;
-	}
 	resolveState->state = Resolve_closed;
 	ResolveState_decRef(resolveState);
 }
@@ -83,7 +83,13 @@ struct ResolveState {
 	ResolveErrorCallback errorCallback;
 	void *extra;
 
-	CallbackID callbackID;
+	char *node;
+	char *service;
+	struct addrinfo hints;
+			// Copies of the arguments, for the lookup thread.
+	bool threadBusy;
+			// The lookup thread has not reported back yet. It holds a
+			// reference until it does.
 	ResolveError error;
 	struct addrinfo *result;
 };
@@ -0,0 +1,260 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// The NetManager using epoll(), for Linux. The same as netmanager_bsd.c,
+// but the kernel keeps the set of descriptors to watch, instead of it
+// being passed to select() as a whole on each call, and there is no
+// FD_SETSIZE limit.
+// Read, write and exception callbacks are mapped to EPOLLIN, EPOLLOUT and
+// EPOLLPRI. As with select(), an error or hangup wakes up the read and
+// write callbacks, which will find out about it when they use the socket.
+
+#define SOCKET_INTERNAL
+#define NETDESCRIPTOR_INTERNAL
+#define NDINDEX_DYNAMIC
+#include "netmanager_bsd.h"
+#include "ndesc.h"
+#include "../socket/socket.h"
+
+#include "types.h"
+#include "libs/log.h"
+#include "libs/misc.h"
+		// for explode()
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+
+#include "netmanager_common.ci"
+#include "ndindex.ci"
+
+#define NETMANAGER_MAX_EVENTS 64
+		// Events handled per epoll_wait() call.
+
+struct SocketManagementDataBsd {
+	uint32 events;
+			// The EPOLL* events asked for.
+};
+
+static int epollFd = -1;
+
+
+void
+NetManager_init(void) {
+	NDIndex_init();
+
+	epollFd = epoll_create(NETMANAGER_MAX_EVENTS);
+			// The size is only a hint.
+	if (epollFd == -1) {
+		log_add(log_Fatal, "epoll_create() failed: %s.", strerror(errno));
+		explode();
+	}
+}
+
+void
+NetManager_uninit(void) {
+	if (epollFd != -1) {
+		close(epollFd);
+		epollFd = -1;
+	}
+	NDIndex_uninit();
+}
+
+static int
+NetManager_epollCtl(NetDescriptor *nd, int op) {
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof event);
+	event.events = nd->smd->events;
+	event.data.fd = nd->socket->fd;
+	return epoll_ctl(epollFd, op, nd->socket->fd, &event);
+}
+
+static void
+NetManager_setEvents(NetDescriptor *nd, uint32 events, bool on) {
+	uint32 newEvents = on ? (nd->smd->events | events) :
+			(nd->smd->events & ~events);
+
+	if (newEvents == nd->smd->events)
+		return;
+	nd->smd->events = newEvents;
+	if (NetManager_epollCtl(nd, EPOLL_CTL_MOD) == -1) {
+		log_add(log_Error, "epoll_ctl() failed: %s.", strerror(errno));
+	}
+}
+
+// Register the NetDescriptor with the NetManager.
+int
+NetManager_addDesc(NetDescriptor *nd) {
+	SocketManagementData *smd;
+
+	assert(nd->socket != Socket_noSocket);
+	assert(!NDIndex_socketRegistered(nd->socket));
+
+	if (NDIndex_registerNDWithSocket(nd->socket, nd) == -1) {
+		// errno is set
+		return -1;
+	}
+
+	smd = malloc(sizeof (SocketManagementData));
+	smd->events = 0;
+	if (nd->readCallback != NULL)
+		smd->events |= EPOLLIN;
+	if (nd->writeCallback != NULL)
+		smd->events |= EPOLLOUT;
+	if (nd->exceptionCallback != NULL)
+		smd->events |= EPOLLPRI;
+	nd->smd = smd;
+
+	if (NetManager_epollCtl(nd, EPOLL_CTL_ADD) == -1) {
+		int savedErrno = errno;
+		nd->smd = NULL;
+		free(smd);
+		NDIndex_unregisterNDForSocket(nd->socket);
+		errno = savedErrno;
+		return -1;
+	}
+	return 0;
+}
+
+void
+NetManager_removeDesc(NetDescriptor *nd) {
+	assert(nd->socket != Socket_noSocket);
+	assert(NDIndex_getNDForSocket(nd->socket) == nd);
+
+	(void) NetManager_epollCtl(nd, EPOLL_CTL_DEL);
+			// The socket may not be closed right away
+			// (NetDescriptor_detach()).
+	free(nd->smd);
+	nd->smd = NULL;
+
+	NDIndex_unregisterNDForSocket(nd->socket);
+}
+
+void
+NetManager_activateReadCallback(NetDescriptor *nd) {
+	NetManager_setEvents(nd, EPOLLIN, true);
+}
+
+void
+NetManager_deactivateReadCallback(NetDescriptor *nd) {
+	NetManager_setEvents(nd, EPOLLIN, false);
+}
+
+void
+NetManager_activateWriteCallback(NetDescriptor *nd) {
+	NetManager_setEvents(nd, EPOLLOUT, true);
+}
+
+void
+NetManager_deactivateWriteCallback(NetDescriptor *nd) {
+	NetManager_setEvents(nd, EPOLLOUT, false);
+}
+
+void
+NetManager_activateExceptionCallback(NetDescriptor *nd) {
+	NetManager_setEvents(nd, EPOLLPRI, true);
+}
+
+void
+NetManager_deactivateExceptionCallback(NetDescriptor *nd) {
+	NetManager_setEvents(nd, EPOLLPRI, false);
+}
+
+static uint32
+msSince(const struct timeval *start) {
+	struct timeval now;
+	long ms;
+
+	gettimeofday(&now, NULL);
+	ms = (now.tv_sec - start->tv_sec) * 1000 +
+			(now.tv_usec - start->tv_usec) / 1000;
+	return ms < 0 ? 0 : (uint32) ms;
+}
+
+// This function may be called again from inside a callback function
+// triggered by this function. BUG: This may result in callbacks being
+// called multiple times.
+// This function should however not be called from multiple threads at once.
+int
+NetManager_process(uint32 *timeoutMs) {
+	struct epoll_event events[NETMANAGER_MAX_EVENTS];
+	struct timeval start;
+	uint32 elapsed;
+	int numEvents;
+	int i;
+
+	gettimeofday(&start, NULL);
+	for (;;) {
+		elapsed = msSince(&start);
+		if (elapsed > *timeoutMs)
+			elapsed = *timeoutMs;
+		numEvents = epoll_wait(epollFd, events, NETMANAGER_MAX_EVENTS,
+				(int) (*timeoutMs - elapsed));
+		if (numEvents != -1 || errno != EINTR)
+			break;
+		// Interrupted; wait for the rest of the time.
+	}
+	if (numEvents == -1) {
+		int savedErrno = errno;
+		log_add(log_Error, "epoll_wait() failed: %s.", strerror(errno));
+		errno = savedErrno;
+		elapsed = msSince(&start);
+		*timeoutMs = elapsed >= *timeoutMs ? 0 : *timeoutMs - elapsed;
+		return -1;
+	}
+
+	for (i = 0; i < numEvents; i++) {
+		uint32 happened = events[i].events;
+		NetDescriptor *nd;
+
+		// A callback may cause a NetDescriptor to be closed, or even
+		// another one to be opened on the same fd. The index is checked
+		// again for every event so that one that is closed is skipped.
+		// An event for a new one may be spurious, as with select().
+
+		nd = NDIndex_findNDForSocketFd(events[i].data.fd);
+		if (nd == NULL)
+			continue;
+
+		if ((happened & EPOLLPRI) &&
+				(nd->smd->events & EPOLLPRI) && nd->exceptionCallback) {
+			if (NetManager_doExceptionCallback(nd))
+				continue;
+		}
+
+		if ((happened & (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
+				(nd->smd->events & EPOLLOUT) && nd->writeCallback) {
+			if (NetManager_doWriteCallback(nd))
+				continue;
+		}
+
+		if ((happened & (EPOLLIN | EPOLLERR | EPOLLHUP)) &&
+				(nd->smd->events & EPOLLIN) && nd->readCallback) {
+			if (NetManager_doReadCallback(nd))
+				continue;
+		}
+	}
+
+	elapsed = msSince(&start);
+	*timeoutMs = elapsed >= *timeoutMs ? 0 : *timeoutMs - elapsed;
+	return 0;
+}
+
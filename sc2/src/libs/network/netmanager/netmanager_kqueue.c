@@ -0,0 +1,310 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// The NetManager using kqueue(), for the BSDs and MacOS X. The same as
+// netmanager_bsd.c, but the kernel keeps the set of descriptors to watch,
+// instead of it being passed to select() as a whole on each call, and
+// there is no FD_SETSIZE limit.
+// Read and write callbacks are mapped to the EVFILT_READ and EVFILT_WRITE
+// filters. Exception callbacks use EVFILT_EXCEPT with NOTE_OOB where there
+// is such a filter.
+
+#define SOCKET_INTERNAL
+#define NETDESCRIPTOR_INTERNAL
+#define NDINDEX_DYNAMIC
+#include "netmanager_bsd.h"
+#include "ndesc.h"
+#include "../socket/socket.h"
+
+#include "types.h"
+#include "libs/log.h"
+#include "libs/misc.h"
+		// for explode()
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+
+#include "netmanager_common.ci"
+#include "ndindex.ci"
+
+#define NETMANAGER_MAX_EVENTS 64
+		// Events handled per kevent() call.
+
+#define FILTER_READ      0x1
+#define FILTER_WRITE     0x2
+#define FILTER_EXCEPTION 0x4
+
+struct SocketManagementDataBsd {
+	int filters;
+			// The FILTER_* bits for the filters added.
+};
+
+static int kqueueFd = -1;
+
+
+void
+NetManager_init(void) {
+	NDIndex_init();
+
+	kqueueFd = kqueue();
+	if (kqueueFd == -1) {
+		log_add(log_Fatal, "kqueue() failed: %s.", strerror(errno));
+		explode();
+	}
+}
+
+void
+NetManager_uninit(void) {
+	if (kqueueFd != -1) {
+		close(kqueueFd);
+		kqueueFd = -1;
+	}
+	NDIndex_uninit();
+}
+
+// Adds or deletes the kqueue filter for one of the FILTER_* bits.
+// Returns -1 and sets errno on failure.
+static int
+NetManager_changeFilter(NetDescriptor *nd, int filter, bool on) {
+	struct kevent change;
+	short kFilter;
+	u_int fflags = 0;
+
+	switch (filter) {
+		case FILTER_READ:
+			kFilter = EVFILT_READ;
+			break;
+		case FILTER_WRITE:
+			kFilter = EVFILT_WRITE;
+			break;
+		case FILTER_EXCEPTION:
+#if defined(EVFILT_EXCEPT) && defined(NOTE_OOB)
+			kFilter = EVFILT_EXCEPT;
+			fflags = NOTE_OOB;
+			break;
+#else
+			// XXX: No out-of-band notification here. Nothing uses
+			//      exception callbacks at the moment.
+			return 0;
+#endif
+		default:
+			assert(false);
+			return 0;
+	}
+
+	EV_SET(&change, nd->socket->fd, kFilter, on ? EV_ADD : EV_DELETE,
+			fflags, 0, NULL);
+	return kevent(kqueueFd, &change, 1, NULL, 0, NULL);
+}
+
+static void
+NetManager_setFilter(NetDescriptor *nd, int filter, bool on) {
+	if (((nd->smd->filters & filter) != 0) == on)
+		return;
+
+	if (NetManager_changeFilter(nd, filter, on) == -1) {
+		log_add(log_Error, "kevent() failed: %s.", strerror(errno));
+		return;
+	}
+	if (on)
+		nd->smd->filters |= filter;
+	else
+		nd->smd->filters &= ~filter;
+}
+
+// Register the NetDescriptor with the NetManager.
+int
+NetManager_addDesc(NetDescriptor *nd) {
+	SocketManagementData *smd;
+
+	assert(nd->socket != Socket_noSocket);
+	assert(!NDIndex_socketRegistered(nd->socket));
+
+	if (NDIndex_registerNDWithSocket(nd->socket, nd) == -1) {
+		// errno is set
+		return -1;
+	}
+
+	smd = malloc(sizeof (SocketManagementData));
+	smd->filters = 0;
+	nd->smd = smd;
+
+	if (nd->readCallback != NULL)
+		NetManager_setFilter(nd, FILTER_READ, true);
+	if (nd->writeCallback != NULL)
+		NetManager_setFilter(nd, FILTER_WRITE, true);
+	if (nd->exceptionCallback != NULL)
+		NetManager_setFilter(nd, FILTER_EXCEPTION, true);
+	return 0;
+}
+
+void
+NetManager_removeDesc(NetDescriptor *nd) {
+	assert(nd->socket != Socket_noSocket);
+	assert(NDIndex_getNDForSocket(nd->socket) == nd);
+
+	// The socket may not be closed right away (NetDescriptor_detach()),
+	// so the filters are removed explicitly.
+	if (nd->smd->filters & FILTER_READ)
+		(void) NetManager_changeFilter(nd, FILTER_READ, false);
+	if (nd->smd->filters & FILTER_WRITE)
+		(void) NetManager_changeFilter(nd, FILTER_WRITE, false);
+	if (nd->smd->filters & FILTER_EXCEPTION)
+		(void) NetManager_changeFilter(nd, FILTER_EXCEPTION, false);
+	free(nd->smd);
+	nd->smd = NULL;
+
+	NDIndex_unregisterNDForSocket(nd->socket);
+}
+
+void
+NetManager_activateReadCallback(NetDescriptor *nd) {
+	NetManager_setFilter(nd, FILTER_READ, true);
+}
+
+void
+NetManager_deactivateReadCallback(NetDescriptor *nd) {
+	NetManager_setFilter(nd, FILTER_READ, false);
+}
+
+void
+NetManager_activateWriteCallback(NetDescriptor *nd) {
+	NetManager_setFilter(nd, FILTER_WRITE, true);
+}
+
+void
+NetManager_deactivateWriteCallback(NetDescriptor *nd) {
+	NetManager_setFilter(nd, FILTER_WRITE, false);
+}
+
+void
+NetManager_activateExceptionCallback(NetDescriptor *nd) {
+	NetManager_setFilter(nd, FILTER_EXCEPTION, true);
+}
+
+void
+NetManager_deactivateExceptionCallback(NetDescriptor *nd) {
+	NetManager_setFilter(nd, FILTER_EXCEPTION, false);
+}
+
+static uint32
+msSince(const struct timeval *start) {
+	struct timeval now;
+	long ms;
+
+	gettimeofday(&now, NULL);
+	ms = (now.tv_sec - start->tv_sec) * 1000 +
+			(now.tv_usec - start->tv_usec) / 1000;
+	return ms < 0 ? 0 : (uint32) ms;
+}
+
+// This function may be called again from inside a callback function
+// triggered by this function. BUG: This may result in callbacks being
+// called multiple times.
+// This function should however not be called from multiple threads at once.
+int
+NetManager_process(uint32 *timeoutMs) {
+	struct kevent events[NETMANAGER_MAX_EVENTS];
+	struct timeval start;
+	struct timespec timeout;
+	uint32 elapsed;
+	uint32 left;
+	int numEvents;
+	int i;
+
+	gettimeofday(&start, NULL);
+	for (;;) {
+		elapsed = msSince(&start);
+		left = elapsed >= *timeoutMs ? 0 : *timeoutMs - elapsed;
+		timeout.tv_sec = left / 1000;
+		timeout.tv_nsec = (long) (left % 1000) * 1000000;
+		numEvents = kevent(kqueueFd, NULL, 0, events, NETMANAGER_MAX_EVENTS,
+				&timeout);
+		if (numEvents != -1 || errno != EINTR)
+			break;
+		// Interrupted; wait for the rest of the time.
+	}
+	if (numEvents == -1) {
+		int savedErrno = errno;
+		log_add(log_Error, "kevent() failed: %s.", strerror(errno));
+		errno = savedErrno;
+		elapsed = msSince(&start);
+		*timeoutMs = elapsed >= *timeoutMs ? 0 : *timeoutMs - elapsed;
+		return -1;
+	}
+
+	// Each filter gives its own event. To call the callbacks of a
+	// descriptor in the same order as netmanager_bsd.c does, exception
+	// events go first, then write, then read.
+	{
+		static const short order[] = {
+#if defined(EVFILT_EXCEPT) && defined(NOTE_OOB)
+			EVFILT_EXCEPT,
+#endif
+			EVFILT_WRITE, EVFILT_READ
+		};
+		size_t pass;
+
+		for (pass = 0; pass < sizeof order / sizeof order[0]; pass++) {
+			for (i = 0; i < numEvents; i++) {
+				NetDescriptor *nd;
+
+				if (events[i].filter != order[pass])
+					continue;
+
+				// A callback may cause a NetDescriptor to be closed, or
+				// even another one to be opened on the same fd. The index
+				// is checked again for every event so that one that is
+				// closed is skipped. An event for a new one may be
+				// spurious, as with select().
+				nd = NDIndex_findNDForSocketFd((int) events[i].ident);
+				if (nd == NULL)
+					continue;
+
+				switch (events[i].filter) {
+#if defined(EVFILT_EXCEPT) && defined(NOTE_OOB)
+					case EVFILT_EXCEPT:
+						if ((nd->smd->filters & FILTER_EXCEPTION) &&
+								nd->exceptionCallback)
+							(void) NetManager_doExceptionCallback(nd);
+						break;
+#endif
+					case EVFILT_WRITE:
+						if ((nd->smd->filters & FILTER_WRITE) &&
+								nd->writeCallback)
+							(void) NetManager_doWriteCallback(nd);
+						break;
+					case EVFILT_READ:
+						if ((nd->smd->filters & FILTER_READ) &&
+								nd->readCallback)
+							(void) NetManager_doReadCallback(nd);
+						break;
+				}
+			}
+		}
+	}
+
+	elapsed = msSince(&start);
+	*timeoutMs = elapsed >= *timeoutMs ? 0 : *timeoutMs - elapsed;
+	return 0;
+}
+
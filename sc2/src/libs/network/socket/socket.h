@@ -86,6 +86,9 @@ ssize_t Socket_recv(Socket *sock, void *buf, size_t len, int flags);
 ssize_t Socket_recvfrom(Socket *sock, void *buf, size_t len, int flags,
 		struct sockaddr *from, socklen_t *fromLen);
 
+int Socket_getLocalAddr(Socket *sock, struct sockaddr *addr,
+		socklen_t *addrLen);
+
 int Socket_setNonBlocking(Socket *sock);
 int Socket_setReuseAddr(Socket *sock);
 int Socket_setNodelay(Socket *sock);
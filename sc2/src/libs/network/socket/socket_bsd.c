@@ -146,6 +146,13 @@ Socket_recvfrom(Socket *sock, void *buf, size_t len, int flags,
 	return recvfrom(sock->fd, buf, len, flags, from, fromLen);
 }
 
+// The address the socket is bound to.
+int
+Socket_getLocalAddr(Socket *sock, struct sockaddr *addr,
+		socklen_t *addrLen) {
+	return getsockname(sock->fd, addr, addrLen);
+}
+
 int
 Socket_setNonBlocking(Socket *sock) {
 	int flags;
@@ -33,6 +33,22 @@ extern "C" {
 #	endif
 //	other realistic possibilities for MSVC compiler are
 //		_M_AMD64 (AMD x86-64), _M_IA64 (Intel Arch 64)
+
+//	Vector intrinsics; SSE2 and NEON only when the target baseline
+//	has them, AVX2 on top of SSE2 where the compiler can build it
+//	for selected functions (detected at runtime)
+#	if defined(__SSE2__) || defined(_M_X64) \
+			|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		define SSE2_INTRIN
+#		if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 \
+				|| (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) \
+				|| (defined(_MSC_VER) && _MSC_VER >= 1800)
+#			define AVX2_INTRIN
+#		endif
+#	endif
+#	if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#		define NEON_INTRIN
+#	endif
 #endif
 
 typedef enum
@@ -43,8 +59,11 @@ typedef enum
 	PLATFORM_SSE,
 	PLATFORM_3DNOW,
 	PLATFORM_ALTIVEC,
+	PLATFORM_SSE2,
+	PLATFORM_AVX2,
+	PLATFORM_NEON,
 
-	PLATFORM_LAST = PLATFORM_ALTIVEC
+	PLATFORM_LAST = PLATFORM_NEON
 
 } PLATFORM_TYPE;
 
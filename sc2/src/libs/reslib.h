@@ -70,11 +70,22 @@ BOOLEAN InstallResTypeVectors (const char *res_type, ResourceLoadFun *loadFun, R
 void *res_GetResource (RESOURCE res);
 void *res_DetachResource (RESOURCE res);
 void res_FreeResource (RESOURCE res);
+void res_SetIdleCacheSize (DWORD bytes);
 COUNT CountResourceTypes (void);
 DWORD res_GetIntResource (RESOURCE res);
 BOOLEAN res_GetBooleanResource (RESOURCE res);
 const char *res_GetResourceType (RESOURCE res);
 
+typedef struct resource_request ResourceRequest;
+ResourceRequest *res_GetResourceAsync (RESOURCE res);
+BOOLEAN res_ResourceReady (ResourceRequest *req);
+void *res_WaitResource (ResourceRequest *req);
+void *res_WaitDetachedResource (ResourceRequest *req);
+void res_LockLoading (void);
+void res_UnlockLoading (void);
+void res_Preload (RESOURCE res);
+void res_PreloadSet (const char *name);
+
 void LoadResourceIndex (uio_DirHandle *dir, const char *filename, const char *prefix);
 void SaveResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *root, BOOLEAN strip_root);
 
@@ -0,0 +1,337 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Loading resources on a loader task, so that the caller can get on with
+// something else (or start more loads) in the meantime.
+//
+// The loader only fills in its own copy of the resource data; the
+// descriptor is only touched from the thread that waits for the request,
+// the same as with res_GetResource(). Loads are serialised with each
+// other by the loader lock, as the file loaders pass the name of the file
+// being loaded around in _cur_resfile_name.
+
+#include "options.h"
+#include "resintrn.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include "libs/tasklib.h"
+#include "libs/threadlib.h"
+
+struct resource_request
+{
+	RESOURCE res;
+			// A copy, which follows the struct
+#ifndef USE_RUST_RESOURCE
+	ResourceDesc *desc;
+			// NULL if there is nothing for the loader to do
+	RESOURCE_DATA resdata;
+			// What the loader got, until it is handed to the descriptor
+	DWORD size;
+	BOOLEAN done;
+	ResourceRequest *next;
+#endif
+};
+
+#ifndef USE_RUST_RESOURCE
+
+static RecursiveMutex loaderLock;
+static Mutex queueMutex;
+static Semaphore queueWake;
+static Task loaderTask;
+static ResourceRequest *queueHead;
+static ResourceRequest *queueTail;
+
+static int
+ResourceLoaderFunc (void *data)
+{
+	Task task = (Task) data;
+
+	while (!Task_ReadState (task, TASK_EXIT))
+	{
+		ResourceRequest *req;
+
+		SetSemaphore (queueWake);
+
+		LockMutex (queueMutex);
+		req = queueHead;
+		if (req)
+		{
+			queueHead = req->next;
+			if (!queueHead)
+				queueTail = NULL;
+		}
+		UnlockMutex (queueMutex);
+
+		if (!req)
+			continue; // Just woken up to exit
+
+		req->size = loadResourceData (req->desc, &req->resdata);
+
+		LockMutex (queueMutex);
+		req->done = TRUE;
+		UnlockMutex (queueMutex);
+	}
+
+	FinishTask (task);
+	return 0;
+}
+
+void
+InitResourceLoader (void)
+{
+	if (!loaderLock)
+		loaderLock = CreateRecursiveMutex ("Resource loader lock",
+				SYNC_CLASS_RESOURCE);
+}
+
+void
+UninitResourceLoader (void)
+{
+	if (loaderTask)
+	{
+		Task_SetState (loaderTask, TASK_EXIT);
+		ClearSemaphore (queueWake);
+		ConcludeTask (loaderTask);
+		loaderTask = NULL;
+	}
+
+	// Whatever was still queued is left to the waiter to load
+	while (queueHead)
+	{
+		ResourceRequest *req = queueHead;
+		queueHead = req->next;
+		req->desc = NULL;
+		req->done = TRUE;
+	}
+	queueTail = NULL;
+
+	if (queueWake)
+	{
+		DestroySemaphore (queueWake);
+		queueWake = NULL;
+	}
+	if (queueMutex)
+	{
+		DestroyMutex (queueMutex);
+		queueMutex = NULL;
+	}
+	if (loaderLock)
+	{
+		DestroyRecursiveMutex (loaderLock);
+		loaderLock = NULL;
+	}
+}
+
+static BOOLEAN
+startLoader (void)
+{
+	if (loaderTask)
+		return TRUE;
+
+	if (!queueMutex)
+		queueMutex = CreateMutex ("Resource loader queue",
+				SYNC_CLASS_RESOURCE);
+	if (!queueWake)
+		queueWake = CreateSemaphore (0, "Resource loader wake",
+				SYNC_CLASS_RESOURCE);
+	loaderTask = AssignTask (ResourceLoaderFunc, 4096, "resource loader");
+	if (!loaderTask)
+	{
+		log_add (log_Warning, "Could not start the resource loader task; "
+				"resources will load when waited for.");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void
+res_LockLoading (void)
+{
+	if (loaderLock)
+		LockRecursiveMutex (loaderLock);
+}
+
+void
+res_UnlockLoading (void)
+{
+	if (loaderLock)
+		UnlockRecursiveMutex (loaderLock);
+}
+
+#else /* USE_RUST_RESOURCE */
+
+// The Rust resource backend has no loader of its own here; the requests
+// load when they are waited for.
+
+void
+res_LockLoading (void)
+{
+}
+
+void
+res_UnlockLoading (void)
+{
+}
+
+#endif /* USE_RUST_RESOURCE */
+
+// Start loading a resource. The result must be collected with
+// res_WaitResource() or res_WaitDetachedResource(), also when it is no
+// longer needed. Returns NULL only if out of memory.
+ResourceRequest *
+res_GetResourceAsync (RESOURCE res)
+{
+	ResourceRequest *req;
+	size_t resLen;
+#ifndef USE_RUST_RESOURCE
+	ResourceDesc *desc;
+#endif
+
+	resLen = res ? strlen (res) + 1 : 0;
+	req = HMalloc (sizeof (ResourceRequest) + resLen);
+	if (req == NULL)
+		return NULL;
+	req->res = NULL_RESOURCE;
+	if (res)
+	{
+		char *copy = (char *) (req + 1);
+		memcpy (copy, res, resLen);
+		req->res = copy;
+	}
+
+#ifndef USE_RUST_RESOURCE
+	req->desc = NULL;
+	req->resdata.ptr = NULL;
+	req->size = 0;
+	req->done = TRUE;
+	req->next = NULL;
+
+	if (res == NULL_RESOURCE)
+		return req;
+	desc = lookupResourceDesc (_get_current_index_header (), res);
+	if (desc == NULL || desc->resdata.ptr != NULL || desc->preload
+			|| desc->vtable->freeFun == NULL)
+	{	// Nothing worth a trip to the loader; res_GetResource() will
+		// sort it out, or complain about it, when waited for
+		return req;
+	}
+	if (!startLoader ())
+		return req;
+
+	req->desc = desc;
+	req->done = FALSE;
+	LockMutex (queueMutex);
+	if (queueTail)
+		queueTail->next = req;
+	else
+		queueHead = req;
+	queueTail = req;
+	UnlockMutex (queueMutex);
+
+	ClearSemaphore (queueWake);
+#endif
+
+	return req;
+}
+
+// TRUE if res_WaitResource() would not have to wait
+BOOLEAN
+res_ResourceReady (ResourceRequest *req)
+{
+#ifndef USE_RUST_RESOURCE
+	BOOLEAN done;
+
+	if (req == NULL || req->desc == NULL)
+		return TRUE;
+	LockMutex (queueMutex);
+	done = req->done;
+	UnlockMutex (queueMutex);
+	return done;
+#else
+	(void) req;
+	return TRUE;
+#endif
+}
+
+#ifndef USE_RUST_RESOURCE
+// Wait for the loader to be done with a request, and hand what it loaded
+// to the descriptor
+static void
+installRequest (ResourceRequest *req)
+{
+	while (!res_ResourceReady (req))
+		HibernateThread (ONE_SECOND / 120);
+
+	if (req->resdata.ptr != NULL)
+	{
+		ResourceDesc *desc = req->desc;
+		if (desc->resdata.ptr == NULL)
+		{
+			desc->resdata = req->resdata;
+			desc->size = req->size;
+		}
+		else
+		{	// Loaded the usual way in the meantime
+			desc->vtable->freeFun (req->resdata.ptr);
+		}
+		req->resdata.ptr = NULL;
+	}
+}
+
+// The same, then free the request
+void
+finishRequest (ResourceRequest *req)
+{
+	installRequest (req);
+	HFree (req);
+}
+#endif
+
+static void *
+waitForRequest (ResourceRequest *req, BOOLEAN detach)
+{
+	void *data;
+
+	if (req == NULL)
+		return NULL;
+
+#ifndef USE_RUST_RESOURCE
+	installRequest (req);
+#endif
+	data = res_GetResource (req->res);
+			// Loads it here if the loader did not, or failed to
+	if (data && detach)
+		res_DetachResource (req->res);
+	HFree (req);
+
+	return data;
+}
+
+// Wait for a request to finish and free it. The result is referenced as
+// with res_GetResource().
+void *
+res_WaitResource (ResourceRequest *req)
+{
+	return waitForRequest (req, FALSE);
+}
+
+// Wait for a request to finish and free it. The caller becomes
+// responsible for the result, as with LoadGraphicInstance().
+void *
+res_WaitDetachedResource (ResourceRequest *req)
+{
+	return waitForRequest (req, TRUE);
+}
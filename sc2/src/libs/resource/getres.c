@@ -25,9 +25,24 @@
 
 #ifndef USE_RUST_RESOURCE
 
+#define RES_IDLE_CACHE_SIZE (8 * 1024 * 1024)
+		// Default budget of the idle cache; see res_SetIdleCacheSize()
+
 const char *_cur_resfile_name;
 // When a file is being loaded, _cur_resfile_name is set to its name.
-// At other times, it is NULL.
+// At other times, it is NULL. It is only touched with the loader lock
+// held (see res_LockLoading()).
+
+static DWORD loadBytes;
+		// Bytes read by LoadResourceFromPath() during the current load
+
+// Resources that are no longer referenced stay loaded in case they are
+// asked for again, until the bytes read to load them go over the budget.
+// The least recently released go first.
+static ResourceDesc *idleOldest;
+static ResourceDesc *idleNewest;
+static DWORD idleBytes;
+static DWORD idleBudget = RES_IDLE_CACHE_SIZE;
 
 ResourceDesc *
 lookupResourceDesc (RESOURCE_INDEX idx, RESOURCE res)
@@ -35,10 +50,76 @@ lookupResourceDesc (RESOURCE_INDEX idx, RESOURCE res)
 	return (ResourceDesc *) CharHashTable_find (idx->map, res);
 }
 
+// Returns the number of bytes read for it
+DWORD
+loadResourceData (ResourceDesc *desc, RESOURCE_DATA *resdata)
+{
+	DWORD size;
+
+	res_LockLoading ();
+	loadBytes = 0;
+	desc->vtable->loadFun (desc->fname, resdata);
+	size = loadBytes;
+	res_UnlockLoading ();
+
+	return size;
+}
+
 void
 loadResourceDesc (ResourceDesc *desc)
 {
-	desc->vtable->loadFun (desc->fname, &desc->resdata);
+	desc->size = loadResourceData (desc, &desc->resdata);
+}
+
+// Take a resource out of the idle cache, leaving it loaded
+void
+forgetIdleResource (ResourceDesc *desc)
+{
+	if (!desc->idle)
+		return;
+
+	if (desc->idlePrev)
+		desc->idlePrev->idleNext = desc->idleNext;
+	else
+		idleOldest = desc->idleNext;
+	if (desc->idleNext)
+		desc->idleNext->idlePrev = desc->idlePrev;
+	else
+		idleNewest = desc->idlePrev;
+	desc->idlePrev = NULL;
+	desc->idleNext = NULL;
+	desc->idle = FALSE;
+	idleBytes -= desc->size;
+}
+
+static void
+freeIdleResource (ResourceDesc *desc)
+{
+	forgetIdleResource (desc);
+	(*desc->vtable->freeFun) (desc->resdata.ptr);
+	desc->resdata.ptr = NULL;
+}
+
+static void
+trimIdleResources (DWORD budget)
+{
+	while (idleOldest && idleBytes > budget)
+		freeIdleResource (idleOldest);
+}
+
+void
+freeIdleResources (void)
+{
+	trimIdleResources (0);
+}
+
+// The budget is in bytes read from the content files, so the memory used
+// is somewhat more for compressed images and sounds. 0 disables the cache.
+void
+res_SetIdleCacheSize (DWORD bytes)
+{
+	idleBudget = bytes;
+	trimIdleResources (idleBudget);
 }
 
 void *
@@ -64,9 +145,12 @@ LoadResourceFromPath (const char *path, ResourceLoadFileFun *loadFun)
 		goto err;
 	}
 
+	res_LockLoading ();
 	_cur_resfile_name = path;
+	loadBytes += dataLen;
 	resdata = (*loadFun) (stream, dataLen);
 	_cur_resfile_name = NULL;
+	res_UnlockLoading ();
 	res_CloseResFile (stream);
 
 	return resdata;
@@ -124,8 +208,12 @@ res_GetResource (RESOURCE res)
 		return NULL;
 	}
 
+	collectPreload (desc);
+	forgetIdleResource (desc);
 	if (desc->resdata.ptr == NULL)
 		loadResourceDesc (desc);
+	if (desc->vtable->freeFun != NULL)
+		recordResourceUse (res);
 	if (desc->resdata.ptr != NULL)
 		++desc->refcount;
 
@@ -164,7 +252,8 @@ res_GetBooleanResource (RESOURCE res)
 	return (res_GetIntResource (res) != 0);
 }
 
-// NB: this function appears to be never called!
+// When the last reference goes, the resource is not freed straight away
+// but kept by the idle cache.
 void
 res_FreeResource (RESOURCE res)
 {
@@ -185,6 +274,8 @@ res_FreeResource (RESOURCE res)
 		log_add (log_Debug, "Warning: freeing an unreferenced resource.");
 	if (desc->refcount > 0)
 		return; // Still references left
+	if (desc->idle)
+		return; // Already released
 
 	freeFun = desc->vtable->freeFun;
 	if (freeFun == NULL)
@@ -200,8 +291,30 @@ res_FreeResource (RESOURCE res)
 		return;
 	}
 
-	(*freeFun) (desc->resdata.ptr);
-	desc->resdata.ptr = NULL;
+	releaseResourceDesc (desc);
+}
+
+// Hand a loaded, unreferenced resource to the idle cache
+void
+releaseResourceDesc (ResourceDesc *desc)
+{
+	if (idleBudget == 0 || desc->size > idleBudget / 4)
+	{	// Would push out too much else
+		(*desc->vtable->freeFun) (desc->resdata.ptr);
+		desc->resdata.ptr = NULL;
+		return;
+	}
+
+	desc->idle = TRUE;
+	desc->idlePrev = idleNewest;
+	desc->idleNext = NULL;
+	if (idleNewest)
+		idleNewest->idleNext = desc;
+	else
+		idleOldest = desc;
+	idleNewest = desc;
+	idleBytes += desc->size;
+	trimIdleResources (idleBudget);
 }
 
 // By calling this function the caller will be responsible of unloading
@@ -244,6 +357,7 @@ res_DetachResource (RESOURCE res)
 		return NULL;
 	}
 
+	forgetIdleResource (desc);
 	result = desc->resdata.ptr;
 	desc->resdata.ptr = NULL;
 	desc->refcount = 0;
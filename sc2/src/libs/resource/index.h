@@ -42,6 +42,14 @@ struct resource_desc
 	RESOURCE_DATA resdata;
 	// refcount is rudimentary as nothing really frees the descriptors
 	unsigned refcount;
+	DWORD size;
+			// Bytes read to load it, which is what the idle cache counts
+	BOOLEAN idle;
+			// Unreferenced, but kept loaded by the idle cache
+	ResourceDesc *idlePrev;
+	ResourceDesc *idleNext;
+	ResourceRequest *preload;
+			// Loading for a preload set, not collected yet
 };
 
 struct resource_index_desc
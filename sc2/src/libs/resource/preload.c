@@ -0,0 +1,213 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Preload sets: the resources a screen uses, named in an index file as
+//   preload.starbase = PRELOADSET:starbase.anim.frame ship.sis.icons ...
+// res_PreloadSet() is called just before the screen is set up. It hands
+// all of them to the loader task, and the screen's own res_GetResource()
+// calls then wait for the loads already under way (or done) rather than
+// starting them one by one. What the screen does not take stays in the
+// idle cache.
+//
+// With UQM_RES_MANIFEST naming a file, the resources each set's screen
+// actually gets are recorded there, in the same form, from one
+// res_PreloadSet() to the next. That file can go into the content as an
+// index file of its own; if a screen is visited more than once, the last
+// line for its set is the one that counts.
+
+#include "options.h"
+#include "resintrn.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef USE_RUST_RESOURCE
+
+#define PRELOAD_ENV_VAR "UQM_RES_MANIFEST"
+
+static FILE *manifest;
+static char *recordingSet;
+		// Name of the set being recorded; NULL if none
+static char **recorded;
+static COUNT numRecorded;
+static COUNT maxRecorded;
+
+static char *
+copyString (const char *str)
+{
+	size_t len = strlen (str) + 1;
+	char *result = HMalloc (len);
+	memcpy (result, str, len);
+	return result;
+}
+
+// Writes out the set being recorded, and stops recording it
+static void
+flushRecording (void)
+{
+	COUNT i;
+
+	if (manifest && recordingSet && numRecorded > 0)
+	{
+		fprintf (manifest, "%s = PRELOADSET:", recordingSet);
+		for (i = 0; i < numRecorded; i++)
+			fprintf (manifest, "%s%s", i ? " " : "", recorded[i]);
+		fprintf (manifest, "\n");
+		fflush (manifest);
+	}
+
+	for (i = 0; i < numRecorded; i++)
+		HFree (recorded[i]);
+	numRecorded = 0;
+	HFree (recordingSet);
+	recordingSet = NULL;
+}
+
+// Wait for the preload of a resource, leaving the result in the idle
+// cache to be taken from there
+void
+collectPreload (ResourceDesc *desc)
+{
+	ResourceRequest *req = desc->preload;
+
+	if (req == NULL)
+		return;
+
+	desc->preload = NULL;
+	finishRequest (req);
+	if (desc->resdata.ptr != NULL && desc->refcount == 0 && !desc->idle)
+		releaseResourceDesc (desc);
+}
+
+// Returns TRUE if a load was started
+static BOOLEAN
+startPreload (RESOURCE_INDEX idx, RESOURCE res)
+{
+	ResourceDesc *desc = lookupResourceDesc (idx, res);
+	if (desc == NULL || desc->preload || desc->resdata.ptr != NULL
+			|| desc->vtable->freeFun == NULL)
+		return FALSE;
+	desc->preload = res_GetResourceAsync (res);
+	return TRUE;
+}
+
+// Like res_PreloadSet(), for a single resource that is known to be
+// needed soon
+void
+res_Preload (RESOURCE res)
+{
+	if (res != NULL_RESOURCE)
+		startPreload (_get_current_index_header (), res);
+}
+
+void
+res_PreloadSet (const char *name)
+{
+	RESOURCE_INDEX idx = _get_current_index_header ();
+	ResourceDesc *setDesc;
+	char *keys, *key;
+	COUNT numStarted = 0;
+
+	if (manifest)
+	{
+		flushRecording ();
+		recordingSet = copyString (name);
+	}
+
+	setDesc = lookupResourceDesc (idx, name);
+	if (setDesc == NULL || setDesc->vtable == NULL
+			|| strcmp (setDesc->vtable->resType, "PRELOADSET") != 0)
+		return; // Nothing known about this screen
+
+	keys = copyString (setDesc->resdata.str);
+	for (key = strtok (keys, " \t,"); key; key = strtok (NULL, " \t,"))
+	{
+		if (startPreload (idx, key))
+			numStarted++;
+	}
+	HFree (keys);
+
+	log_add (log_Debug, "Preloading %u resources for '%s'.", numStarted,
+			name);
+}
+
+void
+recordResourceUse (RESOURCE res)
+{
+	COUNT i;
+
+	if (!recordingSet)
+		return;
+
+	for (i = 0; i < numRecorded; i++)
+	{
+		if (strcmp (recorded[i], res) == 0)
+			return;
+	}
+	if (numRecorded == maxRecorded)
+	{
+		maxRecorded = maxRecorded ? maxRecorded * 2 : 64;
+		recorded = HRealloc (recorded, maxRecorded * sizeof (char *));
+	}
+	recorded[numRecorded++] = copyString (res);
+}
+
+void
+InitPreloadRecording (void)
+{
+	const char *fileName = getenv (PRELOAD_ENV_VAR);
+
+	if (fileName == NULL || manifest != NULL)
+		return;
+	manifest = fopen (fileName, "w");
+	if (manifest == NULL)
+		log_add (log_Warning, "Could not create preload manifest '%s'.",
+				fileName);
+	else
+		fprintf (manifest, "# Preload sets, as recorded\n");
+}
+
+void
+UninitPreloadRecording (void)
+{
+	flushRecording ();
+	HFree (recorded);
+	recorded = NULL;
+	maxRecorded = 0;
+	if (manifest)
+	{
+		fclose (manifest);
+		manifest = NULL;
+	}
+}
+
+#else /* USE_RUST_RESOURCE */
+
+void
+res_Preload (RESOURCE res)
+{
+	(void) res;
+}
+
+void
+res_PreloadSet (const char *name)
+{
+	(void) name;
+}
+
+#endif /* USE_RUST_RESOURCE */
@@ -25,6 +25,7 @@
 #include "libs/reslib.h"
 #include "libs/sndlib.h"
 #include "libs/vidlib.h"
+#include "libs/time/bootprof.h"
 #include "propfile.h"
 #include <ctype.h>
 #include <stdlib.h>
@@ -53,13 +54,15 @@ freeResourceIndex (RESOURCE_INDEX h) {
 
 #define TYPESIZ 32
 
+static ResourceDesc *newTypedResourceDesc (const char *res_id,
+		ResourceHandlers *vtable, const char *path);
+
 static ResourceDesc *
 newResourceDesc (const char *res_id, const char *resval)
 {
 	const char *path;
-	int pathlen;
 	ResourceHandlers *vtable;
-	ResourceDesc *result, *handlerdesc;
+	ResourceDesc *handlerdesc;
 	RESOURCE_INDEX idx = _get_current_index_header ();
 	char typestr[TYPESIZ];
 
@@ -83,7 +86,6 @@ newResourceDesc (const char *res_id, const char *resval)
 		typestr[n+4] = '\0';
 		path++;
 	}
-	pathlen = strlen (path);
 
 	handlerdesc = lookupResourceDesc(idx, typestr);
 	if (handlerdesc == NULL) {
@@ -94,13 +96,24 @@ newResourceDesc (const char *res_id, const char *resval)
 
 	vtable = (ResourceHandlers *)handlerdesc->resdata.ptr;
 
+	return newTypedResourceDesc (res_id, vtable, path);
+}
+
+static ResourceDesc *
+newTypedResourceDesc (const char *res_id, ResourceHandlers *vtable,
+		const char *path)
+{
+	ResourceDesc *result;
+	int pathlen;
+
 	if (vtable->loadFun == NULL)
 	{
 		log_add (log_Warning, "Warning: Unable to load '%s'; no handler "
-				"for type %s defined.", res_id, typestr);
+				"for type %s defined.", res_id, vtable->resType);
 		return NULL;
 	}
 
+	pathlen = strlen (path);
 	result = HMalloc (sizeof (ResourceDesc));
 	if (result == NULL)
 		return NULL;
@@ -110,6 +123,11 @@ newResourceDesc (const char *res_id, const char *resval)
 	result->fname[pathlen] = '\0';
 	result->vtable = vtable;
 	result->refcount = 0;
+	result->size = 0;
+	result->idle = FALSE;
+	result->idlePrev = NULL;
+	result->idleNext = NULL;
+	result->preload = NULL;
 	
 	if (vtable->freeFun == NULL)
 	{
@@ -124,10 +142,9 @@ newResourceDesc (const char *res_id, const char *resval)
 }
 
 static void
-process_resource_desc (const char *key, const char *value)
+addResourceDesc (const char *key, ResourceDesc *newDesc)
 {
 	CharHashTable_HashTable *map = _get_current_index_header ()->map;
-	ResourceDesc *newDesc = newResourceDesc (key, value);
 	if (newDesc != NULL)
 	{
 		if (!CharHashTable_add (map, key, newDesc))
@@ -138,6 +155,41 @@ process_resource_desc (const char *key, const char *value)
 	}
 }
 
+static void
+process_resource_desc (const char *key, const char *value)
+{
+	addResourceDesc (key, newResourceDesc (key, value));
+}
+
+// The handlers of a type, by the name it has in the index files; NULL if
+// there is no such type
+ResourceHandlers *
+lookupResourceType (const char *resType)
+{
+	char typestr[TYPESIZ];
+	ResourceDesc *handlerdesc;
+
+	if (strlen (resType) >= TYPESIZ - 4)
+		return NULL;
+	snprintf (typestr, TYPESIZ, "sys.%s", resType);
+	handlerdesc = lookupResourceDesc (_get_current_index_header (),
+			typestr);
+	return handlerdesc ? (ResourceHandlers *) handlerdesc->resdata.ptr
+			: NULL;
+}
+
+// Add a resource from a compiled index. Without the handlers of its type,
+// it is parsed from the value as from an index file.
+void
+addIndexedResource (const char *key, ResourceHandlers *vtable,
+		const char *value, const char *path)
+{
+	if (vtable == NULL)
+		process_resource_desc (key, value);
+	else
+		addResourceDesc (key, newTypedResourceDesc (key, vtable, path));
+}
+
 static void
 UseDescriptorAsRes (const char *descriptor, RESOURCE_DATA *resdata)
 {
@@ -341,6 +393,8 @@ InitResourceSystem (void)
 	ndx = allocResourceIndex ();
 	
 	_set_current_index_header (ndx);
+	InitResourceLoader ();
+	InitPreloadRecording ();
 
 	InstallResTypeVectors ("UNKNOWNRES", UseDescriptorAsRes, NULL, NULL);
 	InstallResTypeVectors ("STRING", UseDescriptorAsRes, NULL, RawDescriptor);
@@ -348,6 +402,8 @@ InitResourceSystem (void)
 	InstallResTypeVectors ("BOOLEAN", DescriptorToBoolean, NULL,
 			BooleanToString);
 	InstallResTypeVectors ("COLOR", DescriptorToColor, NULL, ColorToString);
+	InstallResTypeVectors ("PRELOADSET", UseDescriptorAsRes, NULL,
+			RawDescriptor);
 	InstallGraphicResTypes ();
 	InstallStringTableResType ();
 	InstallAudioResTypes ();
@@ -369,7 +425,10 @@ _get_current_index_header (void)
 void
 LoadResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *prefix)
 {
-	PropFile_from_filename (dir, rmpfile, process_resource_desc, prefix);
+	BOOT_BEGIN (BOOT_INDEXES);
+	if (!LoadCompiledResourceIndex (dir, rmpfile, prefix))
+		PropFile_from_filename (dir, rmpfile, process_resource_desc, prefix);
+	BOOT_END (BOOT_INDEXES);
 }
 
 void
@@ -421,6 +480,9 @@ SaveResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *root, BO
 void
 UninitResourceSystem (void)
 {
+	UninitPreloadRecording ();
+	UninitResourceLoader ();
+	freeIdleResources ();
 	freeResourceIndex (_get_current_index_header ());
 	_set_current_index_header (NULL);
 }
@@ -458,6 +520,12 @@ InstallResTypeVectors (const char *resType, ResourceLoadFun *loadFun,
 	result->fname[typelen] = '\0';
 	result->vtable = NULL;
 	result->resdata.ptr = handlers;
+	result->refcount = 0;
+	result->size = 0;
+	result->idle = FALSE;
+	result->idlePrev = NULL;
+	result->idleNext = NULL;
+	result->preload = NULL;
 
 	map = _get_current_index_header ()->map;
 	return CharHashTable_add (map, key, result) != 0;
@@ -637,6 +705,8 @@ res_Remove (const char *key)
 	ResourceDesc *oldDesc = (ResourceDesc *)CharHashTable_find (map, key);
 	if (oldDesc != NULL)
 	{
+		collectPreload (oldDesc);
+		forgetIdleResource (oldDesc);
 		if (oldDesc->resdata.ptr != NULL)
 		{
 			if (oldDesc->refcount > 0)
@@ -25,6 +25,25 @@
 
 ResourceDesc *lookupResourceDesc (RESOURCE_INDEX idx, RESOURCE res);
 void loadResourceDesc (ResourceDesc *desc);
+DWORD loadResourceData (ResourceDesc *desc, RESOURCE_DATA *resdata);
+void forgetIdleResource (ResourceDesc *desc);
+void freeIdleResources (void);
+
+ResourceHandlers *lookupResourceType (const char *resType);
+void addIndexedResource (const char *key, ResourceHandlers *vtable,
+		const char *value, const char *path);
+BOOLEAN LoadCompiledResourceIndex (uio_DirHandle *dir, const char *rmpfile,
+		const char *prefix);
+
+void InitResourceLoader (void);
+void UninitResourceLoader (void);
+void finishRequest (ResourceRequest *req);
+void releaseResourceDesc (ResourceDesc *desc);
+
+void collectPreload (ResourceDesc *desc);
+void recordResourceUse (RESOURCE res);
+void InitPreloadRecording (void);
+void UninitPreloadRecording (void);
 
 void _set_current_index_header (RESOURCE_INDEX newResourceIndex);
 RESOURCE_INDEX _get_current_index_header (void);
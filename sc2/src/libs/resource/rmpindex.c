@@ -0,0 +1,203 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Compiled resource indices, as written by tools/pkg/mkresidx.
+//
+// "foo.rmp" may come with a "foo.rmpc", which holds the same entries
+// already split into key, type and path, so that loading it needs no
+// parsing, and each type is looked up once rather than for every entry.
+// The compiled index is only used when it is at least as new as the
+// text one and was made from a file of the same size; otherwise the text
+// is parsed as before.
+//
+// Layout, all numbers 32 bits little endian:
+//   "URIX", version, size of the .rmp it was made from,
+//   number of types, number of entries, size of the string table
+//   for each type: offset of its name in the string table
+//   for each entry, sorted by key: offsets of its key and its
+//     whole value, and the index of its type (~0 if the value has none)
+//   the string table: NUL terminated strings, each stored once
+// The path of an entry with a type is the value after the ':'.
+
+#include "options.h"
+#include "resintrn.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifndef USE_RUST_RESOURCE
+
+#define RMPC_MAGIC "URIX"
+#define RMPC_VERSION 1
+#define RMPC_HEADER_SIZE 24
+#define RMPC_NO_TYPE 0xffffffff
+
+static DWORD
+getDword (const BYTE *buf)
+{
+	return (DWORD) buf[0] | ((DWORD) buf[1] << 8) |
+			((DWORD) buf[2] << 16) | ((DWORD) buf[3] << 24);
+}
+
+// Returns the data of the compiled index of rmpfile if it can be used in
+// its place, NULL if not
+static BYTE *
+readCompiledIndex (uio_DirHandle *dir, const char *rmpfile, size_t *size)
+{
+	char fileName[256];
+	struct stat textSb, compiledSb;
+	BOOLEAN haveText;
+	uio_Stream *stream;
+	BYTE *data;
+
+	if (snprintf (fileName, sizeof fileName, "%sc", rmpfile)
+			>= (int) sizeof fileName)
+		return NULL;
+	if (uio_stat (dir, fileName, &compiledSb) == -1)
+		return NULL;
+	haveText = uio_stat (dir, rmpfile, &textSb) == 0;
+	if (haveText && textSb.st_mtime > compiledSb.st_mtime)
+	{
+		log_add (log_Debug, "'%s' is older than '%s'; not using it.",
+				fileName, rmpfile);
+		return NULL;
+	}
+
+	stream = res_OpenResFile (dir, fileName, "rb");
+	if (stream == NULL)
+		return NULL;
+	*size = LengthResFile (stream);
+	data = *size >= RMPC_HEADER_SIZE ? HMalloc (*size) : NULL;
+	if (data && ReadResFile (data, *size, 1, stream) != 1)
+	{
+		HFree (data);
+		data = NULL;
+	}
+	res_CloseResFile (stream);
+
+	if (data == NULL || memcmp (data, RMPC_MAGIC, 4) != 0
+			|| getDword (data + 4) != RMPC_VERSION)
+	{
+		log_add (log_Warning, "'%s' is not a compiled resource index.",
+				fileName);
+		HFree (data);
+		return NULL;
+	}
+	if (haveText && getDword (data + 8) != (DWORD) textSb.st_size)
+	{
+		log_add (log_Debug, "'%s' was made from another '%s'; not "
+				"using it.", fileName, rmpfile);
+		HFree (data);
+		return NULL;
+	}
+	return data;
+}
+
+BOOLEAN
+LoadCompiledResourceIndex (uio_DirHandle *dir, const char *rmpfile,
+		const char *prefix)
+{
+	BYTE *data;
+	size_t size;
+	DWORD numTypes, numEntries, strSize;
+	const BYTE *types, *entries;
+	const char *strings;
+	ResourceHandlers **vtables;
+	DWORD i;
+
+	data = readCompiledIndex (dir, rmpfile, &size);
+	if (data == NULL)
+		return FALSE;
+
+	numTypes = getDword (data + 12);
+	numEntries = getDword (data + 16);
+	strSize = getDword (data + 20);
+	if (numTypes > size / 4 || numEntries > size / 12 || strSize > size
+			|| RMPC_HEADER_SIZE + 4 * numTypes + 12 * numEntries
+			+ strSize != size || strSize == 0)
+		goto err;
+	types = data + RMPC_HEADER_SIZE;
+	entries = types + 4 * numTypes;
+	strings = (const char *) (entries + 12 * numEntries);
+	if (strings[strSize - 1] != '\0')
+		goto err;
+
+	vtables = HMalloc ((numTypes + 1) * sizeof (ResourceHandlers *));
+	for (i = 0; i < numTypes; i++)
+	{
+		DWORD nameOfs = getDword (types + 4 * i);
+		if (nameOfs >= strSize)
+		{
+			HFree (vtables);
+			goto err;
+		}
+		// Unknown to us: those entries get the warnings the text would
+		vtables[i] = lookupResourceType (strings + nameOfs);
+	}
+
+	for (i = 0; i < numEntries; i++)
+	{
+		const BYTE *entry = entries + 12 * i;
+		DWORD keyOfs = getDword (entry);
+		DWORD valueOfs = getDword (entry + 4);
+		DWORD type = getDword (entry + 8);
+		const char *key, *value;
+		ResourceHandlers *vtable = NULL;
+		const char *path = NULL;
+		char buf[256];
+
+		if (keyOfs >= strSize || valueOfs >= strSize
+				|| (type != RMPC_NO_TYPE && type >= numTypes))
+		{
+			log_add (log_Warning, "Broken entry in the compiled index of "
+					"'%s'.", rmpfile);
+			continue;
+		}
+		key = strings + keyOfs;
+		value = strings + valueOfs;
+		if (type != RMPC_NO_TYPE && vtables[type] != NULL)
+		{
+			path = strchr (value, ':');
+			if (path != NULL)
+			{
+				vtable = vtables[type];
+				path++;
+			}
+		}
+
+		if (prefix)
+		{
+			snprintf (buf, 255, "%s%s", prefix, key);
+			buf[255] = 0;
+			key = buf;
+		}
+		addIndexedResource (key, vtable, value, path);
+	}
+
+	HFree (vtables);
+	HFree (data);
+	return TRUE;
+
+err:
+	log_add (log_Warning, "The compiled index of '%s' is broken; parsing "
+			"the text.", rmpfile);
+	HFree (data);
+	return FALSE;
+}
+
+#endif /* !USE_RUST_RESOURCE */
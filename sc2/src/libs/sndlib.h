@@ -37,6 +37,12 @@ typedef struct soundposition
 	int x, y;
 } SoundPosition;
 
+typedef struct
+{
+	COUNT channel;
+	SoundPosition pos;
+} ChannelPosition;
+
 #define InitSoundResources InitStringTableResources
 #define CaptureSound CaptureStringTable
 #define ReleaseSound ReleaseStringTable
@@ -86,6 +92,8 @@ extern BOOLEAN ChannelPlaying (COUNT Channel);
 extern void * GetPositionalObject (COUNT channel);
 extern void SetPositionalObject (COUNT channel, void *positional_object);
 extern void UpdateSoundPosition (COUNT channel, SoundPosition pos);
+extern void UpdateSoundPositionBatch (const ChannelPosition *positions,
+		COUNT count);
 extern void StopChannel (COUNT Channel, BYTE Priority);
 extern void SetMusicVolume (COUNT Volume);
 extern void SetChannelVolume (COUNT Channel, COUNT Volume, BYTE
@@ -36,6 +36,9 @@ enum
 #define audio_QUALITY_HIGH   (1 << 0)
 #define audio_QUALITY_MEDIUM (1 << 1)
 #define audio_QUALITY_LOW    (1 << 2)
+#define audio_LOW_LATENCY    (1 << 3)
+		/* Start with a small output buffer, and only make it larger
+		 * when the device runs dry */
 
 
 /* Interface Types */
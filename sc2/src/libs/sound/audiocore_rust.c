@@ -19,6 +19,7 @@
 #include "sndintrn.h"
 #include "libs/log.h"
 #include "libs/threadlib.h"
+#include "libs/time/bootprof.h"
 #include "decoders/decoder.h"
 #include "stream.h"
 
@@ -125,6 +126,7 @@ initAudio (sint32 driver, sint32 flags)
 	unsigned int mixer_format;
 
 	log_add (log_Info, "initAudio: Using Rust mixer backend");
+	BOOT_BEGIN (BOOT_AUDIO);
 
 	(void)driver; /* We always use the Rust mixer */
 
@@ -160,6 +162,7 @@ initAudio (sint32 driver, sint32 flags)
 	{
 		log_add (log_Error, "Sound decoders initialization failed.");
 		rust_mixer_Uninit();
+		BOOT_END (BOOT_AUDIO);
 		return -1;
 	}
 	log_add (log_Info, "Sound decoders initialized.");
@@ -180,6 +183,7 @@ initAudio (sint32 driver, sint32 flags)
 	{
 		log_add (log_Error, "Stream decoder initialization failed.");
 		rust_mixer_Uninit();
+		BOOT_END (BOOT_AUDIO);
 		return -1;
 	}
 
@@ -190,6 +194,7 @@ initAudio (sint32 driver, sint32 flags)
 	SetMusicVolume (musicVolume);
 
 	audio_inited = true;
+	BOOT_END (BOOT_AUDIO);
 
 	return 0; /* Success */
 }
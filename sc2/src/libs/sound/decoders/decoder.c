@@ -24,6 +24,8 @@
 #include "libs/memlib.h"
 #include "libs/file.h"
 #include "libs/log.h"
+#include "libs/timelib.h"
+#include "libs/threadlib.h"
 #include "decoder.h"
 #include "wav.h"
 #include "dukaud.h"
@@ -137,6 +139,52 @@ typedef struct tfb_nullsounddecoder
 
 } TFB_NullSoundDecoder;
 
+static const char* pref_GetName (void);
+static bool pref_InitModule (int flags, const TFB_DecoderFormats*);
+static void pref_TermModule (void);
+static uint32 pref_GetStructSize (void);
+static int pref_GetError (THIS_PTR);
+static bool pref_Init (THIS_PTR);
+static void pref_Term (THIS_PTR);
+static bool pref_Open (THIS_PTR, uio_DirHandle *dir, const char *filename);
+static void pref_Close (THIS_PTR);
+static int pref_Decode (THIS_PTR, void* buf, sint32 bufsize);
+static uint32 pref_Seek (THIS_PTR, uint32 pcm_pos);
+static uint32 pref_GetFrame (THIS_PTR);
+
+TFB_SoundDecoderFuncs pref_DecoderVtbl = 
+{
+	pref_GetName,
+	pref_InitModule,
+	pref_TermModule,
+	pref_GetStructSize,
+	pref_GetError,
+	pref_Init,
+	pref_Term,
+	pref_Open,
+	pref_Close,
+	pref_Decode,
+	pref_Seek,
+	pref_GetFrame,
+};
+
+// Plays out data decoded ahead of time before passing on to the
+// decoder that produced it
+typedef struct tfb_prefsounddecoder
+{
+	// always the first member
+	TFB_SoundDecoder decoder;
+
+	// private
+	TFB_SoundDecoder *inner;
+	uint8 *data;
+			// Raw output of 'inner' from start_sample on; freed once
+			// played out
+	uint32 size;
+	uint32 cur;
+
+} TFB_PrefSoundDecoder;
+
 #undef THIS_PTR
 
 
@@ -208,6 +256,13 @@ SoundDecoder_SwapWords (uint16* data, uint32 size)
 	}
 }
 
+void
+SoundDecoder_GetConfig (TFB_DecoderFormats *formats, int *flags)
+{
+	*formats = decoder_formats;
+	*flags = sd_flags;
+}
+
 const char*
 SoundDecoder_GetName (TFB_SoundDecoder *decoder)
 {
@@ -246,6 +301,83 @@ SoundDecoder_Init (int flags, TFB_DecoderFormats *formats)
 	return ret;
 }
 
+// Decode buffers are only allocated when something is first decoded, so
+// that the decoders of the pages of a track that wait their turn do not
+// hold one. Freed ones are kept for the next decoder that asks for the
+// same size; streams all use one or two sizes.
+#define SD_BUFFER_POOL_SIZE 16
+#define SD_BUFFER_POOL_MAX 32768
+		// Larger ones are freed; they are whole sounds
+
+typedef struct
+{
+	void *buf;
+	uint32 size;
+} TFB_PooledDecodeBuffer;
+
+static TFB_PooledDecodeBuffer sd_bufferPool[SD_BUFFER_POOL_SIZE];
+static uint32 sd_bufferPoolCount;
+static AtomicU32 sd_bufferPoolLock;
+		// Decoders are loaded and freed by the game and the prefetcher
+
+static void *
+allocDecodeBuffer (uint32 size)
+{
+	void *buf = NULL;
+	uint32 i;
+
+	while (!AtomicCompareExchange (&sd_bufferPoolLock, 0, 1))
+		TaskSwitch ();
+	for (i = sd_bufferPoolCount; i > 0; --i)
+	{
+		if (sd_bufferPool[i - 1].size == size)
+		{
+			buf = sd_bufferPool[i - 1].buf;
+			sd_bufferPool[i - 1] = sd_bufferPool[--sd_bufferPoolCount];
+			break;
+		}
+	}
+	AtomicStore (&sd_bufferPoolLock, 0);
+
+	return buf ? buf : HMalloc (size);
+}
+
+static void
+freeDecodeBuffer (void *buf, uint32 size)
+{
+	if (!buf)
+		return;
+
+	if (size > 0 && size <= SD_BUFFER_POOL_MAX)
+	{
+		while (!AtomicCompareExchange (&sd_bufferPoolLock, 0, 1))
+			TaskSwitch ();
+		if (sd_bufferPoolCount < SD_BUFFER_POOL_SIZE)
+		{
+			sd_bufferPool[sd_bufferPoolCount].buf = buf;
+			sd_bufferPool[sd_bufferPoolCount].size = size;
+			++sd_bufferPoolCount;
+			buf = NULL;
+		}
+		AtomicStore (&sd_bufferPoolLock, 0);
+	}
+
+	HFree (buf);
+}
+
+static void
+freeDecodeBufferPool (void)
+{
+	uint32 i;
+
+	while (!AtomicCompareExchange (&sd_bufferPoolLock, 0, 1))
+		TaskSwitch ();
+	for (i = 0; i < sd_bufferPoolCount; ++i)
+		HFree (sd_bufferPool[i].buf);
+	sd_bufferPoolCount = 0;
+	AtomicStore (&sd_bufferPoolLock, 0);
+}
+
 void
 SoundDecoder_Uninit (void)
 {
@@ -264,6 +396,8 @@ SoundDecoder_Uninit (void)
 			info->ext = NULL;
 		}
 	}
+
+	freeDecodeBufferPool ();
 }
 
 TFB_RegSoundDecoder*
@@ -444,7 +578,8 @@ SoundDecoder_Load (uio_DirHandle *dir, char *filename,
 		return NULL;
 	}
 
-	decoder->buffer = HMalloc (buffer_size);
+	decoder->buffer = NULL;
+			// Until something is decoded
 	decoder->buffer_size = buffer_size;
 	decoder->looping = false;
 	decoder->error = SOUNDDECODER_OK;
@@ -498,6 +633,9 @@ SoundDecoder_Decode (TFB_SoundDecoder *decoder)
 		return 0;
 	}
 
+	if (!decoder->buffer && decoder->buffer_size > 0)
+		decoder->buffer = allocDecodeBuffer (decoder->buffer_size);
+
 	buffer = (uint8*) decoder->buffer;
 	buffer_size = decoder->buffer_size;
 	if (!decoder->looping && decoder->end_sample > 0)
@@ -597,6 +735,9 @@ SoundDecoder_DecodeAll (TFB_SoundDecoder *decoder)
 	if (reqbufsize < 4096)
 		reqbufsize = 4096;
 
+	if (!decoder->buffer && decoder->buffer_size > 0)
+		decoder->buffer = allocDecodeBuffer (decoder->buffer_size);
+
 	for (decoded_bytes = 0, rc = 1; rc > 0; )
 	{	
 		if (decoded_bytes >= decoder->buffer_size)
@@ -648,6 +789,62 @@ SoundDecoder_DecodeAll (TFB_SoundDecoder *decoder)
 	return decoded_bytes;
 }
 
+TFB_SoundDecoder*
+SoundDecoder_LoadAhead (uio_DirHandle *dir, char *filename,
+		uint32 buffer_size, uint32 startTime, uint32 ahead_bytes)
+{
+	TFB_SoundDecoder *inner;
+	TFB_PrefSoundDecoder *pref;
+	uint32 struct_size;
+	uint32 size;
+	int rc;
+
+	inner = SoundDecoder_Load (dir, filename, buffer_size, startTime, 0);
+	if (!inner)
+		return NULL;
+
+	struct_size = sizeof (TFB_PrefSoundDecoder);
+	if (struct_size < SD_MIN_SIZE)
+		struct_size = SD_MIN_SIZE;
+
+	pref = (TFB_PrefSoundDecoder*) HCalloc (struct_size);
+	pref->decoder = *inner;
+	pref->decoder.funcs = &pref_DecoderVtbl;
+	pref->decoder.buffer = NULL;
+	pref->decoder.filename = (char *) HMalloc (strlen (filename) + 1);
+	strcpy (pref->decoder.filename, filename);
+	pref->inner = inner;
+
+	pref->data = HMalloc (ahead_bytes);
+	for (size = 0, rc = 1; rc > 0 && size < ahead_bytes; size += rc)
+	{
+		rc = inner->funcs->Decode (inner, pref->data + size,
+				ahead_bytes - size);
+		if (rc < 0)
+			break; // stops here when played
+	}
+	pref->size = size;
+	pref->cur = 0;
+	if (size == 0)
+	{
+		HFree (pref->data);
+		pref->data = NULL;
+	}
+
+	return &pref->decoder;
+}
+
+void
+SoundDecoder_SetRunTime (TFB_SoundDecoder *decoder, sint32 runTime)
+{
+	if (runTime <= 0 || runTime / 1000.0 >= decoder->length)
+		return;
+
+	decoder->length = (float)(runTime / 1000.0);
+	decoder->end_sample = decoder->start_sample + 
+			(unsigned long)(decoder->length * decoder->frequency);
+}
+
 void
 SoundDecoder_Rewind (TFB_SoundDecoder *decoder)
 {
@@ -691,7 +888,7 @@ SoundDecoder_Free (TFB_SoundDecoder *decoder)
 	decoder->funcs->Close (decoder);
 	decoder->funcs->Term (decoder);
 
-	HFree (decoder->buffer);
+	freeDecodeBuffer (decoder->buffer, decoder->buffer_size);
 	HFree (decoder->filename);
 	HFree (decoder);
 }
@@ -976,3 +1173,219 @@ nula_GetFrame (THIS_PTR)
 
 	(void)This; // laugh at compiler warning
 }
+
+
+#define THIS_PTR TFB_SoundDecoder* This
+
+static const char*
+pref_GetName (void)
+{
+	return "Prefetched";
+}
+
+static bool
+pref_InitModule (int flags, const TFB_DecoderFormats* fmts)
+{
+	// this should never be called
+	log_add (log_Debug, "pref_InitModule(): dead function called");
+	return false;
+	
+	(void)flags; (void)fmts; // laugh at compiler warning
+}
+
+static void
+pref_TermModule (void)
+{
+	// this should never be called
+	log_add (log_Debug, "pref_TermModule(): dead function called");
+}
+
+static uint32
+pref_GetStructSize (void)
+{
+	return sizeof (TFB_PrefSoundDecoder);
+}
+
+static int
+pref_GetError (THIS_PTR)
+{
+	TFB_PrefSoundDecoder* pref = (TFB_PrefSoundDecoder*) This;
+	return pref->inner->funcs->GetError (pref->inner);
+}
+
+static bool
+pref_Init (THIS_PTR)
+{
+	// this should never be called; SoundDecoder_LoadAhead() sets it up
+	log_add (log_Debug, "pref_Init(): dead function called");
+	return false;
+
+	(void)This; // laugh at compiler warning
+}
+
+static void
+pref_Term (THIS_PTR)
+{
+	TFB_PrefSoundDecoder* pref = (TFB_PrefSoundDecoder*) This;
+
+	pref_Close (This); // ensure cleanup
+	SoundDecoder_Free (pref->inner);
+	pref->inner = NULL;
+}
+
+static bool
+pref_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
+{
+	// this should never be called
+	log_add (log_Debug, "pref_Open(): dead function called");
+	return false;
+
+	// laugh at compiler warnings
+	(void)This; (void)dir; (void)filename;
+}
+
+static void
+pref_Close (THIS_PTR)
+{
+	TFB_PrefSoundDecoder* pref = (TFB_PrefSoundDecoder*) This;
+
+	if (pref->data)
+	{
+		HFree (pref->data);
+		pref->data = NULL;
+	}
+}
+
+static int
+pref_Decode (THIS_PTR, void* buf, sint32 bufsize)
+{
+	TFB_PrefSoundDecoder* pref = (TFB_PrefSoundDecoder*) This;
+	uint32 dec_bytes;
+
+	if (!pref->data)
+		return pref->inner->funcs->Decode (pref->inner, buf, bufsize);
+
+	dec_bytes = pref->size - pref->cur;
+	if (dec_bytes > (uint32) bufsize)
+		dec_bytes = bufsize;
+	memcpy (buf, pref->data + pref->cur, dec_bytes);
+	pref->cur += dec_bytes;
+
+	if (pref->cur == pref->size)
+	{	// 'inner' is right where the data ends
+		HFree (pref->data);
+		pref->data = NULL;
+	}
+
+	return dec_bytes;
+}
+
+static uint32
+pref_Seek (THIS_PTR, uint32 pcm_pos)
+{
+	TFB_PrefSoundDecoder* pref = (TFB_PrefSoundDecoder*) This;
+
+	if (pref->data && pcm_pos >= This->start_sample
+			&& (pcm_pos - This->start_sample) * This->bytes_per_samp
+			< pref->size)
+	{	// Rewinding to the start of a stream lands here
+		pref->cur = (pcm_pos - This->start_sample) * This->bytes_per_samp;
+		return pcm_pos;
+	}
+
+	pref_Close (This);
+	return pref->inner->funcs->Seek (pref->inner, pcm_pos);
+}
+
+static uint32
+pref_GetFrame (THIS_PTR)
+{
+	TFB_PrefSoundDecoder* pref = (TFB_PrefSoundDecoder*) This;
+	return pref->inner->funcs->GetFrame (pref->inner);
+}
+
+#define PERFTEST_BUFFER_SIZE 16384
+#define PERFTEST_MIN_TIME    (ONE_SECOND / 2)
+#define PERFTEST_MAX_PASSES  20
+
+// Decodes every file in 'path' that one of the registered decoders
+// handles and logs how fast that went. The files are decoded over and
+// over for at least PERFTEST_MIN_TIME each, to get past the timer
+// resolution.
+void
+SoundDecoder_PerfTest (uio_DirHandle *dir, const char *path)
+{
+	uio_DirHandle *testDir;
+	uio_DirList *dirList;
+	int i;
+
+	testDir = uio_openDirRelative (dir, path, 0);
+	if (!testDir)
+	{
+		log_add (log_Error, "SoundDecoder_PerfTest(): cannot open '%s'",
+				path);
+		return;
+	}
+	dirList = uio_getDirList (testDir, "", "", match_MATCH_PREFIX);
+	if (!dirList)
+	{
+		uio_closeDir (testDir);
+		return;
+	}
+
+	for (i = 0; i < dirList->numNames; i++)
+	{
+		char *fileName = (char *) dirList->names[i];
+		const char *pext = strrchr (fileName, '.');
+		const char *decName = NULL;
+		TimeCount start;
+		TimeCount elapsed;
+		unsigned long bytes = 0;
+		float seconds = 0;
+		int passes;
+
+		if (!pext || !SoundDecoder_Lookup (pext + 1))
+			continue;
+
+		start = GetTimeCounter ();
+		for (passes = 0; passes < PERFTEST_MAX_PASSES; ++passes)
+		{
+			TFB_SoundDecoder *decoder;
+
+			decoder = SoundDecoder_Load (testDir, fileName,
+					PERFTEST_BUFFER_SIZE, 0, 0);
+			if (!decoder)
+				break;
+			decName = SoundDecoder_GetName (decoder);
+			while (decoder->error == SOUNDDECODER_OK)
+				bytes += SoundDecoder_Decode (decoder);
+			seconds += decoder->length;
+			SoundDecoder_Free (decoder);
+
+			if (GetTimeCounter () - start >= PERFTEST_MIN_TIME)
+			{
+				++passes;
+				break;
+			}
+		}
+		elapsed = GetTimeCounter () - start;
+
+		if (passes == 0)
+		{
+			log_add (log_Warning, "SoundDecoder_PerfTest(): cannot load "
+					"'%s'", fileName);
+			continue;
+		}
+		if (elapsed == 0)
+			elapsed = 1;
+
+		log_add (log_Debug, "%s (%s): %d passes, %lu KB in %lu ms; "
+				"%.2f MB/s, %.1fx real time", fileName, decName, passes,
+				bytes >> 10, (unsigned long) elapsed * 1000 / ONE_SECOND,
+				bytes / (1024.0f * 1024.0f) * ONE_SECOND / elapsed,
+				seconds * ONE_SECOND / elapsed);
+	}
+
+	uio_DirList_free (dirList);
+	uio_closeDir (testDir);
+}
@@ -81,6 +81,7 @@ struct tfb_sounddecoder
 
 	// public R/O, set by wrapper
 	void *buffer;
+			// NULL until the first SoundDecoder_Decode()
 	uint32 buffer_size;
 	sint32 error;
 	uint32 bytes_per_samp;
@@ -115,8 +116,18 @@ const TFB_SoundDecoderFuncs* SoundDecoder_Lookup (const char* fileext);
 void SoundDecoder_SwapWords (uint16* data, uint32 size);
 sint32 SoundDecoder_Init (int flags, TFB_DecoderFormats* formats);
 void SoundDecoder_Uninit (void);
+// What decoded data looks like is fully determined by these
+void SoundDecoder_GetConfig (TFB_DecoderFormats *formats, int *flags);
 TFB_SoundDecoder* SoundDecoder_Load (uio_DirHandle *dir,
 		char *filename, uint32 buffer_size, uint32 startTime, sint32 runTime);
+// Like SoundDecoder_Load() with no run time, but also decodes the
+// first 'ahead_bytes' of the file right away. Meant for loading on
+// another thread than the one that is going to play the sound.
+TFB_SoundDecoder* SoundDecoder_LoadAhead (uio_DirHandle *dir,
+		char *filename, uint32 buffer_size, uint32 startTime,
+		uint32 ahead_bytes);
+// Cuts the decoder short as the runTime argument of SoundDecoder_Load()
+void SoundDecoder_SetRunTime (TFB_SoundDecoder *decoder, sint32 runTime);
 uint32 SoundDecoder_Decode (TFB_SoundDecoder *decoder);
 uint32 SoundDecoder_DecodeAll (TFB_SoundDecoder *decoder);
 float SoundDecoder_GetTime (TFB_SoundDecoder *decoder);
@@ -125,5 +136,7 @@ void SoundDecoder_Seek (TFB_SoundDecoder *decoder, uint32 msecs);
 void SoundDecoder_Rewind (TFB_SoundDecoder *decoder);
 void SoundDecoder_Free (TFB_SoundDecoder *decoder);
 const char* SoundDecoder_GetName (TFB_SoundDecoder *decoder);
+// Logs the decoding speed of the sound files in 'path'
+void SoundDecoder_PerfTest (uio_DirHandle *dir, const char *path);
 
 #endif
@@ -157,7 +157,7 @@ static int adpcm_step[89] = {
 		};
 
 
-// *** BEGIN part copied from MPlayer ***
+// *** BEGIN part derived from MPlayer ***
 // (some little changes)
 
 #if 0
@@ -180,9 +180,40 @@ static int adpcm_index[16] = {
 		-1, -1, -1, -1, 2, 4, 6, 8
 		};
 
-// clamp a number between 0 and 88
-#define CLAMP_0_TO_88(x) \
-		if ((x) < 0) (x) = 0; else if ((x) > 88) (x) = 88;
+// The difference each nibble makes at each step index, and the index
+// that follows, so that decoding a nibble is two lookups.
+// Made by duka_InitModule() from the tables above.
+static sint32 adpcm_diff[89][8];
+static uint8 adpcm_next[89][16];
+
+static void
+init_tables (void)
+{
+	int index;
+	int nibble;
+
+	for (index = 0; index < 89; ++index)
+	{
+		for (nibble = 0; nibble < 8; ++nibble)
+		{
+			// real thing, not the fast approximation used in most
+			// decoders:
+			// diff = ((signed)delta + 0.5) * step[channel_number] / 4;
+			adpcm_diff[index][nibble] =
+					(((nibble << 1) + 1) * adpcm_step[index]) >> 3;
+		}
+
+		for (nibble = 0; nibble < 16; ++nibble)
+		{
+			int next = index + adpcm_index[nibble];
+			if (next < 0)
+				next = 0;
+			else if (next > 88)
+				next = 88;
+			adpcm_next[index][nibble] = next;
+		}
+	}
+}
 
 // clamp a number within a signed 16-bit range
 #define CLAMP_S16(x) \
@@ -191,80 +222,76 @@ static int adpcm_index[16] = {
 		else if ((x) > 32767) \
 			(x) = 32767;
 
+// Decodes a nibble of one channel
+#define DECODE_NIBBLE(nibble, predictor, index) \
+		do { \
+			sint32 diff = adpcm_diff[index][(nibble) & 7]; \
+			if ((nibble) & 8) \
+				(predictor) -= diff; \
+			else \
+				(predictor) += diff; \
+			CLAMP_S16 (predictor); \
+			(index) = adpcm_next[index][nibble]; \
+		} while (0)
+
+// Decodes straight from the packed input, in one pass. Each byte holds
+// a sample of both channels of a stereo stream, the left one in the high
+// nibble, or two samples of a mono one.
 static void
-decode_nibbles (sint16 *output, sint32 output_size, sint32 channels,
-		sint32* predictors, uint16* indices)
+decode_nibbles (sint16 *output, const uint8 *input, sint32 input_size,
+		sint32 channels, sint32* predictors, uint16* indices)
 {
-	sint32 step[2];
-	sint32 index[2];
-	sint32 diff;
-	sint32 i;
-	int sign;
-	sint32 delta;
-	int channel_number = 0;
-
-	channels -= 1;
-	index[0] = indices[0];
-	index[1] = indices[1];
-	step[0] = adpcm_step[index[0]];
-	step[1] = adpcm_step[index[1]];
-
-	for (i = 0; i < output_size; i++)
+	sint32 pred0 = predictors[0];
+	sint32 pred1 = predictors[1];
+	uint32 index0 = indices[0];
+	uint32 index1 = indices[1];
+	const uint8 *inend = input + input_size;
+
+	// Garbage in the file should not index past the tables
+	if (index0 > 88)
+		index0 = 88;
+	if (index1 > 88)
+		index1 = 88;
+
+	if (channels == 2)
 	{
-		delta = output[i];
-
-		index[channel_number] += adpcm_index[delta];
-		CLAMP_0_TO_88(index[channel_number]);
-
-		sign = delta & 8;
-		delta = delta & 7;
-
-#if 0
-		// fast approximation, used in most decoders
-		diff = step[channel_number] >> 3;
-		if (delta & 4) diff += step[channel_number];
-		if (delta & 2) diff += step[channel_number] >> 1;
-		if (delta & 1) diff += step[channel_number] >> 2;
-#else
-		// real thing
-//		diff = ((signed)delta + 0.5) * step[channel_number] / 4;
-		diff = (((delta << 1) + 1) * step[channel_number]) >> 3;
-#endif
-
-		if (sign)
-			predictors[channel_number] -= diff;
-		else
-			predictors[channel_number] += diff;
-
-		CLAMP_S16(predictors[channel_number]);
-		output[i] = predictors[channel_number];
-		step[channel_number] = adpcm_step[index[channel_number]];
-
-		// toggle channel
-		channel_number ^= channels;
+		for ( ; input < inend; ++input)
+		{
+			DECODE_NIBBLE (*input >> 4, pred0, index0);
+			DECODE_NIBBLE (*input & 0x0f, pred1, index1);
+			output[0] = pred0;
+			output[1] = pred1;
+			output += 2;
+		}
 	}
+	else
+	{
+		for ( ; input < inend; ++input)
+		{
+			DECODE_NIBBLE (*input >> 4, pred0, index0);
+			output[0] = pred0;
+			DECODE_NIBBLE (*input & 0x0f, pred0, index0);
+			output[1] = pred0;
+			output += 2;
+		}
+	}
+
+	predictors[0] = pred0;
+	predictors[1] = pred1;
 }
-// *** END part copied from MPlayer ***
+// *** END part derived from MPlayer ***
 
 static sint32
 duka_decodeFrame (TFB_DuckSoundDecoder* duka, DukAud_AudSubframe* header,
 		uint8* input)
 {
-	uint8* inend;
 	sint16* output;
-	sint16* outptr;
 	sint32 outputsize;
 
 	outputsize = header->numsamples * 2 * sizeof (sint16);
-	outptr = output = (sint16*) ((uint8*)duka->data + duka->cbdata);
-	
-	for (inend = input + header->numsamples; input < inend; ++input)
-	{
-		*(outptr++) = *input >> 4;
-		*(outptr++) = *input & 0x0f;
-	}
+	output = (sint16*) ((uint8*)duka->data + duka->cbdata);
 	
-	decode_nibbles (output, header->numsamples * 2, duka->channels,
+	decode_nibbles (output, input, header->numsamples, duka->channels,
 			duka->predictors, header->indices);
 
 	duka->cbdata += outputsize;
@@ -343,6 +370,7 @@ static bool
 duka_InitModule (int flags, const TFB_DecoderFormats* fmts)
 {
 	duka_formats = fmts;
+	init_tables ();
 	return true;
 
 	(void)flags;	// laugh at compiler warning
@@ -182,68 +182,134 @@ static MDRIVER moda_mmout_drv =
 static const TFB_DecoderFormats* moda_formats = NULL;
 
 // MikMod READER interface
-//  we provide our own so that we can do loading via uio 
+//  we provide our own so that we can do loading via uio.
+//  The whole file is read in one go and the loaders read it from memory,
+//  as they read a few bytes at a time and seek around.
 //
-typedef struct MUIOREADER
+typedef struct MMEMREADER
 {
 	MREADER     core;
-	uio_Stream* file;
+	const UBYTE* data;
+	long        size;
+	long        pos;
 
-} MUIOREADER;
+} MMEMREADER;
 
 static BOOL
-moda_uioReader_Eof (MREADER* reader)
+moda_memReader_Eof (MREADER* reader)
 {
-	return uio_feof (((MUIOREADER*)reader)->file);
+	MMEMREADER* mr = (MMEMREADER*)reader;
+	return mr->pos >= mr->size;
 }
 
 static BOOL
-moda_uioReader_Read (MREADER* reader, void* ptr, size_t size)
+moda_memReader_Read (MREADER* reader, void* ptr, size_t size)
 {
-	return uio_fread (ptr, size, 1, ((MUIOREADER*)reader)->file);
+	MMEMREADER* mr = (MMEMREADER*)reader;
+	size_t left = (size_t)(mr->size - mr->pos);
+
+	if (size > left)
+	{	// Like fread(), what there is is read
+		memcpy (ptr, mr->data + mr->pos, left);
+		mr->pos = mr->size;
+		return 0;
+	}
+	memcpy (ptr, mr->data + mr->pos, size);
+	mr->pos += (long)size;
+	return 1;
 }
 
 static int
-moda_uioReader_Get (MREADER* reader)
+moda_memReader_Get (MREADER* reader)
 {
-	return uio_fgetc (((MUIOREADER*)reader)->file);
+	MMEMREADER* mr = (MMEMREADER*)reader;
+	if (mr->pos >= mr->size)
+		return EOF;
+	return mr->data[mr->pos++];
 }
 
 static BOOL
-moda_uioReader_Seek (MREADER* reader, long offset, int whence)
+moda_memReader_Seek (MREADER* reader, long offset, int whence)
 {
-	return uio_fseek (((MUIOREADER*)reader)->file, offset, whence);
+	MMEMREADER* mr = (MMEMREADER*)reader;
+	long pos;
+
+	switch (whence)
+	{
+		case SEEK_SET:
+			pos = offset;
+			break;
+		case SEEK_CUR:
+			pos = mr->pos + offset;
+			break;
+		case SEEK_END:
+			pos = mr->size + offset;
+			break;
+		default:
+			return -1;
+	}
+	if (pos < 0)
+		return -1;
+	// Like fseek(), seeking past the end is allowed; reading there fails
+	mr->pos = pos < mr->size ? pos : mr->size;
+	return 0;
 }
 
 static long
-moda_uioReader_Tell (MREADER* reader)
+moda_memReader_Tell (MREADER* reader)
 {
-	return uio_ftell (((MUIOREADER*)reader)->file);
+	return ((MMEMREADER*)reader)->pos;
 }
 
 static MREADER*
-moda_new_uioReader (uio_Stream* fp)
+moda_new_memReader (const UBYTE* data, long size)
 {
-	MUIOREADER* reader = (MUIOREADER*) HMalloc (sizeof(MUIOREADER));
+	MMEMREADER* reader = (MMEMREADER*) HMalloc (sizeof(MMEMREADER));
 	if (reader)
 	{
-		reader->core.Eof  = &moda_uioReader_Eof;
-		reader->core.Read = &moda_uioReader_Read;
-		reader->core.Get  = &moda_uioReader_Get;
-		reader->core.Seek = &moda_uioReader_Seek;
-		reader->core.Tell = &moda_uioReader_Tell;
-		reader->file = fp;
+		memset (&reader->core, 0, sizeof reader->core);
+		reader->core.Eof  = &moda_memReader_Eof;
+		reader->core.Read = &moda_memReader_Read;
+		reader->core.Get  = &moda_memReader_Get;
+		reader->core.Seek = &moda_memReader_Seek;
+		reader->core.Tell = &moda_memReader_Tell;
+		reader->data = data;
+		reader->size = size;
+		reader->pos = 0;
 	}
 	return (MREADER*)reader;
 }
 
 static void
-moda_delete_uioReader (MREADER* reader)
+moda_delete_memReader (MREADER* reader)
 {
 	if (reader)
 		HFree (reader);
 }
 
+// Reads all of 'fp'. The caller frees the result with HFree().
+static UBYTE*
+moda_readAll (uio_Stream* fp, long* size)
+{
+	struct stat sb;
+	UBYTE* data;
+
+	if (uio_fstat (uio_streamHandle (fp), &sb) == -1 || sb.st_size <= 0)
+		return NULL;
+
+	data = HMalloc (sb.st_size);
+	if (!data)
+		return NULL;
+	if (uio_fread (data, sb.st_size, 1, fp) != 1)
+	{
+		HFree (data);
+		return NULL;
+	}
+
+	*size = (long) sb.st_size;
+	return data;
+}
+
 
 static const char*
 moda_GetName (void)
@@ -259,13 +325,14 @@ moda_InitModule (int flags, const TFB_DecoderFormats* fmts)
 
 	if (flags & audio_QUALITY_HIGH)
 	{
-		md_mode = DMODE_HQMIXER|DMODE_STEREO|DMODE_16BITS|DMODE_INTERP|DMODE_SURROUND;
+		md_mode = DMODE_HQMIXER|DMODE_STEREO|DMODE_16BITS|DMODE_INTERP|DMODE_SURROUND
+				|DMODE_SIMDMIXER;
 		md_mixfreq = 44100;
 		md_reverb = 1;
 	}
 	else if (flags & audio_QUALITY_LOW)
 	{
-		md_mode = DMODE_SOFT_MUSIC|DMODE_STEREO|DMODE_16BITS;
+		md_mode = DMODE_SOFT_MUSIC|DMODE_STEREO|DMODE_16BITS|DMODE_SIMDMIXER;
 #ifdef __SYMBIAN32__
 		md_mixfreq = 11025;
 #else
@@ -275,7 +342,8 @@ moda_InitModule (int flags, const TFB_DecoderFormats* fmts)
 	}
 	else
 	{
-		md_mode = DMODE_SOFT_MUSIC|DMODE_STEREO|DMODE_16BITS|DMODE_INTERP;
+		md_mode = DMODE_SOFT_MUSIC|DMODE_STEREO|DMODE_16BITS|DMODE_INTERP
+				|DMODE_SIMDMIXER;
 		md_mixfreq = 44100;
 		md_reverb = 0;
 	}
@@ -336,6 +404,8 @@ moda_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
 {
 	TFB_ModSoundDecoder* moda = (TFB_ModSoundDecoder*) This;
 	uio_Stream *fp;
+	UBYTE* data;
+	long size;
 	MREADER* reader;
 	MODULE* mod;
 
@@ -346,19 +416,26 @@ moda_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
 		return false;
 	}
 
-	reader = moda_new_uioReader (fp);
+	data = moda_readAll (fp, &size);
+	if (!data)
+		moda->last_error = errno;
+	uio_fclose (fp);
+	if (!data)
+		return false;
+
+	reader = moda_new_memReader (data, size);
 	if (!reader)
 	{
 		moda->last_error = -1;
-		uio_fclose (fp);
+		HFree (data);
 		return false;
 	}
 
 	mod = Player_LoadGeneric (reader, 8, 0);
 	
-	// can already dispose of reader and fileh
-	moda_delete_uioReader (reader);
-	uio_fclose (fp);
+	// can already dispose of reader and data
+	moda_delete_memReader (reader);
+	HFree (data);
 	if (!mod)
 	{
 		log_add (log_Warning, "moda_Open(): could not load %s", filename);
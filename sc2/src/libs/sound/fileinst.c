@@ -29,10 +29,12 @@ LoadSoundFile (const char *pStr)
 {
 	uio_Stream *fp;
 
-	// FIXME: this theoretically needs a mechanism to prevent races
+	res_LockLoading ();
 	if (_cur_resfile_name)
-		// something else is loading resources atm
+	{	// something else on this thread is loading resources atm
+		res_UnlockLoading ();
 		return 0;
+	}
 
 	fp = res_OpenResFile (contentDir, pStr, "rb");
 	if (fp)
@@ -42,11 +44,13 @@ LoadSoundFile (const char *pStr)
 		_cur_resfile_name = pStr;
 		hData = (SOUND_REF)_GetSoundBankData (fp, LengthResFile (fp));
 		_cur_resfile_name = 0;
+		res_UnlockLoading ();
 
 		res_CloseResFile (fp);
 
 		return hData;
 	}
+	res_UnlockLoading ();
 
 	return NULL;
 }
@@ -57,10 +61,12 @@ LoadMusicFile (const char *pStr)
 	uio_Stream *fp;
 	char filename[256];
 
-	// FIXME: this theoretically needs a mechanism to prevent races
+	res_LockLoading ();
 	if (_cur_resfile_name)
-		// something else is loading resources atm
+	{	// something else on this thread is loading resources atm
+		res_UnlockLoading ();
 		return 0;
+	}
 
 	strncpy (filename, pStr, sizeof(filename) - 1);
 	filename[sizeof(filename) - 1] = '\0';
@@ -77,11 +83,13 @@ LoadMusicFile (const char *pStr)
 		_cur_resfile_name = filename;
 		hData = (MUSIC_REF)_GetMusicData (fp, LengthResFile (fp));
 		_cur_resfile_name = 0;
+		res_UnlockLoading ();
 
 		res_CloseResFile (fp);
 
 		return hData;
 	}
+	res_UnlockLoading ();
 
 	return (0);
 }
@@ -157,6 +157,13 @@ noSound_Uninit (void)
 {
 	int i;
 
+	// The playback task wakes the decoder, so it goes first
+	if (PlaybackTask)
+	{
+		ConcludeTask (PlaybackTask);
+		PlaybackTask = 0;
+	}
+
 	UninitStreamDecoder ();
 
 	for (i = 0; i < NUM_SOUNDSOURCES; ++i)
@@ -176,12 +183,6 @@ noSound_Uninit (void)
 		noSound_DeleteSources (1, &soundSource[i].handle);
 	}
 
-	if (PlaybackTask)
-	{
-		ConcludeTask (PlaybackTask);
-		PlaybackTask = 0;
-	}
-
 	mixer_Uninit ();
 	SoundDecoder_Uninit ();
 }
@@ -207,6 +208,7 @@ PlaybackTaskFunc (void *data)
 	{
 		entryTime = GetTimeCounter ();
 		mixer_MixFake (NULL, stream, len);
+		WakeStreamDecoder ();
 		delay = period - (GetTimeCounter () - entryTime);
 		if (delay > 0)
 			HibernateThread (delay);
@@ -21,7 +21,9 @@
 #include "../../sndintrn.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/timelib.h"
 #include <stdlib.h>
+#include <string.h>
 
 
 /* SDL2 wants to talk to a specific device. We'll let SDL1 use the same
@@ -100,6 +102,237 @@ static const audio_Driver mixSDL_Driver =
 
 static void audioCallback (void *userdata, Uint8 *stream, int len);
 
+/* With audio_LOW_LATENCY, the device starts with a small buffer. A
+ * callback that comes in later than the previous buffer lasted means
+ * the device ran dry. After a few of those close together, the device
+ * is reopened with a buffer twice the size, up to the size that would
+ * have been used otherwise. */
+#define MIX_LOW_LATENCY_SAMPLES 512
+#define MIX_UNDERRUN_GROW_COUNT 3
+#define MIX_UNDERRUN_WINDOW 2000000
+		// In microseconds
+
+static struct
+{
+	bool adaptive;
+	SDL_AudioSpec spec;
+			// As obtained
+	Uint16 maxSamples;
+	DWORD lastCallback;
+	DWORD windowStart;
+	uint32 windowUnderruns;
+	volatile bool growPending;
+	mixSDL_LatencyStats stats;
+} latency;
+
+/* Source commands that need no answer (setting properties, play, stop,
+ * queueing buffers) are not run right away, but queued for the audio
+ * callback, which runs them before it mixes. So the game and decoder
+ * threads do not take the mixer's locks for those, and the callback does
+ * not wait on a thread that was preempted while it held one.
+ * Any call that returns something runs the queued commands first, on the
+ * calling thread, so it sees them done. The callback only takes the
+ * commands that are completely queued, and leaves the running to such a
+ * thread if one is at it; it never waits.
+ * Several threads queue these, so this is a bounded queue for many
+ * producers (sequence numbers per slot), with one thread at a time
+ * running the commands. With ATOMICS_USE_LOCK the atomics themselves
+ * take a lock, so there is no point and the commands are run right
+ * away. */
+#define MIX_CMD_QUEUE_SIZE 256
+		// A power of 2
+#define MIX_CMD_MAX_BUFFERS 4
+		// Queueing more buffers at once is done right away
+
+typedef enum
+{
+	MIX_CMD_SOURCEI,
+	MIX_CMD_SOURCEF,
+	MIX_CMD_SOURCEFV,
+	MIX_CMD_REWIND,
+	MIX_CMD_PLAY,
+	MIX_CMD_PAUSE,
+	MIX_CMD_STOP,
+	MIX_CMD_QUEUE_BUFFERS
+} MixCmdOp;
+
+typedef struct
+{
+	MixCmdOp op;
+	mixer_Object src;
+	mixer_SourceProp pname;
+	union
+	{
+		mixer_IntVal i;
+		float f[3];
+		mixer_Object bufs[MIX_CMD_MAX_BUFFERS];
+	} value;
+	uint32 n;
+			// Of value.bufs
+} MixCmd;
+
+#ifndef ATOMICS_USE_LOCK
+typedef struct
+{
+	AtomicU32 seq;
+			// == its position when free to be filled, position + 1 when
+			// filled
+	MixCmd cmd;
+} MixCmdSlot;
+
+static MixCmdSlot cmdQueue[MIX_CMD_QUEUE_SIZE];
+static AtomicU32 cmdTail;
+		// Where the next command goes
+static uint32 cmdHead;
+		// The next command to run; only touched with cmdRunning held
+static AtomicU32 cmdRunning;
+#endif
+
+static void
+runCmd (const MixCmd *cmd)
+{
+	switch (cmd->op)
+	{
+		case MIX_CMD_SOURCEI:
+			mixer_Sourcei (cmd->src, cmd->pname, cmd->value.i);
+			break;
+		case MIX_CMD_SOURCEF:
+			mixer_Sourcef (cmd->src, cmd->pname, cmd->value.f[0]);
+			break;
+		case MIX_CMD_SOURCEFV:
+			mixer_Sourcefv (cmd->src, cmd->pname, (float *) cmd->value.f);
+			break;
+		case MIX_CMD_REWIND:
+			mixer_SourceRewind (cmd->src);
+			break;
+		case MIX_CMD_PLAY:
+			mixer_SourcePlay (cmd->src);
+			break;
+		case MIX_CMD_PAUSE:
+			mixer_SourcePause (cmd->src);
+			break;
+		case MIX_CMD_STOP:
+			mixer_SourceStop (cmd->src);
+			break;
+		case MIX_CMD_QUEUE_BUFFERS:
+			mixer_SourceQueueBuffers (cmd->src, cmd->n,
+					(mixer_Object *) cmd->value.bufs);
+			break;
+	}
+}
+
+#ifndef ATOMICS_USE_LOCK
+// Runs the queued commands, up to 'end' if 'wait', or else as far as
+// they are completely queued. cmdRunning is held.
+static void
+runQueuedCmds (bool wait, uint32 end)
+{
+	for (;;)
+	{
+		MixCmdSlot *slot = &cmdQueue[cmdHead & (MIX_CMD_QUEUE_SIZE - 1)];
+		MixCmd cmd;
+
+		if (wait && cmdHead == end)
+			break;
+		if (AtomicLoad (&slot->seq) != cmdHead + 1)
+		{	// Not filled in yet
+			if (!wait)
+				break;
+			continue;
+					// Whoever has it is writing it just now
+		}
+
+		cmd = slot->cmd;
+		AtomicStore (&slot->seq, cmdHead + MIX_CMD_QUEUE_SIZE);
+		++cmdHead;
+		runCmd (&cmd);
+	}
+}
+#endif
+
+// Makes sure that the commands queued so far are done
+static void
+flushCmds (void)
+{
+#ifndef ATOMICS_USE_LOCK
+	uint32 end = AtomicLoad (&cmdTail);
+
+	if (cmdHead == end)
+		return;
+				// A stale cmdHead can only be behind, which just means
+				// taking the lock to look
+
+	while (!AtomicCompareExchange (&cmdRunning, 0, 1))
+		TaskSwitch ();
+	if ((sint32) (end - cmdHead) > 0)
+		runQueuedCmds (true, end);
+	AtomicStore (&cmdRunning, 0);
+#endif
+}
+
+// Called from the audio callback
+static void
+runCmdsForCallback (void)
+{
+#ifndef ATOMICS_USE_LOCK
+	if (!AtomicCompareExchange (&cmdRunning, 0, 1))
+		return;
+				// Another thread is running them already
+	runQueuedCmds (false, 0);
+	AtomicStore (&cmdRunning, 0);
+#endif
+}
+
+static void
+queueCmd (const MixCmd *cmd)
+{
+#ifndef ATOMICS_USE_LOCK
+	uint32 pos = AtomicLoad (&cmdTail);
+
+	for (;;)
+	{
+		MixCmdSlot *slot = &cmdQueue[pos & (MIX_CMD_QUEUE_SIZE - 1)];
+		sint32 diff = (sint32) (AtomicLoad (&slot->seq) - pos);
+
+		if (diff == 0)
+		{
+			if (AtomicCompareExchange (&cmdTail, pos, pos + 1))
+			{
+				slot->cmd = *cmd;
+				AtomicStore (&slot->seq, pos + 1);
+				return;
+			}
+			pos = AtomicLoad (&cmdTail);
+		}
+		else if (diff < 0)
+		{	// Full; the callback is not keeping up, or not running
+			flushCmds ();
+			pos = AtomicLoad (&cmdTail);
+		}
+		else
+		{	// Taken by another thread in the meantime
+			pos = AtomicLoad (&cmdTail);
+		}
+	}
+#else
+	runCmd (cmd);
+#endif
+}
+
+static void
+initCmdQueue (void)
+{
+#ifndef ATOMICS_USE_LOCK
+	uint32 i;
+
+	for (i = 0; i < MIX_CMD_QUEUE_SIZE; ++i)
+		AtomicStore (&cmdQueue[i].seq, i);
+	AtomicStore (&cmdTail, 0);
+	cmdHead = 0;
+	AtomicStore (&cmdRunning, 0);
+#endif
+}
+
 /*
  * Initialization
  */
@@ -110,6 +343,7 @@ mixSDL_Init (audio_Driver *driver, sint32 flags)
 	int i;
 	SDL_AudioSpec desired, obtained;
 	mixer_Quality quality;
+	Uint16 samples;
 	TFB_DecoderFormats formats =
 	{
 		MIX_IS_BIG_ENDIAN, MIX_WANT_BIG_ENDIAN,
@@ -150,6 +384,11 @@ mixSDL_Init (audio_Driver *driver, sint32 flags)
 		desired.samples = 4096;
 	}
 
+	samples = desired.samples;
+	latency.adaptive = (flags & audio_LOW_LATENCY) != 0;
+	if (latency.adaptive && desired.samples > MIX_LOW_LATENCY_SAMPLES)
+		desired.samples = MIX_LOW_LATENCY_SAMPLES;
+
 	desired.format = AUDIO_S16SYS;
 	desired.channels = 2;
 	desired.callback = audioCallback;
@@ -208,7 +447,15 @@ mixSDL_Init (audio_Driver *driver, sint32 flags)
 				obtained.samples);
 	}
 
+	latency.spec = obtained;
+	latency.maxSamples = samples > obtained.samples ? samples
+			: obtained.samples;
+	latency.stats.bufferSamples = obtained.samples;
+	latency.stats.bufferTime = (uint32) ((uint64) obtained.samples
+			* 1000000 / obtained.freq);
+
 	log_add (log_Info, "Initializing mixer.");
+	initCmdQueue ();
 	if (!mixer_Init (obtained.freq, MIX_FORMAT_MAKE (2, obtained.channels),
 			quality, 0))
 	{
@@ -265,6 +512,9 @@ mixSDL_Uninit (void)
 {
 	int i;
 
+	// Waits for the callback to finish; it must not wake the decoder
+	// while that is being torn down
+	SDL_PauseAudioDevice (dev, 1);
 	UninitStreamDecoder ();
 
 	for (i = 0; i < NUM_SOUNDSOURCES; ++i)
@@ -286,15 +536,121 @@ mixSDL_Uninit (void)
 	}
 
 	SDL_CloseAudioDevice (dev);
+	flushCmds ();
 	mixer_Uninit ();
 	SoundDecoder_Uninit ();
 	SDL_QuitSubSystem (SDL_INIT_AUDIO);
+
+	log_add (log_Info, "Audio output: %u samples buffer, %u underruns, "
+			"grown %u times, longest mix %u us",
+			latency.stats.bufferSamples, latency.stats.underruns,
+			latency.stats.grows, latency.stats.maxMixTime);
+	latency.adaptive = false;
+}
+
+// Called from the audio callback
+static void
+checkUnderrun (DWORD start)
+{
+	DWORD last = latency.lastCallback;
+
+	latency.lastCallback = start;
+	if (last == 0 || start - last <= latency.stats.bufferTime * 3 / 2)
+		return;
+
+	++latency.stats.underruns;
+	if (!latency.adaptive || latency.spec.samples >= latency.maxSamples)
+		return;
+
+	if (start - latency.windowStart > MIX_UNDERRUN_WINDOW)
+	{
+		latency.windowStart = start;
+		latency.windowUnderruns = 0;
+	}
+	if (++latency.windowUnderruns >= MIX_UNDERRUN_GROW_COUNT)
+		latency.growPending = true;
 }
 
 static void
 audioCallback (void *userdata, Uint8 *stream, int len)
 {
+	DWORD start = GetTimeMicroseconds ();
+	DWORD mixTime;
+
+	checkUnderrun (start);
+
+	runCmdsForCallback ();
 	mixer_MixChannels (userdata, stream, len);
+	WakeStreamDecoder ();
+
+	mixTime = GetTimeMicroseconds () - start;
+	if (mixTime > latency.stats.maxMixTime)
+		latency.stats.maxMixTime = mixTime;
+#ifdef TRACE_THREADS
+	TraceSpan ("audio callback", start);
+#endif
+}
+
+void
+mixSDL_GetLatencyStats (mixSDL_LatencyStats *stats)
+{
+	*stats = latency.stats;
+}
+
+void
+mixSDL_AdaptBuffer (void)
+{
+	SDL_AudioSpec desired;
+
+	if (!latency.growPending)
+		return;
+	latency.growPending = false;
+
+	desired = latency.spec;
+	desired.samples *= 2;
+	if (desired.samples > latency.maxSamples)
+		desired.samples = latency.maxSamples;
+
+	// Any format change is converted by SDL, as the mixer has been set
+	// up for the current one. There is a moment of silence while the
+	// device is closed, which is what an underrun sounds like anyway.
+	SDL_CloseAudioDevice (dev);
+#if SDL_MAJOR_VERSION > 1
+	dev = SDL_OpenAudioDevice (NULL, 0, &desired, NULL, 0);
+	if (dev == 0)
+#else
+	if (SDL_OpenAudio (&desired, NULL) < 0)
+#endif
+	{
+		log_add (log_Error, "Unable to reopen audio device with a %u "
+				"samples buffer: %s", desired.samples, SDL_GetError ());
+		// Try what worked before
+		desired.samples = latency.spec.samples;
+#if SDL_MAJOR_VERSION > 1
+		dev = SDL_OpenAudioDevice (NULL, 0, &desired, NULL, 0);
+		if (dev == 0)
+#else
+		if (SDL_OpenAudio (&desired, NULL) < 0)
+#endif
+		{
+			log_add (log_Error, "Unable to reopen audio device: %s",
+					SDL_GetError ());
+			latency.adaptive = false;
+			return;
+		}
+	}
+
+	latency.spec.samples = desired.samples;
+	latency.lastCallback = 0;
+	latency.windowUnderruns = 0;
+	latency.stats.bufferSamples = desired.samples;
+	latency.stats.bufferTime = (uint32) ((uint64) desired.samples
+			* 1000000 / desired.freq);
+	++latency.stats.grows;
+	log_add (log_Info, "Audio buffer underruns; buffer grown to %u "
+			"samples.", desired.samples);
+
+	SDL_PauseAudioDevice (dev, 0);
 }
 
 /*
@@ -304,7 +660,10 @@ audioCallback (void *userdata, Uint8 *stream, int len)
 sint32
 mixSDL_GetError (void)
 {
-	sint32 value = mixer_GetError ();
+	sint32 value;
+
+	flushCmds ();
+	value = mixer_GetError ();
 	switch (value)
 	{
 		case MIX_NO_ERROR:
@@ -334,18 +693,21 @@ mixSDL_GetError (void)
 void
 mixSDL_GenSources (uint32 n, audio_Object *psrcobj)
 {
+	flushCmds ();
 	mixer_GenSources (n, (mixer_Object *) psrcobj);
 }
 
 void
 mixSDL_DeleteSources (uint32 n, audio_Object *psrcobj)
 {
+	flushCmds ();
 	mixer_DeleteSources (n, (mixer_Object *) psrcobj);
 }
 
 bool
 mixSDL_IsSource (audio_Object srcobj)
 {
+	flushCmds ();
 	return mixer_IsSource ((mixer_Object) srcobj);
 }
 
@@ -354,28 +716,47 @@ mixSDL_Sourcei (audio_Object srcobj, audio_SourceProp pname,
 		audio_IntVal value)
 
 {
-	mixer_Sourcei ((mixer_Object) srcobj, (mixer_SourceProp) pname,
-			(mixer_IntVal) value);
+	MixCmd cmd;
+
+	cmd.op = MIX_CMD_SOURCEI;
+	cmd.src = (mixer_Object) srcobj;
+	cmd.pname = (mixer_SourceProp) pname;
+	cmd.value.i = (mixer_IntVal) value;
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_Sourcef (audio_Object srcobj, audio_SourceProp pname,
 		float value)
 {
-	mixer_Sourcef ((mixer_Object) srcobj, (mixer_SourceProp) pname, value);
+	MixCmd cmd;
+
+	cmd.op = MIX_CMD_SOURCEF;
+	cmd.src = (mixer_Object) srcobj;
+	cmd.pname = (mixer_SourceProp) pname;
+	cmd.value.f[0] = value;
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_Sourcefv (audio_Object srcobj, audio_SourceProp pname,
 		float *value)
 {
-	mixer_Sourcefv ((mixer_Object) srcobj, (mixer_SourceProp) pname, value);
+	MixCmd cmd;
+
+	cmd.op = MIX_CMD_SOURCEFV;
+	cmd.src = (mixer_Object) srcobj;
+	cmd.pname = (mixer_SourceProp) pname;
+	// MIX_POSITION is the only vector property
+	memcpy (cmd.value.f, value, sizeof cmd.value.f);
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_GetSourcei (audio_Object srcobj, audio_SourceProp pname,
 		audio_IntVal *value)
 {
+	flushCmds ();
 	mixer_GetSourcei ((mixer_Object) srcobj, (mixer_SourceProp) pname,
 			(mixer_IntVal *) value);
 	if (pname == MIX_SOURCE_STATE)
@@ -404,45 +785,78 @@ void
 mixSDL_GetSourcef (audio_Object srcobj, audio_SourceProp pname,
 		float *value)
 {
+	flushCmds ();
 	mixer_GetSourcef ((mixer_Object) srcobj, (mixer_SourceProp) pname, value);
 }
 
 void
 mixSDL_SourceRewind (audio_Object srcobj)
 {
-	mixer_SourceRewind ((mixer_Object) srcobj);
+	MixCmd cmd;
+
+	cmd.op = MIX_CMD_REWIND;
+	cmd.src = (mixer_Object) srcobj;
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_SourcePlay (audio_Object srcobj)
 {
-	mixer_SourcePlay ((mixer_Object) srcobj);
+	MixCmd cmd;
+
+	cmd.op = MIX_CMD_PLAY;
+	cmd.src = (mixer_Object) srcobj;
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_SourcePause (audio_Object srcobj)
 {
-	mixer_SourcePause ((mixer_Object) srcobj);
+	MixCmd cmd;
+
+	cmd.op = MIX_CMD_PAUSE;
+	cmd.src = (mixer_Object) srcobj;
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_SourceStop (audio_Object srcobj)
 {
-	mixer_SourceStop ((mixer_Object) srcobj);
+	MixCmd cmd;
+
+	cmd.op = MIX_CMD_STOP;
+	cmd.src = (mixer_Object) srcobj;
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_SourceQueueBuffers (audio_Object srcobj, uint32 n,
 		audio_Object* pbufobj)
 {
-	mixer_SourceQueueBuffers ((mixer_Object) srcobj, n,
-			(mixer_Object *) pbufobj);
+	MixCmd cmd;
+	uint32 i;
+
+	if (n > MIX_CMD_MAX_BUFFERS)
+	{
+		flushCmds ();
+		mixer_SourceQueueBuffers ((mixer_Object) srcobj, n,
+				(mixer_Object *) pbufobj);
+		return;
+	}
+
+	cmd.op = MIX_CMD_QUEUE_BUFFERS;
+	cmd.src = (mixer_Object) srcobj;
+	cmd.n = n;
+	for (i = 0; i < n; ++i)
+		cmd.value.bufs[i] = (mixer_Object) pbufobj[i];
+	queueCmd (&cmd);
 }
 
 void
 mixSDL_SourceUnqueueBuffers (audio_Object srcobj, uint32 n,
 		audio_Object* pbufobj)
 {
+	flushCmds ();
 	mixer_SourceUnqueueBuffers ((mixer_Object) srcobj, n,
 			(mixer_Object *) pbufobj);
 }
@@ -455,18 +869,21 @@ mixSDL_SourceUnqueueBuffers (audio_Object srcobj, uint32 n,
 void
 mixSDL_GenBuffers (uint32 n, audio_Object *pbufobj)
 {
+	flushCmds ();
 	mixer_GenBuffers (n, (mixer_Object *) pbufobj);
 }
 
 void
 mixSDL_DeleteBuffers (uint32 n, audio_Object *pbufobj)
 {
+	flushCmds ();
 	mixer_DeleteBuffers (n, (mixer_Object *) pbufobj);
 }
 
 bool
 mixSDL_IsBuffer (audio_Object bufobj)
 {
+	flushCmds ();
 	return mixer_IsBuffer ((mixer_Object) bufobj);
 }
 
@@ -474,6 +891,7 @@ void
 mixSDL_GetBufferi (audio_Object bufobj, audio_BufferProp pname,
 		audio_IntVal *value)
 {
+	flushCmds ();
 	mixer_GetBufferi ((mixer_Object) bufobj, (mixer_BufferProp) pname,
 			(mixer_IntVal *) value);
 }
@@ -482,5 +900,6 @@ void
 mixSDL_BufferData (audio_Object bufobj, uint32 format, void* data,
 		uint32 size, uint32 freq)
 {
+	flushCmds ();
 	mixer_BufferData ((mixer_Object) bufobj, format, data, size, freq);
 }
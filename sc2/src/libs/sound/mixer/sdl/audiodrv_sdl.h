@@ -30,6 +30,26 @@ sint32 mixSDL_Init (audio_Driver *driver, sint32 flags);
 void mixSDL_Uninit (void);
 sint32 mixSDL_GetError (void);
 
+/* Output latency */
+typedef struct
+{
+	uint32 bufferSamples;
+			// Current size of the device buffer
+	uint32 bufferTime;
+			// How long that buffer plays, in microseconds
+	uint32 underruns;
+			// Callbacks that came after the previous buffer ran out
+	uint32 grows;
+			// Times the buffer was made larger because of those
+	uint32 maxMixTime;
+			// The longest a callback took, in microseconds
+} mixSDL_LatencyStats;
+
+void mixSDL_GetLatencyStats (mixSDL_LatencyStats *stats);
+// With audio_LOW_LATENCY, reopens the device with a larger buffer when
+// it has been running dry. Must not be called from the audio callback.
+void mixSDL_AdaptBuffer (void);
+
 /* Sources */
 void mixSDL_GenSources (uint32 n, audio_Object *psrcobj);
 void mixSDL_DeleteSources (uint32 n, audio_Object *psrcobj);
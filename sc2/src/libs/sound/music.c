@@ -19,6 +19,7 @@
 #include "options.h"
 #include "sound.h"
 #include "sndintrn.h"
+#include "prefetch.h"
 #include "libs/reslib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
@@ -179,7 +180,7 @@ _GetMusicData (uio_Stream *fp, DWORD length)
 	CheckMusicResName (filename);
 
 	log_add (log_Info, "_GetMusicData(): loading %s", filename);
-	decoder = SoundDecoder_Load (contentDir, filename, 4096, 0, 0);
+	decoder = SoundPrefetch_Load (contentDir, filename, 4096, 0, 0);
 	if (!decoder)
 	{
 		log_add (log_Warning, "_GetMusicData(): couldn't load %s", filename);
@@ -0,0 +1,175 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include "pcmcache.h"
+#include "decoders/decoder.h"
+#include "libs/memlib.h"
+#include <string.h>
+
+struct pcm_cache_entry
+{
+	PCMCacheEntry *next;
+			// The list runs from the most to the least recently used
+	char *fileName;
+	TFB_DecoderFormats formats;
+	int flags;
+	uint32 format;
+	uint32 frequency;
+	float length;
+	void *data;
+	uint32 size;
+	int refCount;
+};
+
+static PCMCacheEntry *entries;
+static size_t cacheSize;
+static size_t cacheLimit = PCMCACHE_DEFAULT_LIMIT;
+
+static bool
+sameFormats (const TFB_DecoderFormats *a, const TFB_DecoderFormats *b)
+{
+	return a->big_endian == b->big_endian
+			&& a->want_big_endian == b->want_big_endian
+			&& a->mono8 == b->mono8 && a->stereo8 == b->stereo8
+			&& a->mono16 == b->mono16 && a->stereo16 == b->stereo16;
+}
+
+static void
+freeEntry (PCMCacheEntry *e)
+{
+	cacheSize -= e->size;
+	HFree (e->fileName);
+	HFree (e->data);
+	HFree (e);
+}
+
+static void
+evictToLimit (size_t limit)
+{
+	while (cacheSize > limit)
+	{
+		PCMCacheEntry **link;
+		PCMCacheEntry **victim = NULL;
+
+		for (link = &entries; *link != NULL; link = &(*link)->next)
+		{
+			if ((*link)->refCount == 0)
+				victim = link;
+		}
+		if (!victim)
+			break; // Everything left is in use
+
+		{
+			PCMCacheEntry *e = *victim;
+			*victim = e->next;
+			freeEntry (e);
+		}
+	}
+}
+
+void
+PCMCache_SetLimit (size_t bytes)
+{
+	cacheLimit = bytes;
+	evictToLimit (cacheLimit);
+}
+
+PCMCacheEntry *
+PCMCache_Get (const char *fileName)
+{
+	PCMCacheEntry **link;
+	TFB_DecoderFormats formats;
+	int flags;
+
+	if (cacheLimit == 0)
+		return NULL;
+
+	SoundDecoder_GetConfig (&formats, &flags);
+
+	for (link = &entries; *link != NULL; link = &(*link)->next)
+	{
+		PCMCacheEntry *e = *link;
+
+		if (e->flags == flags
+				&& sameFormats (&e->formats, &formats)
+				&& strcmp (e->fileName, fileName) == 0)
+		{
+			// Move to the front
+			*link = e->next;
+			e->next = entries;
+			entries = e;
+
+			++e->refCount;
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+PCMCacheEntry *
+PCMCache_Put (const char *fileName, uint32 format, uint32 frequency,
+		float length, const void *data, uint32 size)
+{
+	PCMCacheEntry *e;
+	size_t nameLen;
+
+	if (cacheLimit == 0 || size > cacheLimit / 4)
+		return NULL; // Would push out too much else
+
+	e = HMalloc (sizeof (PCMCacheEntry));
+	nameLen = strlen (fileName) + 1;
+	e->fileName = HMalloc (nameLen);
+	memcpy (e->fileName, fileName, nameLen);
+	SoundDecoder_GetConfig (&e->formats, &e->flags);
+	e->format = format;
+	e->frequency = frequency;
+	e->length = length;
+	e->data = HMalloc (size);
+	memcpy (e->data, data, size);
+	e->size = size;
+	e->refCount = 1;
+
+	e->next = entries;
+	entries = e;
+	cacheSize += size;
+
+	evictToLimit (cacheLimit);
+	return e;
+}
+
+void
+PCMCache_Release (PCMCacheEntry *entry)
+{
+	if (!entry)
+		return;
+
+	--entry->refCount;
+	if (entry->refCount == 0)
+		evictToLimit (cacheLimit);
+}
+
+void
+PCMCache_GetData (PCMCacheEntry *entry, uint32 *format, uint32 *frequency,
+		float *length, const void **data, uint32 *size)
+{
+	*format = entry->format;
+	*frequency = entry->frequency;
+	*length = entry->length;
+	*data = entry->data;
+	*size = entry->size;
+}
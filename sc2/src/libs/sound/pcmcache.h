@@ -0,0 +1,53 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef LIBS_SOUND_PCMCACHE_H_
+#define LIBS_SOUND_PCMCACHE_H_
+
+#include "types.h"
+#include <stddef.h>
+
+/* Cache of fully decoded sound effects, used by _GetSoundBankData().
+ * Entries are keyed on the file name and on the decoder configuration
+ * (output formats and quality flags), so the data always matches what
+ * decoding the file again would give. An entry is referenced by every
+ * loaded sample made from it. Once the cache holds more than the limit
+ * in bytes, the least recently used unreferenced entries are evicted;
+ * this is what lets a bank loaded again soon after its release, like
+ * the ships of the next melee battle, skip decoding altogether.
+ * To be called only from the thread that loads and frees resources. */
+
+// Default limit, overridden by config.pcmcachesize
+#define PCMCACHE_DEFAULT_LIMIT (8 * 1024 * 1024)
+
+typedef struct pcm_cache_entry PCMCacheEntry;
+
+void PCMCache_SetLimit (size_t bytes);
+		// 0 disables the cache, and frees every unreferenced entry
+
+// Returns the entry with a reference added, or NULL on a miss
+PCMCacheEntry *PCMCache_Get (const char *fileName);
+// Stores a copy of 'data' and returns the entry with a reference, or
+// NULL if it is not to be cached
+PCMCacheEntry *PCMCache_Put (const char *fileName, uint32 format,
+		uint32 frequency, float length, const void *data, uint32 size);
+void PCMCache_Release (PCMCacheEntry *entry);
+
+void PCMCache_GetData (PCMCacheEntry *entry, uint32 *format,
+		uint32 *frequency, float *length, const void **data, uint32 *size);
+
+#endif /* LIBS_SOUND_PCMCACHE_H_ */
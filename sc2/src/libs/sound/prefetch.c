@@ -0,0 +1,255 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include "prefetch.h"
+#include "options.h"
+#include "libs/tasklib.h"
+#include "libs/threadlib.h"
+#include "libs/log.h"
+#include <string.h>
+
+#define PREFETCH_SLOTS 8
+#define PREFETCH_AHEAD_BYTES (4 * PREFETCH_BUFFER_SIZE)
+		// The buffers PlayStream() queues first
+
+typedef enum
+{
+	PREFETCH_FREE,
+	PREFETCH_QUEUED,
+	PREFETCH_LOADING,
+	PREFETCH_READY,
+} PrefetchState;
+
+typedef struct
+{
+	PrefetchState state;
+	char fileName[128];
+	uint32 startTime;
+	DWORD seq;
+			// Which hint is the oldest
+	TFB_SoundDecoder *decoder;
+			// NULL if loading failed
+} PrefetchSlot;
+
+static PrefetchSlot slots[PREFETCH_SLOTS];
+static DWORD hintSeq;
+static Mutex prefetchMutex;
+static Semaphore prefetchWake;
+static Task prefetchTask;
+
+static PrefetchSlot *
+findSlot (const char *fileName, uint32 startTime)
+{
+	int i;
+
+	for (i = 0; i < PREFETCH_SLOTS; ++i)
+	{
+		PrefetchSlot *slot = &slots[i];
+		if (slot->state != PREFETCH_FREE && slot->startTime == startTime
+				&& strcmp (slot->fileName, fileName) == 0)
+			return slot;
+	}
+	return NULL;
+}
+
+static void
+freeSlot (PrefetchSlot *slot)
+{
+	if (slot->decoder)
+		SoundDecoder_Free (slot->decoder);
+	slot->decoder = NULL;
+	slot->state = PREFETCH_FREE;
+}
+
+static int
+PrefetchTaskFunc (void *data)
+{
+	Task task = (Task) data;
+
+	while (!Task_ReadState (task, TASK_EXIT))
+	{
+		PrefetchSlot *slot = NULL;
+		char fileName[sizeof slots[0].fileName];
+		uint32 startTime = 0;
+		TFB_SoundDecoder *decoder;
+		int i;
+
+		SetSemaphore (prefetchWake);
+
+		LockMutex (prefetchMutex);
+		for (i = 0; i < PREFETCH_SLOTS; ++i)
+		{
+			if (slots[i].state == PREFETCH_QUEUED
+					&& (!slot || slots[i].seq < slot->seq))
+				slot = &slots[i];
+		}
+		if (slot)
+		{
+			slot->state = PREFETCH_LOADING;
+			strcpy (fileName, slot->fileName);
+			startTime = slot->startTime;
+		}
+		UnlockMutex (prefetchMutex);
+
+		if (!slot)
+			continue; // Already taken, or just woken up to exit
+
+		decoder = SoundDecoder_LoadAhead (contentDir, fileName,
+				PREFETCH_BUFFER_SIZE, startTime, PREFETCH_AHEAD_BYTES);
+
+		LockMutex (prefetchMutex);
+		slot->decoder = decoder;
+		slot->state = PREFETCH_READY;
+		UnlockMutex (prefetchMutex);
+	}
+
+	FinishTask (task);
+	return 0;
+}
+
+void
+SoundPrefetch_Init (void)
+{
+	prefetchMutex = CreateMutex ("Sound prefetch mutex", SYNC_CLASS_AUDIO);
+	prefetchWake = CreateSemaphore (0, "Sound prefetch wake",
+			SYNC_CLASS_AUDIO);
+	prefetchTask = AssignTask (PrefetchTaskFunc, 1024,
+			"audio prefetch");
+	if (!prefetchTask)
+		log_add (log_Warning, "Could not start the sound prefetch task.");
+}
+
+void
+SoundPrefetch_Uninit (void)
+{
+	int i;
+
+	if (prefetchTask)
+	{
+		Task_SetState (prefetchTask, TASK_EXIT);
+		ClearSemaphore (prefetchWake);
+		ConcludeTask (prefetchTask);
+		prefetchTask = NULL;
+	}
+
+	for (i = 0; i < PREFETCH_SLOTS; ++i)
+		freeSlot (&slots[i]);
+
+	if (prefetchWake)
+	{
+		DestroySemaphore (prefetchWake);
+		prefetchWake = NULL;
+	}
+	if (prefetchMutex)
+	{
+		DestroyMutex (prefetchMutex);
+		prefetchMutex = NULL;
+	}
+}
+
+void
+SoundPrefetch_Hint (const char *fileName, uint32 startTime)
+{
+	PrefetchSlot *slot = NULL;
+	const char *ext;
+	int i;
+
+	if (!prefetchTask || strlen (fileName) >= sizeof slots[0].fileName)
+		return;
+
+	// MikMod keeps its player state in globals, so a module can only be
+	// opened on the thread that plays it
+	ext = strrchr (fileName, '.');
+	if (ext && strcmp (ext, ".mod") == 0)
+		return;
+
+	LockMutex (prefetchMutex);
+	if (findSlot (fileName, startTime))
+	{	// Already on it
+		UnlockMutex (prefetchMutex);
+		return;
+	}
+
+	for (i = 0; i < PREFETCH_SLOTS; ++i)
+	{
+		if (slots[i].state == PREFETCH_FREE)
+		{
+			slot = &slots[i];
+			break;
+		}
+		// Else make room by dropping the oldest unused one
+		if (slots[i].state == PREFETCH_READY
+				&& (!slot || slots[i].seq < slot->seq))
+			slot = &slots[i];
+	}
+	if (!slot)
+	{	// Everything is queued; this one will just load late
+		UnlockMutex (prefetchMutex);
+		return;
+	}
+
+	freeSlot (slot);
+	strcpy (slot->fileName, fileName);
+	slot->startTime = startTime;
+	slot->seq = hintSeq++;
+	slot->state = PREFETCH_QUEUED;
+	UnlockMutex (prefetchMutex);
+
+	ClearSemaphore (prefetchWake);
+}
+
+TFB_SoundDecoder *
+SoundPrefetch_Load (uio_DirHandle *dir, char *fileName, uint32 bufferSize,
+		uint32 startTime, sint32 runTime)
+{
+	PrefetchSlot *slot;
+	TFB_SoundDecoder *decoder;
+
+	if (!prefetchTask || dir != contentDir
+			|| bufferSize != PREFETCH_BUFFER_SIZE)
+		return SoundDecoder_Load (dir, fileName, bufferSize, startTime,
+				runTime);
+
+	LockMutex (prefetchMutex);
+	slot = findSlot (fileName, startTime);
+	while (slot && slot->state == PREFETCH_LOADING)
+	{	// Still faster than starting over
+		UnlockMutex (prefetchMutex);
+		HibernateThread (ONE_SECOND / 120);
+		LockMutex (prefetchMutex);
+		slot = findSlot (fileName, startTime);
+	}
+	if (!slot)
+	{
+		UnlockMutex (prefetchMutex);
+		return SoundDecoder_Load (dir, fileName, bufferSize, startTime,
+				runTime);
+	}
+
+	// A queued hint is not worth waiting for
+	decoder = slot->state == PREFETCH_READY ? slot->decoder : NULL;
+	slot->decoder = NULL;
+	slot->state = PREFETCH_FREE;
+	UnlockMutex (prefetchMutex);
+
+	if (!decoder)
+		return SoundDecoder_Load (dir, fileName, bufferSize, startTime,
+				runTime);
+
+	SoundDecoder_SetRunTime (decoder, runTime);
+	return decoder;
+}
@@ -0,0 +1,46 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef LIBS_SOUND_PREFETCH_H_
+#define LIBS_SOUND_PREFETCH_H_
+
+#include "types.h"
+#include "decoders/decoder.h"
+#include "libs/uio.h"
+
+/* Opening a sound file in the content packages and decoding its first
+ * buffers can take long enough on slow storage to delay a speech line
+ * or a music change. A hint makes a worker thread do that ahead of
+ * time; SoundPrefetch_Load() then hands over the ready decoder instead
+ * of opening the file again. Hints that are not used are dropped once
+ * newer ones need their slot. Hints are ignored while the stream
+ * decoder is not running. */
+
+#define PREFETCH_BUFFER_SIZE 4096
+		// What the track player and music loader ask for
+
+void SoundPrefetch_Init (void);
+void SoundPrefetch_Uninit (void);
+
+// 'startTime' is in milliseconds, as for SoundDecoder_Load()
+void SoundPrefetch_Hint (const char *fileName, uint32 startTime);
+// Same as SoundDecoder_Load(), using a prefetched decoder when there is
+// one. Waits for it if the worker is busy loading it.
+TFB_SoundDecoder *SoundPrefetch_Load (uio_DirHandle *dir, char *fileName,
+		uint32 bufferSize, uint32 startTime, sint32 runTime);
+
+#endif /* LIBS_SOUND_PREFETCH_H_ */
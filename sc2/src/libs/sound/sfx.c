@@ -17,6 +17,7 @@
 #include "options.h"
 #include "sound.h"
 #include "sndintrn.h"
+#include "pcmcache.h"
 #include "libs/reslib.h"
 #include "libs/log.h"
 #include "libs/strlib.h"
@@ -25,6 +26,7 @@
 		// for AllocStringTable(), FreeStringTable()
 #include "libs/memlib.h"
 #include <math.h>
+#include <string.h>
 
 
 #ifndef USE_RUST_AUDIO_HEART
@@ -112,12 +114,15 @@ SetPositionalObject (COUNT channel, void *positional_object)
 	soundSource[channel].positional_object = positional_object;
 }
 
-void
-UpdateSoundPosition (COUNT channel, SoundPosition pos)
+// The position last given to each sfx channel's source, so that
+// UpdateSoundPositionBatch() can leave out the ones that did not move
+static float lastSoundPos[NUM_SFX_CHANNELS][3];
+
+static void
+calcSourcePosition (SoundPosition pos, float fpos[3])
 {
 	const float ATTENUATION = 160.0f;
 	const float MIN_DISTANCE = 0.5f;
-	float fpos[3];
 
 	if (pos.positional)
 	{
@@ -134,16 +139,53 @@ UpdateSoundPosition (COUNT channel, SoundPosition pos)
 			fpos[0] *= scale;
 			fpos[2] *= scale;
 		}
-
-		audio_Sourcefv (soundSource[channel].handle, audio_POSITION, fpos);
-		//log_add (log_Debug, "UpdateSoundPosition(): channel %d, pos %d %d, posobj %x",
-		//		channel, pos.x, pos.y, (unsigned int)soundSource[channel].positional_object);
 	}
 	else
 	{
 		fpos[0] = fpos[1] = 0.0f;
 		fpos[2] = -1.0f;
-		audio_Sourcefv (soundSource[channel].handle, audio_POSITION, fpos);
+	}
+}
+
+static void
+setSourcePosition (COUNT channel, const float fpos[3])
+{
+	audio_Sourcefv (soundSource[channel].handle, audio_POSITION,
+			(float *) fpos);
+	if (channel < NUM_SFX_CHANNELS)
+		memcpy (lastSoundPos[channel], fpos, sizeof lastSoundPos[channel]);
+}
+
+void
+UpdateSoundPosition (COUNT channel, SoundPosition pos)
+{
+	float fpos[3];
+
+	calcSourcePosition (pos, fpos);
+	setSourcePosition (channel, fpos);
+	//log_add (log_Debug, "UpdateSoundPosition(): channel %d, pos %d %d, posobj %x",
+	//		channel, pos.x, pos.y, (unsigned int)soundSource[channel].positional_object);
+}
+
+// Sets the positions of several channels at once, at the end of a frame.
+// The sources of channels whose position did not change are not touched,
+// and the rest go to the mixer back to back, so that it applies them
+// together.
+void
+UpdateSoundPositionBatch (const ChannelPosition *positions, COUNT count)
+{
+	COUNT i;
+
+	for (i = 0; i < count; ++i)
+	{
+		COUNT channel = positions[i].channel;
+		float fpos[3];
+
+		calcSourcePosition (positions[i].pos, fpos);
+		if (channel < NUM_SFX_CHANNELS && memcmp (fpos,
+				lastSoundPos[channel], sizeof lastSoundPos[channel]) == 0)
+			continue;
+		setSourcePosition (channel, fpos);
 	}
 }
 
@@ -157,6 +199,17 @@ SetChannelVolume (COUNT channel, COUNT volume, BYTE priority)
 	(void)priority; // ignored
 }
 
+#else /* USE_RUST_AUDIO_HEART */
+
+void
+UpdateSoundPositionBatch (const ChannelPosition *positions, COUNT count)
+{
+	COUNT i;
+
+	for (i = 0; i < count; ++i)
+		UpdateSoundPosition (positions[i].channel, positions[i].pos);
+}
+
 #endif /* USE_RUST_AUDIO_HEART */
 
 void *
@@ -197,6 +250,7 @@ _GetSoundBankData (uio_Stream *fp, DWORD length)
 		TFB_SoundSample* sample;
 		TFB_SoundDecoder* decoder;
 		uint32 decoded_bytes;
+		PCMCacheEntry *cached;
 
 		if (sscanf (CurrentLine, "%s", &filename[n]) != 1)
 		{
@@ -205,6 +259,27 @@ _GetSoundBankData (uio_Stream *fp, DWORD length)
 			continue;
 		}
 
+		cached = PCMCache_Get (filename);
+		if (cached)
+		{	// Decoded before, for a bank that may have been freed since
+			uint32 format, freq, size;
+			const void *data;
+
+			log_add (log_Info, "_GetSoundBankData(): %s is cached",
+					filename);
+
+			sample = TFB_CreateSoundSample (NULL, 1, NULL);
+			PCMCache_GetData (cached, &format, &freq, &sample->length,
+					&data, &size);
+			audio_BufferData (sample->buffer[0], format, (void *) data,
+					size, freq);
+			sample->data = cached;
+
+			sndfx[snd_ct] = sample;
+			++snd_ct;
+			continue;
+		}
+
 		log_add (log_Info, "_GetSoundBankData(): loading %s", filename);
 
 		decoder = SoundDecoder_Load (contentDir, filename, 4096, 0, 0);
@@ -229,6 +304,10 @@ _GetSoundBankData (uio_Stream *fp, DWORD length)
 			decoder->buffer, decoded_bytes, decoder->frequency);
 		// just for informational purposes
 		sample->length = decoder->length;
+		// Keeps the PCM for the next time this file is loaded
+		sample->data = PCMCache_Put (filename, decoder->format,
+				decoder->frequency, decoder->length, decoder->buffer,
+				decoded_bytes);
 
 		SoundDecoder_Free (decoder);
 
@@ -243,7 +322,10 @@ _GetSoundBankData (uio_Stream *fp, DWORD length)
 	if (!Snd)
 	{	// Oops, have to delete everything now
 		while (snd_ct--)
+		{
+			PCMCache_Release (sndfx[snd_ct]->data);
 			TFB_DestroySoundSample (sndfx[snd_ct]);
+		}
 		
 		return NULL;
 	}
@@ -288,6 +370,8 @@ _ReleaseSoundBankData (void *Snd)
         if (sample->decoder)
 			SoundDecoder_Free (sample->decoder);
 		sample->decoder = NULL;
+		PCMCache_Release (sample->data);
+		sample->data = NULL;
 		TFB_DestroySoundSample (sample);
 		// sptr will be deleted by FreeStringTable() below
 	}
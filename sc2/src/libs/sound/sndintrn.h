@@ -24,7 +24,9 @@
 #include "libs/reslib.h"
 #include "libs/memlib.h"
 
-#define PAD_SCOPE_BYTES 256
+#define PAD_SCOPE_SAMPLES 128
+#define SCOPE_RATE 11025
+		// The oscilloscope ring keeps one sample per 1/SCOPE_RATE second
 
 extern void *_GetMusicData (uio_Stream *fp, DWORD length);
 extern BOOLEAN _ReleaseMusicData (void *handle);
@@ -63,12 +65,16 @@ typedef struct tfb_soundsource
 
 	audio_Object last_q_buf; // for callbacks processing
 
-	// Cyclic waveform buffer for oscilloscope
-	void *sbuffer; 
-	uint32 sbuf_size;
+	// Cyclic waveform buffer for oscilloscope, holding the downmixed
+	// peaks of the queued audio at SCOPE_RATE (half scale)
+	sint16 *sbuffer;
+	uint32 sbuf_size;        // in samples
 	uint32 sbuf_tail;
 	uint32 sbuf_head;
 	uint32 sbuf_lasttime;    // timestamp of the first queued buffer
+	uint32 sbuf_tail_acc;    // rate conversion remainders of tail ..
+	uint32 sbuf_head_acc;    // .. and head
+	sint32 sbuf_peak;        // peak of the partial sample at the tail
 } TFB_SoundSource;
 
 extern TFB_SoundSource soundSource[];
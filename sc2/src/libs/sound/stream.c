@@ -20,13 +20,32 @@
 		// for abs()
 #include "sound.h"
 #include "sndintrn.h"
+#include "prefetch.h"
+#include "mixer/sdl/audiodrv_sdl.h"
 #include "libs/tasklib.h"
 #include "libs/timelib.h"
+#include "libs/time/profile.h"
 #include "libs/threadlib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
 
 
+// Posted by the audio driver each time it has mixed a device buffer,
+// which is when queued stream buffers can have finished playing
+static Semaphore decoderWake;
+static volatile bool decoderWakeable;
+		// Set once a driver posts decoderWake; the decoder polls until then
+
+void
+WakeStreamDecoder (void)
+{
+	if (!decoderWake)
+		return;
+
+	decoderWakeable = true;
+	ClearSemaphore (decoderWake);
+}
+
 #ifndef USE_RUST_AUDIO_HEART
 
 static Task decoderTask;
@@ -38,6 +57,7 @@ static int musicFadeDelta;
 // Mutex protects fade structures
 static Mutex fade_mutex;
 
+static void start_scope (TFB_SoundSource *source, uint32 bytes);
 static void add_scope_data (TFB_SoundSource *source, uint32 bytes);
 
 
@@ -75,9 +95,9 @@ PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, bool scope,
 	if (scope)
 	{	// Prealloc the scope buffer in advance so that we do not
 		// realloc it a zillion times
-		soundSource[source].sbuf_size = sample->num_buffers *
-				decoder->buffer_size + PAD_SCOPE_BYTES;
-		soundSource[source].sbuffer = HCalloc (soundSource[source].sbuf_size);
+		start_scope (&soundSource[source], sample->num_buffers *
+				decoder->buffer_size);
+		scope = soundSource[source].sbuffer != NULL;
 	}
 
 	for (i = 0; i < sample->num_buffers; ++i)
@@ -146,6 +166,9 @@ StopStream (uint32 source)
 	soundSource[source].sbuf_size = 0;
 	soundSource[source].sbuf_head = 0;
 	soundSource[source].sbuf_tail = 0;
+	soundSource[source].sbuf_head_acc = 0;
+	soundSource[source].sbuf_tail_acc = 0;
+	soundSource[source].sbuf_peak = 0;
 	soundSource[source].pause_time = 0;
 }
 
@@ -196,6 +219,97 @@ PlayingStream (uint32 source)
 }
 
 
+// The mixer buffers of streams (music, speech) that were destroyed, for
+// the next ones, so that switching tracks does not delete and make them
+// again. Only samples with more than one buffer are streams; the buffer of
+// a sound effect may still be attached to a source, and they are loaded
+// for as long as their sound bank anyway.
+#define STREAM_BUFFER_POOL_SIZE 96
+static audio_Object streamBufferPool[STREAM_BUFFER_POOL_SIZE];
+static uint32 streamBufferPoolCount;
+static AtomicU32 streamBufferPoolLock;
+		// Samples are made and destroyed by the game, the track player and
+		// the resource loaders, before InitStreamDecoder() and after
+		// UninitStreamDecoder() too, so this cannot be a Mutex
+static bool streamBufferPoolOpen;
+		// Between InitStreamDecoder() and UninitStreamDecoder()
+
+static void
+lockStreamBufferPool (void)
+{
+	while (!AtomicCompareExchange (&streamBufferPoolLock, 0, 1))
+		TaskSwitch ();
+}
+
+static void
+unlockStreamBufferPool (void)
+{
+	AtomicStore (&streamBufferPoolLock, 0);
+}
+
+static void
+genStreamBuffers (uint32 n, audio_Object *pbufobj)
+{
+	uint32 taken = 0;
+
+	lockStreamBufferPool ();
+	if (streamBufferPoolOpen)
+	{
+		taken = n < streamBufferPoolCount ? n : streamBufferPoolCount;
+		streamBufferPoolCount -= taken;
+		memcpy (pbufobj, streamBufferPool + streamBufferPoolCount,
+				taken * sizeof (audio_Object));
+	}
+	unlockStreamBufferPool ();
+
+	if (taken < n)
+		audio_GenBuffers (n - taken, pbufobj + taken);
+}
+
+static void
+deleteStreamBuffers (uint32 n, audio_Object *pbufobj)
+{
+	uint32 kept = 0;
+
+	lockStreamBufferPool ();
+	if (streamBufferPoolOpen)
+	{
+		kept = STREAM_BUFFER_POOL_SIZE - streamBufferPoolCount;
+		if (kept > n)
+			kept = n;
+		memcpy (streamBufferPool + streamBufferPoolCount, pbufobj,
+				kept * sizeof (audio_Object));
+		streamBufferPoolCount += kept;
+	}
+	unlockStreamBufferPool ();
+
+	if (kept < n)
+		audio_DeleteBuffers (n - kept, pbufobj + kept);
+}
+
+static void
+openStreamBufferPool (void)
+{
+	lockStreamBufferPool ();
+	streamBufferPoolOpen = true;
+	unlockStreamBufferPool ();
+}
+
+static void
+closeStreamBufferPool (void)
+{
+	uint32 count;
+
+	lockStreamBufferPool ();
+	streamBufferPoolOpen = false;
+	count = streamBufferPoolCount;
+	streamBufferPoolCount = 0;
+	unlockStreamBufferPool ();
+
+	if (count > 0)
+		audio_DeleteBuffers (count, streamBufferPool);
+}
+
 TFB_SoundSample *
 TFB_CreateSoundSample (TFB_SoundDecoder *decoder, uint32 num_buffers,
 		const TFB_SoundCallbacks *pcbs /* can be NULL */)
@@ -206,7 +320,10 @@ TFB_CreateSoundSample (TFB_SoundDecoder *decoder, uint32 num_buffers,
 	sample->decoder = decoder;
 	sample->num_buffers = num_buffers;
 	sample->buffer = HCalloc (sizeof (audio_Object) * num_buffers);
-	audio_GenBuffers (num_buffers, sample->buffer);
+	if (num_buffers > 1)
+		genStreamBuffers (num_buffers, sample->buffer);
+	else
+		audio_GenBuffers (num_buffers, sample->buffer);
 	if (pcbs)
 		sample->callbacks = *pcbs;
 
@@ -219,7 +336,10 @@ TFB_DestroySoundSample (TFB_SoundSample *sample)
 {
 	if (sample->buffer)
 	{
-		audio_DeleteBuffers (sample->num_buffers, sample->buffer);
+		if (sample->num_buffers > 1)
+			deleteStreamBuffers (sample->num_buffers, sample->buffer);
+		else
+			audio_DeleteBuffers (sample->num_buffers, sample->buffer);
 		HFree (sample->buffer);
 	}
 	HFree (sample->buffer_tag);
@@ -307,48 +427,113 @@ TFB_ClearBufferTag (TFB_SoundTag *ptag)
 	ptag->buf_name = 0;
 }
 
+static inline sint32
+readSoundSample (void *ptr, int sample_size)
+{
+	if (sample_size == sizeof (uint8))
+		return (*(uint8*)ptr - 128) << 8;
+	else
+		return *(sint16*)ptr;
+}
+
+// Returns the number of scope samples that 'frames' more frames at
+// 'freq' make up, keeping the remainder in *acc. The buffers we get are
+// small enough for this not to overflow.
+static inline uint32
+scope_advance (uint32 *acc, uint32 frames, uint32 freq)
+{
+	uint32 total = *acc + frames * SCOPE_RATE;
+	*acc = total % freq;
+	return total / freq;
+}
+
+static void
+start_scope (TFB_SoundSource *source, uint32 bytes)
+{
+	TFB_SoundDecoder *decoder = source->sample->decoder;
+	int channels;
+	int sample_size;
+
+	source->sbuffer = NULL;
+	source->sbuf_size = 0;
+	if (!audio_GetFormatInfo (decoder->format, &channels, &sample_size)
+			|| decoder->frequency == 0)
+		return;
+
+	source->sbuf_head = 0;
+	source->sbuf_tail = 0;
+	source->sbuf_head_acc = 0;
+	source->sbuf_tail_acc = 0;
+	source->sbuf_peak = 0;
+	source->sbuf_size = bytes / (channels * sample_size) * SCOPE_RATE
+			/ decoder->frequency + 1 + PAD_SCOPE_SAMPLES;
+	source->sbuffer = HCalloc (source->sbuf_size * sizeof (sint16));
+}
+
 static void
 remove_scope_data (TFB_SoundSource *source, audio_Object buffer)
 {
+	TFB_SoundDecoder *decoder = source->sample->decoder;
 	audio_IntVal buf_size;
+	int channels;
+	int sample_size;
 
 	audio_GetBufferi (buffer, audio_SIZE, &buf_size);
-	source->sbuf_head += buf_size;
-	// the buffer is cyclic
-	source->sbuf_head %= source->sbuf_size;
+	if (audio_GetFormatInfo (decoder->format, &channels, &sample_size)
+			&& decoder->frequency != 0)
+	{
+		source->sbuf_head += scope_advance (&source->sbuf_head_acc,
+				buf_size / (channels * sample_size), decoder->frequency);
+		// the buffer is cyclic
+		source->sbuf_head %= source->sbuf_size;
+	}
 
 	source->sbuf_lasttime = GetTimeCounter ();
 }
 
+// Downmixes the decoded data and keeps the peak of every 1/SCOPE_RATE
+// second of it, which is all the oscilloscope can show anyway
 static void
 add_scope_data (TFB_SoundSource *source, uint32 bytes)
 {
-	uint8 *sbuffer = source->sbuffer;
-	uint8 *dec_buf = source->sample->decoder->buffer;
-	uint32 tail_bytes;
-	uint32 wrap_bytes;
-								
-	if (source->sbuf_tail + bytes > source->sbuf_size)
-	{	// does not fit at the tail, have to split it up
-		tail_bytes = source->sbuf_size - source->sbuf_tail;
-		wrap_bytes = bytes - tail_bytes;
-	}
-	else
-	{	// all fits at the tail
-		tail_bytes = bytes;
-		wrap_bytes = 0;
-	}
-	
-	if (tail_bytes)
-	{
-		memcpy (sbuffer + source->sbuf_tail, dec_buf, tail_bytes);
-		source->sbuf_tail += tail_bytes;
-	}
+	TFB_SoundDecoder *decoder = source->sample->decoder;
+	uint8 *dec_buf = decoder->buffer;
+	sint16 *sbuffer = source->sbuffer;
+	int channels;
+	int sample_size;
+	int full_sample;
+	uint32 freq = decoder->frequency;
+	uint32 frames;
+	uint32 i;
+
+	if (!audio_GetFormatInfo (decoder->format, &channels, &sample_size)
+			|| freq == 0)
+		return;
+	full_sample = channels * sample_size;
 
-	if (wrap_bytes)
+	frames = bytes / full_sample;
+	for (i = 0; i < frames; ++i, dec_buf += full_sample)
 	{
-		memcpy (sbuffer, dec_buf + tail_bytes, wrap_bytes);
-		source->sbuf_tail = wrap_bytes;
+		sint32 s;
+		bool filled = false;
+
+		s = readSoundSample (dec_buf, sample_size);
+		if (channels > 1)
+			s += readSoundSample (dec_buf + sample_size, sample_size);
+		if (abs (s) > abs (source->sbuf_peak))
+			source->sbuf_peak = s;
+
+		source->sbuf_tail_acc += SCOPE_RATE;
+		while (source->sbuf_tail_acc >= freq)
+		{
+			source->sbuf_tail_acc -= freq;
+			sbuffer[source->sbuf_tail] = (sint16) (source->sbuf_peak / 2);
+			if (++source->sbuf_tail == source->sbuf_size)
+				source->sbuf_tail = 0;
+			filled = true;
+		}
+		if (filled)
+			source->sbuf_peak = 0;
 	}
 }
 
@@ -546,6 +731,8 @@ StreamDecoderTaskFunc (void *data)
 		active_streams = 0;
 
 		processMusicFade ();
+		if (snddriver == audio_DRIVER_MIXSDL)
+			mixSDL_AdaptBuffer ();
 
 		for (i = MUSIC_SOURCE; i < NUM_SOUNDSOURCES; ++i)
 		{
@@ -562,7 +749,9 @@ StreamDecoderTaskFunc (void *data)
 				continue;
 			}
 
+			PROFILE_BEGIN (PROF_AUDIO);
 			process_stream (source);
+			PROFILE_END (PROF_AUDIO);
 			active_streams++;
 
 			UnlockMutex (source->stream_mutex);
@@ -572,6 +761,10 @@ StreamDecoderTaskFunc (void *data)
 		{	// Throttle down the thread when there are no active streams
 			HibernateThread (ONE_SECOND / 10);
 		}
+		else if (decoderWakeable)
+		{	// Nothing more to refill until the mixer has played something
+			SetSemaphore (decoderWake);
+		}
 		else
 			TaskSwitch ();
 	}
@@ -580,15 +773,6 @@ StreamDecoderTaskFunc (void *data)
 	return 0;
 }
 
-static inline sint32
-readSoundSample (void *ptr, int sample_size)
-{
-	if (sample_size == sizeof (uint8))
-		return (*(uint8*)ptr - 128) << 8;
-	else
-		return *(sint16*)ptr;
-}
-
 // Graphs the current sound data for the oscilloscope.
 // Includes a rudimentary automatic gain control (AGC) to properly graph
 // the streams at different gain levels (based on running average).
@@ -600,14 +784,10 @@ GraphForegroundStream (uint8 *data, sint32 width, sint32 height,
 {
 	int source_num;
 	TFB_SoundSource *source;
-	TFB_SoundDecoder *decoder;
-	int channels;
-	int sample_size;
-	int full_sample;
 	int step;
 	long played_time;
 	long delta;
-	uint8 *sbuffer;
+	sint16 *sbuffer;
 	unsigned long pos;
 	int scale;
 	sint32 i;
@@ -665,22 +845,10 @@ GraphForegroundStream (uint8 *data, sint32 width, sint32 height,
 		UnlockMutex (source->stream_mutex);
 		return 0;
 	}
-	decoder = source->sample->decoder;
-
-	if (!audio_GetFormatInfo (decoder->format, &channels, &sample_size))
-	{
-		UnlockMutex (source->stream_mutex);
-		log_add (log_Debug, "GraphForegroundStream(): uknown format %u",
-				(unsigned)decoder->format);
-		return 0;
-	}
-	full_sample = channels * sample_size;
 
 	// See how far into the buffer we should be now
 	played_time = GetTimeCounter () - source->sbuf_lasttime;
-	delta = played_time * decoder->frequency * full_sample / ONE_SECOND;
-	// align delta to sample start
-	delta = delta & ~(full_sample - 1);
+	delta = played_time * SCOPE_RATE / ONE_SECOND;
 
 	if (delta < 0)
 	{
@@ -693,12 +861,6 @@ GraphForegroundStream (uint8 *data, sint32 width, sint32 height,
 		delta = 0;
 	}
 
-	// Step is in 11025 Hz units, so we need to adjust to source frequency
-	step = decoder->frequency * step / 11025;
-	if (step == 0)
-		step = 1;
-	step *= full_sample;
-
 	sbuffer = source->sbuffer;
 	pos = source->sbuf_head + delta;
 
@@ -716,9 +878,7 @@ GraphForegroundStream (uint8 *data, sint32 width, sint32 height,
 
 		pos %= source->sbuf_size;
 
-		s = readSoundSample (sbuffer + pos, sample_size);
-		if (channels > 1)
-			s += readSoundSample (sbuffer + pos + sample_size, sample_size);
+		s = sbuffer[pos] * 2;
 
 		energy += (s * s) / 0x10000;
 		t = abs(s);
@@ -791,28 +951,48 @@ InitStreamDecoder (void)
 	if (!fade_mutex)
 		return -1;
 
+	decoderWake = CreateSemaphore (0, "Stream decoder wake",
+			SYNC_CLASS_AUDIO);
+	decoderWakeable = false;
+
 	decoderTask = AssignTask (StreamDecoderTaskFunc, 1024, 
 		"audio stream decoder");
 	if (!decoderTask)
 		return -1;
 
+	SoundPrefetch_Init ();
+	openStreamBufferPool ();
+
 	return 0;
 }
 
 void
 UninitStreamDecoder (void)
 {
+	SoundPrefetch_Uninit ();
+
 	if (decoderTask)
 	{
+		Task_SetState (decoderTask, TASK_EXIT);
+		ClearSemaphore (decoderWake);
 		ConcludeTask (decoderTask);
 		decoderTask = NULL;
 	}
 
+	// The driver has stopped posting by now
+	if (decoderWake)
+	{
+		DestroySemaphore (decoderWake);
+		decoderWake = NULL;
+	}
+
 	if (fade_mutex)
 	{
 		DestroyMutex (fade_mutex);
 		fade_mutex = NULL;
 	}
+
+	closeStreamBufferPool ();
 }
 
 #endif /* USE_RUST_AUDIO_HEART */
@@ -19,6 +19,9 @@
 
 int InitStreamDecoder (void);
 void UninitStreamDecoder (void);
+// Called by the audio driver after mixing, from any thread. Must not be
+// called any more once UninitStreamDecoder() has started.
+void WakeStreamDecoder (void);
 
 void PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, 
 				 bool scope, bool rewind);
@@ -18,8 +18,10 @@
 #include "sndintrn.h"
 #include "libs/sound/trackplayer.h"
 #include "trackint.h"
+#include "prefetch.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/memory/arena.h"
 #include "options.h"
 #include <ctype.h>
 #include <stdlib.h>
@@ -46,6 +48,23 @@ static TFB_SoundChunk *last_sub;      // last chunk in the list with a subtitle
 static TFB_SoundChunk *cur_chunk;     // currently playing chunk
 static TFB_SoundChunk *cur_sub_chunk; // currently displayed subtitle chunk
 
+// Time index of the chunks list, so that seek_track() does not have to
+// walk the whole list on every smooth seek step. Built on the first seek
+// after the list has changed.
+typedef struct
+{
+	sint32 end_time;          // chunk_end_time() of 'chunk'
+	TFB_SoundChunk *chunk;
+	TFB_SoundChunk *last_tag; // last chunk with tag_me up to 'chunk'
+} TrackSeekEntry;
+
+static TrackSeekEntry *seek_index;
+static int seek_index_size;           // 0 when the index must be rebuilt
+
+// The subtitle pages of all the chunks, let go of together by StopTrack()
+static MemArena *sub_text_arena;
+#define SUB_TEXT_ARENA_CHUNK 8192
+
 // Accesses to cur_chunk and cur_sub_chunk are guarded by stream_mutex,
 // because these should only be accesses by the DoInput and the
 // stream player threads. Any other accesses would go unguarded.
@@ -56,6 +75,7 @@ static TFB_SoundChunk *cur_sub_chunk; // currently displayed subtitle chunk
 // structures the same way.
 
 static void seek_track (sint32 offset);
+static void invalidate_seek_index (void);
 
 // stream callbacks
 static bool OnStreamStart (TFB_SoundSample* sample);
@@ -180,6 +200,7 @@ StopTrack (void)
 	cur_sub_chunk = NULL;
 	UnlockMutex (soundSource[SPEECH_SOURCE].stream_mutex);
 
+	invalidate_seek_index ();
 	if (chunks_head)
 	{
 		chunks_tail = NULL;
@@ -187,6 +208,8 @@ StopTrack (void)
 		chunks_head = NULL;
 		last_sub = NULL;
 	}
+	if (sub_text_arena)
+		MemArena_reset (sub_text_arena);
 	if (sound_sample)
 	{
 		// We delete the decoders ourselves
@@ -299,12 +322,12 @@ GetTimeStamps (UNICODE *TimeStamps, sint32 *time_stamps)
 	
 	while (*TimeStamps && (pos = strcspn (TimeStamps, ",\r\n")))
 	{
-		UNICODE valStr[32];
+		char *end;
 		uint32 val;
 		
-		memcpy (valStr, TimeStamps, pos);
-		valStr[pos] = '\0';
-		val = strtoul (valStr, NULL, 10);
+		val = strtoul (TimeStamps, &end, 10);
+		if (end > TimeStamps + pos)
+			val = 0; // the number is not in this field
 		if (val)
 		{
 			*time_stamps = val;
@@ -317,15 +340,43 @@ GetTimeStamps (UNICODE *TimeStamps, sint32 *time_stamps)
 	return (num);
 }
 
+// Appends 'text' to the subtitle of 'chunk'
+static void
+append_sub_text (TFB_SoundChunk *chunk, const UNICODE *text)
+{
+	size_t slen1 = strlen (chunk->text);
+	size_t slen2 = strlen (text);
+
+	chunk->text = MemArena_realloc (sub_text_arena, chunk->text,
+			slen1 + 1, slen1 + slen2 + 1);
+	strcpy (chunk->text + slen1, text);
+}
+
+#define MAX_PAGES 50
 #define TEXT_SPEED 80
-// Returns number of parsed pages
+// Returns number of parsed pages. The pages are made in one block of
+// sub_text_arena. 'prefix', unless NULL, is put in front of the first
+// page; that is how a subtitle is continued.
 static int
-SplitSubPages (UNICODE *text, UNICODE *pages[], sint32 timestamp[], int size)
+SplitSubPages (const UNICODE *prefix, UNICODE *text, UNICODE *pages[],
+		sint32 timestamp[], int size)
 {
+	int lengths[MAX_PAGES];
+	BYTE aft_ellipses[MAX_PAGES];
+	size_t prefix_len = prefix ? strlen (prefix) : 0;
+	size_t total = prefix_len;
 	int lead_ellips = 0;
-	COUNT page;
+	int num_pages;
+	int page;
+	UNICODE *dst;
+
+	if (!sub_text_arena)
+		sub_text_arena = MemArena_new (SUB_TEXT_ARENA_CHUNK);
+	if (size > MAX_PAGES)
+		size = MAX_PAGES;
 	
-	for (page = 0; page < size && *text != '\0'; ++page)
+	// Find the pages first, so they can be allocated all at once
+	for (num_pages = 0; num_pages < size && *text != '\0'; ++num_pages)
 	{
 		int aft_ellips;
 		int pos;
@@ -336,24 +387,55 @@ SplitSubPages (UNICODE *text, UNICODE *pages[], sint32 timestamp[], int size)
 		//   are used exclusively
 		aft_ellips = 3 * (text[pos] != '\0' && pos > 0 &&
 				!ispunct (text[pos - 1]) && !isspace (text[pos - 1]));
-		pages[page] = HMalloc (sizeof (UNICODE) *
-				(lead_ellips + pos + aft_ellips + 1));
-		if (lead_ellips)
-			strcpy (pages[page], "..");
-		memcpy (pages[page] + lead_ellips, text, pos);
-		pages[page][lead_ellips + pos] = '\0'; // string term
-		if (aft_ellips)
-			strcpy (pages[page] + lead_ellips + pos, "...");
-		timestamp[page] = pos * TEXT_SPEED;
-		if (timestamp[page] < 1000)
-			timestamp[page] = 1000;
+		pages[num_pages] = text;
+				// where the page starts, for now
+		lengths[num_pages] = pos;
+		aft_ellipses[num_pages] = aft_ellips;
+		total += lead_ellips + pos + aft_ellips + 1;
 		lead_ellips = aft_ellips ? 2 : 0;
 		text += pos;
 		// Skip any EOL
 		text += strspn (text, "\r\n");
 	}
+	if (num_pages == 0)
+		return 0;
+
+	dst = MemArena_alloc (sub_text_arena, sizeof (UNICODE) * total);
+	if (!dst)
+		return 0;
+
+	lead_ellips = 0;
+	for (page = 0; page < num_pages; ++page)
+	{
+		const UNICODE *src = pages[page];
+
+		pages[page] = dst;
+		if (page == 0 && prefix_len)
+		{
+			memcpy (dst, prefix, prefix_len);
+			dst += prefix_len;
+		}
+		if (lead_ellips)
+		{
+			memcpy (dst, "..", 2);
+			dst += 2;
+		}
+		memcpy (dst, src, lengths[page]);
+		dst += lengths[page];
+		if (aft_ellipses[page])
+		{
+			memcpy (dst, "...", 3);
+			dst += 3;
+		}
+		*dst++ = '\0'; // string term
+
+		timestamp[page] = lengths[page] * TEXT_SPEED;
+		if (timestamp[page] < 1000)
+			timestamp[page] = 1000;
+		lead_ellips = aft_ellipses[page] ? 2 : 0;
+	}
 
-	return page;
+	return num_pages;
 }
 
 // decodes several tracks into one and adds it to queue
@@ -367,7 +449,6 @@ SpliceMultiTrack (UNICODE *TrackNames[], UNICODE *TrackText)
 #define MAX_MULTI_BUFFERS 100
 	TFB_SoundDecoder* track_decs[MAX_MULTI_TRACKS + 1];
 	int tracks;
-	int slen1, slen2;
 
 	if (!TrackText)
 	{
@@ -395,6 +476,7 @@ SpliceMultiTrack (UNICODE *TrackNames[], UNICODE *TrackText)
 					track_decs[tracks]->format);
 			SoundDecoder_DecodeAll (track_decs[tracks]);
 
+			invalidate_seek_index ();
 			chunks_tail->next = create_SoundChunk (track_decs[tracks], sound_sample->length);
 			chunks_tail = chunks_tail->next;
 			chunks_tail->track_num = track_count - 1;
@@ -415,10 +497,7 @@ SpliceMultiTrack (UNICODE *TrackNames[], UNICODE *TrackText)
 		return;
 	}
 
-	slen1 = strlen (last_sub->text);
-	slen2 = strlen (TrackText);
-	last_sub->text = HRealloc (last_sub->text, slen1 + slen2 + 1);
-	strcpy (last_sub->text + slen1, TrackText);
+	append_sub_text (last_sub, TrackText);
 
 	no_page_break = 1;
 }
@@ -429,7 +508,6 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 {
 	static UNICODE last_track_name[128] = "";
 	static unsigned long dec_offset = 0;
-#define MAX_PAGES 50
 	UNICODE *pages[MAX_PAGES];
 	sint32 time_stamps[MAX_PAGES];
 	int num_pages;
@@ -440,8 +518,6 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 
 	if (!TrackName)
 	{	// Appending a piece of subtitles to the last track
-		int slen1, slen2;
-
 		if (track_count == 0)
 		{
 			log_add (log_Warning, "SpliceTrack(): Tried to append a subtitle,"
@@ -456,7 +532,9 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 			return;
 		}
 		
-		num_pages = SplitSubPages (TrackText, pages, time_stamps, MAX_PAGES);
+		// The first piece goes on the last subtitle page
+		num_pages = SplitSubPages (last_sub->text, TrackText, pages,
+				time_stamps, MAX_PAGES);
 		if (num_pages == 0)
 		{
 			log_add (log_Warning, "SpliceTrack(): Failed to parse subtitles");
@@ -466,12 +544,7 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 		// actually play to the end.
 		time_stamps[num_pages - 1] = -time_stamps[num_pages - 1];
 
-		// Add the first piece to the last subtitle page
-		slen1 = strlen (last_sub->text);
-		slen2 = strlen (pages[0]);
-		last_sub->text = HRealloc (last_sub->text, slen1 + slen2 + 1);
-		strcpy (last_sub->text + slen1, pages[0]);
-		HFree (pages[0]);
+		last_sub->text = pages[0];
 		
 		// Add the rest of the pages
 		for (page = 1; page < num_pages; ++page)
@@ -484,7 +557,7 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 			}
 			else
 			{	// probably no timestamps were provided, so need more work
-				TFB_SoundDecoder *decoder = SoundDecoder_Load (contentDir,
+				TFB_SoundDecoder *decoder = SoundPrefetch_Load (contentDir,
 						last_track_name, 4096, dec_offset, time_stamps[page]);
 				if (!decoder)
 				{
@@ -492,6 +565,7 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 					break;
 				}
 				dec_offset += (unsigned long)(decoder->length * 1000);
+				invalidate_seek_index ();
 				chunks_tail->next = create_SoundChunk (decoder, sound_sample->length);
 				chunks_tail = chunks_tail->next;
 				chunks_tail->tag_me = 1;
@@ -511,7 +585,11 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 
 		utf8StringCopy (last_track_name, sizeof (last_track_name), TrackName);
 
-		num_pages = SplitSubPages (TrackText, pages, time_stamps, MAX_PAGES);
+		// Without a page break, the first piece goes on the last subtitle
+		// page
+		num_pages = SplitSubPages (no_page_break && track_count ?
+				last_sub->text : NULL, TrackText, pages, time_stamps,
+				MAX_PAGES);
 		if (num_pages == 0)
 		{
 			log_add (log_Warning, "SpliceTrack(): Failed to parse sutitles");
@@ -522,15 +600,7 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 		time_stamps[num_pages - 1] = -time_stamps[num_pages - 1];
 
 		if (no_page_break && track_count)
-		{
-			int slen1, slen2;
-
-			slen1 = strlen (last_sub->text);
-			slen2 = strlen (pages[0]);
-			last_sub->text = HRealloc (last_sub->text, slen1 + slen2 + 1);
-			strcpy (last_sub->text + slen1, pages[0]);
-			HFree (pages[0]);
-		}
+			last_sub->text = pages[0];
 		else
 			track_count++;
 
@@ -559,7 +629,7 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 		dec_offset = 0;
 		for (page = 0; page < num_timestamps; ++page)
 		{
-			TFB_SoundDecoder *decoder = SoundDecoder_Load (contentDir,
+			TFB_SoundDecoder *decoder = SoundPrefetch_Load (contentDir,
 					TrackName, 4096, dec_offset, time_stamps[page]);
 			if (!decoder)
 			{
@@ -567,6 +637,7 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 				break;
 			}
 
+			invalidate_seek_index ();
 			if (!sound_sample)
 			{
 				sound_sample = TFB_CreateSoundSample (NULL, 8, &trackCBs);
@@ -603,6 +674,58 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 	}
 }
 
+static void
+invalidate_seek_index (void)
+{
+	HFree (seek_index);
+	seek_index = NULL;
+	seek_index_size = 0;
+}
+
+static void
+build_seek_index (void)
+{
+	TFB_SoundChunk *cur;
+	TFB_SoundChunk *last_tag = NULL;
+	int count = 0;
+	int i;
+
+	for (cur = chunks_head; cur; cur = cur->next)
+		++count;
+	if (count == 0)
+		return;
+
+	seek_index = HMalloc (count * sizeof (seek_index[0]));
+	for (cur = chunks_head, i = 0; cur; cur = cur->next, ++i)
+	{
+		if (cur->tag_me)
+			last_tag = cur;
+		seek_index[i].end_time = chunk_end_time (cur);
+		seek_index[i].chunk = cur;
+		seek_index[i].last_tag = last_tag;
+	}
+	seek_index_size = count;
+}
+
+// Returns the index of the first chunk that ends after 'offset',
+// or seek_index_size if there is none
+static int
+find_seek_entry (sint32 offset)
+{
+	int lo = 0;
+	int hi = seek_index_size;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (offset >= seek_index[mid].end_time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 // This function figures out the chunk that should be playing based on
 // 'offset' into the total playing time of all tracks. It then sets
 // the speech source's sample to the necessary decoder and seeks the
@@ -613,8 +736,9 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 static void
 seek_track (sint32 offset)
 {
-	TFB_SoundChunk *cur;
+	TFB_SoundChunk *cur = NULL;
 	TFB_SoundChunk *last_tag = NULL;
+	int entry;
 
 	if (!sound_sample)
 		return; // nothing to recompute
@@ -629,15 +753,17 @@ seek_track (sint32 offset)
 	soundSource[SPEECH_SOURCE].start_time = GetTimeCounter () - offset;
 	
 	// Find the chunk that should be playing at this time offset
-	for (cur = chunks_head; cur && offset >= chunk_end_time (cur);
-			cur = cur->next)
+	if (seek_index_size == 0)
+		build_seek_index ();
+	entry = find_seek_entry (offset);
+	if (entry < seek_index_size)
 	{
-		// .. looking for the last callback as we go along
+		cur = seek_index[entry].chunk;
+		// .. and the last callback before it
 		// XXX: this effectively set the last point where Fot is looking at.
 		// TODO: this should be somehow changed if we implement more
 		//   callbacks, like Melnorme trading, offloading at Starbase, etc.
-		if (cur->tag_me)
-			last_tag = cur;
+		last_tag = seek_index[entry].last_tag;
 	}
 
 	if (cur)
@@ -650,8 +776,6 @@ seek_track (sint32 offset)
 		SoundDecoder_Seek (cur->decoder, seekTime);
 		sound_sample->decoder = cur->decoder;
 		
-		if (cur->tag_me)
-			last_tag = cur;
 		if (last_tag)
 			DoTrackTag (last_tag);
 	}
@@ -800,7 +924,7 @@ destroy_SoundChunk_list (TFB_SoundChunk *chunk)
 		next = chunk->next;
 		if (chunk->decoder)
 			SoundDecoder_Free (chunk->decoder);
-		HFree (chunk->text);
+		// The text is in sub_text_arena
 		HFree (chunk);
 	}
 }
@@ -883,3 +1007,10 @@ GetTrackSubtitle (void)
 
 #endif /* USE_RUST_AUDIO_HEART */
 
+void
+PrefetchTrack (UNICODE *TrackName)
+{
+	if (TrackName)
+		SoundPrefetch_Hint (TrackName, 0);
+}
+
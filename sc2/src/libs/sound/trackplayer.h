@@ -38,6 +38,8 @@ extern void FastForward_Page (void);
 
 extern void SpliceTrack (UNICODE *filespec, UNICODE *textspec, UNICODE *TimeStamp, CallbackFunction cb);
 extern void SpliceMultiTrack (UNICODE *TrackNames[], UNICODE *TrackText);
+// Starts loading a speech clip that is about to be spliced in
+extern void PrefetchTrack (UNICODE *TrackName);
 
 extern int GetTrackPosition (int in_units);
 
@@ -42,40 +42,36 @@ dword_convert (DWORD *dword_array, COUNT num_dwords)
 	} while (--num_dwords);
 }
 
-static STRING
-set_strtab_entry (STRING_TABLE_DESC *strtab, int index, const char *value,
-		int len)
+// Point the entries at their strings, which follow each other in 'data'.
+// 'data' must be in the arena of the table. Returns the end of the
+// strings.
+static char *
+set_strtab_entries (STRING_TABLE_DESC *strtab, size_t firstIndex,
+		size_t count, char *data, const DWORD *lens)
 {
-	STRING str = &strtab->strings[index];
+	size_t stringI;
 
-	if (str->data)
-	{
-		HFree (str->data);
-		str->data = NULL;
-		str->length = 0;
-	}
-	if (len)
+	for (stringI = 0; stringI < count; stringI++)
 	{
-		str->data = HMalloc (len);
-		str->length = len;
-		memcpy (str->data, value, len);
+		STRING str = &strtab->strings[firstIndex + stringI];
+
+		str->data = lens[stringI] ? data : NULL;
+		str->length = lens[stringI];
+		data += lens[stringI];
 	}
-	return str;
+	return data;
 }
 
-static void
-copy_strings_to_strtab (STRING_TABLE_DESC *strtab, size_t firstIndex,
-		size_t count, const char *data, const DWORD *lens)
+// Copy the strings in 'data' to 'arena' and point the entries at them.
+// Returns where the next strings go.
+static char *
+copy_strings_to_arena (STRING_TABLE_DESC *strtab, size_t firstIndex,
+		size_t count, char *arena, const char *data, size_t size,
+		const DWORD *lens)
 {
-	size_t stringI;
-	const char *off = data;
-
-	for (stringI = 0; stringI < count; stringI++)
-	{
-		set_strtab_entry(strtab, firstIndex + stringI,
-				off, lens[stringI]);
-		off += lens[stringI];
-	}
+	if (size)
+		memcpy (arena, data, size);
+	return set_strtab_entries (strtab, firstIndex, count, arena, lens);
 }
 
 // Check whether a buffer has a certain minimum size, and enlarge it
@@ -418,34 +414,39 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 		result = AllocStringTable (stringCount, flags);
 		if (result)
 		{
-			// Copy all the gatherered data in a STRING_TABLE
+			// Copy all the gatherered data in a STRING_TABLE, all of
+			// it in one block
 			STRING_TABLE_DESC *lpST = (STRING_TABLE) result;
 			STRING str;
+			char *arena;
 			stringI = 0;
 
+			arena = HMalloc (StringOffs + NameOffs + ClipOffs + TSOffs);
+			lpST->arena = arena;
+
 			// Store the dialog string.
-			copy_strings_to_strtab (
-					lpST, stringI, stringCount, strdata, slen);
+			arena = copy_strings_to_arena (lpST, stringI, stringCount,
+					arena, strdata, StringOffs, slen);
 			stringI += stringCount;
 			
 			// Store the dialog names.
-			copy_strings_to_strtab (
-					lpST, stringI, stringCount, namedata, nlen);
+			arena = copy_strings_to_arena (lpST, stringI, stringCount,
+					arena, namedata, NameOffs, nlen);
 			stringI += stringCount;
 				
 			// Store sound clip file names.
 			if (lpST->flags & HAS_SOUND_CLIPS)
 			{
-				copy_strings_to_strtab (
-						lpST, stringI, stringCount, clipdata, clen);
+				arena = copy_strings_to_arena (lpST, stringI,
+						stringCount, arena, clipdata, ClipOffs, clen);
 				stringI += stringCount;
 			}
 
 			// Store time stamp data.
 			if (lpST->flags & HAS_TIMESTAMP)
 			{
-				copy_strings_to_strtab (
-						lpST, stringI, stringCount, ts_data, tslen);
+				copy_strings_to_arena (lpST, stringI, stringCount,
+						arena, ts_data, TSOffs, tslen);
 				//stringI += stringCount;
 			}
 
@@ -459,13 +460,18 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 			}
 
 			lpST->nameIndex = nameHashTable;
+			nameHashTable = NULL;
 		}
 	}
+	if (nameHashTable != NULL)
+		StringHashTable_deleteHashTable (nameHashTable);
 	HFree (strdata);
+	HFree (namedata);
 	if (clipdata != NULL)
 		HFree (clipdata);
 	if (ts_data != NULL)
 		HFree (ts_data);
+	res_CloseResFile (fp);
 
 	resdata->ptr = result;
 	return;
@@ -477,6 +483,8 @@ err:
 		HFree (ts_data);
 	if (clipdata != NULL)
 		HFree (clipdata);
+	if (namedata != NULL)
+		HFree (namedata);
 	if (strdata != NULL)
 		HFree (strdata);
 	res_CloseResFile (fp);
@@ -587,9 +595,11 @@ _GetStringData (uio_Stream *fp, DWORD length)
 
 		result = AllocStringTable (stringI, flags);
 		if (result)
-		{
+		{	// The strings stay where they were read to
 			STRING_TABLE_DESC *lpST = (STRING_TABLE) result;
-			copy_strings_to_strtab (lpST, 0, stringCount, strdata, slen);
+			lpST->arena = strdata;
+			set_strtab_entries (lpST, 0, stringCount, strdata, slen);
+			strdata = NULL;
 		}
 	}
 	HFree (strdata);
@@ -620,21 +630,21 @@ _GetBinaryTableData (uio_Stream *fp, DWORD length)
 
 		lpST = AllocStringTable (fileData[0], 0);
 		if (lpST)
-		{
-			int i, size;
-			BYTE *stringptr;
+		{	// The strings are used where they are in the file data
+			int size;
+			char *stringptr;
 
 			size = lpST->size;
 
 			dword_convert (fileData+1, size + 1);
-			stringptr = (BYTE *)(fileData + 2 + size + fileData[1]);
-			for (i = 0; i < size; i++)
-			{
-				set_strtab_entry (lpST, i, (char *)stringptr, fileData[2+i]);
-				stringptr += fileData[2+i];
-			}
+			stringptr = (char *)(fileData + 2 + size + fileData[1]);
+			set_strtab_entries (lpST, 0, size, stringptr, fileData + 2);
+			lpST->arena = result;
+		}
+		else
+		{
+			HFree (result);
 		}
-		HFree (result);
 		result = lpST;
 	}
 
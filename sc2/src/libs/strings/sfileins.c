@@ -27,10 +27,12 @@ LoadStringTableFile (uio_DirHandle *dir, const char *fileName)
 {
 	uio_Stream *fp;
 
-	// FIXME: this theoretically needs a mechanism to prevent races
+	res_LockLoading ();
 	if (_cur_resfile_name)
-		// something else is loading resources atm
+	{	// something else on this thread is loading resources atm
+		res_UnlockLoading ();
 		return 0;
+	}
 
 	fp = res_OpenResFile (dir, fileName, "rb");
 	if (fp)
@@ -40,10 +42,12 @@ LoadStringTableFile (uio_DirHandle *dir, const char *fileName)
 		_cur_resfile_name = fileName;
 		data = (STRING_TABLE) _GetStringData (fp, LengthResFile (fp));
 		_cur_resfile_name = 0;
+		res_UnlockLoading ();
 		res_CloseResFile (fp);
 
 		return data;
 	}
+	res_UnlockLoading ();
 
 	return (0);
 }
@@ -49,6 +49,7 @@ AllocStringTable (int num_entries, int flags)
 		strtab->strings[i].index = i;
 	}
 	strtab->nameIndex = NULL;
+	strtab->arena = NULL;
 	return strtab;
 }
 
@@ -62,6 +63,10 @@ FreeStringTable (STRING_TABLE strtab)
 		return;
 	}
 
+	if (strtab->flags & HAS_NAMEINDEX)
+	{
+		multiplier++;
+	}
 	if (strtab->flags & HAS_SOUND_CLIPS)
 	{
 		multiplier++;
@@ -71,14 +76,25 @@ FreeStringTable (STRING_TABLE strtab)
 		multiplier++;
 	}
 
-	for (i = 0; i < strtab->size * multiplier; i++)
+	if (strtab->arena != NULL)
+	{
+		HFree (strtab->arena);
+	}
+	else
 	{
-		if (strtab->strings[i].data != NULL)
+		for (i = 0; i < strtab->size * multiplier; i++)
 		{
-			HFree (strtab->strings[i].data);
+			if (strtab->strings[i].data != NULL)
+			{
+				HFree (strtab->strings[i].data);
+			}
 		}
 	}
 
+	if (strtab->nameIndex != NULL)
+	{
+		StringHashTable_deleteHashTable (strtab->nameIndex);
+	}
 	HFree (strtab->strings);
 	HFree (strtab);
 }
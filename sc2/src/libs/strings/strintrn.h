@@ -39,6 +39,9 @@ struct string_table
 	int size;
 	STRING_TABLE_ENTRY_DESC *strings;
 	StringHashTable_HashTable *nameIndex;
+	char *arena;
+			// If set, the data of all strings is in this one block,
+			// which is all that is freed with the table
 };
 
 #define HAS_SOUND_CLIPS  (1 << 0)
@@ -27,6 +27,42 @@
 #include "libs/misc.h"
 
 
+// Whether none of the 4 bytes of 'w' is '\0' or above 0x7f: subtracting
+// 1 from each byte borrows only from a '\0', and leaves the high bit of
+// the others as it was.
+#define ASCII_WORD(w) \
+		((((w) | ((w) - 0x01010101)) & 0x80808080) == 0)
+
+// The number of ASCII characters, other than '\0', at the start of
+// [ptr, end). They are looked at 8 bytes at a time.
+static inline size_t
+asciiRunLengthN(const unsigned char *ptr, const unsigned char *end) {
+	const unsigned char *start = ptr;
+
+	while (end - ptr >= 8) {
+		uint32 w[2];
+		memcpy(w, ptr, sizeof w);
+		if (!ASCII_WORD(w[0]) || !ASCII_WORD(w[1]))
+			break;
+		ptr += 8;
+	}
+	while (ptr < end && *ptr != '\0' && *ptr < 0x80)
+		ptr++;
+	return ptr - start;
+}
+
+// The number of ASCII characters, other than '\0', at the start of a
+// 0-terminated string. These go byte by byte, as reading a word could
+// read past the terminator.
+static inline size_t
+asciiRunLength(const unsigned char *ptr) {
+	const unsigned char *start = ptr;
+
+	while (*ptr != '\0' && *ptr < 0x80)
+		ptr++;
+	return ptr - start;
+}
+
 // Resynchronise (skip everything starting with 0x10xxxxxx):
 static inline void
 resyncUTF8(const unsigned char **ptr) {
@@ -174,6 +210,9 @@ getLineFromString(const unsigned char *start, const unsigned char **end,
 
 	// Search for the first newline.
 	for (;;) {
+		// Printable ASCII needs no decoding
+		while (*ptr >= 0x20 && *ptr < 0x80)
+			ptr++;
 		if (*ptr == '\0') {
 			*end = ptr;
 			*startNext = ptr;
@@ -221,6 +260,10 @@ utf8StringCount(const unsigned char *start) {
 	UniChar ch;
 
 	for (;;) {
+		size_t run = asciiRunLength(start);
+		start += run;
+		count += run;
+
 		ch = getCharFromString(&start);
 		if (ch == '\0')
 			return count;
@@ -234,6 +277,10 @@ utf8StringCountN(const unsigned char *start, const unsigned char *end) {
 	UniChar ch;
 
 	for (;;) {
+		size_t run = asciiRunLengthN(start, end);
+		start += run;
+		count += run;
+
 		ch = getCharFromStringN(&start, end);
 		if (ch == '\0')
 			return count;
@@ -329,7 +376,16 @@ skipUTF8Chars(const unsigned char *ptr, size_t num) {
 	UniChar ch;
 	const unsigned char *oldPtr;
 
-	while (num--) {
+	while (num > 0) {
+		size_t run = asciiRunLength(ptr);
+		if (run > 0) {
+			if (run > num)
+				run = num;
+			ptr += run;
+			num -= run;
+			continue;
+		}
+		num--;
 		oldPtr = ptr;
 		ch = getCharFromString(&ptr);
 		if (ch == '\0')
@@ -357,6 +413,16 @@ getUniCharFromStringN(UniChar *wstr, size_t maxcount,
 
 	for (next = wstr; maxcount > 0; ++next, --maxcount)
 	{
+		size_t run = asciiRunLengthN(start, end);
+		if (run > 1)
+		{	// Widen the run, save for its last character, which the
+			// loop does as usual
+			if (run > maxcount)
+				run = maxcount;
+			for (--run; run > 0; --run, --maxcount)
+				*next++ = *start++;
+		}
+
 		*next = getCharFromStringN(&start, end);
 		if (*next == 0)
 			break;
@@ -384,6 +450,16 @@ getUniCharFromString(UniChar *wstr, size_t maxcount,
 
 	for (next = wstr; maxcount > 0; ++next, --maxcount)
 	{
+		size_t run = asciiRunLength(start);
+		if (run > 1)
+		{	// Widen the run, save for its last character, which the
+			// loop does as usual
+			if (run > maxcount)
+				run = maxcount;
+			for (--run; run > 0; --run, --maxcount)
+				*next++ = *start++;
+		}
+
 		*next = getCharFromString(&start);
 		if (*next == 0)
 			break;
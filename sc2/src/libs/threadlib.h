@@ -22,13 +22,16 @@
 
 #define NAMED_SYNCHRO           /* Should synchronizable objects have names? */
 #define TRACK_CONTENTION       /* Should we report when a thread sleeps on synchronize? */
+//#define TRACE_THREADS          /* Should we write a timeline of thread activity? */
+//#define PROFILE_LOCKS          /* Should we count waits for each lock? Needs SDL2 */
 
-/* TRACK_CONTENTION implies NAMED_SYNCHRO. */
-#ifdef TRACK_CONTENTION
+/* TRACK_CONTENTION, TRACE_THREADS and PROFILE_LOCKS imply NAMED_SYNCHRO. */
+#if defined(TRACK_CONTENTION) || defined(TRACE_THREADS) || \
+		defined(PROFILE_LOCKS)
 #	ifndef NAMED_SYNCHRO
 #		define NAMED_SYNCHRO
 #	endif
-#endif /* TRACK_CONTENTION */
+#endif /* TRACK_CONTENTION || TRACE_THREADS || PROFILE_LOCKS */
 
 #ifdef DEBUG
 #	ifndef DEBUG_THREADS
@@ -64,6 +67,83 @@ typedef void *Semaphore;
 typedef void *RecursiveMutex;
 typedef void *CondVar;
 
+/* Atomic 32-bit counters, for the few places where taking a Mutex for
+ * every operation is too expensive (such as the draw command queue).
+ * All operations are full barriers.  AtomicAdd() returns the value
+ * from before the addition. */
+typedef volatile uint32 AtomicU32;
+
+#if defined(__GNUC__)
+static inline uint32
+AtomicLoad (AtomicU32 *p)
+{
+	return __atomic_load_n (p, __ATOMIC_SEQ_CST);
+}
+
+static inline void
+AtomicStore (AtomicU32 *p, uint32 val)
+{
+	__atomic_store_n (p, val, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32
+AtomicAdd (AtomicU32 *p, uint32 val)
+{
+	return __atomic_fetch_add (p, val, __ATOMIC_SEQ_CST);
+}
+
+static inline int
+AtomicCompareExchange (AtomicU32 *p, uint32 expected, uint32 desired)
+{
+	return __atomic_compare_exchange_n (p, &expected, desired, 0,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#elif defined(_MSC_VER)
+#	include <intrin.h>
+static inline uint32
+AtomicLoad (AtomicU32 *p)
+{
+	return (uint32) _InterlockedOr ((volatile long *) p, 0);
+}
+
+static inline void
+AtomicStore (AtomicU32 *p, uint32 val)
+{
+	_InterlockedExchange ((volatile long *) p, (long) val);
+}
+
+static inline uint32
+AtomicAdd (AtomicU32 *p, uint32 val)
+{
+	return (uint32) _InterlockedExchangeAdd ((volatile long *) p,
+			(long) val);
+}
+
+static inline int
+AtomicCompareExchange (AtomicU32 *p, uint32 expected, uint32 desired)
+{
+	return (uint32) _InterlockedCompareExchange ((volatile long *) p,
+			(long) desired, (long) expected) == expected;
+}
+#else
+	/* No compiler support; fall back on a global lock in thrcommon.c. */
+#	define ATOMICS_USE_LOCK
+uint32 AtomicLoad (AtomicU32 *p);
+void AtomicStore (AtomicU32 *p, uint32 val);
+uint32 AtomicAdd (AtomicU32 *p, uint32 val);
+int AtomicCompareExchange (AtomicU32 *p, uint32 expected, uint32 desired);
+#endif
+
+#if defined(TRACE_THREADS) && defined(ATOMICS_USE_LOCK)
+	/* The trace is recorded with atomics; recording a wait would then
+	 * wait on the atomics lock itself. */
+#	undef TRACE_THREADS
+#endif
+#if defined(PROFILE_LOCKS) && defined(ATOMICS_USE_LOCK)
+	/* Likewise for the lock counts. */
+#	undef PROFILE_LOCKS
+#endif
+
 /* Local data associated with each thread */
 typedef struct _threadLocal {
 	Semaphore flushSem;
@@ -155,6 +235,9 @@ void WaitThread (Thread thread, int *status);
 
 void FinishThread (Thread);
 void ProcessThreadLifecycles (void);
+// 'wakeup' is called from the starting thread whenever a thread start
+// waits for ProcessThreadLifecycles(), for a main thread that sleeps.
+void SetThreadLifecycleWakeup (void (*wakeup) (void));
 
 #ifdef PROFILE_THREADS
 void PrintThreadsStats (void);
@@ -179,6 +262,16 @@ void WaitCondVar (CondVar);
 void SignalCondVar (CondVar);
 void BroadcastCondVar (CondVar);
 
+#ifdef TRACE_THREADS
+/* Blocking on the synchronization objects and the lifetime of threads
+ * are traced automatically. TraceSpan() adds other work: the calling
+ * thread was busy with 'name' (which must remain valid) from 'start', as
+ * returned by GetTimeMicroseconds(), until now. On exit, the trace is
+ * written to TRACE_FILE as Chrome trace event JSON. */
+#define TRACE_FILE "uqmtrace.json"
+void TraceSpan (const char *name, DWORD start);
+#endif  /* TRACE_THREADS */
+
 #if defined(__cplusplus)
 }
 #endif
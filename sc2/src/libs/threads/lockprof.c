@@ -0,0 +1,157 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "lockprof.h"
+
+#ifdef PROFILE_LOCKS
+
+#include "libs/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LOCKPROF_MAX_NAMES 256
+		// Objects with names beyond that are counted under "(others)"
+
+struct LockProfile
+{
+	const char *name;
+	LockProfileKind kind;
+	AtomicU32 taken;
+	AtomicU32 waited;
+	AtomicU32 waitSeconds;
+	AtomicU32 waitMicroseconds;
+			// The parts of the waits below a whole second
+};
+
+static LockProfile profiles[LOCKPROF_MAX_NAMES + 1];
+static uint32 numProfiles;
+static AtomicU32 profilesLock;
+		// A spin lock; a Mutex would count itself. Only taken when an
+		// object is created.
+
+static const char *const kindNames[] =
+{
+	"mutex",
+	"recursive mutex",
+	"condvar",
+};
+
+LockProfile *
+LockProfile_get (const char *name, LockProfileKind kind)
+{
+	LockProfile *profile = NULL;
+	uint32 i;
+
+	if (name == NULL)
+		name = "(unnamed)";
+
+	while (!AtomicCompareExchange (&profilesLock, 0, 1))
+		;
+
+	for (i = 0; i < numProfiles; i++)
+	{
+		if (profiles[i].kind == kind && strcmp (profiles[i].name, name) == 0)
+		{
+			profile = &profiles[i];
+			break;
+		}
+	}
+	if (profile == NULL)
+	{
+		if (numProfiles < LOCKPROF_MAX_NAMES)
+		{
+			profile = &profiles[numProfiles++];
+			profile->name = name;
+		}
+		else
+		{
+			profile = &profiles[LOCKPROF_MAX_NAMES];
+			profile->name = "(others)";
+		}
+		profile->kind = kind;
+	}
+
+	AtomicStore (&profilesLock, 0);
+	return profile;
+}
+
+void
+LockProfile_taken (LockProfile *profile)
+{
+	AtomicAdd (&profile->taken, 1);
+}
+
+void
+LockProfile_waited (LockProfile *profile, DWORD start)
+{
+	DWORD wait = GetTimeMicroseconds () - start;
+
+	AtomicAdd (&profile->taken, 1);
+	AtomicAdd (&profile->waited, 1);
+	if (wait >= 1000000)
+		AtomicAdd (&profile->waitSeconds, wait / 1000000);
+	AtomicAdd (&profile->waitMicroseconds, wait % 1000000);
+}
+
+static double
+totalWait (const LockProfile *profile)
+{
+	return (double) AtomicLoad ((AtomicU32 *) &profile->waitSeconds)
+			+ AtomicLoad ((AtomicU32 *) &profile->waitMicroseconds) / 1e6;
+}
+
+static int
+compareWait (const void *a, const void *b)
+{
+	double waitA = totalWait (*(const LockProfile *const *) a);
+	double waitB = totalWait (*(const LockProfile *const *) b);
+
+	return waitA < waitB ? 1 : waitA > waitB ? -1 : 0;
+}
+
+void
+LockProfile_report (void)
+{
+	LockProfile *sorted[LOCKPROF_MAX_NAMES + 1];
+	uint32 count = 0;
+	uint32 i;
+
+	for (i = 0; i <= LOCKPROF_MAX_NAMES; i++)
+	{
+		if (AtomicLoad (&profiles[i].taken) != 0)
+			sorted[count++] = &profiles[i];
+	}
+	qsort (sorted, count, sizeof sorted[0], compareWait);
+
+	log_add (log_Info, "Lock contention, most waited for first:");
+	log_add (log_Info, "%10s %10s %12s %10s  %s", "taken", "waited",
+			"total ms", "avg us", "name");
+	for (i = 0; i < count; i++)
+	{
+		const LockProfile *profile = sorted[i];
+		uint32 waited = AtomicLoad ((AtomicU32 *) &profile->waited);
+		double wait = totalWait (profile);
+
+		log_add (log_Info, "%10lu %10lu %12.3f %10.1f  %s (%s)",
+				(unsigned long) AtomicLoad ((AtomicU32 *) &profile->taken),
+				(unsigned long) waited, wait * 1e3,
+				waited ? wait * 1e6 / waited : 0.0,
+				profile->name, kindNames[profile->kind]);
+	}
+}
+
+#endif  /* PROFILE_LOCKS */
@@ -0,0 +1,54 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Lock contention counts, for PROFILE_LOCKS.
+ * Every mutex, recursive mutex and condition variable counts how often
+ * it was taken, how often the taking thread had to wait for it, and how
+ * long it waited in total. The counts are kept per name, so all the
+ * objects made with the same name add up. They are written to the log
+ * when the thread system is shut down.
+ * Only the thread library itself uses this. */
+
+#ifndef LIBS_THREADS_LOCKPROF_H_
+#define LIBS_THREADS_LOCKPROF_H_
+
+#include "libs/threadlib.h"
+
+#ifdef PROFILE_LOCKS
+
+typedef enum
+{
+	LOCKPROF_MUTEX,
+	LOCKPROF_RECURSIVE_MUTEX,
+	LOCKPROF_CONDVAR
+} LockProfileKind;
+
+typedef struct LockProfile LockProfile;
+
+// Returns the counters shared by all objects of this name and kind
+LockProfile *LockProfile_get (const char *name, LockProfileKind kind);
+
+// Taken without waiting
+void LockProfile_taken (LockProfile *profile);
+// Taken after waiting since 'start', as returned by
+// GetTimeMicroseconds()
+void LockProfile_waited (LockProfile *profile, DWORD start);
+
+void LockProfile_report (void);
+
+#endif  /* PROFILE_LOCKS */
+
+#endif  /* LIBS_THREADS_LOCKPROF_H_ */
@@ -17,6 +17,7 @@
 #include "libs/memlib.h"
 #include "thrcommon.h"
 #include "rust_threads.h"
+#include "thrtrace.h"
 
 #ifdef RUST_OWNS_MAIN
 /* When Rust owns main(), there is no separate main thread pumping SDL
@@ -118,9 +119,18 @@ RustThreadHelper (void *opaque)
 	void *data = startInfo->data;
 	TrueThread thread = startInfo->thread;
 	int result;
+#ifdef TRACE_THREADS
+	DWORD startTime = GetTimeMicroseconds ();
+#endif
 
 	HFree (startInfo);
+#ifdef TRACE_THREADS
+	TraceThreadStart (thread->name);
+#endif
 	result = (*func) (data);
+#ifdef TRACE_THREADS
+	TraceThreadEnd (thread->name, startTime);
+#endif
 
 #ifdef DEBUG_THREADS
 	if (thread != NULL)
@@ -139,6 +149,9 @@ void
 InitThreadSystem (void)
 {
 	rust_init_thread_system();
+#ifdef TRACE_THREADS
+	InitThreadTrace ();
+#endif
 	InitLifecycleState ();
 	lifecycleMutex = CreateMutex ("Thread Lifecycle Mutex", SYNC_CLASS_RESOURCE);
 	log_add(log_Debug, "Rust thread system initialized");
@@ -148,6 +161,9 @@ void
 UnInitThreadSystem (void)
 {
 	ProcessThreadLifecycles ();
+#ifdef TRACE_THREADS
+	UnInitThreadTrace ();
+#endif
 	if (lifecycleMutex)
 	{
 		DestroyMutex (lifecycleMutex);
@@ -176,6 +192,7 @@ CreateThread_Core (ThreadFunction func, void *data, SDWORD stackSize, const char
 		HFree (thread);
 		return NULL;
 	}
+	TRACE_OBJECT_NAME (thread, name);
 
 	return (Thread) thread;
 }
@@ -204,6 +221,10 @@ StartThread_Core (ThreadFunction func, void *data, SDWORD stackSize, const char
 		HFree (startInfo);
 		HFree (thread);
 	}
+	else
+	{
+		TRACE_OBJECT_NAME (thread, name);
+	}
 }
 
 void
@@ -270,7 +291,10 @@ WaitThread (Thread thread, int *status)
 	if (t && t->native)
 	{
 		int out_status = 0;
-		int result = rust_thread_join (t->native, &out_status);
+		int result;
+
+		TRACE_WAIT ("WaitThread", t,
+				result = rust_thread_join (t->native, &out_status));
 		if (status)
 		{
 			if (result)
@@ -305,6 +329,14 @@ FinishThread (Thread thread)
 	exit (EXIT_FAILURE);
 }
 
+void
+SetThreadLifecycleWakeup (void (*wakeup) (void))
+{
+	/* Threads are started right away, never by
+	 * ProcessThreadLifecycles(), so nobody needs waking up. */
+	(void) wakeup;
+}
+
 void
 ProcessThreadLifecycles (void)
 {
@@ -337,8 +369,12 @@ DestroyThread (Thread t)
 Mutex
 CreateMutex_Core (const char *name, DWORD syncClass)
 {
+	Mutex result;
+
 	(void)syncClass;
-	return (Mutex)rust_mutex_create(name);
+	result = (Mutex)rust_mutex_create(name);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 void
@@ -350,7 +386,7 @@ DestroyMutex (Mutex m)
 void
 LockMutex (Mutex m)
 {
-	rust_mutex_lock((RustMutex*)m);
+	TRACE_WAIT ("LockMutex", m, rust_mutex_lock((RustMutex*)m));
 }
 
 void
@@ -362,8 +398,12 @@ UnlockMutex (Mutex m)
 Semaphore
 CreateSemaphore_Core (DWORD initial, const char *name, DWORD syncClass)
 {
+	Semaphore result;
+
 	(void)syncClass;
-	return (Semaphore)rust_semaphore_create((uint32)initial, name);
+	result = (Semaphore)rust_semaphore_create((uint32)initial, name);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 void
@@ -375,7 +415,8 @@ DestroySemaphore (Semaphore s)
 void
 SetSemaphore (Semaphore s)
 {
-	rust_semaphore_acquire((RustSemaphore*)s);
+	TRACE_WAIT ("SetSemaphore", s,
+			rust_semaphore_acquire((RustSemaphore*)s));
 }
 
 void
@@ -387,8 +428,12 @@ ClearSemaphore (Semaphore s)
 CondVar
 CreateCondVar_Core (const char *name, DWORD syncClass)
 {
+	CondVar result;
+
 	(void)syncClass;
-	return (CondVar)rust_condvar_create(name);
+	result = (CondVar)rust_condvar_create(name);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 void
@@ -401,7 +446,7 @@ void
 WaitCondVar (CondVar c)
 {
 	/* Note: Rust condvar doesn't need external mutex for this simplified API */
-	rust_condvar_wait((RustCondVar*)c, NULL);
+	TRACE_WAIT ("WaitCondVar", c, rust_condvar_wait((RustCondVar*)c, NULL));
 }
 
 void
@@ -422,8 +467,12 @@ CreateRecursiveMutex_Core (const char *name, DWORD syncClass)
 	/* RustFfiMutex supports recursive locking with owner tracking and depth counting.
 	 * This comment describes the recursive-mutex path only; plain Mutex semantics
 	 * remain governed by the separate audit blocker in the specification. */
+	RecursiveMutex result;
+
 	(void)syncClass;
-	return (RecursiveMutex)rust_mutex_create(name);
+	result = (RecursiveMutex)rust_mutex_create(name);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 void
@@ -435,7 +484,7 @@ DestroyRecursiveMutex (RecursiveMutex m)
 void
 LockRecursiveMutex (RecursiveMutex m)
 {
-	rust_mutex_lock((RustMutex*)m);
+	TRACE_WAIT ("LockRecursiveMutex", m, rust_mutex_lock((RustMutex*)m));
 }
 
 void
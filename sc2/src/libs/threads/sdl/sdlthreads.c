@@ -18,6 +18,7 @@
 #include "libs/misc.h"
 #include "libs/memlib.h"
 #include "sdlthreads.h"
+#include "../lockprof.h"
 #ifdef PROFILE_THREADS
 #include <signal.h>
 #include <unistd.h>
@@ -31,6 +32,9 @@
 
 #if SDL_MAJOR_VERSION == 1
 typedef Uint32 SDL_threadID;
+#	ifdef PROFILE_LOCKS
+#		error "PROFILE_LOCKS needs SDL_TryLockMutex() from SDL2"
+#	endif
 #endif
 
 typedef struct _thread {
@@ -305,13 +309,22 @@ SleepThread_SDL (TimeCount sleepTime)
 
 void
 SleepThreadUntil_SDL (TimeCount wakeTime) {
-	TimeCount now;
+	DWORD left;
 
-	now = GetTimeCounter ();
-	if (wakeTime <= now)
+	left = GetTimeMicrosecondsUntil (wakeTime);
+	if (left == 0) {
 		TaskSwitch_SDL ();
-	else
-		SDL_Delay ((wakeTime - now) * 1000 / ONE_SECOND);
+		return;
+	}
+
+	// SDL_Delay() only sleeps whole milliseconds. What is left after the
+	// last whole one is waited for by yielding, so that the thread wakes
+	// up within microseconds of wakeTime instead of up to a millisecond
+	// late.
+	if (left >= 1000)
+		SDL_Delay (left / 1000);
+	while (GetTimeMicrosecondsUntil (wakeTime) > 0)
+		SDL_Delay (0);
 }
 
 void
@@ -346,6 +359,9 @@ typedef struct _mutex {
 	const char *name;
 	DWORD syncClass;
 #endif
+#ifdef PROFILE_LOCKS
+	LockProfile *profile;
+#endif
 } Mut;
 	
 
@@ -366,6 +382,9 @@ CreateMutex_SDL (void)
 #ifdef NAMED_SYNCHRO
 		mutex->name = name;
 		mutex->syncClass = syncClass;
+#endif
+#ifdef PROFILE_LOCKS
+		mutex->profile = LockProfile_get (name, LOCKPROF_MUTEX);
 #endif
 	}
 
@@ -415,10 +434,24 @@ LockMutex_SDL (Mutex m)
 				MyThreadName (), mutex->name);
 	}
 #endif
+#ifdef PROFILE_LOCKS
+	if (SDL_TryLockMutex (mutex->mutex) == 0)
+		LockProfile_taken (mutex->profile);
+	else
+	{
+		DWORD start = GetTimeMicroseconds ();
+		while (SDL_mutexP (mutex->mutex) != 0)
+		{
+			TaskSwitch_SDL ();
+		}
+		LockProfile_waited (mutex->profile, start);
+	}
+#else
 	while (SDL_mutexP (mutex->mutex) != 0)
 	{
 		TaskSwitch_SDL ();
 	}
+#endif
 #ifdef TRACK_CONTENTION
 	mutex->owner = SDL_ThreadID ();
 #endif
@@ -528,6 +561,9 @@ typedef struct _recm {
 	const char *name;
 	DWORD syncClass;
 #endif
+#ifdef PROFILE_LOCKS
+	LockProfile *profile;
+#endif
 } RecM;
 
 RecursiveMutex
@@ -555,6 +591,9 @@ CreateRecursiveMutex_SDL (void)
 #ifdef NAMED_SYNCHRO
 	mtx->name = name;
 	mtx->syncClass = syncClass;
+#endif
+#ifdef PROFILE_LOCKS
+	mtx->profile = LockProfile_get (name, LOCKPROF_RECURSIVE_MUTEX);
 #endif
 	mtx->locks = 0;
 	return (RecursiveMutex) mtx;
@@ -582,8 +621,20 @@ LockRecursiveMutex_SDL (RecursiveMutex val)
 					MyThreadName (), mtx->name);
 		}
 #endif
+#ifdef PROFILE_LOCKS
+		if (SDL_TryLockMutex (mtx->mutex) == 0)
+			LockProfile_taken (mtx->profile);
+		else
+		{
+			DWORD start = GetTimeMicroseconds ();
+			while (SDL_mutexP (mtx->mutex))
+				TaskSwitch_SDL ();
+			LockProfile_waited (mtx->profile, start);
+		}
+#else
 		while (SDL_mutexP (mtx->mutex))
 			TaskSwitch_SDL ();
+#endif
 		mtx->thread_id = thread_id;
 	}
 	mtx->locks++;
@@ -626,6 +677,9 @@ typedef struct _cond {
 	const char *name;
 	DWORD syncClass;
 #endif
+#ifdef PROFILE_LOCKS
+	LockProfile *profile;
+#endif
 } cvar;
 
 CondVar
@@ -652,6 +706,9 @@ CreateCondVar_SDL (void)
 #ifdef NAMED_SYNCHRO
 	cv->name = name;
 	cv->syncClass = syncClass;
+#endif
+#ifdef PROFILE_LOCKS
+	cv->profile = LockProfile_get (name, LOCKPROF_CONDVAR);
 #endif
 	return cv;
 }
@@ -669,6 +726,10 @@ void
 WaitCondVar_SDL (CondVar c)
 {
 	cvar *cv = (cvar *) c;
+#ifdef PROFILE_LOCKS
+	DWORD start = GetTimeMicroseconds ();
+			// Every wait for a signal counts as waited
+#endif
 	SDL_mutexP (cv->mutex);
 #ifdef TRACK_CONTENTION
 	if (cv->syncClass & TRACK_CONTENTION_CLASSES)
@@ -689,6 +750,9 @@ WaitCondVar_SDL (CondVar c)
 	}
 #endif
 	SDL_mutexV (cv->mutex);
+#ifdef PROFILE_LOCKS
+	LockProfile_waited (cv->profile, start);
+#endif
 }
 
 void
@@ -24,8 +24,10 @@
 #include "libs/async.h"
 #include "libs/memlib.h"
 #include "thrcommon.h"
+#include "thrtrace.h"
+#include "lockprof.h"
 
-#define LIFECYCLE_SIZE 8
+#define LIFECYCLE_SIZE 16
 typedef struct {
 	ThreadFunction func;
 	void *data;
@@ -42,6 +44,10 @@ typedef SpawnRequest_struct *SpawnRequest;
 static Mutex        lifecycleMutex;
 static SpawnRequest pendingBirth[LIFECYCLE_SIZE];
 static Thread       pendingDeath[LIFECYCLE_SIZE];
+static void       (*lifecycleWakeup) (void);
+#ifdef ATOMICS_USE_LOCK
+static Mutex        atomicMutex;
+#endif
 
 void
 InitThreadSystem (void)
@@ -53,14 +59,29 @@ InitThreadSystem (void)
 		pendingBirth[i] = NULL;
 		pendingDeath[i] = NULL;
 	}
+#ifdef TRACE_THREADS
+	InitThreadTrace ();
+#endif
 	lifecycleMutex = CreateMutex ("Thread Lifecycle Mutex", SYNC_CLASS_RESOURCE);
+#ifdef ATOMICS_USE_LOCK
+	atomicMutex = CreateMutex ("Atomic Ops Mutex", SYNC_CLASS_RESOURCE);
+#endif
 }
 
 void
 UnInitThreadSystem (void)
 {
+#ifdef TRACE_THREADS
+	UnInitThreadTrace ();
+#endif
+#ifdef PROFILE_LOCKS
+	LockProfile_report ();
+#endif
 	NativeUnInitThreadSystem ();
 	DestroyMutex (lifecycleMutex);
+#ifdef ATOMICS_USE_LOCK
+	DestroyMutex (atomicMutex);
+#endif
 }
 
 static Thread
@@ -74,6 +95,8 @@ FlagStartThread (SpawnRequest s)
 		{
 			pendingBirth[i] = s;
 			UnlockMutex (lifecycleMutex);
+			if (lifecycleWakeup)
+				lifecycleWakeup ();
 			if (s->sem)
 			{
 				Thread result;
@@ -109,6 +132,12 @@ FinishThread (Thread thread)
 }
 
 /* Only call from main thread! */
+void
+SetThreadLifecycleWakeup (void (*wakeup) (void))
+{
+	lifecycleWakeup = wakeup;
+}
+
 void
 ProcessThreadLifecycles (void)
 {
@@ -121,6 +150,7 @@ ProcessThreadLifecycles (void)
 		{
 #ifdef NAMED_SYNCHRO
 			s->value = NativeCreateThread (s->func, s->data, s->stackSize, s->name);
+			TRACE_OBJECT_NAME (s->value, s->name);
 #else
 			s->value = NativeCreateThread (s->func, s->data, s->stackSize);
 #endif
@@ -153,6 +183,40 @@ ProcessThreadLifecycles (void)
 }
 
 
+#ifdef TRACE_THREADS
+typedef struct {
+	ThreadFunction func;
+	void *data;
+	const char *name;
+} TracedThreadStart;
+
+static int
+TracedThreadHelper (void *opaque)
+{
+	TracedThreadStart start = *(TracedThreadStart *) opaque;
+	DWORD startTime = GetTimeMicroseconds ();
+	int result;
+
+	HFree (opaque);
+	TraceThreadStart (start.name);
+	result = (*start.func) (start.data);
+	TraceThreadEnd (start.name, startTime);
+	return result;
+}
+
+/* Makes the thread of the request record its lifetime */
+static void
+TraceSpawnRequest (SpawnRequest s)
+{
+	TracedThreadStart *start = HMalloc (sizeof (TracedThreadStart));
+	start->func = s->func;
+	start->data = s->data;
+	start->name = s->name;
+	s->func = TracedThreadHelper;
+	s->data = start;
+}
+#endif  /* TRACE_THREADS */
+
 /* The Create routines look different based on whether NAMED_SYNCHRO
    is defined or not. */
 
@@ -166,6 +230,9 @@ CreateThread_Core (ThreadFunction func, void *data, SDWORD stackSize, const char
 	s->stackSize = stackSize;
 	s->name = name;
 	s->sem = CreateSemaphore (0, "SpawnRequest semaphore", SYNC_CLASS_RESOURCE);
+#ifdef TRACE_THREADS
+	TraceSpawnRequest (s);
+#endif
 	return FlagStartThread (s);
 }
 
@@ -178,31 +245,42 @@ StartThread_Core (ThreadFunction func, void *data, SDWORD stackSize, const char
 	s->stackSize = stackSize;
 	s->name = name;
 	s->sem = NULL;
+#ifdef TRACE_THREADS
+	TraceSpawnRequest (s);
+#endif
 	FlagStartThread (s);
 }
 
 Mutex
 CreateMutex_Core (const char *name, DWORD syncClass)
 {
-	return NativeCreateMutex (name, syncClass);
+	Mutex result = NativeCreateMutex (name, syncClass);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 Semaphore
 CreateSemaphore_Core (DWORD initial, const char *name, DWORD syncClass)
 {
-	return NativeCreateSemaphore (initial, name, syncClass);
+	Semaphore result = NativeCreateSemaphore (initial, name, syncClass);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 RecursiveMutex
 CreateRecursiveMutex_Core (const char *name, DWORD syncClass)
 {
-	return NativeCreateRecursiveMutex (name, syncClass);
+	RecursiveMutex result = NativeCreateRecursiveMutex (name, syncClass);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 CondVar
 CreateCondVar_Core (const char *name, DWORD syncClass)
 {
-	return NativeCreateCondVar (name, syncClass);
+	CondVar result = NativeCreateCondVar (name, syncClass);
+	TRACE_OBJECT_NAME (result, name);
+	return result;
 }
 
 #else
@@ -284,7 +362,7 @@ GetMyThreadLocal (void)
 void
 WaitThread (Thread thread, int *status)
 {
-	NativeWaitThread (thread, status);
+	TRACE_WAIT ("WaitThread", thread, NativeWaitThread (thread, status));
 }
 
 #ifdef DEBUG_SLEEP
@@ -377,7 +455,7 @@ DestroyMutex (Mutex sem)
 void
 LockMutex (Mutex sem)
 {
-	NativeLockMutex (sem);
+	TRACE_WAIT ("LockMutex", sem, NativeLockMutex (sem));
 }
 
 void
@@ -395,7 +473,7 @@ DestroySemaphore (Semaphore sem)
 void
 SetSemaphore (Semaphore sem)
 {
-	NativeSetSemaphore (sem);
+	TRACE_WAIT ("SetSemaphore", sem, NativeSetSemaphore (sem));
 }
 
 void
@@ -413,7 +491,7 @@ DestroyCondVar (CondVar cv)
 void
 WaitCondVar (CondVar cv)
 {
-	NativeWaitCondVar (cv);
+	TRACE_WAIT ("WaitCondVar", cv, NativeWaitCondVar (cv));
 }
 
 void
@@ -437,7 +515,7 @@ DestroyRecursiveMutex (RecursiveMutex mutex)
 void
 LockRecursiveMutex (RecursiveMutex mutex)
 {
-	NativeLockRecursiveMutex (mutex);
+	TRACE_WAIT ("LockRecursiveMutex", mutex, NativeLockRecursiveMutex (mutex));
 }
 
 void
@@ -452,4 +530,47 @@ GetRecursiveMutexDepth (RecursiveMutex mutex)
 	return NativeGetRecursiveMutexDepth (mutex);
 }
 
+#ifdef ATOMICS_USE_LOCK
+uint32
+AtomicLoad (AtomicU32 *p)
+{
+	uint32 result;
+	LockMutex (atomicMutex);
+	result = *p;
+	UnlockMutex (atomicMutex);
+	return result;
+}
+
+void
+AtomicStore (AtomicU32 *p, uint32 val)
+{
+	LockMutex (atomicMutex);
+	*p = val;
+	UnlockMutex (atomicMutex);
+}
+
+uint32
+AtomicAdd (AtomicU32 *p, uint32 val)
+{
+	uint32 result;
+	LockMutex (atomicMutex);
+	result = *p;
+	*p = result + val;
+	UnlockMutex (atomicMutex);
+	return result;
+}
+
+int
+AtomicCompareExchange (AtomicU32 *p, uint32 expected, uint32 desired)
+{
+	int result;
+	LockMutex (atomicMutex);
+	result = (*p == expected);
+	if (result)
+		*p = desired;
+	UnlockMutex (atomicMutex);
+	return result;
+}
+#endif /* ATOMICS_USE_LOCK */
+
 #endif /* !USE_RUST_THREADS */
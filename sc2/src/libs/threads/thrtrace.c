@@ -0,0 +1,251 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "thrtrace.h"
+
+#ifdef TRACE_THREADS
+
+#include "port.h"
+#include SDL_INCLUDE(SDL.h)
+#include SDL_INCLUDE(SDL_thread.h)
+#include "libs/log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_MAX_EVENTS 0x40000
+		// Recording stops when this many have been recorded
+#define TRACE_MAX_OBJECTS 1024
+#define TRACE_MIN_WAIT 20
+		// In microseconds; shorter waits are not worth showing
+
+typedef enum
+{
+	TRACE_EVENT_WAIT,
+	TRACE_EVENT_SPAN,
+	TRACE_EVENT_THREAD,
+	TRACE_EVENT_THREAD_NAME,
+} TraceEventType;
+
+typedef struct
+{
+	BYTE type;
+	const char *name;
+	const void *object;
+	DWORD start;
+	DWORD duration;
+	uint32 thread;
+} TraceEvent;
+
+typedef struct
+{
+	const void *object;
+	const char *name;
+} TraceObject;
+
+// Event slots are claimed with an atomic increment, so recording never
+// blocks. Neither array is read before the trace is written on exit.
+static TraceEvent events[TRACE_MAX_EVENTS];
+static AtomicU32 numEvents;
+static TraceObject objects[TRACE_MAX_OBJECTS];
+static AtomicU32 numObjects;
+static volatile BOOLEAN tracing;
+static DWORD traceStart;
+
+static void
+addEvent (TraceEventType type, const char *name, const void *object,
+		DWORD start, DWORD end)
+{
+	uint32 i;
+	TraceEvent *event;
+
+	if (!tracing)
+		return;
+
+	i = AtomicAdd (&numEvents, 1);
+	if (i >= TRACE_MAX_EVENTS)
+		return;
+
+	event = &events[i];
+	event->type = type;
+	event->name = name;
+	event->object = object;
+	event->start = start - traceStart;
+	event->duration = end - start;
+	event->thread = (uint32) SDL_ThreadID ();
+}
+
+void
+InitThreadTrace (void)
+{
+	traceStart = GetTimeMicroseconds ();
+	tracing = TRUE;
+	addEvent (TRACE_EVENT_THREAD_NAME, "main", NULL, traceStart, traceStart);
+}
+
+void
+TraceObjectName (const void *object, const char *name)
+{
+	uint32 i;
+
+	if (!tracing || object == NULL || name == NULL)
+		return;
+
+	i = AtomicAdd (&numObjects, 1);
+	if (i >= TRACE_MAX_OBJECTS)
+		return;
+	objects[i].object = object;
+	objects[i].name = name;
+}
+
+void
+TraceWait (const char *what, const void *object, DWORD start)
+{
+	DWORD now = GetTimeMicroseconds ();
+
+	if (now - start < TRACE_MIN_WAIT)
+		return;
+	addEvent (TRACE_EVENT_WAIT, what, object, start, now);
+}
+
+void
+TraceSpan (const char *name, DWORD start)
+{
+	addEvent (TRACE_EVENT_SPAN, name, NULL, start, GetTimeMicroseconds ());
+}
+
+void
+TraceThreadStart (const char *name)
+{
+	DWORD now = GetTimeMicroseconds ();
+	addEvent (TRACE_EVENT_THREAD_NAME, name, NULL, now, now);
+}
+
+void
+TraceThreadEnd (const char *name, DWORD start)
+{
+	addEvent (TRACE_EVENT_THREAD, name, NULL, start, GetTimeMicroseconds ());
+}
+
+static const char *
+objectName (const void *object)
+{
+	uint32 count = AtomicLoad (&numObjects);
+	uint32 i;
+
+	if (count > TRACE_MAX_OBJECTS)
+		count = TRACE_MAX_OBJECTS;
+	// Addresses get reused after an object is destroyed; the one created
+	// last is most likely the one meant.
+	for (i = count; i-- > 0; )
+	{
+		if (objects[i].object == object)
+			return objects[i].name;
+	}
+	return "?";
+}
+
+static void
+writeString (FILE *out, const char *str)
+{
+	fputc ('"', out);
+	for (; *str != '\0'; str++)
+	{
+		if (*str == '"' || *str == '\\')
+			fputc ('\\', out);
+		if ((unsigned char) *str >= ' ')
+			fputc (*str, out);
+	}
+	fputc ('"', out);
+}
+
+static void
+writeEvent (FILE *out, const TraceEvent *event)
+{
+	if (event->type == TRACE_EVENT_THREAD_NAME)
+	{
+		fprintf (out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"tid\":%lu,\"args\":{\"name\":",
+				(unsigned long) event->thread);
+		writeString (out, event->name);
+		fputs ("}}", out);
+		return;
+	}
+
+	fputs ("{\"name\":", out);
+	writeString (out, event->name);
+	fprintf (out, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,"
+			"\"pid\":1,\"tid\":%lu",
+			event->type == TRACE_EVENT_WAIT ? "wait" :
+			event->type == TRACE_EVENT_THREAD ? "thread" : "work",
+			(unsigned long) event->start, (unsigned long) event->duration,
+			(unsigned long) event->thread);
+	if (event->object)
+	{
+		fputs (",\"args\":{\"object\":", out);
+		writeString (out, objectName (event->object));
+		fputc ('}', out);
+	}
+	fputc ('}', out);
+}
+
+void
+UnInitThreadTrace (void)
+{
+	FILE *out;
+	uint32 count;
+	uint32 written = 0;
+	uint32 i;
+
+	if (!tracing)
+		return;
+	tracing = FALSE;
+
+	count = AtomicLoad (&numEvents);
+	if (count > TRACE_MAX_EVENTS)
+	{
+		log_add (log_Warning, "Thread trace full; the last %lu events "
+				"were dropped.", (unsigned long) (count - TRACE_MAX_EVENTS));
+		count = TRACE_MAX_EVENTS;
+	}
+
+	out = fopen (TRACE_FILE, "w");
+	if (out == NULL)
+	{
+		log_add (log_Error, "Could not write thread trace '%s': %s.",
+				TRACE_FILE, strerror (errno));
+		return;
+	}
+
+	fputs ("{\"traceEvents\":[", out);
+	for (i = 0; i < count; i++)
+	{
+		if (events[i].name == NULL)
+			continue; // Claimed, but not filled in yet
+		if (written++ > 0)
+			fputc (',', out);
+		fputc ('\n', out);
+		writeEvent (out, &events[i]);
+	}
+	fputs ("\n],\"displayTimeUnit\":\"ms\"}\n", out);
+	fclose (out);
+
+	log_add (log_Info, "Thread trace of %lu events written to '%s'.",
+			(unsigned long) written, TRACE_FILE);
+}
+
+#endif  /* TRACE_THREADS */
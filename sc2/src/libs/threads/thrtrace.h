@@ -0,0 +1,55 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Recording of thread activity, for TRACE_THREADS.
+ * Only the thread library itself uses this; see TraceSpan() in
+ * threadlib.h for the outside. */
+
+#ifndef LIBS_THREADS_THRTRACE_H_
+#define LIBS_THREADS_THRTRACE_H_
+
+#include "libs/threadlib.h"
+
+#ifdef TRACE_THREADS
+
+void InitThreadTrace (void);
+		// Call from the main thread
+void UnInitThreadTrace (void);
+		// Writes the trace
+
+void TraceObjectName (const void *object, const char *name);
+void TraceWait (const char *what, const void *object, DWORD start);
+void TraceThreadStart (const char *name);
+void TraceThreadEnd (const char *name, DWORD start);
+
+// Runs 'call', which blocks on 'object'
+#define TRACE_WAIT(what, object, call) \
+		do { \
+			DWORD traceStart_ = GetTimeMicroseconds (); \
+			call; \
+			TraceWait ((what), (object), traceStart_); \
+		} while (0)
+#define TRACE_OBJECT_NAME(object, name) \
+		TraceObjectName ((object), (name))
+
+#else  /* !defined(TRACE_THREADS) */
+
+#define TRACE_WAIT(what, object, call) call
+#define TRACE_OBJECT_NAME(object, name) do { } while (0)
+
+#endif  /* !defined(TRACE_THREADS) */
+
+#endif  /* LIBS_THREADS_THRTRACE_H_ */
@@ -0,0 +1,264 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "workpool.h"
+#include "libs/log.h"
+
+#define WORKPOOL_QUEUE_SIZE 256
+		// Per worker; work that finds all queues full is done right away
+
+typedef struct
+{
+	WorkFunction func;
+	void *data;
+	int index;
+	WorkGroup *group;
+} WorkItem;
+
+typedef struct
+{
+	Mutex lock;
+	WorkItem items[WORKPOOL_QUEUE_SIZE];
+	COUNT head;
+			// The oldest item
+	COUNT count;
+} WorkQueue;
+
+static WorkQueue queues[WORKPOOL_MAX_WORKERS];
+static int numWorkers;
+static AtomicU32 nextQueue;
+		// Where the next piece of work is submitted, round robin
+static Semaphore workReady;
+		// Posted once for every piece of work queued
+static Semaphore workersDone;
+static volatile BOOLEAN workersQuit;
+
+static BOOLEAN
+pushWork (WorkQueue *q, const WorkItem *item)
+{
+	BOOLEAN pushed = FALSE;
+
+	LockMutex (q->lock);
+	if (q->count < WORKPOOL_QUEUE_SIZE)
+	{
+		q->items[(q->head + q->count) % WORKPOOL_QUEUE_SIZE] = *item;
+		++q->count;
+		pushed = TRUE;
+	}
+	UnlockMutex (q->lock);
+	return pushed;
+}
+
+// Takes the newest item if 'newest', else the oldest
+static BOOLEAN
+popWork (WorkQueue *q, WorkItem *item, BOOLEAN newest)
+{
+	BOOLEAN popped = FALSE;
+
+	LockMutex (q->lock);
+	if (q->count > 0)
+	{
+		--q->count;
+		if (newest)
+		{
+			*item = q->items[(q->head + q->count) % WORKPOOL_QUEUE_SIZE];
+		}
+		else
+		{
+			*item = q->items[q->head];
+			q->head = (q->head + 1) % WORKPOOL_QUEUE_SIZE;
+		}
+		popped = TRUE;
+	}
+	UnlockMutex (q->lock);
+	return popped;
+}
+
+// 'self' is the worker's own queue, or -1 for a thread that is not a
+// worker
+static BOOLEAN
+takeWork (int self, WorkItem *item)
+{
+	int i;
+
+	if (self >= 0 && popWork (&queues[self], item, TRUE))
+		return TRUE;
+
+	for (i = 1; i <= numWorkers; ++i)
+	{
+		int victim = (self + i) % numWorkers;
+		if (victim != self && popWork (&queues[victim], item, FALSE))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+runWork (const WorkItem *item)
+{
+	WorkGroup *group = item->group;
+
+	item->func (item->data, item->index);
+	if (AtomicAdd (&group->pending, (uint32) -1) == 1)
+		ClearSemaphore (group->done);
+}
+
+static int
+workerFunc (void *data)
+{
+	int self = (int) ((WorkQueue *) data - queues);
+	WorkItem item;
+
+	for (;;)
+	{
+		SetSemaphore (workReady);
+		if (workersQuit)
+			break;
+		// The waiting threads may have taken the work already
+		while (takeWork (self, &item))
+			runWork (&item);
+	}
+
+	ClearSemaphore (workersDone);
+	return 0;
+}
+
+void
+WorkPool_init (int workers)
+{
+	int i;
+
+	if (workReady)
+		return;
+
+	if (workers < 0)
+		workers = 0;
+	if (workers > WORKPOOL_MAX_WORKERS)
+		workers = WORKPOOL_MAX_WORKERS;
+	numWorkers = workers;
+	workersQuit = FALSE;
+	AtomicStore (&nextQueue, 0);
+	workReady = CreateSemaphore (0, "Work ready", SYNC_CLASS_RESOURCE);
+	workersDone = CreateSemaphore (0, "Workers done", SYNC_CLASS_RESOURCE);
+	for (i = 0; i < numWorkers; ++i)
+	{
+		queues[i].lock = CreateMutex ("Work queue", SYNC_CLASS_RESOURCE);
+		queues[i].head = 0;
+		queues[i].count = 0;
+		StartThread (workerFunc, &queues[i], 0, "pool worker");
+	}
+	log_add (log_Info, "Work pool is using %d worker threads", numWorkers);
+}
+
+// Nothing may be submitting work anymore
+void
+WorkPool_uninit (void)
+{
+	int i;
+
+	if (!workReady)
+		return;
+
+	workersQuit = TRUE;
+	for (i = 0; i < numWorkers; ++i)
+		ClearSemaphore (workReady);
+	for (i = 0; i < numWorkers; ++i)
+		SetSemaphore (workersDone);
+	for (i = 0; i < numWorkers; ++i)
+	{
+		DestroyMutex (queues[i].lock);
+		queues[i].lock = 0;
+	}
+	DestroySemaphore (workersDone);
+	workersDone = 0;
+	DestroySemaphore (workReady);
+	workReady = 0;
+	numWorkers = 0;
+}
+
+int
+WorkPool_getWorkerCount (void)
+{
+	return numWorkers;
+}
+
+void
+WorkGroup_init (WorkGroup *group, const char *name)
+{
+	AtomicStore (&group->pending, 1);
+	group->done = CreateSemaphore (0, name, SYNC_CLASS_RESOURCE);
+	(void) name;
+			// Unused without NAMED_SYNCHRO
+}
+
+void
+WorkGroup_uninit (WorkGroup *group)
+{
+	DestroySemaphore (group->done);
+	group->done = 0;
+}
+
+void
+WorkGroup_submit (WorkGroup *group, WorkFunction func, void *data,
+		int index)
+{
+	WorkItem item;
+	int first, i;
+
+	item.func = func;
+	item.data = data;
+	item.index = index;
+	item.group = group;
+	AtomicAdd (&group->pending, 1);
+
+	if (numWorkers > 0)
+	{
+		first = (int) (AtomicAdd (&nextQueue, 1) % numWorkers);
+		for (i = 0; i < numWorkers; ++i)
+		{
+			if (pushWork (&queues[(first + i) % numWorkers], &item))
+			{
+				ClearSemaphore (workReady);
+				return;
+			}
+		}
+	}
+
+	// No workers, or all the queues are full
+	runWork (&item);
+}
+
+void
+WorkGroup_wait (WorkGroup *group)
+{
+	WorkItem item;
+
+	// Drop the reference held since the group was last waited for. If
+	// that was the last one, everything is done and no one posts 'done'.
+	if (AtomicAdd (&group->pending, (uint32) -1) == 1)
+	{
+		AtomicStore (&group->pending, 1);
+		return;
+	}
+
+	// Help out instead of sleeping. This may run work of other groups
+	// as well.
+	while (AtomicLoad (&group->pending) != 0 && takeWork (-1, &item))
+		runWork (&item);
+
+	SetSemaphore (group->done);
+	AtomicStore (&group->pending, 1);
+}
@@ -0,0 +1,67 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* A fixed pool of worker threads, shared by everything that splits its
+ * work into pieces that can run at the same time (scaling bands, frames
+ * of a drawable, bands of a planet map).
+ * Pieces of work are submitted to a WorkGroup, and WorkGroup_wait()
+ * returns when all of those are done. Each worker has its own queue;
+ * it takes the newest work from its own queue first, and when that is
+ * empty takes the oldest from the others. A thread waiting for a group
+ * runs queued work itself until the group is done, so waiting from
+ * inside a piece of work does not tie up a worker.
+ * Work must not block on anything but other work groups. */
+
+#ifndef LIBS_THREADS_WORKPOOL_H_
+#define LIBS_THREADS_WORKPOOL_H_
+
+#include "libs/threadlib.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define WORKPOOL_MAX_WORKERS 8
+
+typedef void (*WorkFunction) (void *data, int index);
+
+typedef struct
+{
+	AtomicU32 pending;
+			// Work not finished yet, plus one until WorkGroup_wait()
+	Semaphore done;
+} WorkGroup;
+
+// Called from the main thread. With 0 workers, work is done right away
+// by the thread submitting it.
+void WorkPool_init (int workers);
+void WorkPool_uninit (void);
+int WorkPool_getWorkerCount (void);
+
+void WorkGroup_init (WorkGroup *group, const char *name);
+void WorkGroup_uninit (WorkGroup *group);
+// Calls func (data, index) on some thread
+void WorkGroup_submit (WorkGroup *group, WorkFunction func, void *data,
+		int index);
+// Waits for all the work submitted so far. The group can be used again
+// afterwards.
+void WorkGroup_wait (WorkGroup *group);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_THREADS_WORKPOOL_H_ */
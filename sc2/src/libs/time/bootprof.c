@@ -0,0 +1,111 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "bootprof.h"
+
+#include "libs/timelib.h"
+#include "libs/log.h"
+
+#include <stdlib.h>
+
+static const char *const phaseNames[BOOT_NUM_PHASES] =
+{
+	"config",
+	"content mounts",
+	"resource indexes",
+	"core systems",
+	"graphics",
+	"input",
+	"audio",
+	"ship list",
+	"kernel resources",
+	"splash screen",
+};
+
+volatile BOOLEAN BootProfile_enabled;
+
+static DWORD bootStart;
+static DWORD phaseStart[BOOT_NUM_PHASES];
+static BOOLEAN phaseRunning[BOOT_NUM_PHASES];
+static DWORD phaseSum[BOOT_NUM_PHASES];
+static COUNT phaseCount[BOOT_NUM_PHASES];
+
+void
+BootProfile_enable (void)
+{
+	bootStart = GetTimeMicroseconds ();
+	BootProfile_enabled = TRUE;
+}
+
+void
+BootProfile_begin (BootPhase phase)
+{
+	phaseStart[phase] = GetTimeMicroseconds ();
+	phaseRunning[phase] = TRUE;
+}
+
+void
+BootProfile_end (BootPhase phase)
+{
+	if (!phaseRunning[phase])
+		return;
+
+	phaseSum[phase] += GetTimeMicroseconds () - phaseStart[phase];
+	++phaseCount[phase];
+	phaseRunning[phase] = FALSE;
+}
+
+static int
+comparePhases (const void *a, const void *b)
+{
+	DWORD sumA = phaseSum[*(const int *) a];
+	DWORD sumB = phaseSum[*(const int *) b];
+
+	return sumA < sumB ? 1 : sumA > sumB ? -1 : 0;
+}
+
+void
+BootProfile_finish (void)
+{
+	int sorted[BOOT_NUM_PHASES];
+	DWORD total;
+	int i;
+
+	if (!BootProfile_enabled)
+		return;
+	BootProfile_enabled = FALSE;
+
+	total = GetTimeMicroseconds () - bootStart;
+	for (i = 0; i < BOOT_NUM_PHASES; ++i)
+		sorted[i] = i;
+	qsort (sorted, BOOT_NUM_PHASES, sizeof sorted[0], comparePhases);
+
+	log_add (log_Info, "Startup took %lu ms to the main menu, including "
+			"the splash screen and intro; slowest phases first:",
+			(unsigned long) (total / 1000));
+	for (i = 0; i < BOOT_NUM_PHASES; ++i)
+	{
+		int phase = sorted[i];
+
+		if (phaseCount[phase] == 0)
+			continue;
+		log_add (log_Info, "  %-18s %8lu.%lu ms  (%u %s)",
+				phaseNames[phase], (unsigned long) (phaseSum[phase] / 1000),
+				(unsigned long) (phaseSum[phase] % 1000 / 100),
+				(unsigned) phaseCount[phase],
+				phaseCount[phase] == 1 ? "time" : "times");
+	}
+}
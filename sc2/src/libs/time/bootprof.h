@@ -0,0 +1,86 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Startup time breakdown, enabled with --bootprofile.
+ * The steps of starting up are bracketed by BOOT_BEGIN() and BOOT_END()
+ * for one of the phases below; a phase may be entered any number of
+ * times, and its times are summed. When the main menu comes up, the
+ * phases are logged, slowest first, along with the total time since the
+ * profile was enabled. When disabled, a marker costs one test of a
+ * global. */
+
+#ifndef LIBS_TIME_BOOTPROF_H_
+#define LIBS_TIME_BOOTPROF_H_
+
+#include "libs/compiler.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum
+{
+	BOOT_CONFIG,
+			// Config dir and uqm.cfg
+	BOOT_CONTENT,
+			// Mounting the content, addon and package dirs
+	BOOT_INDEXES,
+			// Loading resource indexes; mostly part of BOOT_CONTENT
+	BOOT_SYSTEMS,
+			// Time, tasks, work pool, alarms, network
+	BOOT_GRAPHICS,
+			// Video mode, scalers and color maps
+	BOOT_INPUT,
+	BOOT_AUDIO,
+	BOOT_SHIPS,
+			// The master ship list
+	BOOT_KERNEL,
+			// Fonts, menu graphics, strings and sounds
+	BOOT_SPLASH,
+			// Loading the title screen
+
+	BOOT_NUM_PHASES
+} BootPhase;
+
+extern volatile BOOLEAN BootProfile_enabled;
+
+#define BOOT_BEGIN(phase) \
+		do { \
+			if (BootProfile_enabled) \
+				BootProfile_begin (phase); \
+		} while (0)
+#define BOOT_END(phase) \
+		do { \
+			if (BootProfile_enabled) \
+				BootProfile_end (phase); \
+		} while (0)
+
+// The total is counted from here
+void BootProfile_enable (void);
+
+// A phase must not be entered again before it is left
+void BootProfile_begin (BootPhase phase);
+void BootProfile_end (BootPhase phase);
+
+// Logs the report and disables the profile; only the first call does
+// anything
+void BootProfile_finish (void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_TIME_BOOTPROF_H_ */
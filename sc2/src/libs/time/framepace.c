@@ -0,0 +1,74 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "framepace.h"
+
+#include "libs/threadlib.h"
+#include "libs/log.h"
+
+void
+FramePacer_init (FramePacer *pacer)
+{
+	pacer->due = 0;
+	pacer->frames = 0;
+	pacer->missed = 0;
+	pacer->resyncs = 0;
+	pacer->worstLate = 0;
+}
+
+BOOLEAN
+FramePacer_wait (FramePacer *pacer, TimePeriod period)
+{
+	TimeCount now = GetTimeCounter ();
+	TimePeriod late;
+
+	if (pacer->due == 0)
+		pacer->due = now;
+	pacer->due += period;
+	++pacer->frames;
+
+	if ((sint32) (pacer->due - now) >= 0)
+	{
+		SleepThreadUntil (pacer->due);
+		return TRUE;
+	}
+
+	late = now - pacer->due;
+	if (late > FRAMEPACE_MAX_BEHIND * period)
+	{	// Too far behind to catch up; the frames in between are lost
+		++pacer->resyncs;
+		pacer->due = now;
+		return FALSE;
+	}
+
+	++pacer->missed;
+	if (late > pacer->worstLate)
+		pacer->worstLate = late;
+	return FALSE;
+}
+
+void
+FramePacer_report (const FramePacer *pacer, const char *what)
+{
+	if (pacer->missed == 0)
+		return;
+
+	log_add (log_Info, "%s: %lu of %lu frames late (by up to %lu ms), "
+			"restarted %lu times", what, (unsigned long) pacer->missed,
+			(unsigned long) pacer->frames,
+			(unsigned long) (pacer->worstLate * 1000 / ONE_SECOND),
+			(unsigned long) pacer->resyncs);
+}
@@ -0,0 +1,67 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Pacing of game loops on a fixed tick.
+ * A loop that sleeps until 'now + period' after doing its work runs
+ * slower by however long the work took, and every late wakeup is added
+ * to all the frames after it. A FramePacer instead keeps the time each
+ * frame is due, and moves it on by exactly one period per frame, so
+ * that a frame that runs late is made up by the ones after it.
+ * When the loop falls behind by more than FRAMEPACE_MAX_BEHIND periods
+ * (it was paused, or the machine is just too slow), the frames that
+ * were missed are dropped from the schedule instead of being rushed
+ * through. */
+
+#ifndef LIBS_TIME_FRAMEPACE_H_
+#define LIBS_TIME_FRAMEPACE_H_
+
+#include "libs/compiler.h"
+#include "libs/timelib.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define FRAMEPACE_MAX_BEHIND 3
+
+typedef struct
+{
+	TimeCount due;
+			// When the current frame is to end; 0 before the first one
+	DWORD frames;
+	DWORD missed;
+			// Frames that ended after they were due
+	DWORD resyncs;
+			// Times the schedule was started over from the current time
+	TimePeriod worstLate;
+			// The furthest a frame ran past its due time, not counting
+			// resyncs
+} FramePacer;
+
+void FramePacer_init (FramePacer *pacer);
+
+// Ends a frame of 'period' ticks, sleeping until it is due.
+// Returns FALSE if it was already past due.
+BOOLEAN FramePacer_wait (FramePacer *pacer, TimePeriod period);
+
+// Logs the missed deadlines, if there were any
+void FramePacer_report (const FramePacer *pacer, const char *what);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_TIME_FRAMEPACE_H_ */
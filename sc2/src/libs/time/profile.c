@@ -0,0 +1,266 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "profile.h"
+
+#include "libs/timelib.h"
+
+#include <string.h>
+
+typedef struct
+{
+	DWORD frameTime;
+	DWORD sectionTime[PROF_NUM_SECTIONS];
+} ProfileFrame;
+
+static const struct
+{
+	const char *name;
+	int parent;
+			// The section this one is always nested in, or -1
+} sectionInfo[PROF_NUM_SECTIONS] =
+{
+	{ "input",       -1 },
+	{ "preprocess",  -1 },
+	{ "postprocess", -1 },
+	{ "comm",        -1 },
+	{ "flush",       -1 },
+	{ "swap",        PROF_FLUSH },
+	{ "scale",       PROF_SWAP },
+	{ "audio",       -1 },
+};
+
+volatile BOOLEAN Profile_enabled;
+BOOLEAN Profile_showGraph = TRUE;
+
+// The sums for the frame in progress. These are updated without locking;
+// a section ending on another thread while the frame is closed may be
+// counted in the wrong frame, which is good enough here.
+static DWORD sectionStart[PROF_NUM_SECTIONS];
+static BOOLEAN sectionRunning[PROF_NUM_SECTIONS];
+static DWORD sectionSum[PROF_NUM_SECTIONS];
+static DWORD frameStart;
+
+static ProfileFrame history[PROFILE_HISTORY];
+static COUNT historyNext;
+static COUNT historyCount;
+
+#define PROFILE_SUB_BUCKETS 16
+		// Buckets per power of two; the times below that many us each
+		// have their own
+#define PROFILE_NUM_BUCKETS ((32 - 3) * PROFILE_SUB_BUCKETS)
+
+static DWORD frameHistogram[PROFILE_NUM_BUCKETS];
+static DWORD sectionHistogram[PROF_NUM_SECTIONS][PROFILE_NUM_BUCKETS];
+static DWORD totalFrames;
+
+void
+Profile_enable (BOOLEAN enable)
+{
+	if (enable && !Profile_enabled)
+	{
+		memset (sectionRunning, 0, sizeof sectionRunning);
+		memset (sectionSum, 0, sizeof sectionSum);
+		historyNext = 0;
+		historyCount = 0;
+		memset (frameHistogram, 0, sizeof frameHistogram);
+		memset (sectionHistogram, 0, sizeof sectionHistogram);
+		totalFrames = 0;
+		frameStart = GetTimeMicroseconds ();
+	}
+	Profile_enabled = enable;
+}
+
+void
+Profile_begin (ProfileSection section)
+{
+	sectionStart[section] = GetTimeMicroseconds ();
+	sectionRunning[section] = TRUE;
+}
+
+void
+Profile_end (ProfileSection section)
+{
+	if (!sectionRunning[section])
+		return; // Profiling was enabled inside the section
+
+	sectionSum[section] += GetTimeMicroseconds () - sectionStart[section];
+	sectionRunning[section] = FALSE;
+}
+
+static COUNT
+bucketOf (DWORD us)
+{
+	int bit = 4;
+
+	if (us < PROFILE_SUB_BUCKETS)
+		return us;
+
+	while (bit < 31 && (us >> (bit + 1)) != 0)
+		++bit;
+	// The top bit selects the power of two, the 4 below it the bucket
+	return (bit - 3) * PROFILE_SUB_BUCKETS
+			+ ((us >> (bit - 4)) & (PROFILE_SUB_BUCKETS - 1));
+}
+
+// The middle of the times counted in 'bucket'
+static DWORD
+bucketTime (COUNT bucket)
+{
+	int bit;
+
+	if (bucket < PROFILE_SUB_BUCKETS)
+		return bucket;
+
+	bit = bucket / PROFILE_SUB_BUCKETS + 3;
+	return ((PROFILE_SUB_BUCKETS + bucket % PROFILE_SUB_BUCKETS)
+			<< (bit - 4)) + ((1 << (bit - 4)) >> 1);
+}
+
+void
+Profile_endFrame (void)
+{
+	ProfileFrame *frame;
+	DWORD now;
+	int i;
+
+	if (!Profile_enabled)
+		return;
+
+	now = GetTimeMicroseconds ();
+	frame = &history[historyNext];
+	frame->frameTime = now - frameStart;
+	frameStart = now;
+
+	memcpy (frame->sectionTime, sectionSum, sizeof sectionSum);
+	memset (sectionSum, 0, sizeof sectionSum);
+	// Innermost sections come last, so each is taken out of its parent
+	// before the parent is taken out of its own.
+	for (i = PROF_NUM_SECTIONS - 1; i >= 0; --i)
+	{
+		int parent = sectionInfo[i].parent;
+		if (parent < 0)
+			continue;
+
+		if (frame->sectionTime[parent] > frame->sectionTime[i])
+			frame->sectionTime[parent] -= frame->sectionTime[i];
+		else
+			frame->sectionTime[parent] = 0;
+	}
+
+	++frameHistogram[bucketOf (frame->frameTime)];
+	for (i = 0; i < PROF_NUM_SECTIONS; ++i)
+		++sectionHistogram[i][bucketOf (frame->sectionTime[i])];
+	++totalFrames;
+
+	historyNext = (historyNext + 1) % PROFILE_HISTORY;
+	if (historyCount < PROFILE_HISTORY)
+		++historyCount;
+}
+
+const char *
+Profile_sectionName (ProfileSection section)
+{
+	return sectionInfo[section].name;
+}
+
+COUNT
+Profile_numFrames (void)
+{
+	return historyCount;
+}
+
+static const ProfileFrame *
+getFrame (COUNT framesAgo)
+{
+	if (framesAgo >= historyCount)
+		return NULL;
+	return &history[(historyNext + PROFILE_HISTORY - 1 - framesAgo)
+			% PROFILE_HISTORY];
+}
+
+DWORD
+Profile_frameTime (COUNT framesAgo)
+{
+	const ProfileFrame *frame = getFrame (framesAgo);
+	return frame ? frame->frameTime : 0;
+}
+
+DWORD
+Profile_sectionTime (COUNT framesAgo, ProfileSection section)
+{
+	const ProfileFrame *frame = getFrame (framesAgo);
+	return frame ? frame->sectionTime[section] : 0;
+}
+
+DWORD
+Profile_totalFrames (void)
+{
+	return totalFrames;
+}
+
+static DWORD
+percentile (const DWORD *histogram, int percent)
+{
+	DWORD wanted = (DWORD) (((double) totalFrames * percent + 99) / 100);
+	DWORD counted = 0;
+	COUNT bucket;
+
+	if (wanted == 0)
+		wanted = 1;
+	for (bucket = 0; bucket < PROFILE_NUM_BUCKETS; ++bucket)
+	{
+		counted += histogram[bucket];
+		if (counted >= wanted)
+			return bucketTime (bucket);
+	}
+	return 0;
+}
+
+DWORD
+Profile_framePercentile (int percent)
+{
+	return percentile (frameHistogram, percent);
+}
+
+DWORD
+Profile_sectionPercentile (ProfileSection section, int percent)
+{
+	return percentile (sectionHistogram[section], percent);
+}
+
+void
+Profile_dumpCSV (FILE *out)
+{
+	COUNT framesAgo;
+	int i;
+
+	fprintf (out, "frame,total");
+	for (i = 0; i < PROF_NUM_SECTIONS; ++i)
+		fprintf (out, ",%s", sectionInfo[i].name);
+	fprintf (out, "\n");
+
+	for (framesAgo = historyCount; framesAgo-- > 0; )
+	{
+		const ProfileFrame *frame = getFrame (framesAgo);
+
+		fprintf (out, "%u,%lu", historyCount - 1 - framesAgo,
+				(unsigned long) frame->frameTime);
+		for (i = 0; i < PROF_NUM_SECTIONS; ++i)
+			fprintf (out, ",%lu", (unsigned long) frame->sectionTime[i]);
+		fprintf (out, "\n");
+	}
+}
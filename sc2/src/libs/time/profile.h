@@ -0,0 +1,109 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Lightweight frame time profiling.
+ * Code under test is bracketed by PROFILE_BEGIN() and PROFILE_END() for
+ * one of the sections below. The time spent in each section is summed
+ * until the next displayed frame, and the sums of the last
+ * PROFILE_HISTORY frames are kept. For longer runs, the times of all
+ * frames since profiling was enabled are also counted in histograms, from
+ * which percentiles are read to within about 1/32. When profiling is
+ * disabled, a marker costs one test of a global. */
+
+#ifndef LIBS_TIME_PROFILE_H_
+#define LIBS_TIME_PROFILE_H_
+
+#include "libs/compiler.h"
+
+#include <stdio.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum
+{
+	PROF_INPUT,
+			// Battle input and computer ship AI
+	PROF_PREPROCESS,
+			// Element movement (PreProcessQueue)
+	PROF_POSTPROCESS,
+			// Collisions and drawing the elements (PostProcessQueue)
+	PROF_COMM,
+			// Comm screen animations and oscilloscope
+	PROF_FLUSH,
+			// Executing the draw command queue
+	PROF_SWAP,
+			// Composing the screens for display
+	PROF_SCALE,
+			// Scaling; part of PROF_SWAP
+	PROF_AUDIO,
+			// Stream decoding, on the decoder thread
+
+	PROF_NUM_SECTIONS
+} ProfileSection;
+
+#define PROFILE_HISTORY 128
+
+extern volatile BOOLEAN Profile_enabled;
+extern BOOLEAN Profile_showGraph;
+		// Whether the frame times are drawn while profiling; TRUE unless
+		// changed
+
+#define PROFILE_BEGIN(section) \
+		do { \
+			if (Profile_enabled) \
+				Profile_begin (section); \
+		} while (0)
+#define PROFILE_END(section) \
+		do { \
+			if (Profile_enabled) \
+				Profile_end (section); \
+		} while (0)
+
+void Profile_enable (BOOLEAN enable);
+		// Enabling clears the history
+
+// A section must not be entered again before it is left; markers for
+// different sections may be used from different threads.
+void Profile_begin (ProfileSection section);
+void Profile_end (ProfileSection section);
+
+// Called once for every frame displayed
+void Profile_endFrame (void);
+
+const char *Profile_sectionName (ProfileSection section);
+COUNT Profile_numFrames (void);
+		// The number of frames in the history
+// Times are in microseconds. 'framesAgo' is 0 for the last complete frame.
+// Sections contained in another do not count towards the outer one.
+DWORD Profile_frameTime (COUNT framesAgo);
+DWORD Profile_sectionTime (COUNT framesAgo, ProfileSection section);
+
+DWORD Profile_totalFrames (void);
+		// The number of frames since profiling was enabled
+// The time that 'percent' percent of all those frames took at most
+DWORD Profile_framePercentile (int percent);
+DWORD Profile_sectionPercentile (ProfileSection section, int percent);
+
+// Writes the history, oldest frame first
+void Profile_dumpCSV (FILE *out);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_TIME_PROFILE_H_ */
@@ -20,11 +20,108 @@
 #include "sdltime.h"
 #include "libs/timelib.h"
 
-Uint32
-SDLWrapper_GetTimeCounter (void)
+#if SDL_MAJOR_VERSION > 1
+// The performance counter is clock_gettime(CLOCK_MONOTONIC) or
+// QueryPerformanceCounter() underneath. SDL_GetTicks() only counts whole
+// milliseconds, which do not line up with the ticks of ONE_SECOND, so
+// that a tick measured with it could be 1 or 2 ms long.
+static Uint64 perfFreq;
+static Uint64 perfBase;
+		// The performance counter when the time system was started
+static Uint32 counterBase;
+		// The time counter at that moment, continuing the one from
+		// SDL_GetTicks() used before that
+#endif
+
+static Uint32
+ticksTimeCounter (void)
 {
 	Uint32 ticks = SDL_GetTicks ();
 	return (ticks / 1000) * ONE_SECOND + ((ticks % 1000) * ONE_SECOND / 1000);
 	// Use the following instead when confirming "random" lockup bugs (see #668)
 	//return ticks * ONE_SECOND / 1000;
 }
+
+void
+SDLWrapper_InitTimeSystem (void)
+{
+#if SDL_MAJOR_VERSION > 1
+	if (perfFreq != 0)
+		return;
+	counterBase = ticksTimeCounter ();
+	perfBase = SDL_GetPerformanceCounter ();
+	perfFreq = SDL_GetPerformanceFrequency ();
+#endif
+}
+
+Uint32
+SDLWrapper_GetTimeCounter (void)
+{
+#if SDL_MAJOR_VERSION > 1
+	Uint64 count;
+
+	if (perfFreq == 0)
+		return ticksTimeCounter ();
+
+	count = SDL_GetPerformanceCounter () - perfBase;
+	return counterBase + (Uint32) ((count / perfFreq) * ONE_SECOND
+			+ (count % perfFreq) * ONE_SECOND / perfFreq);
+#else
+	return ticksTimeCounter ();
+#endif
+}
+
+Uint32
+SDLWrapper_GetTimeMicrosecondsUntil (Uint32 when)
+{
+	Uint32 now;
+	Uint32 left;
+	Uint64 frac = 0;
+			// How far into the current tick we are, in 1 / perfFreq ticks
+
+#if SDL_MAJOR_VERSION > 1
+	if (perfFreq != 0)
+	{
+		Uint64 units = (SDL_GetPerformanceCounter () - perfBase)
+				* ONE_SECOND;
+		now = counterBase + (Uint32) (units / perfFreq);
+		frac = units % perfFreq;
+	}
+	else
+#endif
+		now = ticksTimeCounter ();
+
+	if ((Sint32) (when - now) <= 0)
+		return 0;
+	left = when - now;
+
+#if SDL_MAJOR_VERSION > 1
+	if (perfFreq != 0)
+	{
+		Uint64 count = ((Uint64) left * perfFreq - frac + ONE_SECOND - 1)
+				/ ONE_SECOND;
+				// Performance counts, rounded up
+		return (Uint32) ((count / perfFreq) * 1000000
+				+ ((count % perfFreq) * 1000000 + perfFreq - 1) / perfFreq);
+	}
+#endif
+	(void) frac;
+	return (left / ONE_SECOND) * 1000000
+			+ (left % ONE_SECOND) * 1000000 / ONE_SECOND;
+}
+
+Uint32
+SDLWrapper_GetTimeMicroseconds (void)
+{
+#if SDL_MAJOR_VERSION > 1
+	static Uint64 freq;
+	Uint64 count = SDL_GetPerformanceCounter ();
+
+	if (freq == 0)
+		freq = SDL_GetPerformanceFrequency ();
+	return (Uint32) ((count / freq) * 1000000
+			+ (count % freq) * 1000000 / freq);
+#else
+	return SDL_GetTicks () * 1000;
+#endif
+}
@@ -24,11 +24,19 @@
 #include SDL_INCLUDE(SDL.h)
 #include "../timecommon.h"
 
-#define NativeInitTimeSystem()
+extern void SDLWrapper_InitTimeSystem (void);
+#define NativeInitTimeSystem() \
+		SDLWrapper_InitTimeSystem ()
 #define NativeUnInitTimeSystem()
 extern Uint32 SDLWrapper_GetTimeCounter (void);
 #define NativeGetTimeCounter() \
 		SDLWrapper_GetTimeCounter ()
+extern Uint32 SDLWrapper_GetTimeMicrosecondsUntil (Uint32 when);
+#define NativeGetTimeMicrosecondsUntil(when) \
+		SDLWrapper_GetTimeMicrosecondsUntil (when)
+extern Uint32 SDLWrapper_GetTimeMicroseconds (void);
+#define NativeGetTimeMicroseconds() \
+		SDLWrapper_GetTimeMicroseconds ()
 
 
 #endif  /* LIBS_TIME_SDL_SDLTIME_H_ */
@@ -39,3 +39,15 @@ GetTimeCounter (void)
 	return NativeGetTimeCounter ();
 }
 
+DWORD
+GetTimeMicrosecondsUntil (TimeCount when)
+{
+	return NativeGetTimeMicrosecondsUntil (when);
+}
+
+
+DWORD
+GetTimeMicroseconds (void)
+{
+	return NativeGetTimeMicroseconds ();
+}
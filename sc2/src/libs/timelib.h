@@ -41,6 +41,10 @@ typedef DWORD TimePeriod;
 extern void InitTimeSystem (void);
 extern void UnInitTimeSystem (void);
 extern TimeCount GetTimeCounter (void);
+extern DWORD GetTimeMicrosecondsUntil (TimeCount when);
+		// 0 if the time counter has already reached 'when'
+extern DWORD GetTimeMicroseconds (void);
+		// For measuring short intervals; wraps around after 71 minutes
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2003  Serge van den Boom
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ * Nota bene: later versions of the GNU General Public License do not apply
+ * to this program.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// This file is used as a template; see hashtable.h.
+// The entries are kept in the slot array itself, in Robin Hood order:
+// a lookup can stop at the first slot holding an entry that is closer
+// to its home slot than the key looked for would be, and a removal
+// shifts the entries after it one slot back, so that no tombstones
+// are needed.
+
+#ifndef HASHTABLE_INTERNAL
+#	define HASHTABLE_INTERNAL
+#	include "hashtable.h"
+#endif
+
+#include "mem.h"
+#include "uioport.h"
+
+#define HASHTABLE_MIN_SIZE 8
+		// Never shrink below this number of slots.
+#define HASHTABLE_MAX_FILL_QUOTIENT 0.9
+		// Fill more than this, and the probe sequences get long.
+
+static void HASHTABLE_(setSize)(HASHTABLE_(HashTable) *hashTable,
+		uio_uint32 size);
+static void HASHTABLE_(resize)(HASHTABLE_(HashTable) *hashTable,
+		uio_uint32 size);
+static void HASHTABLE_(place)(HASHTABLE_(HashTable) *hashTable,
+		HASHTABLE_(HashEntry) entry);
+static HASHTABLE_(HashEntry) *HASHTABLE_(findEntry)(
+		HASHTABLE_(HashTable) *hashTable,
+		const HASHTABLE_(Key) *key, uio_uint32 hash);
+static inline uio_uint32 HASHTABLE_(nextPower2)(uio_uint32 x);
+
+
+HASHTABLE_(HashTable) *
+HASHTABLE_(newHashTable)(
+		HASHTABLE_(HashFunction) hashFunction,
+		HASHTABLE_(EqualFunction) equalFunction,
+		HASHTABLE_(CopyFunction) copyFunction,
+		HASHTABLE_(FreeKeyFunction) freeKeyFunction,
+		HASHTABLE_(FreeValueFunction) freeValueFunction,
+		uio_uint32 initialSize,
+		double minFillQuotient, double maxFillQuotient) {
+	HASHTABLE_(HashTable) *hashTable;
+	uio_uint32 size;
+
+	hashTable = uio_malloc(sizeof (HASHTABLE_(HashTable)));
+	if (hashTable == NULL)
+		return NULL;
+	hashTable->hashFunction = hashFunction;
+	hashTable->equalFunction = equalFunction;
+	hashTable->copyFunction = copyFunction;
+	hashTable->freeKeyFunction = freeKeyFunction;
+	hashTable->freeValueFunction = freeValueFunction;
+
+	if (maxFillQuotient > HASHTABLE_MAX_FILL_QUOTIENT)
+		maxFillQuotient = HASHTABLE_MAX_FILL_QUOTIENT;
+	if (minFillQuotient > maxFillQuotient)
+		minFillQuotient = maxFillQuotient;
+	hashTable->minFillQuotient = minFillQuotient;
+	hashTable->maxFillQuotient = maxFillQuotient;
+
+	// Room for initialSize entries without growing.
+	size = (uio_uint32) (initialSize / maxFillQuotient) + 1;
+	if (size < HASHTABLE_MIN_SIZE)
+		size = HASHTABLE_MIN_SIZE;
+	size = HASHTABLE_(nextPower2)(size);
+
+	hashTable->entries = uio_calloc(size, sizeof (HASHTABLE_(HashEntry)));
+	if (hashTable->entries == NULL) {
+		uio_free(hashTable);
+		return NULL;
+	}
+	HASHTABLE_(setSize)(hashTable, size);
+	hashTable->numEntries = 0;
+#ifdef HashTable_PROFILE
+	hashTable->numCollisions = 0;
+#endif
+	return hashTable;
+}
+
+// Returns true if the key was added, false if it was already present
+// (in which case the table is left unchanged).
+uio_bool
+HASHTABLE_(add)(HASHTABLE_(HashTable) *hashTable,
+		const HASHTABLE_(Key) *key, HASHTABLE_(Value) *value) {
+	HASHTABLE_(HashEntry) entry;
+
+	entry.hash = HASHTABLE_(HASH)(hashTable, key);
+	if (HASHTABLE_(findEntry)(hashTable, key, entry.hash) != NULL)
+		return false;
+
+	if (hashTable->numEntries + 1 > hashTable->maxSize)
+		HASHTABLE_(resize)(hashTable, hashTable->size * 2);
+
+	entry.key = HASHTABLE_(COPY)(hashTable, key);
+	entry.value = value;
+	HASHTABLE_(place)(hashTable, entry);
+	hashTable->numEntries++;
+	return true;
+}
+
+// Returns true if the key was found and removed, false otherwise.
+uio_bool
+HASHTABLE_(remove)(HASHTABLE_(HashTable) *hashTable,
+		const HASHTABLE_(Key) *key) {
+	HASHTABLE_(HashEntry) *entries = hashTable->entries;
+	HASHTABLE_(HashEntry) *entry;
+	uio_uint32 i;
+
+	entry = HASHTABLE_(findEntry)(hashTable, key,
+			HASHTABLE_(HASH)(hashTable, key));
+	if (entry == NULL)
+		return false;
+
+	HASHTABLE_(FREEKEY)(hashTable, entry->key);
+	HASHTABLE_(FREEVALUE)(hashTable, entry->value);
+
+	// Shift back the entries that are not in their home slot.
+	i = (uio_uint32) (entry - entries);
+	for (;;) {
+		uio_uint32 next = (i + 1) & hashTable->hashMask;
+		if (entries[next].distance <= 1)
+			break;
+		entries[i] = entries[next];
+		entries[i].distance--;
+		i = next;
+	}
+	entries[i].distance = 0;
+	hashTable->numEntries--;
+
+	if (hashTable->numEntries < hashTable->minSize)
+		HASHTABLE_(resize)(hashTable, hashTable->size / 2);
+	return true;
+}
+
+HASHTABLE_(Value) *
+HASHTABLE_(find)(HASHTABLE_(HashTable) *hashTable,
+		const HASHTABLE_(Key) *key) {
+	HASHTABLE_(HashEntry) *entry;
+
+	entry = HASHTABLE_(findEntry)(hashTable, key,
+			HASHTABLE_(HASH)(hashTable, key));
+	if (entry == NULL)
+		return NULL;
+	return entry->value;
+}
+
+uio_uint32
+HASHTABLE_(count)(const HASHTABLE_(HashTable) *hashTable) {
+	return hashTable->numEntries;
+}
+
+void
+HASHTABLE_(deleteHashTable)(HASHTABLE_(HashTable) *hashTable) {
+	uio_uint32 i;
+
+	for (i = 0; i < hashTable->size; i++) {
+		HASHTABLE_(HashEntry) *entry = &hashTable->entries[i];
+		if (entry->distance == 0)
+			continue;
+		HASHTABLE_(FREEKEY)(hashTable, entry->key);
+		HASHTABLE_(FREEVALUE)(hashTable, entry->value);
+	}
+	uio_free(hashTable->entries);
+	uio_free(hashTable);
+}
+
+// The table may not be changed while an iterator is in use.
+HASHTABLE_(Iterator) *
+HASHTABLE_(getIterator)(const HASHTABLE_(HashTable) *hashTable) {
+	HASHTABLE_(Iterator) *iterator;
+
+	iterator = uio_malloc(sizeof (HASHTABLE_(Iterator)));
+	if (iterator == NULL)
+		return NULL;
+	iterator->hashTable = hashTable;
+	iterator->bucketNr = 0;
+	while (iterator->bucketNr < hashTable->size &&
+			hashTable->entries[iterator->bucketNr].distance == 0)
+		iterator->bucketNr++;
+	return iterator;
+}
+
+int
+HASHTABLE_(iteratorDone)(const HASHTABLE_(Iterator) *iterator) {
+	return iterator->bucketNr >= iterator->hashTable->size;
+}
+
+HASHTABLE_(Key) *
+HASHTABLE_(iteratorKey)(HASHTABLE_(Iterator) *iterator) {
+	return iterator->hashTable->entries[iterator->bucketNr].key;
+}
+
+HASHTABLE_(Value) *
+HASHTABLE_(iteratorValue)(HASHTABLE_(Iterator) *iterator) {
+	return iterator->hashTable->entries[iterator->bucketNr].value;
+}
+
+HASHTABLE_(Iterator) *
+HASHTABLE_(iteratorNext)(HASHTABLE_(Iterator) *iterator) {
+	const HASHTABLE_(HashTable) *hashTable = iterator->hashTable;
+
+	do {
+		iterator->bucketNr++;
+	} while (iterator->bucketNr < hashTable->size &&
+			hashTable->entries[iterator->bucketNr].distance == 0);
+	return iterator;
+}
+
+void
+HASHTABLE_(freeIterator)(HASHTABLE_(Iterator) *iterator) {
+	uio_free(iterator);
+}
+
+static void
+HASHTABLE_(setSize)(HASHTABLE_(HashTable) *hashTable, uio_uint32 size) {
+	hashTable->size = size;
+	hashTable->hashMask = size - 1;
+	hashTable->maxSize = (uio_uint32) (size * hashTable->maxFillQuotient);
+	if (hashTable->maxSize >= size)
+		hashTable->maxSize = size - 1;
+			// There must always be an empty slot to end a probe.
+	hashTable->minSize = (size <= HASHTABLE_MIN_SIZE) ? 0 :
+			(uio_uint32) ((size / 2) * hashTable->minFillQuotient);
+}
+
+// Move all entries to a slot array of the given size.
+// If there is no memory for it, the table is left as it was; it still
+// works, only with longer probe sequences.
+static void
+HASHTABLE_(resize)(HASHTABLE_(HashTable) *hashTable, uio_uint32 size) {
+	HASHTABLE_(HashEntry) *oldEntries = hashTable->entries;
+	uio_uint32 oldSize = hashTable->size;
+	uio_uint32 i;
+
+	hashTable->entries = uio_calloc(size, sizeof (HASHTABLE_(HashEntry)));
+	if (hashTable->entries == NULL) {
+		hashTable->entries = oldEntries;
+		return;
+	}
+	HASHTABLE_(setSize)(hashTable, size);
+#ifdef HashTable_PROFILE
+	hashTable->numCollisions = 0;
+#endif
+
+	for (i = 0; i < oldSize; i++) {
+		if (oldEntries[i].distance != 0)
+			HASHTABLE_(place)(hashTable, oldEntries[i]);
+	}
+	uio_free(oldEntries);
+}
+
+// Put an entry in the table, which should have room for it and not
+// contain its key already.
+static void
+HASHTABLE_(place)(HASHTABLE_(HashTable) *hashTable,
+		HASHTABLE_(HashEntry) entry) {
+	HASHTABLE_(HashEntry) *entries = hashTable->entries;
+	uio_uint32 i;
+
+	i = entry.hash & hashTable->hashMask;
+	entry.distance = 1;
+	for (;;) {
+		if (entries[i].distance == 0) {
+			entries[i] = entry;
+			return;
+		}
+		if (entries[i].distance < entry.distance) {
+			// Take the slot of the entry closer to its home; that
+			// one moves on instead.
+			HASHTABLE_(HashEntry) displaced = entries[i];
+			entries[i] = entry;
+			entry = displaced;
+		}
+#ifdef HashTable_PROFILE
+		hashTable->numCollisions++;
+#endif
+		entry.distance++;
+		i = (i + 1) & hashTable->hashMask;
+	}
+}
+
+static HASHTABLE_(HashEntry) *
+HASHTABLE_(findEntry)(HASHTABLE_(HashTable) *hashTable,
+		const HASHTABLE_(Key) *key, uio_uint32 hash) {
+	HASHTABLE_(HashEntry) *entries = hashTable->entries;
+	uio_uint32 distance;
+	uio_uint32 i;
+
+	i = hash & hashTable->hashMask;
+	for (distance = 1; ; distance++) {
+		HASHTABLE_(HashEntry) *entry = &entries[i];
+		if (entry->distance < distance) {
+			// Empty, or an entry that would have been placed after
+			// ours if ours were here.
+			return NULL;
+		}
+		if (entry->hash == hash &&
+				HASHTABLE_(EQUAL)(hashTable, entry->key, key))
+			return entry;
+		i = (i + 1) & hashTable->hashMask;
+	}
+}
+
+static inline uio_uint32
+HASHTABLE_(nextPower2)(uio_uint32 x) {
+	x--;
+	x |= x >> 1;
+	x |= x >> 2;
+	x |= x >> 4;
+	x |= x >> 8;
+	x |= x >> 16;
+	return x + 1;
+}
+
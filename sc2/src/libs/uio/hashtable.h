@@ -33,6 +33,11 @@
 // Define to enable profiling.
 #define HashTable_PROFILE
 
+// The table uses open addressing with linear probing, in Robin Hood
+// order: an entry is never further from its home slot than an entry it
+// was placed before. The hash of each key is kept in its slot, so keys
+// are only compared when their hashes match.
+
 // You can use inline hash functions for extra speed, by using this file as
 // a template.
 // To do this, make a new .h and .c file. In the .h file, define the macros
@@ -96,31 +101,35 @@ struct HASHTABLE_(HashTable) {
 	uio_uint32 maxSize;
 			// Resize to size*2 when above this size.
 	uio_uint32 size;
-			// The number of buckets in the hash table.
+			// The number of slots in the hash table; a power of 2.
 	uio_uint32 hashMask;
 			// Mask to take on a the calculated hash value, to make it
 			// fit into the table.
 
-	HASHTABLE_(HashEntry) **entries;
-			// The actual entries
+	HASHTABLE_(HashEntry) *entries;
+			// The slots, holding the entries themselves
 
 	uio_uint32 numEntries;
 #ifdef HashTable_PROFILE
 	uio_uint32 numCollisions;
+			// Number of occupied slots passed while placing entries,
+			// since the table was last resized.
 #endif
 };
 
 struct HASHTABLE_(HashEntry) {
 	uio_uint32 hash;
+	uio_uint32 distance;
+			// 1 + how far the entry is from its home slot; 0 if the
+			// slot is empty.
 	HASHTABLE_(Key) *key;
 	HASHTABLE_(Value) *value;
-	HASHTABLE_(HashEntry) *next;
 };
 
 struct HASHTABLE_(Iterator) {
 	const HASHTABLE_(HashTable) *hashTable;
 	uio_uint32 bucketNr;
-	HASHTABLE_(HashEntry) *entry;
+			// The slot of the current entry; hashTable->size when done.
 };
 
 HASHTABLE_(HashTable) *HASHTABLE_(newHashTable)(
@@ -82,6 +82,24 @@ uio_MountHandle *uio_mountDir(uio_Repository *destRep, const char *mountPoint,
 		const char *inPath, uio_AutoMount **autoMount, int flags,
 		uio_MountHandle *relative);
 
+#ifdef USE_RUST_UIO
+// Index the zip archives 'names' in 'sourceDir' concurrently, for
+// uio_mountDir() to use when they are mounted afterwards. Mounting them
+// is still to be done one by one, in order of precedence.
+// Returns the number of archives indexed.
+int uio_preindexArchives(uio_DirHandle *sourceDir, const char *const names[],
+		int count);
+// Drop what uio_preindexArchives() indexed and was not mounted.
+void uio_forgetPreindexedArchives(void);
+// Start (enable != 0) or stop counting opens, reads and seeks per file,
+// for uio_printMounts() to report. Also started by having UQM_UIO_STATS
+// set in the environment.
+void uio_setStatsEnabled(int enable);
+// Set the number of bytes of small zip entries kept inflated in memory
+// for the next time they are opened (8 MB by default); 0 turns it off.
+void uio_setEntryCacheSize(size_t size);
+#endif
+
 // Mount a repository directory into same repository at a different
 // location.
 // From fossil.
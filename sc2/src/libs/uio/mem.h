@@ -24,13 +24,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include "uioport.h"
+#include "libs/memlib.h"
 
-#define uio_malloc malloc
-#define uio_realloc realloc
-#define uio_free free
-#define uio_calloc calloc
+#ifdef TRACK_MEMORY
+#	define uio_malloc(s) MemTrack_malloc (s, MEMTAG_UIO)
+#	define uio_realloc(p, s) MemTrack_realloc (p, s, MEMTAG_UIO)
+#	define uio_free(p) MemTrack_free (p)
+#	define uio_calloc(n, s) MemTrack_calloc (n, s, MEMTAG_UIO)
+#else
+#	define uio_malloc malloc
+#	define uio_realloc realloc
+#	define uio_free free
+#	define uio_calloc calloc
+#endif
 
-#ifdef uio_MEM_DEBUG
+#if defined(uio_MEM_DEBUG) || defined(TRACK_MEMORY)
 // When uio_strdup is defined to the libc strdup, there's no opportunity
 // to intercept the alloc. Hence this function here.
 static inline char *
@@ -53,6 +53,15 @@ int uio_ferror(uio_Stream *stream);
 void uio_clearerr(uio_Stream *stream);
 uio_Handle *uio_streamHandle(uio_Stream *stream);
 
+#ifdef USE_RUST_UIO
+#define uio_STREAM_USAGE_SEQUENTIAL 1
+// Hint that 'stream' is read front to back, so that up to
+// 'readAheadBufSize' bytes after the read position can be read ahead of
+// time on an I/O thread. Usage 0 undoes that.
+void uio_setStreamUsageHint(uio_Stream *stream, int usage,
+		size_t readAheadBufSize);
+#endif
+
 
 /* *** Internal definitions follow *** */
 #ifdef uio_INTERNAL
@@ -29,6 +29,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/stat.h>
@@ -44,6 +45,9 @@
 
 
 #define DIR_STRUCTURE_READ_BUFSIZE 0x10000
+#define LOCAL_HEADERS_READ_BUFSIZE 0x1000
+		// Enough for the local headers of a few small files at once,
+		// without reading much of the data of large ones
 
 static int zip_badFile(zip_GPFileData *gPFileData, char *fileName);
 static int zip_fillDirStructure(uio_GPDir *top, uio_Handle *handle);
@@ -53,13 +57,25 @@ static int zip_fillDirStructureLocalProcessEntry(uio_GPDir *topGPDir,
 		uio_FileBlock *fileBlock, off_t *pos);
 #endif
 #if zip_USE_HEADERS == zip_USE_CENTRAL_HEADERS
+// The regular files found in the central directory, for reading their
+// local headers in one go afterwards.
+typedef struct {
+	zip_GPFileData **files;
+	uio_uint32 numFiles;
+	uio_uint32 maxFiles;
+} zip_FileList;
+
 static off_t zip_findEndOfCentralDirectoryRecord(uio_Handle *handle,
 		uio_FileBlock *fileBlock);
 static int zip_fillDirStructureCentral(uio_GPDir *top, uio_Handle *handle);
 static int zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
-		uio_FileBlock *fileBlock, off_t *pos);
+		uio_FileBlock *fileBlock, off_t *pos, zip_FileList *fileList);
+static void zip_readLocalHeaders(uio_FileBlock *fileBlock,
+		zip_FileList *fileList);
 static int zip_updatePFileDataFromLocalFileHeader(zip_GPFileData *gPFileData,
 		uio_FileBlock *fileBlock, int pos);
+static int zip_readLocalHeader(zip_GPFileData *gPFileData,
+		uio_FileBlock *fileBlock);
 int zip_updateFileDataFromLocalHeader(uio_Handle *handle,
 		zip_GPFileData *gPFileData);
 #endif
@@ -89,6 +105,14 @@ static ssize_t zip_readStored(uio_Handle *handle, void *buf, size_t count);
 static ssize_t zip_readDeflated(uio_Handle *handle, void *buf, size_t count);
 static off_t zip_seekStored(uio_Handle *handle, off_t offset);
 static off_t zip_seekDeflated(uio_Handle *handle, off_t offset);
+#ifdef zip_USE_CHECKPOINTS
+static void zip_addCheckpoint(zip_Handle *zipHandle);
+static const zip_Checkpoint *zip_findCheckpoint(const zip_Handle *zipHandle,
+		off_t offset);
+static int zip_resumeFromCheckpoint(zip_Handle *zipHandle,
+		const zip_Checkpoint *checkpoint);
+static void zip_freeCheckpoints(zip_Handle *zipHandle);
+#endif
 
 uio_FileSystemHandler zip_fileSystemHandler = {
 	/* .init    = */  NULL,
@@ -191,6 +215,9 @@ static mode_t zip_makeFileMode(zip_OSType creatorOS, uio_uint32 modeBytes);
 #define zip_INPUT_BUFFER_SIZE 0x10000
 		// TODO: make this configurable a la sysctl?
 #define zip_SEEK_BUFFER_SIZE zip_INPUT_BUFFER_SIZE
+#define zip_CHECKPOINT_SPAN 0x100000
+		// Minimum distance in the uncompressed data between checkpoints
+		// for seeking in deflated files. Each takes 32 KB.
 
 
 void
@@ -203,6 +230,9 @@ zip_close(uio_Handle *handle) {
 	zip_handle = handle->native;
 	uio_GPFile_unref(zip_handle->file);
 	zip_unInitZipStream(&zip_handle->zipStream);
+#ifdef zip_USE_CHECKPOINTS
+	zip_freeCheckpoints(zip_handle);
+#endif
 	uio_closeFileBlock(zip_handle->fileBlock);
 	uio_free(zip_handle);
 }
@@ -387,6 +417,10 @@ zip_open(uio_PDirHandle *pDirHandle, const char *name, int flags,
 	}
 	handle->compressedOffset = 0;
 	handle->uncompressedOffset = 0;
+#ifdef zip_USE_CHECKPOINTS
+	handle->checkpoints = NULL;
+	handle->numCheckpoints = 0;
+#endif
 	
 	(void) mode;
 	return uio_Handle_new(pDirHandle->pRoot, handle, flags);
@@ -463,12 +497,24 @@ zip_readDeflated(uio_Handle *handle, void *buf, size_t count) {
 			zipHandle->zipStream.avail_in = numBytes;
 			zipHandle->compressedOffset += numBytes;
 		}
+#ifdef zip_USE_CHECKPOINTS
+		// Stop at block boundaries, as those are the only places
+		// where a checkpoint can be made.
+		inflateResult = inflate(&zipHandle->zipStream, Z_BLOCK);
+#else
 		inflateResult = inflate(&zipHandle->zipStream, Z_SYNC_FLUSH);
+#endif
 		zipHandle->uncompressedOffset = zipHandle->zipStream.total_out;
 		if (inflateResult == Z_STREAM_END) {
 			// Everything is decompressed
 			break;
 		}
+#ifdef zip_USE_CHECKPOINTS
+		if (inflateResult == Z_OK &&
+				(zipHandle->zipStream.data_type & 128) &&
+				!(zipHandle->zipStream.data_type & 64))
+			zip_addCheckpoint(zipHandle);
+#endif
 		if (inflateResult != Z_OK) {
 			switch (inflateResult) {
 				case Z_VERSION_ERROR:
@@ -574,6 +620,25 @@ zip_seekDeflated(uio_Handle *handle, off_t offset) {
 
 	zipHandle = handle->native;
 
+#ifdef zip_USE_CHECKPOINTS
+	{
+		const zip_Checkpoint *checkpoint =
+				zip_findCheckpoint(zipHandle, offset);
+		if (checkpoint != NULL && (offset < zipHandle->uncompressedOffset ||
+				checkpoint->uncompressedOffset >
+				zipHandle->uncompressedOffset)) {
+			// Resuming from the checkpoint saves inflating the part
+			// before it.
+			if (zip_resumeFromCheckpoint(zipHandle, checkpoint) == -1) {
+				// The stream has been reset; fall back to seeking from
+				// the beginning.
+				zipHandle->compressedOffset = 0;
+				zipHandle->uncompressedOffset = 0;
+			}
+		}
+	}
+#endif
+
 	if (offset < zipHandle->uncompressedOffset) {
 		// The new offset is earlier than the current offset. We need to
 		// seek from the beginning.
@@ -616,6 +681,105 @@ zip_seekDeflated(uio_Handle *handle, off_t offset) {
 	return zipHandle->uncompressedOffset;
 }
 
+#ifdef zip_USE_CHECKPOINTS
+// Called at a block boundary in the deflated stream.
+static void
+zip_addCheckpoint(zip_Handle *zipHandle) {
+	z_stream *zipStream = &zipHandle->zipStream;
+	off_t lastOffset;
+	zip_Checkpoint *checkpoint;
+	zip_Checkpoint **newCheckpoints;
+
+	lastOffset = zipHandle->numCheckpoints == 0 ? 0 :
+			zipHandle->checkpoints[zipHandle->numCheckpoints - 1]->
+			uncompressedOffset;
+	if ((off_t) zipStream->total_out < lastOffset + zip_CHECKPOINT_SPAN)
+		return;
+
+	checkpoint = uio_malloc(sizeof (zip_Checkpoint));
+	checkpoint->windowSize = sizeof checkpoint->window;
+	if (inflateGetDictionary(zipStream, checkpoint->window,
+			&checkpoint->windowSize) != Z_OK) {
+		uio_free(checkpoint);
+		return;
+	}
+	checkpoint->uncompressedOffset = zipStream->total_out;
+	checkpoint->compressedOffset =
+			zipHandle->compressedOffset - zipStream->avail_in;
+	checkpoint->bits = zipStream->data_type & 7;
+
+	newCheckpoints = uio_realloc(zipHandle->checkpoints,
+			(zipHandle->numCheckpoints + 1) * sizeof (zip_Checkpoint *));
+	if (newCheckpoints == NULL) {
+		uio_free(checkpoint);
+		return;
+	}
+	zipHandle->checkpoints = newCheckpoints;
+	zipHandle->checkpoints[zipHandle->numCheckpoints] = checkpoint;
+	zipHandle->numCheckpoints++;
+}
+
+// Returns the last checkpoint at or before 'offset', or NULL if there
+// is none.
+static const zip_Checkpoint *
+zip_findCheckpoint(const zip_Handle *zipHandle, off_t offset) {
+	int lo = 0;
+	int hi = zipHandle->numCheckpoints;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (zipHandle->checkpoints[mid]->uncompressedOffset <= offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo == 0 ? NULL : zipHandle->checkpoints[lo - 1];
+}
+
+static int
+zip_resumeFromCheckpoint(zip_Handle *zipHandle,
+		const zip_Checkpoint *checkpoint) {
+	z_stream *zipStream = &zipHandle->zipStream;
+
+	if (zip_reInitZipStream(zipStream) == -1) {
+		fprintf(stderr, "Fatal: Could not reinitialise zip stream: "
+				"%s.\n", strerror(errno));
+		abort();
+	}
+
+	if (checkpoint->bits != 0) {
+		unsigned char byte;
+		if (uio_copyFileBlock(zipHandle->fileBlock,
+				checkpoint->compressedOffset - 1, (char *) &byte, 1) != 1)
+			return -1;
+		inflatePrime(zipStream, checkpoint->bits,
+				byte >> (8 - checkpoint->bits));
+	}
+	if (inflateSetDictionary(zipStream, checkpoint->window,
+			checkpoint->windowSize) != Z_OK) {
+		zip_reInitZipStream(zipStream);
+		return -1;
+	}
+
+	// zip_readDeflated() keeps track of the position through total_out.
+	zipStream->total_out = checkpoint->uncompressedOffset;
+	zipHandle->compressedOffset = checkpoint->compressedOffset;
+	zipHandle->uncompressedOffset = checkpoint->uncompressedOffset;
+	return 0;
+}
+
+static void
+zip_freeCheckpoints(zip_Handle *zipHandle) {
+	int i;
+
+	for (i = 0; i < zipHandle->numCheckpoints; i++)
+		uio_free(zipHandle->checkpoints[i]);
+	uio_free(zipHandle->checkpoints);
+	zipHandle->checkpoints = NULL;
+	zipHandle->numCheckpoints = 0;
+}
+#endif  /* zip_USE_CHECKPOINTS */
+
 uio_PRoot *
 zip_mount(uio_Handle *handle, int flags) {
 	uio_PRoot *result;
@@ -669,6 +833,11 @@ zip_fillDirStructureCentral(uio_GPDir *top, uio_Handle *handle) {
 			//       to a smart size
 	off_t eocdr;
 	off_t startCentralDir;
+	zip_FileList fileList;
+
+	fileList.files = NULL;
+	fileList.numFiles = 0;
+	fileList.maxFiles = 0;
 
 	fileBlock = uio_openFileBlock(handle);
 	if (fileBlock == NULL) {
@@ -706,15 +875,24 @@ zip_fillDirStructureCentral(uio_GPDir *top, uio_Handle *handle) {
 	uio_setFileBlockUsageHint(fileBlock, uio_FB_USAGE_FORWARD,
 			DIR_STRUCTURE_READ_BUFSIZE);
 
+	fileList.maxFiles = numEntries;
+	fileList.files = uio_malloc(
+			(numEntries ? numEntries : 1) * sizeof *fileList.files);
+
 	pos = startCentralDir;
 	while (numEntries--) {
-		if (zip_fillDirStructureCentralProcessEntry(top, fileBlock, &pos)
-				== -1) {
+		if (zip_fillDirStructureCentralProcessEntry(top, fileBlock, &pos,
+				&fileList) == -1) {
 			// errno is set
 			goto err;
 		}
 	}
 
+	// Each file would otherwise need an extra seek and read for its
+	// local header when it is first accessed.
+	zip_readLocalHeaders(fileBlock, &fileList);
+
+	uio_free(fileList.files);
 	uio_closeFileBlock(fileBlock);
 	return 0;
 
@@ -722,6 +900,8 @@ err:
 	{
 		int savedErrno = errno;
 
+		if (fileList.files != NULL)
+			uio_free(fileList.files);
 		if (fileBlock != NULL)
 			uio_closeFileBlock(fileBlock);
 		errno = savedErrno;
@@ -729,9 +909,37 @@ err:
 	}
 }
 
+static int
+zip_compareHeaderOffsets(const void *a, const void *b) {
+	off_t offsetA = (*(zip_GPFileData * const *) a)->headerOffset;
+	off_t offsetB = (*(zip_GPFileData * const *) b)->headerOffset;
+
+	return (offsetA > offsetB) - (offsetA < offsetB);
+}
+
+// Reads the local headers of all the files in 'fileList' in the order
+// they are in the archive, so the reads go forward through it.
+// A file whose header cannot be read is left for when it is accessed,
+// which then reports the error as before.
+static void
+zip_readLocalHeaders(uio_FileBlock *fileBlock, zip_FileList *fileList) {
+	uio_uint32 i;
+
+	qsort(fileList->files, fileList->numFiles, sizeof *fileList->files,
+			zip_compareHeaderOffsets);
+
+	uio_setFileBlockUsageHint(fileBlock, uio_FB_USAGE_FORWARD,
+			LOCAL_HEADERS_READ_BUFSIZE);
+	for (i = 0; i < fileList->numFiles; i++) {
+		zip_GPFileData *gPFileData = fileList->files[i];
+		if (zip_readLocalHeader(gPFileData, fileBlock) == -1)
+			gPFileData->fileOffset = (off_t) -1;
+	}
+}
+
 static int
 zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
-		uio_FileBlock *fileBlock, off_t *pos) {
+		uio_FileBlock *fileBlock, off_t *pos, zip_FileList *fileList) {
 	char *buf;
 	zip_GPFileData *gPFileData;
 	ssize_t numBytes;
@@ -850,6 +1058,8 @@ zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
 			}
 			return zip_badFile(gPFileData, fileName);
 		}
+		if (fileList->numFiles < fileList->maxFiles)
+			fileList->files[fileList->numFiles++] = gPFileData;
 
 #if defined(DEBUG) && DEBUG > 1
 		fprintf(stderr, "Debug: Found file '%s'.\n", fileName);
@@ -1265,18 +1475,26 @@ zip_updateFileDataFromLocalHeader(uio_Handle *handle,
 		// errno is set
 		return -1;
 	}
-	if (zip_updatePFileDataFromLocalFileHeader(gPFileData,
-			fileBlock, gPFileData->headerOffset) == -1) {
+	if (zip_readLocalHeader(gPFileData, fileBlock) == -1) {
 		int savedErrno = errno;
 		uio_closeFileBlock(fileBlock);
 		errno = savedErrno;
 		return -1;
 	}
+	uio_closeFileBlock(fileBlock);
+	return 0;
+}
+
+// returns 0 for success, -1 for error (errno is set)
+static int
+zip_readLocalHeader(zip_GPFileData *gPFileData, uio_FileBlock *fileBlock) {
+	if (zip_updatePFileDataFromLocalFileHeader(gPFileData,
+			fileBlock, gPFileData->headerOffset) == -1)
+		return -1;
 	if (gPFileData->ctime == (time_t) 0)
 		gPFileData->ctime = gPFileData->mtime;
 	if (gPFileData->atime == (time_t) 0)
 		gPFileData->atime = gPFileData->mtime;
-	uio_closeFileBlock(fileBlock);
 	return 0;
 }
 #endif
@@ -77,6 +77,27 @@ typedef zip_GPFileData zip_GPDirData;
 // directories. A few bytes could be saved here by making a seperate
 // structure.
 
+#if ZLIB_VERNUM >= 0x1271
+		// inflateGetDictionary() is needed
+#	define zip_USE_CHECKPOINTS
+#endif
+
+#ifdef zip_USE_CHECKPOINTS
+// A point in a deflated file from which inflating can resume without
+// going back to the start of it.
+typedef struct zip_Checkpoint {
+	off_t uncompressedOffset;
+	off_t compressedOffset;
+			// of the first byte that is not fully consumed
+	int bits;
+			// number of bits of the byte before compressedOffset which
+			// are still to be used
+	uInt windowSize;
+	Bytef window[1 << MAX_WBITS];
+			// the last uncompressed bytes before this point
+} zip_Checkpoint;
+#endif
+
 typedef struct zip_Handle {
 	uio_GPFile *file;
 	z_stream zipStream;
@@ -86,6 +107,11 @@ typedef struct zip_Handle {
 	off_t compressedOffset;
 			// seek location in the compressed stream, from the start
 			// of the compressed file
+#ifdef zip_USE_CHECKPOINTS
+	zip_Checkpoint **checkpoints;
+			// ordered by offset, recorded while reading
+	int numCheckpoints;
+#endif
 } zip_Handle;
 
 
@@ -62,6 +62,15 @@ int UniChar_isPrint(UniChar ch);
 UniChar UniChar_toUpper(UniChar ch);
 UniChar UniChar_toLower(UniChar ch);
 
+// getCharFromString() with the ASCII case done inline, for the loops
+// that go through a string one character at a time.
+static inline UniChar
+getCharFromStringFast(const UNICODE_CHAR **ptr) {
+	if ((unsigned char) **ptr < 0x80)
+		return (unsigned char) *(*ptr)++;
+	return getCharFromString(ptr);
+}
+
 #undef UNICODE_CHAR
 
 #if defined(__cplusplus)
@@ -25,7 +25,13 @@
 #include <string.h>
 #include "libs/uio.h"
 #include "libs/memlib.h"
+#include "libs/platform.h"
 #include "endian_uqm.h"
+#ifdef SSE2_INTRIN
+#	include <emmintrin.h>
+#elif defined(NEON_INTRIN)
+#	include <arm_neon.h>
+#endif
 
 #define THIS_PTR    TFB_VideoDecoder* This
 
@@ -113,6 +119,7 @@ typedef struct tfb_duckvideodecoder
 #define DUCK_GENERAL_FPS     14.622f
 #define DUCK_MAX_FRAME_SIZE  0x8000U
 #define DUCK_END_OF_SEQUENCE 1
+#define DUCK_READAHEAD_SIZE  (8 * DUCK_MAX_FRAME_SIZE)
 
 static void
 dukv_DecodeFrame (uint8* src_p, uint32* dst_p, uint32 wb, uint32 hb,
@@ -284,8 +291,16 @@ dukv_OpenStream (TFB_DuckVideoDecoder* dukv)
 
 	strcat (strcpy (filename, dukv->basename), ".duk");
 
-	return (dukv->stream =
-			uio_fopen (dukv->basedir, filename, "rb")) != NULL;
+	dukv->stream = uio_fopen (dukv->basedir, filename, "rb");
+	if (!dukv->stream)
+		return false;
+
+#ifdef USE_RUST_UIO
+	// Frames are read one after the other, with the audio skipped
+	uio_setStreamUsageHint (dukv->stream, uio_STREAM_USAGE_SEQUENTIAL,
+			DUCK_READAHEAD_SIZE);
+#endif
+	return true;
 }
 
 static bool
@@ -458,6 +473,102 @@ dukv_PixelConv (uint16 pix, const TFB_PixelFormat* fmt)
 		((b >> fmt->Bloss) << fmt->Bshift);
 }
 
+#if defined(SSE2_INTRIN)
+// dukv_PixelConv() for 4 pixels; 'shifts' holds the loss and shift of
+// red, green and blue
+static inline __m128i
+dukv_PixelConv4 (__m128i pix, const __m128i* shifts)
+{
+	const __m128i mask = _mm_set1_epi32 (0xf8);
+	__m128i r, g, b;
+
+	r = _mm_and_si128 (_mm_srli_epi32 (pix, 7), mask);
+	g = _mm_and_si128 (_mm_srli_epi32 (pix, 2), mask);
+	b = _mm_and_si128 (_mm_slli_epi32 (pix, 3), mask);
+
+	return _mm_or_si128 (_mm_or_si128 (
+			_mm_sll_epi32 (_mm_srl_epi32 (r, shifts[0]), shifts[1]),
+			_mm_sll_epi32 (_mm_srl_epi32 (g, shifts[2]), shifts[3])),
+			_mm_sll_epi32 (_mm_srl_epi32 (b, shifts[4]), shifts[5]));
+}
+#elif defined(NEON_INTRIN)
+// dukv_PixelConv() for 4 pixels; 'shifts' holds the loss (negated) and
+// shift of red, green and blue
+static inline uint32x4_t
+dukv_PixelConv4 (uint32x4_t pix, const int32x4_t* shifts)
+{
+	const uint32x4_t mask = vdupq_n_u32 (0xf8);
+	uint32x4_t r, g, b;
+
+	r = vandq_u32 (vshrq_n_u32 (pix, 7), mask);
+	g = vandq_u32 (vshrq_n_u32 (pix, 2), mask);
+	b = vandq_u32 (vshlq_n_u32 (pix, 3), mask);
+
+	return vorrq_u32 (vorrq_u32 (
+			vshlq_u32 (vshlq_u32 (r, shifts[0]), shifts[1]),
+			vshlq_u32 (vshlq_u32 (g, shifts[2]), shifts[3])),
+			vshlq_u32 (vshlq_u32 (b, shifts[4]), shifts[5]));
+}
+#endif
+
+// Converts a line of pixel pairs to a 32-bit format; the high pixel of
+// each pair goes to 'dst0', the low one to 'dst1'
+static void
+dukv_RenderLine32 (uint32* dst0, uint32* dst1, const uint32* dec,
+		uint32 count, const TFB_PixelFormat* fmt)
+{
+	uint32 x = 0;
+
+#if defined(SSE2_INTRIN)
+	const __m128i lo16 = _mm_set1_epi32 (0xffff);
+	__m128i shifts[6];
+
+	shifts[0] = _mm_cvtsi32_si128 (fmt->Rloss);
+	shifts[1] = _mm_cvtsi32_si128 (fmt->Rshift);
+	shifts[2] = _mm_cvtsi32_si128 (fmt->Gloss);
+	shifts[3] = _mm_cvtsi32_si128 (fmt->Gshift);
+	shifts[4] = _mm_cvtsi32_si128 (fmt->Bloss);
+	shifts[5] = _mm_cvtsi32_si128 (fmt->Bshift);
+
+	for (; x + 4 <= count; x += 4)
+	{
+		__m128i pair = _mm_loadu_si128 ((const __m128i *) (dec + x));
+
+		_mm_storeu_si128 ((__m128i *) (dst0 + x),
+				dukv_PixelConv4 (_mm_srli_epi32 (pair, 16), shifts));
+		_mm_storeu_si128 ((__m128i *) (dst1 + x),
+				dukv_PixelConv4 (_mm_and_si128 (pair, lo16), shifts));
+	}
+#elif defined(NEON_INTRIN)
+	const uint32x4_t lo16 = vdupq_n_u32 (0xffff);
+	int32x4_t shifts[6];
+
+	shifts[0] = vdupq_n_s32 (-(int) fmt->Rloss);
+	shifts[1] = vdupq_n_s32 ((int) fmt->Rshift);
+	shifts[2] = vdupq_n_s32 (-(int) fmt->Gloss);
+	shifts[3] = vdupq_n_s32 ((int) fmt->Gshift);
+	shifts[4] = vdupq_n_s32 (-(int) fmt->Bloss);
+	shifts[5] = vdupq_n_s32 ((int) fmt->Bshift);
+
+	for (; x + 4 <= count; x += 4)
+	{
+		uint32x4_t pair = vld1q_u32 (dec + x);
+
+		vst1q_u32 (dst0 + x,
+				dukv_PixelConv4 (vshrq_n_u32 (pair, 16), shifts));
+		vst1q_u32 (dst1 + x,
+				dukv_PixelConv4 (vandq_u32 (pair, lo16), shifts));
+	}
+#endif
+
+	for (; x < count; ++x)
+	{
+		uint32 pair = dec[x];
+		dst0[x] = dukv_PixelConv ((uint16)(pair >> 16), fmt);
+		dst1[x] = dukv_PixelConv ((uint16)(pair & 0xffff), fmt);
+	}
+}
+
 static void
 dukv_RenderFrame (THIS_PTR)
 {
@@ -519,12 +630,8 @@ dukv_RenderFrame (THIS_PTR)
 			dst0 = (uint32*) This->callbacks.GetCanvasLine (This, y * 2);
 			dst1 = (uint32*) This->callbacks.GetCanvasLine (This, y * 2 + 1);
 
-			for (x = 0; x < dukv->decoder.w; ++x, ++dec, ++dst0, ++dst1)
-			{
-				uint32 pair = *dec;
-				*dst0 = dukv_PixelConv ((uint16)(pair >> 16), fmt);
-				*dst1 = dukv_PixelConv ((uint16)(pair & 0xffff), fmt);
-			}
+			dukv_RenderLine32 (dst0, dst1, dec, dukv->decoder.w, fmt);
+			dec += dukv->decoder.w;
 		}
 		break;
 	}
@@ -36,7 +36,6 @@ typedef struct tfb_videoclip
 	RECT src_rect;     // source rect
 	MUSIC_REF hAudio;
 	uint32 frame_time; // time when next frame should be rendered
-	TFB_Image* frame;  // frame preped and optimized for rendering
 	uint32 cur_frame;  // index of frame currently displayed
 	bool playing;
 	bool own_audio;
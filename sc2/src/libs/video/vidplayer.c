@@ -25,6 +25,7 @@
 #include "libs/log.h"
 #include "libs/memlib.h"
 #include "libs/sndlib.h"
+#include "libs/tasklib.h"
 
 // video callbacks
 static void vp_BeginFrame (TFB_VideoDecoder*);
@@ -58,18 +59,237 @@ static const TFB_SoundCallbacks vp_AudioCBs =
 	vp_QueueBuffer
 };
 
+// Frames are decoded ahead of when they are displayed by a decoder task,
+// into a ring of images, so that a slow read or decode does not hold up
+// the display. Only one clip plays at a time, so this is kept here and
+// not in the clip.
+#define VID_AHEAD_FRAMES 4
+		// Decoded frames kept ready ahead of the one displayed
+#define VID_NO_SEEK (0U-1)
+
+typedef struct
+{
+	TFB_Image *image;
+	uint32 index;  // index of the frame in the clip
+	float pos;     // position of the frame in seconds
+	uint32 wait;   // msecs to display it, for non-audio-synced video
+} AheadFrame;
+
+// All but the images are protected by aheadMutex. An image belongs to the
+// decoder task until its frame is counted in aheadCount, and to the player
+// from then on until it pops it.
+static Mutex aheadMutex;
+static Semaphore aheadWake;
+		// The decoder task waits on this when it has nothing to do
+static Task aheadTask;
+static VIDEO_REF aheadVid;
+		// The clip being decoded
+static AheadFrame aheadFrames[VID_AHEAD_FRAMES];
+static uint32 aheadFirst;
+		// Ring index of the next frame to display
+static uint32 aheadCount;
+		// Number of frames decoded and ready to display
+static uint32 aheadSeek;
+		// Frame to continue decoding from, or VID_NO_SEEK
+static uint32 aheadSeq;
+		// Bumped on every seek, to drop a frame decoded before it
+static bool aheadDone;
+		// The decoder reached the end of the clip, or failed
+static AheadFrame *aheadDecoding;
+		// The frame the decoder callbacks draw into
+static float shownPos;
+		// Position of the frame displayed, in seconds; protected by
+		// the guard of the clip
+
 
 bool
 TFB_InitVideoPlayer_Legacy (void)
 {
-	// now just a stub
+	aheadMutex = CreateMutex ("video decode-ahead mutex", SYNC_CLASS_VIDEO);
+	aheadWake = CreateSemaphore (0, "video decode-ahead wake",
+			SYNC_CLASS_VIDEO);
 	return true;
 }
 
 void
 TFB_UninitVideoPlayer_Legacy (void)
 {
-	// now just a stub
+	if (aheadWake)
+	{
+		DestroySemaphore (aheadWake);
+		aheadWake = NULL;
+	}
+	if (aheadMutex)
+	{
+		DestroyMutex (aheadMutex);
+		aheadMutex = NULL;
+	}
+}
+
+// Decodes the next frame of the clip into 'frame'. Called by the decoder
+// task, or before it is started.
+static int
+vp_DecodeAhead (VIDEO_REF vid, AheadFrame *frame)
+{
+	int ret;
+
+	aheadDecoding = frame;
+	ret = VideoDecoder_Decode (vid->decoder);
+	aheadDecoding = NULL;
+	if (ret <= 0)
+		return ret;
+
+	frame->index = vid->decoder->cur_frame;
+	frame->pos = vid->decoder->pos;
+	if (frame->index == vid->loop_frame)
+		VideoDecoder_SeekFrame (vid->decoder, vid->loop_to);
+	return ret;
+}
+
+static int
+vp_DecoderTaskFunc (void *data)
+{
+	Task task = (Task) data;
+	VIDEO_REF vid = aheadVid;
+
+	while (!Task_ReadState (task, TASK_EXIT))
+	{
+		AheadFrame *frame;
+		uint32 seq;
+		int ret;
+
+		LockMutex (aheadMutex);
+		if (aheadSeek != VID_NO_SEEK)
+		{
+			VideoDecoder_SeekFrame (vid->decoder, aheadSeek);
+			aheadSeek = VID_NO_SEEK;
+			aheadDone = false;
+		}
+		if (aheadDone || aheadCount == VID_AHEAD_FRAMES)
+		{	// Nothing to do until the player makes room or seeks
+			UnlockMutex (aheadMutex);
+			SetSemaphore (aheadWake);
+			continue;
+		}
+		// The player does not look at the frames past aheadCount
+		frame = &aheadFrames[(aheadFirst + aheadCount) % VID_AHEAD_FRAMES];
+		seq = aheadSeq;
+		UnlockMutex (aheadMutex);
+
+		ret = vp_DecodeAhead (vid, frame);
+
+		LockMutex (aheadMutex);
+		if (seq != aheadSeq)
+			; // The player seeked meanwhile; this frame is not wanted
+		else if (ret <= 0)
+			aheadDone = true;
+		else
+			aheadCount++;
+		UnlockMutex (aheadMutex);
+	}
+
+	FinishTask (task);
+	return 0;
+}
+
+// Returns the next frame to display, or NULL if it is not decoded yet.
+// 'ready' is set to the number of frames decoded.
+static AheadFrame *
+vp_PeekAhead (uint32 *ready)
+{
+	AheadFrame *frame = NULL;
+
+	LockMutex (aheadMutex);
+	*ready = aheadCount;
+	if (aheadCount > 0)
+		frame = &aheadFrames[aheadFirst];
+	UnlockMutex (aheadMutex);
+
+	return frame;
+}
+
+// Done with the frame vp_PeekAhead() returned; the decoder may reuse it
+static void
+vp_PopAhead (void)
+{
+	LockMutex (aheadMutex);
+	aheadFirst = (aheadFirst + 1) % VID_AHEAD_FRAMES;
+	aheadCount--;
+	UnlockMutex (aheadMutex);
+	ClearSemaphore (aheadWake);
+}
+
+// Drops the decoded frames and has the decoder continue from 'frame_pos'
+static void
+vp_SeekAhead (uint32 frame_pos)
+{
+	LockMutex (aheadMutex);
+	aheadCount = 0;
+	aheadSeek = frame_pos;
+	aheadSeq++;
+	UnlockMutex (aheadMutex);
+	ClearSemaphore (aheadWake);
+}
+
+static bool
+vp_AheadDone (void)
+{
+	bool done;
+
+	LockMutex (aheadMutex);
+	done = aheadDone;
+	UnlockMutex (aheadMutex);
+
+	return done;
+}
+
+static void
+vp_FreeAheadFrames (void)
+{
+	int i;
+
+	for (i = 0; i < VID_AHEAD_FRAMES; ++i)
+	{
+		if (aheadFrames[i].image)
+		{
+			TFB_DrawScreen_DeleteImage (aheadFrames[i].image);
+			aheadFrames[i].image = NULL;
+		}
+	}
+}
+
+static void
+vp_StopDecoder (void)
+{
+	if (aheadTask)
+	{
+		Task_SetState (aheadTask, TASK_EXIT);
+		ClearSemaphore (aheadWake);
+		ConcludeTask (aheadTask);
+		aheadTask = NULL;
+	}
+	vp_FreeAheadFrames ();
+	aheadVid = NULL;
+}
+
+static void
+vp_DrawFrame (VIDEO_REF vid, AheadFrame *frame)
+{
+	CONTEXT oldContext;
+
+	// We have the cliprect precalculated and don't need the rest
+	oldContext = SetContext (NULL);
+	TFB_DrawScreen_Image (frame->image,
+			vid->dst_rect.corner.x, vid->dst_rect.corner.y, 0, 0,
+			NULL, DRAW_REPLACE_MODE, TFB_SCREEN_MAIN);
+	SetContext (oldContext);
+	FlushGraphics (); // needed to prevent half-frame updates
+			// and so that the image is drawn before it is reused
+
+	vid->cur_frame = frame->index;
+	LockMutex (vid->guard);
+	shownPos = frame->pos;
+	UnlockMutex (vid->guard);
 }
 
 static inline sint32
@@ -86,11 +306,11 @@ processAudioSyncedFrame (VIDEO_REF vid)
 #define MAX_FRAME_LAG  8
 #define LAG_FRACTION   6
 #define SYNC_BIAS      1 / 3
-	int ret;
 	uint32 want_frame;
 	uint32 prev_want_frame;
 	sint32 wait_msec;
-	CONTEXT oldContext;
+	AheadFrame *frame;
+	uint32 ready;
 	TimeCount Now = GetTimeCounter ();
 
 	if (!vid->playing)
@@ -110,18 +330,20 @@ processAudioSyncedFrame (VIDEO_REF vid)
 	}
 
 	// this works like so (audio-synced):
-	//  1. you call VideoDecoder_Seek() [when necessary] and
-	//     VideoDecoder_Decode()
-	//  2. wait till it's time for this frame to be drawn
+	//  1. the decoder task keeps the next few frames decoded
+	//  2. wait till it's time for the next frame to be drawn
 	//     the timeout is necessary because the audio signaling is not
 	//     precise (see vp_AudioStart, vp_AudioEnd, vp_BufferTag)
-	//  3. output the frame; if the audio is behind, the lag counter
+	//  3. frames the audio has already passed are dropped, as long as
+	//     a later one is decoded
+	//  4. output the frame; if the audio is behind, the lag counter
 	//     goes up; if the video is behind, the lag counter goes down
-	//  4. set the next frame timeout; lag counter increases or
+	//  5. set the next frame timeout; lag counter increases or
 	//     decreases the timeout to allow audio or video to catch up
-	//  5. on a seek operation, the audio stream is moved to the
+	//  6. on a seek operation, the audio stream is moved to the
 	//     correct position and then the audio signals the frame
-	//     that should be rendered
+	//     that should be rendered; the decoder task is told to
+	//     continue from there
 	//  The system of timeouts and lag counts should make the video
 	//  *relatively* smooth
 	//
@@ -129,30 +351,33 @@ processAudioSyncedFrame (VIDEO_REF vid)
 	if (want_frame > prev_want_frame - MAX_FRAME_LAG
 			&& want_frame <= prev_want_frame + MAX_FRAME_LAG)
 	{
-		// we will draw the next frame right now, thus +1
-		vid->lag_cnt = vid->cur_frame + 1 - want_frame;
+		frame = vp_PeekAhead (&ready);
+		while (frame && ready > 1 && frame->index < want_frame)
+		{	// drop it
+			vp_PopAhead ();
+			frame = vp_PeekAhead (&ready);
+		}
 	}
 	else
 	{	// out of sequence frame, let's get it
+		// (unless it is decoded already, as at the start)
+		frame = vp_PeekAhead (&ready);
+		if (frame && frame->index != want_frame)
+			frame = NULL;
+		if (!frame)
+			vp_SeekAhead (want_frame);
+		vid->cur_frame = want_frame;
 		vid->lag_cnt = 0;
-		vid->cur_frame = VideoDecoder_SeekFrame (vid->decoder, want_frame);
-		ret = VideoDecoder_Decode (vid->decoder);
-		if (ret < 0)
-		{	// decoder returned a failure
-			vid->playing = false;
-			return false;
-		}
 	}
-	vid->cur_frame = vid->decoder->cur_frame;
+
+	if (!frame)
+		return true; // not decoded yet; try again on the next call
+
+	vid->lag_cnt = (int)frame->index - (int)want_frame;
 
 	// draw the frame
-	// We have the cliprect precalculated and don't need the rest
-	oldContext = SetContext (NULL);
-	TFB_DrawScreen_Image (vid->frame,
-			vid->dst_rect.corner.x, vid->dst_rect.corner.y, 0, 0,
-			NULL, DRAW_REPLACE_MODE, TFB_SCREEN_MAIN);
-	SetContext (oldContext);
-	FlushGraphics (); // needed to prevent half-frame updates
+	vp_DrawFrame (vid, frame);
+	vp_PopAhead ();
 
 	// increase interframe with positive lag-count to allow audio to catch up
 	// decrease interframe with negative lag-count to allow video to catch up
@@ -161,12 +386,6 @@ processAudioSyncedFrame (VIDEO_REF vid)
 			+ (int)vid->decoder->interframe_wait * vid->lag_cnt / LAG_FRACTION;
 	vid->frame_time = Now + msecToTimeCount (wait_msec);
 
-	ret = VideoDecoder_Decode (vid->decoder);
-	if (ret < 0)
-	{
-		// TODO: decide what to do on error
-	}
-
 	return vid->playing;
 }
 
@@ -175,41 +394,37 @@ processAudioSyncedFrame (VIDEO_REF vid)
 static bool
 processMuteFrame (VIDEO_REF vid)
 {
-	int ret;
 	TimeCount Now = GetTimeCounter ();
 
 	if (!vid->playing)
 		return false;
 
 	// this works like so:
-	//  1. you call VideoDecoder_Seek() [when necessary] and
-	//     VideoDecoder_Decode()
-	//  2. the decoder calls back vp_GetTicks() and vp_SetTimer()
-	//     to figure out and tell you when to render the frame
-	//     being decoded
-	//  On a seek operation, the decoder should reset its internal
-	//  clock and call vp_GetTicks() again
+	//  1. the decoder task keeps the next few frames decoded
+	//  2. the decoder calls back vp_SetTimer() to tell for how
+	//     long each frame should be displayed
+	//  3. the decoder task seeks back to vid->loop_to after it
+	//     decodes vid->loop_frame
 	//
 	if (Now >= vid->frame_time)
 	{
-		CONTEXT oldContext;
-		
-		vid->cur_frame = vid->decoder->cur_frame;
-
-		// We have the cliprect precalculated and don't need the rest
-		oldContext = SetContext (NULL);
-		TFB_DrawScreen_Image (vid->frame,
-				vid->dst_rect.corner.x, vid->dst_rect.corner.y, 0, 0,
-				NULL, DRAW_REPLACE_MODE, TFB_SCREEN_MAIN);
-		SetContext (oldContext);
-		FlushGraphics (); // needed to prevent half-frame updates
-
-		if (vid->cur_frame == vid->loop_frame)
-			VideoDecoder_SeekFrame (vid->decoder, vid->loop_to);
-
-		ret = VideoDecoder_Decode (vid->decoder);
-		if (ret <= 0)
-			vid->playing = false;
+		AheadFrame *frame;
+		uint32 ready;
+		bool done = vp_AheadDone ();
+				// Before the peek, as the decoder stops after a frame
+				// it may add meanwhile
+
+		frame = vp_PeekAhead (&ready);
+		if (!frame)
+		{
+			if (done)
+				vid->playing = false;
+			return vid->playing;
+		}
+
+		vp_DrawFrame (vid, frame);
+		vid->frame_time = Now + msecToTimeCount (frame->wait);
+		vp_PopAhead ();
 	}
 
 	return vid->playing;
@@ -225,6 +440,7 @@ TFB_PlayVideo_Legacy (VIDEO_REF vid, uint32 x, uint32 y)
 	RECT sr;
 	bool loop_music = false;
 	int ret;
+	int i;
 
 	if (!vid)
 		return false;
@@ -252,7 +468,21 @@ TFB_PlayVideo_Legacy (VIDEO_REF vid, uint32 x, uint32 y)
 	vid->decoder->callbacks = vp_DecoderCBs;
 	vid->decoder->data = vid;
 	
-	vid->frame = TFB_DrawImage_CreateForScreen (vid->w, vid->h, FALSE);
+	if (aheadVid)
+		vp_StopDecoder (); // only one clip plays at a time
+
+	for (i = 0; i < VID_AHEAD_FRAMES; ++i)
+	{
+		aheadFrames[i].image = TFB_DrawImage_CreateForScreen (
+				vid->w, vid->h, FALSE);
+		aheadFrames[i].wait = 0;
+	}
+	aheadVid = vid;
+	aheadFirst = 0;
+	aheadCount = 0;
+	aheadSeek = VID_NO_SEEK;
+	aheadDone = false;
+	shownPos = 0;
 	vid->cur_frame = -1;
 	vid->want_frame = -1;
 
@@ -268,6 +498,7 @@ TFB_PlayVideo_Legacy (VIDEO_REF vid, uint32 x, uint32 y)
 		{
 			log_add (log_Warning, "TFB_PlayVideo: "
 					"Cannot load sound-track for audio-synced video");
+			vp_StopDecoder ();
 			return false;
 		}
 
@@ -276,9 +507,26 @@ TFB_PlayVideo_Legacy (VIDEO_REF vid, uint32 x, uint32 y)
 	}
 
 	// get the first frame
-	ret = VideoDecoder_Decode (vid->decoder);
+	ret = vp_DecodeAhead (vid, &aheadFrames[0]);
 	if (ret < 0)
+	{
+		vp_StopDecoder ();
 		return false;
+	}
+	if (ret > 0)
+		aheadCount = 1;
+	else
+		aheadDone = true;
+
+	// and let the decoder task get the rest
+	aheadTask = AssignTask (vp_DecoderTaskFunc, 1024, "video decoder");
+	if (!aheadTask)
+	{
+		log_add (log_Warning, "TFB_PlayVideo: "
+				"Could not start the video decoder task");
+		vp_StopDecoder ();
+		return false;
+	}
 
 	vid->playing = true;
 	
@@ -313,11 +561,8 @@ TFB_StopVideo_Legacy (VIDEO_REF vid)
 			vid->own_audio = false;
 		}
 	}
-	if (vid->frame) 
-	{
-		TFB_DrawScreen_DeleteImage (vid->frame);
-		vid->frame = NULL;
-	}
+	if (aheadVid == vid)
+		vp_StopDecoder ();
 }
 
 bool
@@ -350,7 +595,7 @@ TFB_GetVideoPosition_Legacy (VIDEO_REF vid)
 		return 0;
 
 	LockMutex (vid->guard);
-	pos = (uint32) (vid->decoder->pos * 1000);
+	pos = (uint32) (shownPos * 1000);
 	UnlockMutex (vid->guard);
 
 	return pos;
@@ -380,30 +625,30 @@ TFB_SeekVideo_Legacy (VIDEO_REF vid, uint32 pos)
 static void
 vp_BeginFrame (TFB_VideoDecoder* decoder)
 {
-	TFB_VideoClip* vid = decoder->data;
+	if (aheadDecoding)
+		TFB_DrawCanvas_Lock (aheadDecoding->image->NormalImg);
 
-	if (vid)
-		TFB_DrawCanvas_Lock (vid->frame->NormalImg);
+	(void)decoder; // gobble up compiler warning
 }
 
 static void
 vp_EndFrame (TFB_VideoDecoder* decoder)
 {
-	TFB_VideoClip* vid = decoder->data;
+	if (aheadDecoding)
+		TFB_DrawCanvas_Unlock (aheadDecoding->image->NormalImg);
 
-	if (vid)
-		TFB_DrawCanvas_Unlock (vid->frame->NormalImg);
+	(void)decoder; // gobble up compiler warning
 }
 
 static void*
 vp_GetCanvasLine (TFB_VideoDecoder* decoder, uint32 line)
 {
-	TFB_VideoClip* vid = decoder->data;
-
-	if (!vid)
+	if (!aheadDecoding)
 		return NULL;
 	
-	return TFB_DrawCanvas_GetLine (vid->frame->NormalImg, line);
+	return TFB_DrawCanvas_GetLine (aheadDecoding->image->NormalImg, line);
+
+	(void)decoder; // gobble up compiler warning
 }
 
 static uint32
@@ -418,14 +663,14 @@ vp_GetTicks (TFB_VideoDecoder* decoder)
 static bool
 vp_SetTimer (TFB_VideoDecoder* decoder, uint32 msecs)
 {
-	TFB_VideoClip* vid = decoder->data;
-
-	if (!vid)
+	if (!aheadDecoding)
 		return false;
 
-	// time when next frame should be displayed
-	vid->frame_time = GetTimeCounter () + msecs * ONE_SECOND / 1000;
+	// how long the frame being decoded should be displayed
+	aheadDecoding->wait = msecs;
 	return true;
+
+	(void)decoder; // gobble up compiler warning
 }
 
 static bool
@@ -58,6 +58,11 @@ BOOLEAN optSpeech;
 BOOLEAN optSubtitles;
 BOOLEAN optStereoSFX;
 BOOLEAN optKeepAspectRatio;
+BOOLEAN optMeleePrescale;
+BOOLEAN optMeleeHeadless;
+BOOLEAN optMeleeRecord;
+BOOLEAN optPlanetFrameCache;
+BOOLEAN optTopoDiskCache;
 
 float optGamma;
 
@@ -83,6 +88,34 @@ static void mountAddonDir (uio_Repository *repository,
 
 static void mountDirZips (uio_DirHandle *dirHandle, const char *mountPoint,
 		int relativeFlags, uio_MountHandle *relativeHandle);
+static void mountZipList (uio_DirHandle *dirHandle, const char **names,
+		int numNames, const char *mountPoint, int relativeFlags,
+		uio_MountHandle *relativeHandle);
+static void mountAddonsDirZips (uio_DirHandle *addonsDir);
+static void deferAddonMount (const char *addon, uio_DirHandle *dir,
+		const char *archive, const char *mountPoint);
+		// takes over 'dir'
+static void mountDeferredAddon (const char *addon);
+static void freeDeferredMounts (void);
+
+// Addon archives are only mounted, and so only have their directories
+// read, once the addon they are for is used. Archives in 'addons/<name>'
+// are for addon <name>. Archives directly in 'addons' are mounted right
+// away, unless a manifest '<archive>.addons' next to it lists the addons
+// it provides, one name per line.
+typedef struct
+{
+	char *addon;
+	uio_DirHandle *dir;
+	char *archive;
+			// The archive in 'dir' to mount, or NULL for all of them
+	char *mountPoint;
+} DeferredMount;
+
+static DeferredMount *deferredMounts;
+static int numDeferredMounts;
+static uio_MountHandle *addonMountHandle;
+		// What the addon archives are mounted below
 
 
 // Looks for a file 'file' in all 'numLocs' locations from 'locs'.
@@ -399,7 +432,8 @@ mountAddonDir (uio_Repository *repository, uio_MountHandle *contentMountHandle,
 		return;
 	}
 
-	mountDirZips (addonsDir, "addons", uio_MOUNT_BELOW, mountHandle);
+	addonMountHandle = mountHandle;
+	mountAddonsDirZips (addonsDir);
 			
 	availableAddons = uio_getDirList (addonsDir, "", "", match_MATCH_PREFIX);
 	if (availableAddons != NULL)
@@ -446,8 +480,7 @@ mountAddonDir (uio_Repository *repository, uio_MountHandle *contentMountHandle,
 					 "not found; addon skipped.", addon);
 				continue;
 			}
-			mountDirZips (addonDir, mountname, uio_MOUNT_BELOW, mountHandle);
-			uio_closeDir (addonDir);
+			deferAddonMount (addon, addonDir, NULL, mountname);
 		}
 	}
 	else
@@ -463,30 +496,217 @@ static void
 mountDirZips (uio_DirHandle *dirHandle, const char *mountPoint,
 		int relativeFlags, uio_MountHandle *relativeHandle)
 {
-	static uio_AutoMount *autoMount[] = { NULL };
 	uio_DirList *dirList;
 
 	dirList = uio_getDirList (dirHandle, "", "\\.([zZ][iI][pP]|[uU][qQ][mM])$",
 			match_MATCH_REGEX);
 	if (dirList != NULL)
 	{
-		int i;
-		
-		for (i = 0; i < dirList->numNames; i++)
+		mountZipList (dirHandle, dirList->names, dirList->numNames,
+				mountPoint, relativeFlags, relativeHandle);
+	}
+	uio_DirList_free (dirList);
+}
+
+static void
+mountZipList (uio_DirHandle *dirHandle, const char **names, int numNames,
+		const char *mountPoint, int relativeFlags,
+		uio_MountHandle *relativeHandle)
+{
+	static uio_AutoMount *autoMount[] = { NULL };
+	int i;
+
+	if (numNames == 0)
+		return;
+
+#ifdef USE_RUST_UIO
+	// Read all the archives' directories at once; the mounting
+	// below then just has to put them in place.
+	uio_preindexArchives (dirHandle, names, numNames);
+#endif
+	for (i = 0; i < numNames; i++)
+	{
+		if (uio_mountDir (repository, mountPoint, uio_FSTYPE_ZIP,
+				dirHandle, names[i], "/", autoMount,
+				relativeFlags | uio_MOUNT_RDONLY,
+				relativeHandle) == NULL)
+		{
+			log_add (log_Warning, "Warning: Could not mount '%s': %s.",
+					names[i], strerror (errno));
+		}
+	}
+#ifdef USE_RUST_UIO
+	uio_forgetPreindexedArchives ();
+#endif
+}
+
+// Mounts the archives directly in 'addons', except those with a manifest,
+// which are deferred until one of the addons in it is used.
+static void
+mountAddonsDirZips (uio_DirHandle *addonsDir)
+{
+	uio_DirList *dirList;
+	const char **now;
+	int numNow;
+	int i;
+
+	dirList = uio_getDirList (addonsDir, "", "\\.([zZ][iI][pP]|[uU][qQ][mM])$",
+			match_MATCH_REGEX);
+	if (dirList == NULL)
+		return;
+
+	now = HMalloc ((dirList->numNames + 1) * sizeof *now);
+	numNow = 0;
+	for (i = 0; i < dirList->numNames; i++)
+	{
+		const char *archive = dirList->names[i];
+		char manifestName[PATH_MAX];
+		uio_Stream *manifest;
+		char line[128];
+		int numProvided = 0;
+
+		snprintf (manifestName, sizeof manifestName, "%s.addons", archive);
+		manifest = uio_fopen (addonsDir, manifestName, "r");
+		if (manifest != NULL)
 		{
-			if (uio_mountDir (repository, mountPoint, uio_FSTYPE_ZIP,
-					dirHandle, dirList->names[i], "/", autoMount,
-					relativeFlags | uio_MOUNT_RDONLY,
-					relativeHandle) == NULL)
+			while (uio_fgets (line, sizeof line, manifest))
 			{
-				log_add (log_Warning, "Warning: Could not mount '%s': %s.",
-						dirList->names[i], strerror (errno));
+				char *name = line;
+				char *end;
+
+				while (*name == ' ' || *name == '\t')
+					++name;
+				end = name + strlen (name);
+				while (end > name && (end[-1] == '\n' || end[-1] == '\r'
+						|| end[-1] == ' ' || end[-1] == '\t'))
+					--end;
+				*end = '\0';
+				if (*name == '\0' || *name == '#')
+					continue;
+
+				deferAddonMount (name, uio_openDirRelative (contentDir,
+						"addons", 0), archive, "addons");
+				++numProvided;
 			}
+			uio_fclose (manifest);
 		}
+
+		if (numProvided == 0)
+			now[numNow++] = archive;
+		else
+			log_add (log_Debug, "Mounting '%s' when it is first used.",
+					archive);
 	}
+
+	mountZipList (addonsDir, now, numNow, "addons", uio_MOUNT_BELOW,
+			addonMountHandle);
+	HFree ((void *) now);
 	uio_DirList_free (dirList);
 }
 
+static void
+deferAddonMount (const char *addon, uio_DirHandle *dir, const char *archive,
+		const char *mountPoint)
+{
+	DeferredMount *mount;
+
+	deferredMounts = HRealloc (deferredMounts,
+			(numDeferredMounts + 1) * sizeof *deferredMounts);
+	mount = &deferredMounts[numDeferredMounts++];
+	mount->addon = HMalloc (strlen (addon) + 1);
+	strcpy (mount->addon, addon);
+	mount->dir = dir;
+	mount->archive = NULL;
+	if (archive)
+	{
+		mount->archive = HMalloc (strlen (archive) + 1);
+		strcpy (mount->archive, archive);
+	}
+	mount->mountPoint = HMalloc (strlen (mountPoint) + 1);
+	strcpy (mount->mountPoint, mountPoint);
+}
+
+static void
+freeDeferredMount (DeferredMount *mount)
+{
+	HFree (mount->addon);
+	if (mount->dir)
+		uio_closeDir (mount->dir);
+	HFree (mount->archive);
+	HFree (mount->mountPoint);
+}
+
+// Whether 'a' and 'b' mount the same archives
+static BOOLEAN
+sameDeferredMount (const DeferredMount *a, const DeferredMount *b)
+{
+	if (strcmp (a->mountPoint, b->mountPoint) != 0)
+		return FALSE;
+	if (!a->archive || !b->archive)
+		return !a->archive && !b->archive;
+	return strcmp (a->archive, b->archive) == 0;
+}
+
+// Mounts the archives deferred for 'addon', and drops them, and any other
+// addons' entries for the same archives, from the deferred list.
+static void
+mountDeferredAddon (const char *addon)
+{
+	int i;
+
+	for (i = 0; i < numDeferredMounts; )
+	{
+		DeferredMount mount = deferredMounts[i];
+		int j, k;
+
+		if (strcmp (mount.addon, addon) != 0)
+		{
+			++i;
+			continue;
+		}
+
+		log_add (log_Debug, "Mounting the archives of addon '%s'", addon);
+		if (mount.dir && mount.archive)
+		{
+			const char *names[1];
+			names[0] = mount.archive;
+			mountZipList (mount.dir, names, 1, mount.mountPoint,
+					uio_MOUNT_BELOW, addonMountHandle);
+		}
+		else if (mount.dir)
+		{
+			mountDirZips (mount.dir, mount.mountPoint, uio_MOUNT_BELOW,
+					addonMountHandle);
+		}
+
+		// Drop every entry for what was just mounted, this one last
+		for (j = 0, k = 0; j < numDeferredMounts; j++)
+		{
+			if (j == i)
+				continue;
+			if (sameDeferredMount (&deferredMounts[j], &mount))
+				freeDeferredMount (&deferredMounts[j]);
+			else
+				deferredMounts[k++] = deferredMounts[j];
+		}
+		numDeferredMounts = k;
+		freeDeferredMount (&mount);
+		i = 0;
+	}
+}
+
+static void
+freeDeferredMounts (void)
+{
+	int i;
+
+	for (i = 0; i < numDeferredMounts; i++)
+		freeDeferredMount (&deferredMounts[i]);
+	HFree (deferredMounts);
+	deferredMounts = NULL;
+	numDeferredMounts = 0;
+}
+
 int
 loadIndices (uio_DirHandle *dir)
 {
@@ -529,6 +749,7 @@ loadAddon (const char *addon)
 				"options are ignored.");
 		return FALSE;
 	}
+	mountDeferredAddon (addon);
 	addonDir = uio_openDirRelative (addonsDir, addon, 0);
 	if (addonDir == NULL)
 	{
@@ -568,6 +789,7 @@ prepareShadowAddons (const char **addons)
 		uio_DirHandle *addonDir;
 		uio_DirHandle *shadowDir;
 
+		mountDeferredAddon (addon);
 		addonDir = uio_openDirRelative (addonsDir, addon, 0);
 		if (addonDir == NULL)
 			continue;
@@ -613,6 +835,7 @@ prepareAddons (const char **addons)
 void
 unprepareAllDirs (void)
 {
+	freeDeferredMounts ();
 	if (saveDir)
 	{
 		uio_closeDir (saveDir);
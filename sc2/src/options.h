@@ -48,6 +48,11 @@ extern BOOLEAN optSpeech;
 extern BOOLEAN optSubtitles;
 extern BOOLEAN optStereoSFX;
 extern BOOLEAN optKeepAspectRatio;
+extern BOOLEAN optMeleePrescale;
+extern BOOLEAN optMeleeHeadless;
+extern BOOLEAN optMeleeRecord;
+extern BOOLEAN optPlanetFrameCache;
+extern BOOLEAN optTopoDiskCache;
 
 #define GAMMA_SCALE  1000
 extern float optGamma;
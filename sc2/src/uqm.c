@@ -30,10 +30,14 @@
 #include <errno.h>
 #include "libs/graphics/gfx_common.h"
 #include "libs/graphics/cmap.h"
+#include "libs/graphics/rotcache.h"
+#include "libs/sound/pcmcache.h"
 #include "libs/sound/sound.h"
 #include "libs/input/input_common.h"
 #include "libs/inplib.h"
 #include "libs/tasklib.h"
+#include "libs/threads/workpool.h"
+#include "libs/time/bootprof.h"
 #include "uqm/controls.h"
 #include "uqm/battle.h"
 		// For BATTLE_FRAME_RATE
@@ -115,6 +119,21 @@ struct options_struct
 	DECL_CONFIG_OPTION(int, scaler);
 	DECL_CONFIG_OPTION(bool, showFps);
 	DECL_CONFIG_OPTION(bool, keepAspectRatio);
+	DECL_CONFIG_OPTION(bool, scaleThreads);
+	DECL_CONFIG_OPTION(bool, glShaders);
+	DECL_CONFIG_OPTION(bool, vsync);
+	DECL_CONFIG_OPTION(bool, adaptiveScaler);
+	DECL_CONFIG_OPTION(int, rotCacheSize);
+	DECL_CONFIG_OPTION(int, scaleCacheSize);
+	DECL_CONFIG_OPTION(bool, atlasDrawables);
+	DECL_CONFIG_OPTION(bool, scaleDiskCache);
+	DECL_CONFIG_OPTION(int, pcmCacheSize);
+	DECL_CONFIG_OPTION(bool, meleePrescale);
+	DECL_CONFIG_OPTION(bool, meleeHeadless);
+	DECL_CONFIG_OPTION(bool, meleeRecord);
+	DECL_CONFIG_OPTION(bool, planetFrameCache);
+	DECL_CONFIG_OPTION(bool, topoDiskCache);
+	DECL_CONFIG_OPTION(bool, lowLatencyAudio);
 	DECL_CONFIG_OPTION(float, gamma);
 	DECL_CONFIG_OPTION(int, soundDriver);
 	DECL_CONFIG_OPTION(int, soundQuality);
@@ -197,6 +216,9 @@ static const struct option_list_value accelList[] =
 	{"mmx",    PLATFORM_MMX},
 	{"sse",    PLATFORM_SSE},
 	{"3dnow",  PLATFORM_3DNOW},
+	{"sse2",   PLATFORM_SSE2},
+	{"avx2",   PLATFORM_AVX2},
+	{"neon",   PLATFORM_NEON},
 	{"none",   PLATFORM_C},
 	{"detect", PLATFORM_NULL},
 	{NULL, 0}
@@ -274,6 +296,21 @@ uqm_c_do_init (int argc, char *argv[])
 		INIT_CONFIG_OPTION(  scaler,            TFB_GFXFLAGS_SCALE_XBRZ3 ),
 		INIT_CONFIG_OPTION(  showFps,           false ),
 		INIT_CONFIG_OPTION(  keepAspectRatio,   true ),
+		INIT_CONFIG_OPTION(  scaleThreads,      false ),
+		INIT_CONFIG_OPTION(  glShaders,         false ),
+		INIT_CONFIG_OPTION(  vsync,             false ),
+		INIT_CONFIG_OPTION(  adaptiveScaler,    false ),
+		INIT_CONFIG_OPTION(  rotCacheSize,      4096 ),
+		INIT_CONFIG_OPTION(  scaleCacheSize,    8192 ),
+		INIT_CONFIG_OPTION(  atlasDrawables,    false ),
+		INIT_CONFIG_OPTION(  scaleDiskCache,    false ),
+		INIT_CONFIG_OPTION(  pcmCacheSize,      8192 ),
+		INIT_CONFIG_OPTION(  meleePrescale,     false ),
+		INIT_CONFIG_OPTION(  meleeHeadless,     false ),
+		INIT_CONFIG_OPTION(  meleeRecord,       false ),
+		INIT_CONFIG_OPTION(  planetFrameCache,  false ),
+		INIT_CONFIG_OPTION(  topoDiskCache,     false ),
+		INIT_CONFIG_OPTION(  lowLatencyAudio,   false ),
 		INIT_CONFIG_OPTION(  gamma,             1.0f ),
 		INIT_CONFIG_OPTION(  soundDriver,       audio_DRIVER_MIXSDL ),
 		INIT_CONFIG_OPTION(  soundQuality,      audio_QUALITY_HIGH ),
@@ -561,6 +598,9 @@ uqm_c_do_init (int argc, char *argv[])
 
 	snddriver = options.soundDriver.value;
 	soundflags = options.soundQuality.value;
+	if (options.lowLatencyAudio.value)
+		soundflags |= audio_LOW_LATENCY;
+	PCMCache_SetLimit ((size_t) options.pcmCacheSize.value * 1024);
 
 	opt3doMusic = options.use3doMusic.value;
 	optRemixMusic = options.useRemixMusic.value;
@@ -572,6 +612,11 @@ uqm_c_do_init (int argc, char *argv[])
 	optWhichShield = options.whichShield.value;
 	optSmoothScroll = options.smoothScroll.value;
 	optMeleeScale = options.meleeScale.value;
+	optMeleePrescale = options.meleePrescale.value;
+	optMeleeHeadless = options.meleeHeadless.value;
+	optMeleeRecord = options.meleeRecord.value;
+	optPlanetFrameCache = options.planetFrameCache.value;
+	optTopoDiskCache = options.topoDiskCache.value;
 	optKeepAspectRatio = options.keepAspectRatio.value;
 	optSubtitles = options.subtitles.value;
 	optStereoSFX = options.stereoSFX.value;
@@ -601,6 +646,7 @@ uqm_c_do_init (int argc, char *argv[])
 
 	InitTimeSystem ();
 	InitTaskSystem ();
+	WorkPool_init (TFB_GetCPUCount () - 1);
 
 	/* Alarm/Callback init kept in C: game loop calls Callback_process,
 	 * Alarm_processOne etc. which depend on C-side globals. */
@@ -621,10 +667,22 @@ uqm_c_do_init (int argc, char *argv[])
 		gfxFlags |= TFB_GFXFLAGS_SCANLINES;
 	if (options.showFps.value)
 		gfxFlags |= TFB_GFXFLAGS_SHOWFPS;
+	if (options.scaleThreads.value)
+		gfxFlags |= TFB_GFXFLAGS_SCALE_THREADED;
+	if (options.glShaders.value)
+		gfxFlags |= TFB_GFXFLAGS_GL_SHADERS;
+	if (options.vsync.value)
+		gfxFlags |= TFB_GFXFLAGS_VSYNC;
+	if (options.adaptiveScaler.value)
+		gfxFlags |= TFB_GFXFLAGS_SCALE_ADAPTIVE;
 	/* Graphics/ColorMaps/Comm/Input init kept in C: many C files call
 	 * FadeScreen, SetColorMap, etc. which depend on C-side globals. */
 	TFB_InitGraphics (gfxDriver, gfxFlags, options.graphicsBackend,
 			options.resolution.width, options.resolution.height);
+	TFB_SetRotationCacheLimit ((size_t) options.rotCacheSize.value * 1024);
+	TFB_SetScaleCacheLimit ((size_t) options.scaleCacheSize.value * 1024);
+	TFB_SetDrawableAtlas (options.atlasDrawables.value);
+	TFB_SetScaleDiskCache (options.scaleDiskCache.value);
 	if (options.gamma.set && setGammaCorrection (options.gamma.value))
 		optGamma = options.gamma.value;
 	else
@@ -664,6 +722,21 @@ main (int argc, char *argv[])
 		INIT_CONFIG_OPTION(  scaler,            TFB_GFXFLAGS_SCALE_XBRZ3 ),  // xBRZ3 scaler for crisp graphics
 		INIT_CONFIG_OPTION(  showFps,           false ),
 		INIT_CONFIG_OPTION(  keepAspectRatio,   true ),       // Preserve aspect ratio
+		INIT_CONFIG_OPTION(  scaleThreads,      false ),
+		INIT_CONFIG_OPTION(  glShaders,         false ),
+		INIT_CONFIG_OPTION(  vsync,             false ),
+		INIT_CONFIG_OPTION(  adaptiveScaler,    false ),
+		INIT_CONFIG_OPTION(  rotCacheSize,      4096 ),
+		INIT_CONFIG_OPTION(  scaleCacheSize,    8192 ),
+		INIT_CONFIG_OPTION(  atlasDrawables,    false ),
+		INIT_CONFIG_OPTION(  scaleDiskCache,    false ),
+		INIT_CONFIG_OPTION(  pcmCacheSize,      8192 ),
+		INIT_CONFIG_OPTION(  meleePrescale,     false ),
+		INIT_CONFIG_OPTION(  meleeHeadless,     false ),
+		INIT_CONFIG_OPTION(  meleeRecord,       false ),
+		INIT_CONFIG_OPTION(  planetFrameCache,  false ),
+		INIT_CONFIG_OPTION(  topoDiskCache,     false ),
+		INIT_CONFIG_OPTION(  lowLatencyAudio,   false ),
 		INIT_CONFIG_OPTION(  gamma,             1.0f ),
 		INIT_CONFIG_OPTION(  soundDriver,       audio_DRIVER_MIXSDL ),
 		INIT_CONFIG_OPTION(  soundQuality,      audio_QUALITY_HIGH ),  // High quality audio
@@ -763,6 +836,7 @@ main (int argc, char *argv[])
 	InitThreadSystem ();
 	log_initThreads ();
 	initIO ();
+	BOOT_BEGIN (BOOT_CONFIG);
 	prepareConfigDir (options.configDir);
 
 	PlayerControls[0] = CONTROL_TEMPLATE_KB_1;
@@ -790,6 +864,7 @@ main (int argc, char *argv[])
 			res_Remove (cfgkey);
 		}
 	}
+	BOOT_END (BOOT_CONFIG);
 
 	/* TODO: Once threading is gone, these become local variables
 	   again.  In the meantime, they must be global so that
@@ -798,6 +873,9 @@ main (int argc, char *argv[])
 	   thread doesn't work */
 	snddriver = options.soundDriver.value;
 	soundflags = options.soundQuality.value;
+	if (options.lowLatencyAudio.value)
+		soundflags |= audio_LOW_LATENCY;
+	PCMCache_SetLimit ((size_t) options.pcmCacheSize.value * 1024);
 
 	// Fill in global variables:
 	opt3doMusic = options.use3doMusic.value;
@@ -810,6 +888,11 @@ main (int argc, char *argv[])
 	optWhichShield = options.whichShield.value;
 	optSmoothScroll = options.smoothScroll.value;
 	optMeleeScale = options.meleeScale.value;
+	optMeleePrescale = options.meleePrescale.value;
+	optMeleeHeadless = options.meleeHeadless.value;
+	optMeleeRecord = options.meleeRecord.value;
+	optPlanetFrameCache = options.planetFrameCache.value;
+	optTopoDiskCache = options.topoDiskCache.value;
 	optKeepAspectRatio = options.keepAspectRatio.value;
 	optSubtitles = options.subtitles.value;
 	optStereoSFX = options.stereoSFX.value;
@@ -818,16 +901,20 @@ main (int argc, char *argv[])
 	speechVolumeScale = options.speechVolumeScale.value;
 	optAddons = options.addons;
 
+	BOOT_BEGIN (BOOT_CONTENT);
 	prepareContentDir (options.contentDir, options.addonDir, argv[0]);
 	prepareMeleeDir ();
 	prepareSaveDir ();
 	prepareShadowAddons (options.addons);
+	BOOT_END (BOOT_CONTENT);
 #if 0
 	initTempDir ();
 #endif
 
+	BOOT_BEGIN (BOOT_SYSTEMS);
 	InitTimeSystem ();
 	InitTaskSystem ();
+	WorkPool_init (TFB_GetCPUCount () - 1);
 
 	Alarm_init ();
 	Callback_init ();
@@ -836,6 +923,7 @@ main (int argc, char *argv[])
 	Network_init ();
 	NetManager_init ();
 #endif
+	BOOT_END (BOOT_SYSTEMS);
 
 	gfxDriver = options.opengl.value ?
 			TFB_GFXDRIVER_SDL_OPENGL : TFB_GFXDRIVER_SDL_PURE;
@@ -846,14 +934,28 @@ main (int argc, char *argv[])
 		gfxFlags |= TFB_GFXFLAGS_SCANLINES;
 	if (options.showFps.value)
 		gfxFlags |= TFB_GFXFLAGS_SHOWFPS;
+	if (options.scaleThreads.value)
+		gfxFlags |= TFB_GFXFLAGS_SCALE_THREADED;
+	if (options.glShaders.value)
+		gfxFlags |= TFB_GFXFLAGS_GL_SHADERS;
+	if (options.vsync.value)
+		gfxFlags |= TFB_GFXFLAGS_VSYNC;
+	if (options.adaptiveScaler.value)
+		gfxFlags |= TFB_GFXFLAGS_SCALE_ADAPTIVE;
+	BOOT_BEGIN (BOOT_GRAPHICS);
 	TFB_InitGraphics (gfxDriver, gfxFlags, options.graphicsBackend,
 			options.resolution.width, options.resolution.height);
+	TFB_SetRotationCacheLimit ((size_t) options.rotCacheSize.value * 1024);
+	TFB_SetScaleCacheLimit ((size_t) options.scaleCacheSize.value * 1024);
+	TFB_SetDrawableAtlas (options.atlasDrawables.value);
+	TFB_SetScaleDiskCache (options.scaleDiskCache.value);
 	if (options.gamma.set && setGammaCorrection (options.gamma.value))
 		optGamma = options.gamma.value;
 	else
 		optGamma = 1.0f; // failed or default
 	
 	InitColorMaps ();
+	BOOT_END (BOOT_GRAPHICS);
 	init_communication ();
 	/* TODO: Once threading is gone, restore initAudio here.
 	   initAudio calls AssignTask, which currently blocks on
@@ -864,8 +966,12 @@ main (int argc, char *argv[])
 			sizeof (int [NUM_TEMPLATES][NUM_KEYS]));
 	TFB_SetInputVectors (ImmediateInputState.menu, NUM_MENU_KEYS,
 			(volatile int *)ImmediateInputState.key, NUM_TEMPLATES, NUM_KEYS);
+	BOOT_BEGIN (BOOT_INPUT);
 	TFB_InitInput (TFB_INPUTDRIVER_SDL, 0);
+	BOOT_END (BOOT_INPUT);
 
+	// The main loop sleeps while there is nothing to draw
+	SetThreadLifecycleWakeup (TFB_WakeEventWait);
 	StartThread (Starcon2Main, NULL, 1024, "Starcon2Main");
 
 	for (i = 0; i < 2000 && !MainExited; )
@@ -899,6 +1005,7 @@ main (int argc, char *argv[])
 		// Purge above refers to colormaps which have to be still up
 		UninitColorMaps ();
 		TFB_UninitGraphics ();
+		WorkPool_uninit ();
 
 #ifdef NETPLAY
 		NetManager_uninit ();
@@ -916,6 +1023,10 @@ main (int argc, char *argv[])
 		unprepareAllDirs ();
 		uninitIO ();
 		UnInitThreadSystem ();
+#ifdef TRACK_MEMORY
+		MemTrack_report ();
+				// What is still live by now was never freed
+#endif
 		mem_uninit ();
 	}
 
@@ -1066,6 +1177,40 @@ getUserConfigOptions (struct options_struct *options)
 	getBoolConfigValue (&options->scanlines, "config.scanlines");
 	getBoolConfigValue (&options->showFps, "config.showfps");
 	getBoolConfigValue (&options->keepAspectRatio, "config.keepaspectratio");
+	getBoolConfigValue (&options->scaleThreads, "config.scalethreads");
+	getBoolConfigValue (&options->glShaders, "config.glshaders");
+	getBoolConfigValue (&options->vsync, "config.vsync");
+	getBoolConfigValue (&options->adaptiveScaler, "config.adaptivescaler");
+	if (res_IsInteger ("config.rotcachesize") && !options->rotCacheSize.set
+			&& res_GetInteger ("config.rotcachesize") >= 0)
+	{	// In KiB; 0 disables the cache
+		options->rotCacheSize.value = res_GetInteger ("config.rotcachesize");
+		options->rotCacheSize.set = true;
+	}
+	if (res_IsInteger ("config.scalecachesize")
+			&& !options->scaleCacheSize.set
+			&& res_GetInteger ("config.scalecachesize") >= 0)
+	{	// In KiB; 0 keeps only the current scaled image
+		options->scaleCacheSize.value =
+				res_GetInteger ("config.scalecachesize");
+		options->scaleCacheSize.set = true;
+	}
+	getBoolConfigValue (&options->atlasDrawables, "config.atlasdrawables");
+	getBoolConfigValue (&options->scaleDiskCache, "config.scalediskcache");
+	if (res_IsInteger ("config.pcmcachesize") && !options->pcmCacheSize.set
+			&& res_GetInteger ("config.pcmcachesize") >= 0)
+	{	// In KiB; 0 decodes every sound bank when it is loaded
+		options->pcmCacheSize.value = res_GetInteger ("config.pcmcachesize");
+		options->pcmCacheSize.set = true;
+	}
+	getBoolConfigValue (&options->meleePrescale, "config.meleeprescale");
+	getBoolConfigValue (&options->meleeHeadless, "config.meleeheadless");
+	getBoolConfigValue (&options->meleeRecord, "config.meleerecord");
+	getBoolConfigValue (&options->planetFrameCache,
+			"config.planetframecache");
+	getBoolConfigValue (&options->topoDiskCache, "config.topodiskcache");
+	getBoolConfigValue (&options->lowLatencyAudio,
+			"config.lowlatencyaudio");
 	getGammaConfigValue (&options->gamma, "config.gamma");
 
 	getBoolConfigValue (&options->subtitles, "config.subtitles");
@@ -1138,6 +1283,15 @@ enum
 	ACCEL_OPT,
 	SAFEMODE_OPT,
 	RENDERER_OPT,
+	SCALETHREADS_OPT,
+	GLSHADERS_OPT,
+	VSYNC_OPT,
+	ADAPTIVESCALER_OPT,
+	BOOTPROFILE_OPT,
+	ATLASDRAWABLES_OPT,
+	SCALEDISKCACHE_OPT,
+	PLANETFRAMECACHE_OPT,
+	TOPODISKCACHE_OPT,
 #ifdef NETPLAY
 	NETHOST1_OPT,
 	NETPORT1_OPT,
@@ -1186,6 +1340,15 @@ static struct option longOptions[] =
 	{"accel", 1, NULL, ACCEL_OPT},
 	{"safe", 0, NULL, SAFEMODE_OPT},
 	{"renderer", 1, NULL, RENDERER_OPT},
+	{"scalethreads", 0, NULL, SCALETHREADS_OPT},
+	{"glshaders", 0, NULL, GLSHADERS_OPT},
+	{"vsync", 0, NULL, VSYNC_OPT},
+	{"adaptivescaler", 0, NULL, ADAPTIVESCALER_OPT},
+	{"bootprofile", 0, NULL, BOOTPROFILE_OPT},
+	{"atlasdrawables", 0, NULL, ATLASDRAWABLES_OPT},
+	{"scalediskcache", 0, NULL, SCALEDISKCACHE_OPT},
+	{"planetframecache", 0, NULL, PLANETFRAMECACHE_OPT},
+	{"topodiskcache", 0, NULL, TOPODISKCACHE_OPT},
 #ifdef NETPLAY
 	{"nethost1", 1, NULL, NETHOST1_OPT},
 	{"netport1", 1, NULL, NETPORT1_OPT},
@@ -1453,6 +1616,33 @@ parseOptions (int argc, char *argv[], struct options_struct *options)
 			case STEREOSFX_OPT:
 				setBoolOption (&options->stereoSFX, true);
 				break;
+			case SCALETHREADS_OPT:
+				setBoolOption (&options->scaleThreads, true);
+				break;
+			case GLSHADERS_OPT:
+				setBoolOption (&options->glShaders, true);
+				break;
+			case VSYNC_OPT:
+				setBoolOption (&options->vsync, true);
+				break;
+			case ADAPTIVESCALER_OPT:
+				setBoolOption (&options->adaptiveScaler, true);
+				break;
+			case BOOTPROFILE_OPT:
+				BootProfile_enable ();
+				break;
+			case ATLASDRAWABLES_OPT:
+				setBoolOption (&options->atlasDrawables, true);
+				break;
+			case SCALEDISKCACHE_OPT:
+				setBoolOption (&options->scaleDiskCache, true);
+				break;
+			case PLANETFRAMECACHE_OPT:
+				setBoolOption (&options->planetFrameCache, true);
+				break;
+			case TOPODISKCACHE_OPT:
+				setBoolOption (&options->topoDiskCache, true);
+				break;
 			case ADDON_OPT:
 				options->numAddons++;
 				options->addons = HRealloc ((void *) options->addons,
@@ -1619,6 +1809,29 @@ usage (FILE *out, const struct options_struct *defaults)
 			boolOptString (&defaults->keepAspectRatio));
 	log_add (log_User, "  -c, --scale=MODE (hq, xbrz3, xbrz4, or none) (default %s)",
 			scalerOptString (&defaults->scaler));
+	log_add (log_User, "  --scalethreads (run the scaler on several "
+			"threads; default %s)", boolOptString (&defaults->scaleThreads));
+	log_add (log_User, "  --glshaders (scale on the GPU with OpenGL; "
+			"default %s)", boolOptString (&defaults->glShaders));
+	log_add (log_User, "  --vsync (show frames in step with the display "
+			"refresh; default %s)", boolOptString (&defaults->vsync));
+	log_add (log_User, "  --adaptivescaler (use a cheaper scaler while the "
+			"chosen one is too slow; default %s)",
+			boolOptString (&defaults->adaptiveScaler));
+	log_add (log_User, "  --bootprofile (log how long each part of "
+			"starting up took)");
+	log_add (log_User, "  --atlasdrawables (pack the frames of each "
+			"drawable into one image; default %s)",
+			boolOptString (&defaults->atlasDrawables));
+	log_add (log_User, "  --scalediskcache (keep smoothly scaled images "
+			"on disk for next time; default %s)",
+			boolOptString (&defaults->scaleDiskCache));
+	log_add (log_User, "  --planetframecache (keep the frames of a "
+			"rotating planet once rendered; default %s)",
+			boolOptString (&defaults->planetFrameCache));
+	log_add (log_User, "  --topodiskcache (keep generated planet "
+			"surfaces on disk for next time; default %s)",
+			boolOptString (&defaults->topoDiskCache));
 	log_add (log_User, "  -b, --meleezoom=MODE (step, aka pc, or smooth, "
 			"aka 3do; default is 3do)");
 	log_add (log_User, "  -s, --scanlines (default %s)",
@@ -23,6 +23,7 @@
 #include "init.h"
 #include "element.h"
 #include "ship.h"
+#include "shipprof.h"
 #include "process.h"
 #include "tactrans.h"
 		// for flee_preprocess()
@@ -35,6 +36,7 @@
 #	include "supermelee/netplay/notifyall.h"
 #endif
 #include "supermelee/pickmele.h"
+#include "supermelee/replay.h"
 #include "resinst.h"
 #include "nameref.h"
 #include "setup.h"
@@ -42,6 +44,7 @@
 #include "sounds.h"
 #include "libs/async.h"
 #include "libs/graphics/gfx_common.h"
+#include "libs/time/profile.h"
 #include "libs/log.h"
 #include "libs/mathlib.h"
 
@@ -50,6 +53,14 @@ BYTE battle_counter[NUM_SIDES];
 		// The number of ships still available for battle to each side.
 		// A ship that has warped out is no longer available.
 BOOLEAN instantVictory;
+BOOLEAN headlessBattle;
+		// Set for SuperMelee battles between two computer players when
+		// optMeleeHeadless is on. The simulation runs exactly as usual,
+		// but as fast as the CPU allows.
+BOOLEAN unpacedBattle;
+DWORD lastBattleFrameCount;
+static BOOLEAN replaySeeking;
+		// Running headless up to the seek frame of a replay
 size_t battleInputOrder[NUM_SIDES];
 		// Indices of the sides in the order their input is processed.
 		// Network sides are last so that the sides will never be waiting
@@ -193,6 +204,8 @@ ProcessInput (void)
 				}
 #endif
 
+				InputState = Replay_battleInput (cur_player, InputState);
+
 				StarShipPtr->ship_input_state = 0;
 				if (StarShipPtr->RaceDescPtr->ship_info.crew_level)
 				{
@@ -244,7 +257,7 @@ BattleSong (BOOLEAN DoPlay)
 			BattleRef = LoadMusic (BATTLE_MUSIC);
 	}
 
-	if (DoPlay)
+	if (DoPlay && !headlessBattle)
 		PlayMusic (BattleRef, TRUE, 1);
 }
 
@@ -255,6 +268,62 @@ FreeBattleSong (void)
 	BattleRef = 0;
 }
 
+#define HEADLESS_YIELD_FRAMES 64
+		// Power of two
+
+static BOOLEAN
+HeadlessBattleAllowed (void)
+{
+	COUNT playerI;
+
+	if (!optMeleeHeadless || LOBYTE (GLOBAL (CurrentActivity)) != SUPER_MELEE)
+		return FALSE;
+
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+	{
+		if (PlayerControl[playerI] & (HUMAN_CONTROL | NETWORK_CONTROL))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+ReportHeadlessBattle (const BATTLE_STATE *bs)
+{
+	COUNT side;
+	SIZE winner = -1;
+
+	if (battle_counter[0] && !battle_counter[1])
+		winner = 0;
+	else if (battle_counter[1] && !battle_counter[0])
+		winner = 1;
+
+	log_add (log_User, "Headless battle: %s after %lu frames",
+			(GLOBAL (CurrentActivity) & CHECK_ABORT) ? "aborted" :
+			(winner < 0 ? "draw" : winner == 0 ? "player 1 won" :
+			"player 2 won"), (unsigned long) bs->frame_count);
+
+	for (side = 0; side < NUM_SIDES; side++)
+	{
+		HSTARSHIP hStarShip, hNextShip;
+		COUNT crew = 0;
+
+		// Only the ship in play still has its race descriptor
+		for (hStarShip = GetHeadLink (&race_q[side]); hStarShip;
+				hStarShip = hNextShip)
+		{
+			STARSHIP *StarShipPtr = LockStarShip (&race_q[side], hStarShip);
+			if (StarShipPtr->RaceDescPtr)
+				crew += StarShipPtr->RaceDescPtr->ship_info.crew_level;
+			hNextShip = _GetSuccLink (StarShipPtr);
+			UnlockStarShip (&race_q[side], hStarShip);
+		}
+
+		log_add (log_User, "  Player %u: %u ships left, %u crew on the "
+				"ship in play", side + 1, battle_counter[side], crew);
+	}
+}
+
 static BOOLEAN
 DoBattle (BATTLE_STATE *bs)
 {
@@ -282,8 +351,10 @@ DoBattle (BATTLE_STATE *bs)
 		addLocalChecksum (battleFrameCount, checksum);
 	}
 #endif
+	PROFILE_BEGIN (PROF_INPUT);
 	ProcessInput ();
 			// Also calls NetInput()
+	PROFILE_END (PROF_INPUT);
 #if defined (NETPLAY) && defined (NETPLAY_CHECKSUM)
 	if (getNumNetConnections() > 0)
 	{
@@ -325,6 +396,21 @@ DoBattle (BATTLE_STATE *bs)
 		ScreenTransition (3, &r);
 	}
 	UnbatchGraphics ();
+	++bs->frame_count;
+	Replay_endFrame ();
+
+	if (replaySeeking && (bs->frame_count >= Replay_getSeekFrame ()
+			|| !Replay_isPlaying ()))
+	{	// Show the rest of the battle
+		replaySeeking = FALSE;
+		headlessBattle = HeadlessBattleAllowed ();
+		if (!headlessBattle)
+		{
+			nth_frame = MAKE_WORD (0, 0);
+			BattleSong (TRUE);
+		}
+	}
+
 	if ((!(GLOBAL (CurrentActivity) & IN_BATTLE)) ||
 			(GLOBAL (CurrentActivity) & (CHECK_ABORT | CHECK_LOAD)))
 	{
@@ -332,16 +418,23 @@ DoBattle (BATTLE_STATE *bs)
 	}
 
 	battle_speed = HIBYTE (nth_frame);
-	if (battle_speed == (BYTE)~0)
-	{	// maximum speed, nothing rendered at all
+	if (headlessBattle)
+	{	// Only yield once in a while; TaskSwitch() may sleep
+		if ((bs->frame_count & (HEADLESS_YIELD_FRAMES - 1)) == 0)
+		{
+			Async_process ();
+			TaskSwitch ();
+		}
+	}
+	else if (battle_speed == (BYTE)~0 || unpacedBattle)
+	{	// maximum speed; with unpacedBattle, still rendered
 		Async_process ();
 		TaskSwitch ();
 	}
 	else
 	{
-		SleepThreadUntil (bs->NextTime
-				+ BATTLE_FRAME_RATE / (battle_speed + 1));
-		bs->NextTime = GetTimeCounter ();
+		FramePacer_wait (&bs->pacer,
+				BATTLE_FRAME_RATE / (battle_speed + 1));
 	}
 
 	if ((GLOBAL (CurrentActivity) & IN_BATTLE) == 0)
@@ -411,6 +504,8 @@ Battle (BattleFrameCallback *callback)
 	BattleSeed = TFB_Random (); /* get next battle seed */
 #endif /* DEMO_MODE */
 
+	replaySeeking = Replay_getSeekFrame () > 0;
+	headlessBattle = replaySeeking || HeadlessBattleAllowed ();
 	BattleSong (FALSE);
 	
 	num_ships = InitShips ();
@@ -425,6 +520,7 @@ Battle (BattleFrameCallback *callback)
 	
 	if (num_ships)
 	{
+		extern UWORD nth_frame;
 		BATTLE_STATE bs;
 
 		GLOBAL (CurrentActivity) |= IN_BATTLE;
@@ -434,7 +530,16 @@ Battle (BattleFrameCallback *callback)
 		if (optMeleeScale != TFB_SCALE_STEP)
 			SetGraphicScaleMode (optMeleeScale);
 
+		if (headlessBattle)
+		{	// Maximum speed; RedrawQueue() draws nothing
+			nth_frame = MAKE_WORD (0, (BYTE)~0);
+		}
+
 		setupBattleInputOrder ();
+		ShipProfile_beginBattle ();
+		bs.frame_count = 0;
+		FramePacer_init (&bs.pacer);
+		ReportInputLatency (NULL);
 #ifdef NETPLAY
 		initBattleInputBuffers ();
 #ifdef NETPLAY_CHECKSUM
@@ -453,7 +558,6 @@ Battle (BattleFrameCallback *callback)
 
 		log_add(log_Debug, "BATTLE_DEBUG: selectAllShips returned TRUE, calling BattleSong");
 		BattleSong (TRUE);
-		bs.NextTime = 0;
 #ifdef NETPLAY
 		initBattleStateDataConnections ();
 		{
@@ -473,6 +577,19 @@ Battle (BattleFrameCallback *callback)
 		log_add(log_Debug, "BATTLE_DEBUG: DoInput returned, CHECK_ABORT=%d", (GLOBAL(CurrentActivity) & CHECK_ABORT) ? 1 : 0);
 
 AbortBattle:
+		lastBattleFrameCount = bs.frame_count;
+		if (headlessBattle)
+		{
+			ReportHeadlessBattle (&bs);
+			nth_frame = MAKE_WORD (0, 0);
+		}
+		else
+		{
+			FramePacer_report (&bs.pacer, "Battle");
+			ReportInputLatency ("Battle");
+		}
+		ShipProfile_endBattle ();
+
 		if (LOBYTE (GLOBAL (CurrentActivity)) == SUPER_MELEE)
 		{
 			if (GLOBAL (CurrentActivity) & CHECK_ABORT)
@@ -488,7 +605,7 @@ AbortBattle:
 
 				GLOBAL (CurrentActivity) &= ~CHECK_ABORT;
 			}
-			else
+			else if (!headlessBattle)
 			{
 				// Show the result of the battle.
 				MeleeGameOver ();
@@ -496,6 +613,9 @@ AbortBattle:
 		}
 
 #ifdef NETPLAY
+#ifdef NETPLAY_STATISTICS
+		logBattleStatistics ();
+#endif  /* NETPLAY_STATISTICS */
 		uninitBattleInputBuffers();
 #ifdef NETPLAY_CHECKSUM
 		uninitChecksumBuffers ();
@@ -510,6 +630,8 @@ AbortBattle:
 
 	UninitShips ();
 	FreeBattleSong ();
+	headlessBattle = FALSE;
+	replaySeeking = FALSE;
 
 	
 	return (BOOLEAN) (num_ships < 0);
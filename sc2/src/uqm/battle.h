@@ -18,6 +18,7 @@
 
 #include "options.h"
 #include "libs/compiler.h"
+#include "libs/time/framepace.h"
 
 #if defined (NETPLAY)
 typedef DWORD BattleFrameCounter;
@@ -37,12 +38,21 @@ typedef void (BattleFrameCallback) (void);
 typedef struct battlestate_struct {
 	BOOLEAN (*InputFunc) (struct battlestate_struct *pInputState);
 	BOOLEAN first_time;
-	DWORD NextTime;
+	FramePacer pacer;
 	BattleFrameCallback *frame_cb;
+	DWORD frame_count;
+			// Number of battle frames run so far
 } BATTLE_STATE;
 
 extern BYTE battle_counter[NUM_SIDES];
 extern BOOLEAN instantVictory;
+extern BOOLEAN headlessBattle;
+		// Nothing is drawn or played, and frames are not paced
+extern BOOLEAN unpacedBattle;
+		// Set by the caller: battles are drawn as usual, but each frame
+		// starts as soon as the last is done
+extern DWORD lastBattleFrameCount;
+		// The frames the last battle ran for
 #if defined (NETPLAY)
 extern BattleFrameCounter battleFrameCount;
 #endif
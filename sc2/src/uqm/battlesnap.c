@@ -0,0 +1,260 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Snapshots of the battle state, to go back to an earlier frame with:
+// the display list and all its elements, the ships of both sides and
+// their RACE_DESCs, the display primitives, the RNG, and the globals the
+// battle keeps its state in. They are kept in a ring of frames allocated
+// once by InitBattleSnapshots(), for a battle that has started. Taking
+// or restoring one is a memcpy() per block; nothing is allocated.
+//
+// Not in a snapshot: what the race code allocates for itself (what
+// RACE_DESC.data points to), the Rust side of the ships with
+// USE_RUST_SHIPS, sound, and what is drawn but not simulated, like the
+// background stars and the status display. A snapshot can only be put
+// back while the same ships are in play; their RACE_DESCs are copied
+// back in place, not loaded anew.
+
+#include "battlesnap.h"
+#include "battle.h"
+#include "element.h"
+#include "races.h"
+#include "setup.h"
+#include "libs/mathlib.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include <string.h>
+
+extern POINT SpaceOrg;
+extern SIZE zoom_out;
+extern UWORD nth_frame;
+extern PRIM_LINKS DisplayLinks;
+
+typedef struct
+{
+	DWORD frame;
+	BOOLEAN used;
+	DWORD seed;
+	BYTE battle_counter[NUM_SIDES];
+	POINT SpaceOrg;
+	SIZE zoom_out;
+	UWORD nth_frame;
+	COUNT DisplayFreeList;
+	PRIM_LINKS DisplayLinks;
+#ifdef NETPLAY
+	BattleFrameCounter battleFrameCount;
+#endif
+	RACE_DESC *raceDescPtr[NUM_SIDES][MAX_SHIPS_PER_SIDE];
+			// Of the ship in each slot of race_q; NULL if none
+} SNAPSHOT_HEADER;
+
+// Each frame of the ring holds, one after the other:
+//   the SNAPSHOT_HEADER
+//   the copies of disp_q, race_q[0] and race_q[1] (CopyQueueOut())
+//   DisplayArray
+//   a RACE_DESC for each slot of raceDescPtr, used or not
+static BYTE *ring;
+static COUNT ringFrames;
+static size_t frameSize;
+static size_t dispQSize;
+static size_t raceQSize[NUM_SIDES];
+
+static void
+getRaceDescs (RACE_DESC *descs[NUM_SIDES][MAX_SHIPS_PER_SIDE])
+{
+	COUNT side;
+
+	memset (descs, 0, sizeof (RACE_DESC *) * NUM_SIDES * MAX_SHIPS_PER_SIDE);
+	for (side = 0; side < NUM_SIDES; ++side)
+	{
+		QUEUE *pq = &race_q[side];
+		HSTARSHIP hStarShip, hNextShip;
+
+		for (hStarShip = GetHeadLink (pq); hStarShip; hStarShip = hNextShip)
+		{
+			STARSHIP *StarShipPtr = LockStarShip (pq, hStarShip);
+			COUNT slot = (COUNT)(((BYTE *)hStarShip - pq->pq_tab)
+					/ GetLinkSize (pq));
+
+			hNextShip = _GetSuccLink (StarShipPtr);
+			// race_q never grows; all its links are in the table
+			assert (slot < MAX_SHIPS_PER_SIDE);
+			descs[side][slot] = StarShipPtr->RaceDescPtr;
+			UnlockStarShip (pq, hStarShip);
+		}
+	}
+}
+
+// Allocates the ring, for the battle that has just been set up. Grows
+// disp_q to the most elements it can have, so that they stay in place.
+BOOLEAN
+InitBattleSnapshots (COUNT numFrames)
+{
+	COUNT side;
+	COUNT i;
+
+	UninitBattleSnapshots ();
+	if (numFrames == 0)
+		return FALSE;
+
+	GrowQueueFully (&disp_q);
+
+	dispQSize = QueueCopySize (&disp_q);
+	frameSize = sizeof (SNAPSHOT_HEADER) + dispQSize;
+	for (side = 0; side < NUM_SIDES; ++side)
+	{
+		raceQSize[side] = QueueCopySize (&race_q[side]);
+		frameSize += raceQSize[side];
+	}
+	frameSize += sizeof (DisplayArray);
+	frameSize += sizeof (RACE_DESC) * NUM_SIDES * MAX_SHIPS_PER_SIDE;
+	frameSize = (frameSize + 15) & ~(size_t)15;
+			// Keep the headers aligned
+
+	ring = HMalloc (frameSize * numFrames);
+	if (!ring)
+		return FALSE;
+	ringFrames = numFrames;
+	for (i = 0; i < numFrames; ++i)
+		((SNAPSHOT_HEADER *)(ring + i * frameSize))->used = FALSE;
+
+	log_add (log_Debug, "Battle snapshots: %u frames of %lu bytes.",
+			numFrames, (unsigned long) frameSize);
+	return TRUE;
+}
+
+void
+UninitBattleSnapshots (void)
+{
+	HFree (ring);
+	ring = NULL;
+	ringFrames = 0;
+}
+
+// Keeps the state of the battle as it is now as that of 'frame', in
+// place of the frame ringFrames before it
+void
+TakeBattleSnapshot (DWORD frame)
+{
+	BYTE *buf;
+	SNAPSHOT_HEADER *hdr;
+	COUNT side, slot;
+
+	if (!ring)
+		return;
+
+	buf = ring + (frame % ringFrames) * frameSize;
+	hdr = (SNAPSHOT_HEADER *) buf;
+	hdr->frame = frame;
+	hdr->used = TRUE;
+	hdr->seed = TFB_SeedRandom (1);
+	TFB_SeedRandom (hdr->seed);
+	memcpy (hdr->battle_counter, battle_counter, sizeof (battle_counter));
+	hdr->SpaceOrg = SpaceOrg;
+	hdr->zoom_out = zoom_out;
+	hdr->nth_frame = nth_frame;
+	hdr->DisplayFreeList = DisplayFreeList;
+	hdr->DisplayLinks = DisplayLinks;
+#ifdef NETPLAY
+	hdr->battleFrameCount = battleFrameCount;
+#endif
+	getRaceDescs (hdr->raceDescPtr);
+	buf += sizeof (SNAPSHOT_HEADER);
+
+	CopyQueueOut (&disp_q, buf);
+	buf += dispQSize;
+	for (side = 0; side < NUM_SIDES; ++side)
+	{
+		CopyQueueOut (&race_q[side], buf);
+		buf += raceQSize[side];
+	}
+	memcpy (buf, DisplayArray, sizeof (DisplayArray));
+	buf += sizeof (DisplayArray);
+
+	for (side = 0; side < NUM_SIDES; ++side)
+	{
+		for (slot = 0; slot < MAX_SHIPS_PER_SIDE;
+				++slot, buf += sizeof (RACE_DESC))
+		{
+			if (hdr->raceDescPtr[side][slot])
+				memcpy (buf, hdr->raceDescPtr[side][slot], sizeof (RACE_DESC));
+		}
+	}
+}
+
+// Puts the battle back the way it was at 'frame'. Returns FALSE, and
+// changes nothing, if that frame is not in the ring (any more), or the
+// ships in play are not the same ones.
+BOOLEAN
+RestoreBattleSnapshot (DWORD frame)
+{
+	BYTE *buf;
+	const SNAPSHOT_HEADER *hdr;
+	RACE_DESC *current[NUM_SIDES][MAX_SHIPS_PER_SIDE];
+	COUNT side, slot;
+
+	if (!ring)
+		return FALSE;
+
+	buf = ring + (frame % ringFrames) * frameSize;
+	hdr = (const SNAPSHOT_HEADER *) buf;
+	if (!hdr->used || hdr->frame != frame)
+		return FALSE;
+
+	getRaceDescs (current);
+	if (memcmp (current, hdr->raceDescPtr, sizeof (current)) != 0)
+		return FALSE;
+	buf += sizeof (SNAPSHOT_HEADER);
+
+	if (!CopyQueueIn (&disp_q, buf))
+	{	// Only if something set up a new display list after Init
+		log_add (log_Warning, "Battle snapshot of frame %lu does not fit "
+				"the display list.", (unsigned long) frame);
+		return FALSE;
+	}
+	buf += dispQSize;
+	for (side = 0; side < NUM_SIDES; ++side)
+	{
+		// The same ships in the same slots, so the same queue
+		CopyQueueIn (&race_q[side], buf);
+		buf += raceQSize[side];
+	}
+	memcpy (DisplayArray, buf, sizeof (DisplayArray));
+	buf += sizeof (DisplayArray);
+
+	for (side = 0; side < NUM_SIDES; ++side)
+	{
+		for (slot = 0; slot < MAX_SHIPS_PER_SIDE;
+				++slot, buf += sizeof (RACE_DESC))
+		{
+			if (hdr->raceDescPtr[side][slot])
+				memcpy (hdr->raceDescPtr[side][slot], buf, sizeof (RACE_DESC));
+		}
+	}
+
+	TFB_SeedRandom (hdr->seed);
+	memcpy (battle_counter, hdr->battle_counter, sizeof (battle_counter));
+	SpaceOrg = hdr->SpaceOrg;
+	zoom_out = hdr->zoom_out;
+	nth_frame = hdr->nth_frame;
+	DisplayFreeList = hdr->DisplayFreeList;
+	DisplayLinks = hdr->DisplayLinks;
+#ifdef NETPLAY
+	battleFrameCount = hdr->battleFrameCount;
+#endif
+
+	return TRUE;
+}
@@ -61,6 +61,7 @@ extern void RemoveEscortShips (COUNT race);
 extern RACE_DESC *load_ship (SPECIES_ID SpeciesID, BOOLEAN LoadBattleData);
 extern void free_ship (RACE_DESC *RaceDescPtr, BOOLEAN FreeIconData,
 		BOOLEAN FreeBattleData);
+extern void preload_ship (SPECIES_ID SpeciesID);
 
 // C-native load/free: always available, bypasses USE_RUST_SHIPS dispatch.
 // Used by LoadMasterShipList to populate the C master_q with real resource handles.
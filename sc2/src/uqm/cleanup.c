@@ -26,6 +26,7 @@
 #include "starcon.h"
 #include "setup.h"
 #include "planets/solarsys.h"
+#include "save.h"
 #include "sounds.h"
 #include "libs/sndlib.h"
 #include "libs/vidlib.h"
@@ -34,6 +35,7 @@
 void
 FreeKernel (void)
 {
+	WaitForSaveWrite ();
 	UninitPlayerInput ();
 
 	UninitResourceSystem ();
@@ -94,6 +94,8 @@ extern HEVENT AddEvent (EVENT_TYPE type, COUNT month_index, COUNT
 extern void EventHandler (BYTE selector);
 extern void GameClockTick (void);
 extern void MoveGameClockDays (COUNT days);
+extern COUNT DaysUntilDate (COUNT month_index, COUNT day_index,
+		COUNT year_index);
 
 // The lock/unlock/running functions are for debugging use only
 // Locking will block the GameClockTick() function and thus
@@ -82,6 +82,34 @@ ValidateEvent (EVENT_TYPE type, COUNT *pmonth_index, COUNT *pday_index,
 			&& day_index < GLOBAL (GameClock.day_index))))));
 }
 
+// The number of days from the current date to the given one; 0 if the
+// date is not in the future
+COUNT
+DaysUntilDate (COUNT month_index, COUNT day_index, COUNT year_index)
+{
+	COUNT month = GLOBAL (GameClock.month_index);
+	COUNT year = GLOBAL (GameClock.year_index);
+	long days;
+
+	if (!(year < year_index || (year == year_index
+			&& (month < month_index || (month == month_index
+			&& GLOBAL (GameClock.day_index) < day_index)))))
+		return 0;
+
+	days = (long) day_index - GLOBAL (GameClock.day_index);
+	while (year < year_index || month < month_index)
+	{
+		days += DaysInMonth (month, year);
+		if (++month > 12)
+		{
+			month = 1;
+			++year;
+		}
+	}
+
+	return (COUNT) days;
+}
+
 HEVENT
 AddEvent (EVENT_TYPE type, COUNT month_index, COUNT day_index, COUNT
 		year_index, BYTE func_index)
@@ -42,6 +42,8 @@
 #include "libs/inplib.h"
 #include "libs/sound/sound.h"
 #include "libs/sound/trackplayer.h"
+#include "libs/time/framepace.h"
+#include "libs/time/profile.h"
 #include "libs/log.h"
 #ifdef USE_RUST_COMM
 #include "rust_comm.h"
@@ -90,7 +92,7 @@ typedef struct encounter_state
 	BOOLEAN (*InputFunc) (struct encounter_state *pES);
 
 	COUNT Initialized;
-	TimeCount NextTime; // framerate control
+	FramePacer pacer; // framerate control
 	BYTE num_responses;
 	BYTE cur_response;
 	BYTE top_response;
@@ -102,8 +104,16 @@ typedef struct encounter_state
 static ENCOUNTER_STATE *pCurInputState;
 
 static BOOLEAN clear_subtitles;
+		// The whole alien frame must be drawn again, with the subtitles
 static TEXT SubtitleText;
 static const UNICODE *last_subtitle;
+static RECT subtitle_rect;
+		// What the subtitle cache covers; extent.width is 0 when empty
+#ifndef USE_RUST_COMM
+static BOOLEAN subtitles_changed;
+		// The subtitles must be drawn again, but the alien frame only
+		// where the old ones were
+#endif
 
 static CONTEXT TextCacheContext;
 static FRAME TextCacheFrame;
@@ -188,6 +198,7 @@ add_text (int status, TEXT *pTextIn)
 			ClearDrawable ();
 
 			last_subtitle = pTextIn->pStr;
+			subtitle_rect.extent.width = 0;
 		}
 
 		text_width = CommData.AlienTextWidth;
@@ -279,8 +290,26 @@ add_text (int status, TEXT *pTextIn)
 		else
 		{
 			// Alien speech
+			RECT r;
+
 			font_DrawTracedText (pText,
 					CommData.AlienTextFColor, CommData.AlienTextBColor);
+
+			if (TextRect (pText, &r, NULL))
+			{	// The trace is 1 pixel around the text
+				r.corner.x--;
+				r.corner.y--;
+				r.extent.width += 2;
+				r.extent.height += 2;
+				if (subtitle_rect.extent.width == 0)
+					subtitle_rect = r;
+				else
+				{	// BoxUnion() cannot work in place
+					RECT u;
+					BoxUnion (&subtitle_rect, &r, &u);
+					subtitle_rect = u;
+				}
+			}
 		}
 	} while (!eol && maxchars);
 	pText->pStr = pStr;
@@ -304,81 +333,13 @@ add_text (int status, TEXT *pTextIn)
 
 // This function calculates how much of a string can be fitted within
 // a specific width, up to a newline or terminating \0.
-// pText is the text to be fitted. pText->CharCount will be set to the
-// number of characters that fitted.
-// startNext will be filled with the start of the first word that
-// doesn't fit in one line, or if an entire line fits, to the character
-// past the newline, or if the entire string fits, to the end of the
-// string.
-// maxWidth is the maximum number of pixels that a line may be wide
+// See TextLineWithinWidth(), which does the work.
 //   ASSUMPTION: there are no words in the text wider than maxWidth
-// maxChars is the maximum number of characters (not bytes) that are to
-// be fitted.
-// TRUE is returned if a complete line fitted
-// FALSE otherwise
 BOOLEAN
 getLineWithinWidth(TEXT *pText, const char **startNext,
 		SIZE maxWidth, COUNT maxChars)
 {
-	BOOLEAN eol;
-			// The end of the line of text has been reached.
-	BOOLEAN done;
-			// We cannot add any more words.
-	RECT rect;
-	COUNT oldCount;
-	const char *ptr;
-	const char *wordStart;
-	UniChar ch;
-	COUNT charCount;
-
-	//GetContextClipRect (&rect);
-
-	eol = FALSE;	
-	done = FALSE;
-	oldCount = 1;
-	charCount = 0;
-	ch = '\0';
-	ptr = pText->pStr;
-	for (;;)
-	{
-		wordStart = ptr;
-
-		// Scan one word.
-		for (;;)
-		{
-			if (*ptr == '\0')
-			{
-				eol = TRUE;
-				done = TRUE;
-				break;
-			}
-			ch = getCharFromString (&ptr);
-			eol = ch == '\0' || ch == '\n' || ch == '\r';
-			done = eol || charCount >= maxChars;
-			if (done || ch == ' ')
-				break;
-			charCount++;
-		}
-
-		oldCount = pText->CharCount;
-		pText->CharCount = charCount;
-		TextRect (pText, &rect, NULL);
-		
-		if (rect.extent.width >= maxWidth)
-		{
-			pText->CharCount = oldCount;
-			*startNext = wordStart;
-			return FALSE;
-		}
-
-		if (done)
-		{
-			*startNext = ptr;
-			return eol;
-		}
-		charCount++;
-				// For the space in between words.
-	}
+	return TextLineWithinWidth (pText, startNext, maxWidth, maxChars);
 }
 
 static void
@@ -525,11 +486,13 @@ UpdateSpeechGraphics (void)
 
 	NextTime = GetTimeCounter () + OSCILLOSCOPE_RATE;
 
+	PROFILE_BEGIN (PROF_COMM);
 	OldContext = SetContext (RadarContext);
 	DrawOscilloscope ();
 	SetContext (SpaceContext);
 	DrawSlider ();
 	SetContext (OldContext);
+	PROFILE_END (PROF_COMM);
 }
 
 static void
@@ -544,15 +507,22 @@ UpdateAnimations (bool paused)
 
 	NextTime = GetTimeCounter () + COMM_ANIM_RATE;
 
+	PROFILE_BEGIN (PROF_COMM);
 	OldContext = SetContext (AnimContext);
 	BatchGraphics ();
+	// Only the part of the alien frame under the old subtitles needs
+	// to be drawn again to erase them
+	if (subtitles_changed && !clear_subtitles)
+		InvalidateAlienFrame (&subtitle_rect);
 	// Advance and draw ambient, transit and talk animations
 	change = ProcessCommAnimations (clear_subtitles, paused);
-	if (change || clear_subtitles)
+	if (change || clear_subtitles || subtitles_changed)
 		RedrawSubtitles ();
 	UnbatchGraphics ();
 	clear_subtitles = FALSE;
+	subtitles_changed = FALSE;
 	SetContext (OldContext);
+	PROFILE_END (PROF_COMM);
 }
 
 static void
@@ -1048,8 +1018,7 @@ PlayerResponseInput (ENCOUNTER_STATE *pES)
 
 		UpdateCommGraphics ();
 
-		SleepThreadUntil (pES->NextTime);
-		pES->NextTime = GetTimeCounter () + COMM_ANIM_RATE;
+		FramePacer_wait (&pES->pacer, COMM_ANIM_RATE);
 	}
 }
 
@@ -1366,12 +1335,16 @@ InitCommunication (CONVERSATION which_comm)
 {
 	COUNT status;
 	LOCDATA *LocDataPtr;
+	char preloadSet[32];
 
 #ifdef DEBUG
 	if (disableInteractivity)
 		return 0;
 #endif
 	
+	snprintf (preloadSet, sizeof preloadSet, "preload.comm.%u",
+			(unsigned) which_comm);
+	res_PreloadSet (preloadSet);
 
 	if (LastActivity & CHECK_LOAD)
 	{
@@ -1672,7 +1645,7 @@ RedrawSubtitles (void)
 static void
 ClearSubtitles (void)
 {
-	clear_subtitles = TRUE;
+	subtitles_changed = TRUE;
 	last_subtitle = NULL;
 	SubtitleText.pStr = NULL;
 	SubtitleText.CharCount = 0;
@@ -1694,7 +1667,7 @@ CheckSubtitles (void)
 			SubtitleText.baseline.y != baseline.y ||
 			SubtitleText.align != align)
 	{	// Subtitles changed
-		clear_subtitles = TRUE;
+		subtitles_changed = TRUE;
 		// Baseline may be updated by the ZFP
 		SubtitleText.baseline = baseline;
 		SubtitleText.align = align;
@@ -39,6 +39,9 @@ static SEQUENCE* Talk;
 static SEQUENCE* Transit;
 static COUNT FirstAmbient;
 static COUNT TotalSequences;
+static RECT DirtyRect;
+		// Part of the alien frame to draw again from all of its layers
+		// on the next DrawAlienFrame(); extent.width is 0 when none
 
 
 static inline DWORD
@@ -556,6 +559,132 @@ ProcessCommAnimations (BOOLEAN FullRedraw, BOOLEAN paused)
 	}
 }
 
+void
+InvalidateAlienFrame (RECT *pRect)
+{
+	RECT r;
+
+	if (pRect->extent.width <= 0 || pRect->extent.height <= 0)
+		return;
+
+	if (DirtyRect.extent.width == 0)
+	{
+		DirtyRect = *pRect;
+		return;
+	}
+	// BoxUnion() cannot work in place
+	BoxUnion (&DirtyRect, pRect, &r);
+	DirtyRect = r;
+}
+
+// Where the current frame of the sequence is drawn
+static void
+getSequenceRect (SEQUENCE *pSeq, RECT *pRect)
+{
+	GetFrameRect (SetAbsFrameIndex (CommData.AlienFrame,
+			pSeq->ADPtr->StartIndex + pSeq->CurIndex), pRect);
+	pRect->corner.x -= SAFE_X;
+}
+
+static BOOLEAN
+isDrawnSequence (SEQUENCE *pSeq)
+{
+	return !(pSeq->ADPtr->AnimFlags & ANIM_DISABLED)
+			&& pSeq->AnimType == PICTURE_ANIM;
+}
+
+// A changed picture must be drawn in its place in the stack when it
+// overlaps a picture above it that does not change. Pictures that do
+// not overlap can simply be drawn over what is there.
+static BOOLEAN
+overlapsUpperSequence (SEQUENCE *Sequences, int index, RECT *pRect)
+{
+	int i;
+
+	// Lower indexes are drawn later, on top
+	for (i = index - 1; i >= 0; --i)
+	{
+		SEQUENCE *pSeq = &Sequences[i];
+		RECT r;
+
+		if (!isDrawnSequence (pSeq) || pSeq->Change)
+			continue;
+
+		getSequenceRect (pSeq, &r);
+		if (BoxIntersect (pRect, &r, &r))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// Draws all the layers of the alien frame again, but only within pRect,
+// in the same order as a full redraw does
+static void
+redrawAlienFrameRect (SEQUENCE *Sequences, COUNT Num, RECT *pRect)
+{
+	RECT oldClip;
+	RECT clip;
+	RECT r;
+	STAMP s;
+	int i;
+
+	GetContextClipRect (&oldClip);
+	r.corner.x = 0;
+	r.corner.y = 0;
+	r.extent = oldClip.extent;
+	if (!BoxIntersect (pRect, &r, &r))
+		return; // outside of the window
+	// The clip rect is in screen coordinates, and drawing is relative
+	// to its corner
+	clip.corner.x = oldClip.corner.x + r.corner.x;
+	clip.corner.y = oldClip.corner.y + r.corner.y;
+	clip.extent = r.extent;
+	SetContextClipRect (&clip);
+
+	s.origin.x = -SAFE_X - r.corner.x;
+	s.origin.y = -r.corner.y;
+
+	s.frame = CommData.AlienFrame;
+	DrawStamp (&s);
+
+	// The static frames are disabled by the full redraw that first
+	// drew them
+	for (i = CommData.NumAnimations - 1; i >= 0; --i)
+	{
+		ANIMATION_DESC *ADPtr = &CommData.AlienAmbientArray[i];
+
+		if ((ADPtr->AnimFlags & ANIM_MASK)
+				|| (ADPtr->AnimFlags & COLORXFORM_ANIM))
+			continue;
+
+		s.frame = SetAbsFrameIndex (CommData.AlienFrame,
+				ADPtr->StartIndex);
+		DrawStamp (&s);
+	}
+
+	if (Sequences)
+	{
+		for (i = Num - 1; i >= 0; --i)
+		{
+			SEQUENCE *pSeq = &Sequences[i];
+			RECT seqRect;
+
+			if (!isDrawnSequence (pSeq))
+				continue;
+
+			getSequenceRect (pSeq, &seqRect);
+			if (!BoxIntersect (pRect, &seqRect, &seqRect))
+				continue;
+
+			s.frame = SetAbsFrameIndex (CommData.AlienFrame,
+					pSeq->ADPtr->StartIndex + pSeq->CurIndex);
+			DrawStamp (&s);
+		}
+	}
+
+	SetContextClipRect (&oldClip);
+}
+
 BOOLEAN
 DrawAlienFrame (SEQUENCE *Sequences, COUNT Num, BOOLEAN fullRedraw)
 {
@@ -592,6 +721,44 @@ DrawAlienFrame (SEQUENCE *Sequences, COUNT Num, BOOLEAN fullRedraw)
 			}
 		}
 	}
+	else if (Sequences)
+	{	// If a changed picture has to go under another one, or a part
+		// of the frame is redrawn anyway, all the changed pictures are
+		// drawn from the bottom of the stack up, within the area they
+		// cover
+		BOOLEAN restack = DirtyRect.extent.width != 0;
+		RECT changed;
+
+		changed.extent.width = 0;
+		for (i = Num - 1; i >= 0; --i)
+		{
+			SEQUENCE *pSeq = &Sequences[i];
+			RECT r;
+
+			if (!isDrawnSequence (pSeq) || !pSeq->Change)
+				continue;
+
+			getSequenceRect (pSeq, &r);
+			if (changed.extent.width == 0)
+				changed = r;
+			else
+			{
+				RECT u;
+				BoxUnion (&changed, &r, &u);
+				changed = u;
+			}
+			if (!restack && overlapsUpperSequence (Sequences, i, &r))
+				restack = TRUE;
+		}
+		if (restack)
+			InvalidateAlienFrame (&changed);
+	}
+
+	if (!fullRedraw && DirtyRect.extent.width != 0)
+	{
+		redrawAlienFrameRect (Sequences, Num, &DirtyRect);
+		Change = TRUE;
+	}
 
 	if (Sequences)
 	{	// Draw the animation sequences (has to be in reverse)
@@ -608,15 +775,20 @@ DrawAlienFrame (SEQUENCE *Sequences, COUNT Num, BOOLEAN fullRedraw)
 			if (!fullRedraw && !pSeq->Change)
 				continue;
 
+			pSeq->Change = FALSE;
+			Change = TRUE;
+
+			if (!fullRedraw && DirtyRect.extent.width != 0)
+				continue; // already drawn in its place in the stack
+
 			s.frame = SetAbsFrameIndex (CommData.AlienFrame,
 					ADPtr->StartIndex + pSeq->CurIndex);
 			DrawStamp (&s);
-			pSeq->Change = FALSE;
-
-			Change = TRUE;
 		}
 	}
 
+	DirtyRect.extent.width = 0;
+
 	UnbatchGraphics ();
 
 	return Change;
@@ -131,6 +131,9 @@ typedef struct SEQUENCE SEQUENCE;
 
 // Returns TRUE if there was an animation change
 extern BOOLEAN DrawAlienFrame (SEQUENCE *pSeq, COUNT Num, BOOLEAN fullRedraw);
+// Has the next partial DrawAlienFrame() draw all the layers of the frame
+// within pRect again, e.g. to erase something drawn over them
+extern void InvalidateAlienFrame (RECT *pRect);
 extern void InitCommAnimations (void);
 extern BOOLEAN ProcessCommAnimations (BOOLEAN fullRedraw, BOOLEAN paused);
 
@@ -80,16 +80,14 @@ NPCPhrase_cb (int index, CallbackFunction cb)
 				pTimeStamp = 0;
 			}
 			else
-			{
-				pStr = (UNICODE *)GetStringAddress (
-						SetAbsStringTableIndex (CommData.ConversationPhrases, index - 1)
-						);
-				pClip = GetStringSoundClip (
-						SetAbsStringTableIndex (CommData.ConversationPhrases, index - 1)
-						);
-				pTimeStamp = GetStringTimeStamp (
-						SetAbsStringTableIndex (CommData.ConversationPhrases, index - 1)
-						);
+			{	// The text, clip and timestamps are all parts of the
+				// one string
+				STRING S = SetAbsStringTableIndex (
+						CommData.ConversationPhrases, index - 1);
+
+				pStr = (UNICODE *)GetStringAddress (S);
+				pClip = GetStringSoundClip (S);
+				pTimeStamp = GetStringTimeStamp (S);
 			}
 			break;
 	}
@@ -103,15 +101,15 @@ NPCPhrase_splice (int index)
 {
 	UNICODE *pStr;
 	void *pClip;
+	STRING S;
 
 	assert (index >= 0);
 	if (index == 0)
 		return;
 
-	pStr = (UNICODE *)GetStringAddress (
-			SetAbsStringTableIndex (CommData.ConversationPhrases, index - 1));
-	pClip = GetStringSoundClip (
-			SetAbsStringTableIndex (CommData.ConversationPhrases, index - 1));
+	S = SetAbsStringTableIndex (CommData.ConversationPhrases, index - 1);
+	pStr = (UNICODE *)GetStringAddress (S);
+	pClip = GetStringSoundClip (S);
 
 	if (!pClip)
 	{	// Just appending some text
@@ -128,6 +126,18 @@ NPCPhrase_splice (int index)
 
 #endif /* !USE_RUST_COMM */
 
+// Lets a script have the voice of a phrase it is going to say next
+// loaded in the background
+void
+NPCPhrasePrefetch (int index)
+{
+	if (index <= 0)
+		return;
+
+	PrefetchTrack (GetStringSoundClip (
+			SetAbsStringTableIndex (CommData.ConversationPhrases, index - 1)));
+}
+
 void
 NPCNumber (int number, const char *fmt)
 {
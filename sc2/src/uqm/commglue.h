@@ -114,6 +114,7 @@ extern void NPCPhrase_cb (int index, CallbackFunction cb);
 #define NPCPhrase(index) NPCPhrase_cb ((index), NULL)
 extern void NPCPhrase_splice (int index);
 #endif
+extern void NPCPhrasePrefetch (int index);
 extern void NPCNumber (int number, const char *fmt);
 
 #define ALLIANCE_NAME_BUFSIZE 256
@@ -99,6 +99,9 @@ extern volatile CONTROLLER_INPUT_STATE ImmediateInputState;
 extern CONTROL_TEMPLATE PlayerControls[];
 
 void UpdateInputState (void);
+// Logs how late key presses were seen since the last report, or with
+// 'what' NULL only starts over
+void ReportInputLatency (const char *what);
 extern void FlushInput (void);
 void SetMenuRepeatDelay (DWORD min, DWORD max, DWORD step, BOOLEAN gestalt);
 void SetDefaultMenuRepeatDelay (void);
@@ -26,6 +26,7 @@
 #include "units.h"
 #include "libs/mathlib.h"
 #include "libs/log.h"
+#include <assert.h>
 
 //#define DEBUG_CYBORG
 
@@ -1003,13 +1004,56 @@ Avoid (ELEMENT *ShipPtr, EVALUATE_DESC *EvalDescPtr)
 	(void) EvalDescPtr;  /* Satisfying compiler (unused parameter) */
 }
 
+// The elements any computer ship may be concerned with this frame, in
+// display list order. The display list does not change while battle
+// input is processed, so the table is built by the first
+// tactical_intelligence() call of a frame and shared by the computer
+// ships after it.
+static struct
+{
+	BOOLEAN valid;
+	COUNT count;
+	HELEMENT elements[MAX_GROWN_DISPLAY_ELEMENTS];
+} threatTable;
+
+// To be called whenever the display list may have changed since the
+// table was built; RedrawQueue() does so every frame
+void
+InvalidateThreatTable (void)
+{
+	threatTable.valid = FALSE;
+}
+
+static void
+BuildThreatTable (void)
+{
+	HELEMENT hElement, hNextElement;
+	ELEMENT *ElementPtr;
+
+	threatTable.count = 0;
+	for (hElement = GetHeadElement (); hElement != 0;
+			hElement = hNextElement)
+	{
+		LockElement (hElement, &ElementPtr);
+		hNextElement = GetSuccElement (ElementPtr);
+		if (CollidingElement (ElementPtr))
+		{
+			assert (threatTable.count < MAX_GROWN_DISPLAY_ELEMENTS);
+			threatTable.elements[threatTable.count++] = hElement;
+		}
+		UnlockElement (hElement);
+	}
+	threatTable.valid = TRUE;
+}
+
 BATTLE_INPUT_STATE
 tactical_intelligence (ComputerInputContext *context, STARSHIP *StarShipPtr)
 {
 	ELEMENT *ShipPtr;
 	ELEMENT Ship;
 	COUNT ShipFacing;
-	HELEMENT hElement, hNextElement;
+	HELEMENT hElement;
+	COUNT threatI;
 	COUNT ConcernCounter;
 	EVALUATE_DESC ObjectsOfConcern[10];
 	BOOLEAN ShipMoved, UltraManeuverable;
@@ -1070,15 +1114,17 @@ if (!(ShipPtr->state_flags & FINITE_LIFE)
 		StarShipPtr->ship_input_state &= ~THRUST;
 	}
 
-	for (hElement = GetHeadElement ();
-			hElement != 0; hElement = hNextElement)
+	if (!threatTable.valid)
+		BuildThreatTable ();
+
+	for (threatI = 0; threatI < threatTable.count; ++threatI)
 	{
 		EVALUATE_DESC ed;
 
 		ed.MoveState = NO_MOVEMENT;
 
+		hElement = threatTable.elements[threatI];
 		LockElement (hElement, &ed.ObjectPtr);
-		hNextElement = GetSuccElement (ed.ObjectPtr);
 		if (CollisionPossible (ed.ObjectPtr, &Ship))
 		{
 			SIZE dx, dy;
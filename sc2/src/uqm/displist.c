@@ -18,6 +18,7 @@
 
 #include "displist.h"
 #include "libs/log.h"
+#include <string.h>
 
 #ifdef QUEUE_TABLE
 #define NULL_HANDLE NULL
@@ -27,29 +28,102 @@
  * This file contains code for generic doubly linked lists.
  * If QUEUE_TABLE is defined, each lists has its own preallocated
  * pool of link structures. The size is specific on InitQueue(),
- * and poses a hard limit on the number of elements in the list.
+ * and poses a hard limit on the number of elements in the list,
+ * unless SetQueueGrowth() lets the pool grow in chunks.
  */
 
+#ifdef QUEUE_TABLE
+static void
+addFreeLink (QUEUE *pq, HLINK hLink)
+{
+	LINK *LinkPtr;
+#ifdef QUEUE_TABLE_COMPACT
+	HLINK hPrevLink = NULL_HANDLE;
+	HLINK hNextLink = GetFreeList (pq);
+
+	// Keep the free list sorted by address
+	while (hNextLink && (BYTE *)hNextLink < (BYTE *)hLink)
+	{
+		LinkPtr = LockLink (pq, hNextLink);
+		hPrevLink = hNextLink;
+		hNextLink = _GetSuccLink (LinkPtr);
+		UnlockLink (pq, hPrevLink);
+	}
+
+	LinkPtr = LockLink (pq, hLink);
+	_SetSuccLink (LinkPtr, hNextLink);
+	UnlockLink (pq, hLink);
+
+	if (hPrevLink)
+	{
+		LinkPtr = LockLink (pq, hPrevLink);
+		_SetSuccLink (LinkPtr, hLink);
+		UnlockLink (pq, hPrevLink);
+	}
+	else
+		SetFreeList (pq, hLink);
+#else /* !QUEUE_TABLE_COMPACT */
+	LinkPtr = LockLink (pq, hLink);
+	_SetSuccLink (LinkPtr, GetFreeList (pq));
+	UnlockLink (pq, hLink);
+
+	SetFreeList (pq, hLink);
+#endif /* QUEUE_TABLE_COMPACT */
+}
+
+// Put all links of the table and the chunks on the free list
+static void
+resetFreeList (QUEUE *pq)
+{
+	COUNT num_elements;
+	QUEUE_CHUNK *chunk;
+
+	SetFreeList (pq, NULL_HANDLE);
+	pq->num_used = 0;
+
+	num_elements = SizeQueueTab (pq);
+	if (num_elements)
+	{
+		do
+			addFreeLink (pq, GetLinkAddr (pq, num_elements));
+		while (--num_elements);
+	}
+
+	for (chunk = pq->chunks; chunk; chunk = chunk->next)
+	{
+		num_elements = chunk->num_objects;
+		do
+			addFreeLink (pq, GetChunkLinkAddr (pq, chunk, num_elements));
+		while (--num_elements);
+	}
+}
+#endif /* QUEUE_TABLE */
+
 BOOLEAN
 InitQueue (QUEUE *pq, COUNT num_elements, OBJ_SIZE size)
 {
 	SetHeadLink (pq, NULL_HANDLE);
 	SetTailLink (pq, NULL_HANDLE);
+	pq->num_links = 0;
 	SetLinkSize (pq, size);
 #ifndef QUEUE_TABLE
 	return (TRUE);
 #else /* QUEUE_TABLE */
 	SetFreeList (pq, NULL_HANDLE);
+	pq->chunks = NULL;
+	pq->grow_size = 0;
+	pq->max_objects = num_elements;
+	pq->total_objects = num_elements;
+	pq->num_used = 0;
+	pq->high_water = 0;
+	pq->num_failed = 0;
 #if 0	
 	log_add (log_Debug, "InitQueue(): num_elements = %d (%d)",
 			num_elements, (BYTE)num_elements);
 #endif
 	if (AllocQueueTab (pq, num_elements) != NULL)
 	{
-		do
-			FreeLink (pq, GetLinkAddr (pq, num_elements));
-		while (--num_elements);
-
+		resetFreeList (pq);
 		return (TRUE);
 	}
 
@@ -63,9 +137,19 @@ UninitQueue (QUEUE *pq)
 #ifdef QUEUE_TABLE
 	SetHeadLink (pq, NULL_HANDLE);
 	SetTailLink (pq, NULL_HANDLE);
+	pq->num_links = 0;
 	SetFreeList (pq, NULL_HANDLE);
 	FreeQueueTab (pq);
 
+	while (pq->chunks)
+	{
+		QUEUE_CHUNK *next = pq->chunks->next;
+		HFree (pq->chunks);
+		pq->chunks = next;
+	}
+	pq->total_objects = 0;
+	pq->num_used = 0;
+
 	return (TRUE);
 #else /* !QUEUE_TABLE */
 	HLINK hLink;
@@ -87,30 +171,158 @@ ReinitQueue (QUEUE *pq)
 {
 	SetHeadLink (pq, NULL_HANDLE);
 	SetTailLink (pq, NULL_HANDLE);
+	pq->num_links = 0;
 #ifdef QUEUE_TABLE
+	resetFreeList (pq);
+#endif /* QUEUE_TABLE */
+}
+
+#ifdef QUEUE_TABLE
+void
+SetQueueGrowth (QUEUE *pq, COUNT grow_size, COUNT max_objects)
+{
+	pq->grow_size = grow_size;
+	pq->max_objects = max_objects;
+}
+
+BOOLEAN
+QueueOwnsLink (const QUEUE *pq, HLINK h)
+{
+	const QUEUE_CHUNK *chunk;
+
+	if (pq->pq_tab && (BYTE*)h >= pq->pq_tab &&
+			(BYTE*)h < pq->pq_tab + pq->object_size * pq->num_objects)
+		return TRUE;
+
+	for (chunk = pq->chunks; chunk; chunk = chunk->next)
 	{
-		COUNT num_elements;
+		const BYTE *base = (const BYTE *)(chunk + 1);
 
-		SetFreeList (pq, NULL_HANDLE);
+		if ((const BYTE*)h >= base &&
+				(const BYTE*)h < base + pq->object_size * chunk->num_objects)
+			return TRUE;
+	}
 
-		num_elements = SizeQueueTab (pq);
-		if (num_elements)
-		{
-			do
-				FreeLink (pq, GetLinkAddr (pq, num_elements));
-			while (--num_elements);
-		}
+	return FALSE;
+}
+
+static BOOLEAN
+growQueue (QUEUE *pq)
+{
+	QUEUE_CHUNK *chunk;
+	COUNT num_elements;
+
+	if (pq->total_objects >= pq->max_objects)
+		return FALSE;
+
+	num_elements = pq->grow_size;
+	if (num_elements > pq->max_objects - pq->total_objects)
+		num_elements = pq->max_objects - pq->total_objects;
+
+	chunk = HMalloc (sizeof (QUEUE_CHUNK)
+			+ (size_t)pq->object_size * num_elements);
+	if (!chunk)
+		return FALSE;
+	chunk->num_objects = num_elements;
+	chunk->next = pq->chunks;
+	pq->chunks = chunk;
+	pq->total_objects += num_elements;
+
+	do
+		addFreeLink (pq, GetChunkLinkAddr (pq, chunk, num_elements));
+	while (--num_elements);
+
+	log_add (log_Debug, "AllocLink(): queue grown to %u links",
+			pq->total_objects);
+	return TRUE;
+}
+
+// Adds all the chunks SetQueueGrowth() allows, so that from now on the
+// queue has all the links it can have, and they stay where they are
+void
+GrowQueueFully (QUEUE *pq)
+{
+	while (pq->grow_size && growQueue (pq))
+		;
+}
+
+// The size of a copy of all the links of the queue, used or free, and
+// of where its list and free list start
+size_t
+QueueCopySize (const QUEUE *pq)
+{
+	return sizeof (QUEUE) + (size_t)pq->object_size * pq->total_objects;
+}
+
+// Copies all the links of the queue, and the queue itself, to buf, the
+// table first, then the chunks in the order they are linked
+void
+CopyQueueOut (const QUEUE *pq, BYTE *buf)
+{
+	const QUEUE_CHUNK *chunk;
+	size_t size;
+
+	memcpy (buf, pq, sizeof (QUEUE));
+	buf += sizeof (QUEUE);
+
+	size = (size_t)pq->object_size * pq->num_objects;
+	memcpy (buf, pq->pq_tab, size);
+	buf += size;
+
+	for (chunk = pq->chunks; chunk; chunk = chunk->next)
+	{
+		size = (size_t)pq->object_size * chunk->num_objects;
+		memcpy (buf, chunk + 1, size);
+		buf += size;
 	}
-#endif /* QUEUE_TABLE */
 }
 
-#ifdef QUEUE_TABLE
+// Puts the queue back the way CopyQueueOut() found it. The queue must
+// still have the same links, in the same places; returns FALSE, leaving
+// the queue alone, if it does not.
+BOOLEAN
+CopyQueueIn (QUEUE *pq, const BYTE *buf)
+{
+	const QUEUE *saved = (const QUEUE *) buf;
+	QUEUE_CHUNK *chunk;
+	size_t size;
+
+	if (saved->pq_tab != pq->pq_tab || saved->chunks != pq->chunks
+			|| saved->total_objects != pq->total_objects
+			|| saved->object_size != pq->object_size)
+		return FALSE;
+	buf += sizeof (QUEUE);
+
+	size = (size_t)pq->object_size * pq->num_objects;
+	memcpy (pq->pq_tab, buf, size);
+	buf += size;
+
+	for (chunk = pq->chunks; chunk; chunk = chunk->next)
+	{
+		size = (size_t)pq->object_size * chunk->num_objects;
+		memcpy (chunk + 1, buf, size);
+		buf += size;
+	}
+
+	SetHeadLink (pq, saved->head);
+	SetTailLink (pq, saved->tail);
+	pq->num_links = saved->num_links;
+	SetFreeList (pq, saved->free_list);
+	pq->num_used = saved->num_used;
+			// The statistics are left as they are
+
+	return TRUE;
+}
+
 HLINK
 AllocLink (QUEUE *pq)
 {
 	HLINK hLink;
 
 	hLink = GetFreeList (pq);
+	if (!hLink && pq->grow_size && growQueue (pq))
+		hLink = GetFreeList (pq);
+
 	if (hLink)
 	{
 		LINK *LinkPtr;
@@ -118,9 +330,16 @@ AllocLink (QUEUE *pq)
 		LinkPtr = LockLink (pq, hLink);
 		SetFreeList (pq, _GetSuccLink (LinkPtr));
 		UnlockLink (pq, hLink);
+
+		++pq->num_used;
+		if (pq->num_used > pq->high_water)
+			pq->high_water = pq->num_used;
 	}
 	else
+	{
+		++pq->num_failed;
 		log_add (log_Debug, "AllocLink(): No more elements");
+	}
 
 	return (hLink);
 }
@@ -128,13 +347,8 @@ AllocLink (QUEUE *pq)
 void
 FreeLink (QUEUE *pq, HLINK hLink)
 {
-	LINK *LinkPtr;
-
-	LinkPtr = LockLink (pq, hLink);
-	_SetSuccLink (LinkPtr, GetFreeList (pq));
-	UnlockLink (pq, hLink);
-
-	SetFreeList (pq, hLink);
+	addFreeLink (pq, hLink);
+	--pq->num_used;
 }
 #endif /* QUEUE_TABLE */
 
@@ -162,6 +376,7 @@ PutQueue (QUEUE *pq, HLINK hLink)
 	UnlockLink (pq, hLink);
 
 	SetTailLink (pq, hLink);
+	++pq->num_links;
 }
 
 void
@@ -194,6 +409,7 @@ InsertQueue (QUEUE *pq, HLINK hLink, HLINK hRefLink)
 		}
 		UnlockLink (pq, hRefLink);
 		UnlockLink (pq, hLink);
+		++pq->num_links;
 	}
 }
 
@@ -233,27 +449,7 @@ RemoveQueue (QUEUE *pq, HLINK hLink)
 		UnlockLink (pq, hSuccLink);
 	}
 	UnlockLink (pq, hLink);
-}
-
-COUNT
-CountLinks (QUEUE *pq)
-{
-	COUNT LinkCount;
-	HLINK hLink, hNextLink;
-
-	LinkCount = 0;
-	for (hLink = GetHeadLink (pq); hLink; hLink = hNextLink)
-	{
-		LINK *LinkPtr;
-
-		++LinkCount;
-
-		LinkPtr = LockLink (pq, hLink);
-		hNextLink = _GetSuccLink (LinkPtr);
-		UnlockLink (pq, hLink);
-	}
-
-	return (LinkCount);
+	--pq->num_links;
 }
 
 void
@@ -36,6 +36,15 @@ extern "C" {
 // code works now.
 #define QUEUE_TABLE
 
+// With QUEUE_TABLE_COMPACT, AllocLink() always hands out the free link
+// lowest in the table, instead of the one most recently freed.  The
+// live links then stay packed at the start of the table, and in a
+// queue that is appended to (like the battle display list) the list
+// order stays close to the table order, so walking it every frame
+// mostly reads memory front to back.  This costs a scan of the free
+// list in FreeLink().
+#define QUEUE_TABLE_COMPACT
+
 typedef void* QUEUE_HANDLE;
 
 typedef UWORD OBJ_SIZE;
@@ -49,13 +58,37 @@ typedef struct link
 	HLINK succ;
 } LINK;
 
+#ifdef QUEUE_TABLE
+// Extra block of links, added by AllocLink() to a queue that may grow
+// once its table is used up.  The links follow the header.
+typedef struct queue_chunk
+{
+	struct queue_chunk *next;
+	COUNT num_objects;
+} QUEUE_CHUNK;
+#endif /* QUEUE_TABLE */
+
 typedef struct /* queue */
 {
 	HLINK head;
 	HLINK tail;
+	COUNT num_links;
+			// Links in the list, so that CountLinks() need not walk it
 #ifdef QUEUE_TABLE
 	BYTE  *pq_tab;
 	HLINK free_list;
+	QUEUE_CHUNK *chunks;
+	COUNT grow_size;
+			// Links per extra chunk; 0 if the queue cannot grow
+	COUNT max_objects;
+			// Limit on the links in the table and chunks together
+	COUNT total_objects;
+			// Links in the table and chunks together
+	COUNT num_used;
+	COUNT high_water;
+			// Largest num_used since the queue was initialised
+	COUNT num_failed;
+			// AllocLink() calls that found no free link
 #endif
 	COUNT object_size;
 #ifdef QUEUE_TABLE
@@ -67,14 +100,25 @@ typedef struct /* queue */
 
 extern HLINK AllocLink (QUEUE *pq);
 extern void FreeLink (QUEUE *pq, HLINK hLink);
+// Lets AllocLink() add chunks of 'grow_size' links when the queue runs
+// out of free links, up to 'max_objects' links in total.  The chunks
+// are kept until UninitQueue(), so a queue only needs to grow once.
+extern void SetQueueGrowth (QUEUE *pq, COUNT grow_size, COUNT max_objects);
+extern BOOLEAN QueueOwnsLink (const QUEUE *pq, HLINK h);
+// For taking copies of a queue and putting them back, a memcpy() per
+// block of links. The links must stay where they are in between, so
+// grow the queue fully first if it may grow.
+extern void GrowQueueFully (QUEUE *pq);
+extern size_t QueueCopySize (const QUEUE *pq);
+extern void CopyQueueOut (const QUEUE *pq, BYTE *buf);
+extern BOOLEAN CopyQueueIn (QUEUE *pq, const BYTE *buf);
 
 static inline LINK *
 LockLink (const QUEUE *pq, HLINK h)
 {
 	if (h) // Apparently, h==0 is OK
 	{	// Make sure the link is actually in our queue!
-		assert (pq->pq_tab && (BYTE*)h >= pq->pq_tab &&
-				(BYTE*)h < pq->pq_tab + pq->object_size * pq->num_objects);
+		assert (QueueOwnsLink (pq, h));
 	}
 	return (LINK*)h;
 }
@@ -84,8 +128,7 @@ UnlockLink (const QUEUE *pq, HLINK h)
 {
 	if (h) // Apparently, h==0 is OK
 	{	// Make sure the link is actually in our queue!
-		assert (pq->pq_tab && (BYTE*)h >= pq->pq_tab &&
-				(BYTE*)h < pq->pq_tab + pq->object_size * pq->num_objects);
+		assert (QueueOwnsLink (pq, h));
 	}
 }
 
@@ -97,6 +140,12 @@ UnlockLink (const QUEUE *pq, HLINK h)
 #define FreeQueueTab(pq) HFree ((pq)->pq_tab); (pq)->pq_tab = NULL
 #define SizeQueueTab(pq) (COUNT)((pq)->num_objects)
 #define GetLinkAddr(pq,i) (HLINK)((pq)->pq_tab + ((pq)->object_size * ((i) - 1)))
+#define GetChunkLinkAddr(pq,c,i) \
+		(HLINK)((BYTE *)((c) + 1) + ((pq)->object_size * ((i) - 1)))
+#define QueueSize(pq) ((pq)->total_objects)
+#define QueueUsage(pq) ((pq)->num_used)
+#define QueueHighWater(pq) ((pq)->high_water)
+#define QueueFailures(pq) ((pq)->num_failed)
 #else /* !QUEUE_TABLE */
 #define AllocLink(pq)     (HLINK)HMalloc ((pq)->object_size)
 #define LockLink(pq, h)   ((LINK*)(h))
@@ -121,7 +170,7 @@ extern void ReinitQueue (QUEUE *pq);
 extern void PutQueue (QUEUE *pq, HLINK hLink);
 extern void InsertQueue (QUEUE *pq, HLINK hLink, HLINK hRefLink);
 extern void RemoveQueue (QUEUE *pq, HLINK hLink);
-extern COUNT CountLinks (QUEUE *pq);
+#define CountLinks(pq) ((COUNT)(pq)->num_links)
 void ForAllLinks(QUEUE *pq, void (*callback)(LINK *, void *), void *arg);
 
 #if defined(__cplusplus)
@@ -24,6 +24,8 @@
 #include "velocity.h"
 #include "libs/gfxlib.h"
 
+#include <stddef.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -101,23 +103,22 @@ typedef void (ElementCollisionFunc) (ELEMENT *ElementPtr0, POINT *pPt0,
 			ELEMENT *ElementPtr1, POINT *pPt1);
 
 // Any physical object in the simulation.
+// The fields are ordered by how often they are used: everything the
+// queue walks of every frame (PreProcessQueue(), ProcessCollisions(),
+// the netplay checksum) read comes first, and what is only used when
+// something happens to the element comes last. See the asserts below.
 struct element
 {
 	// LINK elements; must be first
 	HELEMENT pred, succ;
 
-	ElementProcessFunc *preprocess_func;
-	ElementProcessFunc *postprocess_func;
-	ElementCollisionFunc *collision_func;
-	ElementProcessFunc *death_func;
-
+	ELEMENT_FLAGS state_flags;
 	// Player this element belongs to
 	// -1: neutral (planets, asteroids, crew, etc.)
 	//  0: Melee: bottom player; Full-game: the human player
 	//  1: Melee: top player;    Full-game: the NPC opponent
 	SIZE playerNr;
 
-	ELEMENT_FLAGS state_flags;
 	union
 	{
 		COUNT life_span;
@@ -158,15 +159,37 @@ struct element
 			//        to cycle the ship color when fleeing.
 
 	VELOCITY_DESC velocity;
-	INTERSECT_CONTROL IntersectControl;
 	COUNT PrimIndex;
 	STATE current, next;
+	INTERSECT_CONTROL IntersectControl;
+
+	ElementProcessFunc *preprocess_func;
+	ElementProcessFunc *postprocess_func;
+	ElementCollisionFunc *collision_func;
+
+	// Rarely used from here on
+	ElementProcessFunc *death_func;
 
 	void *pParent;
 			// The ship this element belongs to.
 	HELEMENT hTarget;
 };
 
+// Fails to compile ("negative subscript") if the per-frame fields of
+// ELEMENT no longer fit in its first two cache lines
+#define ELEMENT_LAYOUT_ASSERT(name, x) \
+	typedef int element_layout_##name [(x) * 2 - 1]
+
+ELEMENT_LAYOUT_ASSERT (checksum,
+		offsetof (ELEMENT, next.location) + sizeof (POINT) <= 128);
+ELEMENT_LAYOUT_ASSERT (collision,
+		offsetof (ELEMENT, IntersectControl) + sizeof (INTERSECT_CONTROL)
+		<= 128);
+ELEMENT_LAYOUT_ASSERT (preprocess,
+		offsetof (ELEMENT, preprocess_func) < 128);
+
+#undef ELEMENT_LAYOUT_ASSERT
+
 #define NEUTRAL_PLAYER_NUM  -1
 
 static inline BOOLEAN
@@ -179,8 +202,13 @@ extern QUEUE disp_q;
 // The maximum number of elements is chosen to provide a slight margin.
 // Currently, it is maximum *known used* in Melee + 30
 #define MAX_DISPLAY_ELEMENTS 150
+// When those are all in use, disp_q grows by this many elements at a
+// time, up to MAX_GROWN_DISPLAY_ELEMENTS, instead of dropping new ones
+#define DISPLAY_ELEMENTS_CHUNK 30
+#define MAX_GROWN_DISPLAY_ELEMENTS 300
 
-#define MAX_DISPLAY_PRIMS 330
+// One prim per element, plus the 180 background stars of galaxy.c
+#define MAX_DISPLAY_PRIMS (180 + MAX_GROWN_DISPLAY_ELEMENTS)
 extern COUNT DisplayFreeList;
 extern PRIMITIVE DisplayArray[MAX_DISPLAY_PRIMS];
 
@@ -205,6 +233,9 @@ extern PRIMITIVE DisplayArray[MAX_DISPLAY_PRIMS];
 #define UNDEFINED_LEVEL 0
 
 extern HELEMENT AllocElement (void);
+// Starts the new element as a copy of 'Template' instead of all zeros.
+// The links and PrimIndex of the template are not used.
+extern HELEMENT AllocElementFrom (const ELEMENT *Template);
 extern void FreeElement (HELEMENT hElement);
 #define PutElement(h) PutQueue (&disp_q, h)
 #define InsertElement(h,i) InsertQueue (&disp_q, h, i)
@@ -429,6 +429,19 @@ Flash_setRect (FlashContext *context, const RECT *rect)
 {
 	assert(context->type == FlashType_highlight);
 
+	if (context->started && rect->corner.x == context->rect.corner.x
+			&& rect->corner.y == context->rect.corner.y
+			&& rect->extent.width == context->rect.extent.width
+			&& rect->extent.height == context->rect.extent.height)
+	{
+		// Restoring the original and grabbing it again would give the
+		// same original, and the same frames in the cache, so only the
+		// current frame needs drawing again.
+		context->lastFrameIndex = (COUNT) -1;
+		Flash_drawCurrentFrame (context);
+		return;
+	}
+
 	if (context->started)
 	{
 		Flash_drawFrame (context, context->original);
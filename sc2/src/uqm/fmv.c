@@ -29,6 +29,7 @@
 #include "libs/vidlib.h"
 #include "libs/graphics/gfx_common.h"
 #include "libs/inplib.h"
+#include "libs/time/bootprof.h"
 
 void
 DoShipSpin (COUNT index, MUSIC_REF hMusic)
@@ -81,9 +82,11 @@ SplashScreen (void (* DoProcessing)(DWORD TimeOut))
 	SleepThreadUntil (FadeScreen (FadeAllToBlack, ONE_SECOND / 120));
 	SetContext (ScreenContext);
 	s.origin.x = s.origin.y = 0;
+	BOOT_BEGIN (BOOT_SPLASH);
 	s.frame = CaptureDrawable (LoadGraphic (TITLE_ANIM));
 	DrawStamp (&s);
 	DestroyDrawable (ReleaseDrawable (s.frame));
+	BOOT_END (BOOT_SPLASH);
 
 	TimeOut = FadeScreen (FadeAllToColor, ONE_SECOND / 2);
 
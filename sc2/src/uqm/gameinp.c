@@ -33,6 +33,7 @@
 #include "libs/timelib.h"
 #include "libs/threadlib.h"
 #include "libs/graphics/gfx_common.h"
+#include "libs/log.h"
 #include <stdio.h>
 
 #ifdef RUST_OWNS_MAIN
@@ -85,6 +86,10 @@ volatile BOOLEAN GamePaused;
 
 static InputFrameCallback *inputCallback;
 
+static DWORD edgesTaken, edgesLatched;
+static TimePeriod edgeDelayTotal, edgeDelayWorst;
+		// From the event being pumped to the game seeing it
+
 static void
 _clear_menu_state (void)
 {
@@ -236,6 +241,58 @@ _check_gestalt (DWORD NewTime)
 	}
 }
 
+// A key pressed since the last frame counts as down for this frame,
+// even if it has been released already. VControl's start bit does that
+// too, but loses presses that come between reading ImmediateInputState
+// and BeginInputFrame().
+static void
+_take_input_edges (TimeCount now)
+{
+	TFB_InputEdge edge;
+
+	while (TFB_GetInputEdge (&edge))
+	{
+		TimePeriod delay = now - edge.time;
+		int *key;
+
+		if (!edge.pressed || edge.templat >= NUM_TEMPLATES
+				|| edge.control >= NUM_KEYS)
+			continue;
+
+		++edgesTaken;
+		edgeDelayTotal += delay;
+		if (delay > edgeDelayWorst)
+			edgeDelayWorst = delay;
+
+		key = &CurrentInputState.key[edge.templat][edge.control];
+		if (*key == 0)
+		{
+			++edgesLatched;
+			*key = 1;
+			CachedInputState.key[edge.templat][edge.control] = 1;
+		}
+	}
+}
+
+void
+ReportInputLatency (const char *what)
+{
+	if (what != NULL && edgesTaken != 0)
+	{
+		log_add (log_Info, "%s: %lu key presses seen %lu ms after the "
+				"event on average, %lu ms at worst; %lu were released "
+				"before the frame", what, (unsigned long) edgesTaken,
+				(unsigned long) (edgeDelayTotal * 1000 / ONE_SECOND
+				/ edgesTaken),
+				(unsigned long) (edgeDelayWorst * 1000 / ONE_SECOND),
+				(unsigned long) edgesLatched);
+	}
+	edgesTaken = 0;
+	edgesLatched = 0;
+	edgeDelayTotal = 0;
+	edgeDelayWorst = 0;
+}
+
 void
 UpdateInputState (void)
 {
@@ -261,6 +318,7 @@ UpdateInputState (void)
 	CachedInputState = ImmediateInputState;
 	BeginInputFrame ();
 	NewTime = GetTimeCounter ();
+	_take_input_edges (NewTime);
 	if (_gestalt_keys)
 	{
 		_check_gestalt (NewTime);
@@ -38,10 +38,11 @@
 
 extern FRAME PlayFrame;
 
-#define MAX_SAVED_GAMES 50
 #define SUMMARY_X_OFFS 14
 #define SUMMARY_SIDE_OFFS 7
 #define SAVES_PER_PAGE 5
+#define SUMMARY_CACHE_SIZE (SAVES_PER_PAGE * 2)
+		// Summaries kept as drawn, for going back to a slot
 
 #define MAX_NAME_SIZE  SIS_NAME_SIZE
 
@@ -615,6 +616,15 @@ SettingsMenu (void)
 	DrawStatusMessage (NULL);
 }
 
+typedef struct
+{
+	COUNT gameIndex;
+	STAMP space;
+			// The whole SpaceContext; NULL frame when the entry is free
+	STAMP status;
+			// The part of the StatusContext the summary draws to
+} SUMMARY_CACHE;
+
 typedef struct
 {
 	SUMMARY_DESC summary[MAX_SAVED_GAMES];
@@ -623,9 +633,114 @@ typedef struct
 	BOOLEAN success;
 			// TRUE when load/save succeeded
 	FRAME SummaryFrame;
+	SUMMARY_CACHE cache[SUMMARY_CACHE_SIZE];
+	COUNT nextCache;
+			// The entry to reuse when all are taken
 
 } PICK_GAME_STATE;
 
+// The StatusContext clip rect the summary draws the SIS display with
+static void
+GetSummaryStatusRect (RECT *r)
+{
+	r->corner.x = SIS_ORG_X + ((SIS_SCREEN_WIDTH - STATUS_WIDTH) >> 1) +
+			SAFE_X - 16 + SUMMARY_X_OFFS;
+	r->corner.y = SIS_ORG_Y;
+	r->extent.width = STATUS_WIDTH;
+	r->extent.height = STATUS_HEIGHT;
+}
+
+static void
+FreeCachedSummary (SUMMARY_CACHE *entry)
+{
+	DestroyDrawable (ReleaseDrawable (entry->space.frame));
+	DestroyDrawable (ReleaseDrawable (entry->status.frame));
+	entry->space.frame = NULL;
+	entry->status.frame = NULL;
+}
+
+static void
+FreeCachedSummaries (PICK_GAME_STATE *pickState)
+{
+	COUNT i;
+
+	for (i = 0; i < SUMMARY_CACHE_SIZE; ++i)
+		FreeCachedSummary (&pickState->cache[i]);
+	pickState->nextCache = 0;
+}
+
+static SUMMARY_CACHE *
+FindCachedSummary (PICK_GAME_STATE *pickState, COUNT gameIndex)
+{
+	COUNT i;
+
+	for (i = 0; i < SUMMARY_CACHE_SIZE; ++i)
+	{
+		SUMMARY_CACHE *entry = &pickState->cache[i];
+		if (entry->space.frame && entry->gameIndex == gameIndex)
+			return entry;
+	}
+	return NULL;
+}
+
+// Keeps the summary of 'gameIndex', which is on the screen now, to draw
+// it again with DrawCachedSummary(). Called with SpaceContext set.
+// What is captured also has the slot list, which is drawn over anyway.
+static void
+CacheSummary (PICK_GAME_STATE *pickState, COUNT gameIndex)
+{
+	SUMMARY_CACHE *entry;
+	CONTEXT OldContext;
+	RECT OldRect;
+	RECT r;
+
+	if (FindCachedSummary (pickState, gameIndex))
+		return;
+
+	entry = &pickState->cache[pickState->nextCache];
+	pickState->nextCache = (pickState->nextCache + 1) % SUMMARY_CACHE_SIZE;
+	FreeCachedSummary (entry);
+
+	entry->space = SaveContextFrame (NULL);
+
+	OldContext = SetContext (StatusContext);
+	GetContextClipRect (&OldRect);
+	GetSummaryStatusRect (&r);
+	SetContextClipRect (&r);
+	entry->status = SaveContextFrame (NULL);
+	SetContextClipRect (&OldRect);
+	SetContext (OldContext);
+
+	if (!entry->space.frame || !entry->status.frame)
+		FreeCachedSummary (entry);
+	else
+		entry->gameIndex = gameIndex;
+}
+
+static BOOLEAN
+DrawCachedSummary (PICK_GAME_STATE *pickState, COUNT gameIndex)
+{
+	SUMMARY_CACHE *entry = FindCachedSummary (pickState, gameIndex);
+	CONTEXT OldContext;
+	RECT OldRect;
+	RECT r;
+
+	if (!entry)
+		return FALSE;
+
+	DrawStamp (&entry->space);
+
+	OldContext = SetContext (StatusContext);
+	GetContextClipRect (&OldRect);
+	GetSummaryStatusRect (&r);
+	SetContextClipRect (&r);
+	DrawStamp (&entry->status);
+	SetContextClipRect (&OldRect);
+	SetContext (OldContext);
+
+	return TRUE;
+}
+
 static void
 DrawBlankSavegameDisplay (PICK_GAME_STATE *pickState)
 {
@@ -765,12 +880,7 @@ DrawSavegameSummary (PICK_GAME_STATE *pickState, COUNT gameIndex)
 		OldContext = SetContext (StatusContext);
 		// Hack StatusContext so we can use standard SIS display funcs
 		GetContextClipRect (&OldRect);
-		r.corner.x = SIS_ORG_X + ((SIS_SCREEN_WIDTH - STATUS_WIDTH) >> 1) +
-				SAFE_X - 16 + SUMMARY_X_OFFS;
-//		r.corner.x = SIS_ORG_X + ((SIS_SCREEN_WIDTH - STATUS_WIDTH) >> 1);
-		r.corner.y = SIS_ORG_Y;
-		r.extent.width = STATUS_WIDTH;
-		r.extent.height = STATUS_HEIGHT;
+		GetSummaryStatusRect (&r);
 		SetContextClipRect (&r);
 
 		// Hack the states so that we can use standard SIS display funcs
@@ -1012,8 +1122,11 @@ static void
 RedrawPickDisplay (PICK_GAME_STATE *pickState, COUNT selSlot)
 {
 	BatchGraphics ();
-	DrawBlankSavegameDisplay (pickState);
-	DrawSavegameSummary (pickState, selSlot);
+	if (!DrawCachedSummary (pickState, selSlot))
+	{
+		DrawBlankSavegameDisplay (pickState);
+		DrawSavegameSummary (pickState, selSlot);
+	}
 	DrawGameSelection (pickState, selSlot);
 	UnbatchGraphics ();
 }
@@ -1021,13 +1134,7 @@ RedrawPickDisplay (PICK_GAME_STATE *pickState, COUNT selSlot)
 static void
 LoadGameDescriptions (SUMMARY_DESC *pSD)
 {
-	COUNT i;
-
-	for (i = 0; i < MAX_SAVED_GAMES; ++i, ++pSD)
-	{
-		if (!LoadGame (i, pSD))
-			pSD->year_index = 0;
-	}
+	LoadGameSummaries (pSD);
 }
 
 static BOOLEAN
@@ -1097,8 +1204,11 @@ DoPickGame (MENU_STATE *pMS)
 
 		if (NewState != pMS->CurState)
 		{
-			pMS->CurState = NewState;
 			SetContext (SpaceContext);
+			// Keep the summary being left, now that it is complete on
+			// the screen
+			CacheSummary (pickState, pMS->CurState);
+			pMS->CurState = NewState;
 			RedrawPickDisplay (pickState, pMS->CurState);
 		}
 
@@ -1240,6 +1350,7 @@ PickGame (BOOLEAN saving, BOOLEAN fromMainMenu)
 
 		// reload and redraw everything
 		LoadGameDescriptions (pickState.summary);
+		FreeCachedSummaries (&pickState);
 		RedrawPickDisplay (&pickState, MenuState.CurState);
 	}
 
@@ -1261,6 +1372,7 @@ PickGame (BOOLEAN saving, BOOLEAN fromMainMenu)
 	}
 
 	DestroyDrawable (ReleaseDrawable (DlgStamp.frame));
+	FreeCachedSummaries (&pickState);
 
 	SetContext (OldContext);
 
@@ -23,15 +23,30 @@
 
 //#define DEBUG_GRAVITY
 
+// Where the element is for the gravity pass: its next location once it
+// has been preprocessed this frame, else its current one
+static inline const POINT *
+gravityLocation (const ELEMENT *ElementPtr, BOOLEAN next)
+{
+	return next ? &ElementPtr->next.location : &ElementPtr->current.location;
+}
+
 BOOLEAN
 CalculateGravity (ELEMENT *ElementPtr)
 {
-	BOOLEAN retval, HasGravity;
+	BOOLEAN retval, HasGravity, UseNext;
 	HELEMENT hTestElement, hSuccElement;
+	POINT srcPt;
+	const DWORD thresholdSquared =
+			(DWORD)(GRAVITY_THRESHOLD * GRAVITY_THRESHOLD);
 
 	retval = FALSE;
 	HasGravity = (BOOLEAN)(CollidingElement (ElementPtr)
 			&& GRAVITY_MASS (ElementPtr->mass_points + 1));
+	// The same for every element tested
+	UseNext = (ElementPtr->state_flags & PRE_PROCESS) != 0;
+	srcPt = *gravityLocation (ElementPtr, UseNext);
+
 	for (hTestElement = GetHeadElement ();
 			hTestElement != 0; hTestElement = hSuccElement)
 	{
@@ -39,28 +54,19 @@ CalculateGravity (ELEMENT *ElementPtr)
 		ELEMENT *TestElementPtr;
 
 		LockElement (hTestElement, &TestElementPtr);
+		hSuccElement = GetSuccElement (TestElementPtr);
 		if (TestElementPtr != ElementPtr
 				&& CollidingElement (TestElementPtr)
 				&& (TestHasGravity =
 				GRAVITY_MASS (TestElementPtr->mass_points + 1)) != HasGravity)
 		{
+			const POINT *testPt = gravityLocation (TestElementPtr, UseNext);
 			COUNT abs_dx, abs_dy;
 			SIZE dx, dy;
+			DWORD dist_squared;
 
-			if (!(ElementPtr->state_flags & PRE_PROCESS))
-			{
-				dx = ElementPtr->current.location.x
-						- TestElementPtr->current.location.x;
-				dy = ElementPtr->current.location.y
-						- TestElementPtr->current.location.y;
-			}
-			else
-			{
-				dx = ElementPtr->next.location.x
-						- TestElementPtr->next.location.x;
-				dy = ElementPtr->next.location.y
-						- TestElementPtr->next.location.y;
-			}
+			dx = srcPt.x - testPt->x;
+			dy = srcPt.y - testPt->y;
 #ifdef DEBUG_GRAVITY
 			if (TestElementPtr->state_flags & PLAYER_SHIP)
 			{
@@ -83,65 +89,66 @@ CalculateGravity (ELEMENT *ElementPtr)
 				log_add (log_Debug, "\tdisplay_dx = %d, display_dy = %d",
 						abs_dx, abs_dy);
 #endif /* DEBUG_GRAVITY */
-			if (abs_dx <= GRAVITY_THRESHOLD
-					&& abs_dy <= GRAVITY_THRESHOLD)
+			// Most elements are well away from the well; the square is
+			// only needed for the ones inside the bounding box
+			if (abs_dx > GRAVITY_THRESHOLD || abs_dy > GRAVITY_THRESHOLD)
 			{
-				DWORD dist_squared;
+				UnlockElement (hTestElement);
+				continue;
+			}
 
-				dist_squared = (DWORD)(abs_dx * abs_dx)
-						+ (DWORD)(abs_dy * abs_dy);
-				if (dist_squared <= (DWORD)(GRAVITY_THRESHOLD
-						* GRAVITY_THRESHOLD))
-				{
+			dist_squared = (DWORD)(abs_dx * abs_dx)
+					+ (DWORD)(abs_dy * abs_dy);
+#ifdef DEBUG_GRAVITY
+			if (TestElementPtr->state_flags & PLAYER_SHIP)
+				log_add (log_Debug, "dist_squared = %lu",
+						(unsigned long) dist_squared);
+#endif /* DEBUG_GRAVITY */
+			if (dist_squared <= thresholdSquared)
+			{
 #ifdef NEVER
-					COUNT magnitude;
+				COUNT magnitude;
 
 #define DIFUSE_GRAVITY 175
-					dist_squared += (DWORD)abs_dx * (DIFUSE_GRAVITY << 1)
-							+ (DWORD)abs_dy * (DIFUSE_GRAVITY << 1)
-							+ ((DWORD)(DIFUSE_GRAVITY * DIFUSE_GRAVITY) << 1);
-					if ((magnitude = (COUNT)((DWORD)(GRAVITY_THRESHOLD
-							* GRAVITY_THRESHOLD) / dist_squared)) == 0)
-						magnitude = 1;
+				dist_squared += (DWORD)abs_dx * (DIFUSE_GRAVITY << 1)
+						+ (DWORD)abs_dy * (DIFUSE_GRAVITY << 1)
+						+ ((DWORD)(DIFUSE_GRAVITY * DIFUSE_GRAVITY) << 1);
+				if ((magnitude = (COUNT)((DWORD)(GRAVITY_THRESHOLD
+						* GRAVITY_THRESHOLD) / dist_squared)) == 0)
+					magnitude = 1;
 
 #define MAX_MAGNITUDE 6
-					else if (magnitude > MAX_MAGNITUDE)
-						magnitude = MAX_MAGNITUDE;
-					log_add (log_Debug, "magnitude = %u", magnitude);
+				else if (magnitude > MAX_MAGNITUDE)
+					magnitude = MAX_MAGNITUDE;
+				log_add (log_Debug, "magnitude = %u", magnitude);
 #endif /* NEVER */
 
-#ifdef DEBUG_GRAVITY
+				if (TestHasGravity)
+				{
+					retval = TRUE;
+					UnlockElement (hTestElement);
+					break;
+				}
+				else
+				{
+					COUNT angle;
+
+					angle = ARCTAN (dx, dy);
+					DeltaVelocityComponents (&TestElementPtr->velocity,
+							COSINE (angle, WORLD_TO_VELOCITY (1)),
+							SINE (angle, WORLD_TO_VELOCITY (1)));
 					if (TestElementPtr->state_flags & PLAYER_SHIP)
-						log_add (log_Debug, "dist_squared = %lu", dist_squared);
-#endif /* DEBUG_GRAVITY */
-					if (TestHasGravity)
-					{
-						retval = TRUE;
-						UnlockElement (hTestElement);
-						break;
-					}
-					else
 					{
-						COUNT angle;
-
-						angle = ARCTAN (dx, dy);
-						DeltaVelocityComponents (&TestElementPtr->velocity,
-								COSINE (angle, WORLD_TO_VELOCITY (1)),
-								SINE (angle, WORLD_TO_VELOCITY (1)));
-						if (TestElementPtr->state_flags & PLAYER_SHIP)
-						{
-							STARSHIP *StarShipPtr;
-
-							GetElementStarShip (TestElementPtr, &StarShipPtr);
-							StarShipPtr->cur_status_flags &= ~SHIP_AT_MAX_SPEED;
-							StarShipPtr->cur_status_flags |= SHIP_IN_GRAVITY_WELL;
-						}
+						STARSHIP *StarShipPtr;
+
+						GetElementStarShip (TestElementPtr, &StarShipPtr);
+						StarShipPtr->cur_status_flags &= ~SHIP_AT_MAX_SPEED;
+						StarShipPtr->cur_status_flags |= SHIP_IN_GRAVITY_WELL;
 					}
 				}
 			}
 		}
 
-		hSuccElement = GetSuccElement (TestElementPtr);
 		UnlockElement (hTestElement);
 	}
 
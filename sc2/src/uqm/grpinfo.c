@@ -27,6 +27,7 @@
 
 #include "libs/mathlib.h"
 #include "libs/log.h"
+#include <string.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -35,112 +36,165 @@
 static BYTE LastEncGroup;
 		// Last encountered group, saved into state files
 
+static void FlushGroupInfo (GROUP_HEADER* pGH, DWORD offset,
+		BYTE which_group, GAME_STATE_FILE *fp);
+
+// The records are read and written whole, one call to ReadStateFile() or
+// WriteStateFile() each, rather than a field at a time. The fields are
+// stored as sread_16() and friends would, in host byte order.
+#define GROUP_HEADER_SIZE  (8 + 4 * (NUM_SAVED_BATTLE_GROUPS + 1))
+#define GROUP_RECORD_SIZE  16
+		// Of a SHIP_FRAGMENT or an IP_GROUP
+
+static UWORD
+getRecord16 (const BYTE *rec)
+{
+	UWORD v;
+	memcpy (&v, rec, sizeof (v));
+	return v;
+}
+
+static void
+putRecord16 (BYTE *rec, UWORD v)
+{
+	memcpy (rec, &v, sizeof (v));
+}
+
+static DWORD
+getRecord32 (const BYTE *rec)
+{
+	DWORD v;
+	memcpy (&v, rec, sizeof (v));
+	return v;
+}
+
+static void
+putRecord32 (BYTE *rec, DWORD v)
+{
+	memcpy (rec, &v, sizeof (v));
+}
+
+// Fills in the record from fp; what is not there reads as 0
+static void
+readRecord (GAME_STATE_FILE *fp, BYTE *rec, COUNT size)
+{
+	COUNT got = ReadStateFile (rec, 1, size, fp);
+	if (got < size)
+		memset (rec + got, 0, size - got);
+}
+
 void
 ReadGroupHeader (GAME_STATE_FILE *fp, GROUP_HEADER *pGH)
 {
-	sread_8   (fp, &pGH->NumGroups);
-	sread_8   (fp, &pGH->day_index);
-	sread_8   (fp, &pGH->month_index);
-	sread_8   (fp, NULL); /* padding */
-	sread_16  (fp, &pGH->star_index);
-	sread_16  (fp, &pGH->year_index);
-	sread_a32 (fp, pGH->GroupOffset, NUM_SAVED_BATTLE_GROUPS + 1);
+	BYTE rec[GROUP_HEADER_SIZE];
+	COUNT i;
+
+	readRecord (fp, rec, sizeof rec);
+	pGH->NumGroups = rec[0];
+	pGH->day_index = rec[1];
+	pGH->month_index = rec[2];
+	/* rec[3] is padding */
+	pGH->star_index = getRecord16 (rec + 4);
+	pGH->year_index = getRecord16 (rec + 6);
+	for (i = 0; i <= NUM_SAVED_BATTLE_GROUPS; ++i)
+		pGH->GroupOffset[i] = getRecord32 (rec + 8 + 4 * i);
 }
 
 void
 WriteGroupHeader (GAME_STATE_FILE *fp, const GROUP_HEADER *pGH)
 {
-	swrite_8   (fp, pGH->NumGroups);
-	swrite_8   (fp, pGH->day_index);
-	swrite_8   (fp, pGH->month_index);
-	swrite_8   (fp, 0); /* padding */
-	swrite_16  (fp, pGH->star_index);
-	swrite_16  (fp, pGH->year_index);
-	swrite_a32 (fp, pGH->GroupOffset, NUM_SAVED_BATTLE_GROUPS + 1);
+	BYTE rec[GROUP_HEADER_SIZE];
+	COUNT i;
+
+	rec[0] = pGH->NumGroups;
+	rec[1] = pGH->day_index;
+	rec[2] = pGH->month_index;
+	rec[3] = 0; /* padding */
+	putRecord16 (rec + 4, pGH->star_index);
+	putRecord16 (rec + 6, pGH->year_index);
+	for (i = 0; i <= NUM_SAVED_BATTLE_GROUPS; ++i)
+		putRecord32 (rec + 8 + 4 * i, pGH->GroupOffset[i]);
+	WriteStateFile (rec, 1, sizeof rec, fp);
 }
 
 void
 ReadShipFragment (GAME_STATE_FILE *fp, SHIP_FRAGMENT *FragPtr)
 {
-	BYTE tmpb;
-
-	sread_16 (fp, NULL); /* unused: was which_side */
-	sread_8  (fp, &FragPtr->captains_name_index);
-	sread_8  (fp, NULL); /* padding; for savegame compat */
-	sread_16 (fp, NULL); /* unused: was ship_flags */
-	sread_8  (fp, &FragPtr->race_id);
-	sread_8  (fp, &FragPtr->index);
+	BYTE rec[GROUP_RECORD_SIZE];
+
+	readRecord (fp, rec, sizeof rec);
+	/* rec[0..1] unused: was which_side */
+	FragPtr->captains_name_index = rec[2];
+	/* rec[3] padding; for savegame compat */
+	/* rec[4..5] unused: was ship_flags */
+	FragPtr->race_id = rec[6];
+	FragPtr->index = rec[7];
 	// XXX: reading crew as BYTE to maintain savegame compatibility
-	sread_8  (fp, &tmpb);
-	FragPtr->crew_level = tmpb;
-	sread_8  (fp, &tmpb);
-	FragPtr->max_crew = tmpb;
-	sread_8  (fp, &FragPtr->energy_level);
-	sread_8  (fp, &FragPtr->max_energy);
-	sread_16 (fp, NULL); /* unused; was loc.x */
-	sread_16 (fp, NULL); /* unused; was loc.y */
+	FragPtr->crew_level = rec[8];
+	FragPtr->max_crew = rec[9];
+	FragPtr->energy_level = rec[10];
+	FragPtr->max_energy = rec[11];
+	/* rec[12..15] unused; was loc */
 }
 
 void
 WriteShipFragment (GAME_STATE_FILE *fp, const SHIP_FRAGMENT *FragPtr)
 {
-	swrite_16 (fp, 0); /* unused: was which_side */
-	swrite_8  (fp, FragPtr->captains_name_index);
-	swrite_8  (fp, 0); /* padding; for savegame compat */
-	swrite_16 (fp, 0); /* unused: was ship_flags */
-	swrite_8  (fp, FragPtr->race_id);
-	swrite_8  (fp, FragPtr->index);
+	BYTE rec[GROUP_RECORD_SIZE];
+
+	memset (rec, 0, sizeof rec);
+	rec[2] = FragPtr->captains_name_index;
+	rec[6] = FragPtr->race_id;
+	rec[7] = FragPtr->index;
 	// XXX: writing crew as BYTE to maintain savegame compatibility
-	swrite_8  (fp, FragPtr->crew_level);
-	swrite_8  (fp, FragPtr->max_crew);
-	swrite_8  (fp, FragPtr->energy_level);
-	swrite_8  (fp, FragPtr->max_energy);
-	swrite_16 (fp, 0); /* unused; was loc.x */
-	swrite_16 (fp, 0); /* unused; was loc.y */
+	rec[8] = (BYTE) FragPtr->crew_level;
+	rec[9] = (BYTE) FragPtr->max_crew;
+	rec[10] = FragPtr->energy_level;
+	rec[11] = FragPtr->max_energy;
+	WriteStateFile (rec, 1, sizeof rec, fp);
 }
 
 void
 ReadIpGroup (GAME_STATE_FILE *fp, IP_GROUP *GroupPtr)
 {
-	BYTE tmpb;
-
-	sread_16 (fp, NULL); /* unused; was which_side */
-	sread_8  (fp, NULL); /* unused; was captains_name_index */
-	sread_8  (fp, NULL); /* padding; for savegame compat */
-	sread_16 (fp, &GroupPtr->group_counter);
-	sread_8  (fp, &GroupPtr->race_id);
-	sread_8  (fp, &tmpb); /* was var2 */
-	GroupPtr->sys_loc = LONIBBLE (tmpb);
-	GroupPtr->task = HINIBBLE (tmpb);
-	sread_8  (fp, &GroupPtr->in_system); /* was crew_level */
-	sread_8  (fp, NULL); /* unused; was max_crew */
-	sread_8  (fp, &tmpb); /* was energy_level */
-	GroupPtr->dest_loc = LONIBBLE (tmpb);
-	GroupPtr->orbit_pos = HINIBBLE (tmpb);
-	sread_8  (fp, &GroupPtr->group_id); /* was max_energy */
-	sread_16s(fp, &GroupPtr->loc.x);
-	sread_16s(fp, &GroupPtr->loc.y);
+	BYTE rec[GROUP_RECORD_SIZE];
+
+	readRecord (fp, rec, sizeof rec);
+	/* rec[0..1] unused; was which_side */
+	/* rec[2] unused; was captains_name_index */
+	/* rec[3] padding; for savegame compat */
+	GroupPtr->group_counter = getRecord16 (rec + 4);
+	GroupPtr->race_id = rec[6];
+	GroupPtr->sys_loc = LONIBBLE (rec[7]); /* was var2 */
+	GroupPtr->task = HINIBBLE (rec[7]);
+	GroupPtr->in_system = rec[8]; /* was crew_level */
+	/* rec[9] unused; was max_crew */
+	GroupPtr->dest_loc = LONIBBLE (rec[10]); /* was energy_level */
+	GroupPtr->orbit_pos = HINIBBLE (rec[10]);
+	GroupPtr->group_id = rec[11]; /* was max_energy */
+	// unsigned to signed conversion
+	GroupPtr->loc.x = (SWORD) getRecord16 (rec + 12);
+	GroupPtr->loc.y = (SWORD) getRecord16 (rec + 14);
 }
 
 void
 WriteIpGroup (GAME_STATE_FILE *fp, const IP_GROUP *GroupPtr)
 {
-	swrite_16 (fp, 0); /* unused; was which_side */
-	swrite_8  (fp, 0); /* unused; was captains_name_index */
-	swrite_8  (fp, 0); /* padding; for savegame compat */
-	swrite_16 (fp, GroupPtr->group_counter);
-	swrite_8  (fp, GroupPtr->race_id);
+	BYTE rec[GROUP_RECORD_SIZE];
+
+	memset (rec, 0, sizeof rec);
+	putRecord16 (rec + 4, GroupPtr->group_counter);
+	rec[6] = GroupPtr->race_id;
 	assert (GroupPtr->sys_loc < 0x10 && GroupPtr->task < 0x10);
-	swrite_8  (fp, MAKE_BYTE (GroupPtr->sys_loc, GroupPtr->task));
-			/* was var2 */
-	swrite_8  (fp, GroupPtr->in_system); /* was crew_level */
-	swrite_8  (fp, 0); /* unused; was max_crew */
+	rec[7] = MAKE_BYTE (GroupPtr->sys_loc, GroupPtr->task); /* was var2 */
+	rec[8] = GroupPtr->in_system; /* was crew_level */
 	assert (GroupPtr->dest_loc < 0x10 && GroupPtr->orbit_pos < 0x10);
-	swrite_8  (fp, MAKE_BYTE (GroupPtr->dest_loc, GroupPtr->orbit_pos));
+	rec[10] = MAKE_BYTE (GroupPtr->dest_loc, GroupPtr->orbit_pos);
 			/* was energy_level */
-	swrite_8  (fp, GroupPtr->group_id); /* was max_energy */
-	swrite_16 (fp, GroupPtr->loc.x);
-	swrite_16 (fp, GroupPtr->loc.y);
+	rec[11] = GroupPtr->group_id; /* was max_energy */
+	putRecord16 (rec + 12, GroupPtr->loc.x);
+	putRecord16 (rec + 14, GroupPtr->loc.y);
+	WriteStateFile (rec, 1, sizeof rec, fp);
 }
 
 void
@@ -210,6 +264,23 @@ BuildGroup (QUEUE *pDstQueue, BYTE race_id)
 	return hGroup;
 }
 
+// Mark the groups as belonging to the current star system, and good for
+// the next 7 days
+static void
+StampGroupHeader (GROUP_HEADER *pGH)
+{
+	COUNT month_index, day_index, year_index;
+
+	month_index = 0;
+	day_index = 7;
+	year_index = 0;
+	ValidateEvent (RELATIVE_EVENT, &month_index, &day_index, &year_index);
+	pGH->day_index = (BYTE)day_index;
+	pGH->month_index = (BYTE)month_index;
+	pGH->year_index = year_index;
+	pGH->star_index = CurStarDescPtr - star_array;
+}
+
 void
 BuildGroups (void)
 {
@@ -351,6 +422,18 @@ FoundHome:
 		{
 			RACE_ENCOUNTER_MAKEUP
 		};
+		GAME_STATE_FILE *fp;
+		GROUP_HEADER GH;
+
+		// All the groups go into the same header, so it is read and
+		// stamped once rather than by a PutGroupInfo() for every group
+		fp = OpenStateFile (RANDGRPINFO_FILE, "r+b");
+		if (fp)
+		{
+			SeekStateFile (fp, GROUPS_RANDOM, SEEK_SET);
+			ReadGroupHeader (fp, &GH);
+			StampGroupHeader (&GH);
+		}
 
 		which_group = 0;
 		num_groups = ((COUNT)TFB_Random () % (BestPercent >> 1)) + 1;
@@ -371,9 +454,14 @@ FoundHome:
 							&GLOBAL (npc_built_ship_q), 0);
 			}
 
-			PutGroupInfo (GROUPS_RANDOM, ++which_group);
+			++which_group;
+			if (fp)
+				FlushGroupInfo (&GH, GROUPS_RANDOM, which_group, fp);
 			ReinitQueue (&GLOBAL (npc_built_ship_q));
 		} while (--num_groups);
+
+		if (fp)
+			CloseStateFile (fp);
 	}
 
 	GetGroupInfo (GROUPS_RANDOM, GROUP_INIT_IP);
@@ -838,19 +926,7 @@ PutGroupInfo (DWORD offset, BYTE which_group)
 	//   the entire 'random' group header expires.
 	if (GetHeadLink (&GLOBAL (npc_built_ship_q)) || GH.GroupOffset[0] == 0)
 #endif /* NEVER */
-	{
-		COUNT month_index, day_index, year_index;
-
-		/* The groups in this system are good for the next 7 days */
-		month_index = 0;
-		day_index = 7;
-		year_index = 0;
-		ValidateEvent (RELATIVE_EVENT, &month_index, &day_index, &year_index);
-		GH.day_index = (BYTE)day_index;
-		GH.month_index = (BYTE)month_index;
-		GH.year_index = year_index;
-	}
-	GH.star_index = CurStarDescPtr - star_array;
+	StampGroupHeader (&GH);
 
 #ifdef DEBUG_GROUPS
 	log_add (log_Debug, "PutGroupInfo(%lu): %u out of %u -- %u/%u/%u",
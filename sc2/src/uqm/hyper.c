@@ -51,6 +51,21 @@ static COLORMAP hypercmaps[2];
 static BYTE fuel_ticks;
 static COUNT hyper_dx, hyper_dy, hyper_extra;
 
+// The radar grid and stars are drawn into a layer twice the size of the
+// radar, centered on where the flagship was then, and the part in view is
+// stamped from there until the flagship moves out of it.
+#define RADAR_LAYER_WIDTH (RADAR_WIDTH << 1)
+#define RADAR_LAYER_HEIGHT (RADAR_HEIGHT << 1)
+
+static FRAME radarLayer;
+static BOOLEAN radarLayerValid;
+static COORD radarLayerX;
+static COORD radarLayerY;
+		// Radar offset of the top left of the layer
+static const STAR_DESC *radarLayerStars;
+static BOOLEAN radarLayerArilou;
+		// Whether the Arilou home star was drawn as a super giant
+
 // HyperspaceMenu() items
 enum HyperMenuItems
 {
@@ -167,11 +182,26 @@ check_hyperspace_encounter (void)
 	BYTE Type;
 	POINT universe;
 	HFLEETINFO hStarShip, hNextShip;
+	HENCOUNTER hEncounter, hNextEncounter;
+	ENCOUNTER *EncounterPtr;
+	BOOLEAN present[NUM_AVAILABLE_RACES];
+			// Races with an encounter in the queue already
 	COUNT EncounterPercent[] =
 	{
 		RACE_HYPERSPACE_PERCENT
 	};
 	
+	memset (present, 0, sizeof present);
+	for (hEncounter = GetHeadEncounter ();
+			hEncounter; hEncounter = hNextEncounter)
+	{
+		LockEncounter (hEncounter, &EncounterPtr);
+		hNextEncounter = GetSuccEncounter (EncounterPtr);
+		if (EncounterPtr->race_id < NUM_AVAILABLE_RACES)
+			present[EncounterPtr->race_id] = TRUE;
+		UnlockEncounter (hEncounter);
+	}
+
 	universe.x = LOGX_TO_UNIVERSE (GLOBAL_SIS (log_x));
 	universe.y = LOGY_TO_UNIVERSE (GLOBAL_SIS (log_y));
 	for (hStarShip = GetHeadLink (&GLOBAL (avail_race_q)), Type = 0;
@@ -190,8 +220,6 @@ check_hyperspace_encounter (void)
 			BYTE encounter_flags;
 			SIZE dx, dy;
 			COUNT percent;
-			HENCOUNTER hEncounter;
-			ENCOUNTER *EncounterPtr;
 
 			encounter_flags = 0;
 			percent = EncounterPercent[Type];
@@ -203,8 +231,6 @@ check_hyperspace_encounter (void)
 			}
 			else /* encounter_radius == infinity */
 			{
-				HENCOUNTER hNextEncounter;
-
 				encounter_radius = (MAX_X_UNIVERSE + 1) << 1;
 				if (Type == SLYLANDRO_SHIP)
 				{
@@ -227,19 +253,8 @@ check_hyperspace_encounter (void)
 				}
 
 				// There can be only one! (of either Slylandro or Melnorme)
-				for (hEncounter = GetHeadEncounter ();
-						hEncounter; hEncounter = hNextEncounter)
-				{
-					LockEncounter (hEncounter, &EncounterPtr);
-					hNextEncounter = GetSuccEncounter (EncounterPtr);
-					if (EncounterPtr->race_id == Type)
-					{
-						percent = 0;
-						hNextEncounter = 0;
-					}
-					UnlockEncounter (hEncounter);
-				}
-
+				if (Type < NUM_AVAILABLE_RACES && present[Type])
+					percent = 0;
 
 				if (percent == 100 && Type == MELNORME_SHIP)
 				{
@@ -298,26 +313,46 @@ FreeHyperData (void)
 	hypercmaps[1] = 0;
 }
 
+// Starts the loads, so that the SIS can be drawn while they go on
+static void
+StartLoadingHyperData (ResourceRequest *req[5])
+{
+	if (hyperstars[0] == 0)
+	{
+		req[0] = res_GetResourceAsync (AMBIENT_MASK_PMAP_ANIM);
+		req[1] = res_GetResourceAsync (HYPERSTARS_MASK_PMAP_ANIM);
+		req[2] = res_GetResourceAsync (HYPER_COLOR_TAB);
+		req[3] = res_GetResourceAsync (ARISPACE_MASK_PMAP_ANIM);
+		req[4] = res_GetResourceAsync (ARISPACE_COLOR_TAB);
+	}
+	else
+		memset (req, 0, 5 * sizeof (req[0]));
+}
+
 static void
-LoadHyperData (void)
+LoadHyperData (ResourceRequest *req[5])
 {
 	if (hyperstars[0] == 0)
 	{
 		hyperstars[0] = CaptureDrawable (
-				LoadGraphic (AMBIENT_MASK_PMAP_ANIM));
+				res_WaitDetachedResource (req[0]));
 		hyperstars[1] = CaptureDrawable (
-				LoadGraphic (HYPERSTARS_MASK_PMAP_ANIM));
-		hypercmaps[0] = CaptureColorMap (LoadColorMap (HYPER_COLOR_TAB));
+				res_WaitDetachedResource (req[1]));
+		hypercmaps[0] = CaptureColorMap (
+				res_WaitDetachedResource (req[2]));
 
 		hyperstars[2] = CaptureDrawable (
-				LoadGraphic (ARISPACE_MASK_PMAP_ANIM));
-		hypercmaps[1] = CaptureColorMap (LoadColorMap (ARISPACE_COLOR_TAB));
+				res_WaitDetachedResource (req[3]));
+		hypercmaps[1] = CaptureColorMap (
+				res_WaitDetachedResource (req[4]));
 	}
 }
 
 BOOLEAN
 LoadHyperspace (void)
 {
+	ResourceRequest *req[5];
+
 	hyper_dx = 0;
 	hyper_dy = 0;
 	hyper_extra = 0;
@@ -326,14 +361,8 @@ LoadHyperspace (void)
 	GLOBAL (ShipStamp.origin.x) = -MAX_X_UNIVERSE;
 	GLOBAL (ShipStamp.origin.y) = -MAX_Y_UNIVERSE;
 
-	LoadHyperData ();
-	{
-		FRAME F;
-		
-		F = hyperstars[0];
-		hyperstars[0] = stars_in_space;
-		stars_in_space = F;
-	}
+	res_PreloadSet ("preload.hyperspace");
+	StartLoadingHyperData (req);
 
 	if (!(LastActivity & CHECK_LOAD))
 		RepairSISBorder ();
@@ -354,6 +383,15 @@ LoadHyperspace (void)
 		DrawSISMessage (NULL);
 	}
 
+	LoadHyperData (req);
+	{
+		FRAME F;
+		
+		F = hyperstars[0];
+		hyperstars[0] = stars_in_space;
+		stars_in_space = F;
+	}
+
 	SetContext (RadarContext);
 	SetContextBackGroundColor (
 			BUILD_COLOR (MAKE_RGB15 (0x00, 0x0E, 0x00), 0x6C));
@@ -392,6 +430,10 @@ FreeHyperspace (void)
 	}
 //    FreeHyperData ();
 
+	DestroyDrawable (ReleaseDrawable (radarLayer));
+	radarLayer = 0;
+	radarLayerValid = FALSE;
+
 	return TRUE;
 }
 
@@ -1097,31 +1139,31 @@ AddEncounterElement (ENCOUNTER *EncounterPtr, POINT *puniverse)
 
 #define GRID_OFFSET 200
 
+// Draws the grid lines within w by h universe units around ux, uy
 static void
-DrawHyperGrid (COORD ux, COORD uy, COORD ox, COORD oy)
+DrawHyperGrid (COORD ux, COORD uy, COORD ox, COORD oy, COORD w, COORD h)
 {
 	COORD sx, sy, ex, ey;
 	RECT r;
 
-	ClearDrawable ();
 	SetContextForeGroundColor (
 			BUILD_COLOR (MAKE_RGB15 (0x00, 0x10, 0x00), 0x6B));
 
-	sx = ux - (RADAR_SCAN_WIDTH >> 1);
+	sx = ux - (w >> 1);
 	if (sx  < 0)
 		sx = 0;
 	else
 		sx -= sx % GRID_OFFSET;
-	ex = ux + (RADAR_SCAN_WIDTH >> 1);
+	ex = ux + (w >> 1);
 	if (ex > MAX_X_UNIVERSE + 1)
 		ex = MAX_X_UNIVERSE + 1;
 
-	sy = uy - (RADAR_SCAN_HEIGHT >> 1);
+	sy = uy - (h >> 1);
 	if (sy < 0)
 		sy = 0;
 	else
 		sy -= sy % GRID_OFFSET;
-	ey = uy + (RADAR_SCAN_HEIGHT >> 1);
+	ey = uy + (h >> 1);
 	if (ey > MAX_Y_UNIVERSE + 1)
 		ey = MAX_Y_UNIVERSE + 1;
 
@@ -1347,6 +1389,87 @@ ProcessEncounters (POINT *puniverse, COORD ox, COORD oy)
 	}
 }
 
+static void
+DrawRadarStars (POINT *puniverse, COORD ox, COORD oy, SIZE xbound,
+		SIZE ybound, BOOLEAN arilouHome)
+{
+	FRAME blip_frame;
+	STAR_DESC *SDPtr;
+	STAMP s;
+
+	blip_frame = SetAbsFrameIndex (stars_in_space, 90);
+	SDPtr = 0;
+	while ((SDPtr = FindStar (SDPtr, puniverse, xbound, ybound)))
+	{
+		BYTE star_type;
+		COORD ex, ey;
+
+		ex = SDPtr->star_pt.x;
+		ey = SDPtr->star_pt.y;
+		star_type = STAR_TYPE (SDPtr->Type);
+		if (arilouHome && ex == ARILOU_HOME_X && ey == ARILOU_HOME_Y)
+			star_type = SUPER_GIANT_STAR;
+
+		s.origin.x = (COORD)((long)ex * RADAR_WIDTH
+				/ RADAR_SCAN_WIDTH) - ox;
+		s.origin.y = (COORD)((long)(MAX_Y_UNIVERSE - ey)
+				* RADAR_HEIGHT / RADAR_SCAN_HEIGHT) - oy;
+		s.frame = SetRelFrameIndex (blip_frame, star_type + 2);
+		DrawStamp (&s);
+	}
+}
+
+// Draws the radar background, grid and stars for the radar offset ox, oy
+static void
+DrawRadarLayer (POINT *puniverse, COORD ox, COORD oy, BOOLEAN arilouHome)
+{
+	STAMP s;
+
+	if (!radarLayerValid || radarLayerStars != star_array
+			|| radarLayerArilou != arilouHome
+			|| ox < radarLayerX
+			|| ox > radarLayerX + RADAR_LAYER_WIDTH - RADAR_WIDTH
+			|| oy < radarLayerY
+			|| oy > radarLayerY + RADAR_LAYER_HEIGHT - RADAR_HEIGHT)
+	{
+		CONTEXT OldContext;
+		Color bg = GetContextBackGroundColor ();
+
+		if (!radarLayer)
+		{
+			radarLayer = CaptureDrawable (CreateDrawable (WANT_PIXMAP,
+					RADAR_LAYER_WIDTH, RADAR_LAYER_HEIGHT, 1));
+		}
+		else
+		{	// A draw of the old contents may still be queued
+			FlushGraphics ();
+		}
+
+		radarLayerValid = TRUE;
+		radarLayerX = ox - ((RADAR_LAYER_WIDTH - RADAR_WIDTH) >> 1);
+		radarLayerY = oy - ((RADAR_LAYER_HEIGHT - RADAR_HEIGHT) >> 1);
+		radarLayerStars = star_array;
+		radarLayerArilou = arilouHome;
+
+		OldContext = SetContext (OffScreenContext);
+		SetContextFGFrame (radarLayer);
+		SetContextClipRect (NULL);
+		SetContextBackGroundColor (bg);
+		ClearDrawable ();
+		DrawHyperGrid (puniverse->x, puniverse->y, radarLayerX, radarLayerY,
+				RADAR_SCAN_WIDTH << 1, RADAR_SCAN_HEIGHT << 1);
+		DrawRadarStars (puniverse, radarLayerX, radarLayerY,
+				XOFFS + (RADAR_SCAN_WIDTH >> 1),
+				YOFFS + (RADAR_SCAN_HEIGHT >> 1), arilouHome);
+		SetContext (OldContext);
+	}
+
+	s.origin.x = radarLayerX - ox;
+	s.origin.y = radarLayerY - oy;
+	s.frame = radarLayer;
+	DrawStamp (&s);
+}
+
 void
 SeedUniverse (void)
 {
@@ -1381,33 +1504,7 @@ SeedUniverse (void)
 	arilouSpaceCounter = GET_GAME_STATE (ARILOU_SPACE_COUNTER);
 	arilouSpaceSide = GET_GAME_STATE (ARILOU_SPACE_SIDE);
 
-//    if (ox != ex || oy != ey)
-	{
-		DrawHyperGrid (universe.x, universe.y, ox, oy);
-
-		{
-			SDPtr = 0;
-			while ((SDPtr = FindStar (SDPtr, &universe, XOFFS, YOFFS)))
-			{
-				BYTE star_type;
-
-				ex = SDPtr->star_pt.x;
-				ey = SDPtr->star_pt.y;
-				star_type = STAR_TYPE (SDPtr->Type);
-				if (arilouSpaceSide >= 2 &&
-						ex == ARILOU_HOME_X && ey == ARILOU_HOME_Y)
-					star_type = SUPER_GIANT_STAR;
-
-				s.origin.x = (COORD)((long)ex * RADAR_WIDTH
-						/ RADAR_SCAN_WIDTH) - ox;
-				s.origin.y = (COORD)((long)(MAX_Y_UNIVERSE - ey)
-						* RADAR_HEIGHT / RADAR_SCAN_HEIGHT) - oy;
-				s.frame = SetRelFrameIndex (blip_frame,
-						star_type + 2);
-				DrawStamp (&s);
-			}
-		}
-	}
+	DrawRadarLayer (&universe, ox, oy, arilouSpaceSide >= 2);
 
 	portalCounter = GET_GAME_STATE (PORTAL_COUNTER);
 	if (portalCounter || arilouSpaceCounter)
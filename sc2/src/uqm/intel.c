@@ -22,6 +22,7 @@
 #include "controls.h"
 #include "globdata.h"
 #include "setup.h"
+#include "shipprof.h"
 #include "libs/log.h"
 
 #include <stdio.h>
@@ -40,7 +41,15 @@ computer_intelligence (ComputerInputContext *context, STARSHIP *StarShipPtr)
 		// Selecting the next action for in battle.
 		if (StarShipPtr->control & CYBORG_CONTROL)
 		{
-			InputState = tactical_intelligence (context, StarShipPtr);
+			if (ShipProfile_enabled)
+			{
+				DWORD start = GetTimeMicroseconds ();
+				InputState = tactical_intelligence (context, StarShipPtr);
+				ShipProfile_add (StarShipPtr->SpeciesID,
+						SHIPPROF_INTELLIGENCE, start);
+			}
+			else
+				InputState = tactical_intelligence (context, StarShipPtr);
 
 			// Allow a player to warp-escape in cyborg mode
 			if (StarShipPtr->playerNr == RPG_PLAYER_NUM)
@@ -56,6 +56,7 @@ extern void ship_intelligence (ELEMENT *ShipPtr,
 		EVALUATE_DESC *ObjectsOfConcern, COUNT ConcernCounter);
 extern BOOLEAN ship_weapons (ELEMENT *ShipPtr, ELEMENT *OtherPtr,
 		COUNT margin_of_error);
+extern void InvalidateThreatTable (void);
 
 extern void Pursue (ELEMENT *ShipPtr, EVALUATE_DESC *EvalDescPtr);
 extern void Entice (ELEMENT *ShipPtr, EVALUATE_DESC *EvalDescPtr);
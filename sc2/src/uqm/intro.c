@@ -32,11 +32,26 @@
 #include "libs/sound/sound.h"
 #include "libs/vidlib.h"
 #include "libs/log.h"
+#include "libs/threadlib.h"
 
 #include <ctype.h>
 
 static BOOLEAN ShowSlidePresentation (STRING PresStr);
 
+// The next ANI of a script is loaded on a thread of its own while the
+// current one is up, so that the show does not stop to load it. Only
+// the one slide is loaded ahead, and a slide is freed when the next one
+// replaces it, so a long show keeps no more than two slides in memory.
+typedef struct
+{
+	char Name[512];
+	FRAME Frame;
+	Semaphore Done;
+			// Cleared by the loading thread when it is done
+	BOOLEAN Pending;
+			// A thread is loading Name
+} SLIDE_PRELOAD;
+
 typedef struct
 {
 	/* standard state required by DoInput */
@@ -51,6 +66,7 @@ typedef struct
 #define MAX_FONTS 5
 	FONT Fonts[MAX_FONTS];
 	FRAME Frame;
+	SLIDE_PRELOAD Preload;
 	MUSIC_REF MusicRef;
 	BOOLEAN Batched;
 	FRAME SisFrame;
@@ -285,6 +301,104 @@ ShowPresentationFile (const char *name)
 	return result;
 }
 
+// Splits the opcode off a script line. Returns what follows it, or NULL
+// if the line has none.
+static char *
+Present_GetOpcode (char *pStr, char Opcode[16])
+{
+	if (!pStr)
+		return NULL;
+	if (1 != sscanf (pStr, "%15s", Opcode))
+		return NULL;
+	pStr += strlen (Opcode);
+	if (*pStr != '\0')
+		++pStr;
+	strupr (Opcode);
+	return pStr;
+}
+
+static int
+Present_PreloadFunc (void *data)
+{
+	SLIDE_PRELOAD *pPre = (SLIDE_PRELOAD *) data;
+
+	pPre->Frame = CaptureDrawable (LoadGraphicFile (pPre->Name));
+	ClearSemaphore (pPre->Done);
+	return 0;
+}
+
+static void
+Present_WaitPreload (PRESENTATION_INPUT_STATE* pPIS)
+{
+	if (!pPIS->Preload.Pending)
+		return;
+
+	SetSemaphore (pPIS->Preload.Done);
+	pPIS->Preload.Pending = FALSE;
+}
+
+static void
+Present_DropPreload (PRESENTATION_INPUT_STATE* pPIS)
+{
+	Present_WaitPreload (pPIS);
+	DestroyDrawable (ReleaseDrawable (pPIS->Preload.Frame));
+	pPIS->Preload.Frame = 0;
+	pPIS->Preload.Name[0] = '\0';
+}
+
+// Returns the slide if it was loaded ahead, or 0
+static FRAME
+Present_TakePreload (PRESENTATION_INPUT_STATE* pPIS, const char *name)
+{
+	FRAME frame;
+
+	Present_WaitPreload (pPIS);
+	if (strcmp (pPIS->Preload.Name, name) != 0)
+	{
+		Present_DropPreload (pPIS);
+		return 0;
+	}
+
+	frame = pPIS->Preload.Frame;
+	pPIS->Preload.Frame = 0;
+	pPIS->Preload.Name[0] = '\0';
+	return frame;
+}
+
+// Starts loading the next ANI of the script, if there is one
+static void
+Present_PreloadNextAni (PRESENTATION_INPUT_STATE* pPIS)
+{
+	STRING str = pPIS->SlideShow;
+	COUNT count = GetStringTableCount (str);
+	COUNT i;
+	char *pStr = NULL;
+
+	for (i = pPIS->OperIndex; i < count;
+			++i, str = SetRelStringTableIndex (str, 1))
+	{
+		char Opcode[16];
+
+		pStr = Present_GetOpcode (GetStringAddress (str), Opcode);
+		if (pStr && strcmp (Opcode, "ANI") == 0)
+			break;
+	}
+	if (i >= count)
+		return;
+
+	if (!pPIS->Preload.Done)
+	{
+		pPIS->Preload.Done = CreateSemaphore (0, "Slide preload",
+				SYNC_CLASS_RESOURCE);
+		if (!pPIS->Preload.Done)
+			return;
+	}
+	utf8StringCopy (pPIS->Preload.Name, sizeof (pPIS->Preload.Name), pStr);
+	pPIS->Preload.Pending = TRUE;
+	StartThread (Present_PreloadFunc, &pPIS->Preload, 1024,
+			"slide preloader");
+}
+
 static BOOLEAN
 DoPresentation (void *pIS)
 {
@@ -337,14 +451,9 @@ DoPresentation (void *pIS)
 		pPIS->OperIndex++;
 		pPIS->SlideShow = SetRelStringTableIndex (pPIS->SlideShow, 1);
 
+		pStr = Present_GetOpcode (pStr, Opcode);
 		if (!pStr)
 			continue;
-		if (1 != sscanf (pStr, "%15s", Opcode))
-			continue;
-		pStr += strlen (Opcode);
-		if (*pStr != '\0')
-			++pStr;
-		strupr (Opcode);
 
 		if (strcmp (Opcode, "DIMS") == 0)
 		{	/* set dimensions */
@@ -389,7 +498,10 @@ DoPresentation (void *pIS)
 			utf8StringCopy (pPIS->Buffer, sizeof (pPIS->Buffer), pStr);
 			if (pPIS->Frame)
 				DestroyDrawable (ReleaseDrawable (pPIS->Frame));
-			pPIS->Frame = CaptureDrawable (LoadGraphicFile (pPIS->Buffer));
+			pPIS->Frame = Present_TakePreload (pPIS, pPIS->Buffer);
+			if (!pPIS->Frame)
+				pPIS->Frame = CaptureDrawable (LoadGraphicFile (pPIS->Buffer));
+			Present_PreloadNextAni (pPIS);
 		}
 		else if (strcmp (Opcode, "MUSIC") == 0)
 		{	/* set music */
@@ -760,6 +872,9 @@ ShowSlidePresentation (STRING PresStr)
 	DestroyMusic (pis.MusicRef);
 	DestroyDrawable (ReleaseDrawable (pis.RotatedFrame));
 	DestroyDrawable (ReleaseDrawable (pis.Frame));
+	Present_DropPreload (&pis);
+	if (pis.Preload.Done)
+		DestroySemaphore (pis.Preload.Done);
 	for (i = 0; i < MAX_FONTS; ++i)
 		DestroyFont (pis.Fonts[i]);
 
@@ -32,18 +32,78 @@
 #include "libs/tasklib.h"
 #include "libs/log.h"
 #include "libs/misc.h"
+#include "libs/declib.h"
 
 //#define DEBUG_LOAD
 
 ACTIVITY NextActivity;
 
+static DECODE_REF load_codec;
+		// Set while reading a compressed save; the reads then come
+		// from here rather than from the file passed
+
+// The save file is read ahead a block at a time, rather than with a
+// file read for every field
+#define LOAD_BUF_SIZE 4096
+static BYTE load_buf[LOAD_BUF_SIZE];
+static COUNT load_pos;
+static COUNT load_len;
+
+// Reads count bytes from the save. Returns whether they were all there.
+static BOOLEAN
+read_bytes (void *fp, BYTE *ar, COUNT count)
+{
+	if (load_codec)
+		return cread (ar, 1, count, load_codec) == count;
+
+	while (count)
+	{
+		COUNT len;
+
+		if (load_pos == load_len)
+		{
+			if (count >= LOAD_BUF_SIZE)
+				return ReadResFile (ar, 1, count, fp) == count;
+			load_pos = 0;
+			load_len = (COUNT) ReadResFile (load_buf, 1, LOAD_BUF_SIZE, fp);
+			if (load_len == 0)
+				return FALSE;
+		}
+
+		len = load_len - load_pos;
+		if (len > count)
+			len = count;
+		memcpy (ar, load_buf + load_pos, len);
+		load_pos += len;
+		ar += len;
+		count -= len;
+	}
+	return TRUE;
+}
+
+// Puts the file back where the reads got to, and forgets what was read
+// ahead
+static void
+flush_read_ahead (uio_Stream *fp)
+{
+	if (load_pos < load_len)
+		SeekResFile (fp, -(long) (load_len - load_pos), SEEK_CUR);
+	load_pos = 0;
+	load_len = 0;
+}
+
 static inline size_t
 read_8 (void *fp, BYTE *v)
 {
 	BYTE t;
 	if (!v) /* read value ignored */
 		v = &t;
-	return ReadResFile (v, 1, 1, fp);
+	if (!load_codec && load_pos < load_len)
+	{
+		*v = load_buf[load_pos++];
+		return 1;
+	}
+	return read_bytes (fp, v, 1);
 }
 
 static inline size_t
@@ -100,7 +160,7 @@ static inline size_t
 read_a8 (void *fp, BYTE *ar, COUNT count)
 {
 	assert (ar != NULL);
-	return ReadResFile (ar, 1, count, fp) == count;
+	return read_bytes (fp, ar, count);
 }
 
 static inline size_t
@@ -398,6 +458,15 @@ LoadSummary (SUMMARY_DESC *SummPtr, void *fp)
 	DWORD nameSize = 0;
 	if (!read_32 (fp, &magic))
 		return FALSE;
+	if (magic == SAVEFILE_LZ_TAG)
+	{	// All that follows is compressed; the codec reads the file
+		// itself, from where we got to
+		flush_read_ahead (fp);
+		load_codec = copen (fp, FILE_STREAM, STREAM_READ);
+		if (!load_codec)
+			return FALSE;
+		magic = SAVEFILE_TAG;
+	}
 	if (magic == SAVEFILE_TAG)
 	{
 		if (read_32 (fp, &magic) != 1 || magic != SUMMARY_TAG)
@@ -611,6 +680,19 @@ LoadBattleGroup (uio_Stream *fh, DWORD chunksize)
 	}
 }
 
+static void
+CloseSaveFile (uio_Stream *fp)
+{
+	if (load_codec)
+	{
+		cclose (load_codec);
+		load_codec = NULL;
+	}
+	load_pos = 0;
+	load_len = 0;
+	res_CloseResFile (fp);
+}
+
 BOOLEAN
 LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 {
@@ -623,6 +705,9 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 	DWORD chunk, chunkSize;
 	BOOLEAN first_group_spec = TRUE;
 
+	// The save may still be on its way to the disk
+	WaitForSaveWrite ();
+
 	sprintf (file, "uqmsave.%02u", which_game);
 	in_fp = res_OpenResFile (saveDir, file, "rb");
 	if (!in_fp)
@@ -630,7 +715,7 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 
 	if (!LoadSummary (&loc_sd, in_fp))
 	{
-		res_CloseResFile (in_fp);
+		CloseSaveFile (in_fp);
 		return LoadLegacyGame (which_game, SummPtr);
 	}
 
@@ -641,7 +726,7 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 	else
 	{	// only need summary for displaying to user
 		memcpy (SummPtr, &loc_sd, sizeof (*SummPtr));
-		res_CloseResFile (in_fp);
+		CloseSaveFile (in_fp);
 		return TRUE;
 	}
 
@@ -657,7 +742,7 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 	Activity = GLOBAL (CurrentActivity);
 	if (!LoadGameState (&GlobData.Game_state, in_fp))
 	{
-		res_CloseResFile (in_fp);
+		CloseSaveFile (in_fp);
 		return FALSE;
 	}
 	NextActivity = GLOBAL (CurrentActivity);
@@ -672,7 +757,7 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 		}
 		if (read_32(in_fp, &chunkSize) != 1)
 		{
-			res_CloseResFile (in_fp);
+			CloseSaveFile (in_fp);
 			return FALSE;
 		}
 		switch (chunk)
@@ -759,13 +844,13 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 			log_add (log_Debug, "Skipping chunk of tag %08X (size %u)", chunk, chunkSize);
 			if (skip_8(in_fp, chunkSize) != 1)
 			{
-				res_CloseResFile (in_fp);
+				CloseSaveFile (in_fp);
 				return FALSE;
 			}
 			break;
 		}
 	}
-	res_CloseResFile (in_fp);
+	CloseSaveFile (in_fp);
 
 	EncounterGroup = 0;
 	EncounterRace = -1;
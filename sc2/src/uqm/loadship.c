@@ -60,6 +60,61 @@ static RESOURCE code_resources[] = {
 		SAMATRA_CODE,
 		URQUAN_DRONE_CODE };
 
+// The battle data is taken from the resource system without detaching
+// it, so all the ships of a race in play share one copy, and when the
+// last of them is freed it stays in the idle cache for the next battle.
+// Nothing may change these drawables, sounds or music.
+static void *
+getSharedResource (RESOURCE res)
+{
+	return res_GetResource (res);
+}
+
+static void
+freeSharedResource (RESOURCE res)
+{
+	if (res != NULL_RESOURCE)
+		res_FreeResource (res);
+}
+
+// Like load_animation(), with the frames shared
+static BOOLEAN
+load_shared_animation (FRAME *pixarray, const RESOURCE *rsc)
+{
+	COUNT i;
+
+	pixarray[0] = CaptureDrawable (getSharedResource (rsc[0]));
+	if (!pixarray[0])
+		return FALSE;
+
+	for (i = 1; i < NUM_VIEWS; ++i)
+	{
+		if (rsc[i] == NULL_RESOURCE)
+		{	// Same as the next bigger one
+			pixarray[i] = pixarray[i - 1];
+			continue;
+		}
+		pixarray[i] = CaptureDrawable (getSharedResource (rsc[i]));
+		if (!pixarray[i])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+free_shared_animation (FRAME *pixarray, const RESOURCE *rsc)
+{
+	COUNT i;
+
+	for (i = 0; i < NUM_VIEWS; ++i)
+	{
+		if (pixarray[i])
+			freeSharedResource (rsc[i]);
+		pixarray[i] = NULL;
+	}
+}
+
 // C-native implementation: loads a ship descriptor via CodeRes and C resources.
 // Always available regardless of USE_RUST_SHIPS so that LoadMasterShipList
 // can populate the C master_q with real resource handles.
@@ -112,34 +167,26 @@ c_load_ship (SPECIES_ID SpeciesID, BOOLEAN LoadBattleData)
 	if (LoadBattleData)
 	{
 		DATA_STUFF *RawPtr = &RDPtr->ship_data;
-		if (!load_animation (RawPtr->ship,
-				RawPtr->ship_rsc[0],
-				RawPtr->ship_rsc[1],
-				RawPtr->ship_rsc[2]))
+		if (!load_shared_animation (RawPtr->ship, RawPtr->ship_rsc))
 			goto BadLoad;
 
 		if (RawPtr->weapon_rsc[0] != NULL_RESOURCE)
 		{
-			if (!load_animation (RawPtr->weapon,
-					RawPtr->weapon_rsc[0],
-					RawPtr->weapon_rsc[1],
-					RawPtr->weapon_rsc[2]))
+			if (!load_shared_animation (RawPtr->weapon, RawPtr->weapon_rsc))
 				goto BadLoad;
 		}
 
 		if (RawPtr->special_rsc[0] != NULL_RESOURCE)
 		{
-			if (!load_animation (RawPtr->special,
-					RawPtr->special_rsc[0],
-					RawPtr->special_rsc[1],
-					RawPtr->special_rsc[2]))
+			if (!load_shared_animation (RawPtr->special,
+					RawPtr->special_rsc))
 				goto BadLoad;
 		}
 
 		if (RawPtr->captain_control.captain_rsc != NULL_RESOURCE)
 		{
-			RawPtr->captain_control.background = CaptureDrawable (LoadGraphic (
-					RawPtr->captain_control.captain_rsc));
+			RawPtr->captain_control.background = CaptureDrawable (
+					getSharedResource (RawPtr->captain_control.captain_rsc));
 			if (!RawPtr->captain_control.background)
 				goto BadLoad;
 		}
@@ -147,7 +194,7 @@ c_load_ship (SPECIES_ID SpeciesID, BOOLEAN LoadBattleData)
 		if (RawPtr->victory_ditty_rsc != NULL_RESOURCE)
 		{
 			RawPtr->victory_ditty =
-					LoadMusic (RawPtr->victory_ditty_rsc);
+					getSharedResource (RawPtr->victory_ditty_rsc);
 			if (!RawPtr->victory_ditty)
 				goto BadLoad;
 		}
@@ -155,7 +202,7 @@ c_load_ship (SPECIES_ID SpeciesID, BOOLEAN LoadBattleData)
 		if (RawPtr->ship_sounds_rsc != NULL_RESOURCE)
 		{
 			RawPtr->ship_sounds = CaptureSound (
-					LoadSound (RawPtr->ship_sounds_rsc));
+					getSharedResource (RawPtr->ship_sounds_rsc));
 			if (!RawPtr->ship_sounds)
 				goto BadLoad;
 		}
@@ -174,6 +221,39 @@ BadLoad:
 	goto ExitFunc;
 }
 
+// Starts loading the battle data of a ship in the background, for a
+// ship that will come into play later. load_ship() then only waits for
+// what has not finished loading yet.
+void
+preload_ship (SPECIES_ID SpeciesID)
+{
+	RACE_DESC *RDPtr = 0;
+	void *CodeRef;
+	DATA_STUFF *RawPtr;
+	COUNT i;
+
+	if (SpeciesID >= NUM_SPECIES_ID)
+		return;
+
+	CodeRef = CaptureCodeRes (LoadCodeRes (code_resources[SpeciesID]),
+			&GlobData, (void **)(&RDPtr));
+	if (!CodeRef)
+		return;
+
+	RawPtr = &RDPtr->ship_data;
+	for (i = 0; i < NUM_VIEWS; ++i)
+	{
+		res_Preload (RawPtr->ship_rsc[i]);
+		res_Preload (RawPtr->weapon_rsc[i]);
+		res_Preload (RawPtr->special_rsc[i]);
+	}
+	res_Preload (RawPtr->captain_control.captain_rsc);
+	res_Preload (RawPtr->victory_ditty_rsc);
+	res_Preload (RawPtr->ship_sounds_rsc);
+
+	DestroyCodeRes (ReleaseCodeRes (CodeRef));
+}
+
 // C-native free: always available for master_q resource cleanup.
 void
 c_free_ship (RACE_DESC *raceDescPtr, BOOLEAN FreeIconData,
@@ -186,14 +266,16 @@ c_free_ship (RACE_DESC *raceDescPtr, BOOLEAN FreeIconData,
 	{
 		DATA_STUFF *shipData = &raceDescPtr->ship_data;
 
-		free_image (shipData->special);
-		free_image (shipData->weapon);
-		free_image (shipData->ship);
+		free_shared_animation (shipData->special, shipData->special_rsc);
+		free_shared_animation (shipData->weapon, shipData->weapon_rsc);
+		free_shared_animation (shipData->ship, shipData->ship_rsc);
 
-		DestroyDrawable (
-				ReleaseDrawable (shipData->captain_control.background));
-		DestroyMusic (shipData->victory_ditty);
-		DestroySound (ReleaseSound (shipData->ship_sounds));
+		if (shipData->captain_control.background)
+			freeSharedResource (shipData->captain_control.captain_rsc);
+		if (shipData->victory_ditty)
+			freeSharedResource (shipData->victory_ditty_rsc);
+		if (shipData->ship_sounds)
+			freeSharedResource (shipData->ship_sounds_rsc);
 	}
 
 	if (FreeIconData)
@@ -22,6 +22,7 @@
 #include "resinst.h"
 #include "displist.h"
 #include "supermelee/melee.h"
+#include "libs/time/bootprof.h"
 
 #ifdef USE_RUST_SHIPS
 extern BOOLEAN rust_ships_load_catalog(void);
@@ -38,6 +39,8 @@ LoadMasterShipList (void (* YieldProcessing)(void))
 	COUNT num_entries;
 	SPECIES_ID s_id = ARILOU_ID;
 
+	BOOT_BEGIN (BOOT_SHIPS);
+
 #ifdef USE_RUST_SHIPS
 	// Load the Rust-side catalog for Rust operations
 	rust_ships_load_catalog();
@@ -106,6 +109,8 @@ LoadMasterShipList (void (* YieldProcessing)(void))
 		}
 		InsertQueue (&master_q, hBuiltShip, hStarShip);
 	}
+
+	BOOT_END (BOOT_SHIPS);
 }
 
 void
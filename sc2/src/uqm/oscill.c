@@ -25,18 +25,24 @@
 #include "libs/sound/sound.h"
 #include "libs/sound/trackplayer.h"
 
+#include <string.h>
+
 
 static FRAME scope_frame;
 static int scope_init = 0;
 static FRAME scopeWork;
 static Color scopeColor;
 static EXTENT scopeSize;
+static BYTE scopeLastData[128];
+static BOOLEAN scopeLastValid = FALSE;
+		// scopeWork holds the trace of scopeLastData
 BOOLEAN oscillDisabled = FALSE;
 
 void
 InitOscilloscope (FRAME scopeBg)
 {
 	scope_frame = scopeBg;
+	scopeLastValid = FALSE;
 	if (!scope_init)
 	{
 		EXTENT size = GetFrameBounds (scope_frame);
@@ -84,34 +90,40 @@ DrawOscilloscope (void)
 	if (GraphForegroundStream (scope_data, scopeSize.width, scopeSize.height,
 			usingSpeech))
 	{
-		int i;
-		CONTEXT oldContext;
-
-		oldContext = SetContext (OffScreenContext);
-		SetContextFGFrame (scopeWork);
-		SetContextClipRect (NULL);
-		
-		// draw the background image
-		s.origin.x = 0;
-		s.origin.y = 0;
-		s.frame = scope_frame;
-		DrawStamp (&s);
-
-		// draw the scope lines
-		SetContextForeGroundColor (scopeColor);
-		for (i = 0; i < scopeSize.width - 1; ++i)
+		// Silence, and a paused track, give the same trace frame after
+		// frame; it is only drawn again when it changes
+		if (!scopeLastValid || memcmp (scope_data, scopeLastData,
+				scopeSize.width) != 0)
 		{
-			LINE line;
-
-			line.first.x = i + 1;
-			line.first.y = scope_data[i] + 1;
-			line.second.x = i + 2;
-			line.second.y = scope_data[i + 1] + 1;
-			DrawLine (&line);
+			POINT points[128];
+			int i;
+			CONTEXT oldContext;
+
+			oldContext = SetContext (OffScreenContext);
+			SetContextFGFrame (scopeWork);
+			SetContextClipRect (NULL);
+
+			// draw the background image
+			s.origin.x = 0;
+			s.origin.y = 0;
+			s.frame = scope_frame;
+			DrawStamp (&s);
+
+			// draw the scope lines
+			for (i = 0; i < scopeSize.width; ++i)
+			{
+				points[i].x = i + 1;
+				points[i].y = scope_data[i] + 1;
+			}
+			SetContextForeGroundColor (scopeColor);
+			DrawPolyline (points, scopeSize.width);
+
+			SetContext (oldContext);
+
+			memcpy (scopeLastData, scope_data, scopeSize.width);
+			scopeLastValid = TRUE;
 		}
 
-		SetContext (oldContext);
-
 		s.frame = scopeWork;
 	}
 	else
@@ -96,8 +96,10 @@ DrawModuleStrings (MENU_STATE *pMS, BYTE NewModule)
 	SetContext (OldContext);
 }
 
+// Draws the rows of the fuel tanks that start at a volume from 'first'
+// up to 'last', full or empty as the fuel on board has it.
 static void
-RedistributeFuel (void)
+DrawFuelRows (DWORD first, DWORD last)
 {
 	const DWORD FuelVolume = GLOBAL_SIS (FuelOnBoard);
 	const CONTEXT OldContext = SetContext (SpaceContext);
@@ -110,6 +112,10 @@ RedistributeFuel (void)
 			GLOBAL_SIS (FuelOnBoard) < GetFTankCapacity (&r.corner);
 			GLOBAL_SIS (FuelOnBoard) += FUEL_VOLUME_PER_ROW)
 	{
+		if (GLOBAL_SIS (FuelOnBoard) < first
+				|| GLOBAL_SIS (FuelOnBoard) >= last)
+			continue;
+
 		// If we're less than the fuel level, draw fuel.
 		if (GLOBAL_SIS (FuelOnBoard) < FuelVolume)
 		{
@@ -135,6 +141,25 @@ RedistributeFuel (void)
 	GLOBAL_SIS (FuelOnBoard) = FuelVolume;
 }
 
+static void
+RedistributeFuel (void)
+{
+	DrawFuelRows (0, ~(DWORD)0);
+}
+
+// Draws the rows that the fuel level going from 'oldVolume' to what is
+// on board now changed; those are the ones that start in between
+static void
+UpdateFuelRows (DWORD oldVolume)
+{
+	const DWORD FuelVolume = GLOBAL_SIS (FuelOnBoard);
+
+	if (oldVolume < FuelVolume)
+		DrawFuelRows (oldVolume, FuelVolume);
+	else
+		DrawFuelRows (FuelVolume, oldVolume);
+}
+
 #define LANDER_X 24
 #define LANDER_Y 67
 #define LANDER_WIDTH 15
@@ -579,10 +604,11 @@ ChangeFuelQuantity (void)
 	else
 	{
 		const int cost = (incr / FUEL_TANK_SCALE) * GLOBAL (FuelCost);
+		const DWORD oldVolume = GLOBAL_SIS (FuelOnBoard);
 		PreUpdateFlashRect ();
 		DeltaSISGauges (0, incr, -cost);
 		PostUpdateFlashRect ();
-		RedistributeFuel ();
+		UpdateFuelRows (oldVolume);
 	}
 
 	{   // Make fuel gauge flash.
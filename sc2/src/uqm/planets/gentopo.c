@@ -20,187 +20,264 @@
 
 #include "libs/gfxlib.h"
 #include "libs/mathlib.h"
+#include "libs/threads/workpool.h"
 #include "planets.h"
 
-void
-DeltaTopography (COUNT num_iterations, SBYTE *DepthArray, RECT *pRect,
-		SIZE depth_delta)
+// A fault is a band between two lines, which runs all the way down the
+// map, wrapping around at the sides. The band goes up by depth_delta and
+// the rest of each row goes down by as much. Neither line depends on the
+// map, so all the faults can be drawn from the RNG first, in the order
+// they always were, and then applied to bands of rows at the same time:
+// each row still gets the faults one after the other, so the map comes
+// out the same.
+
+typedef struct
 {
-	SIZE width, height, delta_y;
-	struct
+	COORD x_top;
+	SIZE x_incr, delta_x, error_term;
+} FAULT_LINE;
+
+typedef struct
+{
+	SIZE depth_delta;
+	FAULT_LINE line0, line1;
+} FAULT;
+
+#define FAULT_CHUNK 64
+		// Faults drawn at a time
+#define FAULT_BAND_ROWS 8
+		// Rows each piece of work on the work pool takes
+
+typedef struct
+{
+	const FAULT *faults;
+	COUNT count;
+	SBYTE *DepthArray;
+	SIZE width, height;
+	WorkGroup group;
+} FAULT_JOB;
+		// One for every map being made: surfaces are also made in the
+		// background
+
+static void
+initFaultLine (FAULT_LINE *line, COORD x_top, COORD x_bot, SIZE delta_y)
+{
+	line->x_top = x_top;
+	line->delta_x = (x_bot - x_top) << 1;
+	if (line->delta_x >= 0)
+		line->x_incr = 1;
+	else
 	{
-		COORD x_top, x_bot;
-		SIZE x_incr, delta_x, error_term;
-	} LineDDA0, LineDDA1;
+		line->x_incr = -1;
+		line->delta_x = -line->delta_x;
+	}
+	if (line->delta_x > delta_y)
+		line->error_term = -(line->delta_x >> 1);
+	else
+		line->error_term = -(delta_y >> 1);
+}
 
-	width = pRect->extent.width;
-	height = pRect->extent.height;
-	delta_y = (height - 1) << 1;
-	do
+// Moves the line down a row
+static inline void
+stepFaultLine (FAULT_LINE *line, SIZE delta_y)
+{
+	if (delta_y >= line->delta_x)
 	{
-		SIZE d;
-		COUNT h, w1, w2;
-		DWORD rand_val;
-		SBYTE *lpDst;
-
-		if ((RandomContext_Random (SysGenRNG) & 1) == 0)
-			depth_delta = -depth_delta;
-
-		rand_val = RandomContext_Random (SysGenRNG);
-		w1 = LOWORD (rand_val);
-		w2 = HIWORD (rand_val);
-
-		LineDDA0.x_top = LOBYTE (w1) % width;
-		LineDDA0.x_bot = HIBYTE (w1) % width;
-		LineDDA0.delta_x = (LineDDA0.x_bot - LineDDA0.x_top) << 1;
-		if (LineDDA0.delta_x >= 0)
-			LineDDA0.x_incr = 1;
-		else
+		if ((line->error_term += line->delta_x) >= 0)
 		{
-			LineDDA0.x_incr = -1;
-			LineDDA0.delta_x = -LineDDA0.delta_x;
+			line->x_top += line->x_incr;
+			line->error_term -= delta_y;
 		}
-		if (LineDDA0.delta_x > delta_y)
-			LineDDA0.error_term = -(LineDDA0.delta_x >> 1);
-		else
-			LineDDA0.error_term = -(delta_y >> 1);
-
-		LineDDA1.x_top = (LOBYTE (w2) % (width - 1)) + LineDDA0.x_top + 1;
-		LineDDA1.x_bot = (HIBYTE (w2) % (width - 1)) + LineDDA0.x_bot + 1;
-		LineDDA1.delta_x = (LineDDA1.x_bot - LineDDA1.x_top) << 1;
-		if (LineDDA1.delta_x >= 0)
-			LineDDA1.x_incr = 1;
-		else
+	}
+	else
+	{
+		do
 		{
-			LineDDA1.x_incr = -1;
-			LineDDA1.delta_x = -LineDDA1.delta_x;
+			line->x_top += line->x_incr;
+		} while ((line->error_term += delta_y) < 0);
+		line->error_term -= line->delta_x;
+	}
+}
+
+// Raises the row from x0 to x1 and lowers the rest of it
+static inline void
+shiftRow (SBYTE *row, SIZE width, COORD x0, COORD x1, SIZE depth_delta)
+{
+	SBYTE *lpDst = &row[x0];
+	COUNT w, w1, w2;
+	SIZE d;
+
+	w1 = x1 - x0;
+	w2 = width - w1;
+
+	if ((int)(x0 + w1) > (int)width)
+		w = width - x0;
+	else
+	{
+		w = w1;
+		x0 += w1;
+	}
+	w1 -= w;
+	while (w--)
+	{
+		d = *lpDst + depth_delta;
+		if (d >= -128 && d <= 127)
+			*lpDst = (SBYTE)d;
+		++lpDst;
+	}
+	if (w1 == 0)
+	{
+		if (x0 == width)
+		{
+			x0 = 0;
+			lpDst -= width;
 		}
-		if (LineDDA1.delta_x > delta_y)
-			LineDDA1.error_term = -(LineDDA1.delta_x >> 1);
-		else
-			LineDDA1.error_term = -(delta_y >> 1);
+	}
+	else
+	{
+		x0 = w1;
+		lpDst -= width;
+		do
+		{
+			d = *lpDst + depth_delta;
+			if (d >= -128 && d <= 127)
+				*lpDst = (SBYTE)d;
+			++lpDst;
+		} while (--w1);
+	}
 
-		lpDst = &DepthArray[LineDDA0.x_top];
-		h = height;
+	if ((int)(x0 + w2) > (int)width)
+		w = width - x0;
+	else
+		w = w2;
+	w2 -= w;
+	while (w--)
+	{
+		d = *lpDst - depth_delta;
+		if (d >= -128 && d <= 127)
+			*lpDst = (SBYTE)d;
+		++lpDst;
+	}
+	if (w2 != 0)
+	{
+		lpDst -= width;
 		do
 		{
-			COUNT w;
-
-			w1 = LineDDA1.x_top - LineDDA0.x_top;
-			w2 = width - w1;
-
-			if ((int)(LineDDA0.x_top + w1) > (int)width)
-				w = width - LineDDA0.x_top;
-			else
-			{
-				w = w1;
-				LineDDA0.x_top += w1;
-			}
-			w1 -= w;
-			while (w--)
-			{
-				d = *lpDst + depth_delta;
-				if (d >= -128 && d <= 127)
-					*lpDst = (SBYTE)d;
-				++lpDst;
-			}
-			if (w1 == 0)
-			{
-				if (LineDDA0.x_top == width)
-				{
-					LineDDA0.x_top = 0;
-					lpDst -= width;
-				}
-			}
-			else
-			{
-				LineDDA0.x_top = w1;
-				lpDst -= width;
-				do
-				{
-					d = *lpDst + depth_delta;
-					if (d >= -128 && d <= 127)
-						*lpDst = (SBYTE)d;
-					++lpDst;
-				} while (--w1);
-			}
-
-			if ((int)(LineDDA0.x_top + w2) > (int)width)
-				w = width - LineDDA0.x_top;
-			else
-			{
-				w = w2;
-				LineDDA0.x_top += w2;
-			}
-			w2 -= w;
-			while (w--)
-			{
-				d = *lpDst - depth_delta;
-				if (d >= -128 && d <= 127)
-					*lpDst = (SBYTE)d;
-				++lpDst;
-			}
-			if (w2 == 0)
-			{
-				if (LineDDA0.x_top == width)
-				{
-					LineDDA0.x_top = 0;
-					lpDst -= width;
-				}
-			}
-			else
-			{
-				LineDDA0.x_top = w2;
-				lpDst -= width;
-				do
-				{
-					d = *lpDst - depth_delta;
-					if (d >= -128 && d <= 127)
-						*lpDst = (SBYTE)d;
-					++lpDst;
-				} while (--w2);
-			}
-
-			lpDst += pRect->extent.width;
-
-			if (delta_y >= LineDDA0.delta_x)
-			{
-				if ((LineDDA0.error_term += LineDDA0.delta_x) >= 0)
-				{
-					lpDst += LineDDA0.x_incr;
-					LineDDA0.x_top += LineDDA0.x_incr;
-					LineDDA0.error_term -= delta_y;
-				}
-			}
-			else
-			{
-				do
-				{
-					lpDst += LineDDA0.x_incr;
-					LineDDA0.x_top += LineDDA0.x_incr;
-				} while ((LineDDA0.error_term += delta_y) < 0);
-				LineDDA0.error_term -= LineDDA0.delta_x;
-			}
-
-			if (delta_y >= LineDDA1.delta_x)
-			{
-				if ((LineDDA1.error_term += LineDDA1.delta_x) >= 0)
-				{
-					LineDDA1.x_top += LineDDA1.x_incr;
-					LineDDA1.error_term -= delta_y;
-				}
-			}
-			else
-			{
-				do
-				{
-					LineDDA1.x_top += LineDDA1.x_incr;
-				} while ((LineDDA1.error_term += delta_y) < 0);
-				LineDDA1.error_term -= LineDDA1.delta_x;
-			}
-		} while (--h);
-	} while (--num_iterations);
+			d = *lpDst - depth_delta;
+			if (d >= -128 && d <= 127)
+				*lpDst = (SBYTE)d;
+			++lpDst;
+		} while (--w2);
+	}
 }
 
+// Applies the faults, in order, to rows y0 to y1 - 1
+static void
+applyFaults (const FAULT *faults, COUNT count, SBYTE *DepthArray,
+		SIZE width, SIZE height, COORD y0, COORD y1)
+{
+	SIZE delta_y = (height - 1) << 1;
+	COUNT i;
 
+	for (i = 0; i < count; ++i)
+	{
+		FAULT_LINE line0 = faults[i].line0;
+		FAULT_LINE line1 = faults[i].line1;
+		COORD y;
 
+		for (y = 0; y < y1; ++y)
+		{
+			if (y >= y0)
+				shiftRow (&DepthArray[y * width], width, line0.x_top,
+						line1.x_top, faults[i].depth_delta);
+			stepFaultLine (&line0, delta_y);
+			stepFaultLine (&line1, delta_y);
+		}
+	}
+}
+
+static void
+applyFaultBand (void *data, int band)
+{
+	FAULT_JOB *job = (FAULT_JOB *) data;
+	COORD y0 = band * FAULT_BAND_ROWS;
+	COORD y1 = y0 + FAULT_BAND_ROWS;
+
+	if (y1 > job->height)
+		y1 = job->height;
+	applyFaults (job->faults, job->count, job->DepthArray, job->width,
+			job->height, y0, y1);
+}
+
+static void
+applyFaultsToMap (FAULT_JOB *job)
+{
+	int band;
+
+	if (WorkPool_getWorkerCount () == 0
+			|| job->height < FAULT_BAND_ROWS * 2)
+	{
+		applyFaults (job->faults, job->count, job->DepthArray, job->width,
+				job->height, 0, job->height);
+		return;
+	}
+
+	for (band = 0; band * FAULT_BAND_ROWS < job->height; ++band)
+		WorkGroup_submit (&job->group, applyFaultBand, job, band);
+	WorkGroup_wait (&job->group);
+}
+
+void
+DeltaTopography (RandomContext *rng, COUNT num_iterations, SBYTE *DepthArray,
+		RECT *pRect, SIZE depth_delta)
+{
+	SIZE width, height, delta_y;
+	FAULT faults[FAULT_CHUNK];
+	DWORD rand_vals[FAULT_CHUNK * 2];
+			// Two for each fault
+	FAULT_JOB job;
+
+	width = pRect->extent.width;
+	height = pRect->extent.height;
+	delta_y = (height - 1) << 1;
+
+	job.faults = faults;
+	job.DepthArray = DepthArray;
+	job.width = width;
+	job.height = height;
+	WorkGroup_init (&job.group, "Topography done");
+	do
+	{
+		COUNT count = num_iterations < FAULT_CHUNK ?
+				num_iterations : FAULT_CHUNK;
+		COUNT i;
+
+		RandomContext_FillRandom (rng, rand_vals, count * 2);
+		for (i = 0; i < count; ++i)
+		{
+			FAULT *f = &faults[i];
+			COORD x_top, x_bot;
+			COUNT w1, w2;
+
+			if ((rand_vals[i * 2] & 1) == 0)
+				depth_delta = -depth_delta;
+			f->depth_delta = depth_delta;
+
+			w1 = LOWORD (rand_vals[i * 2 + 1]);
+			w2 = HIWORD (rand_vals[i * 2 + 1]);
+
+			x_top = LOBYTE (w1) % width;
+			x_bot = HIBYTE (w1) % width;
+			initFaultLine (&f->line0, x_top, x_bot, delta_y);
+			initFaultLine (&f->line1,
+					(LOBYTE (w2) % (width - 1)) + x_top + 1,
+					(HIBYTE (w2) % (width - 1)) + x_bot + 1, delta_y);
+		}
+		num_iterations -= count;
+
+		job.count = count;
+		applyFaultsToMap (&job);
+	} while (num_iterations);
+
+	WorkGroup_uninit (&job.group);
+}
@@ -645,195 +645,364 @@ shotCreature (ELEMENT *ElementPtr, BYTE value,
 			NotPositional (), NULL, GAME_SOUND_PRIORITY);
 }
 
+// The objects on the surface by where they are on the planet, so that
+// the lander and its shots only need to be checked against what is near
+// them. The surface is cut into SURFACE_CELL_COLS by SURFACE_CELL_ROWS
+// cells, wrapping around horizontally like the surface itself. Rebuilt
+// along with the display list by BuildObjectList().
+#define SURFACE_CELL_COLS 32
+#define SURFACE_CELL_ROWS 8
+
+typedef struct
+{
+	HELEMENT hElement;
+	COUNT PrimIndex;
+	POINT location;
+	SIZE order;
+			// Where it is in the display list; the collisions are handled
+			// in display list order
+	BOOLEAN isShot;
+			// A lander shot; not in the cells
+	COUNT next;
+			// The next object in the same cell
+} SURFACE_OBJECT;
+
+static SURFACE_OBJECT surfaceObjects[MAX_DISPLAY_PRIMS];
+static COUNT numSurfaceObjects;
+static COUNT surfaceCells[SURFACE_CELL_ROWS][SURFACE_CELL_COLS];
+		// The first object in each cell
+static COUNT surfaceShots[MAX_DISPLAY_PRIMS];
+static COUNT numSurfaceShots;
+		// Sorted by order
+static SIZE surfaceReach;
+		// How far any object in the cells reaches from its location
+
+// How far a frame reaches from its hot spot, in any direction
+static SIZE
+frameReach (FRAME frame)
+{
+	RECT r;
+	SIZE reach;
+
+	if (!GetFrameRect (frame, &r))
+		return 0;
+	reach = -r.corner.x;
+	if (r.corner.x + r.extent.width > reach)
+		reach = r.corner.x + r.extent.width;
+	if (-r.corner.y > reach)
+		reach = -r.corner.y;
+	if (r.corner.y + r.extent.height > reach)
+		reach = r.corner.y + r.extent.height;
+	return reach;
+}
+
 static void
-CheckObjectCollision (COUNT index)
+ClearSurfaceObjects (void)
 {
-	INTERSECT_CONTROL LanderControl;
-	DRAWABLE LanderHandle;
-	PRIMITIVE *pPrim;
-	PRIMITIVE *pLanderPrim;
-	PLANETSIDE_DESC *pPSD = planetSideDesc;
+	COUNT row, col;
+
+	for (row = 0; row < SURFACE_CELL_ROWS; ++row)
+		for (col = 0; col < SURFACE_CELL_COLS; ++col)
+			surfaceCells[row][col] = END_OF_LIST;
+	numSurfaceObjects = 0;
+	numSurfaceShots = 0;
+	surfaceReach = 0;
+}
 
-	if (index != END_OF_LIST)
+static COUNT
+surfaceCellRow (COORD y)
+{
+	return (COUNT)((long)y * SURFACE_CELL_ROWS / (MAP_HEIGHT << MAG_SHIFT));
+}
+
+static void
+AddSurfaceObject (HELEMENT hElement, ELEMENT *ElementPtr, SIZE order)
+{
+	SURFACE_OBJECT *obj;
+	FRAME frame = DisplayArray[ElementPtr->PrimIndex].Object.Stamp.frame;
+
+	obj = &surfaceObjects[numSurfaceObjects];
+	obj->hElement = hElement;
+	obj->PrimIndex = ElementPtr->PrimIndex;
+	obj->location = ElementPtr->next.location;
+	obj->order = order;
+	obj->isShot = frame && GetFrameParentDrawable (frame)
+			== GetFrameParentDrawable (LanderFrame[0]);
+
+	if (obj->isShot)
 	{
-		pLanderPrim = &DisplayArray[index];
-		LanderControl.IntersectStamp = pLanderPrim->Object.Stamp;
-		index = GetPredLink (GetPrimLinks (pLanderPrim));
+		COUNT i;
+
+		for (i = numSurfaceShots; i > 0
+				&& surfaceObjects[surfaceShots[i - 1]].order > order; --i)
+			surfaceShots[i] = surfaceShots[i - 1];
+		surfaceShots[i] = numSurfaceObjects;
+		++numSurfaceShots;
 	}
 	else
 	{
-		pLanderPrim = 0;
-		LanderControl.IntersectStamp.origin.x = SURFACE_WIDTH >> 1;
-		LanderControl.IntersectStamp.origin.y = SURFACE_HEIGHT >> 1;
-		LanderControl.IntersectStamp.frame = LanderFrame[0];
-		index = GetSuccLink (DisplayLinks);
+		COUNT row, col;
+		SIZE reach;
+
+		// Only lander shots leave the surface
+		row = surfaceCellRow (obj->location.y);
+		col = (COUNT)((long)obj->location.x * SURFACE_CELL_COLS
+				/ (MAP_WIDTH << MAG_SHIFT));
+		obj->next = surfaceCells[row][col];
+		surfaceCells[row][col] = numSurfaceObjects;
+
+		reach = frameReach (frame);
+		if (reach > surfaceReach)
+			surfaceReach = reach;
 	}
+	++numSurfaceObjects;
+}
 
-	LanderControl.EndPoint = LanderControl.IntersectStamp.origin;
-	LanderHandle = GetFrameParentDrawable (LanderControl.IntersectStamp.frame);
+// Finds the objects within reach of loc and all the shots, that come
+// after 'after' in the display list, in display list order
+static COUNT
+FindSurfaceObjects (COUNT *found, POINT loc, SIZE reach, SIZE after)
+{
+	long width = MAP_WIDTH << MAG_SHIFT;
+	long x0, y0, y1;
+	COUNT col0, numCols, row0, row1, row, i, j;
+	COUNT numFound = 0;
+
+	reach += surfaceReach + 1;
+
+	x0 = (loc.x - reach) % width;
+	if (x0 < 0)
+		x0 += width;
+	col0 = (COUNT)(x0 * SURFACE_CELL_COLS / width);
+	numCols = (COUNT)((x0 + 2 * reach) * SURFACE_CELL_COLS / width)
+			- col0 + 1;
+	if (numCols > SURFACE_CELL_COLS)
+		numCols = SURFACE_CELL_COLS;
+
+	y0 = loc.y - reach;
+	if (y0 < 0)
+		y0 = 0;
+	y1 = loc.y + reach;
+	if (y1 >= (MAP_HEIGHT << MAG_SHIFT))
+		y1 = (MAP_HEIGHT << MAG_SHIFT) - 1;
+	row0 = surfaceCellRow (y0);
+	row1 = y0 <= y1 ? surfaceCellRow (y1) + 1 : row0;
+			// A shot may be off the surface
+
+	for (row = row0; row < row1; ++row)
+	{
+		for (i = 0; i < numCols; ++i)
+		{
+			COUNT index = surfaceCells[row][(col0 + i) % SURFACE_CELL_COLS];
+
+			for (; index != END_OF_LIST; index = surfaceObjects[index].next)
+			{
+				if (surfaceObjects[index].order > after)
+					found[numFound++] = index;
+			}
+		}
+	}
 
-	for (; index != END_OF_LIST; index = GetPredLink (GetPrimLinks (pPrim)))
+	for (i = 0; i < numSurfaceShots; ++i)
 	{
-		INTERSECT_CONTROL ElementControl;
-		HELEMENT hElement, hNextElement;
+		if (surfaceObjects[surfaceShots[i]].order > after)
+			found[numFound++] = surfaceShots[i];
+	}
 
-		pPrim = &DisplayArray[index];
-		ElementControl.IntersectStamp = pPrim->Object.Stamp;
-		ElementControl.EndPoint = ElementControl.IntersectStamp.origin;
+	// There are only ever a few
+	for (i = 1; i < numFound; ++i)
+	{
+		COUNT index = found[i];
+		SIZE order = surfaceObjects[index].order;
 
-		if (GetFrameParentDrawable (ElementControl.IntersectStamp.frame)
-				== LanderHandle)
-		{
-			CheckObjectCollision (index);
-			continue;
-		}
+		for (j = i; j > 0 && surfaceObjects[found[j - 1]].order > order; --j)
+			found[j] = found[j - 1];
+		found[j] = index;
+	}
 
-		if (!DrawablesIntersect (&LanderControl,
-				&ElementControl, MAX_TIME_VALUE))
-			continue;
+	return numFound;
+}
 
-		for (hElement = GetHeadElement (); hElement; hElement = hNextElement)
-		{
-			ELEMENT *ElementPtr;
+// The lander (byLander) or one of its shots ran into a surface object
+static void
+hitSurfaceObject (ELEMENT *ElementPtr, PRIMITIVE *pPrim, BOOLEAN byLander,
+		INTERSECT_CONTROL *LanderControl, INTERSECT_CONTROL *ElementControl)
+{
+	COUNT scan, NumRetrieved;
+	SIZE which_node;
+	PLANETSIDE_DESC *pPSD = planetSideDesc;
 
-			LockElement (hElement, &ElementPtr);
-			hNextElement = GetSuccElement (ElementPtr);
+	scan = LOBYTE (ElementPtr->scan_node);
+	if (byLander)
+	{
+		/* Collision of lander with another object */
+		if (crew_left == 0 || pPSD->InTransit)
+			return;
 
-			if (&DisplayArray[ElementPtr->PrimIndex] == pLanderPrim)
+		if (ElementPtr->state_flags & FINITE_LIFE)
+		{
+			/* A natural disaster */
+			scan = ElementPtr->mass_points;
+			switch (scan)
 			{
-				ElementPtr->state_flags |= DISAPPEARING;
-				UnlockElement (hElement);
-				continue;
+				case EARTHQUAKE_DISASTER:
+				case LAVASPOT_DISASTER:
+					if (TFB_Random () % 100 < 25)
+						DeltaLanderCrew (-1, scan);
+					break;
 			}
-			
-			if (&DisplayArray[ElementPtr->PrimIndex] != pPrim
-					|| ElementPtr->playerNr != PS_NON_PLAYER)
+			return;
+		}
+		else if (scan == ENERGY_SCAN)
+		{
+			// noop; handled by generation funcs, see below
+		}
+		else if (scan == BIOLOGICAL_SCAN && ElementPtr->hit_points)
+		{
+			BYTE danger_vals[] =
 			{
-				UnlockElement (hElement);
-				continue;
+				0, 6, 13, 26
+			};
+			int creatureIndex = ElementPtr->mass_points
+					& ~CREATURE_AWARE;
+			int dangerLevel =
+					(CreatureData[creatureIndex].Attributes &
+					DANGER_MASK) >> DANGER_SHIFT;
+
+			if (TFB_Random () % 128 < danger_vals[dangerLevel])
+			{
+				PlaySound (SetAbsSoundIndex (
+						LanderSounds, BIOLOGICAL_DISASTER),
+						NotPositional (), NULL,
+						GAME_SOUND_PRIORITY);
+				DeltaLanderCrew (-1, BIOLOGICAL_DISASTER);
 			}
+			return;
+		}
 
-			{
-				COUNT scan, NumRetrieved;
-				SIZE which_node;
+		NumRetrieved = ElementPtr->mass_points;
+	}
+	else if (ElementPtr->state_flags & FINITE_LIFE)
+	{
+		/* Collision of a stun bolt with a natural disaster */
+		return;
+	}
+	else
+	{
+		BYTE value;
 
-				scan = LOBYTE (ElementPtr->scan_node);
-				if (pLanderPrim == 0)
-				{
-					/* Collision of lander with another object */
-					if (crew_left == 0 || pPSD->InTransit)
-						break;
+		if (scan == ENERGY_SCAN)
+		{
+			/* Collision of a stun bolt with an energy node */
+			return;
+		}
 
-					if (ElementPtr->state_flags & FINITE_LIFE)
-					{
-						/* A natural disaster */
-						scan = ElementPtr->mass_points;
-						switch (scan)
-						{
-							case EARTHQUAKE_DISASTER:
-							case LAVASPOT_DISASTER:
-								if (TFB_Random () % 100 < 25)
-									DeltaLanderCrew (-1, scan);
-								break;
-						}
-
-						UnlockElement (hElement);
-						continue;
-					}
-					else if (scan == ENERGY_SCAN)
-					{
-						// noop; handled by generation funcs, see below
-					}
-					else if (scan == BIOLOGICAL_SCAN && ElementPtr->hit_points)
-					{
-						BYTE danger_vals[] =
-						{
-							0, 6, 13, 26
-						};
-						int creatureIndex = ElementPtr->mass_points
-								& ~CREATURE_AWARE;
-						int dangerLevel =
-								(CreatureData[creatureIndex].Attributes &
-								DANGER_MASK) >> DANGER_SHIFT;
-
-						if (TFB_Random () % 128 < danger_vals[dangerLevel])
-						{
-							PlaySound (SetAbsSoundIndex (
-									LanderSounds, BIOLOGICAL_DISASTER),
-									NotPositional (), NULL,
-									GAME_SOUND_PRIORITY);
-							DeltaLanderCrew (-1, BIOLOGICAL_DISASTER);
-						}
-						UnlockElement (hElement);
-						continue;
-					}
+		if (scan == BIOLOGICAL_SCAN
+				&& (value = LONIBBLE (CreatureData[
+				ElementPtr->mass_points
+				& ~CREATURE_AWARE
+				].ValueAndHitPoints)))
+		{
+			/* Collision of a stun bolt with a viable creature */
+			shotCreature (ElementPtr, value, LanderControl, pPrim);
+			return;
+		}
 
-					NumRetrieved = ElementPtr->mass_points;
-				}
-				else if (ElementPtr->state_flags & FINITE_LIFE)
-				{
-					/* Collision of a stun bolt with a natural disaster */
-					UnlockElement (hElement);
-					continue;
-				}
-				else
-				{
-					BYTE value;
+		NumRetrieved = 0;
+	}
 
-					if (scan == ENERGY_SCAN)
-					{
-						/* Collision of a stun bolt with an energy node */
-						UnlockElement (hElement);
-						break;
-					}
+	if (NumRetrieved)
+	{
+		switch (scan)
+		{
+			case ENERGY_SCAN:
+				break;
+			case MINERAL_SCAN:
+				if (!pickupMineralNode (pPSD, NumRetrieved,
+						ElementPtr, LanderControl, ElementControl))
+					return;
+				break;
+			case BIOLOGICAL_SCAN:
+				if (!pickupBioNode (pPSD, NumRetrieved))
+					return;
+				break;
+		}
+	}
 
-					if (scan == BIOLOGICAL_SCAN
-							&& (value = LONIBBLE (CreatureData[
-							ElementPtr->mass_points
-							& ~CREATURE_AWARE
-							].ValueAndHitPoints)))
-					{
-						/* Collision of a stun bolt with a viable creature */
-						shotCreature (ElementPtr, value, &LanderControl,
-								pPrim);
-						UnlockElement (hElement);
-						break;
-					}
+	which_node = HIBYTE (ElementPtr->scan_node) - 1;
+	if (callPickupForScanType (pSolarSysState,
+			pSolarSysState->pOrbitalDesc, which_node, scan))
+	{	// Node retrieved, remove from the surface
+		setNodeRetrieved (&pSolarSysState->SysInfo.PlanetInfo,
+				scan, which_node);
+		SET_GAME_STATE (PLANETARY_CHANGE, 1);
+		ElementPtr->state_flags |= DISAPPEARING;
+	}
+}
 
-					NumRetrieved = 0;
-				}
+// Checks the lander (shot == NULL) or one of its shots against the
+// surface objects after it in the display list. The shots after it are
+// checked along the way.
+// XXX: That makes a shot checked once more for every shot before it, and
+//   so hit twice with two in flight; this is how it always was.
+static void
+CheckObjectCollision (const SURFACE_OBJECT *shot)
+{
+	INTERSECT_CONTROL LanderControl;
+	COUNT found[MAX_DISPLAY_PRIMS];
+	COUNT numFound, i;
 
-				if (NumRetrieved)
-				{
-					switch (scan)
-					{
-						case ENERGY_SCAN:
-							break;
-						case MINERAL_SCAN:
-							if (!pickupMineralNode (pPSD, NumRetrieved,
-									ElementPtr, &LanderControl,
-									&ElementControl))
-								continue;
-							break;
-						case BIOLOGICAL_SCAN:
-							if (!pickupBioNode (pPSD, NumRetrieved))
-								continue;
-							break;
-					}
-				}
+	if (shot)
+	{
+		LanderControl.IntersectStamp =
+				DisplayArray[shot->PrimIndex].Object.Stamp;
+		numFound = FindSurfaceObjects (found, shot->location,
+				frameReach (LanderControl.IntersectStamp.frame),
+				shot->order);
+	}
+	else
+	{
+		LanderControl.IntersectStamp.origin.x = SURFACE_WIDTH >> 1;
+		LanderControl.IntersectStamp.origin.y = SURFACE_HEIGHT >> 1;
+		LanderControl.IntersectStamp.frame = LanderFrame[0];
+		numFound = FindSurfaceObjects (found, curLanderLoc,
+				frameReach (LanderFrame[0]), -MAX_DISPLAY_PRIMS - 1);
+	}
+	LanderControl.EndPoint = LanderControl.IntersectStamp.origin;
 
-				which_node = HIBYTE (ElementPtr->scan_node) - 1;
-				if (callPickupForScanType (pSolarSysState,
-						pSolarSysState->pOrbitalDesc, which_node, scan))
-				{	// Node retrieved, remove from the surface
-					setNodeRetrieved (&pSolarSysState->SysInfo.PlanetInfo,
-							scan, which_node);
-					SET_GAME_STATE (PLANETARY_CHANGE, 1);
-					ElementPtr->state_flags |= DISAPPEARING;
-				}
-				UnlockElement (hElement);
-			}
+	for (i = 0; i < numFound; ++i)
+	{
+		const SURFACE_OBJECT *obj = &surfaceObjects[found[i]];
+		INTERSECT_CONTROL ElementControl;
+		PRIMITIVE *pPrim;
+		ELEMENT *ElementPtr;
+
+		if (obj->isShot)
+		{
+			CheckObjectCollision (obj);
+			continue;
+		}
+
+		pPrim = &DisplayArray[obj->PrimIndex];
+		ElementControl.IntersectStamp = pPrim->Object.Stamp;
+		ElementControl.EndPoint = ElementControl.IntersectStamp.origin;
+
+		if (!DrawablesIntersect (&LanderControl,
+				&ElementControl, MAX_TIME_VALUE))
+			continue;
+
+		if (shot)
+		{	// The shot is spent
+			LockElement (shot->hElement, &ElementPtr);
+			ElementPtr->state_flags |= DISAPPEARING;
+			UnlockElement (shot->hElement);
 		}
+
+		LockElement (obj->hElement, &ElementPtr);
+		if (ElementPtr->playerNr == PS_NON_PLAYER)
+			hitSurfaceObject (ElementPtr, pPrim, shot == NULL,
+					&LanderControl, &ElementControl);
+		UnlockElement (obj->hElement);
 	}
 }
 
@@ -1008,9 +1177,12 @@ BuildObjectList (void)
 	DWORD rand_val;
 	POINT org;
 	HELEMENT hElement, hNextElement;
+	SIZE numInserted;
 	PLANETSIDE_DESC *pPSD = planetSideDesc;
 
 	DisplayLinks = MakeLinks (END_OF_LIST, END_OF_LIST);
+	ClearSurfaceObjects ();
+	numInserted = 0;
 	
 	lander_flags &= ~KILL_CREW;
 
@@ -1100,10 +1272,17 @@ BuildObjectList (void)
 					ElementPtr->next.location.y
 					- org.y + (SURFACE_HEIGHT >> 1);
 
+			++numInserted;
 			if (lander_flags & ADD_AT_END)
+			{
 				InsertPrim (&DisplayLinks, ElementPtr->PrimIndex, END_OF_LIST);
+				AddSurfaceObject (hElement, ElementPtr, -numInserted);
+			}
 			else
+			{
 				InsertPrim (&DisplayLinks, ElementPtr->PrimIndex, GetPredLink (DisplayLinks));
+				AddSurfaceObject (hElement, ElementPtr, numInserted);
+			}
 		}
 
 		hNextElement = GetSuccElement (ElementPtr);
@@ -1218,7 +1397,7 @@ ScrollPlanetSide (SIZE dx, SIZE dy, int landingOffset)
 	
 	if (landingOffset == ON_THE_GROUND && crew_left
 			&& GetPredLink (DisplayLinks) != END_OF_LIST)
-		CheckObjectCollision (END_OF_LIST);
+		CheckObjectCollision (NULL);
 
 	{
 		PLANETSIDE_DESC *pPSD = planetSideDesc;
@@ -310,7 +310,6 @@ FreePlanet (void)
 	DestroyColorMap (ReleaseColorMap (pSolarSysState->OrbitalCMap));
 	pSolarSysState->OrbitalCMap = 0;
 
-	HFree (Orbit->lpTopoData);
 	Orbit->lpTopoData = 0;
 	DestroyDrawable (ReleaseDrawable (Orbit->TopoZoomFrame));
 	Orbit->TopoZoomFrame = 0;
@@ -326,10 +325,12 @@ FreePlanet (void)
 	DestroyDrawable (ReleaseDrawable (Orbit->WorkFrame));
 	Orbit->WorkFrame = 0;
 
-	HFree (Orbit->TopoColors);
 	Orbit->TopoColors = NULL;
-	HFree (Orbit->ScratchArray);
 	Orbit->ScratchArray = NULL;
+	MemArena_delete (Orbit->Arena);
+	Orbit->Arena = NULL;
+	HFree (Orbit->SphereCache);
+	Orbit->SphereCache = NULL;
 
 	DestroyStringTable (ReleaseStringTable (
 			pSolarSysState->SysInfo.PlanetInfo.DiscoveryString
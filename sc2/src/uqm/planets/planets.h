@@ -20,6 +20,7 @@
 #define UQM_PLANETS_PLANETS_H_
 
 #include "libs/mathlib.h"
+#include "libs/memory/arena.h"
 
 #define END_INTERPLANETARY START_INTERPLANETARY
 
@@ -174,8 +175,14 @@ struct planet_orbit
 			// RGBA version of topo image; for 3d planet
 	Color *ScratchArray;
 			// temp RGBA data for whatever transforms (nuked often)
+	BYTE *SphereCache;
+			// rotating 3d planet frames already rendered, if kept;
+			// see RenderPlanetSphere()
 	FRAME WorkFrame;
 			// any extra frame workspace (for dynamic objects)
+	MemArena *Arena;
+			// lpTopoData, TopoColors and ScratchArray live here, and
+			// the scratch space of GeneratePlanetSurface()
 };
 
 // See doc/devel/generate for information on how this structure is
@@ -304,8 +311,19 @@ extern void RotatePlanetSphere (BOOLEAN keepRate);
 extern void DrawScannedObjects (BOOLEAN Reversed);
 extern void GeneratePlanetSurface (PLANET_DESC *pPlanetDesc,
 		FRAME SurfDefFrame);
-extern void DeltaTopography (COUNT num_iterations, SBYTE *DepthArray,
-		RECT *pRect, SIZE depth_delta);
+extern void StartSurfaceGeneration (const PLANET_DESC *planet,
+		const PLANET_DESC *moons);
+extern void StopSurfaceGeneration (void);
+extern void PlanetGen_PerfTest (void);
+extern BOOLEAN TopoCache_Has (const PLANET_DESC *world);
+extern BOOLEAN TopoCache_Get (const PLANET_DESC *world, SBYTE *topo,
+		const SBYTE **lightMap, DWORD *endSeed);
+extern void TopoCache_Put (const PLANET_DESC *world, const SBYTE *topo,
+		const SBYTE *lightMap, DWORD endSeed);
+extern void TopoCache_Uninit (void);
+extern void DeltaTopography (RandomContext *rng, COUNT num_iterations,
+		SBYTE *DepthArray, RECT *pRect, SIZE depth_delta);
+extern void UninitSphereTiltCache (void);
 
 extern void DrawPlanetSurfaceBorder (void);
 
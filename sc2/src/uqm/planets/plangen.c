@@ -27,8 +27,17 @@
 #include "libs/mathlib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/platform.h"
+#include "libs/tasklib.h"
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
 #include <math.h>
 #include <time.h>
+#ifdef SSE2_INTRIN
+#	include <emmintrin.h>
+#elif defined(NEON_INTRIN)
+#	include <arm_neon.h>
+#endif
 
 
 #undef PROFILE_ROTATION
@@ -40,7 +49,6 @@
 #define SHIELD_GLOW_COMP    120
 #define SHIELD_REFLECT_COMP 100
 
-#define NUM_BATCH_POINTS 64
 #define RADIUS 37
 //2*RADIUS
 #define TWORADIUS (RADIUS << 1)
@@ -87,13 +95,56 @@ typedef struct
 	double x, y, z;
 } POINT3;
 
+// The colour of each elevation byte, as it is stored in the map
 static void
-RenderTopography (FRAME DstFrame, SBYTE *pTopoData, int w, int h)
+BuildTopoColorTable (Color *table, const PlanetFrame *PlanDataPtr,
+		const BYTE *xlat_tab, const BYTE *cbase)
+{
+	int i;
+	BYTE AlgoType = PLANALGO (PlanDataPtr->Type);
+	SIZE base = PlanDataPtr->base_elevation;
+
+	for (i = 0; i < 256; ++i)
+	{
+		SIZE d = (SBYTE) i;
+		const BYTE *ctab;
+
+		if (AlgoType == GAS_GIANT_ALGO)
+		{	// make elevation value non-negative
+			d &= 255;
+		}
+		else
+		{
+			d += base;
+			if (d < 0)
+				d = 0;
+			else if (d > 255)
+				d = 255;
+		}
+
+		d = xlat_tab[d] - cbase[0];
+		ctab = (cbase + 2) + d * 3;
+
+		// fixed planet surfaces being too dark
+		// ctab shifts were previously >> 3 .. -Mika
+		table[i] = BUILD_COLOR (MAKE_RGB15 (ctab[0] >> 1,
+				ctab[1] >> 1, ctab[2] >> 1), d);
+	}
+}
+
+static void
+MapTopoColors (Color *pix, const SBYTE *pTopoData, COUNT count,
+		const Color *table)
 {
-	FRAME OldFrame;
+	const BYTE *src = (const BYTE *) pTopoData;
 
-	OldFrame = SetContextFGFrame (DstFrame);
+	for (; count; --count, ++pix, ++src)
+		*pix = table[*src];
+}
 
+static void
+RenderTopography (FRAME DstFrame, SBYTE *pTopoData, int w, int h)
+{
 	if (pSolarSysState->XlatRef == 0)
 	{
 		// There is currently nothing we can do w/o an xlat table
@@ -102,95 +153,26 @@ RenderTopography (FRAME DstFrame, SBYTE *pTopoData, int w, int h)
 	}
 	else
 	{
-		COUNT i;
-		BYTE AlgoType;
-		SIZE base, d;
-		const XLAT_DESC *xlatDesc;
-		POINT pt;
 		const PlanetFrame *PlanDataPtr;
-		PRIMITIVE BatchArray[NUM_BATCH_POINTS];
-		PRIMITIVE *pBatch;
-		SBYTE *pSrc;
-		const BYTE *xlat_tab;
-		BYTE *cbase;
-		POINT oldOrigin;
-		RECT ClipRect;
-
-		oldOrigin = SetContextOrigin (MAKE_POINT (0, 0));
-		GetContextClipRect (&ClipRect);
-		SetContextClipRect (NULL);
-
-		pBatch = &BatchArray[0];
-		for (i = 0; i < NUM_BATCH_POINTS; ++i, ++pBatch)
-		{
-			SetPrimNextLink (pBatch, i + 1);
-			SetPrimType (pBatch, POINT_PRIM);
-		}
-		SetPrimNextLink (&pBatch[-1], END_OF_LIST);
+		const XLAT_DESC *xlatDesc;
+		Color table[256];
+		Color *pix;
 
 		PlanDataPtr = &PlanData[
 				pSolarSysState->pOrbitalDesc->data_index & ~PLANET_SHIELDED
 				];
-		AlgoType = PLANALGO (PlanDataPtr->Type);
-		base = PlanDataPtr->base_elevation;
 		xlatDesc = (const XLAT_DESC *) pSolarSysState->XlatPtr;
-		xlat_tab = (const BYTE *) xlatDesc->xlat_tab;
-		cbase = GetColorMapAddress (pSolarSysState->OrbitalCMap);
-
-		i = NUM_BATCH_POINTS;
-		pBatch = &BatchArray[i];
-		pSrc = pTopoData;
-		for (pt.y = 0; pt.y < h; ++pt.y)
-		{
-			for (pt.x = 0; pt.x < w; ++pt.x, ++pSrc)
-			{
-				BYTE *ctab;
-
-				d = *pSrc;
-				if (AlgoType == GAS_GIANT_ALGO)
-				{	// make elevation value non-negative
-					d &= 255;
-				}
-				else
-				{
-					d += base;
-					if (d < 0)
-						d = 0;
-					else if (d > 255)
-						d = 255;
-				}
-
-				--pBatch;
-				pBatch->Object.Point.x = pt.x;
-				pBatch->Object.Point.y = pt.y;
-
-				d = xlat_tab[d] - cbase[0];
-				ctab = (cbase + 2) + d * 3;
-
-				// fixed planet surfaces being too dark
-				// ctab shifts were previously >> 3 .. -Mika
-				SetPrimColor (pBatch, BUILD_COLOR (MAKE_RGB15 (ctab[0] >> 1,
-								ctab[1] >> 1, ctab[2] >> 1), d));
-				
-				if (--i == 0)
-				{	// flush the batch and start the next one
-					DrawBatch (BatchArray, 0, 0);
-					i = NUM_BATCH_POINTS;
-					pBatch = &BatchArray[i];
-				}
-			}
-		}
-
-		if (i < NUM_BATCH_POINTS)
-		{
-			DrawBatch (BatchArray, i, 0);
-		}
-
-		SetContextClipRect (&ClipRect);
-		SetContextOrigin (oldOrigin);
+		BuildTopoColorTable (table, PlanDataPtr,
+				(const BYTE *) xlatDesc->xlat_tab,
+				GetColorMapAddress (pSolarSysState->OrbitalCMap));
+
+		// Written to the frame in one go rather than drawn as points;
+		// frames are drawn to directly, so this is the same
+		pix = HMalloc (sizeof (Color) * w * h);
+		MapTopoColors (pix, pTopoData, w * h, table);
+		WriteFramePixelColors (DstFrame, pix, w, h);
+		HFree (pix);
 	}
-
-	SetContextFGFrame (OldFrame);
 }
 
 static inline void
@@ -227,12 +209,20 @@ P3norm (POINT3 *res, POINT3 *vec)
 static void
 GenerateSphereMask (POINT loc)
 {
+	static POINT madeLoc;
+	static BOOLEAN made = FALSE;
+			// light_diff only depends on loc, and it is only written here
 	POINT pt;
 	POINT3 light;
 	double lrad;
 	const DWORD step = 1 << DIFFUSE_BITS;
 	int y, x;
 
+	if (made && loc.x == madeLoc.x && loc.y == madeLoc.y)
+		return;
+	madeLoc = loc;
+	made = TRUE;
+
 #define AMBIENT_LIGHT 0.1
 #define LIGHT_Z       1.2
 	// lrad is the distance from the sun to the planet
@@ -395,49 +385,10 @@ create_aa_points (MAP3D_POINT *ppt, double x, double y)
 		ppt->m[i] = (DWORD)(m[i] * (1 << AA_WEIGHT_BITS) + 0.5);
 }
 
-static inline BYTE
-get_color_channel (Color c, int channel)
-{
-	switch (channel)
-	{
-		case 0:
-			return c.r;
-		case 1:
-			return c.g;
-		case 2:
-			return c.b;
-		default:
-			return 0;
-	}
-}
-
-// Creates either a red, green, or blue value by
-// computing the weighted averages of the 4 points in p
-static BYTE
-get_avg_channel (Color p[4], DWORD mult[4], int channel)
-{
-	COUNT j;
-	DWORD ci = 0;
-	
-	//sum(mult[])==65536
-	//c is the red/green/blue value of this pixel
-	for (j = 0; j < 4; j++)
-	{
-		BYTE c = get_color_channel (p[j], channel);
-		ci += c * mult[j];
-	}
-	ci >>= AA_WEIGHT_BITS;
-	//check for overflow
-	if (ci > 255)
-		ci = 255;
-	
-	return ((UBYTE)ci);
-}
-
-// CreateSphereTiltMap creates 'map_rotate' to map the topo data
+// CalcSphereTiltMap creates 'map_rotate' to map the topo data
 //  for a tilted planet.  It also does the sphere->plane mapping
 static void
-CreateSphereTiltMap (int angle)
+CalcSphereTiltMap (int angle)
 {
 	int x, y;
 	const double multx = ((double)SPHERE_SPAN_X / M_PI);
@@ -493,6 +444,78 @@ CreateSphereTiltMap (int angle)
 	}
 }
 
+// The tilt maps made last, as a planet and its moons mostly have
+// different tilts. The current one is in map_rotate.
+#define TILT_CACHE_SIZE 4
+
+typedef struct
+{
+	MAP3D_POINT *map;
+			// NULL if the entry is not used
+	int angle;
+	DWORD lastUse;
+} TILT_CACHE_ENTRY;
+
+static TILT_CACHE_ENTRY tiltCache[TILT_CACHE_SIZE];
+static DWORD tiltCacheUse;
+static int tiltMapAngle;
+static BOOLEAN tiltMapMade = FALSE;
+		// Of map_rotate
+
+// CreateSphereTiltMap makes 'map_rotate' for a tilt angle. The maps
+//  for the last few angles are kept, so that the floating point math
+//  is only done once for each.
+static void
+CreateSphereTiltMap (int angle)
+{
+	TILT_CACHE_ENTRY *e;
+	TILT_CACHE_ENTRY *oldest = &tiltCache[0];
+	COUNT i;
+
+	if (tiltMapMade && tiltMapAngle == angle)
+		return;
+
+	for (i = 0; i < TILT_CACHE_SIZE; ++i)
+	{
+		e = &tiltCache[i];
+		if (e->map && e->angle == angle)
+		{
+			memcpy (map_rotate, e->map, sizeof (map_rotate));
+			e->lastUse = ++tiltCacheUse;
+			tiltMapAngle = angle;
+			tiltMapMade = TRUE;
+			return;
+		}
+		if (!e->map || (oldest->map && e->lastUse < oldest->lastUse))
+			oldest = e;
+	}
+
+	CalcSphereTiltMap (angle);
+	tiltMapAngle = angle;
+	tiltMapMade = TRUE;
+
+	if (!oldest->map)
+		oldest->map = HMalloc (sizeof (map_rotate));
+	if (oldest->map)
+	{
+		memcpy (oldest->map, map_rotate, sizeof (map_rotate));
+		oldest->angle = angle;
+		oldest->lastUse = ++tiltCacheUse;
+	}
+}
+
+void
+UninitSphereTiltCache (void)
+{
+	COUNT i;
+
+	for (i = 0; i < TILT_CACHE_SIZE; ++i)
+	{
+		HFree (tiltCache[i].map);
+		tiltCache[i].map = NULL;
+	}
+}
+
 //CreateShieldMask
 // The shield is created in two parts.  This routine creates the Halo.
 // The red tint of the planet is currently applied in RenderPlanetSphere
@@ -684,32 +707,397 @@ calc_map_light (UBYTE val, DWORD dif, int lvf)
 	return ((UBYTE)i);
 }
 
-static inline Color
-get_map_pixel (Color *pixels, int x, int y)
+// The sphere as RenderPlanetSphere() walks it, one entry per lit
+//  pixel, made from map_rotate and light_diff by PrepareSphereTables().
+//  The pixels taken straight from the topo map come first, then the
+//  ones blended from 4, so that the blend can be done several pixels
+//  at a time.
+static COUNT sphere_count;
+		// number of lit pixels
+static COUNT sphere_exact;
+		// number of those taken straight from the topo map
+static UWORD sphere_dst[DIAMETER * DIAMETER];
+		// index of the pixel in the sphere frame
+static DWORD sphere_src[4][DIAMETER * DIAMETER];
+		// offsets of the topo colors; only the first for exact pixels
+static UWORD sphere_weight[4][DIAMETER * DIAMETER];
+		// blend weights of the topo colors
+static DWORD sphere_elev[DIAMETER * DIAMETER];
+		// offset of the elevation at rotation 0
+static UWORD sphere_elev_x[DIAMETER * DIAMETER];
+		// its x, to know when the rotation wraps it around
+static DWORD sphere_weight_sum[DIAMETER * DIAMETER];
+		// sum of the blend weights, which the elevation is scaled by
+static UWORD sphere_diff_hi[DIAMETER * DIAMETER];
+static UWORD sphere_diff_lo[DIAMETER * DIAMETER];
+		// the light_diff of the pixel, in two halves
+static UWORD sphere_shield[DIAMETER * DIAMETER];
+		// red added by the shield, before throbbing
+
+// PrepareSphereTables builds the tables above. Called once the light
+//  and tilt maps are made; they do not change while in orbit.
+static void
+PrepareSphereTables (void)
+{
+	int x, y;
+	COUNT exact, blend;
+	COUNT i;
+
+	// count the exact pixels first, so that the blended ones can be
+	// filled in after them in the same pass
+	exact = 0;
+	for (y = 0; y < DIAMETER; ++y)
+	{
+		for (x = 0; x < DIAMETER; ++x)
+		{
+			const MAP3D_POINT *ppt = &map_rotate[y][x];
+
+			if (light_diff[y][x] == 0)
+				continue;
+			if (ppt->m[0] == 0 || ppt->m[0] > 0xffff || ppt->m[1] > 0xffff
+					|| ppt->m[2] > 0xffff || ppt->m[3] > 0xffff)
+				++exact;
+		}
+	}
+
+	sphere_exact = exact;
+	exact = 0;
+	blend = sphere_exact;
+	for (y = 0; y < DIAMETER; ++y)
+	{
+		for (x = 0; x < DIAMETER; ++x)
+		{
+			const MAP3D_POINT *ppt = &map_rotate[y][x];
+			DWORD diffus = light_diff[y][x];
+			int j;
+
+			if (diffus == 0)
+				continue; // full diffusion; stays clear
+
+			if (ppt->m[0] == 0)
+			{	// exact pixel from the topo map
+				i = exact++;
+				sphere_src[0][i] = ppt->p[0].y * (MAP_WIDTH + SPHERE_SPAN_X)
+						+ ppt->p[0].x;
+			}
+			else
+			{
+				// A weight of 1.0 leaves no room for the others; that
+				// is one point of the topo map taken as it is
+				for (j = 0; j < 4 && ppt->m[j] <= 0xffff; ++j)
+					;
+				if (j < 4)
+				{
+					i = exact++;
+					sphere_src[0][i] = ppt->p[j].y
+							* (MAP_WIDTH + SPHERE_SPAN_X) + ppt->p[j].x;
+				}
+				else
+				{
+					i = blend++;
+					sphere_weight_sum[i] = 0;
+					for (j = 0; j < 4; ++j)
+					{
+						sphere_src[j][i] = ppt->p[j].y
+								* (MAP_WIDTH + SPHERE_SPAN_X) + ppt->p[j].x;
+						sphere_weight[j][i] = (UWORD) ppt->m[j];
+						sphere_weight_sum[i] += ppt->m[j];
+					}
+				}
+			}
+
+			sphere_dst[i] = y * DIAMETER + x;
+			// the light variance comes from the first point only
+			sphere_elev[i] = ppt->p[0].y * MAP_WIDTH + ppt->p[0].x;
+			sphere_elev_x[i] = ppt->p[0].x;
+			sphere_diff_hi[i] = (UWORD) (diffus >> 16);
+			sphere_diff_lo[i] = (UWORD) diffus;
+			sphere_shield[i] = calc_map_light (SHIELD_REFLECT_COMP,
+					diffus, 0) + SHIELD_GLOW_COMP;
+		}
+	}
+	sphere_count = blend;
+
+	// whatever was rendered is for another sphere
+	HFree (pSolarSysState->Orbit.SphereCache);
+	pSolarSysState->Orbit.SphereCache = NULL;
+}
+
+static inline int
+get_sphere_elev (const SBYTE *elevs, COUNT i, int offset)
 {
-	return pixels[y * (MAP_WIDTH + SPHERE_SPAN_X) + x];
+	// offset and x are both below MAP_WIDTH
+	if (sphere_elev_x[i] + offset >= MAP_WIDTH)
+		offset -= MAP_WIDTH;
+	return elevs[sphere_elev[i] + offset];
 }
 
+// The light variance factor of blended pixel i; the weights need not
+// add up to exactly 1.0
 static inline int
-get_map_elev (SBYTE *elevs, int x, int y, int offset)
+get_blended_elev (const SBYTE *elevs, COUNT i, int offset)
+{
+	return (get_sphere_elev (elevs, i, offset)
+			* (int) sphere_weight_sum[i]) >> AA_WEIGHT_BITS;
+}
+
+// Creates either a red, green, or blue value by
+// computing the weighted averages of the 4 points of pixel i
+static inline BYTE
+get_avg_channel (const Color *pixels, COUNT i, int shift)
+{
+	const DWORD *pix32 = (const DWORD *) pixels;
+	COUNT j;
+	DWORD ci = 0;
+
+	//sum(weights)==65536
+	for (j = 0; j < 4; j++)
+	{
+		DWORD c = (pix32[sphere_src[j][i]] >> shift) & 0xff;
+		ci += c * sphere_weight[j][i];
+	}
+	ci >>= AA_WEIGHT_BITS;
+	//check for overflow
+	if (ci > 255)
+		ci = 255;
+
+	return ((UBYTE)ci);
+}
+
+// Apply the lighting model to the topo color c of pixel i
+static inline Color
+light_sphere_pixel (Color c, COUNT i, int lvf, BOOLEAN shielded,
+		int shLevel)
+{
+	DWORD diffus = ((DWORD)sphere_diff_hi[i] << 16) | sphere_diff_lo[i];
+
+	if (shielded)
+	{
+		int r;
+
+		// add lite red filter (3/4) component
+		c.g = (c.g >> 1) + (c.g >> 2);
+		c.b = (c.b >> 1) + (c.b >> 2);
+
+		c.r = calc_map_light (c.r, diffus, lvf);
+		c.g = calc_map_light (c.g, diffus, lvf);
+		c.b = calc_map_light (c.b, diffus, lvf);
+
+		// The shield is glow + reflect (+ filter for others)
+		r = sphere_shield[i];
+		if (shLevel != THROB_MAX_LEVEL)
+		{	// adjust red level for throbbing shield
+			r = r * shLevel / THROB_MAX_LEVEL;
+		}
+
+		r += c.r;
+		if (r > 255)
+			r = 255;
+		c.r = r;
+	}
+	else
+	{
+		c.r = calc_map_light (c.r, diffus, lvf);
+		c.g = calc_map_light (c.g, diffus, lvf);
+		c.b = calc_map_light (c.b, diffus, lvf);
+	}
+
+	c.a = 0xff;
+	return c;
+}
+
+#ifdef SSE2_INTRIN
+// calc_map_light() for 8 pixels; val is 0..255, lvf -128..127
+static inline __m128i
+calc_map_light_sse2 (__m128i val, __m128i dhi, __m128i dlo, __m128i lvf)
 {
-	return elevs[y * MAP_WIDTH + (offset + x) % MAP_WIDTH];
+	// (dif * val) >> DIFFUSE_BITS, with dif split in 16 bit halves
+	__m128i i = _mm_add_epi16 (_mm_mullo_epi16 (dhi, val),
+			_mm_mulhi_epu16 (dlo, val));
+	// (lvf * val) >> 7; the product fits in 16 bits
+	i = _mm_add_epi16 (i, _mm_srai_epi16 (_mm_mullo_epi16 (lvf, val), 7));
+
+	i = _mm_max_epi16 (i, _mm_setzero_si128 ());
+	return _mm_min_epi16 (i, _mm_set1_epi16 (255));
+}
+
+// The blended pixels from first on, 8 at a time; returns where it
+// stopped, for the plain C loop to do the rest. The results are the
+// same as from get_avg_channel() and light_sphere_pixel().
+static COUNT
+render_blended_sse2 (Color *dst, const Color *pixels, const SBYTE *elevs,
+		int offset, COUNT first, BOOLEAN shielded, int shLevel)
+{
+	const DWORD *pix32 = (const DWORD *) pixels;
+	const __m128i byteMask = _mm_set1_epi32 (0xff);
+	DWORD *dst32 = (DWORD *) dst;
+	COUNT i;
+
+	for (i = first; i + 8 <= sphere_count; i += 8)
+	{
+		__m128i sum[3][2];
+		__m128i ch[3];
+		__m128i dhi, dlo, lvf, lo, hi;
+		DWORD out[8];
+		int j, k;
+
+		for (k = 0; k < 3; ++k)
+			sum[k][0] = sum[k][1] = _mm_setzero_si128 ();
+
+		for (j = 0; j < 4; ++j)
+		{
+			const DWORD *src = sphere_src[j] + i;
+			__m128i w = _mm_loadu_si128 (
+					(const __m128i *) (sphere_weight[j] + i));
+			__m128i c0 = _mm_set_epi32 (pix32[src[3]], pix32[src[2]],
+					pix32[src[1]], pix32[src[0]]);
+			__m128i c1 = _mm_set_epi32 (pix32[src[7]], pix32[src[6]],
+					pix32[src[5]], pix32[src[4]]);
+
+			for (k = 0; k < 3; ++k)
+			{
+				// one channel of the 8 colors, times the weights
+				__m128i c = _mm_packs_epi32 (
+						_mm_and_si128 (_mm_srli_epi32 (c0, k * 8), byteMask),
+						_mm_and_si128 (_mm_srli_epi32 (c1, k * 8), byteMask));
+				lo = _mm_mullo_epi16 (c, w);
+				hi = _mm_mulhi_epu16 (c, w);
+				sum[k][0] = _mm_add_epi32 (sum[k][0],
+						_mm_unpacklo_epi16 (lo, hi));
+				sum[k][1] = _mm_add_epi32 (sum[k][1],
+						_mm_unpackhi_epi16 (lo, hi));
+			}
+		}
+		for (k = 0; k < 3; ++k)
+		{
+			ch[k] = _mm_packs_epi32 (
+					_mm_srli_epi32 (sum[k][0], AA_WEIGHT_BITS),
+					_mm_srli_epi32 (sum[k][1], AA_WEIGHT_BITS));
+			ch[k] = _mm_min_epi16 (ch[k], _mm_set1_epi16 (255));
+		}
+
+		dhi = _mm_loadu_si128 ((const __m128i *) (sphere_diff_hi + i));
+		dlo = _mm_loadu_si128 ((const __m128i *) (sphere_diff_lo + i));
+		lvf = _mm_set_epi16 (
+				get_blended_elev (elevs, i + 7, offset),
+				get_blended_elev (elevs, i + 6, offset),
+				get_blended_elev (elevs, i + 5, offset),
+				get_blended_elev (elevs, i + 4, offset),
+				get_blended_elev (elevs, i + 3, offset),
+				get_blended_elev (elevs, i + 2, offset),
+				get_blended_elev (elevs, i + 1, offset),
+				get_blended_elev (elevs, i, offset));
+
+		if (shielded)
+		{
+			__m128i r;
+
+			// add lite red filter (3/4) component
+			ch[1] = _mm_add_epi16 (_mm_srli_epi16 (ch[1], 1),
+					_mm_srli_epi16 (ch[1], 2));
+			ch[2] = _mm_add_epi16 (_mm_srli_epi16 (ch[2], 1),
+					_mm_srli_epi16 (ch[2], 2));
+			for (k = 0; k < 3; ++k)
+				ch[k] = calc_map_light_sse2 (ch[k], dhi, dlo, lvf);
+
+			r = _mm_loadu_si128 ((const __m128i *) (sphere_shield + i));
+			if (shLevel != THROB_MAX_LEVEL)
+			{	// r * shLevel / 256, as (r << 7) * (shLevel << 1) >> 16
+				r = _mm_mulhi_epu16 (_mm_slli_epi16 (r, 7),
+						_mm_set1_epi16 ((short) (shLevel << 1)));
+			}
+			ch[0] = _mm_min_epi16 (_mm_add_epi16 (r, ch[0]),
+					_mm_set1_epi16 (255));
+		}
+		else
+		{
+			for (k = 0; k < 3; ++k)
+				ch[k] = calc_map_light_sse2 (ch[k], dhi, dlo, lvf);
+		}
+
+		// r | g << 8 | b << 16 | 0xff << 24
+		lo = _mm_or_si128 (ch[0], _mm_slli_epi16 (ch[1], 8));
+		hi = _mm_or_si128 (ch[2], _mm_set1_epi16 ((short) 0xff00));
+		_mm_storeu_si128 ((__m128i *) out, _mm_unpacklo_epi16 (lo, hi));
+		_mm_storeu_si128 ((__m128i *) (out + 4), _mm_unpackhi_epi16 (lo, hi));
+		for (k = 0; k < 8; ++k)
+			dst32[sphere_dst[i + k]] = out[k];
+	}
+
+	return i;
+}
+#endif /* SSE2_INTRIN */
+
+// Lights the sphere for one rotation into pix
+static void
+render_sphere (Color *pix, int offset, BOOLEAN shielded, int shLevel)
+{
+	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
+	Color *pixels;
+	SBYTE *elevs;
+	COUNT i;
+
+	pixels = Orbit->TopoColors + offset;
+	elevs = Orbit->lpTopoData;
+
+	for (i = 0; i < sphere_exact; ++i)
+	{
+		pix[sphere_dst[i]] = light_sphere_pixel (pixels[sphere_src[0][i]],
+				i, get_sphere_elev (elevs, i, offset), shielded, shLevel);
+	}
+
+	i = sphere_exact;
+#ifdef SSE2_INTRIN
+	i = render_blended_sse2 (pix, pixels, elevs, offset, i, shielded,
+			shLevel);
+#endif
+	for (; i < sphere_count; ++i)
+	{	// fractional pixel -- blend from 4
+		Color c;
+
+		c.r = get_avg_channel (pixels, i, 0);
+		c.g = get_avg_channel (pixels, i, 8);
+		c.b = get_avg_channel (pixels, i, 16);
+		pix[sphere_dst[i]] = light_sphere_pixel (c, i,
+				get_blended_elev (elevs, i, offset), shielded, shLevel);
+	}
+}
+
+// With optPlanetFrameCache, each rotation is only rendered the first
+//  time it is shown. Orbit->SphereCache then holds a byte per rotation
+//  telling how it was rendered (0 if not yet), followed by the colors
+//  of the lit pixels of each rotation, 3 bytes each; the rest of the
+//  sphere is clear, and the lit pixels are opaque.
+#define SPHERE_CACHED_PLAIN 1
+#define SPHERE_CACHED_THROB 2
+
+static BYTE *
+get_sphere_cache (void)
+{
+	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
+
+	if (!Orbit->SphereCache)
+	{
+		Orbit->SphereCache = HMalloc (MAP_WIDTH
+				+ (size_t) MAP_WIDTH * sphere_count * 3);
+		if (!Orbit->SphereCache)
+			return NULL;
+		memset (Orbit->SphereCache, 0, MAP_WIDTH);
+	}
+	return Orbit->SphereCache;
 }
 
 // RenderPlanetSphere builds a frame for the rotating planet view
 // offset is effectively the angle of rotation around the planet's axis
-// We use the SDL routines to directly write to the SDL_Surface to improve performance
 void
 RenderPlanetSphere (FRAME MaskFrame, int offset, BOOLEAN doThrob)
 {
 	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
-	POINT pt;
 	Color *pix;
-	Color clear;
-	int x, y;
-	Color *pixels;
-	SBYTE *elevs;
+	BOOLEAN shielded;
 	int shLevel;
+	BYTE *cache;
+	BYTE how;
 
 #if PROFILE_ROTATION
 	static clock_t t = 0;
@@ -718,96 +1106,51 @@ RenderPlanetSphere (FRAME MaskFrame, int offset, BOOLEAN doThrob)
 	t1 = clock ();
 #endif
 
-
-	shLevel = shield_level (offset);
+	shielded = (pSolarSysState->pOrbitalDesc->data_index & PLANET_SHIELDED)
+			!= 0;
+	shLevel = doThrob ? shield_level (offset) : THROB_MAX_LEVEL;
+	how = doThrob ? SPHERE_CACHED_THROB : SPHERE_CACHED_PLAIN;
 
 	pix = Orbit->ScratchArray;
-	clear = BUILD_COLOR_RGBA (0, 0, 0, 0);
-	pixels = Orbit->TopoColors + offset;
-	elevs = Orbit->lpTopoData;
-	
-	for (pt.y = 0, y = -RADIUS; pt.y <= TWORADIUS; ++pt.y, ++y)
+	// these stay clear
+	memset (pix, 0, DIAMETER * DIAMETER * sizeof (pix[0]));
+
+	cache = optPlanetFrameCache ? get_sphere_cache () : NULL;
+	if (cache && cache[offset] == how)
+	{	// rendered before
+		const BYTE *src = cache + MAP_WIDTH
+				+ (size_t) offset * sphere_count * 3;
+		COUNT i;
+
+		for (i = 0; i < sphere_count; ++i, src += 3)
+		{
+			Color *c = &pix[sphere_dst[i]];
+			c->r = src[0];
+			c->g = src[1];
+			c->b = src[2];
+			c->a = 0xff;
+		}
+	}
+	else
 	{
-		for (pt.x = 0, x = -RADIUS; pt.x <= TWORADIUS; ++pt.x, ++x, ++pix)
+		render_sphere (pix, offset, shielded, shLevel);
+		if (cache)
 		{
-			Color c;
-			DWORD diffus = light_diff[pt.y][pt.x];
-			int i;
-			MAP3D_POINT *ppt = &map_rotate[pt.y][pt.x];
-			int lvf; // light variance factor
-	
-			if (diffus == 0)
-			{	// full diffusion
-				*pix = clear;
-				continue;
-			}
-
-			// get pixel from topo map and factor from light variance map
-			if (ppt->m[0] == 0) 
-			{	// exact pixel from the topo map
-				c = get_map_pixel (pixels, ppt->p[0].x, ppt->p[0].y);
-				lvf = get_map_elev (elevs, ppt->p[0].x, ppt->p[0].y, offset);
-			}
-			else
-			{	// fractional pixel -- blend from 4
-				Color p[4];
-				int lvsum;
-
-				// compute 'ideal' pixel
-				for (i = 0; i < 4; i++)
-					p[i] = get_map_pixel (pixels, ppt->p[i].x, ppt->p[i].y);
-				
-				c.r = get_avg_channel (p, ppt->m, 0);
-				c.g = get_avg_channel (p, ppt->m, 1);
-				c.b = get_avg_channel (p, ppt->m, 2);
-
-				// compute 'ideal' light variance
-				for (i = 0, lvsum = 0; i < 4; i++)
-					lvsum += get_map_elev (elevs, ppt->p[0].x, ppt->p[0].y,
-							offset) * ppt->m[i];
-				lvf = lvsum >> AA_WEIGHT_BITS;
-			}
-		
-			// Apply the lighting model.  This also bounds the sphere
-			// to make it circular.
-			if (pSolarSysState->pOrbitalDesc->data_index & PLANET_SHIELDED)
-			{
-				int r;
-				
-				// add lite red filter (3/4) component
-				c.g = (c.g >> 1) + (c.g >> 2);
-				c.b = (c.b >> 1) + (c.b >> 2);
-
-				c.r = calc_map_light (c.r, diffus, lvf);
-				c.g = calc_map_light (c.g, diffus, lvf);
-				c.b = calc_map_light (c.b, diffus, lvf);
-
-				// The shield is glow + reflect (+ filter for others)
-				r = calc_map_light (SHIELD_REFLECT_COMP, diffus, 0);
-				r += SHIELD_GLOW_COMP;
-				
-				if (doThrob)
-				{	// adjust red level for throbbing shield
-					r = r * shLevel / THROB_MAX_LEVEL;
-				}
+			BYTE *dst = cache + MAP_WIDTH
+					+ (size_t) offset * sphere_count * 3;
+			COUNT i;
 
-				r += c.r;
-				if (r > 255)
-					r = 255;
-				c.r = r;
-			} 
-			else
+			for (i = 0; i < sphere_count; ++i, dst += 3)
 			{
-				c.r = calc_map_light (c.r, diffus, lvf);
-				c.g = calc_map_light (c.g, diffus, lvf);
-				c.b = calc_map_light (c.b, diffus, lvf);
+				const Color *c = &pix[sphere_dst[i]];
+				dst[0] = c->r;
+				dst[1] = c->g;
+				dst[2] = c->b;
 			}
-
-			c.a = 0xff;
-			*pix = c;
+			cache[offset] = how;
 		}
 	}
-	
+
 	WriteFramePixelColors (MaskFrame, Orbit->ScratchArray, DIAMETER, DIAMETER);
 	SetFrameHot (MaskFrame, MAKE_HOT_SPOT (RADIUS + 1, RADIUS + 1));
 
@@ -831,23 +1174,40 @@ RenderPlanetSphere (FRAME MaskFrame, int offset, BOOLEAN doThrob)
 #define RANGE_SHIFT 6
 
 static void
-DitherMap (SBYTE *DepthArray)
+DitherMap (RandomContext *rng, SBYTE *DepthArray)
 {
 #define DITHER_VARIANCE  (1 << (RANGE_SHIFT - 3))
+#define DITHER_BATCH 256
+		// Random values drawn at a time; each does 4 points
 	COUNT i;
 	SBYTE *elev;
-	DWORD rand_val = 0;
+	DWORD rand_vals[DITHER_BATCH];
+	COUNT num_vals = (MAP_WIDTH * MAP_HEIGHT + 3) / 4;
 
-	for (i = 0, elev = DepthArray; i < MAP_WIDTH * MAP_HEIGHT; ++i, ++elev)
+	elev = DepthArray;
+	for (i = 0; i < num_vals; i += DITHER_BATCH)
 	{
-		// Use up the random value byte by byte
-		if ((i & 3) == 0)
-			rand_val = RandomContext_Random (SysGenRNG);
-		else
-			rand_val >>= 8;
+		COUNT count = num_vals - i < DITHER_BATCH ?
+				num_vals - i : DITHER_BATCH;
+		COUNT j;
 
-		// Bring the elevation point up or down
-		*elev += DITHER_VARIANCE / 2 - (rand_val & (DITHER_VARIANCE - 1));
+		RandomContext_FillRandom (rng, rand_vals, count);
+		for (j = 0; j < count; ++j)
+		{
+			// Use up the random value byte by byte
+			DWORD rand_val = rand_vals[j];
+			COUNT points = (i + j) * 4;
+			COUNT k;
+
+			for (k = 0; k < 4 && points + k < MAP_WIDTH * MAP_HEIGHT;
+					++k, ++elev)
+			{
+				// Bring the elevation point up or down
+				*elev += DITHER_VARIANCE / 2
+						- (rand_val & (DITHER_VARIANCE - 1));
+				rand_val >>= 8;
+			}
+		}
 	}
 }
 
@@ -1044,7 +1404,7 @@ MakeCrater (RECT *pRect, SBYTE *DepthArray, SIZE rim_delta, SIZE
 #define NUM_BAND_COLORS 4
 
 static void
-MakeStorms (COUNT storm_count, SBYTE *DepthArray)
+MakeStorms (RandomContext *rng, COUNT storm_count, SBYTE *DepthArray)
 {
 #define MAX_STORMS 8
 	COUNT i;
@@ -1066,7 +1426,7 @@ MakeStorms (COUNT storm_count, SBYTE *DepthArray)
 
 			intersect = FALSE;
 
-			rand_val = RandomContext_Random (SysGenRNG);
+			rand_val = RandomContext_Random (rng);
 			loword = LOWORD (rand_val);
 			hiword = HIWORD (rand_val);
 			switch (HIBYTE (hiword) & 31)
@@ -1094,7 +1454,7 @@ MakeStorms (COUNT storm_count, SBYTE *DepthArray)
 			if (pstorm_r->extent.height <= 4)
 				pstorm_r->extent.height += 4;
 
-			rand_val = RandomContext_Random (SysGenRNG);
+			rand_val = RandomContext_Random (rng);
 			loword = LOWORD (rand_val);
 			hiword = HIWORD (rand_val);
 
@@ -1168,8 +1528,8 @@ MakeStorms (COUNT storm_count, SBYTE *DepthArray)
 }
 
 static void
-MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
-		depth_delta)
+MakeGasGiant (RandomContext *rng, COUNT num_bands, SBYTE *DepthArray,
+		RECT *pRect, SIZE depth_delta)
 {
 	COORD last_y, next_y;
 	SIZE band_error, band_bump, band_delta;
@@ -1183,7 +1543,7 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 	band_error = num_bands >> 1;
 	lpDst = DepthArray;
 
-	band_delta = ((LOWORD (RandomContext_Random (SysGenRNG))
+	band_delta = ((LOWORD (RandomContext_Random (rng))
 			& (NUM_BAND_COLORS - 1)) << RANGE_SHIFT)
 			+ (1 << (RANGE_SHIFT - 1));
 	last_y = next_y = 0;
@@ -1191,7 +1551,7 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 	{
 		COORD cur_y;
 
-		rand_val = RandomContext_Random (SysGenRNG);
+		rand_val = RandomContext_Random (rng);
 		loword = LOWORD (rand_val);
 		hiword = HIWORD (rand_val);
 
@@ -1213,7 +1573,7 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 			r.corner.x = r.corner.y = 0;
 			r.extent.width = pRect->extent.width;
 			r.extent.height = 5;
-			DeltaTopography (50,
+			DeltaTopography (rng, 50,
 					&DepthArray[(cur_y - 2) * r.extent.width],
 					&r, depth_delta);
 		}
@@ -1232,9 +1592,9 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 				& (((1 << RANGE_SHIFT) * NUM_BAND_COLORS) - 1);
 	}
 
-	MakeStorms (4 + (RandomContext_Random (SysGenRNG) & 3) + 1, DepthArray);
+	MakeStorms (rng, 4 + (RandomContext_Random (rng) & 3) + 1, DepthArray);
 
-	DitherMap (DepthArray);
+	DitherMap (rng, DepthArray);
 }
 
 static void
@@ -1290,37 +1650,54 @@ ValidateMap (SBYTE *DepthArray)
 	} while (--i);
 }
 
+// What planet_orbit_init() puts in the orbit's arena, then the scratch
+// space of GeneratePlanetSurface(), with room for the alignment
+#define ORBIT_ARENA_SIZE (MAP_WIDTH * MAP_HEIGHT \
+		+ sizeof (Color) * MAP_HEIGHT * (MAP_WIDTH + SPHERE_SPAN_X) \
+		+ sizeof (Color) * SHIELD_DIAM * SHIELD_DIAM \
+		+ MAP_WIDTH * 4 * MAP_HEIGHT * 4 \
+		+ MAP_WIDTH * MAP_HEIGHT \
+		+ 5 * 16)
+
 static void
 planet_orbit_init (void)
 {
 	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
 
+	// One allocation for the buffers the orbit keeps, and the ones that
+	// generating the surface needs for a moment
+	Orbit->Arena = MemArena_new (ORBIT_ARENA_SIZE);
+
 	Orbit->SphereFrame = CaptureDrawable (CreateDrawable (
 			WANT_PIXMAP | WANT_ALPHA, DIAMETER, DIAMETER, 2));
 	Orbit->TintFrame = CaptureDrawable (CreateDrawable (
 			WANT_PIXMAP, MAP_WIDTH, MAP_HEIGHT, 1));
 	Orbit->ObjectFrame = 0;
 	Orbit->WorkFrame = 0;
-	Orbit->lpTopoData = HCalloc (MAP_WIDTH * MAP_HEIGHT);
+	Orbit->lpTopoData = MemArena_calloc (Orbit->Arena,
+			MAP_WIDTH * MAP_HEIGHT);
 	Orbit->TopoZoomFrame = CaptureDrawable (CreateDrawable (
 			WANT_PIXMAP, MAP_WIDTH << 2, MAP_HEIGHT << 2, 1));
-	Orbit->TopoColors = HMalloc (sizeof (Orbit->TopoColors[0])
+	Orbit->TopoColors = MemArena_alloc (Orbit->Arena,
+			sizeof (Orbit->TopoColors[0])
 			* (MAP_HEIGHT * (MAP_WIDTH + SPHERE_SPAN_X)));
 	// always allocate the scratch array to largest needed size
-	Orbit->ScratchArray = HMalloc (sizeof (Orbit->ScratchArray[0])
-			* (SHIELD_DIAM) * (SHIELD_DIAM));
+	Orbit->ScratchArray = MemArena_alloc (Orbit->Arena,
+			sizeof (Orbit->ScratchArray[0]) * (SHIELD_DIAM) * (SHIELD_DIAM));
 }
 
+// The state of frandom() that the 4x scaled topography is made with. It
+// carries over from one planet to the next.
+static unsigned zoomSeed = 0x12345678;
+
 static unsigned
-frandom (void)
+frandom (unsigned *seed)
 {
-	static unsigned seed = 0x12345678;
-	
-	if (seed == 0)
-		seed = 15807;
-	seed = (seed >> 4) * 227;
+	if (*seed == 0)
+		*seed = 15807;
+	*seed = (*seed >> 4) * 227;
 
-	return seed;
+	return *seed;
 }
 
 static inline int
@@ -1331,16 +1708,17 @@ TopoVarianceFactor (int step, int allowed, int min)
 }
 
 static inline int
-TopoVarianceCalc (int factor)
+TopoVarianceCalc (unsigned *seed, int factor)
 {
 	if (factor == 0)
 		return 0;
 	else
-		return (frandom () % factor) - (factor >> 1);
+		return (frandom (seed) % factor) - (factor >> 1);
 }
 
 static void
-TopoScale4x (SBYTE *pDstTopo, SBYTE *pSrcTopo, int num_faults, int fault_var)
+TopoScale4x (unsigned *seed, SBYTE *pDstTopo, SBYTE *pSrcTopo, int num_faults,
+		int fault_var)
 {
 		// Interpolate the topographical data by connecting the elevations
 		// to their nearest neighboors using straight lines (in random
@@ -1423,7 +1801,7 @@ TopoScale4x (SBYTE *pDstTopo, SBYTE *pSrcTopo, int num_faults, int fault_var)
 		step = (prow[4] - val) / STEP_RANGE;
 		rndfact = TopoVarianceFactor (step, var_allow, var_min);
 		for (x2 = 1, val += step; x2 < 4; ++x2, val += step)
-			prow[x2] = val + TopoVarianceCalc (rndfact);
+			prow[x2] = val + TopoVarianceCalc (seed, rndfact);
 	}
 
 	pSrc = pSrcTopo;
@@ -1447,7 +1825,7 @@ TopoScale4x (SBYTE *pDstTopo, SBYTE *pSrcTopo, int num_faults, int fault_var)
 		step = (elev[4][4] - val) / STEP_RANGE;
 		rndfact = TopoVarianceFactor (step, var_allow, var_min);
 		for (y2 = 1, val += step; y2 < 4; ++y2, val += step)
-			elev[4][y2] = val + TopoVarianceCalc (rndfact);
+			elev[4][y2] = val + TopoVarianceCalc (seed, rndfact);
 
 		for (x = 0; x < w; ++x, ++pSrc, pDst += 4, prow += 4)
 		{
@@ -1477,17 +1855,17 @@ TopoScale4x (SBYTE *pDstTopo, SBYTE *pSrcTopo, int num_faults, int fault_var)
 			step = (elev[4][4] - val) / STEP_RANGE;
 			rndfact = TopoVarianceFactor (step, var_allow, var_min);
 			for (x2 = 1, val += step; x2 < 4; ++x2, val += step)
-				elev[x2][4] = val + TopoVarianceCalc (rndfact);
+				elev[x2][4] = val + TopoVarianceCalc (seed, rndfact);
 
 			val = elev[4][0];
 			step = (elev[4][4] - val) / STEP_RANGE;
 			rndfact = TopoVarianceFactor (step, var_allow, var_min);
 			for (y2 = 1, val += step; y2 < 4; ++y2, val += step)
-				elev[4][y2] = val + TopoVarianceCalc (rndfact);
+				elev[4][y2] = val + TopoVarianceCalc (seed, rndfact);
 
 			// fill in the rest by connecting opposing elevations
 			// some randomness to determine which elevations to connect
-			for (pld = fill_lines[frandom () & 3]; pld->x0 >= 0; ++pld)
+			for (pld = fill_lines[frandom (seed) & 3]; pld->x0 >= 0; ++pld)
 			{
 				int num_steps;
 
@@ -1504,7 +1882,7 @@ TopoScale4x (SBYTE *pDstTopo, SBYTE *pSrcTopo, int num_faults, int fault_var)
 						x2 != pld->x1 || y2 != pld->y1;
 						x2 += pld->dx, y2 += pld->dy, val += step)
 				{
-					elev[x2][y2] = val + TopoVarianceCalc (rndfact);
+					elev[x2][y2] = val + TopoVarianceCalc (seed, rndfact);
 				}
 			}
 
@@ -1546,71 +1924,234 @@ TopoScale4x (SBYTE *pDstTopo, SBYTE *pSrcTopo, int num_faults, int fault_var)
 #define LMAP_MAX_DIST     ((LMAP_AVG_BLOCK + 1) >> 1)
 #define LMAP_WEIGHT_THRES (LMAP_MAX_DIST * 2 / 3)
 
-typedef struct
+// The light map is made a row at a time. For each row, the min, max and
+// weighted average of the elevation are taken over a vertical block of
+// rows around it, for all columns at once, and then over a horizontal
+// window of those blocks around each point. The map is changed in place
+// as it goes, and the blocks see the rows above already changed, as they
+// always have; that makes the wrapped-around blocks at the end of a row
+// the only ones that see this row changed.
+// Elevations are kept as SWORDs in a copy, so that both passes are the
+// same kernel: the min, max and weighted sum over a number of rows of
+// values, 'stride' apart, for 'count' points next to each other.
+
+#define LMAP_BLOCKS       (2 * LMAP_MAX_DIST + 1)
+
+static inline int
+lmap_weight (int delta)
 {
-	int min;
-	int max;
-	int avg;
+	int weight = 255; // full weight
 
-} elev_block_t;
+	if (delta >= LMAP_WEIGHT_THRES)
+	{	// too far -- progressively reduced weight
+		weight = weight * (LMAP_MAX_DIST - delta + 1)
+				/ (LMAP_MAX_DIST - LMAP_WEIGHT_THRES + 2);
+	}
+	return weight;
+}
 
 static inline void
-get_vblock_avg (elev_block_t *pblk, SBYTE *pTopo, int x, int y)
+lmap_accumulate_c (const SWORD *minSrc, const SWORD *maxSrc,
+		const SWORD *avgSrc, int stride, const SWORD *weights, int numRows,
+		int count, SWORD *minOut, SWORD *maxOut, int *sumOut)
+{
+	int x, r;
+
+	for (x = 0; x < count; ++x)
+	{
+		int min = 127, max = -127;
+		int sum = 0;
+
+		for (r = 0; r < numRows; ++r)
+		{
+			int ofs = r * stride + x;
+
+			if (maxSrc[ofs] > max)
+				max = maxSrc[ofs];
+			if (minSrc[ofs] < min)
+				min = minSrc[ofs];
+			sum += avgSrc[ofs] * weights[r];
+		}
+		minOut[x] = min;
+		maxOut[x] = max;
+		sumOut[x] = sum;
+	}
+}
+
+#if defined(SSE2_INTRIN) || defined(NEON_INTRIN)
+// 8 points at a time. The values are within SBYTE range and the weights
+// at most 255, so the products fit 16 bits; the sums are kept in 32.
+static void
+lmap_accumulate (const SWORD *minSrc, const SWORD *maxSrc,
+		const SWORD *avgSrc, int stride, const SWORD *weights, int numRows,
+		int count, SWORD *minOut, SWORD *maxOut, int *sumOut)
 {
-	SBYTE *elev = pTopo;
+	int x, r;
+
+	for (x = 0; x + 8 <= count; x += 8)
+	{
+#	if defined(SSE2_INTRIN)
+		__m128i vmin = _mm_set1_epi16 (127);
+		__m128i vmax = _mm_set1_epi16 (-127);
+		__m128i sumLo = _mm_setzero_si128 ();
+		__m128i sumHi = _mm_setzero_si128 ();
+
+		for (r = 0; r < numRows; ++r)
+		{
+			int ofs = r * stride + x;
+			__m128i v = _mm_loadu_si128 ((const __m128i *) (avgSrc + ofs));
+			__m128i p = _mm_mullo_epi16 (v, _mm_set1_epi16 (weights[r]));
+			__m128i sign = _mm_srai_epi16 (p, 15);
+
+			vmin = _mm_min_epi16 (vmin,
+					_mm_loadu_si128 ((const __m128i *) (minSrc + ofs)));
+			vmax = _mm_max_epi16 (vmax,
+					_mm_loadu_si128 ((const __m128i *) (maxSrc + ofs)));
+			sumLo = _mm_add_epi32 (sumLo, _mm_unpacklo_epi16 (p, sign));
+			sumHi = _mm_add_epi32 (sumHi, _mm_unpackhi_epi16 (p, sign));
+		}
+		_mm_storeu_si128 ((__m128i *) (minOut + x), vmin);
+		_mm_storeu_si128 ((__m128i *) (maxOut + x), vmax);
+		_mm_storeu_si128 ((__m128i *) (sumOut + x), sumLo);
+		_mm_storeu_si128 ((__m128i *) (sumOut + x + 4), sumHi);
+#	else /* NEON_INTRIN */
+		int16x8_t vmin = vdupq_n_s16 (127);
+		int16x8_t vmax = vdupq_n_s16 (-127);
+		int32x4_t sumLo = vdupq_n_s32 (0);
+		int32x4_t sumHi = vdupq_n_s32 (0);
+
+		for (r = 0; r < numRows; ++r)
+		{
+			int ofs = r * stride + x;
+			int16x8_t v = vld1q_s16 (avgSrc + ofs);
+			int16x4_t w = vdup_n_s16 (weights[r]);
+
+			vmin = vminq_s16 (vmin, vld1q_s16 (minSrc + ofs));
+			vmax = vmaxq_s16 (vmax, vld1q_s16 (maxSrc + ofs));
+			sumLo = vmlal_s16 (sumLo, vget_low_s16 (v), w);
+			sumHi = vmlal_s16 (sumHi, vget_high_s16 (v), w);
+		}
+		vst1q_s16 (minOut + x, vmin);
+		vst1q_s16 (maxOut + x, vmax);
+		vst1q_s32 (sumOut + x, sumLo);
+		vst1q_s32 (sumOut + x + 4, sumHi);
+#	endif
+	}
+
+	if (x < count)
+	{
+		lmap_accumulate_c (minSrc + x, maxSrc + x, avgSrc + x, stride,
+				weights, numRows, count - x, minOut + x, maxOut + x,
+				sumOut + x);
+	}
+}
+#else
+#	define lmap_accumulate lmap_accumulate_c
+#endif
+
+typedef struct
+{
+	SWORD *elev;
+			// A copy of the map, changed along with it
+	SWORD *bmin;
+	SWORD *bmax;
+	SWORD *bavg;
+			// The vertical blocks of a row, point -LMAP_MAX_DIST first,
+			// so that the window of point x starts at x
+	SWORD *wmin;
+	SWORD *wmax;
+			// The windows
+	int *sums;
+			// For both; the one allocation, the rest follows
+} LMAP_WORK;
+
+// Fill in the vertical blocks of row y for the columns [x0, x0 + count)
+// into the block arrays at 'at'
+static void
+lmap_blocks (LMAP_WORK *work, int w, int h, int y, int x0, int count,
+		int at)
+{
+	SWORD weights[LMAP_BLOCKS];
 	int y0, y1, i;
-	int min = 127, max = -127;
-	int avg = 0, total_weight = 0;
+	int total_weight = 0;
+	const SWORD *src;
 
-	// surface wraps around along x
-	x = (x + MAP_WIDTH) % MAP_WIDTH;
-	
 	y0 = y - LMAP_MAX_DIST;
 	y1 = y + LMAP_MAX_DIST;
 	if (y0 < 0)
 		y0 = 0;
-	if (y1 > MAP_HEIGHT)
-		y1 = MAP_HEIGHT;
+	if (y1 > h)
+		y1 = h;
 
-	elev = pTopo + y0 * MAP_WIDTH + x;
-	for (i = y0; i < y1; ++i, elev += MAP_WIDTH)
+	for (i = y0; i < y1; ++i)
 	{
-		int delta = abs (i - y);
-		int weight = 255; // full weight
-		int v = *elev;
+		weights[i - y0] = lmap_weight (abs (i - y));
+		total_weight += weights[i - y0];
+	}
 
-		if (delta >= LMAP_WEIGHT_THRES)
-		{	// too far -- progressively reduced weight
-			weight = weight * (LMAP_MAX_DIST - delta + 1)
-					/ (LMAP_MAX_DIST - LMAP_WEIGHT_THRES + 2);
-		}
+	src = work->elev + y0 * w + x0;
+	lmap_accumulate (src, src, src, w, weights, y1 - y0, count,
+			work->bmin + at, work->bmax + at, work->sums);
 
-		if (v > max)
-			max = v;
-		if (v < min)
-			min = v;
-		avg += v * weight;
-		total_weight += weight;
+	for (i = 0; i < count; ++i)
+	{
+		int avg = work->sums[i];
+
+		avg /= total_weight;
+		work->bavg[at + i] = avg / (y1 - y0);
 	}
-	avg /= total_weight;
+}
+
+// Light the points [x0, x0 + count) of a row from their windows
+static void
+lmap_light_points (LMAP_WORK *work, const SWORD *weights, int total_weight,
+		SBYTE *row, SWORD *elevRow, int x0, int count)
+{
+	int x;
+
+	lmap_accumulate (work->bmin + x0, work->bmax + x0, work->bavg + x0, 1,
+			weights, LMAP_BLOCKS, count, work->wmin, work->wmax, work->sums);
+
+	for (x = 0; x < count; ++x)
+	{
+		int avg = work->sums[x];
+		int med;
+		SBYTE *elev = row + x0 + x;
+
+		avg /= total_weight;
 
-	pblk->min = min;
-	pblk->max = max;
-	pblk->avg = avg / (y1 - y0);
+		// This is mostly Voodoo
+		// figure out what kind of relative lighting factor
+		// to assign to this point
+#if 0
+		// relative to median
+		med = (work->wmin[x] + work->wmax[x]) / 2; // median
+		*elev = (int)*elev - med;
+#else
+		// relative to median of (average, median)
+		med = (work->wmin[x] + work->wmax[x]) / 2; // median
+		med = (med + avg) / 2;
+		*elev = (int)*elev - med;
+#endif
+		elevRow[x0 + x] = *elev;
+	}
 }
 
 // See description above
 static void
 GenerateLightMap (SBYTE *pTopo, int w, int h)
 {
-#define LMAP_BLOCKS       (2 * LMAP_MAX_DIST + 1)
 	int x, y;
-	elev_block_t vblocks[LMAP_BLOCKS];
-			// we use a running block average to reduce the amount of work
-			// where a block is a vertical line of map points
 	SBYTE *elev;
 	int min, max, med;
 	int sfact, spread;
+	LMAP_WORK work;
+	SWORD weights[LMAP_BLOCKS];
+	int total_weight;
+	int ext = w + 2 * LMAP_MAX_DIST;
+			// Points in a row of blocks
+
+	assert (w >= 2 * LMAP_MAX_DIST);
 
 	// normalize the topo data
 	min = 127;
@@ -1642,95 +2183,378 @@ GenerateLightMap (SBYTE *pTopo, int w, int h)
 	else
 		sfact = 100; // full spread
 	
+	work.sums = HMalloc (sizeof (int) * ext
+			+ sizeof (SWORD) * (w * h + 3 * ext + 2 * w));
+	work.elev = (SWORD *) (work.sums + ext);
+	work.bmin = work.elev + w * h;
+	work.bmax = work.bmin + ext;
+	work.bavg = work.bmax + ext;
+	work.wmin = work.bavg + ext;
+	work.wmax = work.wmin + w;
+
 	// apply spread
 	for (x = 0, elev = pTopo; x < w * h; ++x, ++elev)
 	{
 		int v = *elev;
 		v = (v - med) * sfact / spread;
 		*elev = v;
+		work.elev[x] = *elev;
+	}
+
+	total_weight = 0;
+	for (x = 0; x < LMAP_BLOCKS; ++x)
+	{
+		weights[x] = lmap_weight (abs (x - LMAP_MAX_DIST));
+		total_weight += weights[x];
 	}
 
 	// compute and apply weighted averages of surrounding points
-	for (y = 0, elev = pTopo; y < h; ++y)
+	for (y = 0; y < h; ++y)
 	{
-		elev_block_t *pblk;
-		int i;
+		SBYTE *row = pTopo + y * w;
+		SWORD *elevRow = work.elev + y * w;
 
-		// prime the running block average
 		// get the minimum, maximum and avg elevation for each block
-		for (i = -LMAP_MAX_DIST; i < LMAP_MAX_DIST; ++i)
+		lmap_blocks (&work, w, h, y, 0, w, LMAP_MAX_DIST);
+		// blocks wrap around on both sides
+		memcpy (work.bmin, work.bmin + w, sizeof (SWORD) * LMAP_MAX_DIST);
+		memcpy (work.bmax, work.bmax + w, sizeof (SWORD) * LMAP_MAX_DIST);
+		memcpy (work.bavg, work.bavg + w, sizeof (SWORD) * LMAP_MAX_DIST);
+
+		lmap_light_points (&work, weights, total_weight, row, elevRow,
+				0, w - LMAP_MAX_DIST);
+		// The ones on the right are of the start of this row, which is
+		// lit by now
+		lmap_blocks (&work, w, h, y, 0, LMAP_MAX_DIST, w + LMAP_MAX_DIST);
+		lmap_light_points (&work, weights, total_weight, row, elevRow,
+				w - LMAP_MAX_DIST, LMAP_MAX_DIST);
+	}
+
+	HFree (work.sums);
+}
+
+// Makes the elevation data of a planet without a surface definition,
+// taking the random numbers from rng
+static void
+GenerateTopography (RandomContext *rng, const PlanetFrame *PlanDataPtr,
+		SBYTE *topo)
+{
+	RECT r;
+	COUNT i;
+
+	r.corner.x = r.corner.y = 0;
+	r.extent.width = MAP_WIDTH;
+	r.extent.height = MAP_HEIGHT;
+	memset (topo, 0, MAP_WIDTH * MAP_HEIGHT);
+	switch (PLANALGO (PlanDataPtr->Type))
+	{
+		case GAS_GIANT_ALGO:
+			MakeGasGiant (rng, PlanDataPtr->num_faults, topo, &r,
+					PlanDataPtr->fault_depth);
+			break;
+		case TOPO_ALGO:
+		case CRATERED_ALGO:
+			if (PlanDataPtr->num_faults)
+				DeltaTopography (rng, PlanDataPtr->num_faults, topo, &r,
+						PlanDataPtr->fault_depth);
+
+			for (i = 0; i < PlanDataPtr->num_blemishes; ++i)
+			{
+				RECT crater_r;
+				UWORD loword;
+		
+				loword = LOWORD (RandomContext_Random (rng));
+				switch (HIBYTE (loword) & 31)
+				{
+					case 0:
+						crater_r.extent.width =
+								(LOBYTE (loword) % (MAP_HEIGHT >> 2))
+								+ (MAP_HEIGHT >> 2);
+						break;
+					case 1:
+					case 2:
+					case 3:
+					case 4:
+						crater_r.extent.width =
+								(LOBYTE (loword) % (MAP_HEIGHT >> 3))
+								+ (MAP_HEIGHT >> 3);
+						break;
+					default:
+						crater_r.extent.width =
+								(LOBYTE (loword) % (MAP_HEIGHT >> 4))
+								+ 4;
+						break;
+				}
+			
+				loword = LOWORD (RandomContext_Random (rng));
+				crater_r.extent.height = crater_r.extent.width;
+				crater_r.corner.x = HIBYTE (loword)
+						% (MAP_WIDTH - crater_r.extent.width);
+				crater_r.corner.y = LOBYTE (loword)
+						% (MAP_HEIGHT - crater_r.extent.height);
+				MakeCrater (&crater_r, topo,
+						PlanDataPtr->fault_depth << 2,
+						-(PlanDataPtr->fault_depth << 2),
+						FALSE);
+			}
+
+			if (PLANALGO (PlanDataPtr->Type) == CRATERED_ALGO)
+				DitherMap (rng, topo);
+			ValidateMap (topo);
+			break;
+	}
+}
+
+// Generating the surfaces of a planet and its moons in the background.
+// This is started when the ship enters the inner system of a planet, so
+// that by the time it goes into orbit, what takes the longest is done.
+// The task only makes what needs no graphics: the elevation data, the 4x
+// scaled topography and the light map. Each world is made with its own
+// RandomContext, seeded the way GeneratePlanetSurface() seeds SysGenRNG,
+// and SysGenRNG is left where it would have been. The 4x topography takes
+// the frandom() state that carries over from the last planet; it is only
+// used if that is still the state it was made from.
+
+typedef struct
+{
+	DWORD rand_seed;
+	BYTE data_index;
+			// Of the world this is for
+	BOOLEAN done;
+			// Set by the task, with surfaceGenMutex held
+	DWORD endSeed;
+			// The state of the RNG after the elevation data
+	unsigned zoomStartSeed;
+	unsigned zoomEndSeed;
+			// The frandom() state before and after the 4x topography
+	SBYTE *topo;
+	SBYTE *scaledTopo;
+			// NULL for shielded worlds and gas giants
+	SBYTE *lightMap;
+			// NULL for gas giants
+} SURFACE_GEN_JOB;
+
+static SURFACE_GEN_JOB surfaceGenJobs[MAX_MOONS + 1];
+static COUNT numSurfaceGenJobs;
+static Task surfaceGenTask;
+static BOOLEAN surfaceGenRunning;
+		// Cleared by the task, with surfaceGenMutex held, as it ends
+static Mutex surfaceGenMutex;
+
+static void
+generateSurfaceJob (SURFACE_GEN_JOB *job)
+{
+	const PlanetFrame *PlanDataPtr =
+			&PlanData[job->data_index & ~PLANET_SHIELDED];
+	BOOLEAN gasGiant = PLANALGO (PlanDataPtr->Type) == GAS_GIANT_ALGO;
+	RandomContext *rng;
+
+	job->topo = HMalloc (MAP_WIDTH * MAP_HEIGHT);
+	rng = RandomContext_New ();
+	if (!job->topo || !rng)
+	{
+		HFree (job->topo);
+		job->topo = NULL;
+		if (rng)
+			RandomContext_Delete (rng);
+		return;
+	}
+
+	RandomContext_SeedRandom (rng, job->rand_seed);
+	GenerateTopography (rng, PlanDataPtr, job->topo);
+	job->endSeed = RandomContext_GetSeed (rng);
+	RandomContext_Delete (rng);
+
+	if (!(job->data_index & PLANET_SHIELDED) && !gasGiant)
+	{
+		job->scaledTopo = HMalloc (MAP_WIDTH * 4 * MAP_HEIGHT * 4);
+		if (job->scaledTopo)
 		{
-			// blocks wrap around on both sides
-			pblk = vblocks + ((i + LMAP_BLOCKS) % LMAP_BLOCKS);
+			unsigned seed = job->zoomStartSeed;
 
-			get_vblock_avg (pblk, pTopo, i, y);
+			TopoScale4x (&seed, job->scaledTopo, job->topo,
+					PlanDataPtr->num_faults, PlanDataPtr->fault_depth
+					* (PLANALGO (PlanDataPtr->Type) == CRATERED_ALGO ? 2 : 1));
+			job->zoomEndSeed = seed;
 		}
+	}
 
-		for (x = 0; x < w; ++x, ++elev)
+	if (!gasGiant)
+	{
+		job->lightMap = HMalloc (MAP_WIDTH * MAP_HEIGHT);
+		if (job->lightMap)
 		{
-			int avg = 0, total_weight = 0;
+			memcpy (job->lightMap, job->topo, MAP_WIDTH * MAP_HEIGHT);
+			GenerateLightMap (job->lightMap, MAP_WIDTH, MAP_HEIGHT);
+		}
+	}
+}
 
-			min = 127;
-			max = -127;
+static int
+SurfaceGenFunc (void *data)
+{
+	Task task = (Task) data;
+	COUNT i;
 
-			// prepare next block as we move along x
-			pblk = vblocks + ((x + LMAP_MAX_DIST) % LMAP_BLOCKS);
-			get_vblock_avg (pblk, pTopo, x + LMAP_MAX_DIST, y);
+	for (i = 0; i < numSurfaceGenJobs && !Task_ReadState (task, TASK_EXIT);
+			++i)
+	{
+		generateSurfaceJob (&surfaceGenJobs[i]);
 
-			// compute the min, max and weighted avg of blocks
-			for (i = x - LMAP_MAX_DIST; i <= x + LMAP_MAX_DIST; ++i)
-			{
-				int delta = abs (i - x);
-				int weight = 255; // full weight
+		LockMutex (surfaceGenMutex);
+		surfaceGenJobs[i].done = TRUE;
+		UnlockMutex (surfaceGenMutex);
+	}
 
-				pblk = vblocks + ((i + LMAP_BLOCKS) % LMAP_BLOCKS);
+	LockMutex (surfaceGenMutex);
+	surfaceGenRunning = FALSE;
+	UnlockMutex (surfaceGenMutex);
 
-				if (delta >= LMAP_WEIGHT_THRES)
-				{	// too far -- progressively reduced weight
-					weight = weight * (LMAP_MAX_DIST - delta + 1)
-							/ (LMAP_MAX_DIST - LMAP_WEIGHT_THRES + 2);
-				}
+	FinishTask (task);
+	return 0;
+}
 
-				if (pblk->max > max)
-					max = pblk->max;
-				if (pblk->min < min)
-					min = pblk->min;
-				
-				avg += pblk->avg * weight;
-				total_weight += weight;
-			}
-			avg /= total_weight;
+static BOOLEAN
+isSurfaceGenRunning (void)
+{
+	BOOLEAN running;
 
-			// This is mostly Voodoo
-			// figure out what kind of relative lighting factor
-			// to assign to this point
-#if 0
-			// relative to median
-			med = (min + max) / 2; // median
-			*elev = (int)*elev - med;
-#else
-			// relative to median of (average, median)
-			med = (min + max) / 2; // median
-			med = (med + avg) / 2;
-			*elev = (int)*elev - med;
-#endif
+	LockMutex (surfaceGenMutex);
+	running = surfaceGenRunning;
+	UnlockMutex (surfaceGenMutex);
+	return running;
+}
+
+static void
+freeSurfaceGenJob (SURFACE_GEN_JOB *job)
+{
+	HFree (job->topo);
+	job->topo = NULL;
+	HFree (job->scaledTopo);
+	job->scaledTopo = NULL;
+	HFree (job->lightMap);
+	job->lightMap = NULL;
+}
+
+// Returns what the task made for the world, waiting for it if it is not
+// done yet, or NULL if it has nothing. The caller frees the job's buffers
+// with freeSurfaceGenJob() once it is done with them.
+static SURFACE_GEN_JOB *
+takeSurfaceGenJob (const PLANET_DESC *world)
+{
+	COUNT i;
+
+	for (i = 0; i < numSurfaceGenJobs; ++i)
+	{
+		SURFACE_GEN_JOB *job = &surfaceGenJobs[i];
+
+		if (job->rand_seed != world->rand_seed
+				|| job->data_index != world->data_index)
+			continue;
+
+		while (isSurfaceGenRunning ())
+		{
+			BOOLEAN done;
+
+			LockMutex (surfaceGenMutex);
+			done = job->done;
+			UnlockMutex (surfaceGenMutex);
+			if (done)
+				break;
+			HibernateThread (ONE_SECOND / 120);
 		}
+		if (!job->done || !job->topo)
+			return NULL;
+		// Not to be taken twice
+		job->rand_seed = ~job->rand_seed;
+		return job;
 	}
+	return NULL;
+}
+
+// Starts making the surfaces of the planet and its moons in the
+// background, dropping whatever was made for the one before
+void
+StartSurfaceGeneration (const PLANET_DESC *planet, const PLANET_DESC *moons)
+{
+	COUNT i;
+
+	StopSurfaceGeneration ();
+
+	for (i = 0; i <= planet->NumPlanets && i <= MAX_MOONS; ++i)
+	{
+		const PLANET_DESC *world = i == 0 ? planet : &moons[i - 1];
+		SURFACE_GEN_JOB *job;
+
+		if ((world->data_index & ~PLANET_SHIELDED) >= NUMBER_OF_PLANET_TYPES)
+			continue; // Starbases and such have no surface
+		if (TopoCache_Has (world))
+			continue; // Made on an earlier visit
+
+		job = &surfaceGenJobs[numSurfaceGenJobs++];
+		memset (job, 0, sizeof (*job));
+		job->rand_seed = world->rand_seed;
+		job->data_index = world->data_index;
+		job->zoomStartSeed = zoomSeed;
+	}
+	if (numSurfaceGenJobs == 0)
+		return;
+
+	surfaceGenMutex = CreateMutex ("Planet surface generation",
+			SYNC_CLASS_TOPLEVEL);
+	surfaceGenRunning = TRUE;
+	surfaceGenTask = AssignTask (SurfaceGenFunc, 4096,
+			"planet surface generation");
+	if (!surfaceGenTask)
+	{
+		surfaceGenRunning = FALSE;
+		numSurfaceGenJobs = 0;
+	}
+}
+
+// Stops the background generation, and frees what it made
+void
+StopSurfaceGeneration (void)
+{
+	COUNT i;
+
+	if (surfaceGenMutex)
+	{
+		LockMutex (surfaceGenMutex);
+		if (surfaceGenRunning)
+			Task_SetState (surfaceGenTask, TASK_EXIT);
+		UnlockMutex (surfaceGenMutex);
+
+		// Only waits for the world being made to be done
+		while (isSurfaceGenRunning ())
+			HibernateThread (ONE_SECOND / 120);
+
+		DestroyMutex (surfaceGenMutex);
+		surfaceGenMutex = NULL;
+	}
+	surfaceGenTask = NULL;
+
+	for (i = 0; i < numSurfaceGenJobs; ++i)
+		freeSurfaceGenJob (&surfaceGenJobs[i]);
+	numSurfaceGenJobs = 0;
 }
 
 // Sets the SysGenRNG to the required state first.
 void
 GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 {
-	RECT r;
 	const PlanetFrame *PlanDataPtr;
 	PLANET_INFO *PlanetInfo = &pSolarSysState->SysInfo.PlanetInfo;
-	COUNT i, y;
+	COUNT y;
 	POINT loc;
 	CONTEXT OldContext;
 	CONTEXT TopoContext;
 	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
 	BOOLEAN shielded = (pPlanetDesc->data_index & PLANET_SHIELDED) != 0;
+	SURFACE_GEN_JOB *job = NULL;
+	const SBYTE *lightMap = NULL;
+	BOOLEAN keepTopo = FALSE;
+	DWORD endSeed = 0;
 
 	RandomContext_SeedRandom (SysGenRNG, pPlanetDesc->rand_seed);
 
@@ -1794,70 +2618,27 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 	else
 	{	// Generate planet surface elevation data and look
 
-		r.corner.x = r.corner.y = 0;
-		r.extent.width = MAP_WIDTH;
-		r.extent.height = MAP_HEIGHT;
+		job = takeSurfaceGenJob (pPlanetDesc);
+		if (job)
+		{	// Made in the background already
+			memcpy (Orbit->lpTopoData, job->topo, MAP_WIDTH * MAP_HEIGHT);
+			lightMap = job->lightMap;
+			endSeed = job->endSeed;
+			RandomContext_SeedRandom (SysGenRNG, endSeed);
+			keepTopo = TRUE;
+		}
+		else if (TopoCache_Get (pPlanetDesc, Orbit->lpTopoData, &lightMap,
+				&endSeed))
+		{	// Made on an earlier visit
+			RandomContext_SeedRandom (SysGenRNG, endSeed);
+		}
+		else
 		{
-			memset (Orbit->lpTopoData, 0, MAP_WIDTH * MAP_HEIGHT);
-			switch (PLANALGO (PlanDataPtr->Type))
-			{
-				case GAS_GIANT_ALGO:
-					MakeGasGiant (PlanDataPtr->num_faults,
-							Orbit->lpTopoData, &r, PlanDataPtr->fault_depth);
-					break;
-				case TOPO_ALGO:
-				case CRATERED_ALGO:
-					if (PlanDataPtr->num_faults)
-						DeltaTopography (PlanDataPtr->num_faults,
-								Orbit->lpTopoData, &r,
-								PlanDataPtr->fault_depth);
-
-					for (i = 0; i < PlanDataPtr->num_blemishes; ++i)
-					{
-						RECT crater_r;
-						UWORD loword;
-				
-						loword = LOWORD (RandomContext_Random (SysGenRNG));
-						switch (HIBYTE (loword) & 31)
-						{
-							case 0:
-								crater_r.extent.width =
-										(LOBYTE (loword) % (MAP_HEIGHT >> 2))
-										+ (MAP_HEIGHT >> 2);
-								break;
-							case 1:
-							case 2:
-							case 3:
-							case 4:
-								crater_r.extent.width =
-										(LOBYTE (loword) % (MAP_HEIGHT >> 3))
-										+ (MAP_HEIGHT >> 3);
-								break;
-							default:
-								crater_r.extent.width =
-										(LOBYTE (loword) % (MAP_HEIGHT >> 4))
-										+ 4;
-								break;
-						}
-					
-						loword = LOWORD (RandomContext_Random (SysGenRNG));
-						crater_r.extent.height = crater_r.extent.width;
-						crater_r.corner.x = HIBYTE (loword)
-								% (MAP_WIDTH - crater_r.extent.width);
-						crater_r.corner.y = LOBYTE (loword)
-								% (MAP_HEIGHT - crater_r.extent.height);
-						MakeCrater (&crater_r, Orbit->lpTopoData,
-								PlanDataPtr->fault_depth << 2,
-								-(PlanDataPtr->fault_depth << 2),
-								FALSE);
-					}
-
-					if (PLANALGO (PlanDataPtr->Type) == CRATERED_ALGO)
-						DitherMap (Orbit->lpTopoData);
-					ValidateMap (Orbit->lpTopoData);
-					break;
-			}
+			GenerateTopography (SysGenRNG, PlanDataPtr, Orbit->lpTopoData);
+			endSeed = RandomContext_GetSeed (SysGenRNG);
+			keepTopo = TRUE;
 		}
+
 		pSolarSysState->TopoFrame = CaptureDrawable (
 				CreateDrawable (WANT_PIXMAP, (SIZE)MAP_WIDTH,
 				(SIZE)MAP_HEIGHT, 1));
@@ -1889,17 +2670,30 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 	if (!shielded && PlanetInfo->AtmoDensity != GAS_GIANT_ATMOSPHERE)
 	{	// produce 4x scaled topo image for Planetside
 		// for the planets that we can land on
-		SBYTE *pScaledTopo = HMalloc (MAP_WIDTH * 4 * MAP_HEIGHT * 4);
+		SBYTE *pScaledTopo;
+		MemArenaMark scratch = MemArena_mark (Orbit->Arena);
+
+		if (job && job->scaledTopo && job->zoomStartSeed == zoomSeed)
+		{	// Made in the background, from the same frandom() state
+			pScaledTopo = job->scaledTopo;
+			zoomSeed = job->zoomEndSeed;
+		}
+		else
+		{
+			pScaledTopo = MemArena_alloc (Orbit->Arena,
+					MAP_WIDTH * 4 * MAP_HEIGHT * 4);
+			if (pScaledTopo)
+				TopoScale4x (&zoomSeed, pScaledTopo, Orbit->lpTopoData,
+						PlanDataPtr->num_faults, PlanDataPtr->fault_depth
+						* (PLANALGO (PlanDataPtr->Type) == CRATERED_ALGO ?
+						2 : 1));
+		}
 		if (pScaledTopo)
 		{
-			TopoScale4x (pScaledTopo, Orbit->lpTopoData,
-					PlanDataPtr->num_faults, PlanDataPtr->fault_depth
-					* (PLANALGO (PlanDataPtr->Type) == CRATERED_ALGO ? 2 : 1  ));
 			RenderTopography (Orbit->TopoZoomFrame, pScaledTopo,
 					MAP_WIDTH * 4, MAP_HEIGHT * 4);
-
-			HFree (pScaledTopo);
 		}
+		MemArena_release (Orbit->Arena, scratch);
 	}
 
 	// Generate a pixel array from the Topography map.
@@ -1918,12 +2712,30 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 	if (PLANALGO (PlanDataPtr->Type) != GAS_GIANT_ALGO)
 	{	// convert topo data to a light map, based on relative
 		// map point elevations
-		GenerateLightMap (Orbit->lpTopoData, MAP_WIDTH, MAP_HEIGHT);
+		MemArenaMark scratch = MemArena_mark (Orbit->Arena);
+
+		if (!lightMap)
+		{
+			SBYTE *madeLightMap = MemArena_alloc (Orbit->Arena,
+					MAP_WIDTH * MAP_HEIGHT);
+			memcpy (madeLightMap, Orbit->lpTopoData, MAP_WIDTH * MAP_HEIGHT);
+			GenerateLightMap (madeLightMap, MAP_WIDTH, MAP_HEIGHT);
+			lightMap = madeLightMap;
+		}
+		if (keepTopo)
+			TopoCache_Put (pPlanetDesc, Orbit->lpTopoData, lightMap,
+					endSeed);
+		memcpy (Orbit->lpTopoData, lightMap, MAP_WIDTH * MAP_HEIGHT);
+		MemArena_release (Orbit->Arena, scratch);
 	}
 	else
 	{	// gas giants are pretty much flat
+		if (keepTopo)
+			TopoCache_Put (pPlanetDesc, Orbit->lpTopoData, NULL, endSeed);
 		memset (Orbit->lpTopoData, 0, MAP_WIDTH * MAP_HEIGHT);
 	}
+	if (job)
+		freeSurfaceGenJob (job);
 			
 	if (pSolarSysState->pOrbitalDesc->pPrevDesc ==
 			&pSolarSysState->SunDesc[0])
@@ -1938,6 +2750,7 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 	// Rotating planet sphere initialization
 	GenerateSphereMask (loc);
 	CreateSphereTiltMap (PlanetInfo->AxialTilt);
+	PrepareSphereTables ();
 	if (shielded)
 		Orbit->ObjectFrame = CreateShieldMask ();
 	InitSphereRotation (1 - 2 * (PlanetInfo->AxialTilt & 1), shielded);
@@ -1952,3 +2765,100 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 	DestroyContext (TopoContext);
 }
 
+
+#define PERFTEST_SEEDS 16
+
+// Makes the surfaces of every planet type for a fixed set of seeds, the
+// way GeneratePlanetSurface() does but without the frames, and logs the
+// time each step took along with a checksum of what came out, to compare
+// the generators between builds. The colours come from a grey ramp
+// instead of the planet's own colour map.
+void
+PlanetGen_PerfTest (void)
+{
+	extern const PlanetFrame planet_array[];
+	RandomContext *rng;
+	SBYTE *topo, *scaled;
+	Color *pix;
+	Color table[256];
+	BYTE xlat[256];
+	BYTE cmap[2 + 256 * 3];
+	DWORD topoTime = 0, scaleTime = 0, colorTime = 0, lightTime = 0;
+	DWORD checksum = 0;
+	COUNT worlds = 0;
+	COUNT type, seed;
+	int i;
+
+	rng = RandomContext_New ();
+	topo = HMalloc (MAP_WIDTH * MAP_HEIGHT);
+	scaled = HMalloc (MAP_WIDTH * 4 * MAP_HEIGHT * 4);
+	pix = HMalloc (sizeof (Color) * MAP_WIDTH * 4 * MAP_HEIGHT * 4);
+
+	cmap[0] = 0;
+	cmap[1] = 255;
+	for (i = 0; i < 256; ++i)
+	{
+		xlat[i] = i;
+		cmap[2 + i * 3] = cmap[2 + i * 3 + 1] = cmap[2 + i * 3 + 2] = i >> 2;
+	}
+
+	for (type = 0; type < NUMBER_OF_PLANET_TYPES; ++type)
+	{
+		const PlanetFrame *PlanDataPtr = &planet_array[type];
+		BOOLEAN gasGiant = PLANALGO (PlanDataPtr->Type) == GAS_GIANT_ALGO;
+
+		BuildTopoColorTable (table, PlanDataPtr, xlat, cmap);
+
+		for (seed = 1; seed <= PERFTEST_SEEDS; ++seed)
+		{
+			DWORD start;
+			unsigned zoom = seed;
+
+			RandomContext_SeedRandom (rng, seed * 0x10001);
+			start = GetTimeMicroseconds ();
+			GenerateTopography (rng, PlanDataPtr, topo);
+			topoTime += GetTimeMicroseconds () - start;
+
+			start = GetTimeMicroseconds ();
+			MapTopoColors (pix, topo, MAP_WIDTH * MAP_HEIGHT, table);
+			colorTime += GetTimeMicroseconds () - start;
+			checksum = checksum * 31 + pix[MAP_WIDTH * MAP_HEIGHT / 2].r;
+
+			if (!gasGiant)
+			{
+				start = GetTimeMicroseconds ();
+				TopoScale4x (&zoom, scaled, topo, PlanDataPtr->num_faults,
+						PlanDataPtr->fault_depth * (PLANALGO (
+						PlanDataPtr->Type) == CRATERED_ALGO ? 2 : 1));
+				scaleTime += GetTimeMicroseconds () - start;
+
+				start = GetTimeMicroseconds ();
+				MapTopoColors (pix, scaled, MAP_WIDTH * 4 * MAP_HEIGHT * 4,
+						table);
+				colorTime += GetTimeMicroseconds () - start;
+
+				start = GetTimeMicroseconds ();
+				GenerateLightMap (topo, MAP_WIDTH, MAP_HEIGHT);
+				lightTime += GetTimeMicroseconds () - start;
+
+				for (i = 0; i < MAP_WIDTH * MAP_HEIGHT * 16; ++i)
+					checksum = checksum * 31 + (BYTE) scaled[i];
+			}
+
+			for (i = 0; i < MAP_WIDTH * MAP_HEIGHT; ++i)
+				checksum = checksum * 31 + (BYTE) topo[i];
+			++worlds;
+		}
+	}
+
+	log_add (log_Debug, "PlanetGen_PerfTest(): %u worlds; topography %lu us, "
+			"4x scaling %lu us, colours %lu us, light maps %lu us; "
+			"checksum %08lx", worlds, (unsigned long) topoTime,
+			(unsigned long) scaleTime, (unsigned long) colorTime,
+			(unsigned long) lightTime, (unsigned long) checksum);
+
+	HFree (pix);
+	HFree (scaled);
+	HFree (topo);
+	RandomContext_Delete (rng);
+}
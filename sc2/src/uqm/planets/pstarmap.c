@@ -43,6 +43,7 @@
 #include "libs/memlib.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 
 static POINT cursorLoc;
@@ -276,105 +277,172 @@ GetSphereRect (FLEET_INFO *FleetPtr, RECT *pRect, RECT *pRepairRect)
 	}
 }
 
-static void
-DrawStarMap (COUNT race_update, RECT *pClipRect)
+// The star map is drawn from two saved layers, each kept for as long as
+// what it shows stays the same:
+//  - the background: the fuel range circle and the grid,
+//  - the map: the background with the spheres of influence and the stars
+//    on it. Any drawing of the spheres on the move (race_update) makes it
+//    out of date.
+// Both are of the current view only, and are let go with the star map.
+typedef struct
 {
-#define GRID_DELTA 500
-	SIZE i;
+	FRAME frame;
+	BOOLEAN valid;
+	int zoomLevel;
+	POINT origin;
 	COUNT which_space;
-	long diameter;
-	RECT r, old_r;
-	POINT oldOrigin = {0, 0};
-	STAMP s;
-	FRAME star_frame;
-	STAR_DESC *SDPtr;
-	BOOLEAN draw_cursor;
+	RECT fuel_r;
+			// Extent 0 if no circle
+} STARMAP_LAYER;
 
-	if (pClipRect == (RECT*)-1)
+static STARMAP_LAYER backLayer;
+static STARMAP_LAYER mapLayer;
+
+static BOOLEAN
+layerMatches (const STARMAP_LAYER *layer, COUNT which_space,
+		const RECT *fuel_r)
+{
+	return layer->valid && layer->zoomLevel == zoomLevel
+			&& layer->origin.x == mapOrigin.x
+			&& layer->origin.y == mapOrigin.y
+			&& layer->which_space == which_space
+			&& layer->fuel_r.corner.x == fuel_r->corner.x
+			&& layer->fuel_r.corner.y == fuel_r->corner.y
+			&& layer->fuel_r.extent.width == fuel_r->extent.width
+			&& layer->fuel_r.extent.height == fuel_r->extent.height;
+}
+
+// Makes the layer current and draws into it from here on, until the old
+// context is set again. Returns the old context.
+static CONTEXT
+beginLayer (STARMAP_LAYER *layer, COUNT which_space, const RECT *fuel_r)
+{
+	CONTEXT OldContext;
+
+	if (!layer->frame)
 	{
-		pClipRect = 0;
-		draw_cursor = FALSE;
+		layer->frame = CaptureDrawable (CreateDrawable (WANT_PIXMAP,
+				SIS_SCREEN_WIDTH, SIS_SCREEN_HEIGHT, 1));
 	}
 	else
-	{
-		draw_cursor = TRUE;
+	{	// A draw of the old contents may still be queued
+		FlushGraphics ();
 	}
 
-	SetContext (SpaceContext);
-	if (pClipRect)
-	{
-		GetContextClipRect (&old_r);
-		pClipRect->corner.x += old_r.corner.x;
-		pClipRect->corner.y += old_r.corner.y;
-		SetContextClipRect (pClipRect);
-		pClipRect->corner.x -= old_r.corner.x;
-		pClipRect->corner.y -= old_r.corner.y;
-		// Offset the origin so that we draw the correct gfx in the cliprect
-		oldOrigin = SetContextOrigin (MAKE_POINT (-pClipRect->corner.x,
-				-pClipRect->corner.y));
-	}
+	layer->valid = TRUE;
+	layer->zoomLevel = zoomLevel;
+	layer->origin = mapOrigin;
+	layer->which_space = which_space;
+	layer->fuel_r = *fuel_r;
 
-	if (transition_pending)
+	OldContext = SetContext (OffScreenContext);
+	SetContextFGFrame (layer->frame);
+	SetContextClipRect (NULL);
+	return OldContext;
+}
+
+static void
+drawLayer (const STARMAP_LAYER *layer)
+{
+	STAMP s;
+
+	s.origin.x = 0;
+	s.origin.y = 0;
+	s.frame = layer->frame;
+	DrawStamp (&s);
+}
+
+static void
+FreeStarMapLayers (void)
+{
+	DestroyDrawable (ReleaseDrawable (backLayer.frame));
+	backLayer.frame = 0;
+	backLayer.valid = FALSE;
+	DestroyDrawable (ReleaseDrawable (mapLayer.frame));
+	mapLayer.frame = 0;
+	mapLayer.valid = FALSE;
+}
+
+// Where the fuel range circle goes; extent 0 if it is not to be drawn
+static void
+GetFuelRect (COUNT race_update, COUNT which_space, RECT *pRect)
+{
+	long diameter;
+
+	pRect->corner.x = 0;
+	pRect->corner.y = 0;
+	pRect->extent.width = 0;
+	pRect->extent.height = 0;
+
+	if (race_update != 0 || which_space >= 2
+			|| !(diameter = (long)GLOBAL_SIS (FuelOnBoard) << 1))
+		return;
+
+	if (!inHQSpace ())
+		pRect->corner = CurStarDescPtr->star_pt;
+	else
 	{
-		SetTransitionSource (NULL);
+		pRect->corner.x = LOGX_TO_UNIVERSE (GLOBAL_SIS (log_x));
+		pRect->corner.y = LOGY_TO_UNIVERSE (GLOBAL_SIS (log_y));
 	}
-	BatchGraphics ();
-	
-	which_space = GET_GAME_STATE (ARILOU_SPACE_SIDE);
 
+	// Cap the diameter to a sane range
+	if (diameter > MAX_X_UNIVERSE * 4)
+		diameter = MAX_X_UNIVERSE * 4;
+
+	pRect->extent.width = UNIVERSE_TO_DISPX (diameter)
+			- UNIVERSE_TO_DISPX (0);
+	if (pRect->extent.width < 0)
+		pRect->extent.width = -pRect->extent.width;
+	pRect->extent.height = UNIVERSE_TO_DISPY (diameter)
+			- UNIVERSE_TO_DISPY (0);
+	if (pRect->extent.height < 0)
+		pRect->extent.height = -pRect->extent.height;
+
+	pRect->corner.x = UNIVERSE_TO_DISPX (pRect->corner.x)
+			- (pRect->extent.width >> 1);
+	pRect->corner.y = UNIVERSE_TO_DISPY (pRect->corner.y)
+			- (pRect->extent.height >> 1);
+}
+
+// The colors of the space and the grid
+static void
+SetMapColors (COUNT which_space)
+{
 	if (which_space <= 1)
 	{
-		SDPtr = &star_array[0];
 		SetContextForeGroundColor (
 				BUILD_COLOR (MAKE_RGB15 (0x00, 0x00, 0x07), 0x57));
 		SetContextBackGroundColor (BLACK_COLOR);
 	}
 	else
 	{
-		SDPtr = &star_array[NUM_SOLAR_SYSTEMS + 1];
 		SetContextForeGroundColor (
 				BUILD_COLOR (MAKE_RGB15 (0x00, 0x0B, 0x00), 0x6D));
 		SetContextBackGroundColor (
 				BUILD_COLOR (MAKE_RGB15 (0x00, 0x08, 0x00), 0x6E));
 	}
+}
+
+// The fuel range circle and the grid, on the space color
+static void
+DrawMapBackground (COUNT which_space, RECT *fuel_r)
+{
+#define GRID_DELTA 500
+	SIZE i;
+	RECT r;
+
+	SetMapColors (which_space);
 	ClearDrawable ();
 
 	// Draw the fuel range circle
-	if (race_update == 0
-			&& which_space < 2
-			&& (diameter = (long)GLOBAL_SIS (FuelOnBoard) << 1))
+	if (fuel_r->extent.width || fuel_r->extent.height)
 	{
 		Color OldColor;
 
-		if (!inHQSpace ())
-			r.corner = CurStarDescPtr->star_pt;
-		else
-		{
-			r.corner.x = LOGX_TO_UNIVERSE (GLOBAL_SIS (log_x));
-			r.corner.y = LOGY_TO_UNIVERSE (GLOBAL_SIS (log_y));
-		}
-
-		// Cap the diameter to a sane range
-		if (diameter > MAX_X_UNIVERSE * 4)
-			diameter = MAX_X_UNIVERSE * 4;
-
-		r.extent.width = UNIVERSE_TO_DISPX (diameter)
-				- UNIVERSE_TO_DISPX (0);
-		if (r.extent.width < 0)
-			r.extent.width = -r.extent.width;
-		r.extent.height = UNIVERSE_TO_DISPY (diameter)
-				- UNIVERSE_TO_DISPY (0);
-		if (r.extent.height < 0)
-			r.extent.height = -r.extent.height;
-
-		r.corner.x = UNIVERSE_TO_DISPX (r.corner.x)
-				- (r.extent.width >> 1);
-		r.corner.y = UNIVERSE_TO_DISPY (r.corner.y)
-				- (r.extent.height >> 1);
-
 		OldColor = SetContextForeGroundColor (
 				BUILD_COLOR (MAKE_RGB15 (0x03, 0x03, 0x03), 0x22));
-		DrawFilledOval (&r);
+		DrawFilledOval (fuel_r);
 		SetContextForeGroundColor (OldColor);
 	}
 
@@ -397,92 +465,124 @@ DrawStarMap (COUNT race_update, RECT *pClipRect)
 			DrawFilledRectangle (&r);
 		}
 	}
+}
 
-	star_frame = SetRelFrameIndex (StarMapFrame, 2);
-	if (which_space <= 1)
+static void
+DrawSpheres (COUNT race_update, RECT *pClipRect)
+{
+	COUNT index;
+	HFLEETINFO hStarShip, hNextShip;
+	RECT r;
+	static const Color race_colors[] =
 	{
-		COUNT index;
-		HFLEETINFO hStarShip, hNextShip;
-		static const Color race_colors[] =
-		{
-			RACE_COLORS
-		};
+		RACE_COLORS
+	};
 
-		for (index = 0,
-				hStarShip = GetHeadLink (&GLOBAL (avail_race_q));
-				hStarShip != 0; ++index, hStarShip = hNextShip)
-		{
-			FLEET_INFO *FleetPtr;
+	for (index = 0,
+			hStarShip = GetHeadLink (&GLOBAL (avail_race_q));
+			hStarShip != 0; ++index, hStarShip = hNextShip)
+	{
+		FLEET_INFO *FleetPtr;
 
-			FleetPtr = LockFleetInfo (&GLOBAL (avail_race_q), hStarShip);
-			hNextShip = _GetSuccLink (FleetPtr);
+		FleetPtr = LockFleetInfo (&GLOBAL (avail_race_q), hStarShip);
+		hNextShip = _GetSuccLink (FleetPtr);
 
-			if (FleetPtr->known_strength)
+		if (FleetPtr->known_strength)
+		{
+			RECT repair_r;
+
+			GetSphereRect (FleetPtr, &r, &repair_r);
+			if (r.corner.x < SIS_SCREEN_WIDTH
+					&& r.corner.y < SIS_SCREEN_HEIGHT
+					&& r.corner.x + r.extent.width > 0
+					&& r.corner.y + r.extent.height > 0
+					&& (pClipRect == 0
+					|| (repair_r.corner.x < pClipRect->corner.x + pClipRect->extent.width
+					&& repair_r.corner.y < pClipRect->corner.y + pClipRect->extent.height
+					&& repair_r.corner.x + repair_r.extent.width > pClipRect->corner.x
+					&& repair_r.corner.y + repair_r.extent.height > pClipRect->corner.y)))
 			{
-				RECT repair_r;
-
-				GetSphereRect (FleetPtr, &r, &repair_r);
-				if (r.corner.x < SIS_SCREEN_WIDTH
-						&& r.corner.y < SIS_SCREEN_HEIGHT
-						&& r.corner.x + r.extent.width > 0
-						&& r.corner.y + r.extent.height > 0
-						&& (pClipRect == 0
-						|| (repair_r.corner.x < pClipRect->corner.x + pClipRect->extent.width
-						&& repair_r.corner.y < pClipRect->corner.y + pClipRect->extent.height
-						&& repair_r.corner.x + repair_r.extent.width > pClipRect->corner.x
-						&& repair_r.corner.y + repair_r.extent.height > pClipRect->corner.y)))
-				{
-					Color c;
-					TEXT t;
-					STRING locString;
-
-					c = race_colors[index];
-					if (index + 1 == race_update)
-						SetContextForeGroundColor (WHITE_COLOR);
-					else
-						SetContextForeGroundColor (c);
-					DrawOval (&r, 0);
-
-					SetContextFont (TinyFont);
-
-					t.baseline.x = r.corner.x + (r.extent.width >> 1);
-					t.baseline.y = r.corner.y + (r.extent.height >> 1) - 1;
-					t.align = ALIGN_CENTER;
-					locString = SetAbsStringTableIndex (
-							FleetPtr->race_strings, 1);
-					t.CharCount = GetStringLength (locString);
-					t.pStr = (UNICODE *)GetStringAddress (locString);
-					TextRect (&t, &r, NULL);
-
-					if (r.corner.x <= 0)
-						t.baseline.x -= r.corner.x - 1;
-					else if (r.corner.x + r.extent.width >= SIS_SCREEN_WIDTH)
-						t.baseline.x -= (r.corner.x + r.extent.width)
-								- SIS_SCREEN_WIDTH + 1;
-					if (r.corner.y <= 0)
-						t.baseline.y -= r.corner.y - 1;
-					else if (r.corner.y + r.extent.height >= SIS_SCREEN_HEIGHT)
-						t.baseline.y -= (r.corner.y + r.extent.height)
-								- SIS_SCREEN_HEIGHT + 1;
-
-					// The text color is slightly lighter than the color of
-					// the SoI.
-					c.r = (c.r >= 0xff - CC5TO8 (0x03)) ?
-							0xff : c.r + CC5TO8 (0x03);
-					c.g = (c.g >= 0xff - CC5TO8 (0x03)) ?
-							0xff : c.g + CC5TO8 (0x03);
-					c.b = (c.b >= 0xff - CC5TO8 (0x03)) ?
-							0xff : c.b + CC5TO8 (0x03);
+				Color c;
+				TEXT t;
+				STRING locString;
 
+				c = race_colors[index];
+				if (index + 1 == race_update)
+					SetContextForeGroundColor (WHITE_COLOR);
+				else
 					SetContextForeGroundColor (c);
-					font_DrawText (&t);
-				}
+				DrawOval (&r, 0);
+
+				SetContextFont (TinyFont);
+
+				t.baseline.x = r.corner.x + (r.extent.width >> 1);
+				t.baseline.y = r.corner.y + (r.extent.height >> 1) - 1;
+				t.align = ALIGN_CENTER;
+				locString = SetAbsStringTableIndex (
+						FleetPtr->race_strings, 1);
+				t.CharCount = GetStringLength (locString);
+				t.pStr = (UNICODE *)GetStringAddress (locString);
+				TextRect (&t, &r, NULL);
+
+				if (r.corner.x <= 0)
+					t.baseline.x -= r.corner.x - 1;
+				else if (r.corner.x + r.extent.width >= SIS_SCREEN_WIDTH)
+					t.baseline.x -= (r.corner.x + r.extent.width)
+							- SIS_SCREEN_WIDTH + 1;
+				if (r.corner.y <= 0)
+					t.baseline.y -= r.corner.y - 1;
+				else if (r.corner.y + r.extent.height >= SIS_SCREEN_HEIGHT)
+					t.baseline.y -= (r.corner.y + r.extent.height)
+							- SIS_SCREEN_HEIGHT + 1;
+
+				// The text color is slightly lighter than the color of
+				// the SoI.
+				c.r = (c.r >= 0xff - CC5TO8 (0x03)) ?
+						0xff : c.r + CC5TO8 (0x03);
+				c.g = (c.g >= 0xff - CC5TO8 (0x03)) ?
+						0xff : c.g + CC5TO8 (0x03);
+				c.b = (c.b >= 0xff - CC5TO8 (0x03)) ?
+						0xff : c.b + CC5TO8 (0x03);
+
+				SetContextForeGroundColor (c);
+				font_DrawText (&t);
 			}
-
-			UnlockFleetInfo (&GLOBAL (avail_race_q), hStarShip);
 		}
+
+		UnlockFleetInfo (&GLOBAL (avail_race_q), hStarShip);
 	}
+}
+
+// Whether any of the stamp is inside the rect
+static BOOLEAN
+StampShows (const STAMP *s, const RECT *pRect)
+{
+	RECT r;
+
+	GetFrameRect (s->frame, &r);
+	r.corner.x += s->origin.x;
+	r.corner.y += s->origin.y;
+	return r.corner.x < pRect->corner.x + pRect->extent.width
+			&& r.corner.y < pRect->corner.y + pRect->extent.height
+			&& r.corner.x + r.extent.width > pRect->corner.x
+			&& r.corner.y + r.extent.height > pRect->corner.y;
+}
+
+// The stars, and the QuasiSpace portal when it is known. With pClipRect,
+// only those that can show in it.
+static void
+DrawStars (COUNT which_space, RECT *pClipRect)
+{
+	STAMP s;
+	FRAME star_frame;
+	STAR_DESC *SDPtr;
+
+	if (which_space <= 1)
+		SDPtr = &star_array[0];
+	else
+		SDPtr = &star_array[NUM_SOLAR_SYSTEMS + 1];
 
+	star_frame = SetRelFrameIndex (StarMapFrame, 2);
 	do
 	{
 		BYTE star_type;
@@ -503,7 +603,9 @@ DrawStarMap (COUNT race_update, RECT *pClipRect)
 		else
 			s.frame = SetRelFrameIndex (star_frame,
 					GIANT_STAR * NUM_STAR_COLORS + GREEN_BODY);
-		DrawStamp (&s);
+
+		if (!pClipRect || StampShows (&s, pClipRect))
+			DrawStamp (&s);
 
 		++SDPtr;
 	} while (SDPtr->star_pt.x <= MAX_X_UNIVERSE
@@ -525,6 +627,78 @@ DrawStarMap (COUNT race_update, RECT *pClipRect)
 				GIANT_STAR * NUM_STAR_COLORS + GREEN_BODY);
 		DrawStamp (&s);
 	}
+}
+
+static void
+DrawStarMap (COUNT race_update, RECT *pClipRect)
+{
+	COUNT which_space;
+	RECT r, old_r, fuel_r;
+	POINT oldOrigin = {0, 0};
+	BOOLEAN draw_cursor;
+
+	if (pClipRect == (RECT*)-1)
+	{
+		pClipRect = 0;
+		draw_cursor = FALSE;
+	}
+	else
+	{
+		draw_cursor = TRUE;
+	}
+
+	which_space = GET_GAME_STATE (ARILOU_SPACE_SIDE);
+	GetFuelRect (race_update, which_space, &fuel_r);
+
+	if (race_update != 0)
+		mapLayer.valid = FALSE;
+	if (!layerMatches (&backLayer, which_space, &fuel_r))
+	{
+		CONTEXT OldContext = beginLayer (&backLayer, which_space, &fuel_r);
+		DrawMapBackground (which_space, &fuel_r);
+		SetContext (OldContext);
+		mapLayer.valid = FALSE;
+	}
+	if (race_update == 0 && !layerMatches (&mapLayer, which_space, &fuel_r))
+	{
+		CONTEXT OldContext = beginLayer (&mapLayer, which_space, &fuel_r);
+		drawLayer (&backLayer);
+		if (which_space <= 1)
+			DrawSpheres (0, NULL);
+		DrawStars (which_space, NULL);
+		SetContext (OldContext);
+	}
+
+	SetContext (SpaceContext);
+	if (pClipRect)
+	{
+		GetContextClipRect (&old_r);
+		pClipRect->corner.x += old_r.corner.x;
+		pClipRect->corner.y += old_r.corner.y;
+		SetContextClipRect (pClipRect);
+		pClipRect->corner.x -= old_r.corner.x;
+		pClipRect->corner.y -= old_r.corner.y;
+		// Offset the origin so that we draw the correct gfx in the cliprect
+		oldOrigin = SetContextOrigin (MAKE_POINT (-pClipRect->corner.x,
+				-pClipRect->corner.y));
+	}
+
+	if (transition_pending)
+	{
+		SetTransitionSource (NULL);
+	}
+	BatchGraphics ();
+
+	SetMapColors (which_space);
+	if (race_update == 0)
+		drawLayer (&mapLayer);
+	else
+	{	// The spheres are on the move
+		drawLayer (&backLayer);
+		if (which_space <= 1)
+			DrawSpheres (race_update, pClipRect);
+		DrawStars (which_space, pClipRect);
+	}
 
 	if (race_update == 0
 			&& GLOBAL (autopilot.x) != ~0
@@ -817,42 +991,160 @@ typedef struct starsearch_state
 	int PrefixLen;
 	int ClusterLen;
 	int ClusterPos;
+	int MatchStart;
+	int MatchEnd;
+			// The range of SortedStars with a matching cluster name
+	UNICODE PrefixKey[STAR_SEARCH_BUFSIZE];
+			// Prefix in upper case
 	int SortedStars[NUM_SOLAR_SYSTEMS];
 } STAR_SEARCH_STATE;
 
+// The stars by name, for the star search: sorted on the upper case cluster
+// name, then on the Greek letter. With each the upper case cluster name and
+// full name, for the (case insensitive) prefix matching. Made the first
+// time the search is used; the names do not change while the game runs.
+typedef struct
+{
+	int star;
+			// Index in star_array
+	const UNICODE *clusterKey;
+	const UNICODE *nameKey;
+} STAR_NAME_ENTRY;
+
+static STAR_NAME_ENTRY *starNames;
+
+// Upper case version of str in dst; returns the length, including the
+// terminating 0
+static size_t
+StarNameKey (UNICODE *dst, size_t size, const UNICODE *str)
+{
+	UNICODE *start = dst;
+	UniChar ch;
+
+	while ((ch = getCharFromString (&str)) != '\0')
+	{
+		int len = getStringFromChar (dst, size - 1 - (dst - start),
+				UniChar_toUpper (ch));
+		if (len <= 0)
+			break;
+		dst += len;
+	}
+	*dst = '\0';
+	return dst - start + 1;
+}
+
 static int
 compStarName (const void *ptr1, const void *ptr2)
 {
-	int index1;
-	int index2;
+	const STAR_NAME_ENTRY *entry1 = (const STAR_NAME_ENTRY *) ptr1;
+	const STAR_NAME_ENTRY *entry2 = (const STAR_NAME_ENTRY *) ptr2;
+	const STAR_DESC *SDPtr1 = &star_array[entry1->star];
+	const STAR_DESC *SDPtr2 = &star_array[entry2->star];
+	int cmp;
 
-	index1 = *(const int *) ptr1;
-	index2 = *(const int *) ptr2;
-	if (star_array[index1].Postfix != star_array[index2].Postfix)
+	if (SDPtr1->Postfix != SDPtr2->Postfix)
 	{
-		return utf8StringCompare (GAME_STRING (star_array[index1].Postfix),
-				GAME_STRING (star_array[index2].Postfix));
+		cmp = strcmp ((const char *) entry1->clusterKey,
+				(const char *) entry2->clusterKey);
+		if (cmp == 0)
+			cmp = utf8StringCompare (GAME_STRING (SDPtr1->Postfix),
+					GAME_STRING (SDPtr2->Postfix));
+		if (cmp == 0)
+			cmp = SDPtr1->Postfix < SDPtr2->Postfix ? -1 : 1;
+				// Keep the clusters together
+		return cmp;
 	}
 
-	if (star_array[index1].Prefix < star_array[index2].Prefix)
+	if (SDPtr1->Prefix < SDPtr2->Prefix)
 		return -1;
 	
-	if (star_array[index1].Prefix > star_array[index2].Prefix)
+	if (SDPtr1->Prefix > SDPtr2->Prefix)
 		return 1;
 
 	return 0;
 }
 
+static void
+MakeStarNameIndex (void)
+{
+	UNICODE name[STAR_SEARCH_BUFSIZE];
+	UNICODE buf[STAR_SEARCH_BUFSIZE];
+	UNICODE *keys, *key;
+	size_t size = 0;
+	int i;
+
+	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
+	{
+		size += StarNameKey (buf, sizeof buf,
+				GAME_STRING (star_array[i].Postfix));
+		GetClusterName (&star_array[i], name);
+		size += StarNameKey (buf, sizeof buf, name);
+	}
+
+	// The keys follow the entries
+	starNames = HMalloc (NUM_SOLAR_SYSTEMS * sizeof (STAR_NAME_ENTRY)
+			+ size);
+	keys = (UNICODE *) &starNames[NUM_SOLAR_SYSTEMS];
+	for (i = 0, key = keys; i < NUM_SOLAR_SYSTEMS; i++)
+	{
+		starNames[i].star = i;
+		starNames[i].clusterKey = key;
+		key += StarNameKey (key, size - (key - keys),
+				GAME_STRING (star_array[i].Postfix));
+		starNames[i].nameKey = key;
+		GetClusterName (&star_array[i], name);
+		key += StarNameKey (key, size - (key - keys), name);
+	}
+
+	qsort (starNames, NUM_SOLAR_SYSTEMS, sizeof (STAR_NAME_ENTRY),
+			compStarName);
+}
+
 static void
 SortStarsOnName (STAR_SEARCH_STATE *pSS)
 {
 	int i;
-	int *sorted = pSS->SortedStars;
+
+	if (!starNames)
+		MakeStarNameIndex ();
 
 	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
-		sorted[i] = i;
+		pSS->SortedStars[i] = starNames[i].star;
+}
+
+// Finds the range of starNames whose cluster name starts with key
+static void
+FindClusterRange (STAR_SEARCH_STATE *pSS, const UNICODE *key)
+{
+	size_t len = strlen ((const char *) key);
+	int lo, hi;
 
-	qsort (sorted, NUM_SOLAR_SYSTEMS, sizeof (int), compStarName);
+	// The first cluster name not before key
+	lo = 0;
+	hi = NUM_SOLAR_SYSTEMS;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) >> 1;
+		if (strcmp ((const char *) starNames[mid].clusterKey,
+				(const char *) key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	pSS->MatchStart = lo;
+
+	// The first one after that which does not start with key
+	hi = NUM_SOLAR_SYSTEMS;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) >> 1;
+		if (strncmp ((const char *) starNames[mid].clusterKey,
+				(const char *) key, len) == 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	pSS->MatchEnd = lo;
 }
 
 static void
@@ -932,38 +1224,12 @@ FindNextStarIndex (STAR_SEARCH_STATE *pSS, int from, BOOLEAN WithinClust)
 	if (!pSS->Cluster)
 		return -1; // nothing to search for
 
-	for (i = from; i < NUM_SOLAR_SYSTEMS; ++i)
+	if (from < pSS->MatchStart)
+		from = pSS->MatchStart;
+
+	for (i = from; i < pSS->MatchEnd; ++i)
 	{
 		STAR_DESC *SDPtr = &star_array[pSS->SortedStars[i]];
-		UNICODE FullName[STAR_SEARCH_BUFSIZE];
-		UNICODE *ClusterName = GAME_STRING (SDPtr->Postfix);
-		const UNICODE *sptr;
-		const UNICODE *dptr;
-		int dlen;
-		int c;
-		
-		dlen = utf8StringCount (ClusterName);
-		if (pSS->ClusterLen > dlen)
-		{	// no match, skip the rest of cluster
-			i = SkipStarCluster (pSS->SortedStars, i) - 1;
-			continue;
-		}
-
-		for (c = 0, sptr = pSS->Cluster, dptr = ClusterName;
-				c < pSS->ClusterLen; ++c)
-		{
-			UniChar sc = getCharFromString (&sptr);
-			UniChar dc = getCharFromString (&dptr);
-
-			if (UniChar_toUpper (sc) != UniChar_toUpper (dc))
-				break;
-		}
-
-		if (c < pSS->ClusterLen)
-		{	// no match here, skip the rest of cluster
-			i = SkipStarCluster (pSS->SortedStars, i) - 1;
-			continue;
-		}
 
 		if (pSS->Prefix && !SDPtr->Prefix)
 			// we were given a prefix but found a singular star;
@@ -990,26 +1256,13 @@ FindNextStarIndex (STAR_SEARCH_STATE *pSS, int from, BOOLEAN WithinClust)
 		}
 
 		// check prefix
-		GetClusterName (SDPtr, FullName);
-		dlen = utf8StringCount (FullName);
-		if (pSS->PrefixLen > dlen)
-			continue;
-
-		for (c = 0, sptr = pSS->Prefix, dptr = FullName;
-				c < pSS->PrefixLen; ++c)
-		{
-			UniChar sc = getCharFromString (&sptr);
-			UniChar dc = getCharFromString (&dptr);
-
-			if (UniChar_toUpper (sc) != UniChar_toUpper (dc))
-				break;
-		}
-
-		if (c >= pSS->PrefixLen)
+		if (strncmp ((const char *) starNames[i].nameKey,
+				(const char *) pSS->PrefixKey,
+				strlen ((const char *) pSS->PrefixKey)) == 0)
 			break; // found one
 	}
 
-	return (i < NUM_SOLAR_SYSTEMS) ? i : -1;
+	return (i < pSS->MatchEnd) ? i : -1;
 }
 
 static void
@@ -1063,6 +1316,19 @@ MatchNextStar (STAR_SEARCH_STATE *pSS, BOOLEAN Reset)
 		pSS->SingleMatch = FALSE;
 		strcpy (pSS->Buffer, pSS->Text);
 		SplitStarName (pSS);
+
+		pSS->MatchStart = pSS->MatchEnd = 0;
+		pSS->PrefixKey[0] = '\0';
+		if (pSS->Cluster)
+		{
+			UNICODE key[STAR_SEARCH_BUFSIZE];
+
+			StarNameKey (key, sizeof key, pSS->Cluster);
+			FindClusterRange (pSS, key);
+		}
+		if (pSS->Prefix)
+			StarNameKey (pSS->PrefixKey, sizeof pSS->PrefixKey,
+					pSS->Prefix);
 	}
 
 	pSS->CurIndex = FindNextStarIndex (pSS, pSS->CurIndex + 1,
@@ -1617,6 +1883,8 @@ StarMap (void)
 	SetMenuSounds (MENU_SOUND_ARROWS, MENU_SOUND_SELECT);
 	SetDefaultMenuRepeatDelay ();
 
+	FreeStarMapLayers ();
+
 	DrawHyperCoords (universe);
 	DrawSISMessage (NULL);
 	DrawStatusMessage (NULL);
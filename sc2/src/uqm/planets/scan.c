@@ -798,8 +798,25 @@ PickPlanetSide (void)
 
 #define NUM_FLASH_COLORS 8
 
+// Draws a node that is done flashing into the tint frame, which
+// DrawPlanet() draws the scanned part of the map from. It is drawn there
+// once, instead of onto the screen on every line of the scan.
 static void
-DrawScannedStuff (COUNT y, COUNT scan)
+DrawScannedNodeToTint (STAMP *s)
+{
+	CONTEXT OldContext;
+
+	OldContext = SetContext (OffScreenContext);
+	SetContextFGFrame (pSolarSysState->Orbit.TintFrame);
+	SetContextClipRect (NULL);
+	DrawStamp (s);
+	SetContext (OldContext);
+}
+
+// Draws the nodes of type 'scan' that line 'y' of the scan has reached.
+// 'lastY' is the line this was last called for during this scan, or -1.
+static void
+DrawScannedStuff (SIZE lastY, COUNT y, COUNT scan)
 {
 	HELEMENT hElement, hNextElement;
 	Color OldColor;
@@ -829,8 +846,13 @@ DrawScannedStuff (COUNT y, COUNT scan)
 		
 		if (dy >= NUM_FLASH_COLORS)
 		{	// flashing done for this node, draw normal
-			s.frame = ElementPtr->next.image.frame;
-			DrawStamp (&s);
+			if (lastY - ElementPtr->current.location.y < NUM_FLASH_COLORS)
+			{	// Not in the tint frame yet, so not drawn with the
+				// planet either
+				s.frame = ElementPtr->next.image.frame;
+				DrawScannedNodeToTint (&s);
+				DrawStamp (&s);
+			}
 		}
 		else
 		{
@@ -989,6 +1011,9 @@ ScanPlanet (COUNT scanType)
 		UnbatchGraphics ();
 
 		tintColor = tintColors[scan];
+		// Have the tint frame made again, without the nodes that
+		// DrawScannedStuff() put in it during the last scan
+		pSolarSysState->Orbit.TintColor = BLACK_COLOR;
 
 		// Draw the scan slowly line by line
 		TimeOut = GetTimeCounter ();
@@ -1000,7 +1025,7 @@ ScanPlanet (COUNT scanType)
 
 			BatchGraphics ();
 			DrawPlanet (i, tintColor);
-			DrawScannedStuff (i, scan);
+			DrawScannedStuff (i - 1, i, scan);
 			UnbatchGraphics ();
 #ifdef SPIN_ON_SCAN
 			RotatePlanetSphere (TRUE);
@@ -1011,7 +1036,7 @@ ScanPlanet (COUNT scanType)
 		{	// Aborted by a keypress; draw in finished state
 			BatchGraphics ();
 			DrawPlanet (SCAN_LINES - 1, tintColor);
-			DrawScannedStuff (SCAN_LINES - 1, scan);
+			DrawScannedStuff (i - 1, SCAN_LINES - 1, scan);
 			UnbatchGraphics ();
 		}
 	}
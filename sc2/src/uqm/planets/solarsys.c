@@ -44,6 +44,7 @@
 #include "../save.h"
 #include "options.h"
 #include "libs/graphics/gfx_common.h"
+#include "libs/time/framepace.h"
 #include "libs/mathlib.h"
 #include "libs/log.h"
 #include "libs/misc.h"
@@ -56,6 +57,8 @@
 
 static BOOLEAN DoIpFlight (SOLARSYS_STATE *pSS);
 static void DrawSystem (SIZE radius, BOOLEAN IsInnerSystem);
+static void ForgetOuterViews (void);
+static void FreeSystemViews (void);
 static FRAME CreateStarBackGround (void);
 static void DrawInnerSystem (void);
 static void DrawOuterSystem (void);
@@ -90,7 +93,15 @@ BYTE EncounterGroup;
 static FRAME StarsFrame;
 		// prepared star-field graphic
 static FRAME SolarSysFrame;
-		// saved solar system view graphic
+		// saved solar system view graphic; the one of the frames below
+		// being shown
+static FRAME InnerSysFrame;
+#define NUM_SAVED_OUTER_VIEWS 2
+static FRAME OuterSysFrames[NUM_SAVED_OUTER_VIEWS];
+static SIZE OuterSysRadii[NUM_SAVED_OUTER_VIEWS];
+		// The zoom each outer view was drawn at; 0 if none. The orbits
+		// only need drawing again when the zoom changes, and flying in
+		// and out of a zoom boundary goes back and forth between two.
 
 static RECT scaleRect;
 		// system zooms in when the flagship enters this rect
@@ -256,6 +267,10 @@ FreeIPData (void)
 	DestroyMusic (SpaceMusic);
 	SpaceMusic = 0;
 
+	StopSurfaceGeneration ();
+	TopoCache_Uninit ();
+	UninitSphereTiltCache ();
+
 	RandomContext_Delete (SysGenRNG);
 	SysGenRNG = NULL;
 }
@@ -505,8 +520,7 @@ FreeSolarSys (void)
 			saveNonOrbitalLocation ();
 	}
 
-	DestroyDrawable (ReleaseDrawable (SolarSysFrame));
-	SolarSysFrame = NULL;
+	FreeSystemViews ();
 
 	StopMusic ();
 
@@ -917,6 +931,9 @@ enterInnerSystem (PLANET_DESC *planet)
 	GenerateMoons (pSolarSysState, planet);
 	pSolarSysState->pBaseDesc = pSolarSysState->MoonDesc;
 	pSolarSysState->pOrbitalDesc = planet;
+
+	// The ship may go into orbit around any of these now
+	StartSurfaceGeneration (planet, pSolarSysState->MoonDesc);
 }
 
 static void
@@ -924,6 +941,8 @@ leaveInnerSystem (PLANET_DESC *planet)
 {
 	COUNT outerPlanetWait;
 
+	StopSurfaceGeneration ();
+
 	pSolarSysState->pBaseDesc = pSolarSysState->PlanetDesc;
 	pSolarSysState->pOrbitalDesc = NULL;
 
@@ -1226,6 +1245,8 @@ ResetSolarSys (void)
 	// probably needed on 3DO when IP_frame() was a task.
 	assert (!pSolarSysState->InIpFlight);
 
+	// What was done outside of IP flight may have changed the system
+	ForgetOuterViews ();
 	DrawMenuStateStrings (PM_STARMAP, -(PM_NAVIGATE - PM_SCAN));
 
 	InitDisplayList ();
@@ -1364,6 +1385,12 @@ InitSolarSys (void)
 		(*pSolarSysState->genFuncs->initNpcs) (pSolarSysState);
 	}
 
+	if (InnerSystem && !orbital)
+	{	// Loaded into or came back to the inner system
+		StartSurfaceGeneration (pSolarSysState->pOrbitalDesc,
+				pSolarSysState->MoonDesc);
+	}
+
 	if (orbital)
 	{
 		enterOrbital (orbital);
@@ -1459,6 +1486,7 @@ closestPlanetInterPlanetary (const POINT *point)
 static void
 UninitSolarSys (void)
 {
+	StopSurfaceGeneration ();
 	FreeSolarSys ();
 
 //FreeLanderData ();
@@ -1546,6 +1574,69 @@ DrawInnerPlanets (PLANET_DESC *planet)
 	}
 }
 
+static FRAME
+CreateSystemView (void)
+{
+	RECT clipRect;
+
+	GetContextClipRect (&clipRect);
+	return CaptureDrawable (CreateDrawable (WANT_PIXMAP,
+			clipRect.extent.width, clipRect.extent.height, 1));
+}
+
+static void
+ForgetOuterViews (void)
+{
+	COUNT i;
+
+	for (i = 0; i < NUM_SAVED_OUTER_VIEWS; ++i)
+		OuterSysRadii[i] = 0;
+}
+
+static void
+FreeSystemViews (void)
+{
+	COUNT i;
+
+	for (i = 0; i < NUM_SAVED_OUTER_VIEWS; ++i)
+	{
+		DestroyDrawable (ReleaseDrawable (OuterSysFrames[i]));
+		OuterSysFrames[i] = NULL;
+		OuterSysRadii[i] = 0;
+	}
+	DestroyDrawable (ReleaseDrawable (InnerSysFrame));
+	InnerSysFrame = NULL;
+	SolarSysFrame = NULL;
+}
+
+// Returns TRUE if the outer view at this zoom is saved already
+static BOOLEAN
+SelectOuterView (SIZE radius)
+{
+	COUNT i;
+
+	for (i = 0; i < NUM_SAVED_OUTER_VIEWS; ++i)
+	{
+		if (OuterSysRadii[i] == radius && OuterSysFrames[i])
+		{
+			SolarSysFrame = OuterSysFrames[i];
+			return TRUE;
+		}
+	}
+
+	// Draw over the one not being shown
+	for (i = 0; i < NUM_SAVED_OUTER_VIEWS - 1; ++i)
+	{
+		if (OuterSysFrames[i] != SolarSysFrame)
+			break;
+	}
+	if (!OuterSysFrames[i])
+		OuterSysFrames[i] = CreateSystemView ();
+	OuterSysRadii[i] = radius;
+	SolarSysFrame = OuterSysFrames[i];
+	return FALSE;
+}
+
 static void
 DrawSystem (SIZE radius, BOOLEAN IsInnerSystem)
 {
@@ -1555,13 +1646,17 @@ DrawSystem (SIZE radius, BOOLEAN IsInnerSystem)
 	CONTEXT oldContext;
 	STAMP s;
 
-	if (!SolarSysFrame)
-	{	// Create the saved view graphic
-		RECT clipRect;
-
-		GetContextClipRect (&clipRect);
-		SolarSysFrame = CaptureDrawable (CreateDrawable (WANT_PIXMAP,
-				clipRect.extent.width, clipRect.extent.height, 1));
+	if (IsInnerSystem)
+	{
+		if (!InnerSysFrame)
+			InnerSysFrame = CreateSystemView ();
+		SolarSysFrame = InnerSysFrame;
+	}
+	else if (SelectOuterView (radius))
+	{
+		CalcSunSize (&pSolarSysState->SunDesc[0], radius);
+		RestoreSystemView ();
+		return;
 	}
 
 	oldContext = SetContext (OffScreenContext);
@@ -1714,6 +1809,8 @@ ExploreSolarSys (void)
 {
 	SOLARSYS_STATE SolarSysState;
 	
+	res_PreloadSet ("preload.solarsys");
+
 	if (CurStarDescPtr == 0)
 	{
 		POINT universe;
@@ -1992,7 +2089,7 @@ SolarSysMenu (void)
 static BOOLEAN
 DoIpFlight (SOLARSYS_STATE *pSS)
 {
-	static TimeCount NextTime;
+	static FramePacer pacer;
 	BOOLEAN cancel = PulsedInputState.menu[KEY_MENU_CANCEL];
 
 	if (pSS->InOrbit)
@@ -2010,8 +2107,7 @@ DoIpFlight (SOLARSYS_STATE *pSS)
 	{
 		assert (pSS->InIpFlight);
 		IP_frame ();
-		SleepThreadUntil (NextTime);
-		NextTime = GetTimeCounter () + IP_FRAME_RATE;
+		FramePacer_wait (&pacer, IP_FRAME_RATE);
 	}
 
 	return (!(GLOBAL (CurrentActivity)
@@ -27,16 +27,88 @@
 const BYTE *Elements;
 const PlanetFrame *PlanData;
 
+#define MAX_SCAN_NODES (sizeof (DWORD) * 8)
+		// The retrieve masks have one bit per node
+
+// The nodes of the last world generated for one scan type. Asking for a
+// node means generating all the ones before it too, and GeneratePlanetSide()
+// asks for them one by one, so all of them are kept the first time. The
+// world is known by everything the generation depends on.
+typedef struct
+{
+	BOOLEAN valid;
+	DWORD scanSeed;
+	const PlanetFrame *planData;
+	COUNT param;
+			// StarSize for minerals, LifeChance for bio
+	COUNT numNodes;
+	NODE_INFO nodes[MAX_SCAN_NODES];
+	DWORD seedAfter[MAX_SCAN_NODES];
+			// The SysGenRNG state right after generating each node
+	DWORD endSeed;
+			// The SysGenRNG state after generating them all
+} NODE_CACHE;
+
+static NODE_CACHE mineralCache;
+static NODE_CACHE lifeCache;
+
+static BOOLEAN
+nodeCacheMatches (const NODE_CACHE *cache, const SYSTEM_INFO *SysInfoPtr,
+		BYTE scan, COUNT param)
+{
+	return cache->valid
+			&& cache->scanSeed == SysInfoPtr->PlanetInfo.ScanSeed[scan]
+			&& cache->planData == SysInfoPtr->PlanetInfo.PlanDataPtr
+			&& cache->param == param;
+}
+
+static void
+startNodeCache (NODE_CACHE *cache, const SYSTEM_INFO *SysInfoPtr,
+		BYTE scan, COUNT param)
+{
+	cache->valid = TRUE;
+	cache->scanSeed = SysInfoPtr->PlanetInfo.ScanSeed[scan];
+	cache->planData = SysInfoPtr->PlanetInfo.PlanDataPtr;
+	cache->param = param;
+	cache->numNodes = 0;
+	RandomContext_SeedRandom (SysGenRNG, cache->scanSeed);
+}
+
+// Returns TRUE if that was the last node there can be
+static BOOLEAN
+addCachedNode (NODE_CACHE *cache, const NODE_INFO *info)
+{
+	cache->nodes[cache->numNodes] = *info;
+	cache->seedAfter[cache->numNodes] = RandomContext_GetSeed (SysGenRNG);
+	return ++cache->numNodes == MAX_SCAN_NODES;
+}
+
+// Gives the same results, and leaves SysGenRNG in the same state, as
+// generating up to the node asked for would.
 static COUNT
-CalcMineralDeposits (const SYSTEM_INFO *SysInfoPtr, COUNT which_deposit,
-		NODE_INFO *info)
+getCachedNode (const NODE_CACHE *cache, COUNT whichNode, NODE_INFO *info)
+{
+	if (whichNode < cache->numNodes)
+	{
+		*info = cache->nodes[whichNode];
+		RandomContext_SeedRandom (SysGenRNG, cache->seedAfter[whichNode]);
+		return whichNode;
+	}
+
+	if (cache->numNodes > 0)
+		*info = cache->nodes[cache->numNodes - 1];
+	RandomContext_SeedRandom (SysGenRNG, cache->endSeed);
+	return cache->numNodes;
+}
+
+static void
+CalcMineralDeposits (const SYSTEM_INFO *SysInfoPtr, NODE_CACHE *cache)
 {
 	BYTE j;
-	COUNT num_deposits;
 	const ELEMENT_ENTRY *eptr;
+	NODE_INFO info;
 
 	eptr = &SysInfoPtr->PlanetInfo.PlanDataPtr->UsefulElements[0];
-	num_deposits = 0;
 	j = NUM_USEFUL_ELEMENTS;
 	do
 	{
@@ -63,26 +135,26 @@ CalcMineralDeposits (const SYSTEM_INFO *SysInfoPtr, COUNT which_deposit,
 			else
 				deposit_quality_gross = 2;
 
-			GenerateRandomLocation (&info->loc_pt);
+			GenerateRandomLocation (&info.loc_pt);
 
-			info->density = MAKE_WORD (
+			info.density = MAKE_WORD (
 					deposit_quality_gross, deposit_quality_fine / 10 + 1);
-			info->type = eptr->ElementType;
+			info.type = eptr->ElementType;
 #ifdef DEBUG_SURFACE
 			log_add (log_Debug, "\t\t%d units of %Fs",
-					info->density,
+					info.density,
 					Elements[eptr->ElementType].name);
 #endif /* DEBUG_SURFACE */
-			if (num_deposits >= which_deposit
-					|| ++num_deposits == sizeof (DWORD) * 8)
-			{	// reached the maximum or the requested node
-				return num_deposits;
+			if (addCachedNode (cache, &info))
+			{	// reached the maximum
+				cache->endSeed = RandomContext_GetSeed (SysGenRNG);
+				return;
 			}
 		}
 		++eptr;
 	} while (--j);
 
-	return num_deposits;
+	cache->endSeed = RandomContext_GetSeed (SysGenRNG);
 }
 
 // Returns:
@@ -96,18 +168,21 @@ GenerateMineralDeposits (const SYSTEM_INFO *SysInfoPtr, COUNT whichDeposit,
 	NODE_INFO temp_info;
 	if (!info) // user not interested in info but we need space for it
 		info = &temp_info;
-	RandomContext_SeedRandom (SysGenRNG,
-			SysInfoPtr->PlanetInfo.ScanSeed[MINERAL_SCAN]);
-	return CalcMineralDeposits (SysInfoPtr, whichDeposit, info);
+	if (!nodeCacheMatches (&mineralCache, SysInfoPtr, MINERAL_SCAN,
+			SysInfoPtr->StarSize))
+	{
+		startNodeCache (&mineralCache, SysInfoPtr, MINERAL_SCAN,
+				SysInfoPtr->StarSize);
+		CalcMineralDeposits (SysInfoPtr, &mineralCache);
+	}
+	return getCachedNode (&mineralCache, whichDeposit, info);
 }
 
-static COUNT
-CalcLifeForms (const SYSTEM_INFO *SysInfoPtr, COUNT which_life,
-		NODE_INFO *info)
+static void
+CalcLifeForms (const SYSTEM_INFO *SysInfoPtr, NODE_CACHE *cache)
 {
-	COUNT num_life_forms;
+	NODE_INFO info;
 
-	num_life_forms = 0;
 	if (PLANSIZE (SysInfoPtr->PlanetInfo.PlanDataPtr->Type) != GAS_GIANT)
 	{
 #define MIN_LIFE_CHANCE 10
@@ -132,14 +207,14 @@ CalcLifeForms (const SYSTEM_INFO *SysInfoPtr, COUNT which_life,
 				num_creatures = 1 + HIBYTE (rand_val) % 10;
 				do
 				{
-					GenerateRandomLocation (&info->loc_pt);
-					info->type = index;
-					info->density = 0;
-
-					if (num_life_forms >= which_life
-							|| ++num_life_forms == sizeof (DWORD) * 8)
-					{	// reached the maximum or the requested node
-						return num_life_forms;
+					GenerateRandomLocation (&info.loc_pt);
+					info.type = index;
+					info.density = 0;
+
+					if (addCachedNode (cache, &info))
+					{	// reached the maximum
+						cache->endSeed = RandomContext_GetSeed (SysGenRNG);
+						return;
 					}
 				} while (--num_creatures);
 			} while (--num_types);
@@ -153,7 +228,7 @@ CalcLifeForms (const SYSTEM_INFO *SysInfoPtr, COUNT which_life,
 #endif /* DEBUG_SURFACE */
 	}
 
-	return num_life_forms;
+	cache->endSeed = RandomContext_GetSeed (SysGenRNG);
 }
 
 // Returns:
@@ -167,9 +242,14 @@ GenerateLifeForms (const SYSTEM_INFO *SysInfoPtr, COUNT whichLife,
 	NODE_INFO temp_info;
 	if (!info) // user not interested in info but we need space for it
 		info = &temp_info;
-	RandomContext_SeedRandom (SysGenRNG,
-			SysInfoPtr->PlanetInfo.ScanSeed[BIOLOGICAL_SCAN]);
-	return CalcLifeForms (SysInfoPtr, whichLife, info);
+	if (!nodeCacheMatches (&lifeCache, SysInfoPtr, BIOLOGICAL_SCAN,
+			SysInfoPtr->PlanetInfo.LifeChance))
+	{
+		startNodeCache (&lifeCache, SysInfoPtr, BIOLOGICAL_SCAN,
+				SysInfoPtr->PlanetInfo.LifeChance);
+		CalcLifeForms (SysInfoPtr, &lifeCache);
+	}
+	return getCachedNode (&lifeCache, whichLife, info);
 }
 
 // Returns:
@@ -0,0 +1,385 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// A cache of generated planet surfaces. The elevation data of a world
+// without a surface definition, the light map made from it, and the
+// state generating it leaves SysGenRNG in, only depend on the rand_seed
+// and data_index of the world, so they are kept for the next visit.
+// The last few are kept in memory. With optTopoDiskCache they are also
+// kept in "topocache" under the config dir, one file per world:
+//   "UTOP", version, rand_seed, data_index, end seed, width, height,
+//   whether a light map follows (all 32 bits little endian)
+// then the elevation data and the light map, each row stored as the
+// differences from one point to the next, LZ compressed together.
+//
+// Only to be used from the main thread; the LZ codec is not reentrant.
+// Entries are never removed from the disk; delete the directory to start
+// over.
+
+#include "planets.h"
+#include "options.h"
+#include "libs/declib.h"
+#include "libs/uio.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TOPOCACHE_DIR "topocache"
+#define TOPOCACHE_MAGIC "UTOP"
+#define TOPOCACHE_VERSION 1
+		// Bump when the generators change what they make
+#define TOPOCACHE_HEADER_DWORDS 8
+#define TOPOCACHE_ENTRIES 16
+		// Kept in memory
+
+#define TOPO_SIZE (MAP_WIDTH * MAP_HEIGHT)
+
+typedef struct
+{
+	DWORD rand_seed;
+	BYTE data_index;
+	DWORD endSeed;
+	SBYTE *topo;
+			// NULL if the entry is not used
+	SBYTE *lightMap;
+			// NULL for gas giants
+	DWORD lastUse;
+} TOPO_CACHE_ENTRY;
+
+static TOPO_CACHE_ENTRY entries[TOPOCACHE_ENTRIES];
+static DWORD useCount;
+static uio_DirHandle *cacheDir;
+static BOOLEAN cacheDirTried;
+
+static void
+putDword (BYTE *buf, DWORD val)
+{
+	buf[0] = val & 0xff;
+	buf[1] = (val >> 8) & 0xff;
+	buf[2] = (val >> 16) & 0xff;
+	buf[3] = (val >> 24) & 0xff;
+}
+
+static DWORD
+getDword (const BYTE *buf)
+{
+	return (DWORD) buf[0] | ((DWORD) buf[1] << 8) |
+			((DWORD) buf[2] << 16) | ((DWORD) buf[3] << 24);
+}
+
+static uio_DirHandle *
+getCacheDir (void)
+{
+	if (!optTopoDiskCache || !configDir)
+		return NULL;
+	if (!cacheDirTried)
+	{
+		cacheDirTried = TRUE;
+		uio_mkdir (configDir, TOPOCACHE_DIR, 0777);
+				// Fails if it is there already, which is fine
+		cacheDir = uio_openDirRelative (configDir, TOPOCACHE_DIR, 0);
+		if (!cacheDir)
+			log_add (log_Warning, "Could not open the planet surface cache "
+					"directory; not using it.");
+	}
+	return cacheDir;
+}
+
+static void
+entryName (char *buf, size_t size, DWORD rand_seed, BYTE data_index)
+{
+	snprintf (buf, size, "%08lx-%02x.top", (unsigned long) rand_seed,
+			(unsigned) data_index);
+}
+
+static TOPO_CACHE_ENTRY *
+findEntry (const PLANET_DESC *world)
+{
+	COUNT i;
+
+	for (i = 0; i < TOPOCACHE_ENTRIES; ++i)
+	{
+		TOPO_CACHE_ENTRY *e = &entries[i];
+		if (e->topo && e->rand_seed == world->rand_seed
+				&& e->data_index == world->data_index)
+			return e;
+	}
+	return NULL;
+}
+
+// An unused entry, or else the one used longest ago, emptied
+static TOPO_CACHE_ENTRY *
+newEntry (void)
+{
+	COUNT i;
+	TOPO_CACHE_ENTRY *oldest = &entries[0];
+
+	for (i = 0; i < TOPOCACHE_ENTRIES; ++i)
+	{
+		TOPO_CACHE_ENTRY *e = &entries[i];
+		if (!e->topo)
+		{
+			oldest = e;
+			break;
+		}
+		if (e->lastUse < oldest->lastUse)
+			oldest = e;
+	}
+
+	HFree (oldest->topo);
+	oldest->topo = NULL;
+	HFree (oldest->lightMap);
+	oldest->lightMap = NULL;
+	return oldest;
+}
+
+static void
+deltaEncode (SBYTE *dst, const SBYTE *src)
+{
+	COUNT x, y;
+
+	for (y = 0; y < MAP_HEIGHT; ++y, src += MAP_WIDTH, dst += MAP_WIDTH)
+	{
+		dst[0] = src[0];
+		for (x = 1; x < MAP_WIDTH; ++x)
+			dst[x] = (SBYTE) (src[x] - src[x - 1]);
+	}
+}
+
+static void
+deltaDecode (SBYTE *data)
+{
+	COUNT x, y;
+
+	for (y = 0; y < MAP_HEIGHT; ++y, data += MAP_WIDTH)
+	{
+		for (x = 1; x < MAP_WIDTH; ++x)
+			data[x] = (SBYTE) (data[x] + data[x - 1]);
+	}
+}
+
+static void
+makeHeader (BYTE *header, const TOPO_CACHE_ENTRY *e)
+{
+	memcpy (header, TOPOCACHE_MAGIC, 4);
+	putDword (header + 4, TOPOCACHE_VERSION);
+	putDword (header + 8, e->rand_seed);
+	putDword (header + 12, e->data_index);
+	putDword (header + 16, e->endSeed);
+	putDword (header + 20, MAP_WIDTH);
+	putDword (header + 24, MAP_HEIGHT);
+	putDword (header + 28, e->lightMap != NULL);
+}
+
+static BOOLEAN
+readCompressed (SBYTE *data, DECODE_REF codec)
+{
+	if (cread (data, 1, TOPO_SIZE, codec) != TOPO_SIZE)
+		return FALSE;
+	deltaDecode (data);
+	return TRUE;
+}
+
+// Fills in the entry for the world from the disk, if it is there
+static BOOLEAN
+loadEntry (TOPO_CACHE_ENTRY *e, const PLANET_DESC *world)
+{
+	uio_DirHandle *dir = getCacheDir ();
+	char name[32];
+	uio_Stream *stream;
+	BYTE header[TOPOCACHE_HEADER_DWORDS * 4];
+	BYTE expected[TOPOCACHE_HEADER_DWORDS * 4];
+	DECODE_REF codec;
+	BOOLEAN ok;
+
+	if (!dir)
+		return FALSE;
+
+	entryName (name, sizeof name, world->rand_seed, world->data_index);
+	stream = uio_fopen (dir, name, "rb");
+	if (!stream)
+		return FALSE;
+
+	if (uio_fread (header, sizeof header, 1, stream) != 1)
+	{
+		uio_fclose (stream);
+		return FALSE;
+	}
+	// All but the end seed must be as expected
+	e->rand_seed = world->rand_seed;
+	e->data_index = world->data_index;
+	e->endSeed = getDword (header + 16);
+	e->lightMap = getDword (header + 28) ? HMalloc (TOPO_SIZE) : NULL;
+	e->topo = HMalloc (TOPO_SIZE);
+	makeHeader (expected, e);
+	codec = NULL;
+	ok = memcmp (header, expected, 16) == 0
+			&& memcmp (header + 20, expected + 20, sizeof header - 20) == 0
+			&& (codec = copen (stream, FILE_STREAM, STREAM_READ)) != NULL
+			&& readCompressed (e->topo, codec)
+			&& (!e->lightMap || readCompressed (e->lightMap, codec));
+	if (codec)
+		cclose (codec);
+	uio_fclose (stream);
+
+	if (!ok)
+	{
+		HFree (e->topo);
+		e->topo = NULL;
+		HFree (e->lightMap);
+		e->lightMap = NULL;
+	}
+	return ok;
+}
+
+static void
+saveEntry (const TOPO_CACHE_ENTRY *e)
+{
+	uio_DirHandle *dir = getCacheDir ();
+	char name[32];
+	uio_Stream *stream;
+	BYTE header[TOPOCACHE_HEADER_DWORDS * 4];
+	SBYTE *delta;
+	DECODE_REF codec;
+	BOOLEAN ok;
+
+	if (!dir)
+		return;
+
+	entryName (name, sizeof name, e->rand_seed, e->data_index);
+	stream = uio_fopen (dir, name, "wb");
+	if (!stream)
+		return;
+
+	makeHeader (header, e);
+	ok = uio_fwrite (header, sizeof header, 1, stream) == 1;
+	codec = ok ? copen (stream, FILE_STREAM, STREAM_WRITE) : NULL;
+	if (codec)
+	{
+		delta = HMalloc (TOPO_SIZE);
+		deltaEncode (delta, e->topo);
+		ok = cwrite (delta, 1, TOPO_SIZE, codec) == TOPO_SIZE;
+		if (ok && e->lightMap)
+		{
+			deltaEncode (delta, e->lightMap);
+			ok = cwrite (delta, 1, TOPO_SIZE, codec) == TOPO_SIZE;
+		}
+		cclose (codec);
+		HFree (delta);
+	}
+	else
+		ok = FALSE;
+	uio_fclose (stream);
+
+	if (!ok)
+	{	// Would only be taken as a miss, but do not leave it around
+		uio_unlink (dir, name);
+	}
+}
+
+static TOPO_CACHE_ENTRY *
+lookup (const PLANET_DESC *world)
+{
+	TOPO_CACHE_ENTRY *e = findEntry (world);
+
+	if (!e)
+	{
+		TOPO_CACHE_ENTRY loaded;
+
+		if (!loadEntry (&loaded, world))
+			return NULL;
+		e = newEntry ();
+		*e = loaded;
+	}
+	e->lastUse = ++useCount;
+	return e;
+}
+
+// TRUE if the surface of the world is in the cache, in memory or on disk
+BOOLEAN
+TopoCache_Has (const PLANET_DESC *world)
+{
+	return lookup (world) != NULL;
+}
+
+// Copies the cached elevation data of the world to topo, and returns the
+// light map made from it, if any, and the end state of the RNG. The light
+// map stays valid until the cache is used again. Returns FALSE
+// if the world is not in the cache.
+BOOLEAN
+TopoCache_Get (const PLANET_DESC *world, SBYTE *topo, const SBYTE **lightMap,
+		DWORD *endSeed)
+{
+	TOPO_CACHE_ENTRY *e = lookup (world);
+
+	if (!e)
+		return FALSE;
+	memcpy (topo, e->topo, TOPO_SIZE);
+	*lightMap = e->lightMap;
+	*endSeed = e->endSeed;
+	return TRUE;
+}
+
+// Keeps the surface of the world; lightMap is NULL for gas giants
+void
+TopoCache_Put (const PLANET_DESC *world, const SBYTE *topo,
+		const SBYTE *lightMap, DWORD endSeed)
+{
+	TOPO_CACHE_ENTRY *e = findEntry (world);
+
+	if (!e)
+		e = newEntry ();
+	else
+	{
+		HFree (e->topo);
+		HFree (e->lightMap);
+	}
+	e->rand_seed = world->rand_seed;
+	e->data_index = world->data_index;
+	e->endSeed = endSeed;
+	e->topo = HMalloc (TOPO_SIZE);
+	memcpy (e->topo, topo, TOPO_SIZE);
+	e->lightMap = NULL;
+	if (lightMap)
+	{
+		e->lightMap = HMalloc (TOPO_SIZE);
+		memcpy (e->lightMap, lightMap, TOPO_SIZE);
+	}
+	e->lastUse = ++useCount;
+
+	saveEntry (e);
+}
+
+void
+TopoCache_Uninit (void)
+{
+	COUNT i;
+
+	for (i = 0; i < TOPOCACHE_ENTRIES; ++i)
+	{
+		HFree (entries[i].topo);
+		entries[i].topo = NULL;
+		HFree (entries[i].lightMap);
+		entries[i].lightMap = NULL;
+	}
+	if (cacheDir)
+	{
+		uio_closeDir (cacheDir);
+		cacheDir = NULL;
+	}
+	cacheDirTried = FALSE;
+}
@@ -27,10 +27,14 @@
 #include "hyper.h"
 #include "element.h"
 #include "battle.h"
+#include "intel.h"
 #include "weapon.h"
+#include "shipprof.h"
+#include "libs/graphics/context.h"
 #include "libs/graphics/drawable.h"
 #include "libs/graphics/drawcmd.h"
 #include "libs/graphics/gfx_common.h"
+#include "libs/time/profile.h"
 #include "libs/log.h"
 #include "libs/misc.h"
 
@@ -75,6 +79,12 @@ CALC_ZOOM_STUFF (COUNT* idx, COUNT* sc)
 
 HELEMENT
 AllocElement (void)
+{
+	return AllocElementFrom (NULL);
+}
+
+HELEMENT
+AllocElementFrom (const ELEMENT *Template)
 {
 	HELEMENT hElement;
 
@@ -84,7 +94,10 @@ AllocElement (void)
 		ELEMENT *ElementPtr;
 
 		LockElement (hElement, &ElementPtr);
-		memset (ElementPtr, 0, sizeof (*ElementPtr));
+		if (Template)
+			*ElementPtr = *Template;
+		else
+			memset (ElementPtr, 0, sizeof (*ElementPtr));
 		ElementPtr->PrimIndex = AllocDisplayPrim ();
 		if (ElementPtr->PrimIndex == END_OF_LIST)
 		{
@@ -153,7 +166,15 @@ PreProcess (ELEMENT *ElementPtr)
 
 		if (ElementPtr->preprocess_func && !(state_flags & APPEARING))
 		{
-			(*ElementPtr->preprocess_func) (ElementPtr);
+			if (ShipProfile_enabled)
+			{
+				SPECIES_ID species = ShipProfile_elementSpecies (ElementPtr);
+				DWORD start = GetTimeMicroseconds ();
+				(*ElementPtr->preprocess_func) (ElementPtr);
+				ShipProfile_add (species, SHIPPROF_PREPROCESS, start);
+			}
+			else
+				(*ElementPtr->preprocess_func) (ElementPtr);
 
 			state_flags = ElementPtr->state_flags;
 			if ((state_flags & CHANGING) && CollidingElement (ElementPtr))
@@ -189,7 +210,17 @@ static void
 PostProcess (ELEMENT *ElementPtr)
 {
 	if (ElementPtr->postprocess_func)
-		(*ElementPtr->postprocess_func) (ElementPtr);
+	{
+		if (ShipProfile_enabled)
+		{
+			SPECIES_ID species = ShipProfile_elementSpecies (ElementPtr);
+			DWORD start = GetTimeMicroseconds ();
+			(*ElementPtr->postprocess_func) (ElementPtr);
+			ShipProfile_add (species, SHIPPROF_POSTPROCESS, start);
+		}
+		else
+			(*ElementPtr->postprocess_func) (ElementPtr);
+	}
 	ElementPtr->current = ElementPtr->next;
 
 	if (CollidingElement (ElementPtr))
@@ -358,6 +389,56 @@ CalcView (POINT *pNewScrollPt, SIZE next_reduction,
 }
 
 
+static inline void
+GetSweptBounds (INTERSECT_CONTROL *pControl, RECT *pRect)
+{
+	FRAME FramePtr = pControl->IntersectStamp.frame;
+	COORD x0 = pControl->IntersectStamp.origin.x - FramePtr->HotSpot.x;
+	COORD y0 = pControl->IntersectStamp.origin.y - FramePtr->HotSpot.y;
+	COORD x1 = pControl->EndPoint.x - FramePtr->HotSpot.x;
+	COORD y1 = pControl->EndPoint.y - FramePtr->HotSpot.y;
+
+	pRect->corner.x = x0 < x1 ? x0 : x1;
+	pRect->corner.y = y0 < y1 ? y0 : y1;
+	pRect->extent.width = (x0 < x1 ? x1 - x0 : x0 - x1)
+			+ GetFrameWidth (FramePtr);
+	pRect->extent.height = (y0 < y1 ? y1 - y0 : y0 - y1)
+			+ GetFrameHeight (FramePtr);
+}
+
+// Cheap stand-in for the common DrawablesIntersect() miss: when the
+// areas the two frames sweep between their start and end points do not
+// overlap, they cannot collide.  Leaves last_time_val as a miss in
+// DrawablesIntersect() would, as netplay checksums it.
+// A spatial grid cannot be used in place of this per-pair test, as the
+// walk in ProcessCollisions() also PreProcess()es elements in order and
+// the collision functions may move any element, so the result would
+// depend on the grid.
+static inline BOOLEAN
+SweptBoundsDisjoint (INTERSECT_CONTROL *pControl0,
+		INTERSECT_CONTROL *pControl1)
+{
+	RECT r0, r1;
+
+	if (!ContextActive ())
+		return FALSE; // DrawablesIntersect() will bail out itself
+
+	if (!pControl0->IntersectStamp.frame
+			|| !pControl1->IntersectStamp.frame)
+		return FALSE;
+
+	GetSweptBounds (pControl0, &r0);
+	GetSweptBounds (pControl1, &r1);
+	if (r0.corner.x < r1.corner.x + r1.extent.width
+			&& r1.corner.x < r0.corner.x + r0.extent.width
+			&& r0.corner.y < r1.corner.y + r1.extent.height
+			&& r1.corner.y < r0.corner.y + r0.extent.height)
+		return FALSE;
+
+	pControl0->last_time_val = pControl1->last_time_val = 0;
+	return TRUE;
+}
+
 static ELEMENT_FLAGS
 ProcessCollisions (HELEMENT hSuccElement, ELEMENT *ElementPtr,
 		TIME_VALUE min_time, ELEMENT_FLAGS process_flags)
@@ -392,6 +473,9 @@ ProcessCollisions (HELEMENT hSuccElement, ELEMENT *ElementPtr,
 					|| ((test_state_flags & APPEARING)
 					&& TestElementPtr->life_span > 1)))
 				time_val = 0;
+			else if (SweptBoundsDisjoint (&ElementPtr->IntersectControl,
+					&TestElementPtr->IntersectControl))
+				time_val = 0;
 			else
 			{
 				while ((time_val = DrawablesIntersect (&ElementPtr->IntersectControl,
@@ -982,6 +1066,50 @@ PostProcessQueue (VIEW_STATE view_state, SIZE scroll_x,
 #endif
 }
 
+// Render the zoomed ship frames the smooth melee zoom is likely to ask
+// for into the images' scale caches, so the first zoom-out of a battle
+// does not stall on rescaling.  The zoom is continuous, so only a grid
+// of ZOOM_JUMP multiples is covered; each zoom level gets as many
+// steps as an image has cache slots.
+void
+PrescaleShipFrames (FRAME farray[])
+{
+	int zoom;
+	COUNT i, count;
+
+	if (!optMeleePrescale || optMeleeScale == TFB_SCALE_STEP)
+		return;
+
+	for (zoom = 1 << ZOOM_SHIFT; zoom < MAX_ZOOM_OUT; )
+	{
+		COUNT index = zoom < (2 << ZOOM_SHIFT) ? 0 : 1;
+		int scale = (1 << (index + ZOOM_SHIFT + 8)) / zoom;
+		FRAME frame = farray[index];
+		FRAME mmframe = farray[index + 1];
+
+		zoom += ZOOM_JUMP << index;
+
+		if (!frame || scale == GSCALE_IDENTITY)
+			continue;
+
+		count = GetFrameCount (frame);
+		for (i = 0; i < count; ++i)
+		{
+			frame = SetAbsFrameIndex (frame, i);
+			if (optMeleeScale == TFB_SCALE_TRILINEAR && mmframe)
+			{	// Same mipmap as the display list would assign
+				FRAME mm = SetEquFrameIndex (mmframe, frame);
+				HOT_SPOT mmhs = GetFrameHot (mm);
+				TFB_DrawImage_SetMipmap (frame->image, mm->image,
+						mmhs.x, mmhs.y);
+			}
+			if (!TFB_DrawImage_Prescale (frame->image, scale,
+					optMeleeScale))
+				return; // Out of cache budget
+		}
+	}
+}
+
 void
 InitDisplayList (void)
 {
@@ -999,6 +1127,7 @@ InitDisplayList (void)
 	}
 
 	ReinitQueue (&disp_q);
+	InvalidateThreatTable ();
 
 	for (i = 0; i < MAX_DISPLAY_PRIMS; ++i)
 		SetPrimLinks (&DisplayArray[i], END_OF_LIST, i + 1);
@@ -1017,10 +1146,15 @@ RedrawQueue (BOOLEAN clear)
 
 	SetContext (StatusContext);
 
+	PROFILE_BEGIN (PROF_PREPROCESS);
 	view_state = PreProcessQueue (&scroll_x, &scroll_y);
+	PROFILE_END (PROF_PREPROCESS);
+	PROFILE_BEGIN (PROF_POSTPROCESS);
 	PostProcessQueue (view_state, scroll_x, scroll_y);
+	PROFILE_END (PROF_POSTPROCESS);
+	InvalidateThreatTable ();
 
-	if (optStereoSFX)
+	if (optStereoSFX && !headlessBattle)
 		UpdateSoundPositions ();
 
 	SetContext (SpaceContext);
@@ -1049,6 +1183,8 @@ RedrawQueue (BOOLEAN clear)
 			SetGraphicScale (0);
 		}
 
+		if (headlessBattle)
+			ProcessSound ((SOUND)~0, NULL);
 		FlushSounds ();
 	}
 	else
@@ -27,6 +27,7 @@ extern "C" {
 
 extern void RedrawQueue (BOOLEAN clear);
 extern void InitDisplayList (void);
+extern void PrescaleShipFrames (FRAME farray[]);
 extern void SetUpElement (ELEMENT *ElementPtr);
 extern void InsertPrim (PRIM_LINKS *pLinks, COUNT primIndex, COUNT iPI);
 
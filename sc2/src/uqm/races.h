@@ -245,21 +245,14 @@ typedef struct
 struct STARSHIP
 {
 	SHIP_BASE_COMMON;
-	
-	RACE_DESC *RaceDescPtr;
 
-	// Ship information
-	COUNT crew_level;
-			// In full-game battles: crew left
-			// In SuperMelee: irrelevant
-	COUNT max_crew;
-	BYTE ship_cost;
-			// In Super Melee ship queue: ship cost
-			// In full-game: irrelevant
-	COUNT index;
-			// original queue index
-	STRING race_strings;
-	FRAME icons;
+	// The fields used every battle frame come first
+	BYTE control;
+			// HUMAN, COMPUTER or NETWORK control flags, see intel.h
+	BYTE ship_input_state;
+
+	RACE_DESC *RaceDescPtr;
+	HELEMENT hShip;
 
 	// Battle states
 	BYTE weapon_counter;
@@ -269,19 +262,27 @@ struct STARSHIP
 	BYTE energy_counter;
 			// In battle: frames left before energy regeneration
 
-	BYTE ship_input_state;
 	STATUS_FLAGS cur_status_flags;
 	STATUS_FLAGS old_status_flags;
-
-	HELEMENT hShip;
 	COUNT ShipFacing;
 
 	SIZE playerNr;
 			//  0: bottom player; In full-game: the human player (RPG)
 			//  1: top player; In full-game: the NPC opponent
 			// -1: neutral; this should currently never happen (asserts)
-	BYTE control;
-			// HUMAN, COMPUTER or NETWORK control flags, see intel.h
+
+	// Ship information
+	COUNT crew_level;
+			// In full-game battles: crew left
+			// In SuperMelee: irrelevant
+	COUNT max_crew;
+	BYTE ship_cost;
+			// In Super Melee ship queue: ship cost
+			// In full-game: irrelevant
+	COUNT index;
+			// original queue index
+	STRING race_strings;
+	FRAME icons;
 };
 
 #define RPG_PLAYER_NUM  0
@@ -40,6 +40,7 @@
 #include "uqmversion.h"
 #include "libs/graphics/gfx_common.h"
 #include "libs/inplib.h"
+#include "libs/time/bootprof.h"
 
 #ifdef USE_RUST_RESTART
 #include "rust_bridge_restart.h"
@@ -359,6 +360,18 @@ TryStartGame (void)
 	memset (&MenuState, 0, sizeof (MenuState));
 	MenuState.InputFunc = DoRestart;
 
+	if (res_IsString ("config.meleebenchmark")
+			|| res_IsString ("config.meleebatch"))
+	{	// Straight into the benchmark or the batch and out again, so they
+		// can run without anyone at the keyboard
+		// (rust/harness/run_perf_regression.sh, tools/meleetournament.sh)
+		GLOBAL (CurrentActivity) = SUPER_MELEE;
+		FreeGameData ();
+		Melee ();
+		GLOBAL (CurrentActivity) |= CHECK_ABORT;
+		return (FALSE);
+	}
+
 	while (!RestartMenu (&MenuState))
 	{	// spin until a game is started or loaded
 		if (LOBYTE (GLOBAL (CurrentActivity)) == SUPER_MELEE &&
@@ -385,6 +398,9 @@ TryStartGame (void)
 BOOLEAN
 StartGame (void)
 {
+	BootProfile_finish ();
+			// The main menu is about to come up
+
 #ifdef USE_RUST_RESTART
 	return rust_start_game ();
 #else
@@ -41,6 +41,9 @@
 #include "libs/inplib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/declib.h"
+#include "libs/tasklib.h"
+#include "libs/threadlib.h"
 
 // Status boolean. If for some insane reason you need to
 // save games in different threads, you'll need to
@@ -52,13 +55,70 @@
 
 static BOOLEAN io_ok = TRUE;
 
+// The save is put together in memory, then compressed, and written out
+// on a task so that the game does not wait for the disk. It goes to a
+// temporary file first, which then replaces the old save, so a save that
+// fails halfway leaves the old one intact.
+typedef struct
+{
+	BYTE *data;
+	DWORD size;
+	DWORD maxSize;
+} SAVE_BUFFER;
+
+#define SAVE_BUFFER_START_SIZE 0x10000
+
+typedef struct
+{
+	uio_Stream *fp;
+	BYTE *data;
+	DWORD size;
+	char file[PATH_MAX];
+	char tmpFile[PATH_MAX];
+	COUNT which_game;
+	SUMMARY_DESC summary;
+			// For the summary index
+} SAVE_WRITE;
+
+static SAVE_WRITE pendingWrite;
+static Task saveTask;
+static Mutex saveMutex;
+static BOOLEAN saveWriteDone;
+		// Guarded by saveMutex
+
+static inline void
+write_a8 (void *fp, const BYTE *ar, COUNT count)
+{
+	SAVE_BUFFER *buf = (SAVE_BUFFER *) fp;
+
+	if (!io_ok)
+		return;
+
+	if (buf->size + count > buf->maxSize)
+	{
+		DWORD newSize = buf->maxSize ? buf->maxSize : SAVE_BUFFER_START_SIZE;
+		BYTE *data;
+
+		while (newSize < buf->size + count)
+			newSize <<= 1;
+		data = HRealloc (buf->data, newSize);
+		if (!data)
+		{
+			io_ok = FALSE;
+			return;
+		}
+		buf->data = data;
+		buf->maxSize = newSize;
+	}
+	memcpy (buf->data + buf->size, ar, count);
+	buf->size += count;
+}
+
 // XXX: these should handle endian conversions later
 static inline void
 write_8 (void *fp, BYTE v)
 {
-	if (io_ok)
-		if (WriteResFile (&v, 1, 1, fp) != 1)
-			io_ok = FALSE;
+	write_a8 (fp, &v, 1);
 }
 
 static inline void
@@ -77,14 +137,6 @@ write_32 (void *fp, DWORD v)
 	write_8 (fp, (BYTE)((v >> 24) & 0xff));
 }
 
-static inline void
-write_a8 (void *fp, const BYTE *ar, COUNT count)
-{
-	if (io_ok)
-		if (WriteResFile (ar, 1, count, fp) != count)
-			io_ok = FALSE;
-}
-
 static inline void
 write_str (void *fp, const char *str, COUNT count)
 {
@@ -104,7 +156,7 @@ write_a16 (void *fp, const UWORD *ar, COUNT count)
 }
 
 static void
-SaveShipQueue (uio_Stream *fh, QUEUE *pQueue, DWORD tag)
+SaveShipQueue (SAVE_BUFFER *fh, QUEUE *pQueue, DWORD tag)
 {
 	COUNT num_links;
 	HSHIPFRAG hStarShip;
@@ -145,7 +197,7 @@ SaveShipQueue (uio_Stream *fh, QUEUE *pQueue, DWORD tag)
 }
 
 static void
-SaveRaceQueue (uio_Stream *fh, QUEUE *pQueue)
+SaveRaceQueue (SAVE_BUFFER *fh, QUEUE *pQueue)
 {
 	COUNT num_links;
 	HFLEETINFO hFleet;
@@ -197,7 +249,7 @@ SaveRaceQueue (uio_Stream *fh, QUEUE *pQueue)
 }
 
 static void
-SaveGroupQueue (uio_Stream *fh, QUEUE *pQueue)
+SaveGroupQueue (SAVE_BUFFER *fh, QUEUE *pQueue)
 {
 	HIPGROUP hGroup, hNextGroup;
 	COUNT num_links;
@@ -231,7 +283,7 @@ SaveGroupQueue (uio_Stream *fh, QUEUE *pQueue)
 }
 
 static void
-SaveEncounters (uio_Stream *fh)
+SaveEncounters (SAVE_BUFFER *fh)
 {
 	COUNT num_links;
 	HENCOUNTER hEncounter;
@@ -283,7 +335,7 @@ SaveEncounters (uio_Stream *fh)
 }
 
 static void
-SaveEvents (uio_Stream *fh)
+SaveEvents (SAVE_BUFFER *fh)
 {
 	COUNT num_links;
 	HEVENT hEvent;
@@ -314,7 +366,7 @@ SaveEvents (uio_Stream *fh)
 
 /* The clock state is folded in with the game state chunk. */
 static void
-SaveClockState (const CLOCK_STATE *ClockPtr, uio_Stream *fh)
+SaveClockState (const CLOCK_STATE *ClockPtr, SAVE_BUFFER *fh)
 {
 	write_8   (fh, ClockPtr->day_index);
 	write_8   (fh, ClockPtr->month_index);
@@ -327,7 +379,7 @@ SaveClockState (const CLOCK_STATE *ClockPtr, uio_Stream *fh)
  * State chunk is fixed size, but the Game State tag can be extended
  * by modders. */
 static void
-SaveGameState (const GAME_STATE *GSPtr, uio_Stream *fh)
+SaveGameState (const GAME_STATE *GSPtr, SAVE_BUFFER *fh)
 {
 	write_32  (fh, GLOBAL_STATE_TAG);
 	write_32  (fh, 75);
@@ -433,7 +485,7 @@ SaveSummary (const SUMMARY_DESC *SummPtr, void *fp)
  * the Star *Info* chunk, which records which planetary features you
  * have exploited with your lander */
 static void
-SaveStarDesc (const STAR_DESC *SDPtr, uio_Stream *fh)
+SaveStarDesc (const STAR_DESC *SDPtr, SAVE_BUFFER *fh)
 {
 	write_32 (fh, STAR_TAG);
 	write_32 (fh, 8);
@@ -603,10 +655,10 @@ SaveFlagshipState (void)
 }
 
 static void
-SaveStarInfo (uio_Stream *fh)
+SaveStarInfo (SAVE_BUFFER *fh, STATE_SNAPSHOT *snap)
 {
 	GAME_STATE_FILE *fp;
-	fp = OpenStateFile (STARINFO_FILE, "rb");
+	fp = OpenSnapshotFile (snap, STARINFO_FILE);
 	if (fp)
 	{
 		DWORD flen = LengthStateFile (fp);
@@ -631,7 +683,7 @@ SaveStarInfo (uio_Stream *fh)
 }
 
 static void
-SaveBattleGroup (GAME_STATE_FILE *fp, DWORD encounter_id, DWORD grpoffs, uio_Stream *fh)
+SaveBattleGroup (GAME_STATE_FILE *fp, DWORD encounter_id, DWORD grpoffs, SAVE_BUFFER *fh)
 {
 	GROUP_HEADER h;
 	DWORD size = 12;
@@ -683,10 +735,10 @@ SaveBattleGroup (GAME_STATE_FILE *fp, DWORD encounter_id, DWORD grpoffs, uio_Str
 }
 
 static void
-SaveGroups (uio_Stream *fh)
+SaveGroups (SAVE_BUFFER *fh, STATE_SNAPSHOT *snap)
 {
 	GAME_STATE_FILE *fp;
-	fp = OpenStateFile (RANDGRPINFO_FILE, "rb");
+	fp = OpenSnapshotFile (snap, RANDGRPINFO_FILE);
 	if (fp && LengthStateFile (fp) > 0)
 	{
 		GROUP_HEADER h;
@@ -722,7 +774,7 @@ SaveGroups (uio_Stream *fh)
 		SaveBattleGroup (fp, 0, 0, fh);
 		CloseStateFile (fp);
 	}
-	fp = OpenStateFile (DEFGRPINFO_FILE, "rb");
+	fp = OpenSnapshotFile (snap, DEFGRPINFO_FILE);
 	if (fp && LengthStateFile (fp) > 0)
 	{
 		int state_index = SHOFIXTI_GRPOFFS0;
@@ -741,15 +793,122 @@ SaveGroups (uio_Stream *fh)
 	}
 }
 
+// Compresses the save from buf into pendingWrite, after the file tag
+static BOOLEAN
+CompressSave (const SAVE_BUFFER *buf)
+{
+	DECODE_REF codec;
+	DWORD maxSize;
+	DWORD done;
+
+	// Each byte takes less than 3 once compressed, whatever it is
+	maxSize = 4 + buf->size * 3 + 64;
+	pendingWrite.data = HMalloc (maxSize);
+	if (!pendingWrite.data)
+		return FALSE;
+
+	pendingWrite.data[0] = (BYTE)( SAVEFILE_LZ_TAG        & 0xff);
+	pendingWrite.data[1] = (BYTE)((SAVEFILE_LZ_TAG >>  8) & 0xff);
+	pendingWrite.data[2] = (BYTE)((SAVEFILE_LZ_TAG >> 16) & 0xff);
+	pendingWrite.data[3] = (BYTE)((SAVEFILE_LZ_TAG >> 24) & 0xff);
+	codec = copen (pendingWrite.data + 4, MEMORY_STREAM, STREAM_WRITE);
+	if (!codec)
+	{
+		HFree (pendingWrite.data);
+		pendingWrite.data = NULL;
+		return FALSE;
+	}
+	// cwrite() takes a COUNT
+	for (done = 0; done < buf->size; )
+	{
+		COUNT len = (COUNT) (buf->size - done < 0x8000 ?
+				buf->size - done : 0x8000);
+		cwrite (buf->data + done, 1, len, codec);
+		done += len;
+	}
+	pendingWrite.size = 4 + cclose (codec);
+	assert (pendingWrite.size <= maxSize);
+	return TRUE;
+}
+
+// Writes out pendingWrite, and puts it in the place of the old save
+static void
+WriteSave (void)
+{
+	SAVE_WRITE *w = &pendingWrite;
+	BOOLEAN ok;
+
+	ok = WriteResFile (w->data, 1, w->size, w->fp) == w->size;
+	if (!res_CloseResFile (w->fp))
+		ok = FALSE;
+	w->fp = NULL;
+	HFree (w->data);
+	w->data = NULL;
+
+	if (ok && uio_rename (saveDir, w->tmpFile, saveDir, w->file) != 0)
+	{	// Some systems will not rename over a file
+		DeleteResFile (saveDir, w->file);
+		ok = uio_rename (saveDir, w->tmpFile, saveDir, w->file) == 0;
+	}
+	if (!ok)
+	{
+		log_add (log_Error, "Could not write saved game '%s'.", w->file);
+		DeleteResFile (saveDir, w->tmpFile);
+	}
+	else
+		UpdateGameSummary (w->which_game, &w->summary);
+}
+
+static int
+SaveWriterFunc (void *data)
+{
+	Task task = (Task) data;
+
+	WriteSave ();
+
+	LockMutex (saveMutex);
+	saveWriteDone = TRUE;
+	UnlockMutex (saveMutex);
+
+	FinishTask (task);
+	return 0;
+}
+
+// Waits until the last save is on the disk
+void
+WaitForSaveWrite (void)
+{
+	BOOLEAN done;
+
+	if (!saveTask)
+		return;
+
+	do
+	{
+		LockMutex (saveMutex);
+		done = saveWriteDone;
+		UnlockMutex (saveMutex);
+		if (!done)
+			HibernateThread (ONE_SECOND / 120);
+	} while (!done);
+	// The task slot may be in use by someone else by now
+	saveTask = NULL;
+}
+
 // This function first writes to a memory file, and then writes the whole
-// lot to the actual save file at once.
+// lot to the actual save file at once, on a task of its own.
 BOOLEAN
 SaveGame (COUNT which_game, SUMMARY_DESC *SummPtr, const char *name)
 {
-	uio_Stream *out_fp;
+	SAVE_BUFFER out;
+	STATE_SNAPSHOT *snap;
 	POINT pt;
 	STAR_DESC SD;
-	char file[PATH_MAX];
+	BOOLEAN ok;
+
+	// The last save may be to the same slot
+	WaitForSaveWrite ();
+
 	if (CurStarDescPtr)
 		SD = *CurStarDescPtr;
 	else
@@ -763,65 +922,78 @@ SaveGame (COUNT which_game, SUMMARY_DESC *SummPtr, const char *name)
 			& (START_ENCOUNTER | START_INTERPLANETARY)))
 		PutGroupInfo (GROUPS_RANDOM, GROUP_SAVE_IP);
 
-	// Write the memory file to the actual savegame file.
-	sprintf (file, "uqmsave.%02u", which_game);
-	if ((out_fp = res_OpenResFile (saveDir, file, "wb")))
-	{
-		io_ok = TRUE;
-		write_32 (out_fp, SAVEFILE_TAG);
+	memset (&out, 0, sizeof (out));
+	io_ok = TRUE;
 
-		PrepareSummary (SummPtr, name);
-		SaveSummary (SummPtr, out_fp);
+	PrepareSummary (SummPtr, name);
+	SaveSummary (SummPtr, &out);
 
-		SaveGameState (&GlobData.Game_state, out_fp);
+	SaveGameState (&GlobData.Game_state, &out);
 
-		// XXX: Restore
-		GLOBAL (ip_location) = pt;
-		// Only relevant when loading a game and must be cleaned
-		GLOBAL (in_orbit) = 0;
+	// XXX: Restore
+	GLOBAL (ip_location) = pt;
+	// Only relevant when loading a game and must be cleaned
+	GLOBAL (in_orbit) = 0;
 
-		SaveRaceQueue (out_fp, &GLOBAL (avail_race_q));
-		// START_INTERPLANETARY is only set when saving from Homeworld
-		//   encounter screen. When the game is loaded, the
-		//   GenerateOrbitalFunction for the current star system
-		//   create the encounter anew and populate the npc queue.
-		if (!(GLOBAL (CurrentActivity) & START_INTERPLANETARY))
-		{
-			if (GLOBAL (CurrentActivity) & START_ENCOUNTER)
-				SaveShipQueue (out_fp, &GLOBAL (npc_built_ship_q), NPC_SHIP_Q_TAG);
-			else if (LOBYTE (GLOBAL (CurrentActivity)) == IN_INTERPLANETARY)
-				// XXX: Technically, this queue does not need to be
-				//   saved/loaded at all. IP groups will be reloaded
-				//   from group state files. But the original code did,
-				//   and so will we until we can prove we do not need to.
-				SaveGroupQueue (out_fp, &GLOBAL (ip_group_q));
-		}
-		SaveShipQueue (out_fp, &GLOBAL (built_ship_q), SHIP_Q_TAG);
+	SaveRaceQueue (&out, &GLOBAL (avail_race_q));
+	// START_INTERPLANETARY is only set when saving from Homeworld
+	//   encounter screen. When the game is loaded, the
+	//   GenerateOrbitalFunction for the current star system
+	//   create the encounter anew and populate the npc queue.
+	if (!(GLOBAL (CurrentActivity) & START_INTERPLANETARY))
+	{
+		if (GLOBAL (CurrentActivity) & START_ENCOUNTER)
+			SaveShipQueue (&out, &GLOBAL (npc_built_ship_q), NPC_SHIP_Q_TAG);
+		else if (LOBYTE (GLOBAL (CurrentActivity)) == IN_INTERPLANETARY)
+			// XXX: Technically, this queue does not need to be
+			//   saved/loaded at all. IP groups will be reloaded
+			//   from group state files. But the original code did,
+			//   and so will we until we can prove we do not need to.
+			SaveGroupQueue (&out, &GLOBAL (ip_group_q));
+	}
+	SaveShipQueue (&out, &GLOBAL (built_ship_q), SHIP_Q_TAG);
 
-		// Save the game event chunk
-		SaveEvents (out_fp);
+	// Save the game event chunk
+	SaveEvents (&out);
 
-		// Save the encounter chunk (black globes in HS/QS)
-		SaveEncounters (out_fp);
+	// Save the encounter chunk (black globes in HS/QS)
+	SaveEncounters (&out);
 
-		// Save out the data that used to be in state files
-		SaveStarInfo (out_fp);
-		SaveGroups (out_fp);
+	// Save out the data that used to be in state files, from a copy
+	// taken in one go rather than read from them piecemeal
+	snap = SnapshotStateFiles ();
+	SaveStarInfo (&out, snap);
+	SaveGroups (&out, snap);
+	FreeStateSnapshot (snap);
 
-		// Save out the Star Descriptor
-		SaveStarDesc (&SD, out_fp);
-		
-		res_CloseResFile (out_fp);
-		if (!io_ok)
-		{
-			DeleteResFile(saveDir, file);
-			return FALSE;
-		}
-	}
-	else
+	// Save out the Star Descriptor
+	SaveStarDesc (&SD, &out);
+
+	ok = io_ok && CompressSave (&out);
+	HFree (out.data);
+	if (!ok)
+		return FALSE;
+
+	pendingWrite.which_game = which_game;
+	pendingWrite.summary = *SummPtr;
+	sprintf (pendingWrite.file, "uqmsave.%02u", which_game);
+	sprintf (pendingWrite.tmpFile, "uqmsave.%02u.tmp", which_game);
+	pendingWrite.fp = res_OpenResFile (saveDir, pendingWrite.tmpFile, "wb");
+	if (!pendingWrite.fp)
 	{
+		HFree (pendingWrite.data);
+		pendingWrite.data = NULL;
 		return FALSE;
 	}
 
+	if (!saveMutex)
+		saveMutex = CreateMutex ("Save writer", SYNC_CLASS_RESOURCE);
+	saveWriteDone = FALSE;
+	saveTask = AssignTask (SaveWriterFunc, 4096, "save writer");
+	if (!saveTask)
+	{	// Then here and now
+		WriteSave ();
+	}
+
 	return TRUE;
 }
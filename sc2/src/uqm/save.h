@@ -32,9 +32,12 @@ extern "C" {
 //   room for only 16 devices on screen.
 #define MAX_EXCLUSIVE_DEVICES 16
 #define SAVE_NAME_SIZE 64
+#define MAX_SAVED_GAMES 50
 
 // The savefile tag numbers.
 #define SAVEFILE_TAG     0x01534d55 // "UMS\x01": UQM Save version 1
+#define SAVEFILE_LZ_TAG  0x02534d55 // "UMS\x02": UQM Save version 2,
+		// the version 1 chunks LZ compressed
 #define SUMMARY_TAG      0x6d6d7553 // "Summ": Summary. Must be first!
 #define GLOBAL_STATE_TAG 0x74536c47 // "GlSt": Global State. Must be 2nd!
 #define GAME_STATE_TAG   0x74536d47 // "GmSt": Game State Bits. Must be 3rd!
@@ -70,6 +73,11 @@ extern BOOLEAN LoadLegacyGame (COUNT which_game, SUMMARY_DESC *summary_desc);
 
 extern void SaveProblem (void);
 extern BOOLEAN SaveGame (COUNT which_game, SUMMARY_DESC *summary_desc, const char *name);
+extern void WaitForSaveWrite (void);
+
+extern void LoadGameSummaries (SUMMARY_DESC *summary_desc);
+extern void UpdateGameSummary (COUNT which_game,
+		const SUMMARY_DESC *summary_desc);
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,212 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// An index of the summaries of the saved games, so that the load and save
+// menus do not have to open every save to show them. "uqmsave.idx" in the
+// save dir holds, for each slot, the size and time of the save the summary
+// was read from, and the summary itself. A slot is only read from its save
+// again when that has changed. It is a cache for this build on this
+// machine only: the summaries are stored as they are in memory
+//   "USIX", version, sizeof (SUMMARY_DESC), number of slots (32 bits
+//   little endian), then for each slot: size, time, summary
+// Slots that have neither a save nor a legacy save are not opened at all.
+
+#include "save.h"
+#include "options.h"
+#include "setup.h"
+#include "libs/file.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define SAVEINDEX_FILE "uqmsave.idx"
+#define SAVEINDEX_MAGIC "USIX"
+#define SAVEINDEX_VERSION 1
+#define SAVEINDEX_HEADER_SIZE 16
+
+typedef struct
+{
+	DWORD fileSize;
+	DWORD fileTime;
+			// Of the save the summary is from; 0 if none
+	SUMMARY_DESC summary;
+} SAVEINDEX_ENTRY;
+
+static void
+putDword (BYTE *buf, DWORD val)
+{
+	buf[0] = val & 0xff;
+	buf[1] = (val >> 8) & 0xff;
+	buf[2] = (val >> 16) & 0xff;
+	buf[3] = (val >> 24) & 0xff;
+}
+
+static void
+makeHeader (BYTE *header, COUNT count)
+{
+	memcpy (header, SAVEINDEX_MAGIC, 4);
+	putDword (header + 4, SAVEINDEX_VERSION);
+	putDword (header + 8, sizeof (SUMMARY_DESC));
+	putDword (header + 12, count);
+}
+
+// Fills in the entries from the index file; those it does not have are
+// zeroed
+static void
+readIndex (SAVEINDEX_ENTRY *entries, COUNT count)
+{
+	uio_Stream *stream;
+	BYTE header[SAVEINDEX_HEADER_SIZE];
+	BYTE expected[SAVEINDEX_HEADER_SIZE];
+
+	memset (entries, 0, count * sizeof (SAVEINDEX_ENTRY));
+
+	stream = res_OpenResFile (saveDir, SAVEINDEX_FILE, "rb");
+	if (!stream)
+		return;
+	makeHeader (expected, count);
+	if (ReadResFile (header, sizeof header, 1, stream) != 1
+			|| memcmp (header, expected, sizeof header) != 0
+			|| ReadResFile (entries, sizeof (SAVEINDEX_ENTRY), count,
+				stream) != count)
+	{
+		log_add (log_Debug, "Not using the saved game summary index.");
+		memset (entries, 0, count * sizeof (SAVEINDEX_ENTRY));
+	}
+	res_CloseResFile (stream);
+}
+
+static void
+writeIndex (const SAVEINDEX_ENTRY *entries, COUNT count)
+{
+	uio_Stream *stream;
+	BYTE header[SAVEINDEX_HEADER_SIZE];
+	BOOLEAN ok;
+
+	stream = res_OpenResFile (saveDir, SAVEINDEX_FILE, "wb");
+	if (!stream)
+		return;
+	makeHeader (header, count);
+	ok = WriteResFile (header, sizeof header, 1, stream) == 1
+			&& WriteResFile (entries, sizeof (SAVEINDEX_ENTRY), count,
+				stream) == count;
+	if (!res_CloseResFile (stream))
+		ok = FALSE;
+	if (!ok)
+	{	// Would only be taken as unusable, but do not leave it around
+		DeleteResFile (saveDir, SAVEINDEX_FILE);
+	}
+}
+
+// The size and time of the save in a slot; FALSE if there is none
+static BOOLEAN
+statSave (COUNT which_game, DWORD *size, DWORD *time)
+{
+	char file[PATH_MAX];
+	struct stat sb;
+
+	sprintf (file, "uqmsave.%02u", which_game);
+	if (uio_stat (saveDir, file, &sb) != 0)
+		return FALSE;
+	*size = (DWORD) sb.st_size;
+	*time = (DWORD) sb.st_mtime;
+	return TRUE;
+}
+
+static BOOLEAN
+haveLegacySave (COUNT which_game)
+{
+	char file[PATH_MAX];
+	struct stat sb;
+
+	sprintf (file, "starcon2.%02u", which_game);
+	return uio_stat (saveDir, file, &sb) == 0;
+}
+
+// Fills in the summaries of all the slots, the same as LoadGame (i,
+// &pSD[i]) would, with year_index 0 for those without (good) saves
+void
+LoadGameSummaries (SUMMARY_DESC *pSD)
+{
+	const COUNT count = MAX_SAVED_GAMES;
+	SAVEINDEX_ENTRY *entries;
+	BOOLEAN changed = FALSE;
+	COUNT i;
+
+	// The last save may still be on its way to the disk
+	WaitForSaveWrite ();
+
+	entries = HMalloc (count * sizeof (SAVEINDEX_ENTRY));
+	readIndex (entries, count);
+
+	for (i = 0; i < count; ++i, ++pSD)
+	{
+		SAVEINDEX_ENTRY *e = &entries[i];
+		DWORD size, time;
+
+		if (!statSave (i, &size, &time))
+		{
+			if (e->fileSize)
+			{
+				memset (e, 0, sizeof (*e));
+				changed = TRUE;
+			}
+			memset (pSD, 0, sizeof (*pSD));
+			if (!haveLegacySave (i) || !LoadGame (i, pSD))
+				pSD->year_index = 0;
+			continue;
+		}
+
+		if (size == 0 || e->fileSize != size || e->fileTime != time)
+		{
+			memset (&e->summary, 0, sizeof (e->summary));
+			if (!LoadGame (i, &e->summary))
+				e->summary.year_index = 0;
+			e->fileSize = size;
+			e->fileTime = time;
+			changed = TRUE;
+		}
+		*pSD = e->summary;
+	}
+
+	if (changed)
+		writeIndex (entries, count);
+	HFree (entries);
+}
+
+// Records the summary of the save just written to a slot
+void
+UpdateGameSummary (COUNT which_game, const SUMMARY_DESC *SummPtr)
+{
+	const COUNT count = MAX_SAVED_GAMES;
+	SAVEINDEX_ENTRY *entries;
+	SAVEINDEX_ENTRY *e;
+
+	if (which_game >= count)
+		return;
+
+	entries = HMalloc (count * sizeof (SAVEINDEX_ENTRY));
+	readIndex (entries, count);
+	e = &entries[which_game];
+	if (statSave (which_game, &e->fileSize, &e->fileTime))
+		e->summary = *SummPtr;
+	else
+		memset (e, 0, sizeof (*e));
+	writeIndex (entries, count);
+	HFree (entries);
+}
@@ -39,6 +39,7 @@
 #include "libs/vidlib.h"
 #include "libs/log.h"
 #include "libs/misc.h"
+#include "libs/time/bootprof.h"
 
 #include <assert.h>
 #include <errno.h>
@@ -182,6 +183,8 @@ InitContexts (void)
 
 	if (!InitQueue (&disp_q, MAX_DISPLAY_ELEMENTS, sizeof (ELEMENT)))
 		return FALSE;
+	SetQueueGrowth (&disp_q, DISPLAY_ELEMENTS_CHUNK,
+			MAX_GROWN_DISPLAY_ELEMENTS);
 
 	return TRUE;
 }
@@ -233,8 +236,10 @@ InitGameKernel (void)
 {
 	if (ActivityFrame == 0)
 	{
+		BOOT_BEGIN (BOOT_KERNEL);
 		InitKernel ();
 		InitContexts ();
+		BOOT_END (BOOT_KERNEL);
 	}
 	return TRUE;
 }
@@ -53,6 +53,9 @@ typedef struct setup_menu_state {
 static BOOLEAN DoSetupMenu (SETUP_MENU_STATE *pInputState);
 static BOOLEAN done;
 static WIDGET *current, *next;
+static BOOLEAN changed;
+		// The menu on the screen is out of date. The menu is only
+		// drawn again after an event, as nothing else changes it.
 
 static int quit_main_menu (WIDGET *self, int event);
 static int quit_sub_menu (WIDGET *self, int event);
@@ -485,50 +488,64 @@ DoSetupMenu (SETUP_MENU_STATE *pInputState)
 		(*next->receiveFocus) (next, WIDGET_EVENT_DOWN);
 		
 		pInputState->initialized = TRUE;
+		changed = TRUE;
 	}
-	if (current != next)
+	if (current != next || changed)
 	{
-		SetTransitionSource (NULL);
-	}
-	
-	BatchGraphics ();
-	(*next->draw)(next, 0, 0);
+		if (current != next)
+		{
+			SetTransitionSource (NULL);
+		}
 
-	if (current != next)
-	{
-		ScreenTransition (3, NULL);
-		current = next;
-	}
+		BatchGraphics ();
+		(*next->draw)(next, 0, 0);
 
-	UnbatchGraphics ();
+		if (current != next)
+		{
+			ScreenTransition (3, NULL);
+			current = next;
+		}
+
+		UnbatchGraphics ();
+		changed = FALSE;
+	}
 
+	// Handlers may change the menu even when they do not take the event,
+	// so any event redraws it
 	if (PulsedInputState.menu[KEY_MENU_UP])
 	{
 		Widget_Event (WIDGET_EVENT_UP);
+		changed = TRUE;
 	}
 	else if (PulsedInputState.menu[KEY_MENU_DOWN])
 	{
 		Widget_Event (WIDGET_EVENT_DOWN);
+		changed = TRUE;
 	}
 	else if (PulsedInputState.menu[KEY_MENU_LEFT])
 	{
 		Widget_Event (WIDGET_EVENT_LEFT);
+		changed = TRUE;
 	}
 	else if (PulsedInputState.menu[KEY_MENU_RIGHT])
 	{
 		Widget_Event (WIDGET_EVENT_RIGHT);
+		changed = TRUE;
 	}
 	if (PulsedInputState.menu[KEY_MENU_SELECT])
 	{
 		Widget_Event (WIDGET_EVENT_SELECT);
+		changed = TRUE;
 	}
 	if (PulsedInputState.menu[KEY_MENU_CANCEL])
 	{
 		Widget_Event (WIDGET_EVENT_CANCEL);
+		changed = TRUE;
 	}
 	if (PulsedInputState.menu[KEY_MENU_DELETE])
 	{
 		Widget_Event (WIDGET_EVENT_DELETE);
+		changed = TRUE;
 	}
 
 	SleepThreadUntil (pInputState->NextTime + MENU_FRAME_RATE);
@@ -26,6 +26,7 @@
 #include "hyper.h"
 #include "tactrans.h"
 #include "pickship.h"
+#include "process.h"
 #include "intel.h"
 #include "init.h"
 #include "battle.h"
@@ -35,6 +36,8 @@
 #include "sounds.h"
 #include "libs/mathlib.h"
 
+#include <string.h>
+
 #ifdef USE_RUST_SHIPS
 extern void rust_ships_preprocess(ELEMENT *element);
 extern void rust_ships_postprocess(ELEMENT *element);
@@ -184,7 +187,7 @@ ship_preprocess (ELEMENT *ElementPtr)
 			s.origin.x = s.origin.y = 0;
 			s.frame = RDPtr->ship_data.captain_control.background;
 			DrawStamp (&s);
-			DestroyDrawable (ReleaseDrawable (s.frame));
+			res_FreeResource (RDPtr->ship_data.captain_control.captain_rsc);
 			RDPtr->ship_data.captain_control.background = 0;
 			SetContext (OldContext);
 		}
@@ -391,6 +394,7 @@ spawn_ship (STARSHIP *StarShipPtr)
 	RDPtr = load_ship (StarShipPtr->SpeciesID, TRUE);
 	if (!RDPtr)
 		return FALSE;
+	PrescaleShipFrames (RDPtr->ship_data.ship);
 
 	StarShipPtr->RaceDescPtr = RDPtr;
 
@@ -539,6 +543,35 @@ GetNextStarShip (STARSHIP *LastStarShipPtr, COUNT which_side)
 	return (hBattleShip != 0);
 }
 
+// Start loading the ships that are still waiting to come into play.
+// Each race is loaded once; all its ships share that.
+static void
+preloadWaitingStarShips (void)
+{
+	BOOLEAN started[NUM_SPECIES_ID];
+	COUNT side;
+
+	memset (started, 0, sizeof started);
+	for (side = 0; side < NUM_SIDES; ++side)
+	{
+		HSTARSHIP hStarShip, hNextShip;
+
+		for (hStarShip = GetHeadLink (&race_q[side]); hStarShip;
+				hStarShip = hNextShip)
+		{
+			STARSHIP *StarShipPtr = LockStarShip (&race_q[side], hStarShip);
+			if (!StarShipPtr->hShip && StarShipPtr->SpeciesID < NUM_SPECIES_ID
+					&& !started[StarShipPtr->SpeciesID])
+			{
+				started[StarShipPtr->SpeciesID] = TRUE;
+				preload_ship (StarShipPtr->SpeciesID);
+			}
+			hNextShip = _GetSuccLink (StarShipPtr);
+			UnlockStarShip (&race_q[side], hStarShip);
+		}
+	}
+}
+
 BOOLEAN
 GetInitialStarShips (void)
 {
@@ -563,7 +596,6 @@ GetInitialStarShips (void)
 			}
 			UnlockStarShip (&race_q[playerI], ships[playerI]);
 		}
-		return TRUE;
 	}
 	else
 	{
@@ -574,7 +606,10 @@ GetInitialStarShips (void)
 			if (!GetNextStarShip (NULL, i - 1))
 				return FALSE;
 		}
-		return TRUE;
 	}
+
+	// The battle starts with just the ships in play loaded
+	preloadWaitingStarShips ();
+	return TRUE;
 }
 
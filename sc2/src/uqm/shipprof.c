@@ -0,0 +1,126 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include "shipprof.h"
+
+#include "globdata.h"
+#include "libs/log.h"
+#include "libs/time/profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+BOOLEAN ShipProfile_enabled;
+
+typedef struct
+{
+	DWORD calls;
+	DWORD micros;
+} ShipProfileCount;
+
+static ShipProfileCount counts[NUM_SPECIES_ID][SHIPPROF_NUM_KINDS];
+
+static const char *const speciesNames[NUM_SPECIES_ID] =
+{
+	"(no ship)",
+	"Arilou",
+	"Chmmr",
+	"Earthling",
+	"Orz",
+	"Pkunk",
+	"Shofixti",
+	"Spathi",
+	"Supox",
+	"Thraddash",
+	"Utwig",
+	"VUX",
+	"Yehat",
+	"Melnorme",
+	"Druuge",
+	"Ilwrath",
+	"Mycon",
+	"Slylandro",
+	"Umgah",
+	"Ur-Quan",
+	"Zoq-Fot-Pik",
+	"Syreen",
+	"Kohr-Ah",
+	"Androsynth",
+	"Chenjesu",
+	"Mmrnmhrm",
+	"Flagship",
+	"Sa-Matra",
+	"Ur-Quan probe",
+};
+
+void
+ShipProfile_beginBattle (void)
+{
+	BYTE activity = LOBYTE (GLOBAL (CurrentActivity));
+
+	// In HyperSpace and interplanetary flight, pParent of an element is
+	// not always a STARSHIP
+	ShipProfile_enabled = (activity == SUPER_MELEE
+			|| activity == IN_ENCOUNTER || activity == IN_LAST_BATTLE)
+			&& (Profile_enabled || getenv (SHIP_PROFILE_ENV_VAR) != NULL);
+	memset (counts, 0, sizeof counts);
+}
+
+void
+ShipProfile_add (SPECIES_ID species, ShipProfileKind kind, DWORD start)
+{
+	ShipProfileCount *count;
+
+	if ((unsigned) species >= NUM_SPECIES_ID)
+		species = NO_ID;
+	count = &counts[species][kind];
+	++count->calls;
+	count->micros += GetTimeMicroseconds () - start;
+}
+
+void
+ShipProfile_endBattle (void)
+{
+	int species;
+
+	if (!ShipProfile_enabled)
+		return;
+	ShipProfile_enabled = FALSE;
+
+	log_add (log_Info, "Ship callbacks this battle, in microseconds "
+			"(calls):");
+	log_add (log_Info, "  %-14s %18s %18s %18s", "race", "intelligence",
+			"preprocess", "postprocess");
+	for (species = 0; species < NUM_SPECIES_ID; ++species)
+	{
+		const ShipProfileCount *c = counts[species];
+
+		if (c[SHIPPROF_INTELLIGENCE].calls == 0
+				&& c[SHIPPROF_PREPROCESS].calls == 0
+				&& c[SHIPPROF_POSTPROCESS].calls == 0)
+			continue;
+
+		log_add (log_Info, "  %-14s %9lu (%6lu) %9lu (%6lu) %9lu (%6lu)",
+				speciesNames[species],
+				(unsigned long) c[SHIPPROF_INTELLIGENCE].micros,
+				(unsigned long) c[SHIPPROF_INTELLIGENCE].calls,
+				(unsigned long) c[SHIPPROF_PREPROCESS].micros,
+				(unsigned long) c[SHIPPROF_PREPROCESS].calls,
+				(unsigned long) c[SHIPPROF_POSTPROCESS].micros,
+				(unsigned long) c[SHIPPROF_POSTPROCESS].calls);
+	}
+}
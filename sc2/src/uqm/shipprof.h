@@ -0,0 +1,72 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+/* Time spent in the callbacks of each race during a battle: the computer
+ * control of its ships, and the preprocess and postprocess functions of
+ * everything the ships put in the display queue, their weapons
+ * included. Used to find the ships that are expensive in computer vs
+ * computer battles.
+ * Counting is on for a battle when the frame profiler is on (see
+ * libs/time/profile.h) or SHIP_PROFILE_ENV_VAR is set when it starts.
+ * The counts are logged at the end of the battle. */
+
+#ifndef UQM_SHIPPROF_H_
+#define UQM_SHIPPROF_H_
+
+#include "element.h"
+#include "races.h"
+#include "libs/compiler.h"
+#include "libs/timelib.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SHIP_PROFILE_ENV_VAR "UQM_SHIP_PROFILE"
+
+typedef enum
+{
+	SHIPPROF_INTELLIGENCE,
+	SHIPPROF_PREPROCESS,
+	SHIPPROF_POSTPROCESS,
+
+	SHIPPROF_NUM_KINDS
+} ShipProfileKind;
+
+extern BOOLEAN ShipProfile_enabled;
+
+// Called when a battle starts and ends
+void ShipProfile_beginBattle (void);
+void ShipProfile_endBattle (void);
+
+// Counts the time since 'start', as returned by GetTimeMicroseconds()
+void ShipProfile_add (SPECIES_ID species, ShipProfileKind kind,
+		DWORD start);
+
+// The race whose ship put the element in the queue, or NO_ID
+static inline SPECIES_ID
+ShipProfile_elementSpecies (const ELEMENT *ElementPtr)
+{
+	const STARSHIP *StarShipPtr = (const STARSHIP *) ElementPtr->pParent;
+	return StarShipPtr ? StarShipPtr->SpeciesID : NO_ID;
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* UQM_SHIPPROF_H_ */
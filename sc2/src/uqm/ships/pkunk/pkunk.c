@@ -247,6 +247,7 @@ pkunk_intelligence (ELEMENT *ShipPtr, EVALUATE_DESC *ObjectsOfConcern,
 		RemoveElement (PkunkData->hPhoenix);
 		FreeElement (PkunkData->hPhoenix);
 		PkunkData->hPhoenix = 0;
+		InvalidateThreatTable ();
 	}
 
 	if (StarShipPtr->RaceDescPtr->ship_info.energy_level <
@@ -47,9 +47,6 @@ void
 RepairSISBorder (void)
 {
 	RECT r;
-	CONTEXT OldContext;
-
-	OldContext = SetContext (ScreenContext);
 
 	BatchGraphics ();
 
@@ -58,24 +55,20 @@ RepairSISBorder (void)
 	r.corner.y = SIS_ORG_Y - 1;
 	r.extent.width = 1;
 	r.extent.height = SIS_SCREEN_HEIGHT + 2;
-	SetContextForeGroundColor (SIS_LEFT_BORDER_COLOR);
-	DrawFilledRectangle (&r);
+	DrawFilledRectangleIn (ScreenContext, &r, SIS_LEFT_BORDER_COLOR);
 
 	// Right border
-	SetContextForeGroundColor (SIS_BOTTOM_RIGHT_BORDER_COLOR);
 	r.corner.x += (SIS_SCREEN_WIDTH + 2) - 1;
-	DrawFilledRectangle (&r);
+	DrawFilledRectangleIn (ScreenContext, &r, SIS_BOTTOM_RIGHT_BORDER_COLOR);
 
 	// Bottom border
 	r.corner.x = SIS_ORG_X - 1;
 	r.corner.y += (SIS_SCREEN_HEIGHT + 2) - 1;
 	r.extent.width = SIS_SCREEN_WIDTH + 2;
 	r.extent.height = 1;
-	DrawFilledRectangle (&r);
+	DrawFilledRectangleIn (ScreenContext, &r, SIS_BOTTOM_RIGHT_BORDER_COLOR);
 
 	UnbatchGraphics ();
-
-	SetContext (OldContext);
 }
 
 void
@@ -728,9 +721,6 @@ DrawLanders (void)
 	SIZE width;
 	RECT r;
 	STAMP s;
-	CONTEXT OldContext;
-
-	OldContext = SetContext (StatusContext);
 
 	s.frame = IncFrameIndex (FlagStatFrame);
 	GetFrameRect (s.frame, &r);
@@ -745,15 +735,12 @@ DrawLanders (void)
 			+ (2 * (MAX_LANDERS - 1)) + 2;
 	r.corner.x -= r.extent.width >> 1;
 	r.corner.y += s.origin.y;
-	SetContextForeGroundColor (BLACK_COLOR);
-	DrawFilledRectangle (&r);
+	DrawFilledRectangleIn (StatusContext, &r, BLACK_COLOR);
 	while (i--)
 	{
-		DrawStamp (&s);
+		DrawStampIn (StatusContext, &s);
 		s.origin.x += width;
 	}
-
-	SetContext (OldContext);
 }
 
 // Draw the storage bays, below the picture of the flagship.
@@ -762,9 +749,6 @@ DrawStorageBays (BOOLEAN Refresh)
 {
 	BYTE i;
 	RECT r;
-	CONTEXT OldContext;
-
-	OldContext = SetContext (StatusContext);
 
 	r.extent.width = 2;
 	r.extent.height = 4;
@@ -774,8 +758,7 @@ DrawStorageBays (BOOLEAN Refresh)
 		r.extent.width = NUM_MODULE_SLOTS * (r.extent.width + 1);
 		r.corner.x = (STATUS_WIDTH >> 1) - (r.extent.width >> 1);
 
-		SetContextForeGroundColor (BLACK_COLOR);
-		DrawFilledRectangle (&r);
+		DrawFilledRectangleIn (StatusContext, &r, BLACK_COLOR);
 		r.extent.width = 2;
 	}
 
@@ -786,11 +769,11 @@ DrawStorageBays (BOOLEAN Refresh)
 
 		r.corner.x = (STATUS_WIDTH >> 1)
 				- ((i * (r.extent.width + 1)) >> 1);
-		SetContextForeGroundColor (STORAGE_BAY_FULL_COLOR);
 		for (j = GLOBAL_SIS (TotalElementMass);
 				j >= STORAGE_BAY_CAPACITY; j -= STORAGE_BAY_CAPACITY)
 		{
-			DrawFilledRectangle (&r);
+			DrawFilledRectangleIn (StatusContext, &r,
+					STORAGE_BAY_FULL_COLOR);
 			r.corner.x += r.extent.width + 1;
 
 			--i;
@@ -801,13 +784,14 @@ DrawStorageBays (BOOLEAN Refresh)
 		if (r.extent.height)
 		{
 			r.corner.y += 4 - r.extent.height;
-			DrawFilledRectangle (&r);
+			DrawFilledRectangleIn (StatusContext, &r,
+					STORAGE_BAY_FULL_COLOR);
 			r.extent.height = 4 - r.extent.height;
 			if (r.extent.height)
 			{
 				r.corner.y = 123;
-				SetContextForeGroundColor (STORAGE_BAY_EMPTY_COLOR);
-				DrawFilledRectangle (&r);
+				DrawFilledRectangleIn (StatusContext, &r,
+						STORAGE_BAY_EMPTY_COLOR);
 			}
 			r.corner.x += r.extent.width + 1;
 
@@ -815,15 +799,13 @@ DrawStorageBays (BOOLEAN Refresh)
 		}
 		r.extent.height = 4;
 
-		SetContextForeGroundColor (STORAGE_BAY_EMPTY_COLOR);
 		while (i--)
 		{
-			DrawFilledRectangle (&r);
+			DrawFilledRectangleIn (StatusContext, &r,
+					STORAGE_BAY_EMPTY_COLOR);
 			r.corner.x += r.extent.width + 1;
 		}
 	}
-
-	SetContext (OldContext);
 }
 
 void
@@ -1023,60 +1005,57 @@ DeltaSISGauges_crewDelta (SIZE crew_delta)
 	}
 }
 
-static void
-DeltaSISGauges_fuelDelta (SIZE fuel_delta)
+// Returns TRUE if the fuel gauge shows a different value now
+static BOOLEAN
+DeltaSISGauges_changeFuel (SIZE fuel_delta)
 {
 	COUNT old_coarse_fuel;
-	COUNT new_coarse_fuel;
-
-	if (fuel_delta == 0)
-		return;
 
 	if (fuel_delta == UNDEFINED_DELTA)
-		old_coarse_fuel = (COUNT)~0;
+		return TRUE;
+
+	old_coarse_fuel = (COUNT)(
+			GLOBAL_SIS (FuelOnBoard) / FUEL_TANK_SCALE);
+	if (fuel_delta < 0
+			&& GLOBAL_SIS (FuelOnBoard) <= (DWORD)-fuel_delta)
+	{
+		GLOBAL_SIS (FuelOnBoard) = 0;
+	}
 	else
 	{
-
-		old_coarse_fuel = (COUNT)(
-				GLOBAL_SIS (FuelOnBoard) / FUEL_TANK_SCALE);
-		if (fuel_delta < 0
-				&& GLOBAL_SIS (FuelOnBoard) <= (DWORD)-fuel_delta)
-		{
-			GLOBAL_SIS (FuelOnBoard) = 0;
-		}
-		else
-		{
-			DWORD FuelCapacity = GetFuelTankCapacity ();
-			GLOBAL_SIS (FuelOnBoard) += fuel_delta;
-			if (GLOBAL_SIS (FuelOnBoard) > FuelCapacity)
-				GLOBAL_SIS (FuelOnBoard) = FuelCapacity;
-		}
+		DWORD FuelCapacity = GetFuelTankCapacity ();
+		GLOBAL_SIS (FuelOnBoard) += fuel_delta;
+		if (GLOBAL_SIS (FuelOnBoard) > FuelCapacity)
+			GLOBAL_SIS (FuelOnBoard) = FuelCapacity;
 	}
 
-	new_coarse_fuel = (COUNT)(
-			GLOBAL_SIS (FuelOnBoard) / FUEL_TANK_SCALE);
-	if (new_coarse_fuel != old_coarse_fuel)
-	{
-		TEXT t;
-		UNICODE buf[60];
-		RECT r;
+	return (COUNT)(GLOBAL_SIS (FuelOnBoard) / FUEL_TANK_SCALE)
+			!= old_coarse_fuel;
+}
 
-		snprintf (buf, sizeof buf, "%u", new_coarse_fuel);
+static void
+DeltaSISGauges_drawFuel (void)
+{
+	TEXT t;
+	UNICODE buf[60];
+	RECT r;
 
-		GetGaugeRect (&r, FALSE);
-		
-		t.baseline.x = STATUS_WIDTH >> 1;
-		t.baseline.y = r.corner.y + r.extent.height;
-		t.align = ALIGN_CENTER;
-		t.pStr = buf;
-		t.CharCount = (COUNT)~0;
+	snprintf (buf, sizeof buf, "%u",
+			(COUNT)(GLOBAL_SIS (FuelOnBoard) / FUEL_TANK_SCALE));
 
-		SetContextForeGroundColor (BLACK_COLOR);
-		DrawFilledRectangle (&r);
-		SetContextForeGroundColor (
-				BUILD_COLOR (MAKE_RGB15 (0x13, 0x00, 0x00), 0x2C));
-		font_DrawText (&t);
-	}
+	GetGaugeRect (&r, FALSE);
+	
+	t.baseline.x = STATUS_WIDTH >> 1;
+	t.baseline.y = r.corner.y + r.extent.height;
+	t.align = ALIGN_CENTER;
+	t.pStr = buf;
+	t.CharCount = (COUNT)~0;
+
+	SetContextForeGroundColor (BLACK_COLOR);
+	DrawFilledRectangle (&r);
+	SetContextForeGroundColor (
+			BUILD_COLOR (MAKE_RGB15 (0x13, 0x00, 0x00), 0x2C));
+	font_DrawText (&t);
 }
 	
 static void
@@ -1115,8 +1094,12 @@ void
 DeltaSISGauges (SIZE crew_delta, SIZE fuel_delta, int resunit_delta)
 {
 	CONTEXT OldContext;
+	BOOLEAN redrawFuel;
 
-	if (crew_delta == 0 && fuel_delta == 0 && resunit_delta == 0)
+	// In HyperSpace, most fuel changes are too small for the gauge to
+	// show, and then there is nothing to draw
+	redrawFuel = fuel_delta != 0 && DeltaSISGauges_changeFuel (fuel_delta);
+	if (crew_delta == 0 && !redrawFuel && resunit_delta == 0)
 		return;
 
 	OldContext = SetContext (StatusContext);
@@ -1143,7 +1126,8 @@ DeltaSISGauges (SIZE crew_delta, SIZE fuel_delta, int resunit_delta)
 	SetContextFont (TinyFont);
 
 	DeltaSISGauges_crewDelta (crew_delta);
-	DeltaSISGauges_fuelDelta (fuel_delta);
+	if (redrawFuel)
+		DeltaSISGauges_drawFuel ();
 
 	if (crew_delta == UNDEFINED_DELTA)
 	{
@@ -140,23 +140,28 @@ NotPositional (void)
 void
 UpdateSoundPositions (void)
 {
+	ChannelPosition positions[NUM_SFX_CHANNELS];
+	COUNT count = 0;
 	COUNT i;
 
 	for (i = FIRST_SFX_CHANNEL; i <= LAST_SFX_CHANNEL; ++i)
 	{
 		ELEMENT *posobj;
-		if (!ChannelPlaying(i))
-			continue;
 
 		posobj = GetPositionalObject (i);
-		if (posobj != NULL)
+		if (posobj == NULL || !ChannelPlaying (i))
+			continue;
+
+		positions[count].pos = CalcSoundPosition (posobj);
+		if (positions[count].pos.positional)
 		{
-			SoundPosition pos;
-			pos = CalcSoundPosition (posobj);
-			if (pos.positional)
-				UpdateSoundPosition (i, pos);
+			positions[count].channel = i;
+			++count;
 		}
 	}
+
+	if (count > 0)
+		UpdateSoundPositionBatch (positions, count);
 }
 
 void
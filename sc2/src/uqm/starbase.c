@@ -318,7 +318,9 @@ DoStarBase (MENU_STATE *pMS)
 
 		pMS->Initialized = TRUE;
 
-		pMS->CurFrame = CaptureDrawable (LoadGraphic (STARBASE_ANIM));
+		// Shared with the resource system, so that it stays loaded for
+		// the next visit
+		pMS->CurFrame = CaptureDrawable (res_GetResource (STARBASE_ANIM));
 		pMS->hMusic = LoadMusic (STARBASE_MUSIC);
 
 		SetContext (ScreenContext);
@@ -335,8 +337,12 @@ DoStarBase (MENU_STATE *pMS)
 	else if (PulsedInputState.menu[KEY_MENU_SELECT])
 	{
 ExitStarBase:
-		DestroyDrawable (ReleaseDrawable (pMS->CurFrame));
-		pMS->CurFrame = 0;
+		if (pMS->CurFrame)
+		{
+			ReleaseDrawable (pMS->CurFrame);
+			res_FreeResource (STARBASE_ANIM);
+			pMS->CurFrame = 0;
+		}
 		StopMusic ();
 		if (pMS->hMusic)
 		{
@@ -434,6 +440,8 @@ VisitStarBase (void)
 	CONTEXT OldContext;
 	StatMsgMode prevMsgMode = SMM_UNDEFINED;
 
+	res_PreloadSet ("preload.starbase");
+
 	// XXX: This should probably be moved out to Starcon2Main()
 	if (GET_GAME_STATE (CHMMR_BOMB_STATE) == 2)
 	{	// We were just transported by Chmmr to the Starbase
@@ -96,6 +96,14 @@ BackgroundInitKernel (DWORD TimeOut)
 	TaskSwitch ();
 	InitGameKernel ();
 
+#if defined(DEBUG) || defined(USE_DEBUG_KEY)
+	if (runWorldBatch ())
+	{	// Only the batch run was wanted
+		GLOBAL (CurrentActivity) |= CHECK_ABORT;
+		return;
+	}
+#endif
+
 	while ((GetTimeCounter () <= TimeOut) &&
 	       !(GLOBAL (CurrentActivity) & CHECK_ABORT))
 	{
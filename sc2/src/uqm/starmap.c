@@ -20,82 +20,201 @@
 #include "gamestr.h"
 #include "globdata.h"
 #include "libs/gfxlib.h"
+#include <string.h>
 
 
 STAR_DESC *star_array;
 STAR_DESC *CurStarDescPtr = 0;
 
+// A grid over the stars, so that FindStar() only looks at the stars near
+// the point. Built the first time either set of stars is searched; the
+// stars never move. Each cell lists its stars in star_array order.
+#define STAR_GRID_SHIFT 9
+		// Cells of 512 x 512 universe units
+#define STAR_GRID_DIM ((MAX_X_UNIVERSE >> STAR_GRID_SHIFT) + 1)
+#define NUM_HYPER_VORTICES 15
+
+typedef struct
+{
+	STAR_DESC *base;
+			// NULL until built
+	COUNT cellStart[STAR_GRID_DIM * STAR_GRID_DIM + 1];
+	COUNT stars[NUM_SOLAR_SYSTEMS];
+} STAR_GRID;
+
+static STAR_GRID starGrids[2];
+		// HyperSpace and QuasiSpace
+
+// The stars the last search found, for the following FindStar() calls
+// going through them one by one
+static struct
+{
+	STAR_DESC *base;
+	POINT pt;
+	SIZE xbounds, ybounds;
+	COUNT numFound;
+	COUNT next;
+	COUNT found[NUM_SOLAR_SYSTEMS];
+} lastFind;
+
+static COUNT
+starGridCell (COORD c)
+{
+	if (c < 0)
+		return 0;
+	c >>= STAR_GRID_SHIFT;
+	return c < STAR_GRID_DIM ? c : STAR_GRID_DIM - 1;
+}
+
+static STAR_GRID *
+getStarGrid (STAR_DESC *base, COUNT numStars, COUNT which)
+{
+	STAR_GRID *grid = &starGrids[which];
+	COUNT i, cell;
+
+	if (grid->base == base)
+		return grid;
+
+	memset (grid->cellStart, 0, sizeof grid->cellStart);
+	for (i = 0; i < numStars; ++i)
+	{
+		cell = starGridCell (base[i].star_pt.y) * STAR_GRID_DIM
+				+ starGridCell (base[i].star_pt.x);
+		++grid->cellStart[cell + 1];
+	}
+	for (cell = 0; cell < STAR_GRID_DIM * STAR_GRID_DIM; ++cell)
+		grid->cellStart[cell + 1] += grid->cellStart[cell];
+	for (i = 0; i < numStars; ++i)
+	{
+		cell = starGridCell (base[i].star_pt.y) * STAR_GRID_DIM
+				+ starGridCell (base[i].star_pt.x);
+		grid->stars[grid->cellStart[cell]++] = i;
+	}
+	// Each start was moved to the start of the next cell
+	memmove (&grid->cellStart[1], &grid->cellStart[0],
+			STAR_GRID_DIM * STAR_GRID_DIM * sizeof grid->cellStart[0]);
+	grid->cellStart[0] = 0;
+
+	grid->base = base;
+	return grid;
+}
+
+// Fills in lastFind with the stars within the bounds of pt, in star_array
+// order
+static void
+findStarsNear (const STAR_GRID *grid, POINT pt,
+		SIZE xbounds, SIZE ybounds)
+{
+	COORD min_x, max_x, min_y, max_y;
+	COUNT col0, col1, row0, row1, row, col, i, j;
+	COUNT num = 0;
+
+	lastFind.base = grid->base;
+	lastFind.pt = pt;
+	lastFind.xbounds = xbounds;
+	lastFind.ybounds = ybounds;
+	lastFind.next = 0;
+
+	min_x = max_x = pt.x;
+	if (xbounds > 0)
+	{
+		min_x -= xbounds;
+		max_x += xbounds;
+	}
+	min_y = max_y = pt.y;
+	if (ybounds > 0)
+	{
+		min_y -= ybounds;
+		max_y += ybounds;
+	}
+
+	col0 = xbounds < 0 ? 0 : starGridCell (min_x);
+	col1 = xbounds < 0 ? STAR_GRID_DIM - 1 : starGridCell (max_x);
+	row0 = ybounds < 0 ? 0 : starGridCell (min_y);
+	row1 = ybounds < 0 ? STAR_GRID_DIM - 1 : starGridCell (max_y);
+
+	for (row = row0; row <= row1; ++row)
+	{
+		for (col = col0; col <= col1; ++col)
+		{
+			COUNT cell = row * STAR_GRID_DIM + col;
+
+			for (i = grid->cellStart[cell]; i < grid->cellStart[cell + 1];
+					++i)
+			{
+				COUNT index = grid->stars[i];
+				const STAR_DESC *SDPtr = &grid->base[index];
+
+				if ((ybounds < 0 || (SDPtr->star_pt.y >= min_y
+						&& SDPtr->star_pt.y <= max_y))
+						&& (xbounds < 0 || (SDPtr->star_pt.x >= min_x
+						&& SDPtr->star_pt.x <= max_x)))
+					lastFind.found[num++] = index;
+			}
+		}
+	}
+
+	// Stars from different cells, in star_array order again
+	for (i = 1; i < num; ++i)
+	{
+		COUNT index = lastFind.found[i];
+
+		for (j = i; j > 0 && lastFind.found[j - 1] > index; --j)
+			lastFind.found[j] = lastFind.found[j - 1];
+		lastFind.found[j] = index;
+	}
+	lastFind.numFound = num;
+}
+
+// Returns the first star after pLastStar (NULL to start from the first
+// one), in star_array order, that is within xbounds and ybounds of
+// puniverse. A bound of 0 means the star must be right there; a negative
+// one means anywhere in that direction.
 STAR_DESC*
 FindStar (STAR_DESC *LastSDPtr, POINT *puniverse, SIZE xbounds,
 		SIZE ybounds)
 {
-	COORD min_y, max_y;
-	SIZE lo, hi;
 	STAR_DESC *BaseSDPtr;
+	COUNT numStars;
+	const STAR_GRID *grid;
+	COUNT last, i;
 
 	if (GET_GAME_STATE (ARILOU_SPACE_SIDE) <= 1)
 	{
 		BaseSDPtr = star_array;
-		hi = NUM_SOLAR_SYSTEMS - 1;
+		numStars = NUM_SOLAR_SYSTEMS;
+		grid = getStarGrid (BaseSDPtr, numStars, 0);
 	}
 	else
 	{
-#define NUM_HYPER_VORTICES 15
 		BaseSDPtr = &star_array[NUM_SOLAR_SYSTEMS + 1];
-		hi = (NUM_HYPER_VORTICES + 1) - 1;
+		numStars = NUM_HYPER_VORTICES + 1;
+		grid = getStarGrid (BaseSDPtr, numStars, 1);
 	}
 
-	if (LastSDPtr == NULL)
-		lo = 0;
-	else if ((lo = LastSDPtr - BaseSDPtr + 1) > hi)
-		return (0);
-	else
-		hi = lo;
+	if (LastSDPtr == NULL || lastFind.base != BaseSDPtr
+			|| lastFind.pt.x != puniverse->x || lastFind.pt.y != puniverse->y
+			|| lastFind.xbounds != xbounds || lastFind.ybounds != ybounds)
+		findStarsNear (grid, *puniverse, xbounds, ybounds);
 
-	if (ybounds <= 0)
-		min_y = max_y = puniverse->y;
+	if (LastSDPtr == NULL)
+		i = 0;
 	else
 	{
-		min_y = puniverse->y - ybounds;
-		max_y = puniverse->y + ybounds;
-	}
-
-	while (lo < hi)
-	{
-		SIZE mid;
-
-		mid = (lo + hi) >> 1;
-		if (BaseSDPtr[mid].star_pt.y >= min_y)
-			hi = mid - 1;
-		else
-			lo = mid + 1;
-	}
-
-	LastSDPtr = &BaseSDPtr[lo];
-	if (ybounds < 0 || LastSDPtr->star_pt.y <= max_y)
-	{
-		COORD min_x, max_x;
-
-		if (xbounds <= 0)
-			min_x = max_x = puniverse->x;
-		else
-		{
-			min_x = puniverse->x - xbounds;
-			max_x = puniverse->x + xbounds;
+		last = (COUNT)(LastSDPtr - BaseSDPtr);
+		i = lastFind.next;
+		if (i == 0 || lastFind.found[i - 1] != last)
+		{	// Not going through them one by one
+			for (i = 0; i < lastFind.numFound
+					&& lastFind.found[i] <= last; ++i)
+				;
 		}
-
-		do
-		{
-			if ((ybounds < 0 || LastSDPtr->star_pt.y >= min_y)
-					&& (xbounds < 0
-					|| (LastSDPtr->star_pt.x >= min_x
-					&& LastSDPtr->star_pt.x <= max_x))
-					)
-				return (LastSDPtr);
-		} while ((++LastSDPtr)->star_pt.y <= max_y);
 	}
 
-	return (0);
+	if (i >= lastFind.numFound)
+		return (0);
+	lastFind.next = i + 1;
+	return (&BaseSDPtr[lastFind.found[i]]);
 }
 
 void
@@ -50,6 +50,62 @@ static GAME_STATE_FILE state_files[NUM_STATE_FILES] =
 };
 
 
+// A copy of all the state files, taken in one go. Its files can be read
+// like the state files themselves, but are not the state files: they do
+// not change when those do.
+struct STATE_SNAPSHOT
+{
+	GAME_STATE_FILE files[NUM_STATE_FILES];
+};
+
+// The in-memory files as they are read, for the state files themselves
+// without USE_RUST_STATE, and for their copies in a snapshot either way
+static DWORD
+lengthMemFile (GAME_STATE_FILE *fp)
+{
+	return fp->used;
+}
+
+static int
+readMemFile (void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp)
+{
+	DWORD bytes = size * count;
+
+	if (fp->ptr >= fp->size)
+	{	// EOF
+		return 0;
+	}
+	else if (fp->ptr + bytes > fp->size)
+	{	// dont have that much data
+		bytes = fp->size - fp->ptr;
+		bytes -= bytes % size;
+	}
+	
+	if (bytes > 0)
+	{
+		memcpy (lpBuf, fp->data + fp->ptr, bytes);
+		fp->ptr += bytes;
+	}
+	return (bytes / size);
+}
+
+static int
+seekMemFile (GAME_STATE_FILE *fp, long offset, int whence)
+{
+	if (whence == SEEK_CUR)
+		offset += fp->ptr;
+	else if (whence == SEEK_END)
+		offset += fp->used;
+
+	if (offset < 0)
+	{
+		fp->ptr = 0;
+		return 0;
+	}
+	fp->ptr = offset;
+	return 1;
+}
+
 #ifdef USE_RUST_STATE
 
 /* Rust FFI declarations for state file operations */
@@ -77,10 +133,24 @@ OpenStateFile (int stateFile, const char *mode)
 	return &state_files[stateFile];
 }
 
+// The state files themselves live on the Rust side; only the copies in
+// snapshots are here
+static BOOLEAN
+isSnapshotFile (const GAME_STATE_FILE *fp)
+{
+	return fp < state_files || fp >= state_files + NUM_STATE_FILES;
+}
+
 void
 CloseStateFile (GAME_STATE_FILE *fp)
 {
 	int index = (int)(fp - state_files);
+	if (isSnapshotFile (fp))
+	{
+		fp->ptr = 0;
+		fp->open_count--;
+		return;
+	}
 	rust_close_state_file(index);
 }
 
@@ -94,6 +164,8 @@ DWORD
 LengthStateFile (GAME_STATE_FILE *fp)
 {
 	int index = (int)(fp - state_files);
+	if (isSnapshotFile (fp))
+		return lengthMemFile (fp);
 	return (DWORD)rust_length_state_file(index);
 }
 
@@ -101,6 +173,8 @@ int
 ReadStateFile (void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp)
 {
 	int index = (int)(fp - state_files);
+	if (isSnapshotFile (fp))
+		return readMemFile (lpBuf, size, count, fp);
 	return (int)rust_read_state_file(index, lpBuf, size, count);
 }
 
@@ -108,6 +182,8 @@ int
 WriteStateFile (const void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp)
 {
 	int index = (int)(fp - state_files);
+	if (isSnapshotFile (fp))
+		return 0; // Snapshots are only to be read
 	return (int)rust_write_state_file(index, lpBuf, size, count);
 }
 
@@ -115,6 +191,8 @@ int
 SeekStateFile (GAME_STATE_FILE *fp, long offset, int whence)
 {
 	int index = (int)(fp - state_files);
+	if (isSnapshotFile (fp))
+		return seekMemFile (fp, offset, whence);
 	return rust_seek_state_file(index, (int64_t)offset, whence);
 }
 
@@ -254,30 +332,13 @@ DeleteStateFile (int stateFile)
 DWORD
 LengthStateFile (GAME_STATE_FILE *fp)
 {
-	return fp->used;
+	return lengthMemFile (fp);
 }
 
 int
 ReadStateFile (void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp)
 {
-	DWORD bytes = size * count;
-
-	if (fp->ptr >= fp->size)
-	{	// EOF
-		return 0;
-	}
-	else if (fp->ptr + bytes > fp->size)
-	{	// dont have that much data
-		bytes = fp->size - fp->ptr;
-		bytes -= bytes % size;
-	}
-	
-	if (bytes > 0)
-	{
-		memcpy (lpBuf, fp->data + fp->ptr, bytes);
-		fp->ptr += bytes;
-	}
-	return (bytes / size);
+	return readMemFile (lpBuf, size, count, fp);
 }
 
 int
@@ -314,21 +375,112 @@ WriteStateFile (const void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp)
 int
 SeekStateFile (GAME_STATE_FILE *fp, long offset, int whence)
 {
-	if (whence == SEEK_CUR)
-		offset += fp->ptr;
-	else if (whence == SEEK_END)
-		offset += fp->used;
+	return seekMemFile (fp, offset, whence);
+}
 
-	if (offset < 0)
+#endif /* !USE_RUST_STATE */
+
+#define STATE_COPY_CHUNK 0x8000
+		// ReadStateFile() and WriteStateFile() take a COUNT
+
+// Takes a copy of all the state files as they are now. Reading the
+// copies does not go through the state files (or to Rust, with
+// USE_RUST_STATE), and they stay as they are while the game
+// goes on.
+STATE_SNAPSHOT *
+SnapshotStateFiles (void)
+{
+	STATE_SNAPSHOT *snap;
+	int i;
+
+	snap = HCalloc (sizeof (*snap));
+	for (i = 0; i < NUM_STATE_FILES; ++i)
 	{
-		fp->ptr = 0;
-		return 0;
+		GAME_STATE_FILE *copy = &snap->files[i];
+		GAME_STATE_FILE *fp;
+		DWORD len, pos;
+
+		copy->symname = state_files[i].symname;
+		fp = OpenStateFile (i, "rb");
+		if (!fp)
+			continue;
+		len = LengthStateFile (fp);
+		if (len > 0)
+		{
+			copy->data = HMalloc (len);
+			for (pos = 0; pos < len; pos += STATE_COPY_CHUNK)
+			{
+				COUNT chunk = (len - pos < STATE_COPY_CHUNK) ?
+						(COUNT)(len - pos) : STATE_COPY_CHUNK;
+				if (ReadStateFile (copy->data + pos, 1, chunk, fp) != chunk)
+					break;
+			}
+			if (pos < len)
+			{
+				log_add (log_Warning, "WARNING: Could not take a copy of "
+						"state file %s.", copy->symname);
+				len = pos;
+			}
+			copy->used = len;
+			copy->size = len;
+		}
+		CloseStateFile (fp);
 	}
-	fp->ptr = offset;
-	return 1;
+	return snap;
 }
 
-#endif /* !USE_RUST_STATE */
+// Puts the state files back the way they were in the snapshot
+void
+RestoreStateFiles (const STATE_SNAPSHOT *snap)
+{
+	int i;
+
+	for (i = 0; i < NUM_STATE_FILES; ++i)
+	{
+		const GAME_STATE_FILE *copy = &snap->files[i];
+		GAME_STATE_FILE *fp;
+		DWORD pos;
+
+		fp = OpenStateFile (i, "wb");
+		if (!fp)
+			continue;
+		for (pos = 0; pos < copy->used; pos += STATE_COPY_CHUNK)
+		{
+			COUNT chunk = (copy->used - pos < STATE_COPY_CHUNK) ?
+					(COUNT)(copy->used - pos) : STATE_COPY_CHUNK;
+			if (WriteStateFile (copy->data + pos, 1, chunk, fp) != chunk)
+				break;
+		}
+		CloseStateFile (fp);
+	}
+}
+
+void
+FreeStateSnapshot (STATE_SNAPSHOT *snap)
+{
+	int i;
+
+	if (!snap)
+		return;
+	for (i = 0; i < NUM_STATE_FILES; ++i)
+		HFree (snap->files[i].data);
+	HFree (snap);
+}
+
+// Opens the copy of a state file in a snapshot, for reading with
+// ReadStateFile() and friends, and closing with CloseStateFile()
+GAME_STATE_FILE *
+OpenSnapshotFile (STATE_SNAPSHOT *snap, int stateFile)
+{
+	GAME_STATE_FILE *fp;
+
+	if (stateFile < 0 || stateFile >= NUM_STATE_FILES)
+		return NULL;
+	fp = &snap->files[stateFile];
+	fp->open_count++;
+	fp->ptr = 0;
+	return fp;
+}
 
 
 void
@@ -78,6 +78,13 @@ int ReadStateFile (void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp);
 int WriteStateFile (const void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp);
 int SeekStateFile (GAME_STATE_FILE *fp, long offset, int whence);
 
+typedef struct STATE_SNAPSHOT STATE_SNAPSHOT;
+
+STATE_SNAPSHOT *SnapshotStateFiles (void);
+void RestoreStateFiles (const STATE_SNAPSHOT *snap);
+void FreeStateSnapshot (STATE_SNAPSHOT *snap);
+GAME_STATE_FILE *OpenSnapshotFile (STATE_SNAPSHOT *snap, int stateFile);
+
 static inline COUNT
 sread_8 (GAME_STATE_FILE *fp, BYTE *v)
 {
@@ -109,10 +109,25 @@ GetFleetByIndex (MELEE_STATE *pMS, COUNT index, MeleeTeam *result)
 
 	for ( ; index < pMS->load.numIndices; index++)
 	{
-		DIRENTRY entry = SetAbsDirEntryTableIndex (pMS->load.dirEntries,
-				pMS->load.entryIndices[index]);
-		if (LoadTeamImage (entry, result))
+		COUNT entryI = pMS->load.entryIndices[index];
+		DIRENTRY entry;
+		MeleeTeam *team = pMS->load.entryTeams[entryI];
+
+		if (team != NULL)
+		{
+			MeleeTeam_copy (result, team);
+			break;  // Read before
+		}
+
+		entry = SetAbsDirEntryTableIndex (pMS->load.dirEntries, entryI);
+		team = MeleeTeam_new ();
+		if (LoadTeamImage (entry, team))
+		{
+			pMS->load.entryTeams[entryI] = team;
+			MeleeTeam_copy (result, team);
 			break;  // Success
+		}
+		MeleeTeam_delete (team);
 
 		{
 			const char *fileName;
@@ -444,11 +459,30 @@ SelectTeamByFileName (MELEE_STATE *pMS, const char *fileName)
 	RefocusView (pMS, index);
 }
 
+static void
+FreeEntryTeams (MELEE_STATE *pMS)
+{
+	COUNT i;
+
+	if (pMS->load.entryTeams == NULL)
+		return;
+
+	for (i = 0; i < pMS->load.numEntries; i++)
+	{
+		if (pMS->load.entryTeams[i] != NULL)
+			MeleeTeam_delete (pMS->load.entryTeams[i]);
+	}
+	HFree (pMS->load.entryTeams);
+	pMS->load.entryTeams = NULL;
+	pMS->load.numEntries = 0;
+}
+
 void
 LoadTeamList (MELEE_STATE *pMS)
 {
 	COUNT i;
 
+	FreeEntryTeams (pMS);
 	DestroyDirEntryTable (ReleaseDirEntryTable (pMS->load.dirEntries));
 	pMS->load.dirEntries = CaptureDirEntryTable (
 			LoadDirEntryTable (meleeDir, "", ".mle", match_MATCH_SUFFIX));
@@ -460,6 +494,10 @@ LoadTeamList (MELEE_STATE *pMS)
 			sizeof pMS->load.entryIndices[0]);
 	for (i = 0; i < pMS->load.numIndices; i++)
 		pMS->load.entryIndices[i] = i;
+
+	pMS->load.numEntries = pMS->load.numIndices;
+	pMS->load.entryTeams = HCalloc (pMS->load.numEntries *
+			sizeof pMS->load.entryTeams[0]);
 }
 
 BOOLEAN
@@ -810,6 +848,8 @@ void
 InitMeleeLoadState (MELEE_STATE *pMS)
 {
 	pMS->load.entryIndices = NULL;
+	pMS->load.entryTeams = NULL;
+	pMS->load.numEntries = 0;
 	InitPreBuilt (pMS);
 	InitLoadView (pMS);
 }
@@ -819,6 +859,7 @@ UninitMeleeLoadState (MELEE_STATE *pMS)
 {
 	UninitLoadView (pMS);
 	UninitPreBuilt (pMS);
+	FreeEntryTeams (pMS);
 	if (pMS->load.entryIndices != NULL)
 		HFree (pMS->load.entryIndices);
 }
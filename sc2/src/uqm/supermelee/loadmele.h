@@ -38,6 +38,13 @@ struct melee_load_state
 	DIRENTRY dirEntries;
 	COUNT *entryIndices;
 	COUNT numIndices;
+	MeleeTeam **entryTeams;
+			// The teams read from the files so far, by directory entry;
+			// NULL for those not read yet. Kept until the directory is
+			// read again, so paging through the list only reads each
+			// file once.
+	COUNT numEntries;
+			// Number of directory entries (and entryTeams)
 
 	MeleeTeam *view[LOAD_TEAM_VIEW_SIZE];
 	COUNT top;
@@ -21,6 +21,7 @@
 #include "options.h"
 #include "buildpick.h"
 #include "meleeship.h"
+#include "replay.h"
 #include "../battle.h"
 #include "../build.h"
 #include "../status.h"
@@ -40,6 +41,7 @@
 #	include "netplay/netmelee.h"
 #	include "netplay/notify.h"
 #	include "netplay/notifyall.h"
+#	include "netplay/spectate.h"
 #	include "libs/graphics/widgets.h"
 		// for DrawShadowedBox()
 #	include "../cnctdlg.h"
@@ -58,6 +60,8 @@
 		// for TFB_Random()
 #include "libs/reslib.h"
 #include "libs/log.h"
+#include "libs/timelib.h"
+#include "libs/time/profile.h"
 #include "libs/uio.h"
 
 
@@ -202,6 +206,8 @@ static BOOLEAN DoConfirmSettings (MELEE_STATE *pMS);
 static BOOLEAN DrawTeamString (MELEE_STATE *pMS, COUNT side,
 		COUNT HiLiteState, const char *str);
 static void DrawFleetValue (MELEE_STATE *pMS, COUNT side, COUNT HiLiteState);
+static void GetTeamStringRect (COUNT side, RECT *r);
+static void GetFleetValueRect (COUNT side, RECT *r);
 
 static void Melee_UpdateView_fleetValue (MELEE_STATE *pMS, COUNT side);
 static void Melee_UpdateView_ship (MELEE_STATE *pMS, COUNT side,
@@ -347,10 +353,13 @@ DrawControls (COUNT which_side, BOOLEAN HiLite)
 	DrawMeleeIcon (1 + (8 * (1 - which_side)) + (HiLite ? 4 : 0) + which_icon);
 }
 
+// Only what overlaps pRect is drawn; the rest would be clipped away
+// anyway.
 static void
-DrawTeams (void)
+DrawTeams (RECT *pRect)
 {
 	COUNT side;
+	RECT r;
 
 	for (side = 0; side < NUM_SIDES; side++)
 	{
@@ -360,13 +369,22 @@ DrawTeams (void)
 
 		for (index = 0; index < MELEE_FLEET_SIZE; index++)
 		{
-			MeleeShip ship = MeleeSetup_getShip(pMeleeState->meleeSetup,
-					side, index);
+			MeleeShip ship;
+
+			GetShipBox (&r, side, GetShipRow (index), GetShipColumn (index));
+			if (!BoxIntersect (pRect, &r, &r))
+				continue;
+
+			ship = MeleeSetup_getShip(pMeleeState->meleeSetup, side, index);
 			DrawShipBox (side, index, ship, FALSE);
 		}
 
-		DrawTeamString (pMeleeState, side, DTSHS_NORMAL, NULL);
-		DrawFleetValue (pMeleeState, side, DTSHS_NORMAL);
+		GetTeamStringRect (side, &r);
+		if (BoxIntersect (pRect, &r, &r))
+			DrawTeamString (pMeleeState, side, DTSHS_NORMAL, NULL);
+		GetFleetValueRect (side, &r);
+		if (BoxIntersect (pRect, &r, &r))
+			DrawFleetValue (pMeleeState, side, DTSHS_NORMAL);
 	}
 }
 
@@ -374,6 +392,7 @@ void
 RepairMeleeFrame (const RECT *pRect)
 {
 	RECT r;
+	RECT teamsRect;
 	CONTEXT OldContext;
 	RECT OldRect;
 	POINT oldOrigin;
@@ -402,7 +421,10 @@ RepairMeleeFrame (const RECT *pRect)
 #endif
 	DrawMeleeIcon (26);  /* "Battle!" (highlighted) */
 
-	DrawTeams ();
+	teamsRect = r;
+	teamsRect.corner.x -= SAFE_X;
+	teamsRect.corner.y -= SAFE_Y;
+	DrawTeams (&teamsRect);
 
 	if (pMeleeState->MeleeOption == BUILD_PICK)
 		DrawPickFrame (pMeleeState);
@@ -1294,6 +1316,7 @@ DoConfirmSettings (MELEE_STATE *pMS)
 {
 #ifdef NETPLAY
 	ssize_t numDone;
+	size_t inputDelay;
 #endif
 
 	/* Cancel any presses of the Pause key. */
@@ -1356,8 +1379,10 @@ DoConfirmSettings (MELEE_STATE *pMS)
 		
 	// All sides have confirmed.
 
-	// Send our own prefered frame delay.
-	Netplay_NotifyAll_inputDelay (netplayOptions.inputDelay);
+	// Send our own prefered frame delay, taking the round trip time
+	// of the connections into account.
+	inputDelay = roundTripInputDelay (netplayOptions.inputDelay);
+	Netplay_NotifyAll_inputDelay (inputDelay);
 
 	// Synchronise the RNGs:
 	{
@@ -1395,7 +1420,7 @@ DoConfirmSettings (MELEE_STATE *pMS)
 
 	// The maximum value for all connections is used.
 	{
-		bool ok = setupInputDelay (netplayOptions.inputDelay);
+		bool ok = setupInputDelay (inputDelay);
 		if (!ok)
 			return FALSE;
 	}
@@ -1457,6 +1482,39 @@ BuildAndDrawShipList (MELEE_STATE *pMS)
 			// This should be split off.
 }
 
+// Fights a battle between the current teams. With optMeleeRecord, the
+// battle is recorded to REPLAY_FILE_NAME in the config dir. When battles
+// are served to spectators, it is recorded for them as well.
+static BOOLEAN
+RunMeleeBattle (MELEE_STATE *pMS)
+{
+	if (!SetPlayerInputAll ())
+		return FALSE;
+	BuildAndDrawShipList (pMS);
+
+	WaitForSoundEnd (TFBSOUND_WAIT_ALL);
+
+	if (Replay_isPlaying ())
+		TFB_SeedRandom (Replay_getSeed ());
+	else if (optMeleeRecord || Replay_hasListener ())
+	{
+		// The RNG state from here on is all a replay needs
+		DWORD seed = TFB_SeedRandom (0);
+		TFB_SeedRandom (seed);
+		Replay_startRecording (optMeleeRecord ? configDir : NULL,
+				REPLAY_FILE_NAME, pMS->meleeSetup, seed);
+	}
+
+	load_gravity_well ((BYTE)((COUNT)TFB_Random () %
+				NUMBER_OF_PLANET_TYPES));
+	Battle (NULL);
+	free_gravity_well ();
+	ClearPlayerInputAll ();
+	Replay_stop ();
+
+	return TRUE;
+}
+
 static void
 StartMelee (MELEE_STATE *pMS)
 {
@@ -1476,17 +1534,8 @@ StartMelee (MELEE_STATE *pMS)
 
 	do
 	{
-		if (!SetPlayerInputAll ())
+		if (!RunMeleeBattle (pMS))
 			break;
-		BuildAndDrawShipList (pMS);
-
-		WaitForSoundEnd (TFBSOUND_WAIT_ALL);
-
-		load_gravity_well ((BYTE)((COUNT)TFB_Random () %
-					NUMBER_OF_PLANET_TYPES));
-		Battle (NULL);
-		free_gravity_well ();
-		ClearPlayerInputAll ();
 
 		if (GLOBAL (CurrentActivity) & CHECK_ABORT)
 			return;
@@ -1501,6 +1550,228 @@ StartMelee (MELEE_STATE *pMS)
 	pMS->Initialized = FALSE;
 }
 
+#define BATCH_SHIP_PREFIX "ship:"
+
+// 'fileName' is a .mle file in the melee directory, or "ship:<n>" for a
+// team of one ship, of MeleeShip number n.
+static bool
+LoadBatchTeam (MELEE_STATE *pMS, COUNT side, const char *fileName)
+{
+	uio_Stream *stream;
+	int status;
+
+	if (strncmp (fileName, BATCH_SHIP_PREFIX,
+			sizeof BATCH_SHIP_PREFIX - 1) == 0)
+	{
+		unsigned int ship;
+		char dummy;
+		FleetShipIndex slotI;
+
+		if (sscanf (fileName + sizeof BATCH_SHIP_PREFIX - 1, "%u%c",
+				&ship, &dummy) != 1 || ship >= NUM_MELEE_SHIPS)
+			return false;
+
+		for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++)
+			MeleeSetup_setShip (pMS->meleeSetup, side, slotI, MELEE_NONE);
+		MeleeSetup_setShip (pMS->meleeSetup, side, 0, (MeleeShip) ship);
+		MeleeSetup_setTeamName (pMS->meleeSetup, side, fileName);
+		return true;
+	}
+
+	stream = uio_fopen (meleeDir, fileName, "rb");
+	if (stream == NULL)
+		return false;
+
+	status = MeleeSetup_deserializeTeam (pMS->meleeSetup, side, stream);
+	uio_fclose (stream);
+
+	return status == 0 && MeleeSetup_getFleetValue (pMS->meleeSetup, side);
+}
+
+// Runs the matches listed in 'listName' in the melee directory, one after
+// the other, as headless battles. Each line holds the bottom and the top
+// team, as for LoadBatchTeam(), optionally followed by the RNG seed; lines
+// starting with '#' are ignored. When no seed is given, one is picked
+// and logged, so that any match can be replayed. Every battle's result
+// is logged by ReportHeadlessBattle(); tools/meleetournament.sh reads
+// them from there.
+static void
+RunMeleeBatch (MELEE_STATE *pMS, const char *listName)
+{
+	uio_Stream *listStream;
+	char line[256];
+	COUNT matchNr = 0;
+	BOOLEAN oldHeadless = optMeleeHeadless;
+	COUNT side;
+
+	listStream = uio_fopen (meleeDir, listName, "r");
+	if (listStream == NULL)
+	{
+		log_add (log_Error, "Could not open melee batch file '%s'.",
+				listName);
+		return;
+	}
+
+	optMeleeHeadless = TRUE;
+	for (side = 0; side < NUM_SIDES; side++)
+	{
+		if (!(PlayerControl[side] & COMPUTER_CONTROL))
+			PlayerControl[side] = COMPUTER_CONTROL | STANDARD_RATING;
+	}
+
+	while (uio_fgets (line, sizeof line, listStream) != NULL)
+	{
+		char teamFile[NUM_SIDES][sizeof line];
+		unsigned long seed;
+		int numFields;
+
+		numFields = sscanf (line, "%255s %255s %lu", teamFile[0],
+				teamFile[1], &seed);
+		if (numFields < 2 || teamFile[0][0] == '#')
+			continue;
+
+		++matchNr;
+		if (!LoadBatchTeam (pMS, 0, teamFile[0])
+				|| !LoadBatchTeam (pMS, 1, teamFile[1]))
+		{
+			log_add (log_Warning, "Melee batch match %u: could not load "
+					"'%s' vs '%s'; skipped.", matchNr, teamFile[0],
+					teamFile[1]);
+			continue;
+		}
+
+		if (numFields < 3)
+			seed = SeedRandomNumbers ();
+		else
+			TFB_SeedRandom ((DWORD) seed);
+		log_add (log_User, "Melee batch match %u: '%s' vs '%s', seed %lu",
+				matchNr, teamFile[0], teamFile[1], seed);
+
+		if (!RunMeleeBattle (pMS))
+			break;
+
+		if (GLOBAL (CurrentActivity) & CHECK_ABORT)
+			break;
+		GLOBAL (CurrentActivity) = SUPER_MELEE;
+	}
+
+	optMeleeHeadless = oldHeadless;
+	uio_fclose (listStream);
+}
+
+// Plays back the battle recorded in 'fileName' in the config dir. The
+// first 'seekFrame' frames are run headless.
+static void
+RunMeleeReplay (MELEE_STATE *pMS, const char *fileName, DWORD seekFrame)
+{
+	if (!Replay_startPlayback (configDir, fileName, pMS->meleeSetup,
+			seekFrame))
+		return;
+
+	log_add (log_User, "Replaying '%s', seed %lu", fileName,
+			(unsigned long) Replay_getSeed ());
+	RunMeleeBattle (pMS);
+	GLOBAL (CurrentActivity) = SUPER_MELEE;
+}
+
+// Plays back 'fileName' as RunMeleeReplay() does, but with the frames not
+// paced, and logs how fast that went: battle frames simulated and frames
+// displayed per second, and percentiles of the frame profiler's times.
+// The recording fixes the seed, the fleets and every input, so each run
+// does the same work; the graphics settings are what the config says.
+static void
+RunMeleeBenchmark (MELEE_STATE *pMS, const char *fileName)
+{
+	static const int percents[] = { 50, 90, 99 };
+#define NUM_PERCENTS (sizeof percents / sizeof percents[0])
+	BOOLEAN oldShowGraph = Profile_showGraph;
+	DWORD start, elapsed;
+	DWORD displayed;
+	char line[160];
+	int len;
+	COUNT i, section;
+
+	if (!Replay_startPlayback (configDir, fileName, pMS->meleeSetup, 0))
+		return;
+
+	log_add (log_User, "Benchmark with '%s', seed %lu", fileName,
+			(unsigned long) Replay_getSeed ());
+	unpacedBattle = TRUE;
+	Profile_showGraph = FALSE;
+	Profile_enable (TRUE);
+	start = GetTimeMicroseconds ();
+
+	RunMeleeBattle (pMS);
+
+	elapsed = GetTimeMicroseconds () - start;
+	Profile_enable (FALSE);
+	Profile_showGraph = oldShowGraph;
+	unpacedBattle = FALSE;
+	GLOBAL (CurrentActivity) = SUPER_MELEE;
+
+	if (elapsed == 0)
+		elapsed = 1;
+	displayed = Profile_totalFrames ();
+	log_add (log_User, "Benchmark: %lu battle frames in %.2f s; "
+			"%.1f simulated frames/s, %.1f displayed frames/s",
+			(unsigned long) lastBattleFrameCount, elapsed / 1e6,
+			lastBattleFrameCount * 1e6 / elapsed, displayed * 1e6 / elapsed);
+
+	// The times are per displayed frame, in us
+	len = sprintf (line, "%-12s", "us per frame");
+	for (i = 0; i < NUM_PERCENTS; ++i)
+		len += sprintf (line + len, " %5sp%d", "", percents[i]);
+	log_add (log_User, "%s", line);
+
+	len = sprintf (line, "%-12s", "total");
+	for (i = 0; i < NUM_PERCENTS; ++i)
+	{
+		len += sprintf (line + len, " %8lu",
+				(unsigned long) Profile_framePercentile (percents[i]));
+	}
+	log_add (log_User, "%s", line);
+
+	for (section = 0; section < PROF_NUM_SECTIONS; ++section)
+	{
+		len = sprintf (line, "%-12s", Profile_sectionName (section));
+		for (i = 0; i < NUM_PERCENTS; ++i)
+		{
+			len += sprintf (line + len, " %8lu", (unsigned long)
+					Profile_sectionPercentile (section, percents[i]));
+		}
+		log_add (log_User, "%s", line);
+	}
+#undef NUM_PERCENTS
+}
+
+#ifdef NETPLAY_SPECTATE
+// Watches the battles served by 'host' (see netplay/spectate.c), until it
+// closes the connection.
+static void
+RunMeleeSpectate (MELEE_STATE *pMS, const char *host)
+{
+	const char *port = NETPLAY_SPECTATE_PORT;
+	uint32 delay = NETPLAY_SPECTATE_DELAY;
+
+	if (res_IsString ("config.meleespectateport"))
+		port = res_GetString ("config.meleespectateport");
+	if (res_IsInteger ("config.meleespectatedelay"))
+		delay = res_GetInteger ("config.meleespectatedelay");
+
+	if (!startSpectating (host, port, delay))
+		return;
+
+	while (waitSpectatedBattle (pMS->meleeSetup))
+	{
+		RunMeleeBattle (pMS);
+		if (GLOBAL (CurrentActivity) & CHECK_ABORT)
+			break;
+		GLOBAL (CurrentActivity) = SUPER_MELEE;
+	}
+	stopSpectating ();
+}
+#endif  /* NETPLAY_SPECTATE */
+
 static void
 StartMeleeButtonPressed (MELEE_STATE *pMS)
 {
@@ -2049,6 +2320,7 @@ err:
 void
 Melee (void)
 {
+	res_PreloadSet ("preload.melee");
 	InitGlobData ();
 	{
 		MELEE_STATE MenuState;
@@ -2093,14 +2365,61 @@ Melee (void)
 					MenuState.load.preBuiltList[1]);
 		}
 
-		MenuState.side = 0;
-		SetMenuSounds (MENU_SOUND_ARROWS, MENU_SOUND_SELECT);
-		DoInput (&MenuState, TRUE);
+#ifdef NETPLAY_SPECTATE
+		if (res_IsBoolean ("config.meleespectateserve")
+				&& res_GetBoolean ("config.meleespectateserve"))
+		{	// Players, and spectators that pass the battles on
+			serveSpectators (res_IsString ("config.meleespectateport") ?
+					res_GetString ("config.meleespectateport") :
+					NETPLAY_SPECTATE_PORT);
+		}
+#endif
 
-		StopMusic ();
-		WaitForSoundEnd (TFBSOUND_WAIT_ALL);
+		if (res_IsString ("config.meleebatch"))
+		{	// Run the listed matches instead of showing the menu.
+			// melee.cfg is left alone, as the teams were not chosen
+			// by the player.
+			RunMeleeBatch (&MenuState, res_GetString ("config.meleebatch"));
+			GLOBAL (CurrentActivity) |= CHECK_ABORT;
+		}
+		else if (res_IsString ("config.meleebenchmark"))
+		{
+			RunMeleeBenchmark (&MenuState,
+					res_GetString ("config.meleebenchmark"));
+			GLOBAL (CurrentActivity) |= CHECK_ABORT;
+		}
+		else if (res_IsString ("config.meleereplay"))
+		{
+			DWORD seekFrame = 0;
 
-		WriteMeleeConfig (&MenuState);
+			if (res_IsInteger ("config.meleereplayseek"))
+				seekFrame = res_GetInteger ("config.meleereplayseek");
+			RunMeleeReplay (&MenuState, res_GetString ("config.meleereplay"),
+					seekFrame);
+			GLOBAL (CurrentActivity) |= CHECK_ABORT;
+		}
+#ifdef NETPLAY_SPECTATE
+		else if (res_IsString ("config.meleespectate"))
+		{
+			RunMeleeSpectate (&MenuState,
+					res_GetString ("config.meleespectate"));
+			GLOBAL (CurrentActivity) |= CHECK_ABORT;
+		}
+#endif
+		else
+		{
+			MenuState.side = 0;
+			SetMenuSounds (MENU_SOUND_ARROWS, MENU_SOUND_SELECT);
+			DoInput (&MenuState, TRUE);
+
+			StopMusic ();
+			WaitForSoundEnd (TFBSOUND_WAIT_ALL);
+
+			WriteMeleeConfig (&MenuState);
+		}
+#ifdef NETPLAY_SPECTATE
+		stopServingSpectators ();
+#endif
 		FreeMeleeInfo (&MenuState);
 		DestroySound (ReleaseSound (GameSounds));
 		GameSounds = 0;
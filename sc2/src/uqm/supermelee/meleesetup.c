@@ -132,12 +132,14 @@ err:
 int
 MeleeTeam_serialize (const MeleeTeam *team, uio_Stream *stream)
 {
+	BYTE shipBytes[MELEE_FLEET_SIZE];
 	FleetShipIndex slotI;
 
-	for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++) {
-		if (uio_putc ((int) team->ships[slotI], stream) == EOF)
-			return -1;
-	}
+	// One write for all the slots, instead of one uio call per slot.
+	for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++)
+		shipBytes[slotI] = (BYTE) team->ships[slotI];
+	if (uio_fwrite (shipBytes, sizeof shipBytes, 1, stream) != 1)
+		return -1;
 	if (uio_fwrite ((const char *) team->name, sizeof team->name, 1,
 			stream) != 1)
 		return -1;
@@ -148,15 +150,16 @@ MeleeTeam_serialize (const MeleeTeam *team, uio_Stream *stream)
 int
 MeleeTeam_deserialize (MeleeTeam *team, uio_Stream *stream)
 {
+	BYTE shipBytes[MELEE_FLEET_SIZE];
 	FleetShipIndex slotI;
 
+	if (uio_fread (shipBytes, sizeof shipBytes, 1, stream) != 1)
+		goto err;
+
 	// Sanity check on the ships.
 	for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++)
 	{
-		int ship = uio_getc (stream);
-		if (ship == EOF)
-			goto err;
-		team->ships[slotI] = (MeleeShip) ship;
+		team->ships[slotI] = (MeleeShip) shipBytes[slotI];
 
 		if (team->ships[slotI] == MELEE_NONE)
 			continue;
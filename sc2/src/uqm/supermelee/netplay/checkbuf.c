@@ -64,7 +64,7 @@ ChecksumBuffer_init(ChecksumBuffer *cb, size_t delay, size_t interval) {
 	size_t bufSize = ((2 * delay + 2) + (interval - 1)) / interval;
 
 	{
-#ifdef NETPLAY_DEBUG
+#if defined(NETPLAY_DEBUG) || defined(NETPLAY_UDP)
 		size_t i;
 #endif
 
@@ -72,7 +72,7 @@ ChecksumBuffer_init(ChecksumBuffer *cb, size_t delay, size_t interval) {
 		cb->maxSize = bufSize;
 		cb->interval = interval;
 
-#ifdef NETPLAY_DEBUG
+#if defined(NETPLAY_DEBUG) || defined(NETPLAY_UDP)
 		for (i = 0; i < bufSize; i++) {
 			cb->checksums[i].checksum = 0;
 			cb->checksums[i].frameNr = (BattleFrameCounter) -1;
@@ -115,7 +115,7 @@ ChecksumBuffer_addChecksum(ChecksumBuffer *cb, BattleFrameCounter frameNr,
 
 	entry = ChecksumBuffer_getChecksumEntry(cb, frameNr);
 
-#ifdef NETPLAY_DEBUG
+#if defined(NETPLAY_DEBUG) || defined(NETPLAY_UDP)
 	entry->frameNr = frameNr;
 #endif
 	entry->checksum = checksum;
@@ -130,11 +130,13 @@ ChecksumBuffer_getChecksum(ChecksumBuffer *cb, BattleFrameCounter frameNr,
 
 	entry = ChecksumBuffer_getChecksumEntry(cb, frameNr);
 	
-#ifdef NETPLAY_DEBUG
+#if defined(NETPLAY_DEBUG) || defined(NETPLAY_UDP)
 	if (frameNr != entry->frameNr) {
+#ifdef NETPLAY_DEBUG
 		log_add(log_Error, "Checksum buffer entry for requested frame %u "
 				"(still?) contains a checksum for frame %u.\n",
 				frameNr, entry->frameNr);
+#endif
 		return false;
 	}
 #endif
@@ -40,14 +40,16 @@ extern "C" {
 
 
 struct ChecksumEntry {
-#ifdef NETPLAY_DEBUG
+#if defined(NETPLAY_DEBUG) || defined(NETPLAY_UDP)
 	BattleFrameCounter frameNr;
 			// The number of the frame this checksum originated from.
 			// If the checksumming code is working correctly, the checksum
-			// can only come from one frame, so this value is not needed
-			// for normal operation.
-			// Its only use is to detect some cases where checksumming code
-			// is *not* working correctly.
+			// can only come from one frame, so over TCP only this value is
+			// not needed for normal operation.
+			// With NETPLAY_UDP, the input may arrive before the checksum,
+			// and this tells that the checksum is not there yet.
+			// Otherwise its only use is to detect some cases where
+			// checksumming code is *not* working correctly.
 #endif
 	Checksum checksum;
 };
@@ -28,8 +28,18 @@
 		// for DUMP_CRC_OPS
 #include "netconnection.h"
 #include "netmelee.h"
+#ifdef NETPLAY_UDP
+#	include "netudp.h"
+#endif
 #include "libs/log.h"
 #include "libs/mathlib.h"
+#ifdef NETPLAY_DESYNC_FRAMES
+#	include "options.h"
+			// for configDir
+#	include "libs/uio.h"
+#	include <stdlib.h>
+#	include <time.h>
+#endif
 
 ChecksumBuffer localChecksumBuffer;
 
@@ -103,6 +113,237 @@ crc_processSTATE(crc_State *state, const STATE *val) {
 	crc_processPOINT(state, &val->location);
 }
 
+#if !defined(DUMP_CRC_OPS) || defined(NETPLAY_DESYNC_FRAMES)
+// The bytes crc_processUint16() would process for 'val', low byte first
+static inline uint8 *
+putElementField16(uint8 *buf, uint16 val) {
+	buf[0] = (uint8) (val & 0xff);
+	buf[1] = (uint8) (val >> 8);
+	return buf + 2;
+}
+
+static inline uint8 *
+putElementEXTENT(uint8 *buf, const EXTENT *val) {
+	buf = putElementField16(buf, (uint16) val->width);
+	return putElementField16(buf, (uint16) val->height);
+}
+
+#define ELEMENT_CRC_SIZE (2 + 2 + 2 + 1 + 1 + 1 + (2 + 4 * 4) + 4 + 4)
+
+// The bytes crc_processELEMENT() processes for a non-background element,
+// in the same order as the per-field calls, which are kept for the dumps.
+static void
+packELEMENT(uint8 *buf, const ELEMENT *val) {
+	uint8 *ptr = buf;
+
+	ptr = putElementField16(ptr, (uint16) val->state_flags);
+	ptr = putElementField16(ptr, (uint16) val->life_span);
+	ptr = putElementField16(ptr, (uint16) val->crew_level);
+	*ptr++ = (uint8) val->mass_points;
+	*ptr++ = (uint8) val->turn_wait;
+	*ptr++ = (uint8) val->thrust_wait;
+	ptr = putElementField16(ptr, (uint16) val->velocity.TravelAngle);
+	ptr = putElementEXTENT(ptr, &val->velocity.vector);
+	ptr = putElementEXTENT(ptr, &val->velocity.fract);
+	ptr = putElementEXTENT(ptr, &val->velocity.error);
+	ptr = putElementEXTENT(ptr, &val->velocity.incr);
+	ptr = putElementField16(ptr, (uint16) val->current.location.x);
+	ptr = putElementField16(ptr, (uint16) val->current.location.y);
+	ptr = putElementField16(ptr, (uint16) val->next.location.x);
+	ptr = putElementField16(ptr, (uint16) val->next.location.y);
+	assert(ptr == buf + ELEMENT_CRC_SIZE);
+}
+#endif
+
+#ifdef NETPLAY_DESYNC_FRAMES
+// The checksummed state of the last frames, element by element, so that
+// when the checksums of both sides differ it can be told what differs.
+typedef struct {
+	COUNT index;
+			// Position in disp_q
+	SIZE playerNr;
+	uint8 bytes[ELEMENT_CRC_SIZE];
+} DesyncElement;
+
+typedef struct {
+	bool used;
+	BattleFrameCounter frameNr;
+	DWORD seed;
+	Checksum checksum;
+	COUNT numElements;
+	DesyncElement elements[MAX_GROWN_DISPLAY_ELEMENTS];
+} DesyncFrame;
+
+static DesyncFrame *desyncFrames;
+static size_t numDesyncFrames;
+static DesyncFrame *recordingFrame;
+		// The frame crc_processState() is recording; NULL if none
+
+static DesyncFrame *
+getDesyncFrame(BattleFrameCounter frameNr) {
+	DesyncFrame *frame;
+
+	if (desyncFrames == NULL)
+		return NULL;
+	frame = &desyncFrames[frameNr % numDesyncFrames];
+	if (!frame->used || frame->frameNr != frameNr)
+		return NULL;
+	return frame;
+}
+
+static DesyncFrame *
+beginDesyncFrame(BattleFrameCounter frameNr) {
+	DesyncFrame *frame;
+
+	if (desyncFrames == NULL)
+		return NULL;
+	frame = &desyncFrames[frameNr % numDesyncFrames];
+	frame->used = true;
+	frame->frameNr = frameNr;
+	frame->seed = 0;
+	frame->checksum = 0;
+	frame->numElements = 0;
+	return frame;
+}
+
+static void
+recordDesyncElement(const ELEMENT *val, COUNT index) {
+	DesyncElement *entry;
+
+	if (recordingFrame == NULL || (val->state_flags & BACKGROUND_OBJECT)
+			|| recordingFrame->numElements == MAX_GROWN_DISPLAY_ELEMENTS)
+		return;
+
+	entry = &recordingFrame->elements[recordingFrame->numElements++];
+	entry->index = index;
+	entry->playerNr = val->playerNr;
+	packELEMENT(entry->bytes, val);
+}
+
+static void
+initDesyncFrames(void) {
+	numDesyncFrames = getBattleInputDelay() + NETPLAY_DESYNC_FRAMES;
+			// The frame being verified is this far behind the last one
+			// recorded.
+	desyncFrames = calloc(numDesyncFrames, sizeof (DesyncFrame));
+	if (desyncFrames == NULL)
+		log_add(log_Warning, "Not keeping the state of the last frames "
+				"for desync dumps.");
+	recordingFrame = NULL;
+}
+
+static void
+uninitDesyncFrames(void) {
+	free(desyncFrames);
+	desyncFrames = NULL;
+	recordingFrame = NULL;
+}
+
+static inline uint16
+getElementField16(const uint8 *buf) {
+	return (uint16) (buf[0] | (buf[1] << 8));
+}
+
+static inline int
+getElementSigned16(const uint8 *buf) {
+	return (int) (sint16) getElementField16(buf);
+}
+
+// All the checksummed fields of an element, in the order packELEMENT()
+// puts them.
+static void
+dumpDesyncElementFields(uio_Stream *out, const DesyncElement *entry) {
+	const uint8 *b = entry->bytes;
+
+	uio_fprintf(out, "\t%u player %d flags 0x%04x life %u crew %u "
+			"mass %u turn %u thrust %u angle %u vector %d,%d fract %d,%d "
+			"error %d,%d incr %d,%d current %d,%d next %d,%d\n",
+			entry->index, entry->playerNr, getElementField16(b),
+			getElementField16(b + 2), getElementField16(b + 4),
+			b[6], b[7], b[8], getElementField16(b + 9),
+			getElementSigned16(b + 11), getElementSigned16(b + 13),
+			getElementSigned16(b + 15), getElementSigned16(b + 17),
+			getElementSigned16(b + 19), getElementSigned16(b + 21),
+			getElementSigned16(b + 23), getElementSigned16(b + 25),
+			getElementSigned16(b + 27), getElementSigned16(b + 29),
+			getElementSigned16(b + 31), getElementSigned16(b + 33));
+}
+
+// Writes what is kept of the last frames: for each frame one line per
+// element with the checksum of just that element, so that comparing the
+// dumps of both sides shows the first frame and element that differ;
+// then all the fields of the elements of the frame that failed.
+static void
+writeDesyncDump(BattleFrameCounter frameNr, NetConnection *conn,
+		Checksum localChecksum, Checksum remoteChecksum) {
+	char fileName[PATH_MAX];
+	time_t now;
+	uio_Stream *out;
+	BattleFrameCounter first;
+	BattleFrameCounter f;
+	const DesyncFrame *failed;
+	COUNT i;
+
+	if (desyncFrames == NULL || configDir == NULL)
+		return;
+
+	now = time(NULL);
+	if (now == (time_t) -1 || strftime(fileName, sizeof fileName,
+			"netplay-desync-%Y%m%d%H%M%S.txt", localtime(&now)) == 0)
+		return;
+
+	out = uio_fopen(configDir, fileName, "wt");
+	if (out == NULL) {
+		log_add(log_Warning, "Could not create netplay desync dump '%s'.",
+				fileName);
+		return;
+	}
+
+	uio_fprintf(out, "# Checksums of frame %u differ: local 0x%08x, "
+			"player %d 0x%08x.\n", (unsigned) frameNr,
+			(unsigned) localChecksum, NetConnection_getPlayerNr(conn),
+			(unsigned) remoteChecksum);
+	uio_fprintf(out, "# Compare with the dump of the other side.\n");
+
+	first = battleFrameCount >= numDesyncFrames ?
+			battleFrameCount - numDesyncFrames + 1 : 0;
+	for (f = first; f <= battleFrameCount; f++) {
+		const DesyncFrame *frame = getDesyncFrame(f);
+		if (frame == NULL)
+			continue;
+
+		uio_fprintf(out, "frame %u seed 0x%08x elements %u "
+				"checksum 0x%08x\n", (unsigned) frame->frameNr,
+				(unsigned) frame->seed, frame->numElements,
+				(unsigned) frame->checksum);
+		for (i = 0; i < frame->numElements; i++) {
+			const DesyncElement *entry = &frame->elements[i];
+			crc_State state;
+
+			crc_init(&state);
+			crc_processBytes(&state, (uint8 *) entry->bytes,
+					sizeof entry->bytes);
+			uio_fprintf(out, "\t%u player %d crc 0x%08x\n", entry->index,
+					entry->playerNr, (unsigned) crc_finish(&state));
+		}
+	}
+
+	failed = getDesyncFrame(frameNr);
+	if (failed != NULL) {
+		uio_fprintf(out, "# Elements of frame %u:\n", (unsigned) frameNr);
+		for (i = 0; i < failed->numElements; i++)
+			dumpDesyncElementFields(out, &failed->elements[i]);
+	} else {
+		uio_fprintf(out, "# Frame %u is no longer kept.\n",
+				(unsigned) frameNr);
+	}
+
+	uio_fclose(out);
+	log_add(log_Error, "Wrote the state of the last frames to '%s'.",
+			fileName);
+}
+#endif  /* NETPLAY_DESYNC_FRAMES */
+
 void
 crc_processELEMENT(crc_State *state, const ELEMENT *val) {
 #ifdef DUMP_CRC_OPS
@@ -115,6 +356,7 @@ crc_processELEMENT(crc_State *state, const ELEMENT *val) {
 		crc_log("      BACKGROUND_OBJECT element omited");
 #endif
 	} else {
+#ifdef DUMP_CRC_OPS
 		crc_processELEMENT_FLAGS(state, val->state_flags);
 		crc_processCOUNT(state, val->life_span);
 		crc_processCOUNT(state, val->crew_level);
@@ -124,6 +366,14 @@ crc_processELEMENT(crc_State *state, const ELEMENT *val) {
 		crc_processVELOCITY_DESC(state, &val->velocity);
 		crc_processSTATE(state, &val->current);
 		crc_processSTATE(state, &val->next);
+#else
+		// The same bytes in the same order as the calls above, which
+		// are kept for the dumps, gathered for one crc_processBytes().
+		uint8 buf[ELEMENT_CRC_SIZE];
+
+		packELEMENT(buf, val);
+		crc_processBytes(state, buf, sizeof buf);
+#endif
 	}
 #ifdef DUMP_CRC_OPS
 	crc_log("END   crc_processELEMENT().");
@@ -134,9 +384,11 @@ void
 crc_processDispQueue(crc_State *state) {
 	HELEMENT element;
 	HELEMENT nextElement;
+#if defined(DUMP_CRC_OPS) || defined(NETPLAY_DESYNC_FRAMES)
+	size_t i = 0;
+#endif
 
 #ifdef DUMP_CRC_OPS
-	size_t i = 0;
 	crc_log("START crc_processDispQueue().");
 #endif
 	for (element = GetHeadElement(); element != 0; element = nextElement) {
@@ -148,10 +400,13 @@ crc_processDispQueue(crc_State *state) {
 		LockElement(element, &elementPtr);
 
 		crc_processELEMENT(state, elementPtr);
+#ifdef NETPLAY_DESYNC_FRAMES
+		recordDesyncElement(elementPtr, (COUNT) i);
+#endif
 
 		nextElement = GetSuccElement(elementPtr);
 		UnlockElement(element);
-#ifdef DUMP_CRC_OPS
+#if defined(DUMP_CRC_OPS) || defined(NETPLAY_DESYNC_FRAMES)
 		i++;
 #endif
 	}
@@ -173,6 +428,10 @@ crc_processRNG(crc_State *state) {
 	crc_processDWORD(state, seed);
 	TFB_SeedRandom(seed);
 			// Restore the old seed.
+#ifdef NETPLAY_DESYNC_FRAMES
+	if (recordingFrame != NULL)
+		recordingFrame->seed = seed;
+#endif
 
 #ifdef DUMP_CRC_OPS
 	crc_log("END   crc_processRNG().");
@@ -186,8 +445,14 @@ crc_processState(crc_State *state) {
 			"START crc_processState() (frame %u).", battleFrameCount);
 #endif
 
+#ifdef NETPLAY_DESYNC_FRAMES
+	recordingFrame = beginDesyncFrame(battleFrameCount);
+#endif
 	crc_processRNG(state);
 	crc_processDispQueue(state);
+#ifdef NETPLAY_DESYNC_FRAMES
+	recordingFrame = NULL;
+#endif
 
 #ifdef DUMP_CRC_OPS
 	crc_log("END   crc_processState() (frame %u).",
@@ -215,6 +480,9 @@ initChecksumBuffers(void) {
 
 	ChecksumBuffer_init(&localChecksumBuffer, getBattleInputDelay(),
 			NETPLAY_CHECKSUM_INTERVAL);
+#ifdef NETPLAY_DESYNC_FRAMES
+	initDesyncFrames();
+#endif
 }
 
 void
@@ -237,6 +505,9 @@ uninitChecksumBuffers(void)
 	}
 	
 	ChecksumBuffer_uninit(&localChecksumBuffer);
+#ifdef NETPLAY_DESYNC_FRAMES
+	uninitDesyncFrames();
+#endif
 }
 
 void
@@ -244,6 +515,13 @@ addLocalChecksum(BattleFrameCounter frameNr, Checksum checksum) {
 	assert(frameNr == battleFrameCount);
 
 	ChecksumBuffer_addChecksum(&localChecksumBuffer, frameNr, checksum);
+#ifdef NETPLAY_DESYNC_FRAMES
+	{
+		DesyncFrame *frame = getDesyncFrame(frameNr);
+		if (frame != NULL)
+			frame->checksum = checksum;
+	}
+#endif
 }
 
 void
@@ -283,12 +561,22 @@ verifyChecksums(BattleFrameCounter frameNr) {
 
 		cb = NetConnection_getChecksumBuffer(conn);
 		
-		if (!ChecksumBuffer_getChecksum(cb, frameNr, &remoteChecksum))
+		if (!ChecksumBuffer_getChecksum(cb, frameNr, &remoteChecksum)) {
+#ifdef NETPLAY_UDP
+			if (usesUdpChannel(conn))
+				continue;
+						// The input came in over UDP, ahead of the
+						// checksum; this frame goes unchecked.
+#endif
 			return false;
+		}
 
 		if (localChecksum != remoteChecksum) {
 			log_add(log_Error, "Network connections have gone out of "
 					"sync.\n");
+#ifdef NETPLAY_DESYNC_FRAMES
+			writeDesyncDump(frameNr, conn, localChecksum, remoteChecksum);
+#endif
 			return false;
 		}
 	}
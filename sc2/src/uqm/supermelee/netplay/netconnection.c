@@ -21,6 +21,9 @@
 #include "netconnection.h"
 
 #include "netrcv.h"
+#ifdef NETPLAY_UDP
+#	include "netudp.h"
+#endif
 
 #if defined(DEBUG) || defined(NETPLAY_DEBUG)
 #	include "libs/log.h"
@@ -32,6 +35,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #if defined(NETPLAY_DEBUG) && defined(NETPLAY_DEBUG_FILE)
 #	include <errno.h>
 #	include <time.h>
@@ -126,6 +130,15 @@ NetConnection_open(int player, const NetplayPeerOptions *options,
 	conn->readBuf = malloc(NETPLAY_READBUFSIZE);
 	conn->readEnd = conn->readBuf;
 
+	conn->pingId = 0;
+	conn->pingSentTime = 0;
+	conn->pingOutstanding = false;
+	conn->roundTripTime = 0;
+	conn->numRoundTrips = 0;
+#ifdef NETPLAY_UDP
+	conn->udp = NULL;
+#endif
+
 	conn->stateData = NULL;
 	conn->stateFlags.connected = false;
 	conn->stateFlags.disconnected = false;
@@ -154,6 +167,14 @@ NetConnection_open(int player, const NetplayPeerOptions *options,
 			conn->statistics.packetTypeReceived[i] = 0;
 			conn->statistics.packetTypeSent[i] = 0;
 		}
+		conn->statistics.bytesReceived = 0;
+		conn->statistics.bytesSent = 0;
+		conn->statistics.lastRoundTrip = 0;
+		conn->statistics.minRoundTrip = 0;
+		conn->statistics.avgRoundTrip = 0;
+		conn->statistics.roundTripJitter = 0;
+		memset(&conn->statistics.battle, 0,
+				sizeof conn->statistics.battle);
 	}
 #endif
 
@@ -211,6 +232,9 @@ static void
 NetConnection_doClose(NetConnection *conn) {
 	conn->stateFlags.connected = false;
 	conn->stateFlags.disconnected = true;
+#ifdef NETPLAY_UDP
+	closeUdpChannel(conn);
+#endif
 
 	// First the callback, so that it can still use the information
 	// of what is the current state, and the stateData:
@@ -357,6 +381,84 @@ NetConnection_getInputDelay(const NetConnection *conn) {
 	return conn->stateFlags.inputDelay;
 }
 
+// Returns the id to send a new ping with, and notes when it is sent.
+uint32
+NetConnection_newPing(NetConnection *conn) {
+	conn->pingId++;
+	conn->pingSentTime = GetTimeCounter();
+	conn->pingOutstanding = true;
+	return conn->pingId;
+}
+
+#ifdef NETPLAY_STATISTICS
+static void
+NetStatistics_addRoundTrip(NetStatistics *statistics, TimeCount roundTrip) {
+	sint32 diff;
+
+	if (statistics->lastRoundTrip == 0) {
+		statistics->minRoundTrip = roundTrip;
+		statistics->avgRoundTrip = roundTrip;
+		statistics->roundTripJitter = roundTrip / 2;
+		statistics->lastRoundTrip = roundTrip;
+		return;
+	}
+
+	if (roundTrip < statistics->minRoundTrip)
+		statistics->minRoundTrip = roundTrip;
+
+	diff = (sint32) roundTrip - (sint32) statistics->avgRoundTrip;
+	statistics->avgRoundTrip = (TimeCount)
+			((sint32) statistics->avgRoundTrip + diff / 8);
+	if (diff < 0)
+		diff = -diff;
+	statistics->roundTripJitter = (TimeCount)
+			((sint32) statistics->roundTripJitter +
+			(diff - (sint32) statistics->roundTripJitter) / 4);
+
+	statistics->lastRoundTrip = roundTrip;
+}
+#endif  /* NETPLAY_STATISTICS */
+
+// Notes the round trip time of the ping with this id. Returns false if
+// it is not the last ping sent.
+bool
+NetConnection_pingAcked(NetConnection *conn, uint32 id) {
+	TimeCount roundTrip;
+
+	if (id == 0 || id != conn->pingId)
+		return false;
+
+	roundTrip = GetTimeCounter() - conn->pingSentTime;
+	if (conn->numRoundTrips < NETPLAY_PING_COUNT &&
+			roundTrip > conn->roundTripTime)
+		conn->roundTripTime = roundTrip;
+	conn->numRoundTrips++;
+	conn->pingOutstanding = false;
+#ifdef NETPLAY_STATISTICS
+	NetStatistics_addRoundTrip(&conn->statistics, roundTrip);
+#endif
+	return true;
+}
+
+// Returns whether a new ping can be sent, 'interval' after the last one.
+// Only one ping is sent at a time.
+bool
+NetConnection_pingDue(const NetConnection *conn, TimeCount interval) {
+	return !conn->pingOutstanding &&
+			GetTimeCounter() - conn->pingSentTime >= interval;
+}
+
+// The longest round trip measured; 0 if none was.
+TimeCount
+NetConnection_getRoundTripTime(const NetConnection *conn) {
+	return conn->roundTripTime;
+}
+
+size_t
+NetConnection_getNumRoundTrips(const NetConnection *conn) {
+	return conn->numRoundTrips;
+}
+
 #ifdef NETPLAY_CHECKSUM
 ChecksumBuffer *
 NetConnection_getChecksumBuffer(NetConnection *conn) {
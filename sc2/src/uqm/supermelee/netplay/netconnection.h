@@ -31,6 +31,7 @@ typedef struct NetConnectionError NetConnectionError;
 typedef struct ConnectStateData ConnectStateData;
 #ifdef NETPLAY_STATISTICS
 typedef struct NetStatistics NetStatistics;
+typedef struct NetBattleStatistics NetBattleStatistics;
 #endif
 
 typedef void (*NetConnection_ConnectCallback)(NetConnection *nd);
@@ -48,6 +49,7 @@ typedef void (*NetConnection_ResetCallback)(NetConnection *conn, void *arg);
 
 #include "netstate.h"
 #include "netoptions.h"
+#include "libs/timelib.h"
 #ifdef NETPLAY_CHECKSUM
 #	include "checkbuf.h"
 #endif
@@ -72,11 +74,41 @@ struct NetConnectionError {
 };
 
 #ifdef NETPLAY_STATISTICS
+struct NetBattleStatistics {
+	TimeCount startTime;
+	size_t packetsReceived;
+	size_t packetsSent;
+	size_t bytesReceived;
+	size_t bytesSent;
+			// The totals of NetStatistics when the battle started.
+	size_t stalls;
+			// Number of frames on which the battle had to wait for the
+			// input of the other side.
+	TimeCount stallTime;
+			// The time spent waiting, in total.
+	TimeCount longestStall;
+	size_t minInputSlack;
+			// The fewest number of frames the input arrived before it
+			// was needed. (size_t) -1 if no input was used yet.
+};
+
 struct NetStatistics {
 	size_t packetsReceived;
 	size_t packetTypeReceived[PACKET_NUM];
 	size_t packetsSent;
 	size_t packetTypeSent[PACKET_NUM];
+	size_t bytesReceived;
+	size_t bytesSent;
+
+	TimeCount lastRoundTrip;
+			// 0 if no round trip was measured yet.
+	TimeCount minRoundTrip;
+	TimeCount avgRoundTrip;
+	TimeCount roundTripJitter;
+			// The smoothed round trip time and its smoothed deviation,
+			// the way TCP keeps them (SRTT and RTTVAR of RFC 6298).
+
+	NetBattleStatistics battle;
 };
 #endif
 
@@ -167,12 +199,27 @@ struct NetConnection {
 
 	const NetplayPeerOptions *options;
 	PacketQueue queue;
+	uint32 pingId;
+			// Id of the last ping sent; 0 if none was sent.
+	TimeCount pingSentTime;
+			// When it was sent.
+	bool pingOutstanding;
+			// The last ping sent has not been acknowledged yet.
+	TimeCount roundTripTime;
+			// Longest round trip of the first NETPLAY_PING_COUNT pings.
+	size_t numRoundTrips;
+			// Number of pings acknowledged so far.
 #ifdef NETPLAY_STATISTICS
 	NetStatistics statistics;
 #endif
 #ifdef NETPLAY_CHECKSUM
 	ChecksumBuffer checksumBuffer;
 #endif
+#ifdef NETPLAY_UDP
+	struct UdpChannel *udp;
+			// For sending the battle input over UDP too; NULL if
+			// it only goes over TCP.
+#endif
 #if defined(NETPLAY_DEBUG) && defined(NETPLAY_DEBUG_FILE)
 	uio_Stream *debugFile;
 #endif
@@ -226,6 +273,11 @@ const NetplayPeerOptions *NetConnection_getPeerOptions(
 		const NetConnection *conn);
 int NetConnection_getPlayerNr(const NetConnection *conn);
 size_t NetConnection_getInputDelay(const NetConnection *conn);
+uint32 NetConnection_newPing(NetConnection *conn);
+bool NetConnection_pingAcked(NetConnection *conn, uint32 id);
+bool NetConnection_pingDue(const NetConnection *conn, TimeCount interval);
+TimeCount NetConnection_getRoundTripTime(const NetConnection *conn);
+size_t NetConnection_getNumRoundTrips(const NetConnection *conn);
 #ifdef NETPLAY_CHECKSUM
 ChecksumBuffer *NetConnection_getChecksumBuffer(NetConnection *conn);
 size_t NetConnection_getChecksumInterval(const NetConnection *conn);
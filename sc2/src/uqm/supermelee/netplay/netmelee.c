@@ -26,12 +26,18 @@
 #include "netinput.h"
 #include "netmisc.h"
 #include "netsend.h"
+#ifdef NETPLAY_UDP
+#	include "netudp.h"
+#endif
 #include "notify.h"
 #include "packetq.h"
+#include "packetsenders.h"
 #include "proto/npconfirm.h"
 #include "proto/ready.h"
 #include "proto/reset.h"
 
+#include "../../battle.h"
+		// for battleFrameCount
 #include "../../battlecontrols.h"
 		// for NetworkInputContext
 #include "../../controls.h"
@@ -284,6 +290,25 @@ initBattleStateDataConnections(void) {
 		battleStateData =
 				(BattleStateData *) NetConnection_getStateData(conn);
 		battleStateData->endFrameCount = 0;
+#ifdef NETPLAY_UDP
+		initUdpBattle(conn);
+#endif
+#ifdef NETPLAY_STATISTICS
+		{
+			NetStatistics *statistics = NetConnection_getStatistics(conn);
+			NetBattleStatistics *battle = &statistics->battle;
+
+			battle->startTime = GetTimeCounter();
+			battle->packetsReceived = statistics->packetsReceived;
+			battle->packetsSent = statistics->packetsSent;
+			battle->bytesReceived = statistics->bytesReceived;
+			battle->bytesSent = statistics->bytesSent;
+			battle->stalls = 0;
+			battle->stallTime = 0;
+			battle->longestStall = 0;
+			battle->minInputSlack = (size_t) -1;
+		}
+#endif
 	}
 }
 
@@ -304,13 +329,46 @@ setBattleStateConnections(struct battlestate_struct *bs) {
 	}
 }
 
+#ifdef NETPLAY_STATISTICS
+// Notes how long the input for this frame took to arrive. 'slack' is the
+// number of frames of input there were beyond the one needed, 'stall' the
+// time spent waiting for it.
+static void
+noteBattleInput(NetConnection *conn, size_t slack, TimeCount stall) {
+	NetBattleStatistics *battle = &NetConnection_getStatistics(conn)->battle;
+
+	if (slack < battle->minInputSlack)
+		battle->minInputSlack = slack;
+
+	if (stall == 0)
+		return;
+	battle->stalls++;
+	battle->stallTime += stall;
+	if (stall > battle->longestStall)
+		battle->longestStall = stall;
+}
+#endif  /* NETPLAY_STATISTICS */
+
 BATTLE_INPUT_STATE
 networkBattleInput(NetworkInputContext *context, STARSHIP *StarShipPtr) {
 	BattleInputBuffer *bib = getBattleInputBuffer(context->playerNr);
 	BATTLE_INPUT_STATE result;
+#ifdef NETPLAY_STATISTICS
+	NetConnection *conn = netConnections[context->playerNr];
+	bool stalled = false;
+	TimeCount stallStart = 0;
+
+	// Keep measuring the round trip time during the battle.
+	if (conn != NULL && NetConnection_isConnected(conn) &&
+			NetConnection_pingDue(conn, NETPLAY_BATTLE_PING_INTERVAL))
+		sendPing(conn, NetConnection_newPing(conn));
+#endif
 	
 	for (;;) {
 		bool ok;
+#ifdef NETPLAY_STATISTICS
+		size_t available = bib->size;
+#endif
 		
 #if 0
 		// This is a useful debugging trick. By enabling this #if
@@ -328,8 +386,20 @@ networkBattleInput(NetworkInputContext *context, STARSHIP *StarShipPtr) {
 			ok = BattleInputBuffer_pop(bib, &result);
 					// Get the input from the front of the
 					// buffer.
-		if (ok)
+		if (ok) {
+#ifdef NETPLAY_STATISTICS
+			noteBattleInput(conn, available - 1,
+					stalled ? GetTimeCounter() - stallStart : 0);
+#endif
 			break;
+		}
+
+#ifdef NETPLAY_STATISTICS
+		if (!stalled) {
+			stalled = true;
+			stallStart = GetTimeCounter();
+		}
+#endif
 			
 		{
 			NetConnection *conn = netConnections[context->playerNr];
@@ -395,6 +465,153 @@ closePlayerNetworkConnection(COUNT player) {
 	NetConnection_close(netConnections[player]);
 }
 
+// Frames of input delay needed to cover a round trip: half of it,
+// rounding up, plus one for the frame processing the input.
+static size_t
+roundTripFrames(TimeCount roundTrip) {
+	size_t delay = (roundTrip / 2 + BATTLE_FRAME_RATE - 1) / BATTLE_FRAME_RATE
+			+ 1;
+	if (delay > BATTLE_FRAME_RATE)
+		delay = BATTLE_FRAME_RATE;
+			// The most the other side accepts.
+	return delay;
+}
+
+// The round trip time the input delay for a connection should cover,
+// or 0 if nothing is measured (yet).
+static TimeCount
+connectionRoundTrip(NetConnection *conn) {
+	TimeCount roundTrip = NetConnection_getRoundTripTime(conn);
+#ifdef NETPLAY_STATISTICS
+	const NetStatistics *statistics = NetConnection_getStatistics(conn);
+
+	// The pings sent during earlier battles give a smoothed round trip
+	// time and its variation. Like a TCP retransmit timer, four times
+	// the variation on top of the average covers nearly all round trips.
+	if (statistics->lastRoundTrip != 0) {
+		TimeCount estimate = statistics->avgRoundTrip +
+				4 * statistics->roundTripJitter;
+		if (estimate > roundTrip)
+			roundTrip = estimate;
+	}
+#endif
+	return roundTrip;
+}
+
+// The input delay to propose to the other side: the local one, or
+// more if that does not cover the round trips measured on a connection.
+// Input is sent the frame it is made, and used 'delay' frames later on
+// both sides, so the delay must cover the time it takes to get to the
+// other side, half of the round trip, or the other side stalls.
+size_t
+roundTripInputDelay(size_t localInputDelay) {
+	COUNT player;
+	size_t inputDelay = localInputDelay;
+
+	for (player = 0; player < NUM_PLAYERS; player++)
+	{
+		NetConnection *conn = netConnections[player];
+		TimeCount roundTrip;
+		size_t delay;
+
+		if (conn == NULL || !NetConnection_isConnected(conn))
+			continue;
+
+		roundTrip = connectionRoundTrip(conn);
+		if (roundTrip == 0)
+			continue;
+				// Nothing measured (yet).
+
+		delay = roundTripFrames(roundTrip);
+		if (delay > inputDelay)
+		{
+			log_add(log_Info, "NETPLAY: [%d]     Round trip time %u ms; "
+					"input delay raised from %u to %u frames.", player,
+					(unsigned int) (roundTrip * 1000 / ONE_SECOND),
+					(unsigned int) localInputDelay, (unsigned int) delay);
+			inputDelay = delay;
+		}
+	}
+
+	return inputDelay;
+}
+
+#ifdef NETPLAY_STATISTICS
+static unsigned int
+ticksToMs(TimeCount ticks) {
+	return (unsigned int) (ticks * 1000 / ONE_SECOND);
+}
+
+// Per second over 'duration' ticks.
+static unsigned long
+perSecond(size_t count, TimeCount duration) {
+	if (duration == 0)
+		return 0;
+	return (unsigned long) ((double) count * ONE_SECOND / duration);
+}
+
+// Logs what was measured on the connections during the battle that just
+// ended.
+void
+logBattleStatistics(void) {
+	COUNT player;
+
+	for (player = 0; player < NUM_PLAYERS; player++)
+	{
+		NetConnection *conn = netConnections[player];
+		const NetStatistics *statistics;
+		const NetBattleStatistics *battle;
+		TimeCount duration;
+		TimeCount roundTrip;
+
+		if (conn == NULL)
+			continue;
+
+		statistics = NetConnection_getStatistics(conn);
+		battle = &statistics->battle;
+		duration = GetTimeCounter() - battle->startTime;
+
+		log_add(log_Info, "NETPLAY: [%d]     Battle of %u frames in %u ms.",
+				player, (unsigned int) battleFrameCount,
+				ticksToMs(duration));
+		if (statistics->lastRoundTrip != 0) {
+			log_add(log_Info, "NETPLAY: [%d]     Round trip time %u ms "
+					"(min %u ms, jitter %u ms).", player,
+					ticksToMs(statistics->avgRoundTrip),
+					ticksToMs(statistics->minRoundTrip),
+					ticksToMs(statistics->roundTripJitter));
+		}
+		if (battle->minInputSlack != (size_t) -1) {
+			log_add(log_Info, "NETPLAY: [%d]     Input arrived at least %u "
+					"frames early.", player,
+					(unsigned int) battle->minInputSlack);
+		}
+		log_add(log_Info, "NETPLAY: [%d]     Stalled %u times waiting for "
+				"input, %u ms in total, %u ms at most.", player,
+				(unsigned int) battle->stalls, ticksToMs(battle->stallTime),
+				ticksToMs(battle->longestStall));
+		log_add(log_Info, "NETPLAY: [%d]     Received %lu packets/s, "
+				"%lu bytes/s; sent %lu packets/s, %lu bytes/s.", player,
+				perSecond(statistics->packetsReceived -
+					battle->packetsReceived, duration),
+				perSecond(statistics->bytesReceived -
+					battle->bytesReceived, duration),
+				perSecond(statistics->packetsSent -
+					battle->packetsSent, duration),
+				perSecond(statistics->bytesSent -
+					battle->bytesSent, duration));
+
+		roundTrip = connectionRoundTrip(conn);
+		if (roundTrip != 0) {
+			log_add(log_Info, "NETPLAY: [%d]     Input delay %u frames; "
+					"the round trips suggest %u.", player,
+					(unsigned int) getBattleInputDelay(),
+					(unsigned int) roundTripFrames(roundTrip));
+		}
+	}
+}
+#endif  /* NETPLAY_STATISTICS */
+
 bool
 setupInputDelay(size_t localInputDelay) {
 	COUNT player;
@@ -68,6 +68,10 @@ BATTLE_INPUT_STATE networkBattleInput(NetworkInputContext *context,
 NetConnection *openPlayerNetworkConnection(COUNT player, void *extra);
 void closePlayerNetworkConnection(COUNT player);
 
+size_t roundTripInputDelay(size_t localInputDelay);
+#ifdef NETPLAY_STATISTICS
+void logBattleStatistics(void);
+#endif
 bool setupInputDelay(size_t localInputDelay);
 bool setStateConnections(NetState state);
 bool sendAbortConnections(NetplayAbortReason reason);
@@ -127,6 +127,9 @@ NetMelee_enterState_inSetup(NetConnection *conn, void *arg) {
 	assert (NUM_PLAYERS == 2);
 	Melee_bootstrapSyncTeam (meleeState, player);
 
+	// Start measuring the round trip time, for the input delay.
+	sendPing(conn, NetConnection_newPing(conn));
+
 	flushPacketQueues();
 
 	(void) arg;
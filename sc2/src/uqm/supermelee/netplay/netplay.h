@@ -46,8 +46,54 @@
 #define NETPLAY_CHECKSUM_INTERVAL 1
 		/* If NETPLAY_CHECKSUM is defined, this define determines
 		 * every how many frames a checksum packet is sent. */
+#define NETPLAY_DESYNC_FRAMES 16
+		/* If NETPLAY_CHECKSUM is defined, the checksummed state of each
+		 * element is kept for this many frames (on top of the input
+		 * delay). When the checksums of both sides differ, it is written
+		 * to "netplay-desync-<time>.txt" in the config dir. Comparing the
+		 * files of both sides shows the first frame and element that
+		 * differ. Undefine to not keep it. */
+
+#define NETPLAY_PING_COUNT 8
+		/* Number of pings sent one after the other after connecting, to
+		 * measure the round trip time of the connection. The input delay
+		 * for a battle is made long enough to cover the longest of them. */
+#define NETPLAY_BATTLE_PING_INTERVAL ONE_SECOND
+		/* If NETPLAY_STATISTICS is defined, a ping is sent this often
+		 * during a battle, to follow the round trip time and its jitter.
+		 * In TimeCount ticks. */
+
+#define NETPLAY_UDP
+		/* During a battle, also send the battle input in UDP datagrams,
+		 * next to the TCP packets, so that one lost TCP segment does not
+		 * hold up all the input after it. Whichever copy arrives first
+		 * is used. If no UDP gets through, the TCP packets do. */
+#define NETPLAY_UDP_REDUNDANCY 8
+		/* If NETPLAY_UDP is defined, each datagram carries the input of
+		 * up to this many frames that the other side has not
+		 * acknowledged yet. */
+
+#define NETPLAY_SPECTATE
+		/* Allow others to watch the SuperMelee battles over the
+		 * network. The recording of each battle (see replay.h) is
+		 * streamed to them as it is made, and they play it back. */
+#define NETPLAY_SPECTATE_PORT "21838"
+		/* Default port to serve and watch battles on. */
+#define NETPLAY_SPECTATE_DELAY 48
+		/* Default number of frames a spectator stays behind, to
+		 * smooth out the arrival of the stream. */
+#define NETPLAY_SPECTATE_MAX 16
+		/* Maximum number of spectators served at once, by a player
+		 * or by a spectator that passes the stream on. */
+#define NETPLAY_SPECTATE_BACKLOG 65536
+		/* A spectator is dropped when this many bytes for it are
+		 * waiting to be sent, so that a slow one does not hold up
+		 * the game. */
 
 #define NETPLAY_READBUFSIZE  2048
+#define NETPLAY_SENDBUFSIZE  2048
+		/* Queued packets are gathered in a buffer of this size, to send
+		 * them with one send() call. */
 #define NETPLAY_CONNECTTIMEOUT  2000
 		/* Time to wait for a connect() to succeed. In ms. */
 //#define NETPLAY_LISTENTIMEOUT   30000
@@ -73,6 +73,7 @@ dataReceivedSingle(NetConnection *conn, const uint8 *data,
 #ifdef NETPLAY_STATISTICS
 	NetConnection_getStatistics(conn)->packetsReceived++;
 	NetConnection_getStatistics(conn)->packetTypeReceived[type]++;
+	NetConnection_getStatistics(conn)->bytesReceived += packetLen;
 #endif
 
 #ifdef NETPLAY_DEBUG
@@ -32,14 +32,8 @@
 #include <string.h>
 
 
-int
-sendPacket(NetConnection *conn, Packet *packet) {
-	ssize_t sendResult;
-	size_t len;
-	Socket *socket;
-		
-	assert(NetConnection_isConnected(conn));
-
+static void
+logSendPacket(NetConnection *conn, Packet *packet) {
 #ifdef NETPLAY_DEBUG
 	//if (packetType(packet) != PACKET_BATTLEINPUT && 
 	//		packetType(packet) != PACKET_CHECKSUM) {
@@ -56,13 +50,16 @@ sendPacket(NetConnection *conn, Packet *packet) {
 	}
 #endif  /* NETPLAY_DEBUG_FILE */
 #endif  /* NETPLAY_DEBUG */
+}
 
-	socket = NetDescriptor_getSocket(conn->nd);
+static int
+sendData(Socket *socket, const uint8 *data, size_t len) {
+	ssize_t sendResult;
 
-	len = packetLength(packet);
 	while (len > 0) {
-		sendResult = Socket_send(socket, (void *) packet, len, 0);
+		sendResult = Socket_send(socket, (const void *) data, len, 0);
 		if (sendResult >= 0) {
+			data += sendResult;
 			len -= sendResult;
 			continue;
 		}
@@ -83,13 +80,68 @@ sendPacket(NetConnection *conn, Packet *packet) {
 			}
 		}
 	}
+	return 0;
+}
+
+// The packets are gathered into one buffer, so that a frame's worth of
+// packets takes one send() and not one each. Only packets that do not fit
+// in the buffer are sent on their own.
+// If an error occurs, it is not known which of the packets have been sent.
+int
+sendPackets(NetConnection *conn, Packet *const *packets, size_t count) {
+	uint8 buf[NETPLAY_SENDBUFSIZE];
+	size_t bufLen = 0;
+	size_t i;
+	Socket *socket;
+
+	assert(NetConnection_isConnected(conn));
+
+	socket = NetDescriptor_getSocket(conn->nd);
+
+	for (i = 0; i < count; i++) {
+		size_t len = packetLength(packets[i]);
+
+		logSendPacket(conn, packets[i]);
+
+		if (bufLen + len > sizeof buf) {
+			if (bufLen > 0 && sendData(socket, buf, bufLen) == -1) {
+				// errno is set
+				return -1;
+			}
+			bufLen = 0;
+		}
+
+		if (len > sizeof buf) {
+			if (sendData(socket, (const uint8 *) packets[i], len) == -1) {
+				// errno is set
+				return -1;
+			}
+		} else {
+			memcpy(buf + bufLen, packets[i], len);
+			bufLen += len;
+		}
+	}
+
+	if (bufLen > 0 && sendData(socket, buf, bufLen) == -1) {
+		// errno is set
+		return -1;
+	}
 
 #ifdef NETPLAY_STATISTICS
-	NetConnection_getStatistics(conn)->packetsSent++;
-	NetConnection_getStatistics(conn)->packetTypeSent[packetType(packet)]++;
+	for (i = 0; i < count; i++) {
+		NetConnection_getStatistics(conn)->packetsSent++;
+		NetConnection_getStatistics(conn)->packetTypeSent[
+				packetType(packets[i])]++;
+		NetConnection_getStatistics(conn)->bytesSent +=
+				packetLength(packets[i]);
+	}
 #endif
 
 	return 0;
 }
 
+int
+sendPacket(NetConnection *conn, Packet *packet) {
+	return sendPackets(conn, &packet, 1);
+}
 
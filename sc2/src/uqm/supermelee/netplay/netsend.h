@@ -26,6 +26,7 @@ extern "C" {
 #endif
 
 int sendPacket(NetConnection *conn, Packet *packet);
+int sendPackets(NetConnection *conn, Packet *const *packets, size_t count);
 
 
 #if defined(__cplusplus)
@@ -0,0 +1,370 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// The battle input is sent over UDP as well as over TCP. Over TCP, one
+// lost segment holds up everything sent after it until it is resent;
+// the UDP datagrams get through past it. Each datagram holds the input
+// of the last frames the other side has not acknowledged yet (up to
+// NETPLAY_UDP_REDUNDANCY), so losing a datagram costs nothing as long as
+// a later one arrives in time. The TCP packets are still sent, so the
+// battle can go on when no UDP gets through at all (a firewall, or a
+// remote side that does not do UDP); each input is used from whichever
+// copy arrives first.
+//
+// Each side binds its UDP socket to the same address and port as its
+// end of the TCP connection, and sends to the other end's. When a
+// datagram arrives from the right host but from another port (NAT),
+// the replies go to that port from then on.
+//
+// A datagram (all 32 bits values in network byte order):
+//     magic, battle id, number of the first input in it, number of
+//     inputs received from the other side (the ack), count (8 bits),
+//     then count inputs of 8 bits each.
+// The inputs of a battle are numbered from 0, for both TCP and UDP, so
+// the number of the last input in a datagram doubles as its sequence
+// number. The battle id is taken from the random seed when the battle is
+// set up, which both sides agree on, so that stray datagrams from an
+// earlier battle are not taken for this one.
+// The ack is the number of inputs received in sequence; inputs that
+// arrive out of order are not kept (a later datagram or the TCP packet
+// will bring them again), so there is nothing a bitfield of the inputs
+// after it would add.
+
+#define PORT_WANT_ERRNO
+#define NETCONNECTION_INTERNAL
+#include "netplay.h"
+#include "port.h"
+
+#ifdef NETPLAY_UDP
+
+#include "netudp.h"
+#include "netconnection.h"
+#include "netinput.h"
+#include "libs/log.h"
+#include "libs/mathlib.h"
+		// for TFB_SeedRandom()
+#include "libs/network/bytesex.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef USE_WINSOCK
+#	include <winsock2.h>
+#	include <ws2tcpip.h>
+#else
+#	include <sys/socket.h>
+#	include <netinet/in.h>
+#endif
+
+#define UDP_MAGIC 0x55514d49
+		// "UQMI"
+#define UDP_HEADER_SIZE (4 * 4 + 1)
+#define UDP_MAX_DATAGRAM (UDP_HEADER_SIZE + NETPLAY_UDP_REDUNDANCY)
+
+struct UdpChannel {
+	NetDescriptor *nd;
+	struct sockaddr_storage peerAddr;
+	SOCKLEN_T peerAddrLen;
+
+	uint32 battleId;
+	bool inBattle;
+			// initUdpBattle() has been called for the current battle.
+	uint32 numSent;
+			// Number of inputs sent this battle.
+	BATTLE_INPUT_STATE sent[NETPLAY_UDP_REDUNDANCY];
+			// The last inputs sent; input i is at i % NETPLAY_UDP_REDUNDANCY.
+	uint32 numAcked;
+			// Number of inputs the other side has acknowledged.
+	uint32 numReceived;
+			// Number of inputs from the other side put in the battle input
+			// buffer, from either the datagrams or the TCP packets.
+	uint32 numTcpReceived;
+			// Number of BattleInput packets received over TCP.
+};
+
+static inline uint32
+getUint32(const uint8 *buf) {
+	uint32 val;
+	memcpy(&val, buf, sizeof val);
+	return ntoh32(val);
+}
+
+static inline void
+putUint32(uint8 *buf, uint32 val) {
+	val = hton32(val);
+	memcpy(buf, &val, sizeof val);
+}
+
+// Whether the two addresses are of the same host; the ports may differ.
+static bool
+sameHost(const struct sockaddr *a, const struct sockaddr *b) {
+	if (a->sa_family != b->sa_family)
+		return false;
+
+	switch (a->sa_family) {
+		case AF_INET:
+			return memcmp(&((const struct sockaddr_in *) a)->sin_addr,
+					&((const struct sockaddr_in *) b)->sin_addr,
+					sizeof (struct in_addr)) == 0;
+#if NETPLAY == NETPLAY_FULL
+		case AF_INET6:
+			return memcmp(&((const struct sockaddr_in6 *) a)->sin6_addr,
+					&((const struct sockaddr_in6 *) b)->sin6_addr,
+					sizeof (struct in6_addr)) == 0;
+#endif
+		default:
+			return false;
+	}
+}
+
+// Puts the inputs from the datagram that are next in sequence in the
+// battle input buffer.
+static void
+udpInputReceived(NetConnection *conn, const uint8 *data, size_t len) {
+	UdpChannel *udp = conn->udp;
+	uint32 first;
+	uint32 ack;
+	size_t count;
+	size_t i;
+	BattleInputBuffer *bib;
+
+	if (len < UDP_HEADER_SIZE || getUint32(data) != UDP_MAGIC)
+		return;
+	count = data[16];
+	if (len < UDP_HEADER_SIZE + count)
+		return;
+	if (!udp->inBattle || getUint32(data + 4) != udp->battleId)
+		return;  // Not of this battle.
+	if (conn->stateFlags.reset.localReset ||
+			conn->stateFlags.reset.remoteReset ||
+			!NetState_battleActive(conn->state))
+		return;
+
+	first = getUint32(data + 8);
+	ack = getUint32(data + 12);
+	if (ack > udp->numAcked && ack <= udp->numSent)
+		udp->numAcked = ack;
+
+	if (first > udp->numReceived)
+		return;  // A gap; wait for it to be filled in.
+
+	bib = getBattleInputBuffer(conn->player);
+	for (i = udp->numReceived - first; i < count; i++) {
+		if (!BattleInputBuffer_push(bib,
+				(BATTLE_INPUT_STATE) data[UDP_HEADER_SIZE + i]))
+			return;  // Leave it to the TCP packet to report this.
+		udp->numReceived++;
+	}
+}
+
+static void
+udpDataReadyCallback(NetDescriptor *nd) {
+	NetConnection *conn = (NetConnection *) NetDescriptor_getExtra(nd);
+	Socket *socket = NetDescriptor_getSocket(nd);
+	UdpChannel *udp = conn->udp;
+
+	for (;;) {
+		uint8 buf[UDP_MAX_DATAGRAM];
+		struct sockaddr_storage from;
+		socklen_t fromLen = sizeof from;
+		ssize_t numRead;
+
+		numRead = Socket_recvfrom(socket, buf, sizeof buf, 0,
+				(struct sockaddr *) &from, &fromLen);
+		if (numRead == -1) {
+			if (errno == EINTR)
+				continue;  // System call was interrupted. Retry.
+			return;
+					// No more data for now (EAGAIN), or an error, such as
+					// ECONNREFUSED when the other side has no UDP socket.
+					// Either way, the TCP packets will do.
+		}
+
+		if (!sameHost((const struct sockaddr *) &from,
+				(const struct sockaddr *) &udp->peerAddr))
+			continue;
+
+		if (fromLen != udp->peerAddrLen ||
+				memcmp(&from, &udp->peerAddr, fromLen) != 0) {
+			// The other side is behind a NAT; reply to where it sends
+			// from.
+			memcpy(&udp->peerAddr, &from, fromLen);
+			udp->peerAddrLen = fromLen;
+		}
+
+		udpInputReceived(conn, buf, (size_t) numRead);
+	}
+}
+
+// Called when the TCP connection has been established. If no UDP socket
+// can be set up, the battle input just goes over TCP only.
+void
+openUdpChannel(NetConnection *conn, const struct sockaddr *peerAddr,
+		SOCKLEN_T peerAddrLen) {
+	struct sockaddr_storage localAddr;
+	socklen_t localAddrLen = sizeof localAddr;
+	ProtocolFamily family;
+	Socket *socket;
+	UdpChannel *udp;
+
+	assert(conn->udp == NULL);
+
+	if (peerAddrLen > sizeof udp->peerAddr)
+		return;
+
+	if (Socket_getLocalAddr(NetDescriptor_getSocket(conn->nd),
+			(struct sockaddr *) &localAddr, &localAddrLen) == -1)
+		return;
+	switch (localAddr.ss_family) {
+		case AF_INET:
+			family = PF_inet;
+			break;
+#if NETPLAY == NETPLAY_FULL
+		case AF_INET6:
+			family = PF_inet6;
+			break;
+#endif
+		default:
+			return;
+	}
+
+	socket = Socket_open(family, Sock_dgram, IPProto_udp);
+	if (socket == Socket_noSocket)
+		return;
+	if (Socket_setNonBlocking(socket) == -1 ||
+			Socket_bind(socket, (struct sockaddr *) &localAddr,
+			localAddrLen) == -1) {
+		log_add(log_Debug, "NETPLAY: [%d] Could not set up a UDP socket: "
+				"%s; sending the battle input over TCP only.",
+				conn->player, strerror(errno));
+		(void) Socket_close(socket);
+		return;
+	}
+
+	udp = malloc(sizeof (UdpChannel));
+	udp->nd = NetDescriptor_new(socket, (void *) conn);
+	if (udp->nd == NULL) {
+		(void) Socket_close(socket);
+		free(udp);
+		return;
+	}
+	memcpy(&udp->peerAddr, peerAddr, peerAddrLen);
+	udp->peerAddrLen = peerAddrLen;
+	udp->battleId = 0;
+	udp->inBattle = false;
+	udp->numSent = 0;
+	udp->numAcked = 0;
+	udp->numReceived = 0;
+	udp->numTcpReceived = 0;
+
+	conn->udp = udp;
+	NetDescriptor_setReadCallback(udp->nd, udpDataReadyCallback);
+}
+
+void
+closeUdpChannel(NetConnection *conn) {
+	UdpChannel *udp = conn->udp;
+
+	if (udp == NULL)
+		return;
+
+	NetDescriptor_setReadCallback(udp->nd, NULL);
+	NetDescriptor_close(udp->nd);
+	free(udp);
+	conn->udp = NULL;
+}
+
+bool
+usesUdpChannel(const NetConnection *conn) {
+	return conn->udp != NULL;
+}
+
+// Call for each battle, when both sides have the same random seed, before
+// any input is sent.
+void
+initUdpBattle(NetConnection *conn) {
+	UdpChannel *udp = conn->udp;
+	DWORD seed;
+
+	if (udp == NULL)
+		return;
+
+	seed = TFB_SeedRandom(0);
+	TFB_SeedRandom(seed);
+			// Restore the old seed.
+
+	udp->battleId = (uint32) seed;
+	udp->inBattle = true;
+	udp->numSent = 0;
+	udp->numAcked = 0;
+	udp->numReceived = 0;
+	udp->numTcpReceived = 0;
+}
+
+// Call for each input sent over TCP, in the same order.
+void
+sendUdpBattleInput(NetConnection *conn, BATTLE_INPUT_STATE input) {
+	UdpChannel *udp = conn->udp;
+	uint8 buf[UDP_MAX_DATAGRAM];
+	uint32 first;
+	uint32 i;
+	size_t count;
+
+	if (udp == NULL || !udp->inBattle)
+		return;
+
+	udp->sent[udp->numSent % NETPLAY_UDP_REDUNDANCY] = input;
+	udp->numSent++;
+
+	first = udp->numAcked;
+	if (udp->numSent - first > NETPLAY_UDP_REDUNDANCY)
+		first = udp->numSent - NETPLAY_UDP_REDUNDANCY;
+	count = udp->numSent - first;
+
+	putUint32(buf, UDP_MAGIC);
+	putUint32(buf + 4, udp->battleId);
+	putUint32(buf + 8, first);
+	putUint32(buf + 12, udp->numReceived);
+	buf[16] = (uint8) count;
+	for (i = 0; i < count; i++)
+		buf[UDP_HEADER_SIZE + i] =
+				udp->sent[(first + i) % NETPLAY_UDP_REDUNDANCY];
+
+	(void) Socket_sendto(NetDescriptor_getSocket(udp->nd), buf,
+			UDP_HEADER_SIZE + count, 0,
+			(const struct sockaddr *) &udp->peerAddr, udp->peerAddrLen);
+			// Errors are ignored; the TCP packet is sent too.
+}
+
+// Call for each BattleInput packet received over TCP. Returns whether its
+// input is to be used, that is, whether it did not arrive over UDP
+// already.
+bool
+takeTcpBattleInput(NetConnection *conn) {
+	UdpChannel *udp = conn->udp;
+
+	if (udp == NULL || !udp->inBattle)
+		return true;
+
+	udp->numTcpReceived++;
+	if (udp->numTcpReceived <= udp->numReceived)
+		return false;
+
+	udp->numReceived++;
+	return true;
+}
+
+#endif  /* NETPLAY_UDP */
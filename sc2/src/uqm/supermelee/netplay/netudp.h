@@ -0,0 +1,50 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UQM_SUPERMELEE_NETPLAY_NETUDP_H_
+#define UQM_SUPERMELEE_NETPLAY_NETUDP_H_
+
+#include "netplay.h"
+
+#ifdef NETPLAY_UDP
+
+#include "netconnection.h"
+#include "../../controls.h"
+		// for BATTLE_INPUT_STATE
+#include "libs/net.h"
+		// for SOCKLEN_T
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct UdpChannel UdpChannel;
+
+void openUdpChannel(NetConnection *conn, const struct sockaddr *peerAddr,
+		SOCKLEN_T peerAddrLen);
+void closeUdpChannel(NetConnection *conn);
+bool usesUdpChannel(const NetConnection *conn);
+void initUdpBattle(NetConnection *conn);
+void sendUdpBattleInput(NetConnection *conn, BATTLE_INPUT_STATE input);
+bool takeTcpBattleInput(NetConnection *conn);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* NETPLAY_UDP */
+
+#endif  /* UQM_SUPERMELEE_NETPLAY_NETUDP_H_ */
@@ -24,6 +24,9 @@
 #include "notify.h"
 
 #include "packetsenders.h"
+#ifdef NETPLAY_UDP
+#	include "netudp.h"
+#endif
 
 
 // Convert a local player number to a side indication relative to this
@@ -50,6 +53,9 @@ Netplay_Notify_battleInput(NetConnection *conn, BATTLE_INPUT_STATE input) {
 			NetConnection_getState(conn) == NetState_endingBattle2);
 
 	sendBattleInput(conn, input);
+#ifdef NETPLAY_UDP
+	sendUdpBattleInput(conn, input);
+#endif
 }
 
 void
@@ -56,9 +56,38 @@ PacketTypeData packetTypeData[PACKET_NUM] = {
 	DEFINE_PACKETDATA(Reset),
 };
 
+#define PACKET_POOL_BUFSIZE 16
+		// Packets up to this size are allocated in buffers of this size,
+		// which are kept for reuse when the packet is deleted. All
+		// packets sent during a battle fit.
+#define PACKET_POOL_MAX 64
+		// Maximum number of free buffers kept. They are kept until the
+		// program exits.
+
+typedef union PooledPacket PooledPacket;
+union PooledPacket {
+	PooledPacket *next;
+			// When in the pool
+	uint32 data[PACKET_POOL_BUFSIZE / 4];
+};
+
+static PooledPacket *packetPool;
+static size_t packetPoolSize;
+
 static inline void *
 Packet_alloc(size_t size) {
-	return malloc(size);
+	PooledPacket *pooled;
+
+	if (size > PACKET_POOL_BUFSIZE)
+		return malloc(size);
+
+	if (packetPool == NULL)
+		return malloc(sizeof (PooledPacket));
+
+	pooled = packetPool;
+	packetPool = pooled->next;
+	packetPoolSize--;
+	return pooled;
 }
 
 static Packet *
@@ -78,7 +107,18 @@ Packet_create(PacketType type, size_t extraSize) {
 
 void
 Packet_delete(Packet *packet) {
-	free(packet);
+	PooledPacket *pooled;
+
+	if (packetLength(packet) > PACKET_POOL_BUFSIZE ||
+			packetPoolSize >= PACKET_POOL_MAX) {
+		free(packet);
+		return;
+	}
+
+	pooled = (PooledPacket *) packet;
+	pooled->next = packetPool;
+	packetPool = pooled;
+	packetPoolSize++;
 }
 
 Packet_Init *
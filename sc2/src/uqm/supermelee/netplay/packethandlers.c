@@ -26,6 +26,9 @@
 #include "netinput.h"
 #include "netmisc.h"
 #include "packetsenders.h"
+#ifdef NETPLAY_UDP
+#	include "netudp.h"
+#endif
 #include "proto/npconfirm.h"
 #include "proto/ready.h"
 #include "proto/reset.h"
@@ -137,8 +140,10 @@ PacketHandler_Ack(NetConnection *conn, const Packet_Ack *packet) {
 	if (!testNetState(conn->state > NetState_init, PACKET_ACK))
 		return -1;  // errno is set
 
-	(void) conn;
-	(void) packet;
+	// Pings are only sent to measure the round trip time, one at a time.
+	if (NetConnection_pingAcked(conn, ntoh32(packet->id))
+			&& NetConnection_getNumRoundTrips(conn) < NETPLAY_PING_COUNT)
+		sendPing(conn, NetConnection_newPing(conn));
 	return 0;
 }
 
@@ -508,6 +513,11 @@ PacketHandler_BattleInput(NetConnection *conn,
 			conn->state == NetState_endingBattle2, PACKET_BATTLEINPUT))
 		return -1;  // errno is set
 
+#ifdef NETPLAY_UDP
+	if (!takeTcpBattleInput(conn))
+		return 0;  // It came in over UDP already.
+#endif
+
 	input = (BATTLE_INPUT_STATE) packet->state;
 	bib = getBattleInputBuffer(conn->player);
 	if (!BattleInputBuffer_push(bib, input)) {
@@ -607,6 +617,11 @@ PacketHandler_Checksum(NetConnection *conn, const Packet_Checksum *packet) {
 	// In this situation frameNr is n + 1, and battleFrameCount is
 	// n + delay.
 	if (frameNr + delay < battleFrameCount) {
+#ifdef NETPLAY_UDP
+		if (usesUdpChannel(conn))
+			return 0;
+					// The input came in over UDP, ahead of this checksum.
+#endif
 		log_add(log_Warning, "NETPLAY: [%d] <== Received checksum "
 				"for a frame too far in the past (frame %u, current "
 				"is %u, input delay is %u) -- discarding.", conn->player,
@@ -30,15 +30,38 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define PACKETQ_FLUSH_BATCH 16
+
+#define PACKETQ_LINK_POOL_MAX 64
+		// Maximum number of deleted links kept for reuse, so that the
+		// steady stream of packets during a battle needs no malloc().
+
+static PacketQueueLink *linkPool;
+static size_t linkPoolSize;
+
 static inline PacketQueueLink *
 PacketQueueLink_alloc(void) {
-	// XXX: perhaps keep a pool of links?
-	return malloc(sizeof (PacketQueueLink));
+	PacketQueueLink *link;
+
+	if (linkPool == NULL)
+		return malloc(sizeof (PacketQueueLink));
+
+	link = linkPool;
+	linkPool = link->next;
+	linkPoolSize--;
+	return link;
 }
 
 static inline void
 PacketQueueLink_delete(PacketQueueLink *link) {
-	free(link);
+	if (linkPoolSize >= PACKETQ_LINK_POOL_MAX) {
+		free(link);
+		return;
+	}
+
+	link->next = linkPool;
+	linkPool = link;
+	linkPoolSize++;
 }
 
 // 'maxSize' should at least be 1
@@ -106,23 +129,36 @@ queuePacket(NetConnection *conn, Packet *packet) {
 // the queue, and let the caller decide what to do with them.
 // This function may return -1 with errno EAGAIN or EWOULDBLOCK
 // if we're waiting for the other party to act first.
+// The packets are sent PACKETQ_FLUSH_BATCH at a time, with as few
+// send() calls as sendPackets() can manage.
 static int
 flushPacketQueueLinks(NetConnection *conn, PacketQueueLink **first) {
 	PacketQueueLink *link;
 	PacketQueueLink *next;
 	PacketQueue *queue = &conn->queue;
-	
-	for (link = *first; link != NULL; link = next) {
-		if (sendPacket(conn, link->packet) == -1) {
+
+	link = *first;
+	while (link != NULL) {
+		Packet *packets[PACKETQ_FLUSH_BATCH];
+		size_t count = 0;
+		PacketQueueLink *batchEnd;
+
+		for (batchEnd = link; batchEnd != NULL &&
+				count < PACKETQ_FLUSH_BATCH; batchEnd = batchEnd->next)
+			packets[count++] = batchEnd->packet;
+
+		if (sendPackets(conn, packets, count) == -1) {
 			// Errno is set.
 			*first = link;
 			return -1;
 		}
-		
-		next = link->next;
-		Packet_delete(link->packet);
-		PacketQueueLink_delete(link);
-		queue->size--;
+
+		for (; link != batchEnd; link = next) {
+			next = link->next;
+			Packet_delete(link->packet);
+			PacketQueueLink_delete(link);
+			queue->size--;
+		}
 	}
 
 	*first = link;
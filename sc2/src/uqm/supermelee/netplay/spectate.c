@@ -0,0 +1,841 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Spectators watch the SuperMelee battles of someone else. The side that
+// serves the battles sends the recording of each one (see replay.c) to
+// the spectators as it is being made, and they play it back, a number of
+// frames behind to smooth out its arrival. A spectator never sends
+// anything, so the players do not wait for it. A spectator can serve the
+// battles it watches to others in turn, so that many spectators do not
+// all have to be served by a player.
+//
+// When a spectator connects, it is sent SPECTATE_MAGIC and
+// SPECTATE_VERSION (one byte). After that come messages: a type byte, a
+// 16 bits length (network byte order), and that many bytes:
+//   - SPECTATE_MSG_START: the RNG seed (32 bits, network byte order), then
+//     for each side its PlayerControl byte, its MELEE_FLEET_SIZE ships
+//     (one byte each), the length of its team name and the name.
+//   - SPECTATE_MSG_FRAME: the decisions recorded during one frame.
+//   - SPECTATE_MSG_END: the decisions recorded after the last frame.
+// A spectator that connects during a battle is sent all of that battle
+// at once, and runs what is more than the delay behind headless.
+
+#define PORT_WANT_ERRNO
+#include "netplay.h"
+#include "port.h"
+
+#ifdef NETPLAY_SPECTATE
+
+#include "spectate.h"
+#include "netmelee.h"
+		// for netInput()
+#include "../melee.h"
+		// for MELEE_FLEET_SIZE, MAX_TEAM_CHARS
+#include "../replay.h"
+#include "../../globdata.h"
+#include "../../init.h"
+#include "../../setup.h"
+		// for PlayerControl[]
+#include "libs/log.h"
+#include "libs/net.h"
+#include "libs/network/bytesex.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPECTATE_MAGIC "UQMS"
+#define SPECTATE_VERSION 1
+#define SPECTATE_HELLO_SIZE 5
+#define SPECTATE_HEADER_SIZE 3
+#define SPECTATE_MAX_PAYLOAD 0xffff
+
+#define SPECTATE_MSG_START 1
+#define SPECTATE_MSG_FRAME 2
+#define SPECTATE_MSG_END   3
+
+#define SPECTATE_BLOCK_TIME 100
+		// In ms; how long to wait for network activity at a time while
+		// waiting for the stream.
+
+#ifdef MSG_NOSIGNAL
+#	define SPECTATE_SEND_FLAGS MSG_NOSIGNAL
+		// A spectator going away should not kill the game.
+#else
+#	define SPECTATE_SEND_FLAGS 0
+#endif
+
+typedef struct {
+	uint8 *data;
+	size_t len;
+	size_t size;
+} SpectateBuffer;
+
+typedef struct {
+	NetDescriptor *nd;
+	SpectateBuffer out;
+			// Queued, but not sent yet.
+	bool waitingToWrite;
+			// The write callback is set.
+} Spectator;
+
+// Serving
+static ListenState *listenState;
+static Spectator *spectators[NETPLAY_SPECTATE_MAX];
+static SpectateBuffer battleStream;
+		// The messages of the battle going on, for spectators that
+		// connect during it.
+static bool inBattle;
+static SpectateBuffer pendingDecisions;
+		// Recorded since the last frame.
+static SpectateBuffer message;
+		// Scratch space to put a message together.
+
+// Watching
+static ConnectState *connectState;
+static NetDescriptor *watchNd;
+static bool watchClosed;
+		// Nothing more will arrive.
+static bool helloReceived;
+static SpectateBuffer received;
+		// Not yet played back.
+static size_t forwardedLen;
+		// How much of 'received' has been passed on to our own
+		// spectators.
+static bool battleEnded;
+		// The end of the battle being played back has been handed over.
+static uint32 watchDelay;
+
+
+static void
+SpectateBuffer_append(SpectateBuffer *buf, const void *data, size_t len) {
+	if (buf->len + len > buf->size) {
+		size_t newSize = buf->size == 0 ? 1024 : buf->size;
+		while (newSize < buf->len + len)
+			newSize *= 2;
+		buf->data = realloc(buf->data, newSize);
+		buf->size = newSize;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static void
+SpectateBuffer_consume(SpectateBuffer *buf, size_t len) {
+	assert(len <= buf->len);
+	memmove(buf->data, buf->data + len, buf->len - len);
+	buf->len -= len;
+}
+
+static void
+SpectateBuffer_free(SpectateBuffer *buf) {
+	free(buf->data);
+	buf->data = NULL;
+	buf->len = 0;
+	buf->size = 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+// Serving
+
+
+static void spectatorWritable(NetDescriptor *nd);
+
+static void
+dropSpectator(Spectator *spectator) {
+	size_t i;
+
+	for (i = 0; i < NETPLAY_SPECTATE_MAX; i++) {
+		if (spectators[i] == spectator)
+			spectators[i] = NULL;
+	}
+
+	NetDescriptor_close(spectator->nd);
+	SpectateBuffer_free(&spectator->out);
+	free(spectator);
+}
+
+// Sends as much of what is queued for the spectator as the socket takes.
+// Returns -1 if the spectator is to be dropped.
+static int
+flushSpectator(Spectator *spectator) {
+	Socket *socket = NetDescriptor_getSocket(spectator->nd);
+	size_t sent = 0;
+	bool waiting;
+
+	while (sent < spectator->out.len) {
+		ssize_t sendResult = Socket_send(socket, spectator->out.data + sent,
+				spectator->out.len - sent, SPECTATE_SEND_FLAGS);
+		if (sendResult >= 0) {
+			sent += sendResult;
+			continue;
+		}
+
+		if (errno == EINTR)
+			continue;
+		if (errno == EWOULDBLOCK || errno == EAGAIN)
+			break;
+		return -1;
+	}
+	SpectateBuffer_consume(&spectator->out, sent);
+
+	waiting = spectator->out.len > 0;
+	if (waiting != spectator->waitingToWrite) {
+		NetDescriptor_setWriteCallback(spectator->nd,
+				waiting ? spectatorWritable : NULL);
+		spectator->waitingToWrite = waiting;
+	}
+	return 0;
+}
+
+static void
+queueToSpectator(Spectator *spectator, const void *data, size_t len) {
+	SpectateBuffer_append(&spectator->out, data, len);
+	if (spectator->out.len > NETPLAY_SPECTATE_BACKLOG) {
+		log_add(log_Warning, "NETPLAY: Spectator cannot keep up; "
+				"dropped.");
+		dropSpectator(spectator);
+		return;
+	}
+
+	if (!spectator->waitingToWrite && flushSpectator(spectator) == -1) {
+		log_add(log_Info, "NETPLAY: Spectator disconnected: %s.",
+				strerror(errno));
+		dropSpectator(spectator);
+	}
+}
+
+static void
+spectatorWritable(NetDescriptor *nd) {
+	Spectator *spectator = (Spectator *) NetDescriptor_getExtra(nd);
+
+	if (flushSpectator(spectator) == -1) {
+		log_add(log_Info, "NETPLAY: Spectator disconnected: %s.",
+				strerror(errno));
+		dropSpectator(spectator);
+	}
+}
+
+// Spectators do not send anything; this is to notice them leaving.
+static void
+spectatorReadable(NetDescriptor *nd) {
+	Spectator *spectator = (Spectator *) NetDescriptor_getExtra(nd);
+	Socket *socket = NetDescriptor_getSocket(nd);
+	uint8 buf[256];
+
+	for (;;) {
+		ssize_t numRead = Socket_recv(socket, buf, sizeof buf, 0);
+		if (numRead > 0)
+			continue;
+
+		if (numRead == -1) {
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				return;
+			if (errno == EINTR)
+				continue;
+		}
+
+		log_add(log_Info, "NETPLAY: Spectator disconnected.");
+		dropSpectator(spectator);
+		return;
+	}
+}
+
+// Sends a message to all spectators, and keeps it for the ones that
+// connect later during the same battle.
+static void
+broadcastMessage(uint8 type, const uint8 *payload, size_t len) {
+	uint8 header[SPECTATE_HEADER_SIZE];
+	uint16 len16;
+	size_t i;
+
+	assert(len <= SPECTATE_MAX_PAYLOAD);
+
+	header[0] = type;
+	len16 = hton16((uint16) len);
+	memcpy(&header[1], &len16, sizeof len16);
+
+	message.len = 0;
+	SpectateBuffer_append(&message, header, sizeof header);
+	SpectateBuffer_append(&message, payload, len);
+
+	if (type == SPECTATE_MSG_START) {
+		battleStream.len = 0;
+		inBattle = true;
+	}
+	if (inBattle)
+		SpectateBuffer_append(&battleStream, message.data, message.len);
+	if (type == SPECTATE_MSG_END) {
+		battleStream.len = 0;
+		inBattle = false;
+	}
+
+	for (i = 0; i < NETPLAY_SPECTATE_MAX; i++) {
+		if (spectators[i] != NULL)
+			queueToSpectator(spectators[i], message.data, message.len);
+	}
+}
+
+static void
+spectatorConnected(ListenState *state, NetDescriptor *listenNd,
+		NetDescriptor *newNd, const struct sockaddr *addr,
+		SOCKLEN_T addrLen) {
+	Spectator *spectator;
+	uint8 hello[SPECTATE_HELLO_SIZE];
+	size_t i;
+
+	for (i = 0; i < NETPLAY_SPECTATE_MAX; i++) {
+		if (spectators[i] == NULL)
+			break;
+	}
+	if (i == NETPLAY_SPECTATE_MAX) {
+		log_add(log_Warning, "NETPLAY: Too many spectators; one more "
+				"turned away.");
+		NetDescriptor_close(newNd);
+		return;
+	}
+
+	spectator = malloc(sizeof (Spectator));
+	spectator->nd = newNd;
+			// No incRef(); the caller gives up ownership.
+	spectator->out.data = NULL;
+	spectator->out.len = 0;
+	spectator->out.size = 0;
+	spectator->waitingToWrite = false;
+	spectators[i] = spectator;
+
+	NetDescriptor_setExtra(newNd, (void *) spectator);
+	NetDescriptor_setReadCallback(newNd, spectatorReadable);
+	(void) Socket_setInteractive(NetDescriptor_getSocket(newNd));
+
+	log_add(log_Info, "NETPLAY: Spectator connected.");
+
+	memcpy(hello, SPECTATE_MAGIC, 4);
+	hello[4] = SPECTATE_VERSION;
+	queueToSpectator(spectator, hello, sizeof hello);
+	if (spectators[i] != NULL && inBattle)
+		queueToSpectator(spectator, battleStream.data, battleStream.len);
+
+	(void) state;
+	(void) listenNd;
+	(void) addr;
+	(void) addrLen;
+}
+
+static void
+spectatorListenError(ListenState *state, const ListenError *error) {
+	log_add(log_Error, "NETPLAY: Cannot serve spectators: %s.",
+			strerror(error->err));
+	ListenState_close(state);
+	listenState = NULL;
+}
+
+static void
+spectateStart(MeleeSetup *setup, DWORD seed) {
+	SpectateBuffer payload = { NULL, 0, 0 };
+	uint32 seed32 = hton32((uint32) seed);
+	COUNT side;
+
+	SpectateBuffer_append(&payload, &seed32, sizeof seed32);
+	for (side = 0; side < NUM_SIDES; side++) {
+		const char *name = MeleeSetup_getTeamName(setup, side);
+		uint8 nameLen = (uint8) strlen(name);
+		FleetShipIndex slotI;
+
+		SpectateBuffer_append(&payload, &PlayerControl[side], 1);
+		for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++) {
+			uint8 ship = (uint8) MeleeSetup_getShip(setup, side, slotI);
+			SpectateBuffer_append(&payload, &ship, 1);
+		}
+		SpectateBuffer_append(&payload, &nameLen, 1);
+		SpectateBuffer_append(&payload, name, nameLen);
+	}
+
+	broadcastMessage(SPECTATE_MSG_START, payload.data, payload.len);
+	SpectateBuffer_free(&payload);
+	pendingDecisions.len = 0;
+}
+
+static void
+spectateWrite(const BYTE *buf, size_t size) {
+	SpectateBuffer_append(&pendingDecisions, buf, size);
+}
+
+static void
+spectateEndFrame(void) {
+	broadcastMessage(SPECTATE_MSG_FRAME, pendingDecisions.data,
+			pendingDecisions.len);
+	pendingDecisions.len = 0;
+
+	netInput();
+			// Let spectators connect and get their data during a battle
+			// without netplay.
+}
+
+static void
+spectateEnd(void) {
+	broadcastMessage(SPECTATE_MSG_END, pendingDecisions.data,
+			pendingDecisions.len);
+	pendingDecisions.len = 0;
+	netInput();
+}
+
+static const ReplayListener spectateListener = {
+	/* .start    = */ spectateStart,
+	/* .write    = */ spectateWrite,
+	/* .endFrame = */ spectateEndFrame,
+	/* .end      = */ spectateEnd,
+};
+
+bool
+serveSpectators(const char *port) {
+	ListenFlags listenFlags;
+
+	assert(listenState == NULL);
+
+	memset(&listenFlags, 0, sizeof listenFlags);
+	listenFlags.familyDemand =
+#if NETPLAY == NETPLAY_IPV4
+			PF_inet;
+#else
+			PF_unspec;
+#endif
+	listenFlags.familyPrefer = PF_unspec;
+	listenFlags.backlog = NETPLAY_LISTEN_BACKLOG;
+
+	listenState = listenPort(port, IPProto_tcp, &listenFlags,
+			spectatorConnected, spectatorListenError, NULL);
+	if (listenState == NULL) {
+		log_add(log_Error, "NETPLAY: Cannot serve spectators on port %s: "
+				"%s.", port, strerror(errno));
+		return false;
+	}
+
+	Replay_setListener(&spectateListener);
+	log_add(log_User, "Serving battles to spectators on port %s.", port);
+	return true;
+}
+
+void
+stopServingSpectators(void) {
+	size_t i;
+
+	Replay_setListener(NULL);
+
+	if (listenState != NULL) {
+		ListenState_close(listenState);
+		listenState = NULL;
+	}
+
+	for (i = 0; i < NETPLAY_SPECTATE_MAX; i++) {
+		if (spectators[i] != NULL)
+			dropSpectator(spectators[i]);
+	}
+
+	inBattle = false;
+	SpectateBuffer_free(&battleStream);
+	SpectateBuffer_free(&pendingDecisions);
+	SpectateBuffer_free(&message);
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+// Watching
+
+
+static void
+closeWatch(void) {
+	if (watchNd != NULL) {
+		NetDescriptor_close(watchNd);
+		watchNd = NULL;
+	}
+	watchClosed = true;
+}
+
+// Gets the message at 'offset' in 'received'.
+// Returns its total length, or 0 if it has not fully arrived yet.
+static size_t
+receivedMessage(size_t offset, uint8 *type, const uint8 **payload,
+		size_t *payloadLen) {
+	uint16 len16;
+
+	if (received.len < offset + SPECTATE_HEADER_SIZE)
+		return 0;
+
+	memcpy(&len16, &received.data[offset + 1], sizeof len16);
+	*payloadLen = ntoh16(len16);
+	if (received.len < offset + SPECTATE_HEADER_SIZE + *payloadLen)
+		return 0;
+
+	*type = received.data[offset];
+	*payload = &received.data[offset + SPECTATE_HEADER_SIZE];
+	return SPECTATE_HEADER_SIZE + *payloadLen;
+}
+
+static void
+consumeReceived(size_t len) {
+	assert(len <= forwardedLen);
+	SpectateBuffer_consume(&received, len);
+	forwardedLen -= len;
+}
+
+// Passes the messages that have come in on to our own spectators.
+static void
+forwardReceived(void) {
+	for (;;) {
+		uint8 type;
+		const uint8 *payload;
+		size_t payloadLen;
+		size_t len;
+
+		len = receivedMessage(forwardedLen, &type, &payload, &payloadLen);
+		if (len == 0)
+			break;
+
+		if (listenState != NULL)
+			broadcastMessage(type, payload, payloadLen);
+		forwardedLen += len;
+	}
+}
+
+static void
+watchReadable(NetDescriptor *nd) {
+	Socket *socket = NetDescriptor_getSocket(nd);
+
+	for (;;) {
+		uint8 buf[NETPLAY_READBUFSIZE];
+		ssize_t numRead;
+
+		numRead = Socket_recv(socket, buf, sizeof buf, 0);
+		if (numRead == 0) {
+			log_add(log_User, "The connection to the spectated game was "
+					"closed.");
+			closeWatch();
+			return;
+		}
+
+		if (numRead == -1) {
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				return;
+			if (errno == EINTR)
+				continue;
+
+			log_add(log_Error, "NETPLAY: recv() failed: %s.",
+					strerror(errno));
+			closeWatch();
+			return;
+		}
+
+		SpectateBuffer_append(&received, buf, numRead);
+
+		if (!helloReceived) {
+			if (received.len < SPECTATE_HELLO_SIZE)
+				continue;
+			if (memcmp(received.data, SPECTATE_MAGIC, 4) != 0 ||
+					received.data[4] != SPECTATE_VERSION) {
+				log_add(log_Error, "NETPLAY: The other side does not "
+						"serve battles that this version can watch.");
+				closeWatch();
+				return;
+			}
+			SpectateBuffer_consume(&received, SPECTATE_HELLO_SIZE);
+			helloReceived = true;
+		}
+
+		forwardReceived();
+	}
+}
+
+static void
+watchConnected(ConnectState *state, NetDescriptor *nd,
+		const struct sockaddr *addr, socklen_t addrLen) {
+	watchNd = nd;
+			// No incRef(); the caller gives up ownership.
+	NetDescriptor_setReadCallback(watchNd, watchReadable);
+	(void) Socket_setInteractive(NetDescriptor_getSocket(watchNd));
+
+	ConnectState_close(state);
+	connectState = NULL;
+
+	log_add(log_User, "Connected; waiting for a battle to watch.");
+	(void) addr;
+	(void) addrLen;
+}
+
+static void
+watchConnectError(ConnectState *state, const ConnectError *error) {
+	log_add(log_Error, "NETPLAY: Cannot connect to watch: %s.",
+			strerror(error->err));
+	ConnectState_close(state);
+	connectState = NULL;
+	watchClosed = true;
+}
+
+// Waits a bit for more of the stream.
+// Returns false if nothing more will come.
+static bool
+pumpWatch(void) {
+	if (watchClosed || (GLOBAL(CurrentActivity) & CHECK_ABORT))
+		return false;
+
+	netInputBlocking(SPECTATE_BLOCK_TIME);
+	return true;
+}
+
+// Counts the frames of the battle that have fully arrived.
+static uint32
+receivedFrames(bool *ended) {
+	size_t offset = 0;
+	uint32 frames = 0;
+
+	*ended = false;
+	for (;;) {
+		uint8 type;
+		const uint8 *payload;
+		size_t payloadLen;
+		size_t len;
+
+		len = receivedMessage(offset, &type, &payload, &payloadLen);
+		if (len == 0 || offset + len > forwardedLen)
+			break;
+
+		if (type == SPECTATE_MSG_END) {
+			*ended = true;
+			break;
+		}
+		if (type != SPECTATE_MSG_FRAME)
+			break;
+
+		frames++;
+		offset += len;
+	}
+	return frames;
+}
+
+// Waits until there are at least 'watchDelay' frames to play back, or
+// until the battle ends.
+// Returns the number of frames, or -1 if nothing more will come.
+static sint32
+bufferFrames(void) {
+	for (;;) {
+		bool ended;
+		uint32 frames = receivedFrames(&ended);
+
+		if (ended || frames >= watchDelay)
+			return (sint32) frames;
+
+		if (!pumpWatch())
+			return frames > 0 ? (sint32) frames : -1;
+	}
+}
+
+static bool
+waitSpectatedData(void) {
+	if (battleEnded)
+		return false;
+
+	if (bufferFrames() == -1) {
+		if (watchClosed)
+			GLOBAL(CurrentActivity) |= CHECK_ABORT;
+		return false;
+	}
+
+	for (;;) {
+		uint8 type;
+		const uint8 *payload;
+		size_t payloadLen;
+		size_t len;
+
+		len = receivedMessage(0, &type, &payload, &payloadLen);
+		if (len == 0 || len > forwardedLen)
+			break;
+		if (type != SPECTATE_MSG_FRAME && type != SPECTATE_MSG_END)
+			break;
+
+		Replay_addLiveData(payload, payloadLen);
+		consumeReceived(len);
+		if (type == SPECTATE_MSG_END) {
+			battleEnded = true;
+			break;
+		}
+	}
+	return true;
+}
+
+static void
+spectatedFrameDone(void) {
+	netInput();
+			// Keep the stream coming in, and going out to our own
+			// spectators.
+}
+
+static const ReplaySource watchSource = {
+	/* .wait     = */ waitSpectatedData,
+	/* .endFrame = */ spectatedFrameDone,
+};
+
+bool
+startSpectating(const char *host, const char *port, uint32 delay) {
+	ConnectFlags connectFlags;
+
+	assert(connectState == NULL && watchNd == NULL);
+
+	watchClosed = false;
+	helloReceived = false;
+	received.len = 0;
+	forwardedLen = 0;
+	watchDelay = delay;
+
+	memset(&connectFlags, 0, sizeof connectFlags);
+	connectFlags.familyDemand =
+#if NETPLAY == NETPLAY_IPV4
+			PF_inet;
+#else
+			PF_unspec;
+#endif
+	connectFlags.familyPrefer = PF_unspec;
+	connectFlags.timeout = NETPLAY_CONNECTTIMEOUT;
+	connectFlags.retryDelayMs = NETPLAY_RETRYDELAY;
+
+	log_add(log_User, "Connecting to %s port %s to watch its battles.",
+			host, port);
+	connectState = connectHostByName(host, port, IPProto_tcp, &connectFlags,
+			watchConnected, watchConnectError, NULL);
+	if (connectState == NULL) {
+		log_add(log_Error, "NETPLAY: Cannot connect to watch: %s.",
+				strerror(errno));
+		return false;
+	}
+
+	while (watchNd == NULL) {
+		if (!pumpWatch()) {
+			stopSpectating();
+			return false;
+		}
+	}
+	return true;
+}
+
+// Puts the START message in 'payload' in 'setup' and starts the
+// playback.
+static bool
+startSpectatedBattle(MeleeSetup *setup, const uint8 *payload, size_t len,
+		DWORD seekFrame) {
+	uint32 seed32;
+	BYTE control[NUM_SIDES];
+	COUNT side;
+
+	if (len < sizeof seed32)
+		return false;
+	memcpy(&seed32, payload, sizeof seed32);
+	payload += sizeof seed32;
+	len -= sizeof seed32;
+
+	for (side = 0; side < NUM_SIDES; side++) {
+		char name[MAX_TEAM_CHARS + 1];
+		FleetShipIndex slotI;
+		size_t nameLen;
+
+		if (len < 1 + MELEE_FLEET_SIZE + 1)
+			return false;
+		control[side] = payload[0];
+		for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++) {
+			MeleeShip ship = (MeleeShip) payload[1 + slotI];
+			if (!MeleeShip_valid(ship))
+				return false;
+			MeleeSetup_setShip(setup, side, slotI, ship);
+		}
+		nameLen = payload[1 + MELEE_FLEET_SIZE];
+		payload += 1 + MELEE_FLEET_SIZE + 1;
+		len -= 1 + MELEE_FLEET_SIZE + 1;
+
+		if (len < nameLen || nameLen > MAX_TEAM_CHARS)
+			return false;
+		memcpy(name, payload, nameLen);
+		name[nameLen] = '\0';
+		MeleeSetup_setTeamName(setup, side, name);
+		payload += nameLen;
+		len -= nameLen;
+	}
+
+	battleEnded = false;
+	Replay_startLive((DWORD) ntoh32(seed32), control, seekFrame,
+			&watchSource);
+	return true;
+}
+
+bool
+waitSpectatedBattle(MeleeSetup *setup) {
+	uint8 type;
+	const uint8 *payload;
+	size_t payloadLen;
+	size_t len;
+	sint32 frames;
+	SpectateBuffer battleSetup = { NULL, 0, 0 };
+
+	for (;;) {
+		len = receivedMessage(0, &type, &payload, &payloadLen);
+		if (len != 0 && len <= forwardedLen) {
+			if (type == SPECTATE_MSG_START)
+				break;
+			// The rest of a battle that was not played back.
+			consumeReceived(len);
+			continue;
+		}
+
+		if (!pumpWatch())
+			return false;
+	}
+
+	// The frames after the START message are buffered before the
+	// playback starts, and the number of them decides how much to run
+	// headless.
+	SpectateBuffer_append(&battleSetup, payload, payloadLen);
+	consumeReceived(len);
+	frames = bufferFrames();
+	if (frames == -1) {
+		SpectateBuffer_free(&battleSetup);
+		return false;
+	}
+
+	if (!startSpectatedBattle(setup, battleSetup.data, battleSetup.len,
+			(uint32) frames > watchDelay ? (uint32) frames - watchDelay : 0)) {
+		log_add(log_Error, "NETPLAY: Bad battle setup received from the "
+				"spectated game.");
+		SpectateBuffer_free(&battleSetup);
+		closeWatch();
+		return false;
+	}
+	SpectateBuffer_free(&battleSetup);
+	log_add(log_User, "Watching a battle.");
+	return true;
+}
+
+void
+stopSpectating(void) {
+	if (connectState != NULL) {
+		ConnectState_close(connectState);
+		connectState = NULL;
+	}
+	closeWatch();
+	SpectateBuffer_free(&received);
+	forwardedLen = 0;
+}
+
+#endif  /* NETPLAY_SPECTATE */
+
@@ -0,0 +1,50 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UQM_SUPERMELEE_NETPLAY_SPECTATE_H_
+#define UQM_SUPERMELEE_NETPLAY_SPECTATE_H_
+
+#include "netplay.h"
+
+#ifdef NETPLAY_SPECTATE
+
+#include "../meleesetup.h"
+#include "types.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Lets spectators connect on 'port', and streams the battles fought from
+// now on to them.
+bool serveSpectators(const char *port);
+void stopServingSpectators(void);
+
+// Connects to a player (or another spectator) serving battles. They are
+// played back 'delay' frames after they arrive.
+bool startSpectating(const char *host, const char *port, uint32 delay);
+// Waits for the next battle, puts its teams in 'setup' and starts its
+// playback. Returns false when no more battles will come.
+bool waitSpectatedBattle(MeleeSetup *setup);
+void stopSpectating(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* NETPLAY_SPECTATE */
+
+#endif  /* UQM_SUPERMELEE_NETPLAY_SPECTATE_H_ */
@@ -29,6 +29,7 @@
 #include "../master.h"
 #include "../nameref.h"
 #include "melee.h"
+#include "replay.h"
 #ifdef NETPLAY
 #	include "netplay/netmelee.h"
 #	include "netplay/netmisc.h"
@@ -279,7 +280,7 @@ selectShipComputer (ComputerInputContext *context, GETMELEE_STATE *gms)
 {
 #define COMPUTER_SELECTION_DELAY (ONE_SECOND >> 1)
 	TimeCount now = GetTimeCounter ();
-	if (now < gms->player[context->playerNr].timeIn +
+	if (!headlessBattle && now < gms->player[context->playerNr].timeIn +
 			COMPUTER_SELECTION_DELAY)
 		return TRUE;
 
@@ -351,12 +352,14 @@ DoGetMelee (GETMELEE_STATE *gms)
 			continue;
 
 		if (!gms->player[playerI].done) {
-			if (!PlayerInput[playerI]->handlers->selectShip (
+			if (!Replay_selectShip (gms, playerI)
+					&& !PlayerInput[playerI]->handlers->selectShip (
 					PlayerInput[playerI], gms))
 				goto aborted;
 
 			if (gms->player[playerI].done)
 			{
+				Replay_shipSelected (playerI, gms->player[playerI].choice);
 				Flash_terminate (gms->player[playerI].flashContext);
 				gms->player[playerI].flashContext = NULL;
 			}
@@ -0,0 +1,482 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#define PICKMELE_INTERNAL
+#include "replay.h"
+
+#include "../init.h"
+#include "../intel.h"
+#include "../setup.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+
+#include <assert.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// File layout: the magic and version, the seed (4 bytes, little endian),
+// then for each side its PlayerControl byte and its serialised team.
+// After that come the decisions, one per record:
+//   - a battle input: one byte below 0x80
+//   - a ship selection: REPLAY_TAG_SELECT, the player, and the choice
+//     (2 bytes, little endian, 0xffff for a random ship)
+//   - a battle end check: REPLAY_TAG_READY or REPLAY_TAG_NOT_READY
+#define REPLAY_MAGIC "UQMR"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 9
+
+#define REPLAY_TAG_MASK       0x80
+#define REPLAY_TAG_SELECT     0x80
+#define REPLAY_TAG_READY      0x81
+#define REPLAY_TAG_NOT_READY  0x82
+
+#define REPLAY_FLUSH_FRAMES 24
+		// Keeps a recording useful when the game crashes
+
+typedef enum
+{
+	REPLAY_IDLE,
+	REPLAY_RECORDING,
+	REPLAY_PLAYING,
+} ReplayMode;
+
+static struct
+{
+	ReplayMode mode;
+	DWORD frame;
+
+	// Recording
+	uio_Stream *out;
+			// NULL when only the listener gets the recording
+	const ReplayListener *listener;
+
+	// Playback
+	DWORD seed;
+	BYTE *data;
+	size_t size;
+	size_t pos;
+	DWORD seekFrame;
+	bool desynced;
+	const ReplaySource *source;
+			// Non-NULL when the battle is played back live
+} replay;
+
+static void
+writeBytes (const BYTE *buf, size_t size)
+{
+	if (replay.listener != NULL)
+		replay.listener->write (buf, size);
+
+	if (replay.out != NULL && uio_fwrite (buf, size, 1, replay.out) != 1)
+	{
+		log_add (log_Error, "Could not write to the battle recording; "
+				"recording stopped.");
+		uio_fclose (replay.out);
+		replay.out = NULL;
+		if (replay.listener == NULL)
+			Replay_stop ();
+	}
+}
+
+// Returns whether the next 'count' bytes of the recording are there,
+// waiting for them when the battle is played back live.
+static bool
+haveBytes (size_t count)
+{
+	while (replay.pos + count > replay.size)
+	{
+		if (replay.source == NULL || !replay.source->wait ())
+			return false;
+	}
+	return true;
+}
+
+static void
+setPlayedControl (COUNT side, BYTE control)
+{
+	PlayerControl[side] = control;
+	if (PlayerControl[side] & NETWORK_CONTROL)
+	{	// The remote side's inputs are in the recording
+		PlayerControl[side] = HUMAN_CONTROL | STANDARD_RATING;
+	}
+}
+
+static void
+putDword (BYTE *buf, DWORD val)
+{
+	buf[0] = (BYTE) val;
+	buf[1] = (BYTE) (val >> 8);
+	buf[2] = (BYTE) (val >> 16);
+	buf[3] = (BYTE) (val >> 24);
+}
+
+static DWORD
+getDword (const BYTE *buf)
+{
+	return (DWORD) buf[0] | ((DWORD) buf[1] << 8) |
+			((DWORD) buf[2] << 16) | ((DWORD) buf[3] << 24);
+}
+
+bool
+Replay_startRecording (uio_DirHandle *dir, const char *fileName,
+		MeleeSetup *setup, DWORD seed)
+{
+	BYTE header[REPLAY_HEADER_SIZE];
+	COUNT side;
+
+	Replay_stop ();
+
+	if (dir == NULL)
+		goto started;
+
+	replay.out = uio_fopen (dir, fileName, "wb");
+	if (replay.out == NULL)
+	{
+		log_add (log_Error, "Could not create battle recording '%s'.",
+				fileName);
+		return false;
+	}
+
+	memcpy (header, REPLAY_MAGIC, 4);
+	header[4] = REPLAY_VERSION;
+	putDword (&header[5], seed);
+	if (uio_fwrite (header, sizeof header, 1, replay.out) != 1)
+		goto err;
+
+	for (side = 0; side < NUM_SIDES; side++)
+	{
+		if (uio_putc (PlayerControl[side], replay.out) == EOF)
+			goto err;
+		if (MeleeSetup_serializeTeam (setup, side, replay.out) == -1)
+			goto err;
+	}
+
+started:
+	replay.mode = REPLAY_RECORDING;
+	replay.frame = 0;
+	if (replay.listener != NULL)
+		replay.listener->start (setup, seed);
+	return true;
+
+err:
+	log_add (log_Error, "Could not write battle recording '%s'.",
+			fileName);
+	uio_fclose (replay.out);
+	replay.out = NULL;
+	return false;
+}
+
+bool
+Replay_startPlayback (uio_DirHandle *dir, const char *fileName,
+		MeleeSetup *setup, DWORD seekFrame)
+{
+	uio_Stream *stream;
+	struct stat sb;
+	BYTE header[REPLAY_HEADER_SIZE];
+	size_t dataStart;
+	COUNT side;
+
+	Replay_stop ();
+
+	stream = uio_fopen (dir, fileName, "rb");
+	if (stream == NULL)
+	{
+		log_add (log_Error, "Could not open battle recording '%s'.",
+				fileName);
+		return false;
+	}
+
+	if (uio_fstat (uio_streamHandle (stream), &sb) == -1)
+		goto err;
+	dataStart = sizeof header + (1 + MeleeTeam_serialSize) * NUM_SIDES;
+	if ((size_t) sb.st_size < dataStart)
+		goto err;
+
+	if (uio_fread (header, sizeof header, 1, stream) != 1)
+		goto err;
+	if (memcmp (header, REPLAY_MAGIC, 4) != 0
+			|| header[4] != REPLAY_VERSION)
+		goto err;
+	replay.seed = getDword (&header[5]);
+
+	for (side = 0; side < NUM_SIDES; side++)
+	{
+		int control = uio_getc (stream);
+		if (control == EOF)
+			goto err;
+		setPlayedControl (side, (BYTE) control);
+
+		if (MeleeSetup_deserializeTeam (setup, side, stream) == -1)
+			goto err;
+	}
+
+	replay.size = (size_t) sb.st_size - dataStart;
+	replay.data = HMalloc (replay.size + 1);
+	if (replay.size > 0
+			&& uio_fread (replay.data, replay.size, 1, stream) != 1)
+	{
+		HFree (replay.data);
+		replay.data = NULL;
+		goto err;
+	}
+	uio_fclose (stream);
+
+	replay.mode = REPLAY_PLAYING;
+	replay.pos = 0;
+	replay.frame = 0;
+	replay.seekFrame = seekFrame;
+	replay.desynced = false;
+	replay.source = NULL;
+	return true;
+
+err:
+	log_add (log_Error, "'%s' is not a valid battle recording.", fileName);
+	uio_fclose (stream);
+	return false;
+}
+
+void
+Replay_startLive (DWORD seed, const BYTE control[NUM_SIDES],
+		DWORD seekFrame, const ReplaySource *source)
+{
+	COUNT side;
+
+	Replay_stop ();
+
+	for (side = 0; side < NUM_SIDES; side++)
+		setPlayedControl (side, control[side]);
+
+	replay.seed = seed;
+	replay.data = HMalloc (1);
+	replay.size = 0;
+
+	replay.mode = REPLAY_PLAYING;
+	replay.pos = 0;
+	replay.frame = 0;
+	replay.seekFrame = seekFrame;
+	replay.desynced = false;
+	replay.source = source;
+}
+
+void
+Replay_addLiveData (const BYTE *buf, size_t size)
+{
+	assert (replay.mode == REPLAY_PLAYING && replay.source != NULL);
+
+	replay.data = HRealloc (replay.data, replay.size + size + 1);
+	memcpy (&replay.data[replay.size], buf, size);
+	replay.size += size;
+}
+
+// Called when the recording does not match what the battle asks for;
+// the players take over from here.
+static void
+endPlayback (const char *what)
+{
+	if (replay.pos < replay.size)
+		log_add (log_User, "Replay desync at frame %lu: expected %s; "
+				"playback stopped.", (unsigned long) replay.frame, what);
+	else
+		log_add (log_User, "Replay ended at frame %lu.",
+				(unsigned long) replay.frame);
+	Replay_stop ();
+}
+
+void
+Replay_stop (void)
+{
+	if (replay.mode == REPLAY_RECORDING)
+	{
+		if (replay.out != NULL)
+			uio_fclose (replay.out);
+		replay.out = NULL;
+		if (replay.listener != NULL)
+			replay.listener->end ();
+	}
+	else if (replay.mode == REPLAY_PLAYING)
+	{
+		HFree (replay.data);
+		replay.data = NULL;
+		replay.size = 0;
+		replay.source = NULL;
+	}
+	replay.mode = REPLAY_IDLE;
+}
+
+void
+Replay_setListener (const ReplayListener *listener)
+{
+	assert (replay.mode != REPLAY_RECORDING);
+	replay.listener = listener;
+}
+
+bool
+Replay_hasListener (void)
+{
+	return replay.listener != NULL;
+}
+
+bool
+Replay_isPlaying (void)
+{
+	return replay.mode == REPLAY_PLAYING;
+}
+
+DWORD
+Replay_getSeed (void)
+{
+	return replay.seed;
+}
+
+DWORD
+Replay_getSeekFrame (void)
+{
+	return replay.mode == REPLAY_PLAYING ? replay.seekFrame : 0;
+}
+
+BATTLE_INPUT_STATE
+Replay_battleInput (COUNT playerNr, BATTLE_INPUT_STATE input)
+{
+	BATTLE_INPUT_STATE recorded;
+
+	if (replay.mode == REPLAY_RECORDING)
+	{
+		writeBytes (&input, 1);
+		return input;
+	}
+	if (replay.mode != REPLAY_PLAYING)
+		return input;
+
+	if (!haveBytes (1) || (replay.data[replay.pos] & REPLAY_TAG_MASK))
+	{
+		endPlayback ("a battle input");
+		return input;
+	}
+
+	recorded = replay.data[replay.pos++];
+	if (recorded != input && !replay.desynced
+			&& (PlayerControl[playerNr] & COMPUTER_CONTROL))
+	{	// The AI should decide the same on every run
+		log_add (log_User, "Replay desync at frame %lu: player %u "
+				"input is 0x%02x, recorded 0x%02x.",
+				(unsigned long) replay.frame, playerNr, input, recorded);
+		replay.desynced = true;
+	}
+	return recorded;
+}
+
+bool
+Replay_battleEndReady (bool ready)
+{
+	BYTE tag;
+
+	if (replay.mode == REPLAY_RECORDING)
+	{
+		tag = ready ? REPLAY_TAG_READY : REPLAY_TAG_NOT_READY;
+		writeBytes (&tag, 1);
+		return ready;
+	}
+	if (replay.mode != REPLAY_PLAYING)
+		return ready;
+
+	tag = haveBytes (1) ? replay.data[replay.pos] : 0;
+	if (tag != REPLAY_TAG_READY && tag != REPLAY_TAG_NOT_READY)
+	{
+		endPlayback ("a battle end check");
+		return ready;
+	}
+
+	replay.pos++;
+	return tag == REPLAY_TAG_READY;
+}
+
+void
+Replay_endFrame (void)
+{
+	if (replay.mode == REPLAY_IDLE)
+		return;
+
+	++replay.frame;
+	if (replay.mode == REPLAY_RECORDING)
+	{
+		if (replay.out != NULL && replay.frame % REPLAY_FLUSH_FRAMES == 0)
+			uio_fflush (replay.out);
+		if (replay.listener != NULL)
+			replay.listener->endFrame ();
+	}
+	else if (replay.source != NULL)
+		replay.source->endFrame ();
+}
+
+bool
+Replay_selectShip (GETMELEE_STATE *gms, COUNT playerNr)
+{
+	const BYTE *rec;
+	COUNT recPlayer;
+	COUNT choice;
+
+	if (replay.mode != REPLAY_PLAYING)
+		return false;
+
+	if (!haveBytes (4))
+	{
+		endPlayback ("a ship selection");
+		return false;
+	}
+
+	rec = &replay.data[replay.pos];
+	if (rec[0] != REPLAY_TAG_SELECT || rec[1] >= NUM_PLAYERS)
+	{
+		endPlayback ("a ship selection");
+		return false;
+	}
+
+	recPlayer = rec[1];
+	if (recPlayer != playerNr)
+	{	// The other player picked first
+		if (gms->player[recPlayer].selecting
+				&& !gms->player[recPlayer].done)
+			return true;
+
+		endPlayback ("a ship selection");
+		return false;
+	}
+
+	choice = (COUNT) (rec[2] | (rec[3] << 8));
+	if (!setShipSelected (gms, playerNr, choice, false))
+	{
+		endPlayback ("a valid ship selection");
+		return false;
+	}
+
+	replay.pos += 4;
+	return true;
+}
+
+void
+Replay_shipSelected (COUNT playerNr, COUNT choice)
+{
+	BYTE rec[4];
+
+	if (replay.mode != REPLAY_RECORDING)
+		return;
+
+	rec[0] = REPLAY_TAG_SELECT;
+	rec[1] = (BYTE) playerNr;
+	rec[2] = (BYTE) choice;
+	rec[3] = (BYTE) (choice >> 8);
+	writeBytes (rec, sizeof rec);
+}
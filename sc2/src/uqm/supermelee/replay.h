@@ -0,0 +1,109 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef UQM_SUPERMELEE_REPLAY_H_
+#define UQM_SUPERMELEE_REPLAY_H_
+
+/* Recording and playback of SuperMelee battles.
+ * Given the RNG seed, the battle simulation only depends on the input of
+ * each ship on each frame, the ships picked, and the moment each side
+ * was ready to continue after a ship died (which depends on the victory
+ * ditty being played in real time). A replay file holds the seed and
+ * both teams, followed by those decisions in the order the simulation
+ * asked for them.
+ * During playback, the recorded decisions are used for every side.
+ * Computer players still run their AI, as it uses the RNG, and its
+ * choices are checked against the recording to detect desyncs. */
+
+#include "pickmele.h"
+#include "meleesetup.h"
+#include "../controls.h"
+#include "../init.h"
+		// for NUM_SIDES
+#include "libs/compiler.h"
+#include "libs/uio.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define REPLAY_FILE_NAME "lastmelee.rpl"
+
+// Gets what is recorded as it happens, for instance to show the battle
+// to netplay spectators. Set with Replay_setListener().
+typedef struct
+{
+	void (*start) (MeleeSetup *setup, DWORD seed);
+			// A recording starts; PlayerControl[] is set
+	void (*write) (const BYTE *buf, size_t size);
+			// Recorded decisions, in the replay file format
+	void (*endFrame) (void);
+	void (*end) (void);
+} ReplayListener;
+
+// Feeds a played back battle whose decisions are still coming in.
+typedef struct
+{
+	bool (*wait) (void);
+			// Called when more decisions are needed. Adds what arrives
+			// with Replay_addLiveData(), and returns false if no more
+			// will come.
+	void (*endFrame) (void);
+} ReplaySource;
+
+// Starts recording a battle between the teams in 'setup', to be fought
+// with the given RNG seed and PlayerControl[]. With a NULL 'dir', nothing
+// is written to file and the battle only goes to the listener.
+bool Replay_startRecording (uio_DirHandle *dir, const char *fileName,
+		MeleeSetup *setup, DWORD seed);
+// Loads a recording, putting its teams in 'setup' and its controls in
+// PlayerControl[]. Playback starts at the next battle. From frame
+// 'seekFrame' on, the battle is drawn; before that it runs headless.
+bool Replay_startPlayback (uio_DirHandle *dir, const char *fileName,
+		MeleeSetup *setup, DWORD seekFrame);
+// Starts playback of a battle that is being recorded elsewhere. The teams
+// are to be put in the MeleeSetup by the caller; 'control' is what the
+// recording side has in PlayerControl[].
+void Replay_startLive (DWORD seed, const BYTE control[NUM_SIDES],
+		DWORD seekFrame, const ReplaySource *source);
+void Replay_addLiveData (const BYTE *buf, size_t size);
+void Replay_stop (void);
+
+void Replay_setListener (const ReplayListener *listener);
+bool Replay_hasListener (void);
+
+bool Replay_isPlaying (void);
+DWORD Replay_getSeed (void);
+		// The RNG seed to start the played back battle with
+DWORD Replay_getSeekFrame (void);
+		// 0 if nothing is to be skipped
+
+// All of these pass the live value through when not playing back
+BATTLE_INPUT_STATE Replay_battleInput (COUNT playerNr,
+		BATTLE_INPUT_STATE input);
+bool Replay_battleEndReady (bool ready);
+void Replay_endFrame (void);
+
+// Makes the recorded selection for 'playerNr', if it has come up yet.
+// Returns false if the player's own input handler is to be used.
+bool Replay_selectShip (GETMELEE_STATE *gms, COUNT playerNr);
+void Replay_shipSelected (COUNT playerNr, COUNT choice);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* UQM_SUPERMELEE_REPLAY_H_ */
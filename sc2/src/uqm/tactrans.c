@@ -28,6 +28,7 @@
 #include "battle.h"
 #include "init.h"
 #include "supermelee/pickmele.h"
+#include "supermelee/replay.h"
 #ifdef NETPLAY
 #	include "supermelee/netplay/netmelee.h"
 #	include "supermelee/netplay/netmisc.h"
@@ -77,6 +78,8 @@ OpponentAlive (STARSHIP *TestStarShipPtr)
 static void
 PlayDitty (STARSHIP *ship)
 {
+	if (headlessBattle)
+		return;
 	PlayMusic (ship->RaceDescPtr->ship_data.victory_ditty, FALSE, 3);
 	dittyIsPlaying = TRUE;
 }
@@ -250,9 +253,8 @@ battleEndReadyNetwork (NetworkInputContext *context)
 }
 #endif
 
-// Returns true iff this side is ready to end the battle.
 static inline bool
-readyForBattleEnd (void)
+liveReadyForBattleEnd (void)
 {
 #ifndef NETPLAY
 #if DEMO_MODE
@@ -277,6 +279,15 @@ readyForBattleEnd (void)
 #endif  /* defined (NETPLAY) */
 }
 
+// Returns true iff this side is ready to end the battle.
+static inline bool
+readyForBattleEnd (void)
+{
+	// The wait for the victory ditty depends on real time, so its outcome
+	// is part of a battle recording
+	return Replay_battleEndReady (liveReadyForBattleEnd ());
+}
+
 static void
 preprocess_dead_ship (ELEMENT *DeadShipPtr)
 {
@@ -18,9 +18,12 @@
 
 #include "units.h"
 #include "libs/compiler.h"
+#include "libs/log.h"
+#include "libs/mathlib.h"
+#include "libs/timelib.h"
 
 
-SIZE sinetab[] =
+const SIZE sinetab[] =
 {
 	-FLT_ADJUST (1.000000),
 	-FLT_ADJUST (0.995185),
@@ -92,7 +95,7 @@ COUNT
 ARCTAN (SIZE delta_x, SIZE delta_y)
 {
 	SIZE v1, v2;
-	static COUNT atantab[] =
+	static const COUNT atantab[] =
 	{
 		0,
 		0,
@@ -152,3 +155,50 @@ ARCTAN (SIZE delta_x, SIZE delta_y)
 	return (NORMALIZE_ANGLE (v1));
 }
 
+
+#define PERFTEST_CALLS 1000000
+
+// Times square_root(), ARCTAN() and SINE() on a fixed series of
+// arguments, and logs that along with a checksum of the results, to
+// compare builds; netplay needs the results to be the same everywhere.
+void
+Trig_PerfTest (void)
+{
+	DWORD seed = 1;
+	DWORD checksum = 0;
+	DWORD start, sqrtTime, atanTime, sineTime;
+	long i;
+
+	start = GetTimeMicroseconds ();
+	for (i = 0; i < PERFTEST_CALLS; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		// Mostly the squared distances the AI and gravity ask about
+		checksum = checksum * 31 + square_root (seed >> (seed & 15));
+	}
+	sqrtTime = GetTimeMicroseconds () - start;
+
+	start = GetTimeMicroseconds ();
+	for (i = 0; i < PERFTEST_CALLS; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		checksum = checksum * 31 + ARCTAN ((SIZE) (seed >> 16),
+				(SIZE) seed);
+	}
+	atanTime = GetTimeMicroseconds () - start;
+
+	start = GetTimeMicroseconds ();
+	for (i = 0; i < PERFTEST_CALLS; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		checksum = checksum * 31 + (COUNT) SINE (seed >> 16, (SIZE) seed)
+				+ (COUNT) COSINE (seed >> 16, (SIZE) seed);
+	}
+	sineTime = GetTimeMicroseconds () - start;
+
+	log_add (log_Debug, "Trig_PerfTest(): %d calls each; square_root %lu us, "
+			"ARCTAN %lu us, SINE+COSINE %lu us; checksum %08lx",
+			PERFTEST_CALLS, (unsigned long) sqrtTime,
+			(unsigned long) atanTime, (unsigned long) sineTime,
+			(unsigned long) checksum);
+}
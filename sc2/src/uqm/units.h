@@ -204,12 +204,13 @@ universeToLogy (COORD uy)
 #define UNADJUST(x) (SIZE)((x)>>SIN_SHIFT)
 #define ROUND(x,y) ((x)+((x)>=0?((y)>>1):-((y)>>1)))
 
-extern SIZE sinetab[];
+extern const SIZE sinetab[];
 #define SINVAL(a) sinetab[NORMALIZE_ANGLE(a)]
 #define COSVAL(a) SINVAL((a)+QUADRANT)
 #define SINE(a,m) ((SIZE)((((long)SINVAL(a))*(long)(m))>>SIN_SHIFT))
 #define COSINE(a,m) SINE((a)+QUADRANT,m)
 extern COUNT ARCTAN (SIZE delta_x, SIZE delta_y);
+extern void Trig_PerfTest (void);
 
 #define WRAP_VAL(v,w) ((COUNT)((v)<0?((v)+(w)):((v)>=(w)?((v)-(w)):(v))))
 #define WRAP_X(x) WRAP_VAL(x,LOG_SPACE_WIDTH)
@@ -32,14 +32,21 @@
 #include "globdata.h"
 #include "planets/lifeform.h"
 #include "planets/scan.h"
+#include "planets/solarsys.h"
 #include "races.h"
 #include "setup.h"
 #include "state.h"
 #include "libs/mathlib.h"
+#include "libs/timelib.h"
+#include "libs/time/profile.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
+#define WORLD_BATCH_ENV_VAR "UQM_WORLD_DUMP"
+
 
 static void dumpEventCallback (const EVENT *eventPtr, void *arg);
 
@@ -110,6 +117,7 @@ debugKeyPressedSynchronous (void)
 
 	// Informational:
 //	dumpEvents (stderr);
+//	dumpQueueStats (stderr);
 
 	// Graphical and textual:
 //	debugContexts();
@@ -125,10 +133,20 @@ debugKeyPressed (void)
 {
 	// Tests
 //	Scale_PerfTest ();
+//	SoundDecoder_PerfTest (configDir, "perftest");
+//	PlanetGen_PerfTest ();
+//	Trig_PerfTest ();
+//	Canvas_PerfTest ();
 
 	// Informational:
 //	dumpStrings (stdout);
 //	dumpPlanetTypes(stderr);
+#ifdef TRACK_MEMORY
+	MemTrack_report ();
+#endif
+//	uio_printMounts (stderr, repository);
+			// With the Rust uio, this includes the files read the most,
+			// if UQM_UIO_STATS was set or uio_setStatsEnabled() called.
 //	debugHook = dumpUniverseToFile;
 			// This will cause dumpUniverseToFile to be called from the
 			// Starcon2Main loop. Calling it from here would give threading
@@ -140,6 +158,9 @@ debugKeyPressed (void)
 
 	// Interactive:
 //	uio_debugInteractive(stdin, stdout, stderr);
+
+	// Profiling:
+	toggleProfiler ();
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -167,7 +188,7 @@ forwardToNextEvent (BOOLEAN skipHEE)
 	do {
 		hEvent = GetHeadEvent ();
 		if (hEvent == 0)
-			return;
+			break;
 		LockEvent (hEvent, &EventPtr);
 		if (EventPtr->func_index != HYPERSPACE_ENCOUNTER_EVENT)
 			done = TRUE;
@@ -176,16 +197,9 @@ forwardToNextEvent (BOOLEAN skipHEE)
 		day = EventPtr->day_index;
 		UnlockEvent (hEvent);
 
-		for (;;) {
-			if (GLOBAL (GameClock.year_index) > year ||
-					(GLOBAL (GameClock.year_index) == year &&
-					(GLOBAL (GameClock.month_index) > month ||
-					(GLOBAL (GameClock.month_index) == month &&
-					GLOBAL (GameClock.day_index) >= day))))
-				break;
-
-			MoveGameClockDays (1);
-		}
+		// All at once; the clock handles the events of each day on the
+		// way there, the same as when moved one day at a time
+		MoveGameClockDays (DaysUntilDate (month, day, year));
 	} while (!done);
 
 	UnlockGameClock ();
@@ -264,6 +278,59 @@ dumpEvents (FILE *out)
 
 ////////////////////////////////////////////////////////////////////////////
 
+static void
+dumpQueueStat (FILE *out, const char *name, const QUEUE *pq)
+{
+	fprintf (out, "%-16s %5u %5u %5u %5u %5u\n", name,
+			QueueUsage (pq), QueueHighWater (pq), QueueSize (pq),
+			pq->max_objects, QueueFailures (pq));
+}
+
+void
+dumpQueueStats (FILE *out)
+{
+	fprintf (out, "%-16s %5s %5s %5s %5s %5s\n", "Queue",
+			"used", "peak", "size", "max", "fail");
+	dumpQueueStat (out, "disp_q", &disp_q);
+	dumpQueueStat (out, "race_q[0]", &race_q[0]);
+	dumpQueueStat (out, "race_q[1]", &race_q[1]);
+	dumpQueueStat (out, "built_ship_q", &GLOBAL (built_ship_q));
+	dumpQueueStat (out, "npc_built_ship_q", &GLOBAL (npc_built_ship_q));
+	dumpQueueStat (out, "ip_group_q", &GLOBAL (ip_group_q));
+	dumpQueueStat (out, "encounter_q", &GLOBAL (encounter_q));
+}
+
+void
+toggleProfiler (void)
+{
+	FILE *out;
+
+	if (!Profile_enabled)
+	{
+		Profile_enable (TRUE);
+		return;
+	}
+
+	Profile_enable (FALSE);
+
+#	define PROFILE_DUMP_FILE "profile.csv"
+	out = fopen (PROFILE_DUMP_FILE, "w");
+	if (out == NULL)
+	{
+		fprintf (stderr, "Error: Could not open file '%s' for "
+				"writing: %s\n", PROFILE_DUMP_FILE, strerror (errno));
+		return;
+	}
+
+	Profile_dumpCSV (out);
+	fclose (out);
+
+	fprintf (stdout, "*** Frame times of the last %u frames written to "
+			"'%s'.\n", Profile_numFrames (), PROFILE_DUMP_FILE);
+}
+
+////////////////////////////////////////////////////////////////////////////
+
 // NB: Ship maximum speed and turning rate aren't updated in
 // HyperSpace/QuasiSpace or in melee.
 void
@@ -1257,6 +1324,172 @@ tallyResourcesWorld (TallyResourcesArg *arg, const PLANET_DESC *world)
 
 ////////////////////////////////////////////////////////////////////////////
 
+typedef struct
+{
+	DumpUniverseArg dump;
+			// Must be first; the dump callbacks are passed this.
+			// dump.out is NULL if no dump is wanted.
+	FILE *times;
+	DWORD systemStart;
+	DWORD totalTime;
+	DWORD slowestTime;
+	const STAR_DESC *slowestStar;
+	COUNT numSystems;
+	COUNT numWorlds;
+	COUNT worldsInSystem;
+	DWORD bioCount;
+	DWORD mineralCount;
+} BenchUniverseArg;
+
+static void
+benchWorld (BenchUniverseArg *arg, const PLANET_DESC *world)
+{
+	arg->numWorlds++;
+	arg->worldsInSystem++;
+
+	if (world->data_index == HIERARCHY_STARBASE
+			|| world->data_index == SA_MATRA
+			|| (world->data_index & PLANET_SHIELDED))
+		return;
+
+	// This is what has the generators make the mineral and bio data
+	arg->bioCount += calculateBioValue (pSolarSysState, world);
+	arg->mineralCount += calculateMineralValue (pSolarSysState, world);
+}
+
+static void
+benchSystemPreCallback (const STAR_DESC *star, const SOLARSYS_STATE *system,
+		void *arg)
+{
+	BenchUniverseArg *benchArg = (BenchUniverseArg *) arg;
+
+	benchArg->worldsInSystem = 0;
+	if (benchArg->dump.out != NULL)
+		dumpSystem (benchArg->dump.out, star, system);
+}
+
+static void
+benchSystemPostCallback (const STAR_DESC *star, const SOLARSYS_STATE *system,
+		void *arg)
+{
+	BenchUniverseArg *benchArg = (BenchUniverseArg *) arg;
+	UNICODE name[256];
+	DWORD now = GetTimeMicroseconds ();
+	DWORD elapsed = now - benchArg->systemStart;
+			// From the end of the previous system, so the generation of
+			// the planets before systemFuncPre is counted too
+
+	benchArg->systemStart = now;
+	benchArg->totalTime += elapsed;
+	benchArg->numSystems++;
+	if (benchArg->slowestStar == NULL || elapsed > benchArg->slowestTime)
+	{
+		benchArg->slowestTime = elapsed;
+		benchArg->slowestStar = star;
+	}
+
+	GetClusterName (star, name);
+	fprintf (benchArg->times, "%s\t%lu\t%u\n", name,
+			(unsigned long) elapsed, benchArg->worldsInSystem);
+
+	(void) system;  /* satisfy compiler */
+}
+
+static void
+benchPlanetCallback (const PLANET_DESC *planet, void *arg)
+{
+	BenchUniverseArg *benchArg = (BenchUniverseArg *) arg;
+
+	if (benchArg->dump.out != NULL)
+		dumpPlanet (benchArg->dump.out, planet);
+	benchWorld (benchArg, planet);
+}
+
+static void
+benchMoonCallback (const PLANET_DESC *moon, void *arg)
+{
+	BenchUniverseArg *benchArg = (BenchUniverseArg *) arg;
+
+	if (benchArg->dump.out != NULL)
+		dumpMoon (benchArg->dump.out, moon);
+	benchWorld (benchArg, moon);
+}
+
+// Must be called from the Starcon2Main thread.
+void
+benchmarkUniverse (FILE *out, FILE *times)
+{
+	BenchUniverseArg benchArg;
+	UniverseRecurseArg universeRecurseArg;
+	UNICODE name[256];
+
+	memset (&benchArg, 0, sizeof benchArg);
+	benchArg.dump.out = out;
+	benchArg.times = times;
+
+	universeRecurseArg.systemFuncPre = benchSystemPreCallback;
+	universeRecurseArg.systemFuncPost = benchSystemPostCallback;
+	universeRecurseArg.planetFuncPre = benchPlanetCallback;
+	universeRecurseArg.planetFuncPost = NULL;
+	universeRecurseArg.moonFunc = benchMoonCallback;
+	universeRecurseArg.arg = (void *) &benchArg;
+
+	fprintf (times, "# system\tmicroseconds\tworlds\n");
+	benchArg.systemStart = GetTimeMicroseconds ();
+	UniverseRecurse (&universeRecurseArg);
+
+	fprintf (times, "# %u systems, %u worlds in %lu microseconds\n",
+			benchArg.numSystems, benchArg.numWorlds,
+			(unsigned long) benchArg.totalTime);
+	if (benchArg.slowestStar != NULL)
+	{
+		GetClusterName (benchArg.slowestStar, name);
+		fprintf (times, "# slowest: %s, %lu microseconds\n", name,
+				(unsigned long) benchArg.slowestTime);
+	}
+	fprintf (times, "# bio value %lu, mineral value %lu\n",
+			(unsigned long) benchArg.bioCount,
+			(unsigned long) benchArg.mineralCount);
+}
+
+// Must be called from the Starcon2Main thread, before a game is started.
+BOOLEAN
+runWorldBatch (void)
+{
+	const char *fileName = getenv (WORLD_BATCH_ENV_VAR);
+	FILE *out = NULL;
+
+	if (fileName == NULL)
+		return FALSE;
+
+	if (*fileName != '\0' && strcmp (fileName, "-") != 0)
+	{
+		out = fopen (fileName, "w");
+		if (out == NULL)
+		{
+			fprintf (stderr, "Error: Could not open file '%s' for "
+					"writing: %s\n", fileName, strerror (errno));
+			return TRUE;
+		}
+	}
+
+	// The state of a new game, without a game actually running
+	InitGameStructures ();
+	LoadIPData ();
+
+	benchmarkUniverse (out, stdout);
+
+	FreeIPData ();
+	UninitGameStructures ();
+
+	if (out != NULL)
+		fclose (out);
+	fflush (stdout);
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////
+
 void
 forAllPlanetTypes (void (*callback) (int, const PlanetFrame *, void *),
 		void *arg)
@@ -49,6 +49,13 @@ void forwardToNextEvent (BOOLEAN skipHEE);
 void dumpEvents (FILE *out);
 // Describe one event.
 void dumpEvent (FILE *out, const EVENT *eventPtr);
+// Print the use, high-water mark and size of the element queues, for
+// sizing their tables.
+// Must be called on the Starcon2Main thread.
+void dumpQueueStats (FILE *out);
+// Start profiling frame times and show them on screen, or stop and write
+// them to a file.
+void toggleProfiler (void);
 // Get the name of one event.
 const char *eventName (BYTE func_index);
 
@@ -145,6 +152,18 @@ void tallyResources (FILE *out);
 // "./ResourceTally". Must be called on the Starcon2Main thread.
 void tallyResourcesToFile (void);
 
+// Generate every star system with its planets and moons, with their
+// mineral and bio data, as visiting them would. The time each system
+// takes is written to 'times', one tab separated line per system, with
+// totals at the end. If 'out' is not NULL, the universe is also described
+// there, as with dumpUniverse(). Must be called on the Starcon2Main thread.
+void benchmarkUniverse (FILE *out, FILE *times);
+// If UQM_WORLD_DUMP is set, call benchmarkUniverse() on the state of a new
+// game, with the dump going to the file named and the times to stdout
+// ("-" for the times only), and return TRUE; the game should then exit.
+// Must be called on the Starcon2Main thread, while no game is running.
+BOOLEAN runWorldBatch (void);
+
 
 // Call a function for all planet types.
 void forAllPlanetTypes (void (*callBack) (int, const PlanetFrame *,
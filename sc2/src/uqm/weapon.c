@@ -40,27 +40,47 @@ weapon_collision_cb (ELEMENT *WeaponElementPtr, POINT *pWPt,
 	weapon_collision (WeaponElementPtr, pWPt, HitElementPtr, pHPt);
 }
 
+#define LASER_LIFE 1
+
+// What every laser and every missile element starts out as; each shot
+// copies one of these and fills in the rest. The fields not set here
+// are 0, as with AllocElement().
+static ELEMENT laserTemplate;
+static ELEMENT missileTemplate;
+static BOOLEAN templatesMade;
+
+static void
+makeWeaponTemplates (void)
+{
+	laserTemplate.hit_points = 1;
+	laserTemplate.mass_points = 1;
+	laserTemplate.life_span = LASER_LIFE;
+	laserTemplate.collision_func = weapon_collision_cb;
+	laserTemplate.blast_offset = 1;
+	laserTemplate.current.image.farray = &stars_in_space;
+
+	missileTemplate.collision_func = weapon_collision_cb;
+
+	templatesMade = TRUE;
+}
 
 HELEMENT
 initialize_laser (LASER_BLOCK *pLaserBlock)
 {
 	HELEMENT hLaserElement;
 
-	hLaserElement = AllocElement ();
+	if (!templatesMade)
+		makeWeaponTemplates ();
+
+	hLaserElement = AllocElementFrom (&laserTemplate);
 	if (hLaserElement)
 	{
-#define LASER_LIFE 1
 		ELEMENT *LaserElementPtr;
 
 		LockElement (hLaserElement, &LaserElementPtr);
 		LaserElementPtr->playerNr = pLaserBlock->sender;
-		LaserElementPtr->hit_points = 1;
-		LaserElementPtr->mass_points = 1;
 		LaserElementPtr->state_flags = APPEARING | FINITE_LIFE
 				| pLaserBlock->flags;
-		LaserElementPtr->life_span = LASER_LIFE;
-		LaserElementPtr->collision_func = weapon_collision_cb;
-		LaserElementPtr->blast_offset = 1;
 
 		LaserElementPtr->current.location.x = pLaserBlock->cx
 				+ COSINE (FACING_TO_ANGLE (pLaserBlock->face),
@@ -72,7 +92,7 @@ initialize_laser (LASER_BLOCK *pLaserBlock)
 		SetPrimColor (&DisplayArray[LaserElementPtr->PrimIndex],
 				pLaserBlock->color);
 		LaserElementPtr->current.image.frame = DecFrameIndex (stars_in_space);
-		LaserElementPtr->current.image.farray = &stars_in_space;
+				// stars_in_space is loaded again with each battle
 		SetVelocityComponents (&LaserElementPtr->velocity,
 				WORLD_TO_VELOCITY ((pLaserBlock->cx + pLaserBlock->ex)
 				- LaserElementPtr->current.location.x),
@@ -89,7 +109,10 @@ initialize_missile (MISSILE_BLOCK *pMissileBlock)
 {
 	HELEMENT hMissileElement;
 
-	hMissileElement = AllocElement ();
+	if (!templatesMade)
+		makeWeaponTemplates ();
+
+	hMissileElement = AllocElementFrom (&missileTemplate);
 	if (hMissileElement)
 	{
 		SIZE delta_x, delta_y;
@@ -109,7 +132,6 @@ initialize_missile (MISSILE_BLOCK *pMissileBlock)
 				SetAbsFrameIndex (pMissileBlock->farray[0],
 				pMissileBlock->index);
 		MissileElementPtr->preprocess_func = pMissileBlock->preprocess_func;
-		MissileElementPtr->collision_func = weapon_collision_cb;
 		MissileElementPtr->blast_offset = (BYTE)pMissileBlock->blast_offs;
 
 		angle = FACING_TO_ANGLE (pMissileBlock->face);
@@ -0,0 +1,136 @@
+#!/bin/sh
+# Runs a list of asset conversions in parallel, skipping the ones whose
+# output is up to date.
+# The GPL applies.
+#
+# The manifest has one conversion per line:
+#	<input> <output> <command>
+# The command is run with sh, with IN and OUT set to the input and output
+# paths, from the directory the manifest is in. Paths cannot contain
+# spaces. Empty lines and lines starting with '#' are skipped. For example:
+#	ipanims/boom.abx  ipanims/boom.wav  ./abx2wav "$IN" "$OUT"
+#	music/credits.aif music/credits.wav ./aif2wav "$IN" "$OUT"
+#	comm/orz/orz.duk  comm/orz/orz.wav  ./unduck "$IN" && sox -c 2 -r 22050 -w -s -t raw "${IN%.duk}.raw" -t wav "$OUT" && rm -- "${IN%.duk}.raw"
+#
+# A conversion is skipped when its output exists and neither the contents
+# of the input nor the command changed since it last succeeded. The hashes
+# are kept in <manifest>.state/.
+#
+# Environment:
+#	JOBS   conversions run at the same time (default: number of CPUs)
+#	HASH   the command that hashes files (default: sha1sum, or cksum)
+
+if [ "$1" = "--job" ]; then
+	# One conversion: --job <stripped manifest> <state dir> <results> <line>
+	LINE=`sed -n "${5}p" "$2"`
+	STATEDIR="$3"
+	RESULTS="$4"
+
+	set -f
+	set -- $LINE
+	set +f
+	IN="$1"
+	OUT="$2"
+	CMD=`printf '%s\n' "$LINE" | \
+			sed 's/^[[:space:]]*[^[:space:]]*[[:space:]]*[^[:space:]]*[[:space:]]*//'`
+	export IN OUT
+
+	STATE="${STATEDIR}/`echo "$OUT" | sed 's,/,%,g'`"
+	SUM=`{ echo "$CMD"; $HASH < "$IN"; } | $HASH`
+	if [ -e "$OUT" -a -f "$STATE" ] && [ "`cat "$STATE"`" = "$SUM" ]; then
+		echo "skip 0 $IN" >> "$RESULTS"
+		exit 0
+	fi
+
+	BYTES=`wc -c < "$IN" | tr -d ' '`
+	DIR="${OUT%/*}"
+	if [ "$DIR" != "$OUT" -a ! -d "$DIR" ]; then
+		mkdir -p -- "$DIR"
+	fi
+	if sh -c "$CMD" > "${STATE}.log" 2>&1; then
+		echo "$SUM" > "$STATE"
+		rm -f -- "${STATE}.log"
+		echo "done $BYTES $IN" >> "$RESULTS"
+		echo "Converted $IN"
+	else
+		rm -f -- "$STATE"
+		echo "fail $BYTES $IN" >> "$RESULTS"
+		echo "FAILED $IN, see ${STATE}.log"
+	fi
+	exit 0
+fi
+
+if [ $# -ne 1 ]; then
+	echo "Syntax: convertall.sh <manifest>"
+	exit 1
+fi
+
+MANIFEST="$1"
+if [ ! -r "$MANIFEST" ]; then
+	echo "\"${MANIFEST}\" cannot be read"
+	exit 1
+fi
+
+case "$0" in
+	/*) SELF="$0" ;;
+	*) SELF="$PWD/$0" ;;
+esac
+
+if [ -z "$JOBS" ]; then
+	JOBS=`getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1`
+fi
+if [ -z "$HASH" ]; then
+	if command -v sha1sum > /dev/null 2>&1; then
+		HASH=sha1sum
+	else
+		HASH=cksum
+	fi
+fi
+export HASH
+
+cd "`dirname "$MANIFEST"`" || exit 1
+MANIFEST="${MANIFEST##*/}"
+STATEDIR="${MANIFEST}.state"
+TEMPDIR=/tmp/convertall.$$/
+
+mkdir -p "$STATEDIR"
+mkdir "$TEMPDIR"
+if [ $? -ne 0 ]; then
+	echo "Could not create temp dir '$TEMPDIR'"
+	exit 1
+fi
+
+LIST="${TEMPDIR}list"
+RESULTS="${TEMPDIR}results"
+grep -v -e '^[[:space:]]*#' -e '^[[:space:]]*$' "$MANIFEST" > "$LIST"
+: > "$RESULTS"
+COUNT=`wc -l < "$LIST" | tr -d ' '`
+
+echo "$COUNT conversions, $JOBS at a time"
+START=`date +%s`
+
+if [ "$COUNT" -gt 0 ]; then
+	seq 1 "$COUNT" | xargs -n 1 -P "$JOBS" \
+			sh "$SELF" --job "$LIST" "$STATEDIR" "$RESULTS"
+fi
+
+END=`date +%s`
+SECS=`expr "$END" - "$START"`
+
+awk -v secs="$SECS" '
+	{ n[$1]++; bytes[$1] += $2 }
+	END {
+		printf "%d converted, %d up to date, %d failed in %d s\n",
+				n["done"], n["skip"], n["fail"], secs
+		if (secs > 0 && n["done"] > 0)
+			printf "%.1f files/s, %.1f KB/s of input\n",
+					n["done"] / secs, bytes["done"] / 1024 / secs
+	}
+' "$RESULTS"
+
+FAILED=`grep -c '^fail' "$RESULTS"`
+rm -rf -- "$TEMPDIR"
+
+if [ "$FAILED" -ne 0 ]; then
+	exit 1
+fi
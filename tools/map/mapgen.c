@@ -137,9 +137,22 @@ typedef struct
 {
 	obj_type_t type;
 	shape_t shape;
+	unsigned stamp; // last collision query that looked at it
 
 } object_t;
 
+// Objects are indexed by a grid of cells over the map, so that
+// a collision check only looks at the objects near the shape
+#define OBJ_CELLS  64 // per side
+
+typedef struct
+{
+	int* objs; // indices into script_t.objs
+	int cobjs;
+	int objalloc;
+
+} obj_cell_t;
+
 typedef struct
 {
 	unsigned char str[8];
@@ -204,6 +217,10 @@ typedef struct
 	int cobjs;
 	int objalloc;
 
+	obj_cell_t* cells; // OBJ_CELLS x OBJ_CELLS
+	int cindexed; // objs that are in the cells so far
+	unsigned stamp;
+
 } script_t;
 
 int verbose_level = 0;
@@ -1084,6 +1101,13 @@ static void freeScript(script_t* scr)
 	freeMemory(&scr->clusters);
 	freeMemory(&scr->sois);
 	freeMemory(&scr->objs);
+
+	if (scr->cells)
+	{
+		for (i = 0; i < OBJ_CELLS * OBJ_CELLS; ++i)
+			freeMemory(&scr->cells[i].objs);
+		freeMemory(&scr->cells);
+	}
 }
 
 static void preprocessStars(script_t* scr)
@@ -1562,7 +1586,79 @@ static int overlapShapes(const shape_t* obj1, const shape_t* obj2)
 	return 0;
 }
 
-static int isCollidingWith(const script_t* scr, const shape_t* shp, obj_type_t witht)
+static int cellCoord(double c, int extent)
+{
+	int cell = (int)floor(c * OBJ_CELLS / extent);
+
+	if (cell < 0)
+		return 0;
+	if (cell >= OBJ_CELLS)
+		return OBJ_CELLS - 1;
+	return cell;
+}
+
+// gets the range of cells that a shape's box touches
+static void shapeToCells(const script_t* scr, const shape_t* shp,
+		int* x0, int* y0, int* x1, int* y1)
+{
+	mg_rectf_t r;
+
+	shapeToBox(shp, &r);
+	*x0 = cellCoord(r.x, scr->gridmx);
+	*y0 = cellCoord(r.y, scr->gridmy);
+	*x1 = cellCoord(r.x + r.w, scr->gridmx);
+	*y1 = cellCoord(r.y + r.h, scr->gridmy);
+}
+
+static int addToCell(obj_cell_t* cell, int iobj)
+{
+	if (cell->cobjs >= cell->objalloc)
+	{
+		int count = cell->objalloc ? cell->objalloc * 2 : 16;
+		int* newa = realloc(cell->objs, count * sizeof(*cell->objs));
+		if (!newa)
+			return 0;
+		cell->objs = newa;
+		cell->objalloc = count;
+	}
+
+	cell->objs[cell->cobjs] = iobj;
+	cell->cobjs++;
+
+	return 1;
+}
+
+// adds the objects added since the last call to the cells;
+// callers may still change an object's shape until then
+static int indexObjects(script_t* scr)
+{
+	if (!scr->cells)
+	{
+		scr->cells = calloc(OBJ_CELLS * OBJ_CELLS, sizeof(*scr->cells));
+		if (!scr->cells)
+			return 0;
+	}
+
+	for ( ; scr->cindexed < scr->cobjs; ++scr->cindexed)
+	{
+		int x0, y0, x1, y1;
+		int x, y;
+
+		shapeToCells(scr, &scr->objs[scr->cindexed].shape, &x0, &y0, &x1, &y1);
+		for (y = y0; y <= y1; ++y)
+		{
+			for (x = x0; x <= x1; ++x)
+			{
+				if (!addToCell(scr->cells + y * OBJ_CELLS + x, scr->cindexed))
+					return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+static int isCollidingWithAny(const script_t* scr, const shape_t* shp, obj_type_t witht)
 {
 	int i;
 	object_t* testobj;
@@ -1579,6 +1675,42 @@ static int isCollidingWith(const script_t* scr, const shape_t* shp, obj_type_t w
 	return 0;
 }
 
+static int isCollidingWith(script_t* scr, const shape_t* shp, obj_type_t witht)
+{
+	int x0, y0, x1, y1;
+	int x, y;
+
+	if (!indexObjects(scr))
+		return isCollidingWithAny(scr, shp, witht); // out of memory
+
+	// an object in several of the cells is only tested once
+	scr->stamp++;
+
+	shapeToCells(scr, shp, &x0, &y0, &x1, &y1);
+	for (y = y0; y <= y1; ++y)
+	{
+		for (x = x0; x <= x1; ++x)
+		{
+			const obj_cell_t* cell = scr->cells + y * OBJ_CELLS + x;
+			int i;
+
+			for (i = 0; i < cell->cobjs; ++i)
+			{
+				object_t* testobj = scr->objs + cell->objs[i];
+
+				if (!(testobj->type & witht) || testobj->stamp == scr->stamp)
+					continue;
+				testobj->stamp = scr->stamp;
+
+				if (overlapShapes(shp, &testobj->shape))
+					return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
 static void imageToRectShape(const script_t* scr, const mg_image_t img, shape_t* shp)
 {
 	const double stepx = scr->gridr.w / scr->gridmx;
@@ -0,0 +1,253 @@
+#!/bin/sh
+# Round-robin SuperMelee tournaments between computer players: every ship
+# against every other one, on a number of seeds, as headless battles.
+# The GPL applies.
+#
+# Syntax:
+#	meleetournament.sh plan <seeds> > <work file>
+#	meleetournament.sh run <work file>
+#	meleetournament.sh report <work file> > <csv file>
+#
+# 'plan' writes the work file: one battle per line, as
+#	<ship> <ship> <seed>
+# with the ships numbered as MeleeShip in sc2/src/uqm/supermelee/meleeship.h.
+# Every ordered pair of different ships plays each of the seeds 1 to
+# <seeds>, so each ship plays every opponent from both sides.
+#
+# 'run' plays the battles of the work file that are not in
+# <work file>.results yet, and adds their results there, as
+#	<ship> <ship> <seed> <winner> <frames>
+# where the winner is 1 or 2, or 0 for a draw. Starting it again after it
+# was interrupted goes on with the battles that have no result. The
+# battles go to the game in batches (config.meleebatch, see
+# RunMeleeBatch() in sc2/src/uqm/supermelee/melee.c), each batch in a game
+# process of its own with its own config dir.
+#
+# To spread a tournament over several machines, give them all the same
+# work file and each its own SHARD=<k>/<n>: it then plays every n-th
+# battle, starting with the k-th. Join their results files into one for
+# 'report'.
+#
+# 'report' writes CSV with a line for every ship and opponent, and one
+# with "all" as the opponent for every ship. The win rate counts a draw as
+# half a win. The battle length is in battle frames, 24 to the second.
+#
+# Environment:
+#	UQM_BIN      the game binary (default: sc2/uqm)
+#	CONTENT_DIR  default: sc2/content
+#	JOBS         game processes at the same time (default: number of CPUs)
+#	BATCH        battles per game process (default: 50)
+#	SHARD        <k>/<n>, see above (default: 1/1)
+
+SHIPS="androsynth arilou chenjesu chmmr druuge earthling ilwrath kohrah
+		melnorme mmrnmhrm mycon orz pkunk shofixti slylandro spathi supox
+		syreen thraddash umgah urquan utwig vux yehat zoqfotpik"
+NUM_SHIPS=25
+
+if [ "$1" = "--job" ]; then
+	# One batch: --job <results> <batch>
+	RESULTS="$2"
+	BATCHFILE="$3"
+	DIR="${BATCHFILE}.d"
+
+	mkdir -p "${DIR}/teams"
+	awk '{ printf "ship:%s ship:%s %s\n", $1, $2, $3 }' "$BATCHFILE" \
+			> "${DIR}/teams/batch.lst"
+	echo "meleebatch = STRING:batch.lst" > "${DIR}/uqm.cfg"
+
+	"$UQM_BIN" --configdir="$DIR" --contentdir="$CONTENT_DIR" \
+			--logfile="${DIR}/log" > /dev/null 2>&1
+
+	# "Melee batch match 3: 'ship:1' vs 'ship:5', seed 42", then
+	# "Headless battle: player 1 won after 1234 frames"
+	awk '
+		/Melee batch match [0-9]+:/ {
+			line = $0
+			gsub(/[^0-9 ]/, " ", line)
+			n = split(line, f, " ")
+			cur = (n >= 4) ? f[n - 2] " " f[n - 1] " " f[n] : ""
+			next
+		}
+		/Headless battle:/ && cur != "" {
+			if ($0 ~ /player 1 won/)
+				winner = 1
+			else if ($0 ~ /player 2 won/)
+				winner = 2
+			else if ($0 ~ /draw/)
+				winner = 0
+			else {
+				cur = ""
+				next
+			}
+			for (i = 1; i < NF; ++i)
+				if ($(i + 1) == "frames")
+					printf "%s %d %s\n", cur, winner, $i
+			cur = ""
+		}
+	' "${DIR}/log" > "${DIR}/results"
+
+	DONE=`wc -l < "${DIR}/results" | tr -d ' '`
+	TOTAL=`wc -l < "$BATCHFILE" | tr -d ' '`
+	cat "${DIR}/results" >> "$RESULTS"
+	if [ "$DONE" -ne "$TOTAL" ]; then
+		echo "$DONE of $TOTAL battles gave a result; the log is ${DIR}/log"
+	else
+		echo "$DONE battles done"
+		rm -rf -- "$DIR"
+	fi
+	exit 0
+fi
+
+case "$1" in
+	plan)
+		if [ $# -ne 2 ]; then
+			echo "Syntax: meleetournament.sh plan <seeds>" >&2
+			exit 1
+		fi
+		awk -v ships="$NUM_SHIPS" -v seeds="$2" 'BEGIN {
+			for (seed = 1; seed <= seeds; ++seed)
+				for (a = 0; a < ships; ++a)
+					for (b = 0; b < ships; ++b)
+						if (a != b)
+							printf "%d %d %d\n", a, b, seed
+		}'
+		exit 0
+		;;
+	run|report)
+		if [ $# -ne 2 ]; then
+			echo "Syntax: meleetournament.sh $1 <work file>" >&2
+			exit 1
+		fi
+		;;
+	*)
+		echo "Syntax: meleetournament.sh plan|run|report ..." >&2
+		exit 1
+		;;
+esac
+
+WORKFILE="$2"
+RESULTS="${WORKFILE}.results"
+if [ ! -r "$WORKFILE" ]; then
+	echo "\"${WORKFILE}\" cannot be read" >&2
+	exit 1
+fi
+touch "$RESULTS"
+
+if [ "$1" = "report" ]; then
+	# A battle in the results more than once, as after joining the
+	# results of machines that overlapped, counts once.
+	awk -v names="`echo $SHIPS`" -v ships="$NUM_SHIPS" '
+		function add(s, o, result, frames) {
+			battles[s, o]++
+			if (result > 0)
+				wins[s, o]++
+			else if (result < 0)
+				losses[s, o]++
+			else
+				draws[s, o]++
+			length_sum[s, o] += frames
+		}
+		function row(name, o) {
+			if (!battles[s, o])
+				return
+			printf "%s,%s,%d,%d,%d,%d,%.3f,%.1f\n", shipName[s], name,
+					battles[s, o], wins[s, o], losses[s, o], draws[s, o],
+					(wins[s, o] + draws[s, o] / 2) / battles[s, o],
+					length_sum[s, o] / battles[s, o]
+		}
+		BEGIN {
+			split(names, n, " ")
+			for (i = 0; i < ships; ++i)
+				shipName[i] = n[i + 1]
+		}
+		NF == 5 {
+			key = $1 " " $2 " " $3
+			if (key in seen)
+				next
+			seen[key] = 1
+			result = ($4 == 1) ? 1 : ($4 == 2) ? -1 : 0
+			add($1, $2, result, $5)
+			add($2, $1, -result, $5)
+			add($1, "all", result, $5)
+			add($2, "all", -result, $5)
+		}
+		END {
+			print "ship,opponent,battles,wins,losses,draws,win_rate,avg_frames"
+			for (s = 0; s < ships; ++s) {
+				for (o = 0; o < ships; ++o)
+					row(shipName[o], o)
+				row("all", "all")
+			}
+		}
+	' "$RESULTS"
+	exit 0
+fi
+
+case "$0" in
+	/*) SELF="$0" ;;
+	*) SELF="$PWD/$0" ;;
+esac
+TOOLS_DIR=`dirname "$SELF"`
+REPO_ROOT=`cd "${TOOLS_DIR}/.." && pwd`
+
+UQM_BIN="${UQM_BIN:-${REPO_ROOT}/sc2/uqm}"
+CONTENT_DIR="${CONTENT_DIR:-${REPO_ROOT}/sc2/content}"
+BATCH="${BATCH:-50}"
+SHARD="${SHARD:-1/1}"
+if [ -z "$JOBS" ]; then
+	JOBS=`getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1`
+fi
+export UQM_BIN CONTENT_DIR
+
+if [ ! -x "$UQM_BIN" ]; then
+	echo "${UQM_BIN} not found or not executable" >&2
+	exit 1
+fi
+
+SHARD_NR="${SHARD%/*}"
+SHARD_COUNT="${SHARD#*/}"
+if [ "$SHARD_NR" -lt 1 -o "$SHARD_NR" -gt "$SHARD_COUNT" ]; then
+	echo "SHARD must be <k>/<n> with k from 1 to n" >&2
+	exit 1
+fi
+
+TEMPDIR=/tmp/meleetournament.$$/
+mkdir "$TEMPDIR"
+if [ $? -ne 0 ]; then
+	echo "Could not create temp dir '$TEMPDIR'" >&2
+	exit 1
+fi
+
+TODO="${TEMPDIR}todo"
+awk -v k="$SHARD_NR" -v n="$SHARD_COUNT" -v results="$RESULTS" '
+	FILENAME == results {
+		if (NF == 5)
+			done[$1 " " $2 " " $3] = 1
+		next
+	}
+	/^[[:space:]]*#/ || NF < 3 { next }
+	{
+		if (i++ % n != k - 1)
+			next
+		if (!(($1 " " $2 " " $3) in done))
+			print $1, $2, $3
+	}
+' "$RESULTS" "$WORKFILE" > "$TODO"
+COUNT=`wc -l < "$TODO" | tr -d ' '`
+
+echo "$COUNT battles to play, $BATCH to a batch, $JOBS at a time"
+START=`date +%s`
+
+if [ "$COUNT" -gt 0 ]; then
+	(cd "$TEMPDIR" && split -l "$BATCH" todo batch.)
+	ls -d "${TEMPDIR}"batch.* | \
+			xargs -n 1 -P "$JOBS" sh "$SELF" --job "$RESULTS"
+fi
+
+END=`date +%s`
+echo "Done in `expr "$END" - "$START"` s"
+
+# The batches that left their logs behind for a look are kept
+rm -f -- "$TODO" "${TEMPDIR}"batch.??
+rmdir "$TEMPDIR" 2>/dev/null
+exit 0
@@ -0,0 +1,667 @@
+/*
+ * Content package (.uqm zip) builder
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Packs a content directory into a .uqm package, laid out for the way
+// the game reads it:
+// - With an access trace (a file listing paths in the order the game
+//   first opened them, as written when UQM_UIO_TRACE is set), entries
+//   are written in that order, so that startup and the transitions the
+//   trace covers read the package front to back. Entries not in the
+//   trace follow, by name.
+// - Traced files up to the -s size are stored uncompressed, so they are
+//   used as they are rather than inflated on every open.
+// - Audio and video are stored uncompressed as well; the uio zip reader
+//   seeks in those in place, where a compressed entry would have to be
+//   inflated again from the start for every seek back.
+// - The data of stored entries larger than the -a alignment starts on
+//   an -a byte boundary, so that it can be mapped into memory directly.
+//   Smaller entries are read into memory whole when opened; padding
+//   them would only spread out what is read sequentially.
+// Anything that does not get smaller by compressing it is stored too.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define DEFAULT_ALIGN 4096
+#define DEFAULT_STORE_MAX (64 * 1024)
+
+// Extra field ID of the padding that aligns stored data (as used by
+// Android's zipalign)
+#define ALIGN_EXTRA_ID 0xd935
+
+#define LOCAL_HEADER_SIZE 30
+#define CENTRAL_HEADER_SIZE 46
+#define END_OF_CENTRAL_DIR_SIZE 22
+
+#define METHOD_STORED 0
+#define METHOD_DEFLATED 8
+
+struct options {
+	const char *srcdir;
+	const char *outfile;
+	const char *tracefile;
+	const char *prefix;
+			// Stripped from the start of the paths in the trace
+	long storeMax;
+	long align;
+	char verbose;
+};
+
+typedef struct {
+	char *name;
+			// Relative to srcdir, separated by '/'
+	off_t size;
+	time_t mtime;
+	mode_t mode;
+	long order;
+			// Line of the trace it was first opened on; -1 if not in it
+
+	// Filled in as the entry is written
+	uint16_t method;
+	uint32_t crc;
+	uint32_t compSize;
+	uint32_t offset;
+			// Offset of the local header
+	uint16_t dosTime;
+	uint16_t dosDate;
+} Entry;
+
+typedef struct {
+	Entry *entries;
+	size_t numEntries;
+	size_t maxEntries;
+} EntryList;
+
+typedef struct {
+	FILE *file;
+	const char *name;
+	uint32_t offset;
+} Writer;
+
+
+void parse_arguments(int argc, char *argv[], struct options *opts);
+int collectFiles(EntryList *list, const char *srcdir, const char *rel,
+		const struct stat *outSb);
+long applyTrace(EntryList *list, const struct options *opts);
+int writePackage(EntryList *list, const struct options *opts);
+
+
+int
+main(int argc, char *argv[]) {
+	struct options opts;
+	EntryList list;
+	struct stat outSb;
+	size_t i;
+	int result;
+
+	parse_arguments(argc, argv, &opts);
+
+	memset(&list, '\0', sizeof list);
+	// When rebuilding a package inside the dir it is built from, leave
+	// the old one out
+	if (stat(opts.outfile, &outSb) == -1)
+		memset(&outSb, '\0', sizeof outSb);
+	if (collectFiles(&list, opts.srcdir, "", &outSb) == -1)
+		return EXIT_FAILURE;
+
+	if (opts.tracefile != NULL) {
+		long numTraced = applyTrace(&list, &opts);
+		if (numTraced == -1)
+			return EXIT_FAILURE;
+		if (opts.verbose) {
+			fprintf(stderr, "%ld of %lu files are in the trace.\n",
+					numTraced, (unsigned long) list.numEntries);
+		}
+	}
+
+	result = writePackage(&list, &opts);
+
+	for (i = 0; i < list.numEntries; i++)
+		free(list.entries[i].name);
+	free(list.entries);
+	return result == -1 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void
+usage() {
+	fprintf(stderr, "mkpkg [-t <trace>] [-p <prefix>] [-s <size>] "
+			"[-a <align>] [-v] <srcdir> <outfile>\n"
+			"\t-t  order the entries by the access trace in 'trace'\n"
+			"\t-p  strip 'prefix' (the mount point of the package) from "
+			"the paths\n"
+			"\t    in the trace\n"
+			"\t-s  store traced files up to 'size' bytes uncompressed "
+			"(default %d)\n"
+			"\t-a  align stored data on 'align' bytes (default %d)\n"
+			"\t-v  verbose mode\n",
+			DEFAULT_STORE_MAX, DEFAULT_ALIGN);
+}
+
+void
+parse_arguments(int argc, char *argv[], struct options *opts) {
+	int ch;
+
+	memset(opts, '\0', sizeof (struct options));
+	opts->storeMax = DEFAULT_STORE_MAX;
+	opts->align = DEFAULT_ALIGN;
+	while (1) {
+		ch = getopt(argc, argv, "a:hp:s:t:v");
+		if (ch == -1)
+			break;
+		switch(ch) {
+			case 'a':
+				opts->align = atol(optarg);
+				if (opts->align < 1 || opts->align > 65536) {
+					fprintf(stderr, "Invalid alignment.\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'p':
+				opts->prefix = optarg;
+				break;
+			case 's':
+				opts->storeMax = atol(optarg);
+				break;
+			case 't':
+				opts->tracefile = optarg;
+				break;
+			case 'v':
+				opts->verbose = 1;
+				break;
+			case '?':
+			case 'h':
+			default:
+				usage();
+				exit(EXIT_FAILURE);
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 2) {
+		usage();
+		exit(EXIT_FAILURE);
+	}
+	opts->srcdir = argv[0];
+	opts->outfile = argv[1];
+}
+
+static int
+addEntry(EntryList *list, const char *name, const struct stat *sb) {
+	Entry *entry;
+
+	if (list->numEntries == list->maxEntries) {
+		size_t newMax = list->maxEntries == 0 ? 256 : list->maxEntries * 2;
+		Entry *newEntries = realloc(list->entries,
+				newMax * sizeof (Entry));
+		if (newEntries == NULL) {
+			fprintf(stderr, "Error: Out of memory.\n");
+			return -1;
+		}
+		list->entries = newEntries;
+		list->maxEntries = newMax;
+	}
+
+	entry = &list->entries[list->numEntries];
+	memset(entry, '\0', sizeof (Entry));
+	entry->name = strdup(name);
+	if (entry->name == NULL) {
+		fprintf(stderr, "Error: Out of memory.\n");
+		return -1;
+	}
+	entry->size = sb->st_size;
+	entry->mtime = sb->st_mtime;
+	entry->mode = sb->st_mode;
+	entry->order = -1;
+	list->numEntries++;
+	return 0;
+}
+
+// Add the files in 'srcdir'/'rel' and below, except 'outSb'.
+int
+collectFiles(EntryList *list, const char *srcdir, const char *rel,
+		const struct stat *outSb) {
+	char path[PATH_MAX];
+	DIR *dir;
+	struct dirent *de;
+	int result = 0;
+
+	snprintf(path, sizeof path, "%s%s%s", srcdir, *rel ? "/" : "", rel);
+	dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "Error: Could not open directory %s: %s\n", path,
+				strerror(errno));
+		return -1;
+	}
+
+	while (result == 0 && (de = readdir(dir)) != NULL) {
+		char name[PATH_MAX];
+		struct stat sb;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(name, sizeof name, "%s%s%s", rel, *rel ? "/" : "",
+				de->d_name);
+		if (snprintf(path, sizeof path, "%s/%s", srcdir, name)
+				>= (int) sizeof path) {
+			fprintf(stderr, "Error: Path too long: %s/%s\n", srcdir, name);
+			result = -1;
+			break;
+		}
+		if (stat(path, &sb) == -1) {
+			fprintf(stderr, "Error: Could not stat %s: %s\n", path,
+					strerror(errno));
+			result = -1;
+			break;
+		}
+
+		if (S_ISDIR(sb.st_mode)) {
+			result = collectFiles(list, srcdir, name, outSb);
+		} else if (S_ISREG(sb.st_mode)) {
+			if (sb.st_dev == outSb->st_dev && sb.st_ino == outSb->st_ino)
+				continue;
+			if (sb.st_size > (off_t) UINT32_MAX) {
+				fprintf(stderr, "Error: %s is too large for a package.\n",
+						path);
+				result = -1;
+				break;
+			}
+			result = addEntry(list, name, &sb);
+		}
+	}
+
+	closedir(dir);
+	return result;
+}
+
+static int
+compareNames(const void *a, const void *b) {
+	return strcmp(((const Entry *) a)->name, ((const Entry *) b)->name);
+}
+
+// Traced entries first, in the order they were first opened in
+static int
+compareOrder(const void *a, const void *b) {
+	const Entry *ea = a;
+	const Entry *eb = b;
+
+	if (ea->order != eb->order) {
+		if (ea->order == -1)
+			return 1;
+		if (eb->order == -1)
+			return -1;
+		return ea->order < eb->order ? -1 : 1;
+	}
+	return strcmp(ea->name, eb->name);
+}
+
+// Fill in the order of the entries from the trace, and sort them by it.
+// Returns the number of entries in the trace.
+long
+applyTrace(EntryList *list, const struct options *opts) {
+	FILE *trace;
+	char line[PATH_MAX];
+	size_t prefixLen = opts->prefix != NULL ? strlen(opts->prefix) : 0;
+	long lineNr = 0;
+	long numTraced = 0;
+
+	trace = fopen(opts->tracefile, "r");
+	if (trace == NULL) {
+		fprintf(stderr, "Error: Could not open trace %s: %s\n",
+				opts->tracefile, strerror(errno));
+		return -1;
+	}
+
+	qsort(list->entries, list->numEntries, sizeof (Entry), compareNames);
+	while (fgets(line, sizeof line, trace) != NULL) {
+		const char *name = line;
+		Entry key;
+		Entry *entry;
+
+		line[strcspn(line, "\r\n")] = '\0';
+		lineNr++;
+		if (prefixLen > 0 && strncmp(name, opts->prefix, prefixLen) == 0)
+			name += prefixLen;
+		while (*name == '/')
+			name++;
+
+		key.name = (char *) name;
+		entry = bsearch(&key, list->entries, list->numEntries,
+				sizeof (Entry), compareNames);
+		if (entry == NULL) {
+			if (opts->verbose)
+				fprintf(stderr, "Not in the package: %s\n", line);
+			continue;
+		}
+		if (entry->order == -1) {
+			entry->order = lineNr;
+			numTraced++;
+		}
+	}
+	fclose(trace);
+
+	qsort(list->entries, list->numEntries, sizeof (Entry), compareOrder);
+	return numTraced;
+}
+
+// Audio and video, which are seeked in while being played
+static int
+isStreamedFile(const char *name) {
+	static const char *const extensions[] = {
+		".ogg", ".wav", ".mod", ".duk", ".aif", NULL
+	};
+	size_t len = strlen(name);
+	int i;
+
+	for (i = 0; extensions[i] != NULL; i++) {
+		size_t extLen = strlen(extensions[i]);
+		if (len >= extLen && strcasecmp(name + len - extLen,
+				extensions[i]) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+static void
+put16(uint8_t *buf, uint16_t val) {
+	buf[0] = (uint8_t) val;
+	buf[1] = (uint8_t) (val >> 8);
+}
+
+static void
+put32(uint8_t *buf, uint32_t val) {
+	buf[0] = (uint8_t) val;
+	buf[1] = (uint8_t) (val >> 8);
+	buf[2] = (uint8_t) (val >> 16);
+	buf[3] = (uint8_t) (val >> 24);
+}
+
+static int
+writeBytes(Writer *w, const void *buf, size_t size) {
+	if (size == 0)
+		return 0;
+	if ((uint64_t) w->offset + size > UINT32_MAX) {
+		fprintf(stderr, "Error: %s would get too large for a package.\n",
+				w->name);
+		return -1;
+	}
+	if (fwrite(buf, size, 1, w->file) != 1) {
+		fprintf(stderr, "Error writing to file %s: %s.\n", w->name,
+				strerror(errno));
+		return -1;
+	}
+	w->offset += size;
+	return 0;
+}
+
+static void
+setDosTime(Entry *entry) {
+	struct tm *tm = localtime(&entry->mtime);
+
+	if (tm == NULL || tm->tm_year < 80) {
+		// Before what a zip file can hold
+		entry->dosTime = 0;
+		entry->dosDate = (1 << 5) | 1;
+		return;
+	}
+	entry->dosTime = (tm->tm_hour << 11) | (tm->tm_min << 5)
+			| (tm->tm_sec / 2);
+	entry->dosDate = ((tm->tm_year - 80) << 9) | ((tm->tm_mon + 1) << 5)
+			| tm->tm_mday;
+}
+
+static uint8_t *
+readWholeFile(const char *path, size_t size) {
+	FILE *in;
+	uint8_t *data;
+
+	data = malloc(size > 0 ? size : 1);
+	if (data == NULL) {
+		fprintf(stderr, "Error: Out of memory.\n");
+		return NULL;
+	}
+
+	in = fopen(path, "rb");
+	if (in == NULL) {
+		fprintf(stderr, "Error: Could not open file %s: %s\n", path,
+				strerror(errno));
+		free(data);
+		return NULL;
+	}
+	if (size > 0 && fread(data, size, 1, in) != 1) {
+		fprintf(stderr, "Error reading file %s.\n", path);
+		fclose(in);
+		free(data);
+		return NULL;
+	}
+	fclose(in);
+	return data;
+}
+
+// Raw deflate, as zip files hold it. Returns NULL if the data does not
+// get any smaller.
+static uint8_t *
+deflateData(const uint8_t *data, size_t size, uint32_t *compSize) {
+	z_stream zs;
+	uint8_t *out;
+	uLong bound;
+	int status;
+
+	memset(&zs, '\0', sizeof zs);
+	if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK)
+		return NULL;
+
+	bound = deflateBound(&zs, size);
+	out = malloc(bound);
+	if (out == NULL) {
+		deflateEnd(&zs);
+		return NULL;
+	}
+
+	zs.next_in = (Bytef *) data;
+	zs.avail_in = size;
+	zs.next_out = out;
+	zs.avail_out = bound;
+	status = deflate(&zs, Z_FINISH);
+	deflateEnd(&zs);
+	if (status != Z_STREAM_END || zs.total_out >= size) {
+		free(out);
+		return NULL;
+	}
+
+	*compSize = zs.total_out;
+	return out;
+}
+
+static int
+writeEntry(Writer *w, Entry *entry, const struct options *opts) {
+	char path[PATH_MAX];
+	uint8_t header[LOCAL_HEADER_SIZE];
+	uint8_t *data;
+	uint8_t *compData = NULL;
+	uint8_t *extra = NULL;
+	size_t nameLen = strlen(entry->name);
+	size_t extraLen = 0;
+	int result;
+
+	snprintf(path, sizeof path, "%s/%s", opts->srcdir, entry->name);
+	data = readWholeFile(path, entry->size);
+	if (data == NULL)
+		return -1;
+
+	entry->crc = crc32(crc32(0L, Z_NULL, 0), data, entry->size);
+	entry->offset = w->offset;
+	setDosTime(entry);
+
+	if (isStreamedFile(entry->name) || (entry->order != -1
+			&& entry->size <= opts->storeMax))
+		entry->method = METHOD_STORED;
+	else {
+		compData = deflateData(data, entry->size, &entry->compSize);
+		entry->method = compData != NULL ? METHOD_DEFLATED : METHOD_STORED;
+	}
+
+	if (entry->method == METHOD_STORED)
+		entry->compSize = entry->size;
+	if (entry->method == METHOD_STORED && entry->size > opts->align) {
+		uint32_t dataStart = w->offset + LOCAL_HEADER_SIZE + nameLen;
+
+		extraLen = (opts->align - dataStart % opts->align) % opts->align;
+		if (extraLen > 0 && extraLen < 4) {
+			// Too short for an extra field header
+			extraLen += opts->align;
+		}
+		if (extraLen > 0) {
+			extra = calloc(1, extraLen);
+			if (extra == NULL) {
+				fprintf(stderr, "Error: Out of memory.\n");
+				free(data);
+				return -1;
+			}
+			put16(&extra[0], ALIGN_EXTRA_ID);
+			put16(&extra[2], extraLen - 4);
+		}
+	}
+
+	put32(&header[0], 0x04034b50);
+	put16(&header[4], entry->method == METHOD_DEFLATED ? 20 : 10);
+	put16(&header[6], 0);
+	put16(&header[8], entry->method);
+	put16(&header[10], entry->dosTime);
+	put16(&header[12], entry->dosDate);
+	put32(&header[14], entry->crc);
+	put32(&header[18], entry->compSize);
+	put32(&header[22], entry->size);
+	put16(&header[26], nameLen);
+	put16(&header[28], extraLen);
+
+	result = writeBytes(w, header, sizeof header);
+	if (result == 0)
+		result = writeBytes(w, entry->name, nameLen);
+	if (result == 0)
+		result = writeBytes(w, extra, extraLen);
+	if (result == 0) {
+		result = writeBytes(w, compData != NULL ? compData : data,
+				entry->compSize);
+	}
+
+	if (opts->verbose) {
+		fprintf(stderr, "%s %10lu %10lu  %s\n",
+				entry->method == METHOD_STORED ? "stored  " : "deflated",
+				(unsigned long) entry->size,
+				(unsigned long) entry->compSize, entry->name);
+	}
+
+	free(extra);
+	free(compData);
+	free(data);
+	return result;
+}
+
+static int
+writeCentralDirectory(Writer *w, const EntryList *list) {
+	uint8_t header[CENTRAL_HEADER_SIZE];
+	uint8_t end[END_OF_CENTRAL_DIR_SIZE];
+	uint32_t dirStart = w->offset;
+	size_t i;
+
+	for (i = 0; i < list->numEntries; i++) {
+		const Entry *entry = &list->entries[i];
+		size_t nameLen = strlen(entry->name);
+
+		put32(&header[0], 0x02014b50);
+		put16(&header[4], (3 << 8) | 20);
+				// Made on Unix, so the file mode below is used
+		put16(&header[6], entry->method == METHOD_DEFLATED ? 20 : 10);
+		put16(&header[8], 0);
+		put16(&header[10], entry->method);
+		put16(&header[12], entry->dosTime);
+		put16(&header[14], entry->dosDate);
+		put32(&header[16], entry->crc);
+		put32(&header[20], entry->compSize);
+		put32(&header[24], entry->size);
+		put16(&header[28], nameLen);
+		put16(&header[30], 0);
+		put16(&header[32], 0);
+		put16(&header[34], 0);
+		put16(&header[36], 0);
+		put32(&header[38], (uint32_t) (entry->mode & 0xffff) << 16);
+		put32(&header[42], entry->offset);
+
+		if (writeBytes(w, header, sizeof header) == -1
+				|| writeBytes(w, entry->name, nameLen) == -1)
+			return -1;
+	}
+
+	put32(&end[0], 0x06054b50);
+	put16(&end[4], 0);
+	put16(&end[6], 0);
+	put16(&end[8], list->numEntries);
+	put16(&end[10], list->numEntries);
+	put32(&end[12], w->offset - dirStart);
+	put32(&end[16], dirStart);
+	put16(&end[20], 0);
+	return writeBytes(w, end, sizeof end);
+}
+
+int
+writePackage(EntryList *list, const struct options *opts) {
+	Writer w;
+	size_t i;
+	int result = 0;
+
+	if (list->numEntries > 0xffff) {
+		fprintf(stderr, "Error: Too many files for a package.\n");
+		return -1;
+	}
+
+	w.name = opts->outfile;
+	w.offset = 0;
+	w.file = fopen(opts->outfile, "wb");
+	if (w.file == NULL) {
+		fprintf(stderr, "Error: Could not create file %s: %s\n",
+				opts->outfile, strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; result == 0 && i < list->numEntries; i++)
+		result = writeEntry(&w, &list->entries[i], opts);
+	if (result == 0)
+		result = writeCentralDirectory(&w, list);
+
+	if (fclose(w.file) != 0 && result == 0) {
+		fprintf(stderr, "Error writing to file %s: %s.\n", opts->outfile,
+				strerror(errno));
+		result = -1;
+	}
+	if (result == -1)
+		unlink(opts->outfile);
+	return result;
+}
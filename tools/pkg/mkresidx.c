@@ -0,0 +1,425 @@
+/*
+ * Resource index (.rmp) compiler
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Writes "foo.rmpc" next to each "foo.rmp" given, holding the same
+// entries with the parsing done: key, type and value split apart, one
+// entry per key (the last one, as when the text is loaded), sorted by
+// key, and each string stored once. See sc2/src/libs/resource/rmpindex.c
+// for the layout; the game uses the compiled index when it is not older
+// than the .rmp.
+//
+// Run it again whenever a .rmp changes, and before packing the content
+// with mkpkg.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RMPC_MAGIC "URIX"
+#define RMPC_VERSION 1
+#define RMPC_HEADER_SIZE 24
+#define RMPC_NO_TYPE 0xffffffff
+
+#define MAX_TYPE_LEN 27
+		// Longer types are cut short by the game; those entries are left
+		// for it to work out from the value
+
+typedef struct {
+	const char *key;
+	const char *value;
+	size_t line;
+			// To keep the last of the entries with the same key
+	uint32_t keyOfs;
+	uint32_t valueOfs;
+	uint32_t type;
+} Entry;
+
+typedef struct {
+	char *data;
+	size_t size;
+	size_t max;
+	// Open addressing hash of the offsets of the strings in data
+	uint32_t *slots;
+	size_t numSlots;
+	size_t numStrings;
+} StringTable;
+
+typedef struct {
+	char *names[64];
+	uint32_t ofs[64];
+	size_t count;
+} TypeTable;
+
+static char verbose;
+
+
+static void
+usage() {
+	fprintf(stderr, "mkresidx [-v] <file.rmp>...\n"
+			"Writes <file.rmpc> next to each index file.\n");
+}
+
+static void *
+xrealloc(void *ptr, size_t size) {
+	void *result = realloc(ptr, size);
+	if (result == NULL) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	return result;
+}
+
+static uint32_t
+hashString(const char *str) {
+	uint32_t hash = 2166136261u;
+	while (*str != '\0') {
+		hash = (hash ^ (unsigned char) *str) * 16777619u;
+		str++;
+	}
+	return hash;
+}
+
+static void
+growSlots(StringTable *table) {
+	size_t numSlots = table->numSlots ? table->numSlots * 2 : 1024;
+	uint32_t *slots = xrealloc(NULL, numSlots * sizeof *slots);
+	size_t i;
+
+	memset(slots, 0xff, numSlots * sizeof *slots);
+	for (i = 0; i < table->numSlots; i++) {
+		size_t slot;
+		if (table->slots[i] == UINT32_MAX)
+			continue;
+		slot = hashString(table->data + table->slots[i]) & (numSlots - 1);
+		while (slots[slot] != UINT32_MAX)
+			slot = (slot + 1) & (numSlots - 1);
+		slots[slot] = table->slots[i];
+	}
+	free(table->slots);
+	table->slots = slots;
+	table->numSlots = numSlots;
+}
+
+// Returns the offset of str in the table, adding it if it is not there
+static uint32_t
+internString(StringTable *table, const char *str) {
+	size_t len = strlen(str) + 1;
+	size_t slot;
+
+	if (table->numStrings * 2 >= table->numSlots)
+		growSlots(table);
+	slot = hashString(str) & (table->numSlots - 1);
+	while (table->slots[slot] != UINT32_MAX) {
+		if (strcmp(table->data + table->slots[slot], str) == 0)
+			return table->slots[slot];
+		slot = (slot + 1) & (table->numSlots - 1);
+	}
+
+	while (table->size + len > table->max) {
+		table->max = table->max ? table->max * 2 : 65536;
+		table->data = xrealloc(table->data, table->max);
+	}
+	memcpy(table->data + table->size, str, len);
+	table->slots[slot] = (uint32_t) table->size;
+	table->numStrings++;
+	table->size += len;
+	return table->slots[slot];
+}
+
+static void
+put32(uint8_t *buf, uint32_t val) {
+	buf[0] = val & 0xff;
+	buf[1] = (val >> 8) & 0xff;
+	buf[2] = (val >> 16) & 0xff;
+	buf[3] = (val >> 24) & 0xff;
+}
+
+// Splits the index file up the way the game's PropFile_from_string()
+// does, terminating the keys and values in place
+static size_t
+parseIndex(char *d, Entry **entries) {
+	size_t len = strlen(d);
+	size_t i = 0;
+	size_t num = 0, max = 0;
+
+	*entries = NULL;
+	while (i < len) {
+		size_t key_start, key_end, value_start, value_end;
+
+		while (i < len && isspace((unsigned char) d[i]))
+			i++;
+		if (i >= len)
+			break;
+		if (d[i] == '#') {
+			while (i < len && d[i] != '\n')
+				i++;
+			continue;
+		}
+		key_start = i;
+		while (i < len && d[i] != '=' && d[i] != '\n' && d[i] != '#')
+			i++;
+		if (i >= len) {
+			fprintf(stderr, "Warning: Bare keyword at EOF\n");
+			break;
+		}
+		if (d[i] != '=') {
+			fprintf(stderr, "Warning: Key without value\n");
+			while (i < len && d[i] != '\n')
+				i++;
+			continue;
+		}
+		key_end = i;
+		while (key_end > key_start && isspace((unsigned char) d[key_end - 1]))
+			key_end--;
+
+		i++;
+		while (i < len && d[i] != '#' && d[i] != '\n'
+				&& isspace((unsigned char) d[i]))
+			i++;
+		value_start = i;
+		while (i < len && d[i] != '#' && d[i] != '\n')
+			i++;
+		value_end = i;
+		while (value_end > value_start
+				&& isspace((unsigned char) d[value_end - 1]))
+			value_end--;
+		while (i < len && d[i] != '\n')
+			i++;
+		i++;
+
+		d[key_end] = '\0';
+		d[value_end] = '\0';
+		if (num == max) {
+			max = max ? max * 2 : 256;
+			*entries = xrealloc(*entries, max * sizeof **entries);
+		}
+		(*entries)[num].key = d + key_start;
+		(*entries)[num].value = d + value_start;
+		(*entries)[num].line = num;
+		num++;
+	}
+	return num;
+}
+
+static int
+compareEntries(const void *a, const void *b) {
+	const Entry *ea = a;
+	const Entry *eb = b;
+	int result = strcmp(ea->key, eb->key);
+	if (result != 0)
+		return result;
+	return ea->line < eb->line ? -1 : ea->line > eb->line;
+}
+
+static uint32_t
+typeIndex(TypeTable *types, StringTable *strings, const char *value) {
+	const char *colon = strchr(value, ':');
+	size_t len;
+	char name[MAX_TYPE_LEN + 1];
+	size_t i;
+
+	if (colon == NULL)
+		return RMPC_NO_TYPE;
+	len = colon - value;
+	if (len > MAX_TYPE_LEN)
+		return RMPC_NO_TYPE;
+	memcpy(name, value, len);
+	name[len] = '\0';
+
+	for (i = 0; i < types->count; i++) {
+		if (strcmp(types->names[i], name) == 0)
+			return (uint32_t) i;
+	}
+	if (types->count == sizeof types->names / sizeof types->names[0])
+		return RMPC_NO_TYPE;
+	types->names[types->count] = strdup(name);
+	types->ofs[types->count] = internString(strings, name);
+	return (uint32_t) types->count++;
+}
+
+static char *
+readWholeFile(const char *path, size_t *size) {
+	FILE *file;
+	char *data;
+	struct stat sb;
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open '%s': %s\n", path, strerror(errno));
+		return NULL;
+	}
+	if (fstat(fileno(file), &sb) == -1) {
+		fprintf(stderr, "Could not stat '%s': %s\n", path, strerror(errno));
+		fclose(file);
+		return NULL;
+	}
+	*size = (size_t) sb.st_size;
+	data = xrealloc(NULL, *size + 1);
+	if (fread(data, 1, *size, file) != *size) {
+		fprintf(stderr, "Could not read '%s'.\n", path);
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+	data[*size] = '\0';
+	return data;
+}
+
+static int
+writeIndex(const char *outPath, size_t srcSize, Entry *entries,
+		size_t numEntries, const TypeTable *types,
+		const StringTable *strings) {
+	FILE *out;
+	uint8_t header[RMPC_HEADER_SIZE];
+	size_t i;
+	int ok;
+
+	out = fopen(outPath, "wb");
+	if (out == NULL) {
+		fprintf(stderr, "Could not create '%s': %s\n", outPath,
+				strerror(errno));
+		return -1;
+	}
+
+	memcpy(header, RMPC_MAGIC, 4);
+	put32(header + 4, RMPC_VERSION);
+	put32(header + 8, (uint32_t) srcSize);
+	put32(header + 12, (uint32_t) types->count);
+	put32(header + 16, (uint32_t) numEntries);
+	put32(header + 20, (uint32_t) strings->size);
+	ok = fwrite(header, sizeof header, 1, out) == 1;
+
+	for (i = 0; ok && i < types->count; i++) {
+		uint8_t buf[4];
+		put32(buf, types->ofs[i]);
+		ok = fwrite(buf, sizeof buf, 1, out) == 1;
+	}
+	for (i = 0; ok && i < numEntries; i++) {
+		uint8_t buf[12];
+		put32(buf, entries[i].keyOfs);
+		put32(buf + 4, entries[i].valueOfs);
+		put32(buf + 8, entries[i].type);
+		ok = fwrite(buf, sizeof buf, 1, out) == 1;
+	}
+	if (ok && strings->size > 0)
+		ok = fwrite(strings->data, strings->size, 1, out) == 1;
+
+	if (fclose(out) != 0)
+		ok = 0;
+	if (!ok) {
+		fprintf(stderr, "Could not write '%s'.\n", outPath);
+		unlink(outPath);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+compileIndex(const char *path) {
+	char *text;
+	size_t size;
+	Entry *entries;
+	size_t numEntries, numKept, i;
+	StringTable strings;
+	TypeTable types;
+	char *outPath;
+	int result;
+
+	text = readWholeFile(path, &size);
+	if (text == NULL)
+		return -1;
+	numEntries = parseIndex(text, &entries);
+
+	// Sorted, with the entries for the same key in file order, so the
+	// last of them is the one kept
+	qsort(entries, numEntries, sizeof *entries, compareEntries);
+	numKept = 0;
+	for (i = 0; i < numEntries; i++) {
+		if (i + 1 < numEntries
+				&& strcmp(entries[i].key, entries[i + 1].key) == 0)
+			continue;
+		entries[numKept++] = entries[i];
+	}
+
+	memset(&strings, 0, sizeof strings);
+	memset(&types, 0, sizeof types);
+	for (i = 0; i < numKept; i++) {
+		entries[i].keyOfs = internString(&strings, entries[i].key);
+		entries[i].valueOfs = internString(&strings, entries[i].value);
+		entries[i].type = typeIndex(&types, &strings, entries[i].value);
+	}
+	if (strings.size == 0)
+		internString(&strings, "");
+
+	outPath = xrealloc(NULL, strlen(path) + 2);
+	sprintf(outPath, "%sc", path);
+	result = writeIndex(outPath, size, entries, numKept, &types, &strings);
+	if (result == 0 && verbose) {
+		fprintf(stderr, "%s: %lu entries (%lu duplicates dropped), "
+				"%lu types, %lu bytes of strings\n", outPath,
+				(unsigned long) numKept,
+				(unsigned long) (numEntries - numKept),
+				(unsigned long) types.count, (unsigned long) strings.size);
+	}
+
+	for (i = 0; i < types.count; i++)
+		free(types.names[i]);
+	free(outPath);
+	free(strings.slots);
+	free(strings.data);
+	free(entries);
+	free(text);
+	return result;
+}
+
+int
+main(int argc, char *argv[]) {
+	int c;
+	int failed = 0;
+
+	while ((c = getopt(argc, argv, "vh")) != -1) {
+		switch (c) {
+			case 'v':
+				verbose = 1;
+				break;
+			case 'h':
+				usage();
+				return EXIT_SUCCESS;
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	for (; optind < argc; optind++) {
+		if (compileIndex(argv[optind]) == -1)
+			failed = 1;
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}